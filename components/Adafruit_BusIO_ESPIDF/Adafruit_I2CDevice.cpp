@@ -34,7 +34,9 @@ i2c_port_num_t Adafruit_I2CDevice::s_default_port = I2C_NUM_0;
 Adafruit_I2CDevice::Adafruit_I2CDevice(uint8_t addr, void* theWire)
     : addr_(addr), bus_handle_(nullptr), device_handle_(nullptr), 
       initialized_(false), sda_pin_(s_default_sda), scl_pin_(s_default_scl), 
-      i2c_freq_(s_default_freq), i2c_port_(s_default_port) {
+      i2c_freq_(s_default_freq), i2c_port_(s_default_port), async_queue_(nullptr),
+      async_done_(nullptr), async_task_(nullptr), async_in_flight_(0),
+      async_failed_(false), timeout_ms_(DEFAULT_TIMEOUT_MS) {
     // If theWire is provided, use it (cast from void*)
     if (theWire) {
         bus_handle_ = static_cast<i2c_master_bus_handle_t>(theWire);
@@ -58,6 +60,16 @@ Adafruit_I2CDevice::Adafruit_I2CDevice(uint8_t addr, void* theWire)
 }
 
 Adafruit_I2CDevice::~Adafruit_I2CDevice() {
+    waitAsync();
+    if (async_task_) {
+        vTaskDelete(async_task_);
+    }
+    if (async_queue_) {
+        vQueueDelete(async_queue_);
+    }
+    if (async_done_) {
+        vQueueDelete(async_done_);
+    }
     end();
 }
 
@@ -162,18 +174,7 @@ bool Adafruit_I2CDevice::begin(bool addr_detect) {
         return false;
     }
     
-    // Configure I2C device
-    // CRITICAL: Must use memset for ESP-IDF v5.5 structs with unions/flags
-    i2c_device_config_t dev_cfg;
-    memset(&dev_cfg, 0, sizeof(dev_cfg));
-    dev_cfg.dev_addr_length = I2C_ADDR_BIT_LEN_7;
-    dev_cfg.device_address = addr_;
-    dev_cfg.scl_speed_hz = i2c_freq_;
-    
-    esp_err_t ret = i2c_master_bus_add_device(bus_handle_, &dev_cfg, &device_handle_);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG_I2C, "Failed to add I2C device (addr=0x%02X) to bus: %s", 
-                 addr_, esp_err_to_name(ret));
+    if (!addDevice(i2c_freq_)) {
         return false;
     }
     
@@ -198,6 +199,25 @@ bool Adafruit_I2CDevice::begin(bool addr_detect) {
     return true;
 }
 
+bool Adafruit_I2CDevice::addDevice(uint32_t freq) {
+    // Configure I2C device
+    // CRITICAL: Must use memset for ESP-IDF v5.5 structs with unions/flags
+    i2c_device_config_t dev_cfg;
+    memset(&dev_cfg, 0, sizeof(dev_cfg));
+    dev_cfg.dev_addr_length = I2C_ADDR_BIT_LEN_7;
+    dev_cfg.device_address = addr_;
+    dev_cfg.scl_speed_hz = freq;
+    
+    esp_err_t ret = i2c_master_bus_add_device(bus_handle_, &dev_cfg, &device_handle_);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG_I2C, "Failed to add I2C device (addr=0x%02X) to bus: %s", 
+                 addr_, esp_err_to_name(ret));
+        return false;
+    }
+    
+    return true;
+}
+
 void Adafruit_I2CDevice::end() {
     if (device_handle_) {
         esp_err_t ret = i2c_master_bus_rm_device(device_handle_);
@@ -226,7 +246,7 @@ bool Adafruit_I2CDevice::read(uint8_t *buffer, size_t len, bool stop) {
         return false;
     }
     
-    esp_err_t ret = i2c_master_receive(device_handle_, buffer, len, pdMS_TO_TICKS(1000));
+    esp_err_t ret = i2c_master_receive(device_handle_, buffer, len, pdMS_TO_TICKS(timeout_ms_));
     if (ret != ESP_OK) {
         ESP_LOGE(TAG_I2C, "I2C read failed (addr=0x%02X, len=%zu): %s", 
                  addr_, len, esp_err_to_name(ret));
@@ -244,54 +264,107 @@ bool Adafruit_I2CDevice::write(const uint8_t *buffer, size_t len, bool stop,
         return false;
     }
     
-    // Combine prefix and data if prefix is provided
+    esp_err_t ret;
+    size_t total_len = len;
     if (prefix_buffer && prefix_len > 0) {
-        // Use stack buffer for small transfers, heap for large ones
-        const size_t max_stack_size = 64;
-        size_t total_len = prefix_len + len;
-        
-        if (total_len <= max_stack_size) {
-            uint8_t combined[max_stack_size];
-            memcpy(combined, prefix_buffer, prefix_len);
-            memcpy(combined + prefix_len, buffer, len);
-            
-            esp_err_t ret = i2c_master_transmit(device_handle_, combined, total_len, pdMS_TO_TICKS(1000));
-            if (ret != ESP_OK) {
-                ESP_LOGE(TAG_I2C, "I2C write failed (addr=0x%02X, len=%zu): %s", 
-                         addr_, total_len, esp_err_to_name(ret));
-                return false;
-            }
-        } else {
-            // Large transfer - use dynamic allocation
-            uint8_t* combined = (uint8_t*)malloc(total_len);
-            if (!combined) {
-                ESP_LOGE(TAG_I2C, "I2C write: Failed to allocate buffer for %zu bytes", total_len);
-                return false;
-            }
-            memcpy(combined, prefix_buffer, prefix_len);
-            memcpy(combined + prefix_len, buffer, len);
-            
-            esp_err_t ret = i2c_master_transmit(device_handle_, combined, total_len, pdMS_TO_TICKS(1000));
-            free(combined);
-            
-            if (ret != ESP_OK) {
-                ESP_LOGE(TAG_I2C, "I2C write failed (addr=0x%02X, len=%zu): %s", 
-                         addr_, total_len, esp_err_to_name(ret));
-                return false;
-            }
-        }
+        // Prefix and data as one transaction, each sent from where it is
+        i2c_master_transmit_multi_buffer_info_t parts[2] = {
+            { const_cast<uint8_t*>(prefix_buffer), prefix_len },
+            { const_cast<uint8_t*>(buffer), len },
+        };
+        total_len += prefix_len;
+        ret = i2c_master_multi_buffer_transmit(device_handle_, parts, 2, pdMS_TO_TICKS(timeout_ms_));
     } else {
-        esp_err_t ret = i2c_master_transmit(device_handle_, buffer, len, pdMS_TO_TICKS(1000));
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG_I2C, "I2C write failed (addr=0x%02X, len=%zu): %s", 
-                     addr_, len, esp_err_to_name(ret));
-            return false;
+        ret = i2c_master_transmit(device_handle_, buffer, len, pdMS_TO_TICKS(timeout_ms_));
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG_I2C, "I2C write failed (addr=0x%02X, len=%zu): %s", 
+                 addr_, total_len, esp_err_to_name(ret));
+        return false;
+    }
+    
+    return true;
+}
+
+bool Adafruit_I2CDevice::startAsync() {
+    if (async_task_) {
+        return true;
+    }
+    if (!async_queue_) {
+        async_queue_ = xQueueCreate(ASYNC_QUEUE_DEPTH, sizeof(AsyncWrite));
+    }
+    if (!async_done_) {
+        async_done_ = xQueueCreate(ASYNC_QUEUE_DEPTH, sizeof(bool));
+    }
+    if (!async_queue_ || !async_done_ ||
+        xTaskCreate(asyncTask, "i2c_async", 3072, this, 5, &async_task_) != pdPASS) {
+        ESP_LOGE(TAG_I2C, "I2C async: failed to start the worker (addr=0x%02X)", addr_);
+        async_task_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void Adafruit_I2CDevice::asyncTask(void *arg) {
+    Adafruit_I2CDevice *dev = static_cast<Adafruit_I2CDevice*>(arg);
+    AsyncWrite job;
+    while (true) {
+        xQueueReceive(dev->async_queue_, &job, portMAX_DELAY);
+        bool ok = dev->write(job.buffer, job.len, true,
+                             job.prefix_len ? job.prefix : nullptr, job.prefix_len);
+        if (job.cb) {
+            job.cb(job.cb_arg, ok);
         }
+        xQueueSend(dev->async_done_, &ok, portMAX_DELAY);
+    }
+}
+
+bool Adafruit_I2CDevice::writeAsync(const uint8_t *buffer, size_t len,
+                                    const uint8_t *prefix_buffer, size_t prefix_len,
+                                    I2CAsyncCallback cb, void *cb_arg) {
+    if (!initialized_ || !buffer || len == 0 || prefix_len > ASYNC_PREFIX_MAX ||
+        !startAsync()) {
+        return false;
+    }
+    
+    // Collect the oldest result if every slot is taken, so async_done_ can't fill up
+    if (async_in_flight_ == ASYNC_QUEUE_DEPTH) {
+        bool ok;
+        xQueueReceive(async_done_, &ok, portMAX_DELAY);
+        async_in_flight_--;
+        async_failed_ |= !ok;
     }
     
+    AsyncWrite job = {};
+    job.buffer = buffer;
+    job.len = len;
+    if (prefix_buffer && prefix_len > 0) {
+        memcpy(job.prefix, prefix_buffer, prefix_len);
+        job.prefix_len = static_cast<uint8_t>(prefix_len);
+    }
+    job.cb = cb;
+    job.cb_arg = cb_arg;
+    if (xQueueSend(async_queue_, &job, portMAX_DELAY) != pdTRUE) {
+        return false;
+    }
+    async_in_flight_++;
     return true;
 }
 
+bool Adafruit_I2CDevice::waitAsync(TickType_t timeout) {
+    bool all_ok = !async_failed_;
+    async_failed_ = false;
+    while (async_in_flight_ > 0) {
+        bool ok;
+        if (xQueueReceive(async_done_, &ok, timeout) != pdTRUE) {
+            return false;
+        }
+        async_in_flight_--;
+        all_ok &= ok;
+    }
+    return all_ok;
+}
+
 bool Adafruit_I2CDevice::write_then_read(const uint8_t *write_buffer, size_t write_len,
                                          uint8_t *read_buffer, size_t read_len, bool stop) {
     if (!initialized_ || !device_handle_) {
@@ -301,7 +374,7 @@ bool Adafruit_I2CDevice::write_then_read(const uint8_t *write_buffer, size_t wri
     
     if (write_buffer && write_len > 0) {
         esp_err_t ret = i2c_master_transmit(device_handle_, write_buffer, write_len, 
-                                            pdMS_TO_TICKS(1000));
+                                            pdMS_TO_TICKS(timeout_ms_));
         if (ret != ESP_OK) {
             ESP_LOGE(TAG_I2C, "I2C write_then_read: write failed (addr=0x%02X, len=%zu): %s", 
                      addr_, write_len, esp_err_to_name(ret));
@@ -311,7 +384,7 @@ bool Adafruit_I2CDevice::write_then_read(const uint8_t *write_buffer, size_t wri
     
     if (read_buffer && read_len > 0) {
         esp_err_t ret = i2c_master_receive(device_handle_, read_buffer, read_len, 
-                                          pdMS_TO_TICKS(1000));
+                                          pdMS_TO_TICKS(timeout_ms_));
         if (ret != ESP_OK) {
             ESP_LOGE(TAG_I2C, "I2C write_then_read: read failed (addr=0x%02X, len=%zu): %s", 
                      addr_, read_len, esp_err_to_name(ret));
@@ -323,11 +396,64 @@ bool Adafruit_I2CDevice::write_then_read(const uint8_t *write_buffer, size_t wri
 }
 
 bool Adafruit_I2CDevice::setSpeed(uint32_t desiredclk) {
-    // I2C speed is set per device in ESP-IDF, but we can't change it dynamically
-    // Store desired frequency for future use (would need to recreate device to apply)
+    if (desiredclk == 0 || desiredclk > SPEED_FAST_PLUS) {
+        ESP_LOGE(TAG_I2C, "I2C speed %lu Hz out of range (max %lu Hz)",
+                 (unsigned long)desiredclk, (unsigned long)SPEED_FAST_PLUS);
+        return false;
+    }
+    if (!initialized_ || !device_handle_) {
+        i2c_freq_ = desiredclk;
+        return true;
+    }
+    if (desiredclk == i2c_freq_) {
+        return true;
+    }
+    
+    // The clock is fixed when a device is added, so re-add it. Queued writes
+    // go out at the old clock first
+    waitAsync();
+    esp_err_t ret = i2c_master_bus_rm_device(device_handle_);
+    device_handle_ = nullptr;
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG_I2C, "I2C speed change: failed to remove device (addr=0x%02X): %s",
+                 addr_, esp_err_to_name(ret));
+        initialized_ = false;
+        return false;
+    }
+    if (!addDevice(desiredclk)) {
+        // Back to the clock that worked, so the device stays usable
+        if (!addDevice(i2c_freq_)) {
+            initialized_ = false;
+        }
+        return false;
+    }
     i2c_freq_ = desiredclk;
-    ESP_LOGW(TAG_I2C, "I2C speed change requested to %lu Hz, but device already initialized. "
-             "Speed can only be changed before begin() is called.", (unsigned long)desiredclk);
+    ESP_LOGI(TAG_I2C, "I2C device 0x%02X now at %lu Hz", addr_, (unsigned long)i2c_freq_);
     return true;
 }
 
+uint32_t Adafruit_I2CDevice::negotiateSpeed(const uint32_t *clocks, size_t count,
+                                            const uint8_t *probe, size_t probe_len) {
+    if (!initialized_ || !clocks || !probe || probe_len == 0) {
+        return 0;
+    }
+    
+    // Nothing else can tell a too-fast clock from a healthy one, so keep the
+    // first clock the device acknowledges a harmless write at
+    uint32_t previous = i2c_freq_;
+    uint32_t saved_timeout = timeout_ms_;
+    timeout_ms_ = NEGOTIATE_TIMEOUT_MS;
+    uint32_t chosen = 0;
+    for (size_t i = 0; i < count && chosen == 0; i++) {
+        if (setSpeed(clocks[i]) && write(probe, probe_len)) {
+            chosen = clocks[i];
+        }
+    }
+    timeout_ms_ = saved_timeout;
+    if (chosen == 0) {
+        setSpeed(previous);
+        ESP_LOGW(TAG_I2C, "I2C device 0x%02X answered at none of %zu clocks, staying at %lu Hz",
+                 addr_, count, (unsigned long)i2c_freq_);
+    }
+    return chosen;
+}
@@ -18,8 +18,18 @@
 #include "driver/i2c_master.h"
 #include "driver/gpio.h"
 #include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "soc/soc_caps.h"
 
+/**
+ * @brief Completion callback for Adafruit_I2CDevice::writeAsync()
+ *
+ * Runs on the device's I2C worker task, not in an ISR.
+ */
+typedef void (*I2CAsyncCallback)(void *arg, bool ok);
+
 /**
  * @brief I2C device wrapper compatible with Adafruit libraries
  * 
@@ -80,6 +90,9 @@ public:
     
     /**
      * @brief Write data to I2C device
+     *
+     * The prefix and the data go out as one transaction straight from both
+     * buffers; nothing is copied or allocated.
      * @param buffer Data to write
      * @param len Number of bytes to write
      * @param stop Send stop condition after write
@@ -90,6 +103,41 @@ public:
     bool write(const uint8_t *buffer, size_t len, bool stop = true,
                const uint8_t *prefix_buffer = nullptr, size_t prefix_len = 0);
     
+    /**
+     * @brief Queue a write for the device's worker task and return
+     *
+     * buffer must stay valid and unmodified until cb runs or waitAsync()
+     * returns; up to ASYNC_PREFIX_MAX prefix bytes are copied. Writes go out
+     * in order. The worker task is created on the first call, after which
+     * queuing allocates nothing; blocks only when ASYNC_QUEUE_DEPTH writes
+     * are in flight.
+     * @param buffer Data to write
+     * @param len Number of bytes to write
+     * @param prefix_buffer Optional prefix data (e.g., the data mode byte)
+     * @param prefix_len Length of prefix data, at most ASYNC_PREFIX_MAX
+     * @param cb Optional callback once the write is done
+     * @param cb_arg Argument for cb
+     * @return false if the write couldn't be queued
+     */
+    bool writeAsync(const uint8_t *buffer, size_t len,
+                    const uint8_t *prefix_buffer = nullptr, size_t prefix_len = 0,
+                    I2CAsyncCallback cb = nullptr, void *cb_arg = nullptr);
+    
+    /**
+     * @brief Wait until every queued write is done
+     * @param timeout Longest wait for each write
+     * @return false on timeout or if any of them failed
+     */
+    bool waitAsync(TickType_t timeout = portMAX_DELAY);
+    
+    /**
+     * @brief Number of queued writes not yet collected by waitAsync()
+     */
+    size_t pendingAsync(void) const { return async_in_flight_; }
+    
+    static constexpr size_t ASYNC_QUEUE_DEPTH = 4;  ///< writeAsync() slots
+    static constexpr size_t ASYNC_PREFIX_MAX = 4;   ///< prefix bytes a slot holds
+    
     /**
      * @brief Write then read (for register-based devices)
      * @param write_buffer Data to write
@@ -103,13 +151,52 @@ public:
                         uint8_t *read_buffer, size_t read_len,
                         bool stop = false);
     
+    static constexpr uint32_t SPEED_STANDARD = 100000;    ///< Standard mode, Hz
+    static constexpr uint32_t SPEED_FAST = 400000;        ///< Fast mode, Hz
+    static constexpr uint32_t SPEED_FAST_PLUS = 1000000;  ///< Fast mode plus, Hz
+    
     /**
-     * @brief Set I2C bus speed (not implemented, uses bus default)
-     * @param desiredclk Desired clock frequency in Hz
-     * @return true if successful
+     * @brief Set the device's I2C clock
+     *
+     * Before begin() this only records it. After, the device is re-added to
+     * the bus at the new clock (queued writes finish first); if that fails it
+     * is re-added at the old one.
+     * @param desiredclk Clock in Hz, up to SPEED_FAST_PLUS
+     * @return false if out of range or the device couldn't be re-added
      */
     bool setSpeed(uint32_t desiredclk);
     
+    /**
+     * @brief Pick the fastest clock the device keeps up with
+     *
+     * Tries each clock in order, fastest first, and keeps the first one at
+     * which the device acknowledges probe, a write with no side effects
+     * (e.g. a NOP command). Each attempt times out after
+     * NEGOTIATE_TIMEOUT_MS.
+     * @param clocks Clocks in Hz
+     * @param count Number of clocks
+     * @param probe Bytes to write at each clock
+     * @param probe_len Length of probe
+     * @return The clock chosen, or 0 if none worked (the clock is then left
+     *         as it was)
+     */
+    uint32_t negotiateSpeed(const uint32_t *clocks, size_t count,
+                            const uint8_t *probe, size_t probe_len);
+    
+    /**
+     * @brief Current I2C clock in Hz
+     */
+    uint32_t speed(void) const { return i2c_freq_; }
+    
+    /**
+     * @brief How long a read or write may block before it fails
+     * @param ms Timeout in milliseconds (DEFAULT_TIMEOUT_MS until set)
+     */
+    void setTimeout(uint32_t ms) { timeout_ms_ = ms; }
+    
+    static constexpr uint32_t DEFAULT_TIMEOUT_MS = 1000;   ///< setTimeout() default
+    static constexpr uint32_t NEGOTIATE_TIMEOUT_MS = 20;   ///< Per negotiateSpeed() try
+    
     /**
      * @brief Get maximum buffer size for I2C transactions
      * @return Maximum buffer size (typically 512 bytes for ESP-IDF)
@@ -194,9 +281,30 @@ private:
     uint32_t i2c_freq_;                         // I2C frequency
     i2c_port_num_t i2c_port_;                   // I2C port number
     
+    // One writeAsync() request
+    struct AsyncWrite {
+        const uint8_t *buffer;
+        size_t len;
+        uint8_t prefix[ASYNC_PREFIX_MAX];
+        uint8_t prefix_len;
+        I2CAsyncCallback cb;
+        void *cb_arg;
+    };
+    QueueHandle_t async_queue_;                 // AsyncWrite, to the worker
+    QueueHandle_t async_done_;                  // bool result per finished write
+    TaskHandle_t async_task_;                   // Worker, nullptr until first use
+    size_t async_in_flight_;                    // Queued, not yet collected
+    bool async_failed_;                         // A write collected early failed
+    uint32_t timeout_ms_;                       // setTimeout()
+    bool startAsync();
+    static void asyncTask(void *arg);
+    
     // Initialize I2C bus if not already initialized
     bool initBus();
     
+    // Add the device to bus_handle_ at freq, into device_handle_
+    bool addDevice(uint32_t freq);
+    
     // Get default pins based on chip type
     static gpio_num_t getDefaultSda();
     static gpio_num_t getDefaultScl();
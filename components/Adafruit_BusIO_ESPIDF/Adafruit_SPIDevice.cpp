@@ -1,16 +1,29 @@
 #include "Adafruit_SPIDevice.h"
 #include "driver/spi_master.h"
 #include "driver/gpio.h"
+#include "hal/gpio_ll.h"
 #include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_memory_utils.h"
+#include <algorithm>
+#include <cstring>
 
 static const char* TAG = "Adafruit_SPIDevice";
 
+// Scratch size for writeInverted() and staged writes; large enough that a
+// full EPD plane only takes a handful of transactions, small enough to live
+// on the caller's stack
+static constexpr size_t STAGING_CHUNK_SIZE = 512;
+
 // Constructor for hardware SPI
 Adafruit_SPIDevice::Adafruit_SPIDevice(int8_t cspin, uint32_t freq,
                                        BusIOBitOrder dataOrder,
                                        uint8_t dataMode, SPIClass *theSPI)
     : _spi(theSPI), _freq(freq), _dataOrder(dataOrder), _dataMode(dataMode),
-      _cs(cspin), _sck(-1), _mosi(-1), _miso(-1), _begun(false),
+      _cs(cspin), _sck(-1), _mosi(-1), _miso(-1), _dc(-1), _dcLevel(1), _begun(false), _suspended(false),
+      _maxTransfer(SPIClass::DEFAULT_MAX_TRANSFER_SZ), _slots{}, _slotHead(0),
+      _inFlight(0), _busAcquired(0), _stats{}, _tap(nullptr), _tapArg(nullptr),
       spi_device_(nullptr), spi_host_(SPI2_HOST) {
     // Get SPI host from SPIClass if available
     if (_spi != nullptr) {
@@ -24,13 +37,19 @@ Adafruit_SPIDevice::Adafruit_SPIDevice(int8_t cspin, int8_t sck, int8_t miso, in
                                        BusIOBitOrder dataOrder,
                                        uint8_t dataMode)
     : _spi(nullptr), _freq(freq), _dataOrder(dataOrder), _dataMode(dataMode),
-      _cs(cspin), _sck(sck), _mosi(mosi), _miso(miso), _begun(false),
+      _cs(cspin), _sck(sck), _mosi(mosi), _miso(miso), _dc(-1), _dcLevel(1), _begun(false), _suspended(false),
+      _maxTransfer(SPIClass::DEFAULT_MAX_TRANSFER_SZ), _slots{}, _slotHead(0),
+      _inFlight(0), _busAcquired(0), _stats{}, _tap(nullptr), _tapArg(nullptr),
       spi_device_(nullptr), spi_host_(SPI2_HOST) {
     // Software SPI not implemented - would need bit-banging
 }
 
 Adafruit_SPIDevice::~Adafruit_SPIDevice() {
     if (_begun && spi_device_ != nullptr) {
+        waitAsync();
+        while (_busAcquired > 0) {
+            releaseBus();
+        }
         spi_bus_remove_device(spi_device_);
     }
 }
@@ -44,6 +63,9 @@ bool Adafruit_SPIDevice::begin(void) {
     // Configure CS pin
     pinMode(_cs, OUTPUT);
     digitalWrite(_cs, HIGH);
+    if (_dc >= 0) {
+        pinMode(_dc, OUTPUT);
+    }
     
     if (_spi == nullptr) {
         // Software SPI not supported
@@ -60,56 +82,182 @@ bool Adafruit_SPIDevice::begin(void) {
         return false;
     }
     
-    // Get SPI host from SPIClass
+    // Get SPI host and transaction size limit from SPIClass
     spi_host_ = _spi->getHost();
+    _maxTransfer = _spi->getMaxTransferSize();
     
     // Add SPI device to the existing bus
+    esp_err_t ret = addDevice();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add SPI device: %s", esp_err_to_name(ret));
+        return false;
+    }
+    
+    _begun = true;
+    return true;
+}
+
+esp_err_t Adafruit_SPIDevice::addDevice(uint32_t flags) {
     spi_device_interface_config_t dev_cfg = {};
     dev_cfg.clock_speed_hz = _freq;
     dev_cfg.mode = _dataMode;
     dev_cfg.spics_io_num = static_cast<gpio_num_t>(_cs);
-    dev_cfg.queue_size = 1;
-    dev_cfg.flags = (_dataOrder == SPI_BITORDER_LSBFIRST) ? SPI_DEVICE_BIT_LSBFIRST : 0;
-    dev_cfg.pre_cb = nullptr;
+    dev_cfg.queue_size = ASYNC_QUEUE_DEPTH;
+    dev_cfg.flags = flags | ((_dataOrder == SPI_BITORDER_LSBFIRST) ? SPI_DEVICE_BIT_LSBFIRST : 0);
+    dev_cfg.pre_cb = (_dc >= 0) ? dcPreCallback : nullptr;
+    dev_cfg.post_cb = asyncPostCallback;
     
     esp_err_t ret = spi_bus_add_device(spi_host_, &dev_cfg, &spi_device_);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to add SPI device: %s", esp_err_to_name(ret));
+        spi_device_ = nullptr;
+    }
+    return ret;
+}
+
+bool Adafruit_SPIDevice::suspend(void) {
+    if (!_begun || spi_device_ == nullptr) {
+        return _suspended;
+    }
+    if (_busAcquired > 0) {
         return false;
     }
-    
-    _begun = true;
+    waitAsync();
+    spi_bus_remove_device(spi_device_);
+    spi_device_ = nullptr;
+    _suspended = true;
     return true;
 }
 
+bool Adafruit_SPIDevice::ready(void) {
+    if (!_begun) {
+        return false;
+    }
+    if (!_suspended) {
+        return spi_device_ != nullptr;
+    }
+    // Under the burst lock: the SD card driver may be bringing the bus back too
+    int64_t start = esp_timer_get_time();
+    _spi->lock();
+    _spi->begin(_spi->getSckPin(), _spi->getMosiPin(), _spi->getMisoPin());
+    esp_err_t ret = _spi->isInitialized() ? addDevice() : ESP_ERR_INVALID_STATE;
+    _spi->unlock();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot bring SPI device on CS %d back: %s", _cs, esp_err_to_name(ret));
+        return false;
+    }
+    _suspended = false;
+    ESP_LOGD(TAG, "SPI device on CS %d back in %lld us", _cs,
+             (long long)(esp_timer_get_time() - start));
+    return true;
+}
+
+bool Adafruit_SPIDevice::setFrequency(uint32_t freq) {
+    if (freq == 0) {
+        return false;
+    }
+    if (!_begun || spi_device_ == nullptr || freq == _freq) {
+        _freq = freq;
+        return true;
+    }
+    
+    // A held bus is handed back for the swap, but the SPIClass burst lock
+    // stays taken, so no other device gets in between
+    waitAsync();
+    bool held = _busAcquired > 0;
+    if (held) {
+        spi_device_release_bus(spi_device_);
+    }
+    spi_bus_remove_device(spi_device_);
+    
+    uint32_t old = _freq;
+    _freq = freq;
+    esp_err_t ret = addDevice();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Cannot clock SPI device at %lu Hz: %s",
+                 (unsigned long)freq, esp_err_to_name(ret));
+        _freq = old;
+        if (addDevice() != ESP_OK) {
+            ESP_LOGE(TAG, "Lost SPI device on CS %d", _cs);
+            _begun = false;
+            return false;
+        }
+    }
+    if (held) {
+        spi_device_acquire_bus(spi_device_, portMAX_DELAY);
+    }
+    return ret == ESP_OK;
+}
+
 uint8_t Adafruit_SPIDevice::transfer(uint8_t send) {
-    if (!_begun || spi_device_ == nullptr) {
+    if (!ready()) {
         return 0;
     }
     
-    spi_transaction_t t = {};
-    t.length = 8;
-    t.tx_buffer = &send;
-    uint8_t rx_data = 0;
-    t.rx_buffer = &rx_data;
-    t.flags = 0;
+    // Synchronous transmits must not overlap with queued transactions
+    if (_inFlight > 0) {
+        waitAsync();
+    }
+    
+    // Single byte: inline tx/rx data and polling transmit, no DMA setup or ISR
+    AsyncSlot slot = {};
+    slot.trans.length = 8;
+    slot.trans.flags = SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA;
+    slot.trans.tx_data[0] = send;
     
-    esp_err_t ret = spi_device_transmit(spi_device_, &t);
+    esp_err_t ret = transmit(slot, 1, true);
     if (ret != ESP_OK) {
         return 0;
     }
     
-    return rx_data;
+    return slot.trans.rx_data[0];
+}
+
+bool Adafruit_SPIDevice::readBidirectional(uint8_t* buffer, size_t len) {
+    if (!ready() || buffer == nullptr || len == 0 ||
+        len > sizeof(spi_transaction_t::rx_data)) {
+        return false;
+    }
+    
+    // The 3-wire mode is fixed when a device is added, so swap the device
+    // as setFrequency() does; the SPIClass burst lock stays taken
+    waitAsync();
+    bool held = _busAcquired > 0;
+    if (held) {
+        spi_device_release_bus(spi_device_);
+    }
+    spi_bus_remove_device(spi_device_);
+    
+    esp_err_t ret = addDevice(SPI_DEVICE_3WIRE | SPI_DEVICE_HALFDUPLEX);
+    if (ret == ESP_OK) {
+        AsyncSlot slot = {};
+        slot.trans.rxlength = len * 8;
+        slot.trans.flags = SPI_TRANS_USE_RXDATA;
+        ret = transmit(slot, len, true);
+        if (ret == ESP_OK) {
+            memcpy(buffer, slot.trans.rx_data, len);
+        }
+        spi_bus_remove_device(spi_device_);
+    }
+    
+    if (addDevice() != ESP_OK) {
+        ESP_LOGE(TAG, "Lost SPI device on CS %d", _cs);
+        _begun = false;
+        return false;
+    }
+    if (held) {
+        spi_device_acquire_bus(spi_device_, portMAX_DELAY);
+    }
+    return ret == ESP_OK;
 }
 
 void Adafruit_SPIDevice::beginTransaction(void) {
-    // ESP-IDF handles transactions automatically via CS pin
-    // This is a no-op, but kept for compatibility
+    // Arduino semantics: the device owns the bus until endTransaction(), so a
+    // command and its data can't be split by another device's transactions
+    acquireBus();
 }
 
 void Adafruit_SPIDevice::endTransaction(void) {
-    // ESP-IDF handles transactions automatically via CS pin
-    // This is a no-op, but kept for compatibility
+    releaseBus();
 }
 
 void Adafruit_SPIDevice::beginTransactionWithAssertingCS() {
@@ -135,21 +283,274 @@ size_t Adafruit_SPIDevice::write(uint8_t data) {
 }
 
 size_t Adafruit_SPIDevice::write(const uint8_t* buffer, size_t len) {
-    if (!_begun || spi_device_ == nullptr) {
+    if (!ready() || buffer == nullptr || len == 0) {
         return 0;
     }
     
-    spi_transaction_t t = {};
-    t.length = len * 8;
-    t.tx_buffer = buffer;
-    t.rx_buffer = nullptr;
-    t.flags = 0;
+    // DMA can't read PSRAM or flash (const command lists), nor unaligned
+    // words; the driver would heap-allocate a bounce copy per transaction
+    if (!esp_ptr_dma_capable(buffer) || (reinterpret_cast<uintptr_t>(buffer) & 3) != 0) {
+        return writeStaged(buffer, len, false);
+    }
+    return writeDirect(buffer, len);
+}
+
+size_t Adafruit_SPIDevice::writeDirect(const uint8_t* buffer, size_t len) {
+    if (_inFlight > 0) {
+        waitAsync();
+    }
     
-    esp_err_t ret = spi_device_transmit(spi_device_, &t);
-    if (ret != ESP_OK) {
+    // Short command/data bursts: per-transaction overhead dominates, so poll
+    if (len <= POLLING_MAX_BYTES) {
+        AsyncSlot slot = {};
+        slot.trans.length = len * 8;
+        slot.trans.tx_buffer = buffer;
+        esp_err_t ret = transmit(slot, len, true);
+        return (ret == ESP_OK) ? len : 0;
+    }
+    
+    // One transaction per max_transfer_sz chunk instead of one per byte
+    size_t sent = 0;
+    while (sent < len) {
+        size_t chunk = std::min(len - sent, _maxTransfer);
+        
+        AsyncSlot slot = {};
+        slot.trans.length = chunk * 8;
+        slot.trans.tx_buffer = buffer + sent;
+        
+        esp_err_t ret = transmit(slot, chunk, false);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Bulk write failed after %u bytes: %s",
+                     (unsigned)sent, esp_err_to_name(ret));
+            return sent;
+        }
+        sent += chunk;
+    }
+    
+    return sent;
+}
+
+size_t Adafruit_SPIDevice::writeInverted(const uint8_t* buffer, size_t len) {
+    if (!ready() || buffer == nullptr) {
         return 0;
     }
+    return writeStaged(buffer, len, true);
+}
+
+size_t Adafruit_SPIDevice::writeStaged(const uint8_t* buffer, size_t len, bool invert) {
+    // Copy into a word-aligned scratch chunk so the driver can DMA it directly
+    WORD_ALIGNED_ATTR uint8_t scratch[STAGING_CHUNK_SIZE];
+    const size_t chunkMax = std::min(sizeof(scratch), _maxTransfer);
+    
+    size_t sent = 0;
+    while (sent < len) {
+        size_t chunk = std::min(len - sent, chunkMax);
+        if (invert) {
+            for (size_t i = 0; i < chunk; i++) {
+                scratch[i] = ~buffer[sent + i];
+            }
+        } else {
+            memcpy(scratch, buffer + sent, chunk);
+        }
+        if (writeDirect(scratch, chunk) != chunk) {
+            return sent;
+        }
+        sent += chunk;
+    }
+    
+    return sent;
+}
+
+bool Adafruit_SPIDevice::transfer(uint8_t* buffer, size_t len) {
+    if (!ready() || buffer == nullptr) {
+        return false;
+    }
     
-    return len;
+    if (_inFlight > 0) {
+        waitAsync();
+    }
+    
+    // Full duplex in place: each byte sent is replaced by the byte received
+    size_t done = 0;
+    while (done < len) {
+        size_t chunk = std::min(len - done, _maxTransfer);
+        
+        AsyncSlot slot = {};
+        slot.trans.length = chunk * 8;
+        slot.trans.tx_buffer = buffer + done;
+        slot.trans.rx_buffer = buffer + done;
+        
+        esp_err_t ret = transmit(slot, chunk, chunk <= POLLING_MAX_BYTES);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Bulk transfer failed after %u bytes: %s",
+                     (unsigned)done, esp_err_to_name(ret));
+            return false;
+        }
+        done += chunk;
+    }
+    
+    return true;
+}
+
+void IRAM_ATTR Adafruit_SPIDevice::dcPreCallback(spi_transaction_t *t) {
+    // Register write rather than gpio_set_level(): this runs from the
+    // driver's ISR, which may fire while the flash cache is off
+    AsyncSlot *slot = static_cast<AsyncSlot *>(t->user);
+    if (slot != nullptr && slot->dc_pin >= 0) {
+        gpio_ll_set_level(&GPIO, static_cast<gpio_num_t>(slot->dc_pin), slot->dc_level);
+    }
+}
+
+void IRAM_ATTR Adafruit_SPIDevice::asyncPostCallback(spi_transaction_t *t) {
+    // Synchronous transactions leave cb == nullptr
+    AsyncSlot *slot = static_cast<AsyncSlot *>(t->user);
+    if (slot != nullptr && slot->cb != nullptr) {
+        slot->cb(slot->cb_arg);
+    }
+}
+
+void Adafruit_SPIDevice::prepare(AsyncSlot &slot) {
+    slot.trans.user = &slot;
+    slot.dc_pin = _dc;
+    slot.dc_level = _dcLevel;
+}
+
+esp_err_t Adafruit_SPIDevice::transmit(AsyncSlot &slot, size_t len, bool polling) {
+    prepare(slot);
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = polling ? spi_device_polling_transmit(spi_device_, &slot.trans)
+                            : spi_device_transmit(spi_device_, &slot.trans);
+    int64_t end = esp_timer_get_time();
+    _stats.add(len, end - start);
+    if (_tap != nullptr && ret == ESP_OK) {
+        tapSlot(slot, len, start, end, false);
+    }
+    return ret;
 }
 
+void Adafruit_SPIDevice::tapSlot(const AsyncSlot &slot, size_t len, int64_t start,
+                                 int64_t end, bool queued) {
+    BusIOTapEvent event;
+    if (slot.trans.flags & SPI_TRANS_USE_TXDATA) {
+        event.data = slot.trans.tx_data;
+    } else {
+        event.data = static_cast<const uint8_t *>(slot.trans.tx_buffer);
+    }
+    event.len = len;
+    event.freq = _freq;
+    event.start_us = start;
+    event.end_us = end;
+    event.dc_level = slot.dc_level;
+    event.queued = queued;
+    _tap(_tapArg, event);
+}
+
+bool Adafruit_SPIDevice::collectAsync(TickType_t timeout) {
+    spi_transaction_t *done = nullptr;
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = spi_device_get_trans_result(spi_device_, &done, timeout);
+    _stats.busy_us += esp_timer_get_time() - start;
+    if (ret != ESP_OK) {
+        return false;
+    }
+    _inFlight--;
+    return true;
+}
+
+bool Adafruit_SPIDevice::writeAsync(const uint8_t* buffer, size_t len,
+                                    BusIOAsyncCallback cb, void *cb_arg) {
+    if (!ready() || buffer == nullptr || len == 0) {
+        return false;
+    }
+    
+    size_t queued = 0;
+    while (queued < len) {
+        // Free a slot by collecting the oldest result if the queue is full
+        if (_inFlight == ASYNC_QUEUE_DEPTH && !collectAsync(portMAX_DELAY)) {
+            return false;
+        }
+        
+        size_t chunk = std::min(len - queued, _maxTransfer);
+        bool last = (queued + chunk) == len;
+        
+        AsyncSlot &slot = _slots[_slotHead];
+        slot.trans = {};
+        slot.trans.length = chunk * 8;
+        if (chunk <= sizeof(slot.trans.tx_data)) {
+            // Short writes (commands, register arguments) ride in the slot
+            // itself: no DMA descriptor, and buffer may live anywhere
+            slot.trans.flags = SPI_TRANS_USE_TXDATA;
+            memcpy(slot.trans.tx_data, buffer + queued, chunk);
+        } else {
+            slot.trans.tx_buffer = buffer + queued;
+        }
+        slot.cb = last ? cb : nullptr;
+        slot.cb_arg = last ? cb_arg : nullptr;
+        prepare(slot);
+        
+        int64_t start = esp_timer_get_time();
+        esp_err_t ret = spi_device_queue_trans(spi_device_, &slot.trans, portMAX_DELAY);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to queue SPI transaction: %s", esp_err_to_name(ret));
+            return false;
+        }
+        _slotHead = (_slotHead + 1) % ASYNC_QUEUE_DEPTH;
+        _inFlight++;
+        int64_t end = esp_timer_get_time();
+        _stats.add(chunk, end - start, static_cast<uint8_t>(_inFlight));
+        if (_tap != nullptr) {
+            tapSlot(slot, chunk, start, end, true);
+        }
+        queued += chunk;
+    }
+    
+    return true;
+}
+
+bool Adafruit_SPIDevice::waitAsync(TickType_t timeout) {
+    while (_inFlight > 0) {
+        if (!collectAsync(timeout)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Adafruit_SPIDevice::acquireBus(TickType_t timeout) {
+    if (!ready()) {
+        return false;
+    }
+    if (_busAcquired == 0) {
+        // Burst lock first, so a burst another device holds finishes first
+        if (_spi != nullptr && !_spi->lock(timeout)) {
+            ESP_LOGW(TAG, "Timed out waiting for SPI bus burst lock");
+            return false;
+        }
+        esp_err_t ret = spi_device_acquire_bus(spi_device_, timeout);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to acquire SPI bus: %s", esp_err_to_name(ret));
+            if (_spi != nullptr) {
+                _spi->unlock();
+            }
+            return false;
+        }
+    }
+    _busAcquired++;
+    return true;
+}
+
+void Adafruit_SPIDevice::releaseBus(void) {
+    if (_busAcquired == 0) {
+        return;
+    }
+    if (--_busAcquired == 0) {
+        // Queued transactions must finish before the bus is handed over
+        waitAsync();
+        if (spi_device_ != nullptr) {
+            spi_device_release_bus(spi_device_);
+        }
+        if (_spi != nullptr) {
+            _spi->unlock();
+        }
+    }
+}
@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include <SPI.h>
+#include "esp_attr.h"
 
 // Bit order enum matching Adafruit library
 typedef enum {
@@ -10,6 +11,27 @@ typedef enum {
     SPI_BITORDER_LSBFIRST = LSBFIRST,
 } BusIOBitOrder;
 
+// Completion callback for queued (asynchronous) writes.
+// Runs from the SPI driver's post-transaction ISR: keep it short and IRAM-safe
+// (e.g. give a semaphore or notify a task).
+typedef void (*BusIOAsyncCallback)(void *arg);
+
+// One transaction as a tap (Adafruit_SPIDevice::setTap()) sees it
+struct BusIOTapEvent {
+    const uint8_t* data;  // Bytes sent, nullptr for a read
+    size_t len;
+    uint32_t freq;        // Clock it runs at
+    int64_t start_us;     // Issued
+    int64_t end_us;       // Finished; for a queued write, when it was queued
+    uint8_t dc_level;     // setDC() level (1 = data)
+    bool queued;          // writeAsync()
+};
+
+// Transaction tap, called from the issuing task as each transaction is
+// transmitted or queued (after it for a blocking one). Meant for recording
+// the traffic: keep it short, it delays the next transaction
+typedef void (*BusIOTapCallback)(void *arg, const BusIOTapEvent &event);
+
 // The class which defines how we will talk to this device over SPI
 class Adafruit_SPIDevice {
 public:
@@ -28,15 +50,114 @@ public:
     ~Adafruit_SPIDevice();
 
     bool begin(void);
+
+    // Change the clock. The driver fixes a device's clock when it is added,
+    // so after begin() the device is re-added at the new rate: queued writes
+    // finish first and a bus held with acquireBus() stays held. Meant for a
+    // few switches per frame (command vs bulk data rate), not per transfer.
+    // Returns false if the rate can't be set; the old one is kept then
+    bool setFrequency(uint32_t freq);
+    uint32_t getFrequency(void) const { return _freq; }
+
+    // Let the driver drive the display's data/command pin: each transaction
+    // carries the level set with setDC() when it was issued, and a pre-
+    // transaction callback applies it, so commands and data can be queued
+    // back to back. Call before begin(); -1 leaves DC to the caller
+    void setDataCommandPin(int8_t dc) { _dc = dc; }
+    bool hasDataCommandPin(void) const { return _dc >= 0; }
+    // DC level for the transactions issued from now on (1 = data)
+    void setDC(bool data) { _dcLevel = data ? 1 : 0; }
+
     uint8_t transfer(uint8_t send);
+    // Read up to 4 bytes on MOSI, from a device with one bidirectional data
+    // line (3-wire SPI, e.g. a display controller's status registers). The
+    // device is re-added in half-duplex 3-wire mode for the read and back
+    // afterwards, like setFrequency(): meant for rare reads, not streams
+    bool readBidirectional(uint8_t* buffer, size_t len);
+    // Full-duplex bulk transfer in place: buffer is sent and overwritten with
+    // what was read. For DMA, buffer should be word aligned
+    bool transfer(uint8_t* buffer, size_t len);
     void beginTransaction(void);
     void endTransaction(void);
     void beginTransactionWithAssertingCS();
     void endTransactionWithDeassertingCS();
     size_t write(uint8_t data);
+    // Bulk write, split into as few transactions as the bus max_transfer_sz allows.
+    // Buffers DMA can't read (PSRAM, flash, unaligned) are staged through the stack
     size_t write(const uint8_t* buffer, size_t len);
+    // Bulk write of the bitwise complement of buffer (for inverted framebuffers)
+    size_t writeInverted(const uint8_t* buffer, size_t len);
+
+    // Queued, non-blocking write. buffer must stay valid and unmodified until the
+    // callback fires or waitAsync() returns. Writes larger than max_transfer_sz are
+    // split across several queue slots; the callback fires once, after the last one.
+    // Blocks only when all ASYNC_QUEUE_DEPTH slots are in flight. Writes of up
+    // to 4 bytes are copied into the transaction, so buffer is free on return
+    // and needn't be DMA capable.
+    bool writeAsync(const uint8_t* buffer, size_t len,
+                    BusIOAsyncCallback cb = nullptr, void *cb_arg = nullptr);
+    // Wait until every queued write has completed
+    bool waitAsync(TickType_t timeout = portMAX_DELAY);
+    // Number of queued transactions not yet collected
+    size_t pendingAsync(void) const { return _inFlight; }
+
+    static constexpr size_t ASYNC_QUEUE_DEPTH = 4;  ///< Driver queue depth / slot count
+
+    // Hold the bus across a burst of short transactions (e.g. an init command
+    // list) so each one skips bus arbitration. Calls nest; other devices on the
+    // bus wait until the matching releaseBus(). Also takes the SPIClass burst
+    // lock. beginTransaction()/endTransaction() do the same.
+    bool acquireBus(TickType_t timeout = portMAX_DELAY);
+    void releaseBus(void);
+
+    // Take the device off the bus, so SPIClass::end() can free it for an
+    // idle stretch. Queued writes finish first; false while acquireBus()
+    // holds the bus. The next transfer, write or acquireBus() brings the
+    // bus (SPIClass::begin() with its old pins) and the device back
+    bool suspend(void);
+    bool isSuspended(void) const { return _suspended; }
+
+    // Writes up to this size use polling transmit instead of the ISR/DMA path
+    static constexpr size_t POLLING_MAX_BYTES = 32;
+
+    // Transactions, bytes, blocked time and queue peak since the last reset.
+    // A write that falls back to one transaction per byte shows up here as
+    // transactions ~= bytes
+    const BusIOStats& getStats(void) const { return _stats; }
+    void resetStats(void) { _stats = {}; }
+
+    // Watch every transaction of this device, nullptr to stop. Set while
+    // nothing is queued
+    void setTap(BusIOTapCallback tap, void *arg) { _tap = tap; _tapArg = arg; }
 
 private:
+    // One transaction, queued or blocking; trans must stay first so the
+    // callbacks can map it back
+    struct AsyncSlot {
+        spi_transaction_t trans;
+        BusIOAsyncCallback cb;
+        void *cb_arg;
+        int8_t dc_pin;    // -1 if the caller drives DC
+        uint8_t dc_level; // DC level while this transaction is clocked
+    };
+    static void IRAM_ATTR dcPreCallback(spi_transaction_t *t);
+    static void IRAM_ATTR asyncPostCallback(spi_transaction_t *t);
+    bool collectAsync(TickType_t timeout);
+    // spi_bus_add_device() at _freq, with extra SPI_DEVICE_* flags
+    esp_err_t addDevice(uint32_t flags = 0);
+    // Whether the device can transfer, back on the bus after a suspend()
+    bool ready(void);
+    // Point slot.trans.user at slot and stamp the current DC level on it
+    void prepare(AsyncSlot &slot);
+    // Hand a transmitted or queued slot to the tap
+    void tapSlot(const AsyncSlot &slot, size_t len, int64_t start, int64_t end, bool queued);
+    // Blocking transmit of one transaction, counted in _stats
+    esp_err_t transmit(AsyncSlot &slot, size_t len, bool polling);
+    // write() of a DMA-capable, word-aligned buffer
+    size_t writeDirect(const uint8_t* buffer, size_t len);
+    // write() through a stack chunk, complementing each byte if invert
+    size_t writeStaged(const uint8_t* buffer, size_t len, bool invert);
+
     SPIClass *_spi;
     uint32_t _freq;
     BusIOBitOrder _dataOrder;
@@ -44,7 +165,18 @@ private:
     void setChipSelect(int value);
 
     int8_t _cs, _sck, _mosi, _miso;
+    int8_t _dc;           // setDataCommandPin(), -1 if unused
+    uint8_t _dcLevel;     // setDC()
     bool _begun;
+    bool _suspended;      // suspend(): off the bus until the next transfer
+    size_t _maxTransfer;  // Max bytes per transaction, from SPIClass bus config
+    AsyncSlot _slots[ASYNC_QUEUE_DEPTH];
+    size_t _slotHead;     // Next slot to fill
+    size_t _inFlight;     // Slots queued but not yet collected
+    uint8_t _busAcquired; // acquireBus() nesting depth
+    BusIOStats _stats;
+    BusIOTapCallback _tap;  // setTap()
+    void *_tapArg;
     spi_device_handle_t spi_device_;
     spi_host_device_t spi_host_;
 };
@@ -7,6 +7,8 @@
 #include "Arduino.h"
 #include "driver/spi_master.h"
 #include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 // SPI modes
 #define SPI_MODE0 0
@@ -29,6 +31,36 @@ struct SPISettings {
         : clock(clockFreq), bitOrder(bitOrder), dataMode(dataMode) {}
 };
 
+// Traffic counters kept by SPIClass and Adafruit_SPIDevice (getStats()).
+// Updated without locking by whichever task transmits: reset and read them
+// while the device is idle, e.g. once per frame.
+struct BusIOStats {
+    uint32_t transactions;  // Driver transactions, each chunk of a split write counts
+    uint32_t bytes;         // Bytes clocked (a full-duplex byte counts once)
+    int64_t busy_us;        // Time callers spent blocked in transmits and result waits
+    uint8_t queue_peak;     // Most transactions in flight at once
+
+    // Count one transaction of len bytes that blocked the caller for us
+    void add(size_t len, int64_t us, uint8_t depth = 1) {
+        transactions++;
+        bytes += len;
+        busy_us += us;
+        if (depth > queue_peak) {
+            queue_peak = depth;
+        }
+    }
+
+    // Fold another device's counters in (peaks don't add)
+    void merge(const BusIOStats& other) {
+        transactions += other.transactions;
+        bytes += other.bytes;
+        busy_us += other.busy_us;
+        if (other.queue_peak > queue_peak) {
+            queue_peak = other.queue_peak;
+        }
+    }
+};
+
 // SPI class implementation using ESP-IDF SPI driver
 class SPIClass {
 private:
@@ -40,11 +72,36 @@ private:
     gpio_num_t miso_pin_;
     SPISettings current_settings_;
     spi_host_device_t spi_host_;
+    size_t max_transfer_sz_;
+    SemaphoreHandle_t bus_lock_;  // Burst lock shared by every device on the bus
+    BusIOStats stats_;            // transfer() traffic through spi_device_
+    
+    // The device transfer() uses, on cs_pin_
+    esp_err_t addOwnDevice() {
+        spi_device_interface_config_t dev_cfg = {};
+        dev_cfg.clock_speed_hz = current_settings_.clock;
+        dev_cfg.mode = current_settings_.dataMode;
+        dev_cfg.spics_io_num = cs_pin_;
+        dev_cfg.queue_size = 1;
+        dev_cfg.flags = (current_settings_.bitOrder == LSBFIRST) ? SPI_DEVICE_BIT_LSBFIRST : 0;
+        dev_cfg.pre_cb = nullptr;
+        
+        esp_err_t ret = spi_bus_add_device(spi_host_, &dev_cfg, &spi_device_);
+        if (ret != ESP_OK) {
+            spi_device_ = nullptr;
+        }
+        return ret;
+    }
     
 public:
+    // Conservative per-transaction limit used when another component (e.g. the
+    // SD card driver) initialized the bus and its max_transfer_sz is unknown
+    static constexpr size_t DEFAULT_MAX_TRANSFER_SZ = 4000;
+
     SPIClass() : initialized_(false), cs_pin_(GPIO_NUM_NC), 
                  sck_pin_(GPIO_NUM_NC), mosi_pin_(GPIO_NUM_NC), miso_pin_(GPIO_NUM_NC),
-                 spi_host_(SPI2_HOST) {}
+                 spi_host_(SPI2_HOST), max_transfer_sz_(DEFAULT_MAX_TRANSFER_SZ),
+                 bus_lock_(nullptr), stats_{} {}
     
     // Default begin() for compatibility with Adafruit libraries
     // Uses default SPI pins (VSPI on ESP32: SCK=18, MOSI=23, MISO=19)
@@ -61,7 +118,15 @@ public:
     }
     
     // begin() with pins - preferred method for explicit configuration
+    // Owners of other devices on the bus (e.g. the SD card) may call this
+    // again; only the first call sets the bus up.
     void begin(gpio_num_t sck, gpio_num_t mosi, gpio_num_t miso, gpio_num_t cs = GPIO_NUM_NC) {
+        if (initialized_) {
+            return;
+        }
+        if (bus_lock_ == nullptr) {
+            bus_lock_ = xSemaphoreCreateRecursiveMutex();
+        }
         sck_pin_ = sck;
         mosi_pin_ = mosi;
         miso_pin_ = miso;
@@ -83,20 +148,13 @@ public:
             return;
         }
         // If ESP_ERR_INVALID_STATE, bus was already initialized - that's OK, we can use it
+        // (keep the conservative default transfer limit, we don't know its config)
+        if (ret == ESP_OK) {
+            max_transfer_sz_ = bus_cfg.max_transfer_sz;
+        }
         
-        if (cs_pin_ != GPIO_NUM_NC) {
-            spi_device_interface_config_t dev_cfg = {};
-            dev_cfg.clock_speed_hz = current_settings_.clock;
-            dev_cfg.mode = current_settings_.dataMode;
-            dev_cfg.spics_io_num = cs_pin_;
-            dev_cfg.queue_size = 1;
-            dev_cfg.flags = (current_settings_.bitOrder == LSBFIRST) ? SPI_DEVICE_BIT_LSBFIRST : 0;
-            dev_cfg.pre_cb = nullptr;
-            
-            ret = spi_bus_add_device(spi_host_, &dev_cfg, &spi_device_);
-            if (ret != ESP_OK) {
-                return;
-            }
+        if (cs_pin_ != GPIO_NUM_NC && addOwnDevice() != ESP_OK) {
+            return;
         }
         
         initialized_ = true;
@@ -108,6 +166,27 @@ public:
     gpio_num_t getMisoPin() const { return miso_pin_; }
     spi_host_device_t getHost() const { return spi_host_; }
     bool isInitialized() const { return initialized_; }
+    // Largest single transaction (bytes) the bus DMA descriptors can carry
+    size_t getMaxTransferSize() const { return max_transfer_sz_; }
+    
+    // Hold the bus for a burst of transactions, so another device's burst
+    // (an SD multi-sector read vs. a display plane push) can't interleave
+    // with it transaction by transaction. Recursive, per task; lock before
+    // spi_device_acquire_bus(), never after, or two bursts can deadlock.
+    bool lock(TickType_t timeout = portMAX_DELAY) {
+        return bus_lock_ == nullptr || xSemaphoreTakeRecursive(bus_lock_, timeout) == pdTRUE;
+    }
+
+    void unlock() {
+        if (bus_lock_ != nullptr) {
+            xSemaphoreGiveRecursive(bus_lock_);
+        }
+    }
+    
+    // Traffic of this class's own transfer() calls (e.g. MCPSRAM), not of
+    // the Adafruit_SPIDevices or other drivers sharing the bus
+    const BusIOStats& getStats() const { return stats_; }
+    void resetStats() { stats_ = {}; }
     
     // Set SPI host (for advanced use cases)
     void setHost(spi_host_device_t host) { spi_host_ = host; }
@@ -136,7 +215,9 @@ public:
         // Note: SPI mode (CPOL/CPHA) is set in device config, not per transaction
         // Bit order is also set in device config via SPI_DEVICE_BIT_LSBFIRST flag
         
+        int64_t start = esp_timer_get_time();
         esp_err_t ret = spi_device_transmit(spi_device_, &t);
+        stats_.add(1, esp_timer_get_time() - start);
         if (ret != ESP_OK) {
             return 0;
         }
@@ -155,15 +236,30 @@ public:
         t.rx_buffer = buffer;
         t.flags = 0;
         
+        int64_t start = esp_timer_get_time();
         spi_device_transmit(spi_device_, &t);
+        stats_.add(len, esp_timer_get_time() - start);
     }
     
-    void end() {
-        if (initialized_ && cs_pin_ != GPIO_NUM_NC && spi_device_ != nullptr) {
+    // Free the bus, which also gates its peripheral clock and DMA channel;
+    // begin() sets it up again. Every Adafruit_SPIDevice (suspend()) and
+    // other driver has to be off it first: false, with the bus kept, if not
+    bool end() {
+        if (!initialized_) {
+            return true;
+        }
+        if (spi_device_ != nullptr) {
             spi_bus_remove_device(spi_device_);
-            spi_bus_free(spi_host_);
-            initialized_ = false;
+            spi_device_ = nullptr;
+        }
+        if (spi_bus_free(spi_host_) != ESP_OK) {
+            if (cs_pin_ != GPIO_NUM_NC) {
+                addOwnDevice();
+            }
+            return false;
         }
+        initialized_ = false;
+        return true;
     }
     
     // Compatibility methods for MCPSRAM
@@ -216,7 +312,8 @@ public:
     
     void setFrequency(uint32_t freq) {
         current_settings_.clock = freq;
-        // Would need to reconfigure device to apply, but for now just store
+        // The bus has no clock of its own; each device sets its rate, see
+        // Adafruit_SPIDevice::setFrequency()
     }
 };
 
@@ -34,10 +34,51 @@
  */
 
 #include "Adafruit_EPD.h"
+#include "EPDRecorder.h"
 
 #include <stdlib.h>
 
-bool Adafruit_EPD::_isInTransaction = false;
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+
+static const char* TAG_EPD = "Adafruit_EPD";
+
+// Source of uniform plane uploads: DMA reads it in place, no staging.
+// Refilled only when the fill byte changes. Shared by every panel, so it is
+// refilled and sent under fillLock(): panels uploading from their own
+// refresh tasks must not change it under each other's DMA
+static DMA_ATTR WORD_ALIGNED_ATTR uint8_t s_fill_chunk[EPD_FILL_CHUNK_SIZE];
+static int s_fill_value = -1;
+
+static SemaphoreHandle_t fillLock(void) {
+  static StaticSemaphore_t storage;
+  static SemaphoreHandle_t lock = xSemaphoreCreateMutexStatic(&storage);
+  return lock;
+}
+
+/**************************************************************************/
+/*!
+    @brief Check whether every byte of a plane is the same, e.g. the red
+    plane of a slide without red. Stops at the first differing byte, so a
+    busy plane costs next to nothing
+    @param buffer the plane
+    @param size bytes in the plane
+    @param value set to the byte the plane is filled with
+    @returns true if the plane is uniform
+*/
+/**************************************************************************/
+static bool uniformPlane(const uint8_t* buffer, uint32_t size, uint8_t& value) {
+  if (size == 0) {
+    return false;
+  }
+  value = buffer[0];
+  return memcmp(buffer, buffer + 1, size - 1) == 0;
+}
+
+epd_memory_t Adafruit_EPD::_framebuffer_memory = EPD_MEMORY_INTERNAL;
 
 /**************************************************************************/
 /*!
@@ -70,12 +111,13 @@ Adafruit_EPD::Adafruit_EPD(int width, int height, int16_t spi_mosi,
   }
 
   spi_dev = new Adafruit_SPIDevice(CS, spi_clock, spi_miso, spi_mosi,
-                                   4000000,               // frequency
+                                   EPD_SPI_DEFAULT_HZ,    // frequency
                                    SPI_BITORDER_MSBFIRST, // bit order
                                    SPI_MODE0              // data mode
   );
 
   singleByteTxns = false;
+  spanWrites = true;
   buffer1_size = buffer2_size = 0;
   buffer1_addr = buffer2_addr = 0;
   colorbuffer_addr = blackbuffer_addr = 0;
@@ -111,12 +153,13 @@ Adafruit_EPD::Adafruit_EPD(int width, int height, int16_t DC, int16_t RST,
   }
 
   spi_dev = new Adafruit_SPIDevice(CS,
-                                   4000000,               // frequency
+                                   EPD_SPI_DEFAULT_HZ,    // frequency
                                    SPI_BITORDER_MSBFIRST, // bit order
                                    SPI_MODE0,             // data mode
                                    spi);
 
   singleByteTxns = false;
+  spanWrites = true;
   buffer1_size = buffer2_size = 0;
   buffer1_addr = buffer2_addr = 0;
   colorbuffer_addr = blackbuffer_addr = 0;
@@ -129,13 +172,43 @@ Adafruit_EPD::Adafruit_EPD(int width, int height, int16_t DC, int16_t RST,
 */
 /**************************************************************************/
 Adafruit_EPD::~Adafruit_EPD() {
-  if (buffer1 != NULL) {
-    free(buffer1);
-    buffer1 = NULL;
+  if (_refresh_task != NULL) {
+    waitRefresh();
+    vTaskDelete(_refresh_task);
+    _refresh_task = NULL;
+  }
+  if (_refresh_events != NULL) {
+    vEventGroupDelete(_refresh_events);
+    _refresh_events = NULL;
+  }
+  if (_busy_isr_installed) {
+    gpio_isr_handler_remove((gpio_num_t)_busy_pin);
+    _busy_isr_installed = false;
+  }
+  if (_busy_sem != NULL) {
+    vSemaphoreDelete(_busy_sem);
+    _busy_sem = NULL;
+  }
+  if (_panel_io != NULL) {
+    esp_lcd_panel_io_del(_panel_io);
+    _panel_io = NULL;
+  }
+  if (_io_done != NULL) {
+    vSemaphoreDelete(_io_done);
+    _io_done = NULL;
+  }
+  if (_own_buffers) {
+    if (buffer2 != buffer1) {
+      freeFramebuffer(buffer2);
+    }
+    freeFramebuffer(buffer1);
+  }
+  buffer1 = buffer2 = NULL;
+  for (uint8_t i = 0; i < EPD_GLYPH_CACHE_SIZE; i++) {
+    delete _glyph_cache[i].raster;
   }
-  if (buffer2 != NULL) {
-    free(buffer2);
-    buffer2 = NULL;
+  for (uint8_t i = 0; i < EPD_COMMAND_CHAINS; i++) {
+    heap_caps_free(_cmd_chains[i].args);
   }
 }
 
@@ -162,9 +235,12 @@ void Adafruit_EPD::begin(bool reset) {
   }
 
   // Serial.println("set pins");
-  // set pin directions
+  // set pin directions; a panel IO has CS routed to the SPI peripheral
+  // already, which pinMode() would undo
   pinMode(_dc_pin, OUTPUT);
-  pinMode(_cs_pin, OUTPUT);
+  if (_panel_io == NULL) {
+    pinMode(_cs_pin, OUTPUT);
+  }
 
 #if defined(BUSIO_USE_FAST_PINIO)
   csPort = (BusIO_PortReg*)portOutputRegister(digitalPinToPort(_cs_pin));
@@ -175,8 +251,20 @@ void Adafruit_EPD::begin(bool reset) {
 
   csHigh();
 
-  if (!spi_dev->begin()) {
-    return;
+  // Without SRAM the SPI driver owns CS (spics_io_num) and sets DC from each
+  // transaction's flag, so commands and data go out back to back with no
+  // GPIO calls in between. The SRAM pass-through needs both pins by hand.
+  // A panel IO drives both itself, and spi_dev never joins the bus
+  if (_panel_io != NULL) {
+    _driver_pins = true;
+  } else {
+    if (!use_sram) {
+      spi_dev->setDataCommandPin(_dc_pin);
+    }
+    if (!spi_dev->begin()) {
+      return;
+    }
+    _driver_pins = !use_sram;
   }
 
   // Serial.println("hard reset");
@@ -187,16 +275,130 @@ void Adafruit_EPD::begin(bool reset) {
   // Serial.println("busy");
   if (_busy_pin >= 0) {
     pinMode(_busy_pin, INPUT);
+
+    // edge ISR on BUSY so busy_wait() sleeps until the panel is done instead
+    // of polling; the ISR service may already be installed by someone else
+    if (_busy_sem == NULL) {
+      _busy_sem = xSemaphoreCreateBinary();
+    }
+    if (_busy_sem != NULL && !_busy_isr_installed) {
+      esp_err_t err = gpio_install_isr_service(0);
+      if (err == ESP_OK || err == ESP_ERR_INVALID_STATE) {
+        gpio_set_intr_type((gpio_num_t)_busy_pin, GPIO_INTR_DISABLE);
+        _busy_isr_installed =
+            gpio_isr_handler_add((gpio_num_t)_busy_pin, busyPinISR, this) ==
+            ESP_OK;
+      }
+    }
   }
   // Serial.println("done!");
 }
 
+/**************************************************************************/
+/*!
+    @brief BUSY pin edge interrupt, wakes the task blocked in busyWaitPin()
+    @param arg the Adafruit_EPD instance
+*/
+/**************************************************************************/
+void IRAM_ATTR Adafruit_EPD::busyPinISR(void* arg) {
+  Adafruit_EPD* epd = (Adafruit_EPD*)arg;
+  BaseType_t hpw = pdFALSE;
+  xSemaphoreGiveFromISR(epd->_busy_sem, &hpw);
+  if (hpw == pdTRUE) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Block until the BUSY pin reads idle_level. The calling task sleeps
+    on a semaphore given by the BUSY edge ISR, so it wakes as soon as the panel
+    finishes rather than on the next poll tick. Falls back to delay() polling if
+    the ISR could not be attached.
+    @param idle_level the pin level that means "not busy"
+    @param status_cmd if >= 0, a status command re-sent every poll_ms, for
+    controllers that only update BUSY after being queried
+    @param poll_ms poll interval when status_cmd is used or there is no ISR
+    @returns true if the panel went idle, false on busy_timeout_ms timeout
+*/
+/**************************************************************************/
+bool Adafruit_EPD::busyWaitPin(bool idle_level, int16_t status_cmd,
+                               uint32_t poll_ms) {
+  if (_busy_pin < 0) {
+    return true;
+  }
+
+  if (_busy_isr_installed) {
+    xSemaphoreTake(_busy_sem, 0); // drop any stale edge
+    gpio_set_intr_type((gpio_num_t)_busy_pin, GPIO_INTR_ANYEDGE);
+    gpio_intr_enable((gpio_num_t)_busy_pin);
+  }
+
+  bool idle = false;
+  int64_t start_us = _recorder != NULL ? esp_timer_get_time() : 0;
+  uint32_t start = millis();
+  while (true) {
+    if (status_cmd >= 0) {
+      EPD_command((uint8_t)status_cmd);
+    }
+    // checked after arming the ISR so an edge between the two is not lost
+    if ((digitalRead(_busy_pin) != 0) == idle_level) {
+      idle = true;
+      break;
+    }
+    uint32_t elapsed = millis() - start;
+    if (elapsed >= busy_timeout_ms) {
+      break;
+    }
+    uint32_t wait_ms = busy_timeout_ms - elapsed;
+    if (status_cmd >= 0 || !_busy_isr_installed) {
+      wait_ms = min(wait_ms, poll_ms);
+    }
+    if (_busy_isr_installed) {
+      xSemaphoreTake(_busy_sem, pdMS_TO_TICKS(wait_ms) + 1);
+    } else {
+      delay(wait_ms);
+    }
+  }
+
+  if (_busy_isr_installed) {
+    gpio_intr_disable((gpio_num_t)_busy_pin);
+    gpio_set_intr_type((gpio_num_t)_busy_pin, GPIO_INTR_DISABLE);
+  }
+
+  if (_recorder != NULL) {
+    _recorder->busy(start_us, esp_timer_get_time(), idle);
+  }
+  if (!idle) {
+    ESP_LOGW(TAG_EPD, "BUSY pin still active after %u ms",
+             (unsigned)busy_timeout_ms);
+  }
+  return idle;
+}
+
+/**************************************************************************/
+/*!
+    @brief Record the panel's SPI transactions and BUSY waits into an
+    EPDRecorder, which records while started. Transfers through a panel IO
+    (usePanelIO()) bypass the SPI device and aren't recorded. Set while no
+    upload or refresh runs
+    @param recorder the recorder, begun, or NULL to stop
+*/
+/**************************************************************************/
+void Adafruit_EPD::setRecorder(EPDRecorder* recorder) {
+  _recorder = recorder;
+  if (spi_dev) {
+    spi_dev->setTap(recorder != NULL ? EPDRecorder::tap : NULL, recorder);
+  }
+}
+
 /**************************************************************************/
 /*!
     @brief reset Perform a hardware reset
 */
 /**************************************************************************/
 void Adafruit_EPD::hardwareReset(void) {
+  _staged_valid = false;
   if (_reset_pin >= 0) {
     // Setup reset pin direction
     pinMode(_reset_pin, OUTPUT);
@@ -224,6 +426,7 @@ void Adafruit_EPD::hardwareReset(void) {
 void Adafruit_EPD::drawPixel(int16_t x, int16_t y, uint16_t color) {
   if ((x < 0) || (x >= width()) || (y < 0) || (y >= height()))
     return;
+  markDirty(x, y, 1, 1);
 
   uint8_t *black_pBuf, *color_pBuf;
   // Serial.printf("(%d, %d) -> ", x, y);
@@ -257,170 +460,3040 @@ void Adafruit_EPD::drawPixel(int16_t x, int16_t y, uint16_t color) {
   } else { //  THINKINK_STANDARD default!
     addr = ((uint32_t)(WIDTH - 1 - x) * (uint32_t)_HEIGHT + y) / 8;
   }
-  uint8_t black_c, color_c;
   // Serial.printf("0x%0x\n\r",addr);
 
+  if (_band_lines != 0) {
+    // banded: only the lines of the current band are in memory
+    uint32_t start = (uint32_t)_band_first * _band_line_bytes;
+    if (addr < start || addr >= start + buffer1_size) {
+      return;
+    }
+    addr -= start;
+  }
+
   if (use_sram) {
-    black_c = sram.read8(blackbuffer_addr + addr);
-    black_pBuf = &black_c;
-    color_c = sram.read8(colorbuffer_addr + addr);
-    color_pBuf = &color_c;
+    uint16_t offset = loadSRAMLine(addr);
+    black_pBuf = _sram_black_line + offset;
+    color_pBuf = _sram_color_line + offset;
+    _sram_line_dirty = true;
   } else {
     color_pBuf = color_buffer + addr;
     black_pBuf = black_buffer + addr;
   }
 
-  bool color_bit, black_bit;
-
-  black_bit = layer_colors[color] & 0x1;
-  color_bit = layer_colors[color] & 0x2;
-
-  uint8_t bit_idx;
-  if (_data_entry_mode == THINKINK_UC8179) {
-    bit_idx = x;
-  } else { //  THINKINK_STANDARD default!
-    bit_idx = y;
+  bool color_bit, black_bit;
+
+  black_bit = layer_colors[color] & 0x1;
+  color_bit = layer_colors[color] & 0x2;
+
+  uint8_t bit_idx;
+  if (_data_entry_mode == THINKINK_UC8179) {
+    bit_idx = x;
+  } else { //  THINKINK_STANDARD default!
+    bit_idx = y;
+  }
+
+  if ((color_bit && colorInverted) || (!color_bit && !colorInverted)) {
+    *color_pBuf &= ~(1 << (7 - bit_idx % 8));
+  } else {
+    *color_pBuf |= (1 << (7 - bit_idx % 8));
+  }
+
+  if ((black_bit && blackInverted) || (!black_bit && !blackInverted)) {
+    *black_pBuf &= ~(1 << (7 - bit_idx % 8));
+  } else {
+    *black_pBuf |= (1 << (7 - bit_idx % 8));
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Bring the SRAM line holding a framebuffer byte into the cache,
+    writing back the line it replaces. Two block reads per line instead of
+    two single-byte reads and writes per pixel
+    @param addr the byte's offset in its plane
+    @returns the byte's offset in _sram_black_line / _sram_color_line
+*/
+/**************************************************************************/
+uint16_t Adafruit_EPD::loadSRAMLine(uint16_t addr) {
+  uint16_t line = addr & ~(uint16_t)(EPD_SRAM_LINE_SIZE - 1);
+  if (_sram_line_len == 0 || line != _sram_line_addr) {
+    flushSRAMLine();
+    _sram_line_addr = line;
+    _sram_line_len = min((uint32_t)EPD_SRAM_LINE_SIZE, buffer1_size - line);
+    sram.read(blackbuffer_addr + line, _sram_black_line, _sram_line_len);
+    sram.read(colorbuffer_addr + line, _sram_color_line, _sram_line_len);
+  }
+  return addr - line;
+}
+
+/**************************************************************************/
+/*!
+    @brief Write the cached SRAM line back if drawPixel() changed it. Black
+    goes last, as drawPixel() always wrote it, for panels whose black and
+    color share one plane
+*/
+/**************************************************************************/
+void Adafruit_EPD::flushSRAMLine(void) {
+  if (!_sram_line_dirty) {
+    return;
+  }
+  sram.write(colorbuffer_addr + _sram_line_addr, _sram_color_line,
+             _sram_line_len);
+  sram.write(blackbuffer_addr + _sram_line_addr, _sram_black_line,
+             _sram_line_len);
+  _sram_line_dirty = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief Forget the cached SRAM line without writing it back, e.g. when
+    the planes are about to be overwritten
+*/
+/**************************************************************************/
+void Adafruit_EPD::dropSRAMLine(void) {
+  _sram_line_dirty = false;
+  _sram_line_len = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief Write a horizontal run of pixels, one color per pixel. The buffer
+    address is computed once for the whole run and, where the run lies along
+    a buffer byte (e.g. rows in portrait rotation 1), up to 8 pixels are
+    stored per read-modify-write. Much faster than drawPixel() per pixel.
+    @param x the x position of the first pixel
+    @param y the y position of the run
+    @param colors len EPD colors (EPD_WHITE, EPD_BLACK, ...)
+    @param len the number of pixels
+*/
+/**************************************************************************/
+void Adafruit_EPD::writeSpan(int16_t x, int16_t y, const uint8_t* colors,
+                             int16_t len) {
+  if (colors == NULL) {
+    return;
+  }
+  writeSpanBits(x, y, len, false, colors, 0);
+}
+
+/**************************************************************************/
+/*!
+    @brief Draw a horizontal line through the span writer
+    @param x the x position of the left end
+    @param y the y position of the line
+    @param w the line width in pixels
+    @param color the line color
+*/
+/**************************************************************************/
+void Adafruit_EPD::drawFastHLine(int16_t x, int16_t y, int16_t w,
+                                 uint16_t color) {
+  writeSpanBits(x, y, w, false, NULL, color);
+}
+
+/**************************************************************************/
+/*!
+    @brief Draw a vertical line through the span writer
+    @param x the x position of the line
+    @param y the y position of the top end
+    @param h the line height in pixels
+    @param color the line color
+*/
+/**************************************************************************/
+void Adafruit_EPD::drawFastVLine(int16_t x, int16_t y, int16_t h,
+                                 uint16_t color) {
+  writeSpanBits(x, y, h, true, NULL, color);
+}
+
+/**************************************************************************/
+/*!
+    @brief Fill a rectangle, one span per row or per column, whichever runs
+    along the buffer bytes in the current rotation, so each span is a few
+    byte stores
+    @param x the x position of the top left corner
+    @param y the y position of the top left corner
+    @param w the rectangle width
+    @param h the rectangle height
+    @param color the fill color
+*/
+/**************************************************************************/
+void Adafruit_EPD::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                            uint16_t color) {
+  if (w < 0) {
+    x += w + 1;
+    w = -w;
+  }
+  if (h < 0) {
+    y += h + 1;
+    h = -h;
+  }
+
+  // landscape rotations with the standard layout, portrait ones with the
+  // UC8179 layout, store a column of pixels along a byte
+  bool landscape = (getRotation() & 1) == 0;
+  bool columns = landscape == (_data_entry_mode != THINKINK_UC8179);
+  if (columns) {
+    int16_t end = x + w > width() ? width() : x + w;
+    for (int16_t i = x < 0 ? 0 : x; i < end; i++) {
+      writeSpanBits(i, y, h, true, NULL, color);
+    }
+  } else {
+    int16_t end = y + h > height() ? height() : y + h;
+    for (int16_t i = y < 0 ? 0 : y; i < end; i++) {
+      writeSpanBits(x, i, w, false, NULL, color);
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Fill the whole screen: a memset per plane with on-chip buffers
+    @param color the fill color
+*/
+/**************************************************************************/
+void Adafruit_EPD::fillScreen(uint16_t color) {
+  if (use_sram || !spanWrites || color >= EPD_NUM_COLORS) {
+    fillRect(0, 0, width(), height(), color);
+    return;
+  }
+  markDirty(0, 0, width(), height());
+  // same plane sizes as clearBuffer(); color first, then black, like
+  // drawPixel(), for shared planes
+  if (color_buffer) {
+    memset(color_buffer,
+           (((layer_colors[color] & 0x2) != 0) != colorInverted) ? 0xFF : 0x00,
+           buffer2_size);
+  }
+  if (black_buffer) {
+    memset(black_buffer,
+           (((layer_colors[color] & 0x1) != 0) != blackInverted) ? 0xFF : 0x00,
+           buffer1_size);
+  }
+  setPlaneFills(
+      (((layer_colors[color] & 0x1) != 0) != blackInverted) ? 0xFF : 0x00,
+      (((layer_colors[color] & 0x2) != 0) != colorInverted) ? 0xFF : 0x00);
+}
+
+/**************************************************************************/
+/*!
+    @brief Locate a logical pixel in the buffer layout: each layout is a
+    linear bit index (byte = bit / 8, mask = 0x80 >> bit % 8), with the same
+    math as drawPixel(). Also valid for off-screen pixels, as a base for
+    stepping.
+    @param x the logical x position
+    @param y the logical y position
+    @param bit receives the pixel's bit index
+    @param step_x receives the bit index change for x + 1
+    @param step_y receives the bit index change for y + 1
+*/
+/**************************************************************************/
+void Adafruit_EPD::nativeBitIndex(int16_t x, int16_t y, int32_t& bit,
+                                  int32_t& step_x, int32_t& step_y) {
+  // native pixel, and the native steps for x + 1 (hx, hy) and y + 1 (vx, vy)
+  int32_t nx = x, ny = y, hx = 1, hy = 0, vx = 0, vy = 1;
+  switch (getRotation()) {
+  case 1:
+    nx = WIDTH - 1 - y;
+    ny = x;
+    hx = 0, hy = 1, vx = -1, vy = 0;
+    break;
+  case 2:
+    nx = WIDTH - 1 - x;
+    ny = HEIGHT - 1 - y;
+    hx = -1, hy = 0, vx = 0, vy = -1;
+    break;
+  case 3:
+    nx = y;
+    ny = HEIGHT - 1 - x;
+    hx = 0, hy = -1, vx = 1, vy = 0;
+    break;
+  }
+
+  // deal with non-8-bit heights
+  int32_t _HEIGHT = (HEIGHT + 7) & ~7;
+  if (_data_entry_mode == THINKINK_UC8179) {
+    bit = (HEIGHT - 1 - ny) * WIDTH + nx;
+    step_x = hx - hy * WIDTH;
+    step_y = vx - vy * WIDTH;
+  } else { //  THINKINK_STANDARD default!
+    bit = (WIDTH - 1 - nx) * _HEIGHT + ny;
+    step_x = hy - hx * _HEIGHT;
+    step_y = vy - vx * _HEIGHT;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Draw a 1-bit canvas with its top left corner at (x, y), eight
+    pixels per framebuffer store. Canvas rows are transposed onto the buffer
+    bytes as the rotation requires; when they already run along the bytes
+    (e.g. rotation 1 with the standard layout) and the canvas is unrotated,
+    its bytes are shifted in whole.
+    @param canvas the canvas to draw (its rotation is honoured)
+    @param x the x position of the canvas's left edge
+    @param y the y position of the canvas's top edge
+    @param color the color set canvas bits (EPD_BLIT_AND: clear ones) paint
+    @param mode how the canvas bits combine with the framebuffer
+*/
+/**************************************************************************/
+void Adafruit_EPD::blitCanvas(const GFXcanvas1& canvas, int16_t x, int16_t y,
+                              uint16_t color, epd_blit_mode_t mode) {
+  blitRaster(canvas.getBuffer(), canvas.width(), canvas.height(),
+             canvas.getRotation() == 0 ? NULL : &canvas, x, y, color, mode);
+}
+
+/**************************************************************************/
+/*!
+    @brief Draw an unrotated 1-bit raster, e.g. a glyph of a font atlas in
+    flash, like an unrotated canvas of its size (blitCanvas())
+    @param bits rows of w bits, MSB first, each padded to a whole byte
+    @param w the raster width
+    @param h the raster height
+    @param x the x position of the raster's left edge
+    @param y the y position of the raster's top edge
+    @param color the color set bits (EPD_BLIT_AND: clear ones) paint
+    @param mode how the bits combine with the framebuffer
+*/
+/**************************************************************************/
+void Adafruit_EPD::blitBits(const uint8_t* bits, int16_t w, int16_t h,
+                            int16_t x, int16_t y, uint16_t color,
+                            epd_blit_mode_t mode) {
+  blitRaster(bits, w, h, NULL, x, y, color, mode);
+}
+
+/**************************************************************************/
+/*!
+    @brief Shared body of blitCanvas() and blitBits()
+    @param src the raster, rows padded to bytes
+    @param w the width, as drawn
+    @param h the height, as drawn
+    @param rotated the canvas to read through getPixel() when it is
+    rotated, NULL to read src directly
+    @param x the x position of the left edge
+    @param y the y position of the top edge
+    @param color the color set bits (EPD_BLIT_AND: clear ones) paint
+    @param mode how the bits combine with the framebuffer
+*/
+/**************************************************************************/
+void Adafruit_EPD::blitRaster(const uint8_t* src, int16_t w, int16_t h,
+                              const GFXcanvas1* rotated, int16_t x, int16_t y,
+                              uint16_t color, epd_blit_mode_t mode) {
+  if (src == NULL || w <= 0 || h <= 0 || color >= EPD_NUM_COLORS) {
+    return;
+  }
+
+  // raster area that lands on the screen
+  int16_t cx0 = x < 0 ? -x : 0, cy0 = y < 0 ? -y : 0;
+  int16_t cx1 = w, cy1 = h;
+  if (x + cx1 > width()) {
+    cx1 = width() - x;
+  }
+  if (y + cy1 > height()) {
+    cy1 = height() - y;
+  }
+  if (cx0 >= cx1 || cy0 >= cy1) {
+    return;
+  }
+
+  // an unrotated canvas is read straight from its raster
+  bool raw = rotated == NULL;
+  uint16_t stride = (w + 7) / 8;
+  auto canvasBit = [&](int16_t cx, int16_t cy) -> bool {
+    if (raw) {
+      return src[(uint32_t)cy * stride + cx / 8] & (0x80 >> (cx & 7));
+    }
+    return rotated->getPixel(cx, cy);
+  };
+
+  int32_t origin, step_x, step_y;
+  nativeBitIndex(x, y, origin, step_x, step_y);
+  bool along_x = step_x == 1 || step_x == -1;
+  if (use_sram || !spanWrites || (!along_x && step_y != 1 && step_y != -1)) {
+    for (int16_t cy = cy0; cy < cy1; cy++) {
+      for (int16_t cx = cx0; cx < cx1; cx++) {
+        bool on = canvasBit(cx, cy);
+        if (mode == EPD_BLIT_COPY) {
+          drawPixel(x + cx, y + cy, on ? color : (uint16_t)EPD_WHITE);
+        } else if (on == (mode == EPD_BLIT_OR)) {
+          drawPixel(x + cx, y + cy, color);
+        }
+      }
+    }
+    return;
+  }
+  markDirty(x + cx0, y + cy0, cx1 - cx0, cy1 - cy0);
+
+  uint8_t black_fg =
+      (((layer_colors[color] & 0x1) != 0) != blackInverted) ? 0xFF : 0x00;
+  uint8_t color_fg =
+      (((layer_colors[color] & 0x2) != 0) != colorInverted) ? 0xFF : 0x00;
+  uint8_t black_bg =
+      (((layer_colors[EPD_WHITE] & 0x1) != 0) != blackInverted) ? 0xFF : 0x00;
+  uint8_t color_bg =
+      (((layer_colors[EPD_WHITE] & 0x2) != 0) != colorInverted) ? 0xFF : 0x00;
+
+  // one line of the canvas per pass, along the buffer bytes
+  int32_t step = along_x ? step_x : step_y;
+  int32_t line_step = along_x ? step_y : step_x;
+  int16_t a0 = along_x ? cx0 : cy0, a1 = along_x ? cx1 : cy1;
+  int16_t l0 = along_x ? cy0 : cx0, l1 = along_x ? cy1 : cx1;
+  int16_t len = a1 - a0;
+  bool shift_in = raw && along_x && step == 1;
+
+  for (int16_t l = l0; l < l1; l++) {
+    // lowest bit of the run; bits go up from there
+    int32_t start = origin + (int32_t)l * line_step + (int32_t)a0 * step;
+    int32_t low = step > 0 ? start : start - (len - 1);
+    const uint8_t* row = src + (uint32_t)l * stride;
+
+    for (int16_t i = 0; i < len;) {
+      uint32_t addr = (low + i) / 8;
+      uint8_t first = (low + i) % 8;
+      int16_t n = 8 - first;
+      if (n > len - i) {
+        n = len - i;
+      }
+      uint8_t valid = (uint8_t)(0xFF << (8 - n)) >> first;
+
+      uint8_t on = 0;
+      if (shift_in) {
+        // native orientation: the next n canvas bits, as one byte
+        uint16_t s = a0 + i;
+        uint16_t window = row[s / 8] << 8;
+        if (s / 8 + 1 < stride) {
+          window |= row[s / 8 + 1];
+        }
+        on = (uint8_t)((uint16_t)(window << (s % 8)) >> 8) >> first;
+      } else {
+        for (int16_t j = 0; j < n; j++) {
+          int16_t a = step > 0 ? a0 + i + j : a1 - 1 - (i + j);
+          if (along_x ? canvasBit(a, l) : canvasBit(l, a)) {
+            on |= 0x80 >> (first + j);
+          }
+        }
+      }
+      on &= valid;
+
+      uint8_t fg = mode == EPD_BLIT_AND ? (valid & ~on) : on;
+      uint8_t bg = mode == EPD_BLIT_COPY ? (valid & ~on) : 0;
+      uint8_t mask = fg | bg;
+      if (mask != 0) {
+        // color first, then black, like drawPixel(), for shared planes
+        color_buffer[addr] = (color_buffer[addr] & ~mask) |
+                             (color_fg & fg) | (color_bg & bg);
+        black_buffer[addr] = (black_buffer[addr] & ~mask) |
+                             (black_fg & fg) | (black_bg & bg);
+      }
+      i += n;
+    }
+  }
+}
+
+// 4x4 ordered dither thresholds, 0..15: quantizeColor() needs no state
+// between pixels, so bitmaps can be drawn in any order and any piece
+static const uint8_t EPD_BAYER4[4][4] = {
+    {0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+
+/**************************************************************************/
+/*!
+    @brief Map a color to the inks of the current mode, ordered-dithered
+    between neighbouring grays. Mono picks black or white, grayscale4 one
+    of four grays, tricolor and quadcolor take red (and yellow) for clearly
+    warm colors and black or white otherwise
+    @param r red, 0-255
+    @param g green, 0-255
+    @param b blue, 0-255
+    @param x the logical x position, for the dither pattern
+    @param y the logical y position
+    @returns an EPD color (EPD_WHITE, EPD_BLACK, ...)
+*/
+/**************************************************************************/
+uint8_t Adafruit_EPD::quantizeColor(uint8_t r, uint8_t g, uint8_t b,
+                                    int16_t x, int16_t y) {
+  uint16_t luma = (77 * r + 150 * g + 29 * b) >> 8;
+  // threshold in 1/16 steps of one gray interval, centred
+  uint16_t t = EPD_BAYER4[y & 3][x & 3] * 16 + 8;
+
+  if (inkmode == THINKINK_TRICOLOR || inkmode == THINKINK_QUADCOLOR) {
+    // warm and not too dark: red, or yellow when green is as strong
+    if (r > 128 && r > b + 64 && luma > 64) {
+      if (inkmode == THINKINK_QUADCOLOR && g > 160) {
+        return EPD_YELLOW;
+      }
+      if (g < r - 64) {
+        return EPD_RED;
+      }
+    }
+  }
+  if (inkmode == THINKINK_GRAYSCALE4) {
+    // three intervals between four grays; the fraction is dithered
+    uint16_t scaled = luma * 3;
+    uint8_t level = scaled / 255;
+    uint16_t frac = (scaled % 255) * 256 / 255;
+    if (level < 3 && frac >= t) {
+      level++;
+    }
+    static const uint8_t grays[4] = {EPD_BLACK, EPD_DARK, EPD_LIGHT,
+                                     EPD_WHITE};
+    return grays[level];
+  }
+  return luma * 256 / 255 >= t ? EPD_WHITE : EPD_BLACK;
+}
+
+/**************************************************************************/
+/*!
+    @brief Quantize a bitmap and write it as spans of up to EPD_BITMAP_CHUNK
+    pixels along rows or columns, whichever lie along the buffer bytes, so
+    the span writer packs whole bytes
+    @param x the x position of the left edge
+    @param y the y position of the top edge
+    @param rgb w * h RGB565 pixels, or NULL
+    @param gray w * h 8-bit grays if rgb is NULL
+    @param mask 1-bit mask, rows padded to bytes, 0 bits left alone; or NULL
+    @param w the bitmap width
+    @param h the bitmap height
+*/
+/**************************************************************************/
+void Adafruit_EPD::drawQuantized(int16_t x, int16_t y, const uint16_t* rgb,
+                                 const uint8_t* gray, const uint8_t* mask,
+                                 int16_t w, int16_t h) {
+  if ((rgb == NULL && gray == NULL) || w <= 0 || h <= 0) {
+    return;
+  }
+  // clip to the screen, keeping the source offsets
+  int16_t sx0 = x < 0 ? -x : 0, sy0 = y < 0 ? -y : 0;
+  int16_t sx1 = x + w > width() ? width() - x : w;
+  int16_t sy1 = y + h > height() ? height() - y : h;
+  if (sx0 >= sx1 || sy0 >= sy1) {
+    return;
+  }
+  int32_t bit, step_x, step_y;
+  nativeBitIndex(0, 0, bit, step_x, step_y);
+  bool columns = step_y == 1 || step_y == -1;
+  int16_t mask_stride = (w + 7) / 8;
+
+  uint8_t colors[EPD_BITMAP_CHUNK];
+  // outer: the lines across the bytes; inner: runs along them
+  int16_t outer0 = columns ? sx0 : sy0, outer1 = columns ? sx1 : sy1;
+  int16_t inner0 = columns ? sy0 : sx0, inner1 = columns ? sy1 : sx1;
+  for (int16_t o = outer0; o < outer1; o++) {
+    for (int16_t start = inner0; start < inner1; start += EPD_BITMAP_CHUNK) {
+      int16_t n = inner1 - start;
+      if (n > EPD_BITMAP_CHUNK) {
+        n = EPD_BITMAP_CHUNK;
+      }
+      // masked-out pixels end a run: not every writeClippedSpan() skips
+      // colors past EPD_NUM_COLORS
+      int16_t run = 0;
+      for (int16_t k = 0; k <= n; k++) {
+        int16_t sx = columns ? o : start + k;
+        int16_t sy = columns ? start + k : o;
+        if (k == n || (mask != NULL && !(mask[sy * mask_stride + sx / 8] &
+                                         (0x80 >> (sx & 7))))) {
+          if (k > run) {
+            int16_t first = start + run;
+            if (columns) {
+              writeSpanBits(x + o, y + first, k - run, true, colors + run, 0);
+            } else {
+              writeSpanBits(x + first, y + o, k - run, false, colors + run, 0);
+            }
+          }
+          run = k + 1;
+          continue;
+        }
+        uint8_t r, g, b;
+        if (rgb != NULL) {
+          uint16_t c = rgb[(int32_t)sy * w + sx];
+          // 5/6 bits widened with their top bits, so full scale is 255
+          r = ((c >> 8) & 0xF8) | (c >> 13);
+          g = ((c >> 3) & 0xFC) | ((c >> 9) & 0x3);
+          b = ((c << 3) & 0xF8) | ((c >> 2) & 0x7);
+        } else {
+          r = g = b = gray[(int32_t)sy * w + sx];
+        }
+        colors[k] = quantizeColor(r, g, b, x + sx, y + sy);
+      }
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Draw an RGB565 bitmap, quantized to the panel's inks
+    (quantizeColor()) and packed a byte of pixels at a time, instead of
+    Adafruit_GFX's writePixel() per pixel with no ink mapping
+    @param x the x position of the left edge
+    @param y the y position of the top edge
+    @param bitmap w * h RGB565 pixels
+    @param w the bitmap width
+    @param h the bitmap height
+*/
+/**************************************************************************/
+void Adafruit_EPD::drawRGBBitmap(int16_t x, int16_t y, const uint16_t bitmap[],
+                                 int16_t w, int16_t h) {
+  drawQuantized(x, y, bitmap, NULL, NULL, w, h);
+}
+
+/**************************************************************************/
+/*!
+    @brief Draw an RGB565 bitmap from RAM, as the const overload
+    @param x the x position of the left edge
+    @param y the y position of the top edge
+    @param bitmap w * h RGB565 pixels
+    @param w the bitmap width
+    @param h the bitmap height
+*/
+/**************************************************************************/
+void Adafruit_EPD::drawRGBBitmap(int16_t x, int16_t y, uint16_t* bitmap,
+                                 int16_t w, int16_t h) {
+  drawQuantized(x, y, bitmap, NULL, NULL, w, h);
+}
+
+/**************************************************************************/
+/*!
+    @brief Draw an RGB565 bitmap through a 1-bit mask
+    @param x the x position of the left edge
+    @param y the y position of the top edge
+    @param bitmap w * h RGB565 pixels
+    @param mask 1 bit per pixel, rows padded to bytes; 0 leaves the pixel
+    @param w the bitmap width
+    @param h the bitmap height
+*/
+/**************************************************************************/
+void Adafruit_EPD::drawRGBBitmap(int16_t x, int16_t y, const uint16_t bitmap[],
+                                 const uint8_t mask[], int16_t w, int16_t h) {
+  drawQuantized(x, y, bitmap, NULL, mask, w, h);
+}
+
+/**************************************************************************/
+/*!
+    @brief Draw an RGB565 bitmap from RAM through a 1-bit mask
+    @param x the x position of the left edge
+    @param y the y position of the top edge
+    @param bitmap w * h RGB565 pixels
+    @param mask 1 bit per pixel, rows padded to bytes; 0 leaves the pixel
+    @param w the bitmap width
+    @param h the bitmap height
+*/
+/**************************************************************************/
+void Adafruit_EPD::drawRGBBitmap(int16_t x, int16_t y, uint16_t* bitmap,
+                                 uint8_t* mask, int16_t w, int16_t h) {
+  drawQuantized(x, y, bitmap, NULL, mask, w, h);
+}
+
+/**************************************************************************/
+/*!
+    @brief Draw an 8-bit grayscale bitmap, quantized to the panel's inks and
+    packed like drawRGBBitmap()
+    @param x the x position of the left edge
+    @param y the y position of the top edge
+    @param bitmap w * h grays, 0 black to 255 white
+    @param w the bitmap width
+    @param h the bitmap height
+*/
+/**************************************************************************/
+void Adafruit_EPD::drawGrayscaleBitmap(int16_t x, int16_t y,
+                                       const uint8_t bitmap[], int16_t w,
+                                       int16_t h) {
+  drawQuantized(x, y, NULL, bitmap, NULL, w, h);
+}
+
+/**************************************************************************/
+/*!
+    @brief Draw an 8-bit grayscale bitmap from RAM, as the const overload
+    @param x the x position of the left edge
+    @param y the y position of the top edge
+    @param bitmap w * h grays, 0 black to 255 white
+    @param w the bitmap width
+    @param h the bitmap height
+*/
+/**************************************************************************/
+void Adafruit_EPD::drawGrayscaleBitmap(int16_t x, int16_t y, uint8_t* bitmap,
+                                       int16_t w, int16_t h) {
+  drawQuantized(x, y, NULL, bitmap, NULL, w, h);
+}
+
+/**************************************************************************/
+/*!
+    @brief Draw an 8-bit grayscale bitmap through a 1-bit mask
+    @param x the x position of the left edge
+    @param y the y position of the top edge
+    @param bitmap w * h grays, 0 black to 255 white
+    @param mask 1 bit per pixel, rows padded to bytes; 0 leaves the pixel
+    @param w the bitmap width
+    @param h the bitmap height
+*/
+/**************************************************************************/
+void Adafruit_EPD::drawGrayscaleBitmap(int16_t x, int16_t y,
+                                       const uint8_t bitmap[],
+                                       const uint8_t mask[], int16_t w,
+                                       int16_t h) {
+  drawQuantized(x, y, NULL, bitmap, mask, w, h);
+}
+
+/**************************************************************************/
+/*!
+    @brief Draw an 8-bit grayscale bitmap from RAM through a 1-bit mask
+    @param x the x position of the left edge
+    @param y the y position of the top edge
+    @param bitmap w * h grays, 0 black to 255 white
+    @param mask 1 bit per pixel, rows padded to bytes; 0 leaves the pixel
+    @param w the bitmap width
+    @param h the bitmap height
+*/
+/**************************************************************************/
+void Adafruit_EPD::drawGrayscaleBitmap(int16_t x, int16_t y, uint8_t* bitmap,
+                                       uint8_t* mask, int16_t w, int16_t h) {
+  drawQuantized(x, y, NULL, bitmap, mask, w, h);
+}
+
+/**************************************************************************/
+/*!
+    @brief Print one character. Transparent text (a single text color) is
+    drawn from a small LRU cache of glyphs rasterized at the current text
+    size, each blitted in whole bytes with blitCanvas(); other text takes the
+    per-pixel Adafruit_GFX path. Cursor movement and wrapping are the same
+    as Adafruit_GFX::write().
+    @param c the character
+    @returns 1
+*/
+/**************************************************************************/
+size_t Adafruit_EPD::write(uint8_t c) {
+  if (textcolor != textbgcolor || use_sram || !spanWrites) {
+    return Adafruit_GFX::write(c);
+  }
+
+  if (!gfxFont) { // 'Classic' built-in font
+    if (c == '\n') {
+      cursor_x = 0;
+      cursor_y += textsize_y * 8;
+    } else if (c != '\r') {
+      if (wrap && ((cursor_x + textsize_x * 6) > _width)) {
+        cursor_x = 0;
+        cursor_y += textsize_y * 8;
+      }
+      drawGlyph(cursor_x, cursor_y, c);
+      cursor_x += textsize_x * 6;
+    }
+    return 1;
+  }
+
+  if (c == '\n') {
+    cursor_x = 0;
+    cursor_y += (int16_t)textsize_y * gfxFont->yAdvance;
+  } else if (c != '\r') {
+    uint8_t first = gfxFont->first;
+    if ((c >= first) && (c <= gfxFont->last)) {
+      const GFXglyph* glyph = &gfxFont->glyph[c - first];
+      uint8_t w = glyph->width, h = glyph->height;
+      if ((w > 0) && (h > 0)) {
+        int16_t xo = glyph->xOffset;
+        if (wrap && ((cursor_x + textsize_x * (xo + w)) > _width)) {
+          cursor_x = 0;
+          cursor_y += (int16_t)textsize_y * gfxFont->yAdvance;
+        }
+        drawGlyph(cursor_x, cursor_y, c);
+      }
+      cursor_x += glyph->xAdvance * (int16_t)textsize_x;
+    }
+  }
+  return 1;
+}
+
+/**************************************************************************/
+/*!
+    @brief Draw one character at a cursor position from the glyph cache,
+    falling back to Adafruit_GFX::drawChar() when it can't be rasterized
+    @param x the cursor x position
+    @param y the cursor y position (top for the classic font, baseline for
+    GFX fonts)
+    @param c the character
+*/
+/**************************************************************************/
+void Adafruit_EPD::drawGlyph(int16_t x, int16_t y, unsigned char c) {
+  const epd_font_atlas_t* atlas = currentAtlas();
+  if (atlas != NULL && c >= atlas->first && c <= atlas->last) {
+    const epd_atlas_glyph_t& g = atlas->glyphs[c - atlas->first];
+    if (g.width != 0 && g.height != 0) {
+      blitBits(atlas->bitmap + g.offset, g.width, g.height, x + g.x_offset,
+               y + g.y_offset, textcolor, EPD_BLIT_OR);
+    }
+    return;
+  }
+  const glyph_cache_entry_t* glyph = cachedGlyph(c);
+  if (glyph == NULL) {
+    drawChar(x, y, c, textcolor, textbgcolor, textsize_x, textsize_y);
+    return;
+  }
+  blitCanvas(glyph->raster->canvas, x + glyph->x_offset, y + glyph->y_offset,
+             textcolor, EPD_BLIT_OR);
+}
+
+/**************************************************************************/
+/*!
+    @brief Use pre-rasterized fonts for transparent text: write() blits a
+    glyph straight from the atlas matching the current font and text size,
+    and only falls back to the glyph cache for other fonts, sizes and
+    characters
+    @param atlases the atlases, kept by pointer (e.g. tables in flash)
+    @param count how many
+*/
+/**************************************************************************/
+void Adafruit_EPD::setFontAtlases(const epd_font_atlas_t* const* atlases,
+                                  uint8_t count) {
+  _atlases = atlases;
+  _atlas_count = atlases != NULL ? count : 0;
+  _atlas_size_x = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief The atlas for the current font and text size, looked up again
+    only when either changes
+    @returns the atlas, or NULL if there is none
+*/
+/**************************************************************************/
+const epd_font_atlas_t* Adafruit_EPD::currentAtlas(void) {
+  if (_atlas_count == 0) {
+    return NULL;
+  }
+  if (_atlas_size_x != textsize_x || _atlas_size_y != textsize_y ||
+      _atlas_font != gfxFont) {
+    uint32_t key = epdFontKey(gfxFont);
+    _atlas = NULL;
+    for (uint8_t i = 0; i < _atlas_count && _atlas == NULL; i++) {
+      const epd_font_atlas_t* a = _atlases[i];
+      if (a->font_key == key && a->size_x == textsize_x &&
+          a->size_y == textsize_y) {
+        _atlas = a;
+      }
+    }
+    _atlas_font = gfxFont;
+    _atlas_size_x = textsize_x;
+    _atlas_size_y = textsize_y;
+  }
+  // classic atlases are drawn without the cp437 glyph shift
+  return (gfxFont == NULL && _cp437) ? NULL : _atlas;
+}
+
+/**************************************************************************/
+/*!
+    @brief Identify a GFX font by its metrics, so an atlas made from the
+    font's header matches it whichever translation unit defines it:
+    FNV-1a over first, last, yAdvance and each glyph's width, height,
+    xAdvance, xOffset and yOffset bytes
+    @param font the font, NULL for the classic one
+    @returns the key, 0 for the classic font
+*/
+/**************************************************************************/
+uint32_t epdFontKey(const GFXfont* font) {
+  if (font == NULL) {
+    return 0;
+  }
+  uint32_t hash = 2166136261u;
+  auto mix = [&hash](uint8_t b) {
+    hash ^= b;
+    hash *= 16777619u;
+  };
+  mix(font->first);
+  mix(font->last);
+  mix(font->yAdvance);
+  for (uint16_t c = font->first; c <= font->last; c++) {
+    const GFXglyph* g = &font->glyph[c - font->first];
+    mix(g->width);
+    mix(g->height);
+    mix(g->xAdvance);
+    mix((uint8_t)g->xOffset);
+    mix((uint8_t)g->yOffset);
+  }
+  return hash != 0 ? hash : 1;
+}
+
+/**************************************************************************/
+/*!
+    @brief Find a character in the glyph cache for the current font, text
+    size and cp437 setting, rasterizing it into the least recently used slot
+    on a miss
+    @param c the character
+    @returns the entry, or NULL if out of memory
+*/
+/**************************************************************************/
+const Adafruit_EPD::glyph_cache_entry_t*
+Adafruit_EPD::cachedGlyph(unsigned char c) {
+  glyph_cache_entry_t* victim = &_glyph_cache[0];
+  _glyph_clock++;
+  for (uint8_t i = 0; i < EPD_GLYPH_CACHE_SIZE; i++) {
+    glyph_cache_entry_t* e = &_glyph_cache[i];
+    if (e->raster != NULL && e->font == gfxFont && e->c == c &&
+        e->size_x == textsize_x && e->size_y == textsize_y &&
+        e->cp437 == _cp437) {
+      e->last_used = _glyph_clock;
+      return e;
+    }
+    if (victim->raster != NULL &&
+        (e->raster == NULL || e->last_used < victim->last_used)) {
+      victim = e;
+    }
+  }
+
+  // raster size and position relative to the cursor
+  int16_t w, h, x_offset = 0, y_offset = 0;
+  if (!gfxFont) {
+    w = 5 * textsize_x;
+    h = 8 * textsize_y;
+  } else {
+    if (c < gfxFont->first || c > gfxFont->last) {
+      return NULL;
+    }
+    const GFXglyph* glyph = &gfxFont->glyph[c - gfxFont->first];
+    w = glyph->width * textsize_x;
+    h = glyph->height * textsize_y;
+    x_offset = glyph->xOffset * textsize_x;
+    y_offset = glyph->yOffset * textsize_y;
+  }
+  if (w <= 0 || h <= 0) {
+    return NULL;
+  }
+
+  delete victim->raster;
+  victim->raster = new glyph_raster_t(w, h);
+  GFXcanvas1& canvas = victim->raster->canvas;
+  if (canvas.getBuffer() == NULL) {
+    delete victim->raster;
+    victim->raster = NULL;
+    return NULL;
+  }
+  canvas.setFont(gfxFont);
+  canvas.cp437(_cp437);
+  canvas.drawChar(-x_offset, -y_offset, c, 1, 1, textsize_x, textsize_y);
+
+  victim->font = gfxFont;
+  victim->c = c;
+  victim->size_x = textsize_x;
+  victim->size_y = textsize_y;
+  victim->cp437 = _cp437;
+  victim->x_offset = x_offset;
+  victim->y_offset = y_offset;
+  victim->last_used = _glyph_clock;
+  return victim;
+}
+
+/**************************************************************************/
+/*!
+    @brief Write a span writeSpanBits() has clipped, for external SRAM and
+    drivers with their own pixel format (spanWrites false). The default
+    goes through drawPixel(); such drivers can override it with a packed
+    writer of their format
+    @param x the x position of the first pixel, on screen
+    @param y the y position of the first pixel, on screen
+    @param len the number of pixels, all on screen
+    @param vertical run along y instead of x
+    @param colors per-pixel colors, or NULL to use fill for every pixel
+    @param fill the color for every pixel when colors is NULL
+*/
+/**************************************************************************/
+void Adafruit_EPD::writeClippedSpan(int16_t x, int16_t y, int16_t len,
+                                    bool vertical, const uint8_t* colors,
+                                    uint16_t fill) {
+  for (int16_t i = 0; i < len; i++) {
+    uint16_t c = colors != NULL ? colors[i] : fill;
+    if (vertical) {
+      drawPixel(x, y + i, c);
+    } else {
+      drawPixel(x + i, y, c);
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Shared span writer for writeSpan() and the line/rect fills
+    @param x the x position of the first pixel
+    @param y the y position of the first pixel
+    @param len the number of pixels
+    @param vertical run along y instead of x
+    @param colors per-pixel colors, or NULL to use fill for every pixel
+    @param fill the color for every pixel when colors is NULL
+*/
+/**************************************************************************/
+void Adafruit_EPD::writeSpanBits(int16_t x, int16_t y, int16_t len,
+                                 bool vertical, const uint8_t* colors,
+                                 uint16_t fill) {
+  // clip to the logical screen, keeping colors lined up with the first
+  // visible pixel
+  int16_t along = vertical ? y : x;
+  int16_t across = vertical ? x : y;
+  int16_t limit = vertical ? height() : width();
+  if (across < 0 || across >= (vertical ? width() : height()) || len <= 0) {
+    return;
+  }
+  if (along < 0) {
+    if (colors != NULL) {
+      colors -= along;
+    }
+    len += along;
+    along = 0;
+  }
+  if (along + len > limit) {
+    len = limit - along;
+  }
+  if (len <= 0) {
+    return;
+  }
+  x = vertical ? across : along;
+  y = vertical ? along : across;
+  markDirty(x, y, vertical ? 1 : len, vertical ? len : 1);
+
+  if (use_sram || !spanWrites) {
+    writeClippedSpan(x, y, len, vertical, colors, fill);
+    return;
+  }
+
+  int32_t bit, step_x, step_y;
+  nativeBitIndex(x, y, bit, step_x, step_y);
+  int32_t step = vertical ? step_y : step_x;
+
+  if (step == 1 || step == -1) {
+    // the run lies along buffer bytes: walk it in increasing bit order and
+    // merge up to 8 pixels per byte
+    if (step < 0) {
+      bit -= len - 1;
+    }
+    int16_t i = 0;
+    if (colors == NULL) {
+      if (fill >= EPD_NUM_COLORS) {
+        return;
+      }
+      // one color throughout: masked edge bytes, memset in between
+      uint8_t black_fill =
+          (((layer_colors[fill] & 0x1) != 0) != blackInverted) ? 0xFF : 0x00;
+      uint8_t color_fill =
+          (((layer_colors[fill] & 0x2) != 0) != colorInverted) ? 0xFF : 0x00;
+      while (i < len) {
+        uint32_t addr = bit / 8;
+        uint8_t first = bit % 8;
+        if (first == 0 && len - i >= 8) {
+          uint32_t bytes = (len - i) / 8;
+          memset(color_buffer + addr, color_fill, bytes);
+          memset(black_buffer + addr, black_fill, bytes);
+          i += bytes * 8;
+          bit += bytes * 8;
+          continue;
+        }
+        int16_t n = 8 - first;
+        if (n > len - i) {
+          n = len - i;
+        }
+        uint8_t mask = (uint8_t)(0xFF << (8 - n)) >> first;
+        color_buffer[addr] = (color_buffer[addr] & ~mask) | (color_fill & mask);
+        black_buffer[addr] = (black_buffer[addr] & ~mask) | (black_fill & mask);
+        i += n;
+        bit += n;
+      }
+      return;
+    }
+    // plane bits per color, worked out once per run instead of per pixel:
+    // bit 0 black, bit 1 color
+    uint8_t ink[EPD_NUM_COLORS];
+    for (uint8_t c = 0; c < EPD_NUM_COLORS; c++) {
+      ink[c] = ((((layer_colors[c] & 0x1) != 0) != blackInverted) ? 1 : 0) |
+               ((((layer_colors[c] & 0x2) != 0) != colorInverted) ? 2 : 0);
+    }
+    while (i < len) {
+      uint32_t addr = bit / 8;
+      uint8_t first = bit % 8;
+      if (first == 0 && step > 0 && len - i >= 8) {
+        // whole bytes in pixel order (the UC8179 layout unrotated, the
+        // standard one in portrait): pack and store each without reading
+        // it back, a row streaming out as it would from memcpy
+        uint32_t end = addr + (len - i) / 8;
+        for (; addr < end; addr++, i += 8, bit += 8) {
+          const uint8_t* p = colors + i;
+          uint8_t black_bits = 0, color_bits = 0, keep = 0;
+          for (uint8_t j = 0; j < 8; j++) {
+            uint8_t c = p[j];
+            uint8_t bits = c < EPD_NUM_COLORS ? ink[c] : 0;
+            keep |= c < EPD_NUM_COLORS ? 0 : 0x80 >> j;
+            black_bits = (black_bits << 1) | (bits & 1);
+            color_bits = (color_bits << 1) | (bits >> 1);
+          }
+          if (keep == 0) {
+            color_buffer[addr] = color_bits;
+            black_buffer[addr] = black_bits;
+          } else {
+            // pixels out of range keep their old bits
+            color_buffer[addr] = (color_buffer[addr] & keep) | color_bits;
+            black_buffer[addr] = (black_buffer[addr] & keep) | black_bits;
+          }
+        }
+        continue;
+      }
+      int16_t n = 8 - first;
+      if (n > len - i) {
+        n = len - i;
+      }
+      uint8_t mask = 0, black_bits = 0, color_bits = 0;
+      for (int16_t j = 0; j < n; j++, i++) {
+        uint8_t c = colors[step > 0 ? i : len - 1 - i];
+        if (c >= EPD_NUM_COLORS) {
+          continue;
+        }
+        uint8_t m = 0x80 >> (first + j);
+        mask |= m;
+        black_bits |= (ink[c] & 1) ? m : 0;
+        color_bits |= (ink[c] & 2) ? m : 0;
+      }
+      // color first, then black, like drawPixel(), for shared planes
+      color_buffer[addr] = (color_buffer[addr] & ~mask) | color_bits;
+      black_buffer[addr] = (black_buffer[addr] & ~mask) | black_bits;
+      bit += n;
+    }
+    return;
+  }
+
+  // the run crosses buffer bytes: one bit per byte, but no per-pixel
+  // rotation or address math
+  for (int16_t i = 0; i < len; i++, bit += step) {
+    uint16_t c = colors != NULL ? colors[i] : fill;
+    if (c >= EPD_NUM_COLORS) {
+      continue;
+    }
+    uint32_t addr = bit / 8;
+    uint8_t m = 0x80 >> (bit % 8);
+    if (((layer_colors[c] & 0x2) != 0) != colorInverted) {
+      color_buffer[addr] |= m;
+    } else {
+      color_buffer[addr] &= ~m;
+    }
+    if (((layer_colors[c] & 0x1) != 0) != blackInverted) {
+      black_buffer[addr] |= m;
+    } else {
+      black_buffer[addr] &= ~m;
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Send one byte value repeatedly as plane data, from the constant
+    fill chunk instead of the framebuffer. The RAM write command must
+    already be sent and DC high
+    @param value the byte to send, as the controller should receive it
+    @param size number of bytes to send
+*/
+/**************************************************************************/
+void Adafruit_EPD::writeRAMFillToEPD(uint8_t value, uint32_t size) {
+  spiClock(true);
+  xSemaphoreTake(fillLock(), portMAX_DELAY);
+  if (s_fill_value != value) {
+    memset(s_fill_chunk, value, sizeof(s_fill_chunk));
+    s_fill_value = value;
+  }
+  for (uint32_t sent = 0; sent < size; sent += EPD_FILL_CHUNK_SIZE) {
+    if (sent != 0 && sent % EPD_UPLOAD_CHUNK_SIZE == 0 && uploadCancelled()) {
+      break;
+    }
+    uint32_t len = min(size - sent, (uint32_t)EPD_FILL_CHUNK_SIZE);
+    if (_panel_io != NULL) {
+      panelIOColor(s_fill_chunk, len);
+    } else {
+      spi_dev->write(s_fill_chunk, len);
+    }
+  }
+  // the chunk is shared, so queued transfers must be done before it is
+  // handed to another panel
+  panelIOWait();
+  xSemaphoreGive(fillLock());
+}
+
+/**************************************************************************/
+/*!
+    @brief Write a RAM framebuffer plane to the EPD controller memory
+    @param framebuffer the plane to send
+    @param framebuffer_size number of bytes in the plane
+    @param EPDlocation which controller RAM to write (see writeRAMCommand)
+    @param invertdata if true each byte is complemented on the way out
+*/
+/**************************************************************************/
+void Adafruit_EPD::writeRAMFramebufferToEPD(uint8_t* framebuffer,
+                                            uint32_t framebuffer_size,
+                                            uint8_t EPDlocation,
+                                            bool invertdata) {
+  if (uploadCancelled()) {
+    return;
+  }
+  int64_t start = esp_timer_get_time();
+  // write image
+  writeRAMCommand(EPDlocation);
+  dcHigh();
+  // Serial.printf("Writing from RAM location %04x: \n", &framebuffer);
+
+  if (!singleByteTxns) {
+    // bulk path: the plane goes out in max_transfer_sz sized DMA
+    // transactions instead of one blocking transaction per byte, a cancel
+    // check between EPD_UPLOAD_CHUNK_SIZE chunks. A blank plane skips the
+    // framebuffer reads and invert/bounce copies altogether
+    int16_t known = framebuffer == buffer1   ? _plane_fill[0]
+                    : framebuffer == buffer2 ? _plane_fill[1]
+                                             : -1;
+    uint8_t fill = (uint8_t)known;
+    if (known >= 0 || uniformPlane(framebuffer, framebuffer_size, fill)) {
+      writeRAMFillToEPD(invertdata ? (uint8_t)~fill : fill, framebuffer_size);
+      csHigh();
+      _timing_next.plane_us[EPDlocation ? 1 : 0] +=
+          traceSpan(EPDlocation ? EPD_TRACE_PLANE2 : EPD_TRACE_PLANE1, start);
+      return;
+    }
+    spiClock(true);
+    for (uint32_t sent = 0; sent < framebuffer_size; sent += EPD_UPLOAD_CHUNK_SIZE) {
+      if (sent != 0 && uploadCancelled()) {
+        break;
+      }
+      uint32_t len = min(framebuffer_size - sent, (uint32_t)EPD_UPLOAD_CHUNK_SIZE);
+      if (_panel_io != NULL) {
+        if (invertdata) {
+          panelIOColorInverted(framebuffer + sent, len);
+        } else {
+          panelIOColor(framebuffer + sent, len);
+        }
+      } else if (invertdata) {
+        spi_dev->writeInverted(framebuffer + sent, len);
+      } else {
+        spi_dev->write(framebuffer + sent, len);
+      }
+    }
+    // the framebuffer is handed back once display() returns from here
+    panelIOWait();
+    csHigh();
+    _timing_next.plane_us[EPDlocation ? 1 : 0] +=
+        traceSpan(EPDlocation ? EPD_TRACE_PLANE2 : EPD_TRACE_PLANE1, start);
+    return;
+  }
+
+  for (uint32_t i = 0; i < framebuffer_size; i++) {
+    if (i != 0 && i % EPD_UPLOAD_CHUNK_SIZE == 0 && uploadCancelled()) {
+      break;
+    }
+    uint8_t d = framebuffer[i];
+    if (invertdata)
+      d = ~d;
+
+    /*
+    Serial.printf("%02x", d);
+    if ((i+1) % (WIDTH/8) == 0)
+      Serial.println();
+    */
+
+    SPItransfer(d);
+  }
+  //  Serial.println();
+  csHigh();
+  _timing_next.plane_us[EPDlocation ? 1 : 0] +=
+      traceSpan(EPDlocation ? EPD_TRACE_PLANE2 : EPD_TRACE_PLANE1, start);
+  return;
+}
+
+void Adafruit_EPD::writeSRAMFramebufferToEPD(uint16_t SRAM_buffer_addr,
+                                             uint32_t buffer_size,
+                                             uint8_t EPDlocation,
+                                             bool invertdata) {
+  (void)invertdata;
+  uint8_t c;
+  flushSRAMLine();
+  int64_t start = esp_timer_get_time();
+
+  int16_t known = SRAM_buffer_addr == buffer1_addr   ? _plane_fill[0]
+                  : SRAM_buffer_addr == buffer2_addr ? _plane_fill[1]
+                                                     : -1;
+  if (known >= 0 && !singleByteTxns) {
+    // cleared plane: nothing to fetch from the SRAM
+    writeRAMCommand(EPDlocation);
+    dcHigh();
+    writeRAMFillToEPD((uint8_t)known, buffer_size);
+    csHigh();
+    _timing_next.plane_us[EPDlocation ? 1 : 0] +=
+        traceSpan(EPDlocation ? EPD_TRACE_PLANE2 : EPD_TRACE_PLANE1, start);
+    return;
+  }
+
+  if (!singleByteTxns) {
+    // Bulk pass-through. The controller gets its RAM command first, then
+    // the SRAM alone fills the bounce buffer with the first chunk. With both
+    // selected, each full-duplex transfer hands one chunk to the EPD while
+    // the SRAM clocks the next one into the same buffer, so the plane
+    // crosses the bus once, a chunk per DMA transaction
+    uint32_t bounce[EPD_SRAM_BOUNCE_SIZE / 4]; // word aligned for DMA
+    uint8_t* chunk = (uint8_t*)bounce;
+    uint32_t len = min(buffer_size, (uint32_t)EPD_SRAM_BOUNCE_SIZE);
+
+    spi_dev->beginTransaction(); // hold the bus for the whole plane
+    writeRAMCommand(EPDlocation);
+    csHigh();
+
+    sram.csLow();
+    SPItransfer(MCPSRAM_READ);
+    SPItransfer(SRAM_buffer_addr >> 8);
+    SPItransfer(SRAM_buffer_addr & 0xFF);
+    memset(chunk, 0x00, len);
+    spi_dev->transfer(chunk, len);
+
+    // the controller keeps its RAM pointer while deselected
+    csLow();
+    dcHigh();
+    for (uint32_t sent = 0; sent < buffer_size; sent += len) {
+      // the last chunk is no longer than the one before, so the bytes
+      // read alongside it always cover it
+      len = min(buffer_size - sent, (uint32_t)EPD_SRAM_BOUNCE_SIZE);
+      spi_dev->transfer(chunk, len);
+    }
+    csHigh();
+    sram.csHigh();
+    spi_dev->endTransaction();
+    _timing_next.plane_us[EPDlocation ? 1 : 0] +=
+        traceSpan(EPDlocation ? EPD_TRACE_PLANE2 : EPD_TRACE_PLANE1, start);
+    return;
+  }
+
+  // use SRAM
+  sram.csLow();
+  _isInTransaction = true;
+  // send read command
+  SPItransfer(MCPSRAM_READ);
+  // send address
+  SPItransfer(SRAM_buffer_addr >> 8);
+  SPItransfer(SRAM_buffer_addr & 0xFF);
+
+  // first data byte from SRAM will be transfered in at the same time
+  // as the EPD command is transferred out
+  c = writeRAMCommand(EPDlocation);
+
+  dcHigh();
+  for (uint32_t i = 0; i < buffer_size; i++) {
+    c = SPItransfer(c);
+    /*
+    Serial.print("0x"); Serial.print((byte)c, HEX); Serial.print(", ");
+    if (i % 32 == 31) {
+      Serial.println();
+      Serial.print("$");
+      Serial.print(i, HEX);
+      Serial.print(": ");
+    }
+    */
+  }
+  csHigh();
+  sram.csHigh();
+  _isInTransaction = false;
+  _timing_next.plane_us[EPDlocation ? 1 : 0] +=
+      traceSpan(EPDlocation ? EPD_TRACE_PLANE2 : EPD_TRACE_PLANE1, start);
+}
+
+/**************************************************************************/
+/*!
+    @brief Transfer the data stored in the buffer(s) to the display
+*/
+/**************************************************************************/
+void Adafruit_EPD::display(bool sleep) {
+  // a synchronous refresh must not interleave with a background one
+  if (_refresh_task != NULL && xTaskGetCurrentTaskHandle() != _refresh_task) {
+    waitRefresh();
+  }
+  _upload_cancelled = false;
+
+  // the same frame is already on the glass: skip the upload and refresh
+  uint32_t hash = 0;
+  bool hashed = frameHash(hash);
+  if (hashed && _panel_hash_valid && hash == _panel_hash) {
+    ESP_LOGD(TAG_EPD, "Frame unchanged, refresh skipped");
+    _dirty_x1 = _dirty_x2 = 0;
+    framebufferFree();
+    if (sleep) {
+      powerDown();
+    }
+    return;
+  }
+
+#ifdef EPD_DEBUG
+  Serial.println("  Powering Up");
+#endif
+
+  // stageFrame() may have sent this frame already; only the refresh is left
+  bool staged = _staged_valid && hashed && hash == _staged_hash && !fastMode();
+  _staged_valid = false;
+
+  // with other panels on the bus, upload in turn; the turn passes on as
+  // soon as this panel starts refreshing
+  takeBusTurn();
+
+  _timing_next = {};
+  int64_t start = esp_timer_get_time();
+  powerUp();
+  _timing_next.power_up_us = traceSpan(EPD_TRACE_POWER_UP, start);
+
+  // everything drawn so far goes out with this frame
+  _dirty_x1 = _dirty_x2 = 0;
+
+  // the drawing task may switch waveforms once the framebuffer is free
+  bool fast = fastMode();
+  bool exact = _staged_exact;
+  if (staged) {
+    ESP_LOGD(TAG_EPD, "Frame staged, upload skipped");
+  } else {
+    _cancel_armed = true;
+    exact = writeFramebuffers();
+    _cancel_armed = false;
+  }
+
+  if (_upload_cancelled) {
+    // the glass still shows the old frame, but controller RAM holds part
+    // of the new one, which a later partial window would not overwrite.
+    // Marked before the framebuffer is handed back to the drawing task
+    ESP_LOGD(TAG_EPD, "Upload cancelled, refresh skipped");
+    invalidatePanelHash();
+    markDirty(0, 0, width(), height());
+  }
+
+  // planes are in controller RAM now; the framebuffer can be redrawn while
+  // the panel refreshes
+  framebufferFree();
+
+  if (_upload_cancelled) {
+    releaseBusTurn();
+    if (sleep) {
+      powerDown();
+    }
+    return;
+  }
+
+#ifdef EPD_DEBUG
+  Serial.println("  Update");
+#endif
+  start = esp_timer_get_time();
+  update();
+  // drivers that report EPD_POWER_REFRESH passed the turn on already
+  releaseBusTurn();
+  int64_t refresh_us = traceSpan(EPD_TRACE_REFRESH, start);
+  noteFrameRefresh(fast);
+  _panel_hash = hash;
+  _panel_hash_valid = hashed && exact;
+
+  start = esp_timer_get_time();
+  if (sleep) {
+#ifdef EPD_DEBUG
+    Serial.println("  Powering Down");
+#endif
+    powerDown();
+  }
+  finishTiming(refresh_us, sleep ? traceSpan(EPD_TRACE_POWER_DOWN, start) : 0);
+}
+
+/**************************************************************************/
+/*!
+    @brief Poll the cancel callback during display()'s upload; once it has
+    fired the rest of that display() call is skipped. Other writes (partial
+    windows, streamed planes) always finish
+    @returns true if the frame being uploaded is no longer wanted
+*/
+/**************************************************************************/
+bool Adafruit_EPD::uploadCancelled(void) {
+  if (!_cancel_armed) {
+    return false;
+  }
+  if (!_upload_cancelled && _cancel_cb != NULL && _cancel_cb(this, _cancel_cb_arg)) {
+    _upload_cancelled = true;
+  }
+  return _upload_cancelled;
+}
+
+/**************************************************************************/
+/*!
+    @brief Record a panel power state change and report it to the power
+    callback; repeating the current state does nothing. A refresh first
+    waits for the time setRefreshTime() asked for
+    @param state the new state
+*/
+/**************************************************************************/
+void Adafruit_EPD::setPowerState(epd_power_state_t state) {
+  if (state == _power_state) {
+    return;
+  }
+  _power_state = state;
+  if (state == EPD_POWER_REFRESH) {
+    // the panel only needs its BUSY pin until the refresh ends
+    releaseBusTurn();
+    int64_t wait_us = _refresh_at_us ? _refresh_at_us - esp_timer_get_time() : 0;
+    _refresh_at_us = 0;
+    if (wait_us > 0) {
+      delay(wait_us / 1000);
+    }
+  }
+  if (_power_cb != NULL) {
+    _power_cb(this, state, _power_cb_arg);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Wait for the upload turn shared with other panels, if any, then
+    take the upload lock
+*/
+/**************************************************************************/
+void Adafruit_EPD::takeBusTurn(void) {
+  if (_bus_turn != NULL && !_holds_turn) {
+    xSemaphoreTake(_bus_turn, portMAX_DELAY);
+    _holds_turn = true;
+  }
+  // after the wait for the turn, which shouldn't keep the clock up
+  if (_upload_lock != NULL && !_holds_upload_lock) {
+    esp_pm_lock_acquire(_upload_lock);
+    _holds_upload_lock = true;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Hand the upload turn to the next panel and release the upload
+    lock; does nothing if not held
+*/
+/**************************************************************************/
+void Adafruit_EPD::releaseBusTurn(void) {
+  if (_holds_turn) {
+    _holds_turn = false;
+    xSemaphoreGive(_bus_turn);
+  }
+  if (_holds_upload_lock) {
+    _holds_upload_lock = false;
+    esp_pm_lock_release(_upload_lock);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Switch the SPI device to the command or the plane data clock, see
+    setSPIClocks(); does nothing if it already runs at that rate. A data
+    clock the bus can't do is dropped for the command clock
+    @param data true for plane data, false for commands
+*/
+/**************************************************************************/
+void Adafruit_EPD::spiClock(bool data) {
+  uint32_t hz = data ? _spi_data_hz : _spi_command_hz;
+  if (spi_dev->getFrequency() == hz) {
+    return;
+  }
+  if (!spi_dev->setFrequency(hz) && data) {
+    ESP_LOGW(TAG_EPD, "Plane data clock %lu Hz refused, using %lu Hz",
+             (unsigned long)hz, (unsigned long)_spi_command_hz);
+    _spi_data_hz = _spi_command_hz;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Send everything through an ESP-IDF esp_lcd SPI panel IO instead
+    of the Adafruit_SPIDevice: commands and their arguments become
+    tx_param() calls and plane data queued tx_color() DMA transfers, with the
+    IO driving CS and DC, so every driver streams without SPI plumbing of its
+    own. Call after the bus is initialized and before begin(); on-chip RAM
+    only. The IO has one clock, so commands run at pclk_hz too and
+    setSPIClocks() no longer applies. The SPIClass burst lock isn't taken:
+    other devices on the bus interleave per transaction, and the
+    Adafruit_SPIDevice statistics stay at zero
+    @param host the SPI host the bus was initialized on
+    @param pclk_hz the IO's clock
+    @returns true if the IO was created, false to keep the SPI device
+*/
+/**************************************************************************/
+bool Adafruit_EPD::usePanelIO(spi_host_device_t host, uint32_t pclk_hz) {
+  if (_panel_io != NULL) {
+    return true;
+  }
+  if (use_sram) {
+    return false;
+  }
+  if (_io_done == NULL) {
+    _io_done = xSemaphoreCreateCounting(EPD_PANEL_IO_DEPTH, 0);
+    if (_io_done == NULL) {
+      return false;
+    }
+  }
+
+  esp_lcd_panel_io_spi_config_t config = {};
+  config.cs_gpio_num = _cs_pin;
+  config.dc_gpio_num = _dc_pin;
+  config.spi_mode = 0;
+  config.pclk_hz = pclk_hz;
+  config.trans_queue_depth = EPD_PANEL_IO_DEPTH;
+  config.on_color_trans_done = panelIODone;
+  config.user_ctx = this;
+  config.lcd_cmd_bits = 8;
+  config.lcd_param_bits = 8;
+  esp_err_t err = esp_lcd_new_panel_io_spi((esp_lcd_spi_bus_handle_t)host,
+                                           &config, &_panel_io);
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG_EPD, "No panel IO: %s", esp_err_to_name(err));
+    _panel_io = NULL;
+    return false;
+  }
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Color transfer done, from the SPI driver's ISR
+*/
+/**************************************************************************/
+bool IRAM_ATTR Adafruit_EPD::panelIODone(esp_lcd_panel_io_handle_t io,
+                                         esp_lcd_panel_io_event_data_t* edata,
+                                         void* ctx) {
+  (void)io;
+  (void)edata;
+  BaseType_t hpw = pdFALSE;
+  xSemaphoreGiveFromISR(((Adafruit_EPD*)ctx)->_io_done, &hpw);
+  return hpw == pdTRUE;
+}
+
+/**************************************************************************/
+/*!
+    @brief Send a command and its arguments through the panel IO, blocking
+    @param cmd the command, -1 to send only arguments
+    @param buf the arguments, may be on the stack
+    @param len number of argument bytes
+*/
+/**************************************************************************/
+void Adafruit_EPD::panelIOParam(int cmd, const uint8_t* buf, size_t len) {
+  // tx_param() drains the color queue itself; this keeps the count with it
+  panelIOWait();
+  esp_lcd_panel_io_tx_param(_panel_io, cmd, buf, len);
+}
+
+/**************************************************************************/
+/*!
+    @brief Queue plane data on the panel IO. Blocks only while
+    EPD_PANEL_IO_DEPTH transfers are in flight
+    @param buf the data, DMA capable, unchanged until panelIOWait()
+    @param len number of bytes
+*/
+/**************************************************************************/
+void Adafruit_EPD::panelIOColor(const uint8_t* buf, size_t len) {
+  if (_io_pending == EPD_PANEL_IO_DEPTH) {
+    xSemaphoreTake(_io_done, portMAX_DELAY);
+    _io_pending--;
+  }
+  if (esp_lcd_panel_io_tx_color(_panel_io, -1, buf, len) == ESP_OK) {
+    _io_pending++;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Send the complement of plane data through the panel IO, staged a
+    chunk at a time on the stack
+    @param buf the data
+    @param len number of bytes
+*/
+/**************************************************************************/
+void Adafruit_EPD::panelIOColorInverted(const uint8_t* buf, size_t len) {
+  WORD_ALIGNED_ATTR uint8_t chunk[EPD_SRAM_BOUNCE_SIZE];
+  for (size_t sent = 0; sent < len; sent += sizeof(chunk)) {
+    size_t n = min(len - sent, sizeof(chunk));
+    for (size_t i = 0; i < n; i++) {
+      chunk[i] = ~buf[sent + i];
+    }
+    panelIOColor(chunk, n);
+    panelIOWait();
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Wait until every queued panel IO color transfer is done; does
+    nothing without a panel IO
+*/
+/**************************************************************************/
+void Adafruit_EPD::panelIOWait(void) {
+  while (_io_pending > 0) {
+    xSemaphoreTake(_io_done, portMAX_DELAY);
+    _io_pending--;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Wait out a refresh the driver's update() has just started: on the
+    BUSY pin, timing it for takeRefreshDuration(), or without one for the
+    setRefreshDelay() time of its kind, else the panel's refresh_delay
+    @param mode the kind of refresh running
+    @param start_ms millis() when the refresh command was sent
+*/
+/**************************************************************************/
+void Adafruit_EPD::waitRefreshEnd(epd_refresh_t mode, uint32_t start_ms) {
+  busy_wait(); // the driver's own wait, which knows the pin's polarity
+  uint32_t elapsed = millis() - start_ms;
+  if (_busy_pin >= 0) {
+    // a wait that ran into busy_timeout_ms measured nothing
+    if (elapsed < busy_timeout_ms) {
+      _refresh_duration_ms = elapsed;
+      _refresh_duration_mode = mode;
+    }
+  } else if (_refresh_delay_ms[mode] == 0) {
+    delay(default_refresh_delay);
+  } else if (_refresh_delay_ms[mode] > elapsed) {
+    delay(_refresh_delay_ms[mode] - elapsed);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Report a span that ends now to the trace callback
+    @param span what ran
+    @param start_us esp_timer time it started
+    @returns its duration, in microseconds
+*/
+/**************************************************************************/
+int64_t Adafruit_EPD::traceSpan(epd_trace_t span, int64_t start_us) {
+  int64_t end_us = esp_timer_get_time();
+  if (_trace_cb != NULL) {
+    _trace_cb(this, span, start_us, end_us, _trace_cb_arg);
+  }
+  return end_us - start_us;
+}
+
+/**************************************************************************/
+/*!
+    @brief Publish the timings of the refresh just finished for getTiming()
+    @param refresh_us time spent in update()
+    @param power_down_us time spent in powerDown(), 0 if not powered down
+*/
+/**************************************************************************/
+void Adafruit_EPD::finishTiming(int64_t refresh_us, int64_t power_down_us) {
+  _timing_next.refresh_us = refresh_us;
+  _timing_next.power_down_us = power_down_us;
+  _timing_next.count = _timing.count + 1;
+  _timing = _timing_next;
+}
+
+/**************************************************************************/
+/*!
+    @brief Send both framebuffer planes to controller RAM, for display()
+    @returns true if the refresh will show the frame exactly (false for
+    approximations such as a fast mono waveform), so it can be skipped when
+    the same frame is displayed again
+*/
+/**************************************************************************/
+bool Adafruit_EPD::writeFramebuffers(void) {
+#ifdef EPD_DEBUG
+  Serial.println("  Set RAM address");
+#endif
+
+  // Set X & Y ram counters
+  setRAMAddress(0, 0);
+
+  if (use_sram) {
+#ifdef EPD_DEBUG
+    Serial.println("  Write SRAM buff to EPD");
+#endif
+    writeSRAMFramebufferToEPD(buffer1_addr, buffer1_size, 0);
+  } else {
+#ifdef EPD_DEBUG
+    Serial.println("  Write RAM buff to EPD");
+#endif
+    writeRAMFramebufferToEPD(buffer1, buffer1_size, 0);
+  }
+
+  if (buffer2_size != 0) {
+    // oh there's another buffer eh?
+    delay(2);
+
+    // Set X & Y ram counters
+    setRAMAddress(0, 0);
+
+    if (use_sram) {
+      writeSRAMFramebufferToEPD(buffer2_addr, buffer2_size, 1);
+    } else if (_color_dropped) {
+      writeColorFill();
+    } else {
+      writeRAMFramebufferToEPD(buffer2, buffer2_size, 1);
+    }
+  }
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Send the constant plane that stands in for buffer2 after
+    setColorPlane(false), from the shared fill chunk
+*/
+/**************************************************************************/
+void Adafruit_EPD::writeColorFill(void) {
+  int64_t start = esp_timer_get_time();
+  writeRAMCommand(1);
+  dcHigh();
+  // while banding, buffer2_size is the band's
+  writeRAMFillToEPD(_color_fill,
+                    _band_lines != 0 ? _band_saved_size[1] : buffer2_size);
+  csHigh();
+  _timing_next.plane_us[1] += traceSpan(EPD_TRACE_PLANE2, start);
+}
+
+/**************************************************************************/
+/*!
+    @brief Start streaming one plane straight into controller RAM, without
+    going through the framebuffer. Follow with writePlaneChunk() calls
+    totalling the plane's size, endPlaneWrite(), and once every plane is
+    written, displayStreamed(). The bytes go out verbatim, so they must be in
+    the layout display() would send (see getBufferSize() and
+    getDataEntryMode()). The bus is released between chunks, so the data can
+    be read from a card on the same SPI bus.
+    @param index controller RAM to write: 0 for buffer1's plane, 1 for
+    buffer2's
+    @returns false for an invalid index
+*/
+/**************************************************************************/
+bool Adafruit_EPD::beginPlaneWrite(uint8_t index) {
+  if (index > 1) {
+    return false;
+  }
+  _staged_valid = false;
+  if (_plane_writing) {
+    endPlaneWrite();
+  }
+
+  if (!_stream_powered) {
+    // the controller RAM must not change under a background refresh
+    if (_refresh_task != NULL &&
+        xTaskGetCurrentTaskHandle() != _refresh_task) {
+      waitRefresh();
+    }
+    _timing_next = {};
+    int64_t start = esp_timer_get_time();
+    powerUp();
+    _timing_next.power_up_us = traceSpan(EPD_TRACE_POWER_UP, start);
+    _stream_powered = true;
+  } else {
+    delay(2);
+  }
+
+  setRAMAddress(0, 0);
+  writeRAMCommand(index);
+  csHigh();
+  _plane_writing = true;
+  _stream_plane = index;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Send the next bytes of the plane opened by beginPlaneWrite()
+    @param buf plane bytes, in framebuffer order
+    @param len number of bytes
+*/
+/**************************************************************************/
+void Adafruit_EPD::writePlaneChunk(const uint8_t* buf, uint32_t len) {
+  if (!_plane_writing || len == 0) {
+    return;
+  }
+
+  // the controller keeps its RAM pointer across chip select pulses, so
+  // each chunk is its own transaction
+  int64_t start = esp_timer_get_time();
+  spiClock(true);
+  csLow();
+  dcHigh();
+  if (_panel_io != NULL) {
+    // the caller reuses buf on return
+    panelIOColor(buf, len);
+    panelIOWait();
+  } else if (!singleByteTxns) {
+    spi_dev->write(buf, len);
+  } else {
+    for (uint32_t i = 0; i < len; i++) {
+      SPItransfer(buf[i]);
+    }
+  }
+  csHigh();
+  _timing_next.plane_us[_stream_plane] +=
+      traceSpan(_stream_plane ? EPD_TRACE_PLANE2 : EPD_TRACE_PLANE1, start);
+}
+
+/**************************************************************************/
+/*!
+    @brief Finish the plane opened by beginPlaneWrite()
+*/
+/**************************************************************************/
+void Adafruit_EPD::endPlaneWrite(void) {
+  _plane_writing = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief Refresh the panel from the planes streamed since the first
+    beginPlaneWrite(). The framebuffer is left as it was, so the panel no
+    longer matches it; the next display() always refreshes.
+    @param sleep power the panel down afterwards
+*/
+/**************************************************************************/
+void Adafruit_EPD::displayStreamed(bool sleep) {
+  if (_plane_writing) {
+    endPlaneWrite();
+  }
+  if (!_stream_powered) {
+    return;
+  }
+  _stream_powered = false;
+
+  int64_t start = esp_timer_get_time();
+  update();
+  int64_t refresh_us = traceSpan(EPD_TRACE_REFRESH, start);
+  noteFrameRefresh(fastMode());
+  invalidatePanelHash();
+
+  start = esp_timer_get_time();
+  if (sleep) {
+    powerDown();
+  }
+  finishTiming(refresh_us, sleep ? traceSpan(EPD_TRACE_POWER_DOWN, start) : 0);
+}
+
+/**************************************************************************/
+/*!
+    @brief Draw the next frame in bands of plane lines, for panels whose
+    frame doesn't fit in RAM. Until the last nextBand(), buffer1 and buffer2
+    hold only one band: draw the whole frame as usual (pixels outside the
+    band are dropped), call nextBand(), and repeat while it returns true.
+    Each band is streamed to the controller as it is finished, a pass per
+    plane, and the last call refreshes. A line is the unit of the plane
+    layout: a column of the native panel with THINKINK_STANDARD, a row
+    with THINKINK_UC8179. Drawing goes through drawPixel() meanwhile.
+    A framebuffer only partly allocated (a plane the constructor couldn't
+    get) is freed, since nothing can use it.
+    @code
+    epd.beginBands(4096);
+    do {
+      drawFrame();
+    } while (epd.nextBand());
+    @endcode
+    @param band_size bytes per plane a band may take; at least one line
+    is used
+    @returns false with external SRAM, a driver with its own plane layout,
+    or no memory for the band
+*/
+/**************************************************************************/
+bool Adafruit_EPD::beginBands(uint32_t band_size) {
+  if (use_sram || !spanWrites || _band_lines != 0) {
+    return false;
+  }
+  uint16_t total, line_bytes;
+  if (_data_entry_mode == THINKINK_UC8179) {
+    if (WIDTH % 8 != 0) {
+      return false;
+    }
+    total = HEIGHT;
+    line_bytes = WIDTH / 8;
+  } else {
+    total = WIDTH;
+    line_bytes = (HEIGHT + 7) / 8;
+  }
+  if (buffer1_size != (uint32_t)total * line_bytes) {
+    return false;
+  }
+  bool two_planes = buffer2_size != 0 && !_color_dropped;
+  if (_own_buffers && buffer1 != NULL && two_planes && buffer2 == NULL) {
+    freeFramebuffer(buffer1);
+    buffer1 = NULL;
+    black_buffer = color_buffer = NULL;
+  }
+
+  uint16_t lines = max((uint32_t)1, min(band_size / line_bytes, (uint32_t)total));
+  band_size = (uint32_t)lines * line_bytes;
+  uint8_t* band1 = allocFramebuffer(band_size);
+  uint8_t* band2 = two_planes ? allocFramebuffer(band_size) : band1;
+  if (band1 == NULL || band2 == NULL) {
+    freeFramebuffer(band1);
+    if (two_planes) {
+      freeFramebuffer(band2);
+    }
+    return false;
+  }
+
+  // a displayAsync() upload may still read the frame planes
+  waitFramebufferFree();
+  _band_saved[0] = buffer1;
+  _band_saved[1] = buffer2;
+  _band_saved[2] = black_buffer;
+  _band_saved[3] = color_buffer;
+  _band_saved_size[0] = buffer1_size;
+  _band_saved_size[1] = buffer2_size;
+  _band_span_writes = spanWrites;
+  buffer1 = band1;
+  buffer2 = two_planes ? band2 : buffer2;
+  buffer1_size = band_size;
+  buffer2_size = two_planes ? band_size : 0;
+  black_buffer = _black_index == 1 && two_planes ? band2 : band1;
+  color_buffer = _color_index == 1 && two_planes ? band2 : band1;
+  spanWrites = false;
+
+  _band_lines = lines;
+  _band_total = total;
+  _band_line_bytes = line_bytes;
+  _band_first = 0;
+  _band_plane = 0;
+  beginPlaneWrite(0);
+  clearBuffer();
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Send the band just drawn and move on to the next, see
+    beginBands(). After the last band of a plane the passes start again
+    for the next plane; after the last one the panel refreshes
+    (displayStreamed()) and the frame planes are back.
+    @param sleep power the panel down after the refresh
+    @returns true if there is another band to draw, false once refreshed
+*/
+/**************************************************************************/
+bool Adafruit_EPD::nextBand(bool sleep) {
+  if (_band_lines == 0) {
+    return false;
+  }
+  uint16_t lines = min(_band_lines, (uint16_t)(_band_total - _band_first));
+  writePlaneChunk(_band_plane ? buffer2 : buffer1,
+                  (uint32_t)lines * _band_line_bytes);
+
+  _band_first += _band_lines;
+  if (_band_first >= _band_total) {
+    endPlaneWrite();
+    if (_band_plane == 0 && _color_dropped && _band_saved_size[1] != 0) {
+      // the released color plane goes out as its constant bytes
+      beginPlaneWrite(1);
+      writeColorFill();
+      endPlaneWrite();
+    }
+    if (_band_plane == 1 || buffer2_size == 0) {
+      endBands();
+      displayStreamed(sleep);
+      return false;
+    }
+    _band_plane = 1;
+    _band_first = 0;
+    beginPlaneWrite(1);
+  }
+  clearBuffer();
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Abandon a banded frame: the frame planes are back and the panel
+    is powered down unrefreshed, keeping what it showed
+*/
+/**************************************************************************/
+void Adafruit_EPD::cancelBands(void) {
+  if (_band_lines == 0) {
+    return;
+  }
+  endBands();
+  if (_plane_writing) {
+    endPlaneWrite();
+  }
+  if (_stream_powered) {
+    _stream_powered = false;
+    powerDown();
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Free the band planes and put the frame planes back
+*/
+/**************************************************************************/
+void Adafruit_EPD::endBands(void) {
+  bool two_planes = buffer2_size != 0;
+  freeFramebuffer(buffer1);
+  if (two_planes) {
+    freeFramebuffer(buffer2);
+  }
+  buffer1 = _band_saved[0];
+  buffer2 = _band_saved[1];
+  buffer1_size = _band_saved_size[0];
+  buffer2_size = _band_saved_size[1];
+  black_buffer = _band_saved[2];
+  color_buffer = _band_saved[3];
+  spanWrites = _band_span_writes;
+  _band_lines = 0;
+  // the frame planes weren't drawn into
+  _plane_fill[0] = _plane_fill[1] = -1;
+}
+
+/**************************************************************************/
+/*!
+    @brief Refresh only a window of the panel from the framebuffer. The
+    window is moved into controller space for the rotation, widened to whole
+    framebuffer bytes, and its rows go out in bulk; the driver only sets up
+    the controller's RAM window and runs the refresh (beginWindow(),
+    endWindow()). On drivers without windowed updates the whole frame is
+    sent instead
+    @param rect the window, in the current rotation
+    @param mode EPD_REFRESH_PARTIAL for the partial waveform tables, where
+    the panel has them, for the duration; otherwise the tables in force are
+    used
+*/
+/**************************************************************************/
+void Adafruit_EPD::displayWindow(const epd_rect_t& rect, epd_refresh_t mode) {
+  // a window refresh must not interleave with a background one
+  if (_refresh_task != NULL && xTaskGetCurrentTaskHandle() != _refresh_task) {
+    waitRefresh();
+  }
+  // the window overwrites part of a staged frame
+  _staged_valid = false;
+
+  uint16_t x1 = rect.x1, y1 = rect.y1, x2 = rect.x2, y2 = rect.y2;
+  if (x1 > x2)
+    EPD_swap(x1, x2);
+  if (y1 > y2)
+    EPD_swap(y1, y2);
+  x2 = min(x2, (uint16_t)width());
+  y2 = min(y2, (uint16_t)height());
+  if (x1 >= x2 || y1 >= y2) {
+    return;
+  }
+
+  // Move the window into controller space: x along the gates (HEIGHT, one
+  // framebuffer byte per 8 pixels), y along the sources (WIDTH). The window
+  // is half-open, so mirroring is "size - edge" and the edges then swap
+  switch (getRotation()) {
+    case 0:
+      EPD_swap(x1, y1);
+      EPD_swap(x2, y2);
+      y1 = WIDTH - y1;
+      y2 = WIDTH - y2;
+      break;
+    case 1:
+      break;
+    case 2:
+      EPD_swap(x1, y1);
+      EPD_swap(x2, y2);
+      x1 = HEIGHT - x1;
+      x2 = HEIGHT - x2;
+      break;
+    case 3:
+      y1 = WIDTH - y1;
+      y2 = WIDTH - y2;
+      x1 = HEIGHT - x1;
+      x2 = HEIGHT - x2;
+  }
+  if (x1 > x2)
+    EPD_swap(x1, x2);
+  if (y1 > y2)
+    EPD_swap(y1, y2);
+
+  // x1 and x2 must be on byte boundaries
+  uint16_t stride = (HEIGHT + 7) / 8; // framebuffer bytes per source line
+  x1 -= x1 % 8;                       // round down
+  x2 = (x2 + 7) & ~0b111;             // round up
+  x2 = min(x2, (uint16_t)(stride * 8));
+  epd_rect_t ram = {x1, y1, x2, y2};
+
+  const uint8_t* init_code_backup = _epd_init_code;
+  const uint8_t* lut_code_backup = _epd_lut_code;
+  // panels without partial tables keep their own, with the driver's
+  // partial update sequence
+  if (mode == EPD_REFRESH_PARTIAL &&
+      (_epd_partial_init_code != NULL || _epd_partial_lut_code != NULL)) {
+    _epd_init_code = _epd_partial_init_code;
+    _epd_lut_code = _epd_partial_lut_code;
+  }
+
+  if (use_sram) {
+    flushSRAMLine();
+  }
+  uint8_t planes = beginWindow(ram, mode);
+  if (planes == 0) {
+    _epd_init_code = init_code_backup;
+    _epd_lut_code = lut_code_backup;
+    display();
+    return;
+  }
+
+  // the glass no longer matches any full frame
+  invalidatePanelHash();
+
+  bool sent = false;
+  for (uint8_t plane = 0; plane < 2; plane++) {
+    if (!(planes & (plane ? EPD_WINDOW_PLANE1 : EPD_WINDOW_PLANE0)) ||
+        (plane ? buffer2_size : buffer1_size) == 0 ||
+        (plane && _color_dropped)) {
+      continue;
+    }
+    if (sent) {
+      delay(2);
+    }
+    setRAMAddress(x1 / 8, y1);
+    writeWindowPlane(plane, ram, planes & EPD_WINDOW_INVERT);
+    sent = true;
+  }
+
+  endWindow(mode);
+  partialsSinceLastFullUpdate++;
+
+  _epd_init_code = init_code_backup;
+  _epd_lut_code = lut_code_backup;
+}
+
+/**************************************************************************/
+/*!
+    @brief Refresh only a window of the panel with the partial waveform,
+    see displayWindow()
+    @param x1 left edge, in the current rotation
+    @param y1 top edge, in the current rotation
+    @param x2 right edge (exclusive)
+    @param y2 bottom edge (exclusive)
+*/
+/**************************************************************************/
+void Adafruit_EPD::displayPartial(uint16_t x1, uint16_t y1, uint16_t x2,
+                                  uint16_t y2) {
+  displayWindow({x1, y1, x2, y2}, EPD_REFRESH_PARTIAL);
+}
+
+/**************************************************************************/
+/*!
+    @brief Send the rows of one plane's window for displayWindow(). A row
+    is contiguous in the framebuffer, so each goes out as one bulk write,
+    and a window as wide as the panel as a single one
+    @param plane 0 for buffer1, 1 for buffer2
+    @param ram the window in controller space, x on byte boundaries
+    @param invert complement each byte on the way out
+*/
+/**************************************************************************/
+void Adafruit_EPD::writeWindowPlane(uint8_t plane, const epd_rect_t& ram,
+                                    bool invert) {
+  int64_t start = esp_timer_get_time();
+  uint16_t stride = (HEIGHT + 7) / 8;
+  uint16_t bytes = (ram.x2 - ram.x1) / 8;
+  uint16_t rows = ram.y2 - ram.y1;
+  uint32_t first = (uint32_t)ram.y1 * stride + ram.x1 / 8;
+  if (bytes == stride) {
+    bytes *= rows; // whole lines: one span
+    rows = 1;
+  }
+
+  writeRAMCommand(plane);
+  dcHigh();
+  if (use_sram || singleByteTxns) {
+    uint8_t* buffer = plane ? buffer2 : buffer1;
+    uint16_t addr = plane ? buffer2_addr : buffer1_addr;
+    for (uint16_t row = 0; row < rows; row++) {
+      uint32_t i = first + (uint32_t)row * stride;
+      for (uint32_t b = 0; b < bytes; b++) {
+        uint8_t d = use_sram ? sram.read8(addr + i + b) : buffer[i + b];
+        SPItransfer(invert ? ~d : d);
+      }
+    }
+  } else {
+    uint8_t* buffer = (plane ? buffer2 : buffer1) + first;
+    spiClock(true);
+    for (uint16_t row = 0; row < rows; row++, buffer += stride) {
+      if (_panel_io != NULL) {
+        if (invert) {
+          panelIOColorInverted(buffer, bytes);
+        } else {
+          panelIOColor(buffer, bytes);
+        }
+      } else if (invert) {
+        spi_dev->writeInverted(buffer, bytes);
+      } else {
+        spi_dev->write(buffer, bytes);
+      }
+    }
+    panelIOWait();
+  }
+  csHigh();
+  _timing_next.plane_us[plane] +=
+      traceSpan(plane ? EPD_TRACE_PLANE2 : EPD_TRACE_PLANE1, start);
+}
+
+/**************************************************************************/
+/*!
+    @brief Send whatever was drawn since the last refresh: a partial update
+    of its bounding box when that is small and there haven't been too many
+    partials in a row (see setPartialPolicy()), a full refresh otherwise.
+    Does nothing when nothing was drawn.
+    @param sleep power the panel down after a full refresh (a partial one
+    always does)
+*/
+/**************************************************************************/
+void Adafruit_EPD::displayDirty(bool sleep) {
+  if (!isDirty()) {
+    return;
+  }
+  if (chooseRefresh(false) != EPD_REFRESH_PARTIAL) {
+    display(sleep);
+    return;
+  }
+
+  _ghost_area_percent =
+      min((uint32_t)_ghost_area_percent + dirtyAreaPercent(), (uint32_t)0xFFFF);
+  uint16_t x1 = _dirty_x1, y1 = _dirty_y1, x2 = _dirty_x2, y2 = _dirty_y2;
+  _dirty_x1 = _dirty_x2 = 0;
+  invalidatePanelHash();
+  displayPartial(x1, y1, x2, y2);
+}
+
+/**************************************************************************/
+/*!
+    @brief Pick the refresh for the next update, keeping latency low until
+    the ghosting partial and fast refreshes leave behind reaches the budget
+    (see setGhostPolicy() and setAmbientTemperature()); then a full one.
+    Within budget a small dirty box gets a partial update (see
+    setPartialPolicy()) and anything else the fast waveform, if allowed.
+    @param fast_ok the caller would take the fast waveform, e.g. while
+    frames follow each other quickly. If setFastMode(true) then fails,
+    refresh in full
+    @returns the refresh to use
+*/
+/**************************************************************************/
+epd_refresh_t Adafruit_EPD::chooseRefresh(bool fast_ok) {
+  uint8_t max_count = _partial_max_count;
+  uint16_t max_area = _ghost_max_area_percent;
+  if (_ambient_celsius != EPD_TEMPERATURE_UNKNOWN) {
+    if (_ambient_celsius < EPD_FREEZING_CELSIUS) {
+      return EPD_REFRESH_FULL;
+    }
+    if (_ambient_celsius < EPD_COLD_CELSIUS) {
+      max_count /= 2;
+      max_area /= 2;
+    }
+  }
+  if (partialsSinceLastFullUpdate >= max_count ||
+      _ghost_area_percent >= max_area) {
+    return EPD_REFRESH_FULL;
+  }
+  if (isDirty() && _dirty_rotation == getRotation() &&
+      dirtyAreaPercent() <= _partial_max_area_percent) {
+    return EPD_REFRESH_PARTIAL;
+  }
+  if (_ambient_celsius != EPD_TEMPERATURE_UNKNOWN &&
+      (_ambient_celsius < _fast_min_celsius ||
+       _ambient_celsius > _fast_max_celsius)) {
+    return EPD_REFRESH_FULL;
+  }
+  return fast_ok ? EPD_REFRESH_FAST : EPD_REFRESH_FULL;
+}
+
+/**************************************************************************/
+/*!
+    @brief Area of the dirty box, rounded up
+    @returns percent of the screen
+*/
+/**************************************************************************/
+uint16_t Adafruit_EPD::dirtyAreaPercent(void) {
+  uint32_t area =
+      (uint32_t)(_dirty_x2 - _dirty_x1) * (uint32_t)(_dirty_y2 - _dirty_y1);
+  uint32_t screen = (uint32_t)width() * (uint32_t)height();
+  return (uint16_t)((area * 100 + screen - 1) / screen);
+}
+
+/**************************************************************************/
+/*!
+    @brief Account for a whole-frame refresh: the normal waveform clears
+    the ghosting, a fast one adds a screen of it
+    @param fast the frame was shown with the fast waveform
+*/
+/**************************************************************************/
+void Adafruit_EPD::noteFrameRefresh(bool fast) {
+  if (!fast) {
+    partialsSinceLastFullUpdate = 0;
+    _ghost_area_percent = 0;
+    return;
+  }
+  if (partialsSinceLastFullUpdate < 0xFF) {
+    partialsSinceLastFullUpdate++;
+  }
+  _ghost_area_percent = min(_ghost_area_percent + 100, 0xFFFF);
+}
+
+/**************************************************************************/
+/*!
+    @brief CRC-32 of both on-chip planes, as display() would send them
+    @param hash receives the CRC
+    @returns false when the frame lives in external SRAM (not hashed)
+*/
+/**************************************************************************/
+bool Adafruit_EPD::frameHash(uint32_t& hash) {
+  if (use_sram || buffer1 == NULL) {
+    return false;
+  }
+  hash = esp_rom_crc32_le(0, buffer1, buffer1_size);
+  if (buffer2_size != 0 && buffer2 != NULL && buffer2 != buffer1) {
+    hash = esp_rom_crc32_le(hash, buffer2, buffer2_size);
+  }
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Get the hash of the frame the last full refresh put on the glass,
+    e.g. to keep it in RTC memory across deep sleep
+    @param hash receives the hash
+    @returns false when the panel contents are unknown
+*/
+/**************************************************************************/
+bool Adafruit_EPD::getPanelHash(uint32_t& hash) {
+  hash = _panel_hash;
+  return _panel_hash_valid;
+}
+
+/**************************************************************************/
+/*!
+    @brief Tell the driver which frame the glass still shows (from
+    getPanelHash() before a deep sleep), so display() of the same frame is
+    skipped
+    @param hash the hash getPanelHash() returned
+*/
+/**************************************************************************/
+void Adafruit_EPD::setPanelHash(uint32_t hash) {
+  _panel_hash = hash;
+  _panel_hash_valid = true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Forget what the glass shows, so the next display() always
+    refreshes (e.g. to clear ghosting)
+*/
+/**************************************************************************/
+void Adafruit_EPD::invalidatePanelHash(void) {
+  _panel_hash_valid = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief Grow the dirty box, e.g. after writing a getBuffer() plane by hand.
+    Drawing through drawPixel() and the span writers marks it already;
+    subclasses that override drawPixel() must call this themselves.
+    @param x the x position of the top left corner
+    @param y the y position of the top left corner
+    @param w the width
+    @param h the height
+*/
+/**************************************************************************/
+void Adafruit_EPD::markDirty(int16_t x, int16_t y, int16_t w, int16_t h) {
+  if (w <= 0 || h <= 0) {
+    return;
+  }
+  _plane_fill[0] = _plane_fill[1] = -1;
+  if (!isDirty()) {
+    _dirty_rotation = getRotation();
+    _dirty_x1 = x;
+    _dirty_y1 = y;
+    _dirty_x2 = x + w;
+    _dirty_y2 = y + h;
+    return;
+  }
+  if (_dirty_rotation != getRotation()) {
+    // drawn in two rotations: no single window covers both
+    _dirty_rotation = getRotation();
+    _dirty_x1 = _dirty_y1 = 0;
+    _dirty_x2 = width();
+    _dirty_y2 = height();
+    return;
+  }
+  _dirty_x1 = min(_dirty_x1, x);
+  _dirty_y1 = min(_dirty_y1, y);
+  _dirty_x2 = max(_dirty_x2, (int16_t)(x + w));
+  _dirty_y2 = max(_dirty_y2, (int16_t)(y + h));
+}
+
+/**************************************************************************/
+/*!
+    @brief Background task that runs display() for displayAsync()
+    @param arg the Adafruit_EPD instance
+*/
+/**************************************************************************/
+void Adafruit_EPD::refreshTask(void* arg) {
+  Adafruit_EPD* epd = (Adafruit_EPD*)arg;
+
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    epd->display(epd->_refresh_sleep);
+    epd->framebufferFree(); // in case display() returned before its upload
+
+    // latch the callbacks before signalling, a waiter may queue the next one
+    refresh_callback_t cb = epd->_refresh_cb;
+    void* cb_arg = epd->_refresh_cb_arg;
+    portENTER_CRITICAL(&epd->_waiter_mux);
+    refresh_callback_t waiter = epd->_waiter_cb;
+    void* waiter_arg = epd->_waiter_arg;
+    epd->_waiter_cb = NULL;
+    epd->_refresh_running = false;
+    portEXIT_CRITICAL(&epd->_waiter_mux);
+    xEventGroupSetBits(epd->_refresh_events,
+                       EPD_EVT_FRAMEBUFFER_FREE | EPD_EVT_REFRESH_DONE);
+    if (cb != NULL) {
+      cb(epd, cb_arg);
+    }
+    if (waiter != NULL) {
+      waiter(epd, waiter_arg);
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Lazily create the event group and refresh task
+    @returns true if the background refresh path is available
+*/
+/**************************************************************************/
+bool Adafruit_EPD::startRefreshTask(void) {
+  if (_refresh_task != NULL) {
+    return true;
+  }
+  if (_refresh_events == NULL) {
+    _refresh_events = xEventGroupCreate();
+    if (_refresh_events == NULL) {
+      return false;
+    }
+    xEventGroupSetBits(_refresh_events,
+                       EPD_EVT_FRAMEBUFFER_FREE | EPD_EVT_REFRESH_DONE);
+  }
+  // same priority as the caller so the upload isn't starved by it
+  if (xTaskCreatePinnedToCore(refreshTask, "epd_refresh", 4096, this,
+                              uxTaskPriorityGet(NULL), &_refresh_task,
+                              _refresh_core) != pdPASS) {
+    _refresh_task = NULL;
+    return false;
+  }
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Start display() on a background task and return immediately. The
+    framebuffer must not be drawn to until EPD_EVT_FRAMEBUFFER_FREE is set
+    (see waitFramebufferFree()); after that it can be redrawn while the panel
+    is still refreshing. No other panel command may be issued until the
+    refresh is done. A refresh already in progress is waited for first.
+    @param sleep passed through to display()
+    @param cb optional callback, run on the refresh task when done
+    @param cb_arg argument for cb
+    @returns true if the refresh was started in the background, false if the
+    task could not be created and the refresh ran synchronously instead
+*/
+/**************************************************************************/
+bool Adafruit_EPD::displayAsync(bool sleep, refresh_callback_t cb,
+                                void* cb_arg) {
+  if (!startRefreshTask()) {
+    display(sleep);
+    if (cb != NULL) {
+      cb(this, cb_arg);
+    }
+    return false;
+  }
+
+  waitRefresh();
+
+  _refresh_sleep = sleep;
+  _refresh_cb = cb;
+  _refresh_cb_arg = cb_arg;
+  _upload_cancelled = false; // wasCancelled() is about this frame from now on
+  xEventGroupClearBits(_refresh_events,
+                       EPD_EVT_FRAMEBUFFER_FREE | EPD_EVT_REFRESH_DONE);
+  portENTER_CRITICAL(&_waiter_mux);
+  _refresh_running = true;
+  _upload_running = true;
+  portEXIT_CRITICAL(&_waiter_mux);
+  xTaskNotifyGive(_refresh_task);
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Have a callback run once when the displayAsync() refresh in
+    progress is done, instead of blocking in waitRefresh(). It runs on the
+    refresh task, after the displayAsync() callback, and must not block.
+    There is one slot: a second registration replaces the first.
+    @param cb the callback
+    @param arg argument for cb
+    @returns false if no refresh is running; cb is then not registered and
+    never runs
+*/
+/**************************************************************************/
+bool Adafruit_EPD::whenRefreshed(refresh_callback_t cb, void* arg) {
+  portENTER_CRITICAL(&_waiter_mux);
+  bool running = _refresh_running;
+  if (running) {
+    _waiter_cb = cb;
+    _waiter_arg = arg;
+  }
+  portEXIT_CRITICAL(&_waiter_mux);
+  return running;
+}
+
+/**************************************************************************/
+/*!
+    @brief Check whether a displayAsync() refresh is still running
+    @returns true while the background refresh has not completed
+*/
+/**************************************************************************/
+bool Adafruit_EPD::isRefreshing(void) {
+  if (_refresh_events == NULL) {
+    return false;
+  }
+  return (xEventGroupGetBits(_refresh_events) & EPD_EVT_REFRESH_DONE) == 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief Block until the background refresh completes
+    @param timeout how long to wait, in ticks
+    @returns true if no refresh is running anymore
+*/
+/**************************************************************************/
+bool Adafruit_EPD::waitRefresh(TickType_t timeout) {
+  if (_refresh_events == NULL) {
+    return true;
+  }
+  EventBits_t bits = xEventGroupWaitBits(
+      _refresh_events, EPD_EVT_REFRESH_DONE, pdFALSE, pdTRUE, timeout);
+  return (bits & EPD_EVT_REFRESH_DONE) != 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief Block until the background refresh has uploaded the framebuffer,
+    after which it is safe to draw the next frame
+    @param timeout how long to wait, in ticks
+    @returns true if the framebuffer may be modified
+*/
+/**************************************************************************/
+bool Adafruit_EPD::waitFramebufferFree(TickType_t timeout) {
+  if (_refresh_events == NULL) {
+    return true;
+  }
+  EventBits_t bits = xEventGroupWaitBits(
+      _refresh_events, EPD_EVT_FRAMEBUFFER_FREE, pdFALSE, pdTRUE, timeout);
+  return (bits & EPD_EVT_FRAMEBUFFER_FREE) != 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief Take the panel off the SPI bus for an idle stretch, so the bus
+    can be freed (SPIClass::end()). The next command or frame brings it
+    back (Adafruit_SPIDevice::suspend())
+    @returns false while a refresh is running, or with no SPI device
+*/
+/**************************************************************************/
+bool Adafruit_EPD::suspendBus(void) {
+  if (spi_dev == NULL || isRefreshing()) {
+    return false;
+  }
+  return spi_dev->suspend();
+}
+
+/**************************************************************************/
+/*!
+    @brief Get direct access to an on-chip framebuffer plane, e.g. to load a
+    pre-packed image straight into it. The caller may write anywhere, so the
+    whole screen is marked dirty.
+    @param index 0 for the primary buffer, 1 for the secondary
+    @returns the plane, or NULL when using external SRAM or no such plane
+*/
+/**************************************************************************/
+uint8_t* Adafruit_EPD::getBuffer(uint8_t index) {
+  if (use_sram) {
+    return NULL;
+  }
+  markDirty(0, 0, width(), height());
+  if (index == 0) {
+    return buffer1;
+  }
+  if (index == 1) {
+    return buffer2_size != 0 ? buffer2 : NULL;
+  }
+  return NULL;
+}
+
+/**************************************************************************/
+/*!
+    @brief Get the size of a framebuffer plane
+    @param index 0 for the primary buffer, 1 for the secondary
+    @returns the plane size in bytes, 0 if there is no such plane
+*/
+/**************************************************************************/
+uint32_t Adafruit_EPD::getBufferSize(uint8_t index) {
+  if (index == 0) {
+    return buffer1_size;
+  }
+  if (index == 1) {
+    return buffer2_size;
+  }
+  return 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief Allocate a framebuffer plane in the memory setFramebufferMemory()
+    chose. Internal planes are word aligned and DMA-capable, so the SPI
+    driver sends them without a bounce buffer of its own; PSRAM planes are
+    cache-line aligned and fall back to internal RAM when PSRAM is missing
+    or full. Drivers allocate their planes with this; use it for planes
+    passed to swapBuffers() too.
+    @param size plane size in bytes
+    @returns the plane, or NULL when out of memory. Free with
+    freeFramebuffer()
+*/
+/**************************************************************************/
+uint8_t* Adafruit_EPD::allocFramebuffer(uint32_t size) {
+  if (_framebuffer_memory == EPD_MEMORY_SPIRAM) {
+    void* plane = heap_caps_aligned_alloc(EPD_SPIRAM_ALIGN, size,
+                                          MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (plane != NULL) {
+      return (uint8_t*)plane;
+    }
+  }
+  return (uint8_t*)heap_caps_aligned_alloc(EPD_FRAMEBUFFER_ALIGN, size,
+                                           MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+}
+
+/**************************************************************************/
+/*!
+    @brief Free a plane from allocFramebuffer()
+    @param buffer the plane, may be NULL
+*/
+/**************************************************************************/
+void Adafruit_EPD::freeFramebuffer(uint8_t* buffer) {
+  heap_caps_free(buffer);
+}
+
+/**************************************************************************/
+/*!
+    @brief Replace the on-chip framebuffer planes with caller-owned ones,
+    e.g. static arrays sized by the panel geometry, so the display keeps
+    no heap for its frame. The planes the driver allocated are freed, and
+    the caller's are never freed by the display. They should be
+    DMA-capable and EPD_FRAMEBUFFER_ALIGN aligned (DMA_ATTR
+    WORD_ALIGNED_ATTR statics are) or SPI uploads go through a bounce
+    buffer. Waits for any displayAsync() upload first; the contents are
+    kept as they are, so clear or redraw before the next display().
+    @param plane1 buffer of getBufferSize(0) bytes
+    @param plane2 buffer of getBufferSize(1) bytes. Ignored when the
+    display has no separate secondary plane
+    @returns false when using external SRAM or a plane is NULL
+*/
+/**************************************************************************/
+bool Adafruit_EPD::setFramebuffers(uint8_t* plane1, uint8_t* plane2) {
+  bool two_planes = getBuffer(1) != NULL && buffer2 != buffer1;
+  if (use_sram || buffer1 == NULL || plane1 == NULL ||
+      (two_planes && plane2 == NULL)) {
+    return false;
+  }
+
+  waitFramebufferFree();
+  markDirty(0, 0, width(), height());
+
+  uint8_t* old1 = buffer1;
+  uint8_t* old2 = buffer2;
+  buffer1 = plane1;
+  buffer2 = two_planes ? plane2 : (old2 == old1 ? plane1 : old2);
+  if (black_buffer == old1) {
+    black_buffer = buffer1;
+  } else if (black_buffer == old2) {
+    black_buffer = buffer2;
+  }
+  if (color_buffer == old1) {
+    color_buffer = buffer1;
+  } else if (color_buffer == old2) {
+    color_buffer = buffer2;
+  }
+
+  if (_own_buffers) {
+    if (two_planes) {
+      freeFramebuffer(old2);
+    }
+    freeFramebuffer(old1);
+  }
+  _own_buffers = false;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Release the color plane when no color draws into it, or get it
+    back. Without it, color and black share buffer1 (drawing as on a mono
+    panel), and display() sends the plane's constant bytes from a shared
+    fill chunk instead of the RAM, halving both the frame's memory and
+    what is read out for the upload. Windowed updates leave the
+    controller's color RAM as the last full frame filled it.
+    applyPanel() (ThinkInkPanel::begin()) releases it for THINKINK_MONO.
+    A caller-owned plane (setFramebuffers()) is only stopped being used.
+    @param keep false to release the plane, true to allocate it again
+    @returns false if released: on external SRAM, without a separate
+    color plane in buffer2, or while some color still sets a color bit;
+    if kept: when there is no memory, or the planes are caller-owned
+*/
+/**************************************************************************/
+bool Adafruit_EPD::setColorPlane(bool keep) {
+  if (keep) {
+    if (!_color_dropped) {
+      return true;
+    }
+    if (!_own_buffers || _band_lines != 0) {
+      return false;
+    }
+    uint8_t* plane = allocFramebuffer(buffer2_size);
+    if (plane == NULL) {
+      return false;
+    }
+    memset(plane, _color_fill, buffer2_size);
+    buffer2 = plane;
+    if (_black_index == 1) {
+      black_buffer = buffer2;
+    }
+    if (_color_index == 1) {
+      color_buffer = buffer2;
+    }
+    _color_dropped = false;
+    markDirty(0, 0, width(), height());
+    return true;
+  }
+
+  if (_color_dropped) {
+    return true;
   }
-
-  if ((color_bit && colorInverted) || (!color_bit && !colorInverted)) {
-    *color_pBuf &= ~(1 << (7 - bit_idx % 8));
-  } else {
-    *color_pBuf |= (1 << (7 - bit_idx % 8));
+  if (use_sram || _band_lines != 0 || buffer2_size == 0 || buffer2 == NULL ||
+      buffer2 == buffer1 || color_buffer != buffer2 ||
+      black_buffer != buffer1) {
+    return false;
   }
-
-  if ((black_bit && blackInverted) || (!black_bit && !blackInverted)) {
-    *black_pBuf &= ~(1 << (7 - bit_idx % 8));
-  } else {
-    *black_pBuf |= (1 << (7 - bit_idx % 8));
+  // the plane must hold the same bit whatever is drawn
+  for (uint8_t c = 1; c < EPD_NUM_COLORS; c++) {
+    if ((layer_colors[c] & 0x2) != (layer_colors[EPD_WHITE] & 0x2)) {
+      return false;
+    }
   }
 
-  if (use_sram) {
-    sram.write8(colorbuffer_addr + addr, *color_pBuf);
-    sram.write8(blackbuffer_addr + addr, *black_pBuf);
+  waitFramebufferFree();
+  _color_fill =
+      (((layer_colors[EPD_WHITE] & 0x2) != 0) != colorInverted) ? 0xFF : 0x00;
+  if (_own_buffers) {
+    freeFramebuffer(buffer2);
   }
+  buffer2 = NULL;
+  color_buffer = buffer1;
+  _color_dropped = true;
+  markDirty(0, 0, width(), height());
+  return true;
 }
 
-void Adafruit_EPD::writeRAMFramebufferToEPD(uint8_t* framebuffer,
-                                            uint32_t framebuffer_size,
-                                            uint8_t EPDlocation,
-                                            bool invertdata) {
-  // write image
-  writeRAMCommand(EPDlocation);
-  dcHigh();
-  // Serial.printf("Writing from RAM location %04x: \n", &framebuffer);
-
-  for (uint32_t i = 0; i < framebuffer_size; i++) {
-    uint8_t d = framebuffer[i];
-    if (invertdata)
-      d = ~d;
+/**************************************************************************/
+/*!
+    @brief Check the planes swapBuffers() and swapBuffersAsync() are given
+    @returns false when using external SRAM or a plane is NULL
+*/
+/**************************************************************************/
+bool Adafruit_EPD::canSwapBuffers(uint8_t* plane1, uint8_t* plane2) {
+  bool two_planes = getBuffer(1) != NULL && buffer2 != buffer1;
+  return !use_sram && buffer1 != NULL && plane1 != NULL &&
+         (!two_planes || plane2 != NULL);
+}
 
-    /*
-    Serial.printf("%02x", d);
-    if ((i+1) % (WIDTH/8) == 0)
-      Serial.println();
-    */
+/**************************************************************************/
+/*!
+    @brief Put a plane set in the framebuffer, with the black/color aliases
+    following it, and hand back the set it replaces. No upload may be
+    reading the framebuffer
+    @param plane1 the new primary; receives the old one
+    @param plane2 the new secondary; receives the old one. Left alone when
+    the display has no separate secondary plane
+*/
+/**************************************************************************/
+void Adafruit_EPD::exchangeBuffers(uint8_t*& plane1, uint8_t*& plane2) {
+  bool two_planes = getBuffer(1) != NULL && buffer2 != buffer1;
+  markDirty(0, 0, width(), height());
+
+  uint8_t* old1 = buffer1;
+  uint8_t* old2 = buffer2;
+  buffer1 = plane1;
+  plane1 = old1;
+  if (two_planes) {
+    buffer2 = plane2;
+    plane2 = old2;
+  } else if (old2 == old1) {
+    buffer2 = buffer1;
+  }
 
-    SPItransfer(d);
+  if (black_buffer == old1) {
+    black_buffer = buffer1;
+  } else if (black_buffer == old2) {
+    black_buffer = buffer2;
+  }
+  if (color_buffer == old1) {
+    color_buffer = buffer1;
+  } else if (color_buffer == old2) {
+    color_buffer = buffer2;
   }
-  //  Serial.println();
-  csHigh();
-  return;
 }
 
-void Adafruit_EPD::writeSRAMFramebufferToEPD(uint16_t SRAM_buffer_addr,
-                                             uint32_t buffer_size,
-                                             uint8_t EPDlocation,
-                                             bool invertdata) {
-  (void)invertdata;
-  uint8_t c;
-  // use SRAM
-  sram.csLow();
-  _isInTransaction = true;
-  // send read command
-  SPItransfer(MCPSRAM_READ);
-  // send address
-  SPItransfer(SRAM_buffer_addr >> 8);
-  SPItransfer(SRAM_buffer_addr & 0xFF);
+/**************************************************************************/
+/*!
+    @brief Exchange the on-chip framebuffer planes with caller-owned ones,
+    e.g. to show a frame decoded ahead of time without copying it. Waits for
+    any displayAsync() upload first. The black/color plane assignment made
+    by setBlackBuffer()/setColorBuffer() follows the swap.
+    @param plane1 buffer of getBufferSize(0) bytes; receives the old primary
+    @param plane2 buffer of getBufferSize(1) bytes; receives the old
+    secondary. Ignored when the display has no separate secondary plane
+    @returns false when using external SRAM or a plane is NULL
+*/
+/**************************************************************************/
+bool Adafruit_EPD::swapBuffers(uint8_t*& plane1, uint8_t*& plane2) {
+  if (!canSwapBuffers(plane1, plane2)) {
+    return false;
+  }
+  waitFramebufferFree();
+  exchangeBuffers(plane1, plane2);
+  return true;
+}
 
-  // first data byte from SRAM will be transfered in at the same time
-  // as the EPD command is transferred out
-  c = writeRAMCommand(EPDlocation);
+/**************************************************************************/
+/*!
+    @brief swapBuffers() without waiting for a displayAsync() upload: the
+    set becomes the framebuffer as soon as no upload reads the current one,
+    and the set it replaces goes to a callback then, so the caller never
+    blocks and nothing is copied. While an upload runs, the swap happens on
+    the refresh task just before EPD_EVT_FRAMEBUFFER_FREE is set, so
+    waitFramebufferFree() returns with the new set in place; with no upload
+    running it happens at once, and released runs before this returns.
+    Either way the set handed back is no longer read, and may be drawn
+    into, cached or freed. Ownership moves with the planes as for
+    swapBuffers(): the driver frees what is in the framebuffer when it is
+    destroyed, unless setFramebuffers() made the planes caller-owned.
+    There is one slot: with a swap already waiting, this waits for the
+    upload first. Don't draw into the framebuffer until it is free.
+    @param plane1 buffer of getBufferSize(0) bytes
+    @param plane2 buffer of getBufferSize(1) bytes. Ignored when the
+    display has no separate secondary plane, and passed back as given
+    @param released gets the old set; must not block, may be NULL
+    @param arg argument for released
+    @returns false when using external SRAM or a plane is NULL; released
+    then never runs
+*/
+/**************************************************************************/
+bool Adafruit_EPD::swapBuffersAsync(uint8_t* plane1, uint8_t* plane2,
+                                    planes_callback_t released, void* arg) {
+  if (!canSwapBuffers(plane1, plane2)) {
+    return false;
+  }
+  portENTER_CRITICAL(&_waiter_mux);
+  bool busy = _swap_pending;
+  portEXIT_CRITICAL(&_waiter_mux);
+  if (busy) {
+    waitFramebufferFree();
+  }
 
-  dcHigh();
-  for (uint32_t i = 0; i < buffer_size; i++) {
-    c = SPItransfer(c);
-    /*
-    Serial.print("0x"); Serial.print((byte)c, HEX); Serial.print(", ");
-    if (i % 32 == 31) {
-      Serial.println();
-      Serial.print("$");
-      Serial.print(i, HEX);
-      Serial.print(": ");
+  portENTER_CRITICAL(&_waiter_mux);
+  bool queued = _upload_running;
+  if (queued) {
+    _swap_planes[0] = plane1;
+    _swap_planes[1] = plane2;
+    _swap_cb = released;
+    _swap_arg = arg;
+    _swap_pending = true;
+  }
+  portEXIT_CRITICAL(&_waiter_mux);
+  if (!queued) {
+    exchangeBuffers(plane1, plane2);
+    if (released != NULL) {
+      released(this, plane1, plane2, arg);
     }
-    */
   }
-  csHigh();
-  sram.csHigh();
-  _isInTransaction = false;
+  return true;
 }
 
 /**************************************************************************/
 /*!
-    @brief Transfer the data stored in the buffer(s) to the display
+    @brief The upload no longer reads the framebuffer: swap in the set
+    swapBuffersAsync() left waiting, hand back the old one and set
+    EPD_EVT_FRAMEBUFFER_FREE. Harmless when called again
 */
 /**************************************************************************/
-void Adafruit_EPD::display(bool sleep) {
-#ifdef EPD_DEBUG
-  Serial.println("  Powering Up");
-#endif
-
-  powerUp();
-
-#ifdef EPD_DEBUG
-  Serial.println("  Set RAM address");
-#endif
-
-  // Set X & Y ram counters
-  setRAMAddress(0, 0);
-
-  if (use_sram) {
-#ifdef EPD_DEBUG
-    Serial.println("  Write SRAM buff to EPD");
-#endif
-    writeSRAMFramebufferToEPD(buffer1_addr, buffer1_size, 0);
-  } else {
-#ifdef EPD_DEBUG
-    Serial.println("  Write RAM buff to EPD");
-#endif
-    writeRAMFramebufferToEPD(buffer1, buffer1_size, 0);
+void Adafruit_EPD::framebufferFree(void) {
+  portENTER_CRITICAL(&_waiter_mux);
+  bool pending = _swap_pending;
+  uint8_t* plane1 = _swap_planes[0];
+  uint8_t* plane2 = _swap_planes[1];
+  planes_callback_t released = _swap_cb;
+  void* arg = _swap_arg;
+  _swap_pending = false;
+  _upload_running = false;
+  portEXIT_CRITICAL(&_waiter_mux);
+
+  if (pending) {
+    exchangeBuffers(plane1, plane2);
+    if (released != NULL) {
+      released(this, plane1, plane2, arg);
+    }
   }
+  if (_refresh_events != NULL) {
+    xEventGroupSetBits(_refresh_events, EPD_EVT_FRAMEBUFFER_FREE);
+  }
+}
 
-  if (buffer2_size != 0) {
-    // oh there's another buffer eh?
-    delay(2);
+/**************************************************************************/
+/*!
+    @brief Send a frame to controller RAM ahead of its refresh, e.g. the
+    next slide while the current one is shown. The framebuffer is left as
+    it is; once it holds the same frame (swapBuffers() with these planes),
+    display() finds it staged and only refreshes. Anything else written to
+    controller RAM in between drops the staged frame, and display() then
+    uploads as usual. The panel is powered down again if it was off.
+    @param plane1 buffer of getBufferSize(0) bytes, as for swapBuffers()
+    @param plane2 buffer of getBufferSize(1) bytes, as for swapBuffers()
+    @returns false if the driver loses controller RAM on power down
+    (canStageFrames()), with external SRAM, in fast mode, while streaming
+    or banding, or for NULL planes
+*/
+/**************************************************************************/
+bool Adafruit_EPD::stageFrame(uint8_t* plane1, uint8_t* plane2) {
+  if (!canStageFrames() || use_sram || fastMode() || _stream_powered ||
+      _plane_writing || _band_lines != 0) {
+    return false;
+  }
+  // controller RAM must not change under a background refresh
+  if (_refresh_task != NULL && xTaskGetCurrentTaskHandle() != _refresh_task) {
+    waitRefresh();
+  }
 
-    // Set X & Y ram counters
-    setRAMAddress(0, 0);
+  // borrow the framebuffer pointers for the upload; the dirty area belongs
+  // to the frame being drawn and is put back with them
+  int16_t dirty_x1 = _dirty_x1, dirty_y1 = _dirty_y1;
+  int16_t dirty_x2 = _dirty_x2, dirty_y2 = _dirty_y2;
+  if (!swapBuffers(plane1, plane2)) {
+    return false;
+  }
 
-    if (use_sram) {
-      writeSRAMFramebufferToEPD(buffer2_addr, buffer2_size, 1);
-    } else {
-      writeRAMFramebufferToEPD(buffer2, buffer2_size, 1);
+  uint32_t hash = 0;
+  bool hashed = frameHash(hash);
+  bool shown = hashed && _panel_hash_valid && hash == _panel_hash;
+  if (hashed && !shown && !(_staged_valid && hash == _staged_hash)) {
+    bool was_off = _power_state == EPD_POWER_OFF;
+    takeBusTurn();
+    powerUp();
+    _staged_valid = false;
+    _staged_exact = writeFramebuffers();
+    releaseBusTurn();
+    if (was_off) {
+      powerDown();
     }
+    _staged_hash = hash;
+    _staged_valid = true;
   }
 
-#ifdef EPD_DEBUG
-  Serial.println("  Update");
-#endif
-  update();
-  partialsSinceLastFullUpdate = 0;
-
-  if (sleep) {
-#ifdef EPD_DEBUG
-    Serial.println("  Powering Down");
-#endif
-    powerDown();
-  }
+  swapBuffers(plane1, plane2);
+  _dirty_x1 = dirty_x1;
+  _dirty_y1 = dirty_y1;
+  _dirty_x2 = dirty_x2;
+  _dirty_y2 = dirty_y2;
+  return shown || (_staged_valid && hash == _staged_hash);
 }
 
 /**************************************************************************/
@@ -431,6 +3504,10 @@ void Adafruit_EPD::display(bool sleep) {
 */
 /**************************************************************************/
 void Adafruit_EPD::setBlackBuffer(int8_t index, bool inverted) {
+  if (use_sram) {
+    flushSRAMLine();
+    dropSRAMLine();
+  }
   if (index == 0) {
     if (use_sram) {
       blackbuffer_addr = buffer1_addr;
@@ -442,9 +3519,10 @@ void Adafruit_EPD::setBlackBuffer(int8_t index, bool inverted) {
     if (use_sram) {
       blackbuffer_addr = buffer2_addr;
     } else {
-      black_buffer = buffer2;
+      black_buffer = _color_dropped ? buffer1 : buffer2;
     }
   }
+  _black_index = index;
   blackInverted = inverted;
 }
 
@@ -456,6 +3534,10 @@ void Adafruit_EPD::setBlackBuffer(int8_t index, bool inverted) {
 */
 /**************************************************************************/
 void Adafruit_EPD::setColorBuffer(int8_t index, bool inverted) {
+  if (use_sram) {
+    flushSRAMLine();
+    dropSRAMLine();
+  }
   if (index == 0) {
     if (use_sram) {
       colorbuffer_addr = buffer1_addr;
@@ -467,19 +3549,51 @@ void Adafruit_EPD::setColorBuffer(int8_t index, bool inverted) {
     if (use_sram) {
       colorbuffer_addr = buffer2_addr;
     } else {
-      color_buffer = buffer2;
+      color_buffer = _color_dropped ? buffer1 : buffer2;
     }
   }
+  _color_index = index;
   colorInverted = inverted;
 }
 
+/**************************************************************************/
+/*!
+    @brief Apply a panel's plane assignment, color mapping, timing and, if
+    the table has them, init and LUT sequences. Call after the driver's
+    begin(), which sets its own defaults
+    @param panel the panel table
+    @param mode the ink mode to record for getMode()
+*/
+/**************************************************************************/
+void Adafruit_EPD::applyPanel(const epd_panel_t& panel, thinkinkmode_t mode) {
+  // the table's plane assignment is made against both planes
+  setColorPlane(true);
+  setBlackBuffer(panel.black_buffer, panel.black_inverted);
+  setColorBuffer(panel.color_buffer, panel.color_inverted);
+  memcpy(layer_colors, panel.layer_colors, sizeof(layer_colors));
+  default_refresh_delay = panel.refresh_delay;
+  if (panel.init_code != NULL) {
+    _epd_init_code = panel.init_code;
+  }
+  if (panel.lut_code != NULL) {
+    _epd_lut_code = panel.lut_code;
+  }
+  inkmode = mode;
+  if (mode == THINKINK_MONO) {
+    // refused when the mode still draws into the color plane
+    setColorPlane(false);
+  }
+}
+
 /**************************************************************************/
 /*!
     @brief clear all data buffers
 */
 /**************************************************************************/
 void Adafruit_EPD::clearBuffer() {
+  markDirty(0, 0, width(), height());
   if (use_sram) {
+    dropSRAMLine();
     if (blackInverted) {
       sram.erase(blackbuffer_addr, buffer1_size, 0xFF);
     } else {
@@ -506,6 +3620,33 @@ void Adafruit_EPD::clearBuffer() {
       }
     }
   }
+  setPlaneFills(blackInverted ? 0xFF : 0x00, colorInverted ? 0xFF : 0x00);
+}
+
+/**************************************************************************/
+/*!
+    @brief Record that the black and color planes were just filled with a
+    constant, so display() sends them from the fill chunk without reading
+    (or, with external SRAM, fetching) the framebuffer
+    @param black byte the black plane was filled with
+    @param color byte the color plane was filled with
+*/
+/**************************************************************************/
+void Adafruit_EPD::setPlaneFills(uint8_t black, uint8_t color) {
+  for (int i = 0; i < 2; i++) {
+    bool is_black, is_color;
+    if (use_sram) {
+      uint16_t addr = i == 0 ? buffer1_addr : buffer2_addr;
+      is_black = blackbuffer_addr == addr;
+      is_color = colorbuffer_addr == addr;
+    } else {
+      uint8_t* buffer = i == 0 ? buffer1 : buffer2;
+      is_black = buffer != NULL && black_buffer == buffer;
+      is_color = buffer != NULL && color_buffer == buffer;
+    }
+    // a shared plane holds the color fill, written last
+    _plane_fill[i] = is_color ? color : is_black ? black : -1;
+  }
 }
 
 /**************************************************************************/
@@ -515,26 +3656,49 @@ void Adafruit_EPD::clearBuffer() {
 /**************************************************************************/
 void Adafruit_EPD::clearDisplay() {
   clearBuffer();
+  invalidatePanelHash();
   display();
   delay(100);
+  invalidatePanelHash();
   display();
 }
 
 /**************************************************************************/
 /*!
- */
+    @brief send a table of commands and their arguments to the display. The
+    SPI bus is held for each run of commands so the short transactions skip
+    bus arbitration; it is released around 0xFF wait entries so other devices
+    on the bus are not starved during the delay. When the SPI driver drives
+    DC, each run is queued as one chain of transactions from a staged copy
+    of the table, see queueCommandList()
+    @param init_code the command table, terminated by 0xFE
+*/
 /**************************************************************************/
 void Adafruit_EPD::EPD_commandList(const uint8_t* init_code) {
+  if (_driver_pins && !singleByteTxns && _panel_io == NULL) {
+    const command_chain_t* chain = stageCommandList(init_code);
+    if (chain != NULL) {
+      queueCommandList(*chain);
+      return;
+    }
+  }
+
   uint8_t buf[250];
 
+  bool held = spi_dev->acquireBus();
+
   while (init_code[0] != 0xFE) {
     uint8_t cmd = init_code[0];
     init_code++;
     uint8_t num_args = init_code[0];
     init_code++;
     if (cmd == 0xFF) {
+      if (held) {
+        spi_dev->releaseBus();
+      }
       busy_wait();
       delay(num_args);
+      held = spi_dev->acquireBus();
       continue;
     }
     if (num_args > sizeof(buf)) {
@@ -549,6 +3713,113 @@ void Adafruit_EPD::EPD_commandList(const uint8_t* init_code) {
     }
     EPD_command(cmd, buf, num_args);
   }
+
+  if (held) {
+    spi_dev->releaseBus();
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Find or make the staged copy of a command table. Blocks of up to
+    4 arguments travel inside their transaction; longer ones (LUTs) are
+    copied word aligned into DMA memory once, so the table can stay in flash
+    @param table the command table, terminated by 0xFE
+    @returns the staged table, NULL if DMA memory ran out
+*/
+/**************************************************************************/
+const Adafruit_EPD::command_chain_t*
+Adafruit_EPD::stageCommandList(const uint8_t* table) {
+  for (uint8_t i = 0; i < EPD_COMMAND_CHAINS; i++) {
+    if (_cmd_chains[i].table == table) {
+      return &_cmd_chains[i];
+    }
+  }
+
+  uint32_t size = 0;
+  for (const uint8_t* p = table; p[0] != 0xFE; p += 2) {
+    if (p[0] != 0xFF) {
+      if (p[1] > 4) {
+        size += (p[1] + 3) & ~3u;
+      }
+      p += p[1];
+    }
+  }
+  uint8_t* args = NULL;
+  if (size != 0) {
+    args = (uint8_t*)heap_caps_aligned_alloc(4, size,
+                                             MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+    if (args == NULL) {
+      return NULL;
+    }
+    uint8_t* out = args;
+    for (const uint8_t* p = table; p[0] != 0xFE; p += 2) {
+      if (p[0] != 0xFF) {
+        if (p[1] > 4) {
+          memcpy(out, p + 2, p[1]);
+          out += (p[1] + 3) & ~3u;
+        }
+        p += p[1];
+      }
+    }
+  }
+
+  command_chain_t& chain = _cmd_chains[_cmd_chain_next];
+  _cmd_chain_next = (_cmd_chain_next + 1) % EPD_COMMAND_CHAINS;
+  heap_caps_free(chain.args);
+  chain.table = table;
+  chain.args = args;
+  return &chain;
+}
+
+/**************************************************************************/
+/*!
+    @brief Send a staged command table as queued transactions, the DC level
+    riding on each one, so a run of commands goes out back to back. A 0xFF
+    entry drains the queue and releases the bus for the BUSY wait and delay
+    @param chain the table from stageCommandList()
+*/
+/**************************************************************************/
+void Adafruit_EPD::queueCommandList(const command_chain_t& chain) {
+  const uint8_t* p = chain.table;
+  const uint8_t* args = chain.args;
+
+  spiClock(false);
+  bool held = spi_dev->acquireBus();
+  while (p[0] != 0xFE) {
+    uint8_t cmd = p[0];
+    uint8_t num_args = p[1];
+    p += 2;
+    if (cmd == 0xFF) {
+      if (held) {
+        spi_dev->releaseBus(); // drains the queue first
+      } else {
+        spi_dev->waitAsync();
+      }
+      busy_wait();
+      delay(num_args);
+      held = spi_dev->acquireBus();
+      continue;
+    }
+    spi_dev->setDC(false);
+    spi_dev->writeAsync(&cmd, 1);
+    if (num_args != 0) {
+      spi_dev->setDC(true);
+      if (num_args > 4) {
+        spi_dev->writeAsync(args, num_args);
+        args += (num_args + 3) & ~3u;
+      } else {
+        spi_dev->writeAsync(p, num_args);
+      }
+    }
+    p += num_args;
+  }
+
+  if (held) {
+    spi_dev->releaseBus();
+  } else {
+    spi_dev->waitAsync();
+  }
 }
 
 /**************************************************************************/
@@ -560,6 +3831,10 @@ void Adafruit_EPD::EPD_commandList(const uint8_t* init_code) {
 */
 /**************************************************************************/
 void Adafruit_EPD::EPD_command(uint8_t c, const uint8_t* buf, uint16_t len) {
+  if (_panel_io != NULL) {
+    panelIOParam(c, buf, len);
+    return;
+  }
   EPD_command(c, false);
   EPD_data(buf, len);
 }
@@ -576,6 +3851,7 @@ void Adafruit_EPD::EPD_command(uint8_t c, const uint8_t* buf, uint16_t len) {
 uint8_t Adafruit_EPD::EPD_command(uint8_t c, bool end) {
   // SPI
   csHigh();
+  spiClock(false);
   dcLow();
   csLow();
 
@@ -602,9 +3878,21 @@ uint8_t Adafruit_EPD::EPD_command(uint8_t c, bool end) {
 void Adafruit_EPD::EPD_data(const uint8_t* buf, uint16_t len) {
   // SPI
   dcHigh();
+  if (_panel_io != NULL) {
+    panelIOParam(-1, buf, len);
+    csHigh();
+    return;
+  }
 
 #ifdef EPD_DEBUG
   Serial.print("\tData: ");
+#else
+  if (!singleByteTxns) {
+    // argument bytes go out as one short polled transaction
+    spi_dev->write(buf, len);
+    csHigh();
+    return;
+  }
 #endif
   for (uint16_t i = 0; i < len; i++) {
     SPItransfer(buf[i]);
@@ -644,6 +3932,28 @@ void Adafruit_EPD::EPD_data(uint8_t data) {
   csHigh();
 }
 
+/**************************************************************************/
+/*!
+    @brief read data the controller returns for the command just sent, on
+    its bidirectional data line (MOSI). Needs the SPI driver to own CS and
+    DC, so not with an SRAM or a panel IO
+    @param buf where to put the data
+    @param len bytes to read, up to 4
+    @returns false if the bytes could not be read
+*/
+/**************************************************************************/
+bool Adafruit_EPD::EPD_readData(uint8_t* buf, uint16_t len) {
+  if (_panel_io != NULL || !_driver_pins) {
+    return false;
+  }
+  csHigh();
+  dcHigh();
+  csLow();
+  bool ok = spi_dev->readBidirectional(buf, len);
+  csHigh();
+  return ok;
+}
+
 /**************************************************************************/
 /*!
     @brief transfer a single byte over SPI.
@@ -654,6 +3964,16 @@ void Adafruit_EPD::EPD_data(uint8_t data) {
 uint8_t Adafruit_EPD::SPItransfer(uint8_t d) {
   // Serial.print("-> 0x"); Serial.println((byte)d, HEX);
 
+  if (_panel_io != NULL) {
+    // a command, or a one byte argument after dcHigh(); nothing is read back
+    if (_io_data) {
+      panelIOParam(-1, &d, 1);
+    } else {
+      panelIOParam(d, NULL, 0);
+    }
+    return 0;
+  }
+
   if (singleByteTxns) {
     uint8_t b;
     csLow();
@@ -674,7 +3994,9 @@ void Adafruit_EPD::csHigh() {
 #ifdef BUSIO_USE_FAST_PINIO
   *csPort = *csPort | csPinMask;
 #else
-  digitalWrite(_cs_pin, HIGH);
+  if (!_driver_pins) {
+    digitalWrite(_cs_pin, HIGH);
+  }
 #endif
 
   if (_isInTransaction) {
@@ -697,7 +4019,9 @@ void Adafruit_EPD::csLow() {
 #ifdef BUSIO_USE_FAST_PINIO
   *csPort = *csPort & ~csPinMask;
 #else
-  digitalWrite(_cs_pin, LOW);
+  if (!_driver_pins) {
+    digitalWrite(_cs_pin, LOW);
+  }
 #endif
 }
 
@@ -710,7 +4034,13 @@ void Adafruit_EPD::dcHigh() {
 #ifdef BUSIO_USE_FAST_PINIO
   *dcPort = *dcPort | dcPinMask;
 #else
-  digitalWrite(_dc_pin, HIGH);
+  // the device stamps the level on each transaction (and its tap sees it)
+  spi_dev->setDC(true);
+  if (_driver_pins) {
+    _io_data = true;
+  } else {
+    digitalWrite(_dc_pin, HIGH);
+  }
 #endif
 }
 
@@ -723,6 +4053,12 @@ void Adafruit_EPD::dcLow() {
 #ifdef BUSIO_USE_FAST_PINIO
   *dcPort = *dcPort & ~dcPinMask;
 #else
-  digitalWrite(_dc_pin, LOW);
+  // the device stamps the level on each transaction (and its tap sees it)
+  spi_dev->setDC(false);
+  if (_driver_pins) {
+    _io_data = false;
+  } else {
+    digitalWrite(_dc_pin, LOW);
+  }
 #endif
 }
@@ -23,27 +23,40 @@
 // #define EPD_DEBUG
 
 #define RAMBUFSIZE 64 ///< size of the ram buffer
+#define EPD_GLYPH_CACHE_SIZE 24 ///< pre-rasterized glyphs kept by write()
+#define EPD_SRAM_LINE_SIZE 64   ///< bytes per plane drawPixel() caches of SRAM
+#define EPD_SRAM_BOUNCE_SIZE 512 ///< bytes per SRAM-to-EPD pass-through chunk
+#define EPD_UPLOAD_CHUNK_SIZE 4096 ///< bytes sent between upload cancel checks
+#define EPD_FILL_CHUNK_SIZE 1024 ///< constant chunk uniform planes are sent from
+#define EPD_BITMAP_CHUNK 64 ///< pixels drawRGBBitmap() quantizes per span
+#define EPD_SPI_DEFAULT_HZ 4000000 ///< SPI clock until setSPIClocks()
+#define EPD_PANEL_IO_DEPTH 4 ///< queued esp_lcd color transfers, see usePanelIO()
+#define EPD_COMMAND_CHAINS 2 ///< command tables kept staged, e.g. init and LUT
+#define EPD_FRAMEBUFFER_ALIGN 4 ///< framebuffer alignment the SPI DMA needs
+#define EPD_SPIRAM_ALIGN 64 ///< PSRAM framebuffer alignment, one cache line
+
+#define EPD_GHOST_AREA_PERCENT 500 ///< default screens of ghosting refreshes, in %
+#define EPD_COLD_CELSIUS 10 ///< below this the ghosting budget is halved
+#define EPD_FREEZING_CELSIUS 0 ///< below this every refresh is a full one
+#define EPD_HOT_CELSIUS 40 ///< above this the fast waveform isn't used
+#define EPD_TEMPERATURE_UNKNOWN INT8_MIN ///< no ambient temperature given
+
+#define EPD_EVT_FRAMEBUFFER_FREE (1 << 0) ///< planes uploaded, safe to draw
+#define EPD_EVT_REFRESH_DONE (1 << 1)     ///< panel refresh finished
 
 #include <Adafruit_GFX.h>
 #include "../../Adafruit_BusIO_ESPIDF/Adafruit_SPIDevice.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "freertos/task.h"
+#include "esp_pm.h"
+#include "esp_lcd_panel_io.h"
 
 #include "Adafruit_MCPSRAM.h"
+#include "EPDColors.h"
 
-/**************************************************************************/
-/*!
-    @brief available EPD colors
-*/
-/**************************************************************************/
-enum {
-  EPD_WHITE,  ///< white color
-  EPD_BLACK,  ///< black color
-  EPD_RED,    ///< red color
-  EPD_GRAY,   ///< gray color ('red' on grayscale)
-  EPD_DARK,   ///< darker color
-  EPD_LIGHT,  ///< lighter color
-  EPD_YELLOW, ///< fourth color on some displays
-  EPD_NUM_COLORS
-};
+class EPDRecorder;
 
 typedef enum {
   THINKINK_STANDARD = 0, // 99% of panels use this setup!
@@ -58,6 +71,148 @@ typedef enum {
   THINKINK_QUADCOLOR,
 } thinkinkmode_t;
 
+/**************************************************************************/
+/*!
+    @brief how blitCanvas() combines a 1-bit canvas with the framebuffer
+*/
+/**************************************************************************/
+typedef enum {
+  EPD_BLIT_OR,   ///< set canvas bits paint the color, clear bits are skipped
+  EPD_BLIT_AND,  ///< clear canvas bits paint the color (the canvas is a mask)
+  EPD_BLIT_COPY, ///< set bits paint the color, clear bits paint white
+} epd_blit_mode_t;
+
+/**************************************************************************/
+/*!
+    @brief Kinds of refresh Adafruit_EPD::chooseRefresh() picks between
+*/
+/**************************************************************************/
+typedef enum {
+  EPD_REFRESH_FULL,    ///< normal waveform, clears the ghosting
+  EPD_REFRESH_FAST,    ///< fast waveform (setFastMode()) for the whole frame
+  EPD_REFRESH_PARTIAL, ///< partial window of the dirty box
+} epd_refresh_t;
+
+/**************************************************************************/
+/*!
+    @brief A window of the screen, half-open: x2 and y2 are one past the
+    last column and row
+*/
+/**************************************************************************/
+typedef struct {
+  uint16_t x1; ///< left edge
+  uint16_t y1; ///< top edge
+  uint16_t x2; ///< right edge (exclusive)
+  uint16_t y2; ///< bottom edge (exclusive)
+} epd_rect_t;
+
+#define EPD_WINDOW_PLANE0 0x01 ///< beginWindow(): send buffer1's window
+#define EPD_WINDOW_PLANE1 0x02 ///< beginWindow(): send buffer2's window
+#define EPD_WINDOW_INVERT 0x04 ///< beginWindow(): complement the bytes
+
+/**************************************************************************/
+/*!
+    @brief What a ThinkInk panel sets up on top of its controller driver:
+    geometry, plane assignment, color mapping and waveform. Kept as constexpr
+    tables so a panel is data, see EPDPanel.h
+*/
+/**************************************************************************/
+typedef struct {
+  int16_t width;                        ///< native width in pixels
+  int16_t height;                       ///< native height in pixels
+  thinkinkmode_t mode;                  ///< ink mode begin() selects
+  int8_t black_buffer;                  ///< plane holding black, 0 or 1
+  bool black_inverted;                  ///< black plane is stored inverted
+  int8_t color_buffer;                  ///< plane holding color, 0 or 1
+  bool color_inverted;                  ///< color plane is stored inverted
+  uint8_t layer_colors[EPD_NUM_COLORS]; ///< color -> {color, black} bits
+  uint16_t refresh_delay;               ///< ms to wait without a BUSY pin
+  const uint8_t* init_code; ///< init sequence for mode, NULL: the driver's
+  const uint8_t* lut_code;  ///< waveform LUTs for mode, NULL: the driver's
+} epd_panel_t;
+
+/**************************************************************************/
+/*!
+    @brief One glyph of a font atlas, already scaled
+*/
+/**************************************************************************/
+typedef struct {
+  uint32_t offset;            ///< first byte in the atlas bitmap
+  uint8_t width;              ///< raster width, 0 for a blank glyph
+  uint8_t height;             ///< raster height
+  int16_t x_offset, y_offset; ///< raster position relative to the cursor
+} epd_atlas_glyph_t;
+
+/**************************************************************************/
+/*!
+    @brief A font pre-rasterized at one text size, kept in flash and drawn
+    by write() with blitBits() instead of the glyph cache. Made by
+    tools/epd_font_atlas.py, see setFontAtlases()
+*/
+/**************************************************************************/
+typedef struct {
+  uint32_t font_key;  ///< 0 for the classic font, else epdFontKey()
+  uint8_t size_x;     ///< text size it was rendered at
+  uint8_t size_y;     ///< vertical text size
+  uint8_t first;      ///< first character
+  uint8_t last;       ///< last character
+  const epd_atlas_glyph_t* glyphs; ///< last - first + 1 glyphs
+  const uint8_t* bitmap; ///< glyph rows, MSB first, each padded to a byte
+} epd_font_atlas_t;
+
+uint32_t epdFontKey(const GFXfont* font);
+
+/**************************************************************************/
+/*!
+    @brief Where the last refresh spent its time, in microseconds, see
+    Adafruit_EPD::getTiming()
+*/
+/**************************************************************************/
+typedef struct {
+  int64_t power_up_us;   ///< powerUp(): reset and init sequence
+  int64_t plane_us[2];   ///< sending each plane to controller RAM
+  int64_t refresh_us;    ///< update(): the panel refresh, mostly BUSY
+  int64_t power_down_us; ///< powerDown() after the refresh, 0 if awake
+  uint32_t count;        ///< refreshes so far, tells a new record apart
+} epd_timing_t;
+
+/**************************************************************************/
+/*!
+    @brief Spans of a panel update reported to the trace callback, see
+    Adafruit_EPD::setTraceCallback(); they match the epd_timing_t fields
+*/
+/**************************************************************************/
+typedef enum {
+  EPD_TRACE_POWER_UP,   ///< powerUp()
+  EPD_TRACE_PLANE1,     ///< one write to the first plane's controller RAM
+  EPD_TRACE_PLANE2,     ///< one write to the second plane's controller RAM
+  EPD_TRACE_REFRESH,    ///< update()
+  EPD_TRACE_POWER_DOWN, ///< powerDown() after the refresh
+} epd_trace_t;
+
+/**************************************************************************/
+/*!
+    @brief Panel power states reported to the power callback, see
+    Adafruit_EPD::setPowerCallback()
+*/
+/**************************************************************************/
+typedef enum {
+  EPD_POWER_OFF,     ///< charge pumps off (never on, or after power off)
+  EPD_POWER_ON,      ///< charge pumps on, panel idle
+  EPD_POWER_REFRESH, ///< panel refresh running, update()
+} epd_power_state_t;
+
+/**************************************************************************/
+/*!
+    @brief Where allocFramebuffer() puts framebuffer planes, see
+    Adafruit_EPD::setFramebufferMemory()
+*/
+/**************************************************************************/
+typedef enum {
+  EPD_MEMORY_INTERNAL, ///< DMA-capable internal RAM
+  EPD_MEMORY_SPIRAM,   ///< PSRAM, internal RAM when there is none
+} epd_memory_t;
+
 #define EPD_swap(a, b) \
   {                    \
     int16_t t = a;     \
@@ -71,7 +226,54 @@ typedef enum {
 */
 /**************************************************************************/
 class Adafruit_EPD : public Adafruit_GFX {
+  friend class GFXcanvasEPD2; // copies the framebuffer layout
+  template <int16_t, int16_t, uint8_t, thinkink_sramentrymode_t>
+  friend class EPDPlaneView; // writes the planes directly
+
  public:
+  /**************************************************************************/
+  /*!
+    @brief Called from the refresh task when a displayAsync() completes
+  */
+  /**************************************************************************/
+  typedef void (*refresh_callback_t)(Adafruit_EPD* epd, void* arg);
+
+  /**************************************************************************/
+  /*!
+    @brief Called as each span of a panel update ends, from the task that
+    ran it, with esp_timer times
+  */
+  /**************************************************************************/
+  typedef void (*trace_callback_t)(Adafruit_EPD* epd, epd_trace_t span,
+                                   int64_t start_us, int64_t end_us, void* arg);
+
+  /**************************************************************************/
+  /*!
+    @brief Called when the panel power state changes, from the task driving
+    the panel (the refresh task for displayAsync())
+  */
+  /**************************************************************************/
+  typedef void (*power_callback_t)(Adafruit_EPD* epd, epd_power_state_t state,
+                                   void* arg);
+
+  /**************************************************************************/
+  /*!
+    @brief Called with the plane set swapBuffersAsync() took out of the
+    framebuffer, once no upload reads it; from the refresh task, or from
+    the caller when no upload was running
+  */
+  /**************************************************************************/
+  typedef void (*planes_callback_t)(Adafruit_EPD* epd, uint8_t* plane1,
+                                    uint8_t* plane2, void* arg);
+
+  /**************************************************************************/
+  /*!
+    @brief Polled between upload chunks by display(); returning true abandons
+    the frame (see setCancelCallback())
+  */
+  /**************************************************************************/
+  typedef bool (*cancel_callback_t)(Adafruit_EPD* epd, void* arg);
+
   Adafruit_EPD(int width, int height, int16_t SID, int16_t SCLK, int16_t DC,
                int16_t RST, int16_t CS, int16_t SRCS, int16_t MISO,
                int16_t BUSY = -1);
@@ -81,21 +283,494 @@ class Adafruit_EPD : public Adafruit_GFX {
 
   void begin(bool reset = true);
   void drawPixel(int16_t x, int16_t y, uint16_t color);
+  void writeSpan(int16_t x, int16_t y, const uint8_t* colors, int16_t len);
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void fillScreen(uint16_t color);
+  void blitCanvas(const GFXcanvas1& canvas, int16_t x, int16_t y,
+                  uint16_t color, epd_blit_mode_t mode = EPD_BLIT_OR);
+  void blitBits(const uint8_t* bits, int16_t w, int16_t h, int16_t x,
+                int16_t y, uint16_t color, epd_blit_mode_t mode = EPD_BLIT_OR);
+  void drawRGBBitmap(int16_t x, int16_t y, const uint16_t bitmap[], int16_t w,
+                     int16_t h);
+  void drawRGBBitmap(int16_t x, int16_t y, uint16_t* bitmap, int16_t w,
+                     int16_t h);
+  void drawRGBBitmap(int16_t x, int16_t y, const uint16_t bitmap[],
+                     const uint8_t mask[], int16_t w, int16_t h);
+  void drawRGBBitmap(int16_t x, int16_t y, uint16_t* bitmap, uint8_t* mask,
+                     int16_t w, int16_t h);
+  void drawGrayscaleBitmap(int16_t x, int16_t y, const uint8_t bitmap[],
+                           int16_t w, int16_t h);
+  void drawGrayscaleBitmap(int16_t x, int16_t y, uint8_t* bitmap, int16_t w,
+                           int16_t h);
+  void drawGrayscaleBitmap(int16_t x, int16_t y, const uint8_t bitmap[],
+                           const uint8_t mask[], int16_t w, int16_t h);
+  void drawGrayscaleBitmap(int16_t x, int16_t y, uint8_t* bitmap,
+                           uint8_t* mask, int16_t w, int16_t h);
+  virtual uint8_t quantizeColor(uint8_t r, uint8_t g, uint8_t b, int16_t x,
+                                int16_t y);
+
+  using Adafruit_GFX::write;
+  size_t write(uint8_t c);
+  void setFontAtlases(const epd_font_atlas_t* const* atlases, uint8_t count);
   void clearBuffer();
   void clearDisplay();
   void setBlackBuffer(int8_t index, bool inverted);
   void setColorBuffer(int8_t index, bool inverted);
-  void display(bool sleep = false);
+  virtual void display(bool sleep = false);
+  virtual void displayWindow(const epd_rect_t& rect,
+                             epd_refresh_t mode = EPD_REFRESH_PARTIAL);
+  void displayPartial(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
+  void displayDirty(bool sleep = false);
+  epd_refresh_t chooseRefresh(bool fast_ok);
+  void markDirty(int16_t x, int16_t y, int16_t w, int16_t h);
+  bool getPanelHash(uint32_t& hash);
+  void setPanelHash(uint32_t hash);
+  void invalidatePanelHash(void);
+
+  bool beginPlaneWrite(uint8_t index);
+  void writePlaneChunk(const uint8_t* buf, uint32_t len);
+  void endPlaneWrite(void);
+  void displayStreamed(bool sleep = false);
+
+  bool beginBands(uint32_t band_size);
+  bool nextBand(bool sleep = false);
+  void cancelBands(void);
+
+  /**************************************************************************/
+  /*!
+    @brief Check whether drawing goes to bands, see beginBands()
+    @returns true between beginBands() and the last nextBand()
+  */
+  /**************************************************************************/
+  bool banding(void) const {
+    return _band_lines != 0;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Check whether anything was drawn since the last refresh
+    @returns true if displayDirty() has something to send
+  */
+  /**************************************************************************/
+  bool isDirty(void) {
+    return _dirty_x1 < _dirty_x2;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Tune when displayDirty() falls back to a full refresh
+    @param max_area_percent largest dirty box, in percent of the screen,
+    still sent as a partial update
+    @param max_partials partial or fast updates allowed before a full
+    refresh
+  */
+  /**************************************************************************/
+  void setPartialPolicy(uint8_t max_area_percent, uint8_t max_partials) {
+    _partial_max_area_percent = max_area_percent;
+    _partial_max_count = max_partials;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Set how much ghosting chooseRefresh() lets build up before it
+    asks for a full refresh
+    @param max_refreshes partial or fast updates allowed in a row
+    @param max_area_percent total area they may cover between full
+    refreshes, in percent of the screen (a fast refresh counts 100)
+  */
+  /**************************************************************************/
+  void setGhostPolicy(uint8_t max_refreshes, uint16_t max_area_percent) {
+    _partial_max_count = max_refreshes;
+    _ghost_max_area_percent = max_area_percent;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Tell chooseRefresh() the ambient temperature. Ghosting builds up
+    faster in the cold: the budget is halved below EPD_COLD_CELSIUS and
+    only full refreshes are used below EPD_FREEZING_CELSIUS. Outside the
+    fast waveform's range (setFastTemperatureRange()) it is not chosen
+    @param celsius degrees C, or EPD_TEMPERATURE_UNKNOWN
+  */
+  /**************************************************************************/
+  void setAmbientTemperature(int8_t celsius) {
+    _ambient_celsius = celsius;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Set the ambient temperatures chooseRefresh() picks the fast
+    waveform in; a fast LUT tuned at room temperature leaves the image
+    washed out or smeared well outside it. By default EPD_COLD_CELSIUS to
+    EPD_HOT_CELSIUS
+    @param min_celsius lowest temperature, inclusive
+    @param max_celsius highest temperature, inclusive
+  */
+  /**************************************************************************/
+  void setFastTemperatureRange(int8_t min_celsius, int8_t max_celsius) {
+    _fast_min_celsius = min_celsius;
+    _fast_max_celsius = max_celsius;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Read the controller's own temperature sensor, on drivers that
+    can, and pass a valid reading to setAmbientTemperature()
+    @returns degrees C, or EPD_TEMPERATURE_UNKNOWN if there is no reading
+  */
+  /**************************************************************************/
+  virtual int8_t readTemperature(void) {
+    return EPD_TEMPERATURE_UNKNOWN;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Get the ambient temperature given to setAmbientTemperature()
+    @returns degrees C, or EPD_TEMPERATURE_UNKNOWN
+  */
+  /**************************************************************************/
+  int8_t getAmbientTemperature(void) {
+    return _ambient_celsius;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Switch to or from a fast waveform, on controllers that have one
+    @param fast true for the fast waveform, false for the normal one
+    @returns false if asked for a fast waveform this driver lacks
+  */
+  /**************************************************************************/
+  virtual bool setFastMode(bool fast) {
+    return !fast;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Check whether a fast waveform is selected
+    @returns true after a successful setFastMode(true)
+  */
+  /**************************************************************************/
+  virtual bool fastMode(void) {
+    return false;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Get the stage timings of the last refresh that reached the panel
+    (display() or displayStreamed()). Read it while no refresh is running
+    @param timing receives the timings
+  */
+  /**************************************************************************/
+  void getTiming(epd_timing_t& timing) {
+    timing = _timing;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Get the SPI traffic counters of the display's SPI device since the
+    last resetSPIStats(). Like getTiming(), read it while no refresh is running
+    @param stats receives the counters, zeroed without a hardware SPI device
+  */
+  /**************************************************************************/
+  void getSPIStats(BusIOStats& stats) {
+    stats = spi_dev ? spi_dev->getStats() : BusIOStats{};
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Zero the display's SPI traffic counters, e.g. at the start of a frame
+  */
+  /**************************************************************************/
+  void resetSPIStats(void) {
+    if (spi_dev) {
+      spi_dev->resetStats();
+    }
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Report panel power state changes, e.g. for energy accounting.
+    Drivers report them from powerUp(), update() and powerDown()
+    @param cb callback, NULL to stop reporting
+    @param arg passed to the callback
+  */
+  /**************************************************************************/
+  void setPowerCallback(power_callback_t cb, void* arg = NULL) {
+    _power_cb_arg = arg;
+    _power_cb = cb;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Report when each power-up, plane write, refresh and power-down
+    ran, e.g. for a pipeline timeline. Plane writes come in pieces when
+    streamed or banded, one span per piece
+    @param cb callback, NULL to stop reporting
+    @param arg passed to the callback
+  */
+  /**************************************************************************/
+  void setTraceCallback(trace_callback_t cb, void* arg = NULL) {
+    _trace_cb_arg = arg;
+    _trace_cb = cb;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Let display() abandon a frame that is no longer wanted. The check
+    runs before each EPD_UPLOAD_CHUNK_SIZE chunk of the plane upload, on the
+    task driving the panel; once it returns true the rest of the upload and
+    the refresh are skipped, so the glass keeps its previous image. A refresh
+    already started always runs to the end: the controllers can't stop a
+    waveform part way without leaving the panel unevenly driven
+    @param cb callback, NULL to always finish (the default)
+    @param arg passed to the callback
+  */
+  /**************************************************************************/
+  void setCancelCallback(cancel_callback_t cb, void* arg = NULL) {
+    _cancel_cb_arg = arg;
+    _cancel_cb = cb;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Check whether the last display() was abandoned by the cancel
+    callback before its refresh
+  */
+  /**************************************************************************/
+  bool wasCancelled(void) { return _upload_cancelled; }
+
+  /**************************************************************************/
+  /*!
+    @brief Get the panel power state last reported by the driver
+  */
+  /**************************************************************************/
+  epd_power_state_t getPowerState(void) { return _power_state; }
+
+  /**************************************************************************/
+  /*!
+    @brief Get the kind of the refresh running, or of the last one; valid
+    from the EPD_POWER_REFRESH report on. Drivers without partial or fast
+    waveforms always report EPD_REFRESH_FULL
+  */
+  /**************************************************************************/
+  epd_refresh_t getRefreshMode(void) { return _refresh_mode; }
+
+  /**************************************************************************/
+  /*!
+    @brief Hold the next refresh until a given time, e.g. so several panels
+    change together. The upload still runs at once; the waveform starts
+    when esp_timer_get_time() reaches the time (to a tick), or at once if it
+    already has. Applies to one refresh
+    @param at_us esp_timer time, 0 to start the next refresh at once
+  */
+  /**************************************************************************/
+  void setRefreshTime(int64_t at_us) { _refresh_at_us = at_us; }
+
+  bool displayAsync(bool sleep = false, refresh_callback_t cb = NULL,
+                    void* cb_arg = NULL);
+  bool isRefreshing(void);
+  bool waitRefresh(TickType_t timeout = portMAX_DELAY);
+  bool whenRefreshed(refresh_callback_t cb, void* arg = NULL);
+  bool waitFramebufferFree(TickType_t timeout = portMAX_DELAY);
+  bool suspendBus(void);
+
+  /**************************************************************************/
+  /*!
+    @brief Event group carrying EPD_EVT_FRAMEBUFFER_FREE and
+    EPD_EVT_REFRESH_DONE, for callers that want to wait on several sources
+    @returns the event group, or NULL before the first displayAsync()
+  */
+  /**************************************************************************/
+  EventGroupHandle_t refreshEvents(void) {
+    return _refresh_events;
+  }
 
   thinkinkmode_t getMode(void) {
     return inkmode;
   }
 
+  uint8_t* getBuffer(uint8_t index);
+  uint32_t getBufferSize(uint8_t index);
+  bool swapBuffers(uint8_t*& plane1, uint8_t*& plane2);
+  bool swapBuffersAsync(uint8_t* plane1, uint8_t* plane2,
+                        planes_callback_t released, void* arg = NULL);
+  bool stageFrame(uint8_t* plane1, uint8_t* plane2);
+
+  /**************************************************************************/
+  /*!
+    @brief Check whether controller RAM holds a frame stageFrame() sent
+    ahead of its refresh
+    @returns false once anything else was written to controller RAM
+  */
+  /**************************************************************************/
+  bool hasStagedFrame(void) {
+    return _staged_valid;
+  }
+
+  bool setFramebuffers(uint8_t* plane1, uint8_t* plane2);
+  bool setColorPlane(bool keep);
+  static uint8_t* allocFramebuffer(uint32_t size);
+  static void freeFramebuffer(uint8_t* buffer);
+
+  /**************************************************************************/
+  /*!
+    @brief Choose where allocFramebuffer() puts planes from now on. Drivers
+    allocate in their constructor, so set this before constructing the
+    display. PSRAM planes leave internal RAM free for DMA; SPI uploads then
+    go through an internal staging chunk (Adafruit_SPIDevice::write()).
+    @param memory EPD_MEMORY_INTERNAL (default) or EPD_MEMORY_SPIRAM
+  */
+  /**************************************************************************/
+  static void setFramebufferMemory(epd_memory_t memory) {
+    _framebuffer_memory = memory;
+  }
+  static epd_memory_t getFramebufferMemory(void) { return _framebuffer_memory; }
+
+  /**************************************************************************/
+  /*!
+    @brief Get the controller RAM address/bit layout used by the buffers
+    @returns the data entry mode
+  */
+  /**************************************************************************/
+  thinkink_sramentrymode_t getDataEntryMode(void) {
+    return _data_entry_mode;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Set the longest time busy_wait() will block on the BUSY pin
+    @param ms timeout in milliseconds
+  */
+  /**************************************************************************/
+  void setBusyTimeout(uint32_t ms) {
+    busy_timeout_ms = ms;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Check whether a BUSY pin is wired
+    @returns true if refreshes end on the pin rather than on a fixed delay
+  */
+  /**************************************************************************/
+  bool hasBusyPin(void) {
+    return _busy_pin >= 0;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Set how long a refresh of one kind takes without a BUSY pin, e.g.
+    from takeRefreshDuration() readings taken with the pin wired. Replaces
+    the panel table's refresh_delay for that kind
+    @param mode the refresh kind
+    @param ms milliseconds from the refresh command, 0 for the panel default
+  */
+  /**************************************************************************/
+  void setRefreshDelay(epd_refresh_t mode, uint32_t ms) {
+    if (mode <= EPD_REFRESH_PARTIAL) {
+      _refresh_delay_ms[mode] = ms;
+    }
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Take the time the panel held BUSY in the last refresh. Each
+    reading is returned once; call when no refresh is running
+    @param mode set to the kind of that refresh
+    @returns milliseconds from the refresh command to BUSY release, 0 if
+    there is no new reading (no BUSY pin, or the wait timed out)
+  */
+  /**************************************************************************/
+  uint32_t takeRefreshDuration(epd_refresh_t& mode) {
+    uint32_t ms = _refresh_duration_ms;
+    mode = _refresh_duration_mode;
+    _refresh_duration_ms = 0;
+    return ms;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Pin the displayAsync() task to a core; takes effect when the task
+    is created, on the first displayAsync()
+    @param core core ID, or tskNO_AFFINITY (the default)
+  */
+  /**************************************************************************/
+  void setRefreshTaskCore(BaseType_t core) {
+    _refresh_core = core;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Share an upload turn with other panels on the bus, see
+    EPDBusScheduler. display() holds the turn from power-up until the panel
+    starts refreshing, so the panels' uploads go out one after another and
+    each one's refresh overlaps the next one's upload
+    @param turn a mutex shared by the panels, or NULL to stop sharing
+  */
+  /**************************************************************************/
+  void setBusTurn(SemaphoreHandle_t turn) {
+    _bus_turn = turn;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Hold a power management lock for each upload. display() holds it
+    over the same span as the bus turn, from power-up until the panel starts
+    refreshing, so with an ESP_PM_CPU_FREQ_MAX lock the upload runs at full
+    clock while the busy wait that follows lets the chip slow down and sleep
+    @param lock an esp_pm lock, or NULL for none
+  */
+  /**************************************************************************/
+  void setUploadLock(esp_pm_lock_handle_t lock) {
+    _upload_lock = lock;
+  }
+
+  void setRecorder(EPDRecorder* recorder);
+
+  /**************************************************************************/
+  /*!
+    @brief Set the SPI clocks: one for commands and their arguments, and a
+    faster one for plane data, which controllers usually accept at a higher
+    rate. The device is switched between them only where a plane's bytes
+    start and at the next command, a few times a frame. Takes effect from
+    the next command; call before begin() for the init sequence to use it
+    @param command_hz clock for commands, 0 for EPD_SPI_DEFAULT_HZ
+    @param data_hz clock for plane data, 0 for the command clock
+  */
+  /**************************************************************************/
+  void setSPIClocks(uint32_t command_hz, uint32_t data_hz) {
+    _spi_command_hz = command_hz != 0 ? command_hz : EPD_SPI_DEFAULT_HZ;
+    _spi_data_hz = data_hz != 0 ? data_hz : _spi_command_hz;
+  }
+
+  bool usePanelIO(spi_host_device_t host, uint32_t pclk_hz);
+  /**************************************************************************/
+  /*!
+    @brief Whether the esp_lcd panel IO transport is in use, see usePanelIO()
+  */
+  /**************************************************************************/
+  bool hasPanelIO(void) const { return _panel_io != NULL; }
+
  protected:
   thinkink_sramentrymode_t _data_entry_mode = THINKINK_STANDARD;
 
+  virtual bool writeFramebuffers(void);
+
+  /**************************************************************************/
+  /*!
+    @brief Check whether controller RAM keeps a frame through powerDown()
+    and the next powerUp(), so stageFrame() can send it ahead of its refresh
+    @returns false unless the driver overrides it
+  */
+  /**************************************************************************/
+  virtual bool canStageFrames(void) {
+    return false;
+  }
   void writeRAMFramebufferToEPD(uint8_t* buffer, uint32_t buffer_size,
                                 uint8_t EPDlocation, bool invertdata = false);
+  void writeRAMFillToEPD(uint8_t value, uint32_t size);
+  void setPlaneFills(uint8_t black, uint8_t color);
   void writeSRAMFramebufferToEPD(uint16_t SRAM_buffer_addr,
                                  uint32_t buffer_size, uint8_t EPDlocation,
                                  bool invertdata = false);
@@ -122,6 +797,9 @@ class Adafruit_EPD : public Adafruit_GFX {
 
   virtual void busy_wait(void) = 0;
 
+  bool busyWaitPin(bool idle_level, int16_t status_cmd = -1,
+                   uint32_t poll_ms = 10);
+
   /**************************************************************************/
   /*!
     @brief start up the display
@@ -149,9 +827,13 @@ class Adafruit_EPD : public Adafruit_GFX {
       _cs_pin,                        ///< chip select pin
       _busy_pin;                      ///< busy pin
   Adafruit_SPIDevice* spi_dev = NULL; ///< SPI object
-  static bool _isInTransaction;       ///< true if SPI bus is in trasnfer state
+  bool _isInTransaction = false;      ///< true while this device holds the bus
+  bool _driver_pins = false; ///< the SPI driver drives CS and DC, see begin()
+  static epd_memory_t _framebuffer_memory; ///< see setFramebufferMemory()
   bool singleByteTxns; ///< if true CS will go high after every data byte
                        ///< transferred
+  bool spanWrites; ///< false if drawPixel() is overridden with a buffer layout
+                   ///< other than two 1bpp planes; spans then use drawPixel()
 
   const uint8_t* _epd_init_code = NULL;
   const uint8_t* _epd_lut_code = NULL;
@@ -159,9 +841,159 @@ class Adafruit_EPD : public Adafruit_GFX {
   const uint8_t* _epd_partial_lut_code = NULL;
 
   uint16_t default_refresh_delay = 15000;
+  uint32_t busy_timeout_ms = 60000; ///< upper bound for one BUSY pin wait
+  uint32_t _refresh_delay_ms[EPD_REFRESH_PARTIAL + 1] = {}; ///< 0: default
+  uint32_t _refresh_duration_ms = 0; ///< see takeRefreshDuration()
+  epd_refresh_t _refresh_duration_mode = EPD_REFRESH_FULL;
+  epd_refresh_t _refresh_mode = EPD_REFRESH_FULL; ///< see getRefreshMode()
+  void waitRefreshEnd(epd_refresh_t mode, uint32_t start_ms);
+
+  /**************************************************************************/
+  /*!
+    @brief Start a window refresh for displayWindow(): power up and point the
+    controller's RAM at the window. The waveform tables are already chosen
+    (the partial ones for EPD_REFRESH_PARTIAL). The default has no windowed
+    updates, and displayWindow() sends the whole frame instead
+    @param ram the window in controller space: x along the gates (framebuffer
+    bytes, multiples of 8), y along the sources, half-open
+    @param mode the refresh to run
+    @returns EPD_WINDOW_* bits for the planes to send, 0 if windows are not
+    supported
+  */
+  /**************************************************************************/
+  virtual uint8_t beginWindow(const epd_rect_t& ram, epd_refresh_t mode) {
+    (void)ram;
+    (void)mode;
+    return 0;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief Refresh the window sent after beginWindow() and power down
+    @param mode the refresh to run
+  */
+  /**************************************************************************/
+  virtual void endWindow(epd_refresh_t mode) {
+    (void)mode;
+  }
+
+  void writeWindowPlane(uint8_t plane, const epd_rect_t& ram, bool invert);
+
+  SemaphoreHandle_t _busy_sem = NULL; ///< given by the BUSY pin edge ISR
+  bool _busy_isr_installed = false;   ///< true once the edge ISR is attached
+  static void IRAM_ATTR busyPinISR(void* arg);
+
+  TaskHandle_t _refresh_task = NULL;         ///< background displayAsync() task
+  BaseType_t _refresh_core = tskNO_AFFINITY; ///< core _refresh_task runs on
+  EventGroupHandle_t _refresh_events = NULL; ///< EPD_EVT_* completion bits
+  bool _refresh_sleep = false;               ///< sleep arg for queued refresh
+  refresh_callback_t _refresh_cb = NULL;     ///< completion callback
+  void* _refresh_cb_arg = NULL;              ///< completion callback argument
+  portMUX_TYPE _waiter_mux = portMUX_INITIALIZER_UNLOCKED; ///< guards below
+  bool _refresh_running = false;   ///< displayAsync() refresh not done yet
+  refresh_callback_t _waiter_cb = NULL; ///< whenRefreshed() one-shot callback
+  void* _waiter_arg = NULL;             ///< whenRefreshed() callback argument
+  bool _upload_running = false; ///< displayAsync() upload not done yet
+  bool _swap_pending = false;   ///< swapBuffersAsync() set waiting on it
+  uint8_t* _swap_planes[2] = {NULL, NULL}; ///< the set to swap in
+  planes_callback_t _swap_cb = NULL;       ///< gets the set swapped out
+  void* _swap_arg = NULL;                  ///< _swap_cb argument
+  void framebufferFree(void);
+  bool canSwapBuffers(uint8_t* plane1, uint8_t* plane2);
+  void exchangeBuffers(uint8_t*& plane1, uint8_t*& plane2);
+  bool startRefreshTask(void);
+  static void refreshTask(void* arg);
+
+  SemaphoreHandle_t _bus_turn = NULL; ///< upload turn, see setBusTurn()
+  bool _holds_turn = false;           ///< display() has taken _bus_turn
+  esp_pm_lock_handle_t _upload_lock = NULL; ///< see setUploadLock()
+  EPDRecorder* _recorder = NULL;            ///< see setRecorder()
+  bool _holds_upload_lock = false;          ///< display() has acquired it
+
+  uint32_t _spi_command_hz = EPD_SPI_DEFAULT_HZ; ///< see setSPIClocks()
+  uint32_t _spi_data_hz = EPD_SPI_DEFAULT_HZ;    ///< see setSPIClocks()
+  void spiClock(bool data);
+
+  esp_lcd_panel_io_handle_t _panel_io = NULL; ///< see usePanelIO()
+  SemaphoreHandle_t _io_done = NULL; ///< given per finished color transfer
+  uint8_t _io_pending = 0;           ///< color transfers not yet collected
+  bool _io_data = false;             ///< DC level of the next SPItransfer()
+  void panelIOParam(int cmd, const uint8_t* buf, size_t len);
+  void panelIOColor(const uint8_t* buf, size_t len);
+  void panelIOColorInverted(const uint8_t* buf, size_t len);
+  void panelIOWait(void);
+  static bool panelIODone(esp_lcd_panel_io_handle_t io,
+                          esp_lcd_panel_io_event_data_t* edata, void* ctx);
+  void takeBusTurn(void);
+  void releaseBusTurn(void);
+
+  bool _stream_powered = false; ///< beginPlaneWrite() has powered the panel
+  bool _plane_writing = false;  ///< a plane's RAM write command is open
+  uint8_t _stream_plane = 0;    ///< plane beginPlaneWrite() opened
+
+  // banded drawing: buffer1/buffer2 hold the lines of one band, see
+  // beginBands()
+  uint16_t _band_lines = 0;      ///< lines per band, 0 when not banding
+  uint16_t _band_first = 0;      ///< first line of the band being drawn
+  uint16_t _band_total = 0;      ///< lines of a whole plane
+  uint16_t _band_line_bytes = 0; ///< plane bytes per line
+  uint8_t _band_plane = 0;       ///< plane the bands are streamed to
+  uint8_t* _band_saved[4] = {};          ///< buffer1, buffer2, black, color
+  uint32_t _band_saved_size[2] = {0, 0}; ///< buffer1/buffer2 sizes
+  bool _band_span_writes = true;         ///< spanWrites before banding
+  int8_t _black_index = 0; ///< plane setBlackBuffer() chose
+  int8_t _color_index = 1; ///< plane setColorBuffer() chose
+  void endBands(void);
+
+  epd_timing_t _timing = {};       ///< last completed refresh
+  epd_timing_t _timing_next = {};  ///< refresh being sent
+  void finishTiming(int64_t refresh_us, int64_t power_down_us);
+  int64_t traceSpan(epd_trace_t span, int64_t start_us);
+
+  trace_callback_t _trace_cb = NULL; ///< span trace callback
+  void* _trace_cb_arg = NULL;        ///< its argument
+
+  epd_power_state_t _power_state = EPD_POWER_OFF; ///< last reported state
+  volatile int64_t _refresh_at_us = 0; ///< see setRefreshTime()
+  power_callback_t _power_cb = NULL;              ///< power state callback
+  void* _power_cb_arg = NULL;                     ///< its argument
+  void setPowerState(epd_power_state_t state);
+
+  cancel_callback_t _cancel_cb = NULL; ///< upload cancel check
+  void* _cancel_cb_arg = NULL;         ///< its argument
+  volatile bool _upload_cancelled = false; ///< display() was abandoned
+  bool _cancel_armed = false; ///< display() is uploading; the check applies
+  bool uploadCancelled(void);
+
+  void applyPanel(const epd_panel_t& panel, thinkinkmode_t mode);
+
+  void writeSpanBits(int16_t x, int16_t y, int16_t len, bool vertical,
+                     const uint8_t* colors, uint16_t fill);
+  void blitRaster(const uint8_t* src, int16_t w, int16_t h,
+                  const GFXcanvas1* rotated, int16_t x, int16_t y,
+                  uint16_t color, epd_blit_mode_t mode);
+  void drawQuantized(int16_t x, int16_t y, const uint16_t* rgb,
+                     const uint8_t* gray, const uint8_t* mask, int16_t w,
+                     int16_t h);
+  virtual void writeClippedSpan(int16_t x, int16_t y, int16_t len,
+                                bool vertical, const uint8_t* colors,
+                                uint16_t fill);
+  void nativeBitIndex(int16_t x, int16_t y, int32_t& bit, int32_t& step_x,
+                      int32_t& step_y);
 
   Adafruit_MCPSRAM sram; ///< the ram chip object if using off-chip ram
 
+  // drawPixel() works on one cached line of each SRAM plane, written back
+  // when another line is touched or before the planes are read out
+  uint16_t _sram_line_addr = 0;  ///< plane offset of the cached line
+  uint16_t _sram_line_len = 0;   ///< bytes cached, 0 when nothing is
+  bool _sram_line_dirty = false; ///< cached bytes not yet written back
+  uint8_t _sram_black_line[EPD_SRAM_LINE_SIZE]; ///< black plane bytes
+  uint8_t _sram_color_line[EPD_SRAM_LINE_SIZE]; ///< color plane bytes
+  uint16_t loadSRAMLine(uint16_t addr);
+  void flushSRAMLine(void);
+  void dropSRAMLine(void);
+
   bool blackInverted; ///< is black channel inverted
   bool colorInverted; ///< is red channel inverted
 
@@ -186,15 +1018,87 @@ class Adafruit_EPD : public Adafruit_GFX {
   uint8_t EPD_command(uint8_t c, bool end = true);
   void EPD_data(const uint8_t* buf, uint16_t len);
   void EPD_data(uint8_t data);
+  bool EPD_readData(uint8_t* buf, uint16_t len);
 
   uint8_t SPItransfer(uint8_t c);
 
   bool use_sram; ///< true if we are using an SRAM chip as a framebuffer
+  bool _own_buffers = true; ///< buffer1/buffer2 are freed by the destructor
+  bool _color_dropped = false; ///< buffer2 released, see setColorPlane()
+  uint8_t _color_fill = 0;     ///< byte sent for the released plane
+  void writeColorFill(void);
 
   thinkinkmode_t inkmode; // Ink mode passed to begin()
 
   uint8_t partialsSinceLastFullUpdate = 0;
 
+  // Bounding box of the pixels drawn since the last refresh, in the
+  // rotation it was drawn in; empty when x1 >= x2
+  int16_t _dirty_x1 = 0, _dirty_y1 = 0, _dirty_x2 = 0, _dirty_y2 = 0;
+  uint8_t _dirty_rotation = 0;
+  // Byte buffer1 and buffer2 are known to be filled with throughout, set
+  // by clearBuffer() and fillScreen(), -1 once anything else is drawn
+  int16_t _plane_fill[2] = {-1, -1};
+  uint8_t _partial_max_area_percent = 50;
+  uint8_t _partial_max_count = 5;
+  // ghosting since the last full refresh: screen area partial and fast
+  // refreshes covered, in percent (partialsSinceLastFullUpdate counts them)
+  uint16_t _ghost_area_percent = 0;
+  uint16_t _ghost_max_area_percent = EPD_GHOST_AREA_PERCENT;
+  int8_t _ambient_celsius = EPD_TEMPERATURE_UNKNOWN;
+  int8_t _fast_min_celsius = EPD_COLD_CELSIUS;
+  int8_t _fast_max_celsius = EPD_HOT_CELSIUS;
+
+  uint16_t dirtyAreaPercent(void);
+  void noteFrameRefresh(bool fast);
+
+  // CRC of the frame on the glass after the last full refresh
+  uint32_t _panel_hash = 0;
+  bool _panel_hash_valid = false;
+  bool frameHash(uint32_t& hash);
+  // CRC of the frame stageFrame() left in controller RAM
+  uint32_t _staged_hash = 0;
+  bool _staged_valid = false;
+  bool _staged_exact = false;
+
+  // One glyph, scaled and rasterized, for transparent text through write()
+  struct glyph_raster_t {
+    GFXcanvas1 canvas;
+    glyph_raster_t(int16_t w, int16_t h) : canvas(w, h) {}
+  };
+  typedef struct {
+    const GFXfont* font; ///< NULL for the classic font
+    uint8_t c;
+    uint8_t size_x, size_y;
+    bool cp437;
+    int16_t x_offset, y_offset; ///< raster position relative to the cursor
+    glyph_raster_t* raster;     ///< NULL for an unused slot
+    uint32_t last_used;         ///< _glyph_clock at the last hit
+  } glyph_cache_entry_t;
+  glyph_cache_entry_t _glyph_cache[EPD_GLYPH_CACHE_SIZE] = {};
+  uint32_t _glyph_clock = 0;
+  const glyph_cache_entry_t* cachedGlyph(unsigned char c);
+
+  // setFontAtlases(), and the one matching the last font and size looked up
+  const epd_font_atlas_t* const* _atlases = NULL;
+  uint8_t _atlas_count = 0;
+  const epd_font_atlas_t* _atlas = NULL;
+  const GFXfont* _atlas_font = NULL;
+  uint8_t _atlas_size_x = 0, _atlas_size_y = 0; ///< 0: look up again
+  const epd_font_atlas_t* currentAtlas(void);
+  void drawGlyph(int16_t x, int16_t y, unsigned char c);
+
+  // A command table staged for EPD_commandList(): argument blocks longer
+  // than a transaction carries inline, copied word aligned into DMA memory
+  typedef struct {
+    const uint8_t* table; ///< NULL for an unused slot
+    uint8_t* args;        ///< NULL if every block fits inline
+  } command_chain_t;
+  command_chain_t _cmd_chains[EPD_COMMAND_CHAINS] = {};
+  uint8_t _cmd_chain_next = 0; ///< slot the next table staged replaces
+  const command_chain_t* stageCommandList(const uint8_t* table);
+  void queueCommandList(const command_chain_t& chain);
+
 #if defined(BUSIO_USE_FAST_PINIO)
   BusIO_PortReg *csPort, *dcPort;
   BusIO_PortMask csPinMask, dcPinMask;
@@ -2,6 +2,7 @@
 
 #include <Arduino.h>
 #include <SPI.h>
+#include <string.h>
 
 /**************************************************************************/
 /*!
@@ -56,7 +57,7 @@ void Adafruit_MCPSRAM::begin() {
     clkpinmask = digitalPinToBitMask(_sck);
     mosiport = portOutputRegister(digitalPinToPort(_mosi));
     mosipinmask = digitalPinToBitMask(_mosi);
-    misoport = portOutputRegister(digitalPinToPort(_miso));
+    misoport = portInputRegister(digitalPinToPort(_miso));
     misopinmask = digitalPinToBitMask(_miso);
 #endif
   }
@@ -68,31 +69,82 @@ void Adafruit_MCPSRAM::begin() {
   }
 
   csLow();
-
   for (int i = 0; i < 3; i++) {
-    if (hwSPI) {
-      (void)_spi->transfer(0xFF);
-    } else {
-      for (uint8_t bit = 0x80; bit; bit >>= 1) {
+    (void)transferByte(0xFF);
+  }
+  csHigh();
+}
+
+/**************************************************************************/
+/*!
+    @brief  exchange one byte with the chip
+                @param d the byte to send
+                @returns the byte received at the same time
+*/
+/**************************************************************************/
+uint8_t Adafruit_MCPSRAM::transferByte(uint8_t d) {
+  if (hwSPI) {
+    return _spi->transfer(d);
+  }
+  uint8_t r = 0;
+  for (uint8_t bit = 0x80; bit; bit >>= 1) {
 #ifdef HAVE_PORTREG
-        *clkport &= ~clkpinmask;
-        if (0xFF & bit)
-          *mosiport |= mosipinmask;
-        else
-          *mosiport &= ~mosipinmask;
-        *clkport |= clkpinmask;
+    *clkport &= ~clkpinmask;
+    if (d & bit)
+      *mosiport |= mosipinmask;
+    else
+      *mosiport &= ~mosipinmask;
+    *clkport |= clkpinmask;
+    if (*misoport & misopinmask)
+      r |= bit;
 #else
-        digitalWrite(_sck, LOW);
-        if (0xFF & bit)
-          digitalWrite(_mosi, HIGH);
-        else
-          digitalWrite(_mosi, LOW);
-        digitalWrite(_sck, HIGH);
+    digitalWrite(_sck, LOW);
+    if (d & bit)
+      digitalWrite(_mosi, HIGH);
+    else
+      digitalWrite(_mosi, LOW);
+    digitalWrite(_sck, HIGH);
+    if (digitalRead(_miso))
+      r |= bit;
 #endif
-      }
-    }
   }
-  csHigh();
+  return r;
+}
+
+/**************************************************************************/
+/*!
+    @brief  exchange a block of bytes in place, as one SPI transaction on
+   hardware SPI
+                @param buf the bytes to send, replaced by the bytes received
+                @param num the number of bytes, at most MCPSRAM_BLOCK_SIZE
+*/
+/**************************************************************************/
+void Adafruit_MCPSRAM::transferBlock(uint8_t* buf, uint16_t num) {
+  if (hwSPI) {
+    _spi->transfer(buf, num);
+    return;
+  }
+  for (uint16_t i = 0; i < num; i++) {
+    buf[i] = transferByte(buf[i]);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  send a command, and for data commands the address, with chip
+   select already low
+                @param reg the command
+                @param addr the address, sent only if with_addr
+                @param with_addr true for MCPSRAM_READ / MCPSRAM_WRITE
+*/
+/**************************************************************************/
+void Adafruit_MCPSRAM::sendCommand(uint8_t reg, uint16_t addr,
+                                   bool with_addr) {
+  uint8_t cmdbuf[3];
+  cmdbuf[0] = reg;
+  cmdbuf[1] = (addr >> 8);
+  cmdbuf[2] = addr & 0xFF;
+  transferBlock(cmdbuf, with_addr ? 3 : 1);
 }
 
 /**************************************************************************/
@@ -108,64 +160,16 @@ void Adafruit_MCPSRAM::begin() {
 void Adafruit_MCPSRAM::write(uint16_t addr, uint8_t* buf, uint16_t num,
                              uint8_t reg) {
   csLow();
+  sendCommand(reg, addr, reg == MCPSRAM_WRITE);
 
-  // write command and address
-  uint8_t cmdbuf[3];
-  cmdbuf[0] = reg;
-  cmdbuf[1] = (addr >> 8);
-  cmdbuf[2] = addr & 0xFF;
-
-  for (int i = 0; i < 3; i++) {
-    uint8_t d = cmdbuf[i];
-
-    if (hwSPI) {
-      (void)_spi->transfer(d);
-    } else {
-      for (uint8_t bit = 0x80; bit; bit >>= 1) {
-#ifdef HAVE_PORTREG
-        *clkport &= ~clkpinmask;
-        if (d & bit)
-          *mosiport |= mosipinmask;
-        else
-          *mosiport &= ~mosipinmask;
-        *clkport |= clkpinmask;
-#else
-        digitalWrite(_sck, LOW);
-        if (d & bit)
-          digitalWrite(_mosi, HIGH);
-        else
-          digitalWrite(_mosi, LOW);
-        digitalWrite(_sck, HIGH);
-#endif
-      }
-    }
-    if (reg != MCPSRAM_WRITE)
-      break;
-  }
-
-  // write buffer of data
-  for (uint16_t i = 0; i < num; i++) {
-    uint8_t d = buf[i];
-
-    if (hwSPI) {
-      (void)_spi->transfer(d);
-    } else {
-      for (uint8_t bit = 0x80; bit; bit >>= 1) {
-#ifdef HAVE_PORTREG
-        *clkport &= ~clkpinmask;
-        readt |= mosipinmask;
-        readt &= ~mosipinmask;
-        readask;
-#elseread
-        digitalWrite(_sck, LOW);
-        if (d & bit)
-          digitalWrite(_mosi, HIGH);
-        else
-          digitalWrite(_mosi, LOW);
-        digitalWrite(_sck, HIGH);
-#endif
-      }
-    }
+  // the transfer is full duplex in place, so send a copy of the data
+  uint8_t block[MCPSRAM_BLOCK_SIZE];
+  while (num) {
+    uint16_t n = min(num, (uint16_t)MCPSRAM_BLOCK_SIZE);
+    memcpy(block, buf, n);
+    transferBlock(block, n);
+    buf += n;
+    num -= n;
   }
 
   csHigh();
@@ -184,60 +188,16 @@ void Adafruit_MCPSRAM::write(uint16_t addr, uint8_t* buf, uint16_t num,
 void Adafruit_MCPSRAM::read(uint16_t addr, uint8_t* buf, uint16_t num,
                             uint8_t reg) {
   csLow();
+  sendCommand(reg, addr, reg == MCPSRAM_READ);
 
-  // write command and address
-  uint8_t cmdbuf[3];
-  cmdbuf[0] = reg;
-  cmdbuf[1] = (addr >> 8);
-  cmdbuf[2] = addr & 0xFF;
-  for (int i = 0; i < 3; i++) {
-    uint8_t d = cmdbuf[i];
-
-    if (hwSPI) {
-      (void)_spi->transfer(d);
-    } else {
-      for (uint8_t bit = 0x80; bit; bit >>= 1) {
-#ifdef HAVE_PORTREG
-        *clkport &= ~clkpinmask;
-        if (d & bit)
-          *mosiport |= mosipinmask;
-        else
-          *mosiport &= ~mosipinmask;
-        *clkport |= clkpinmask;
-#else
-        digitalWrite(_sck, LOW);
-        if (d & bit)
-          digitalWrite(_mosi, HIGH);
-        else
-          digitalWrite(_mosi, LOW);
-        digitalWrite(_sck, HIGH);
-#endif
-      }
-    }
-    if (reg != MCPSRAM_READ)
-      break;
+  memset(buf, 0x00, num);
+  while (num) {
+    uint16_t n = min(num, (uint16_t)MCPSRAM_BLOCK_SIZE);
+    transferBlock(buf, n);
+    buf += n;
+    num -= n;
   }
 
-  // read data into buffer
-  for (uint16_t i = 0; i < num; i++) {
-    if (hwSPI) {
-      buf[i] = _spi->transfer(0x00);
-    } else {
-      buf[i] = 0;
-      for (uint8_t bit = 0x80; bit; bit >>= 1) {
-#ifdef HAVE_PORTREG
-        *clkport &= ~clkpinmask;
-        *clkport |= clkpinmask;
-        buf[i] = (buf[i] << 1) | = *misoport & misoport;
-#else
-        digitalWrite(_sck, LOW);
-        digitalWrite(_sck, HIGH);
-
-        buf[i] = (buf[i] << 1) | digitalRead(_miso);
-#endif
-      }
-    }
-  }
   csHigh();
 }
 
@@ -306,63 +266,14 @@ void Adafruit_MCPSRAM::write16(uint16_t addr, uint16_t val) {
 /**************************************************************************/
 void Adafruit_MCPSRAM::erase(uint16_t addr, uint16_t length, uint8_t val) {
   csLow();
-  // write command and address
-  uint8_t cmdbuf[3];
-  cmdbuf[0] = MCPSRAM_WRITE;
-  cmdbuf[1] = (addr >> 8);
-  cmdbuf[2] = addr & 0xFF;
-
-  for (int i = 0; i < 3; i++) {
-    uint8_t d = cmdbuf[i];
+  sendCommand(MCPSRAM_WRITE, addr, true);
 
-    if (hwSPI) {
-      (void)_spi->transfer(d);
-    } else {
-      for (uint8_t bit = 0x80; bit; bit >>= 1) {
-#ifdef HAVE_PORTREG
-        *clkport &= ~clkpinmask;
-        if (d & bit)
-          *mosiport |= mosipinmask;
-        else
-          *mosiport &= ~mosipinmask;
-        *clkport |= clkpinmask;
-#else
-        digitalWrite(_sck, LOW);
-        if (d & bit)
-          digitalWrite(_mosi, HIGH);
-        else
-          digitalWrite(_mosi, LOW);
-        digitalWrite(_sck, HIGH);
-#endif
-      }
-    }
-  }
-
-  // write buffer of data
-  for (uint16_t i = 0; i < length; i++) {
-    uint8_t d = val;
-
-    if (hwSPI) {
-      (void)_spi->transfer(d);
-    } else {
-      for (uint8_t bit = 0x80; bit; bit >>= 1) {
-#ifdef HAVE_PORTREG
-        *clkport &= ~clkpinmask;
-        if (d & bit)
-          *mosiport |= mosipinmask;
-        else
-          *mosiport &= ~mosipinmask;
-        *clkport |= clkpinmask;
-#else
-        digitalWrite(_sck, LOW);
-        if (d & bit)
-          digitalWrite(_mosi, HIGH);
-        else
-          digitalWrite(_mosi, LOW);
-        digitalWrite(_sck, HIGH);
-#endif
-      }
-    }
+  uint8_t block[MCPSRAM_BLOCK_SIZE];
+  while (length) {
+    uint16_t n = min(length, (uint16_t)MCPSRAM_BLOCK_SIZE);
+    memset(block, val, n); // refilled each time, the transfer overwrites it
+    transferBlock(block, n);
+    length -= n;
   }
 
   csHigh();
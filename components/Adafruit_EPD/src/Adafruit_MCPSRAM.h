@@ -8,6 +8,8 @@
 
 #define K640_SEQUENTIAL_MODE (1 << 6) ///< put ram chip in sequential mode
 
+#define MCPSRAM_BLOCK_SIZE 64 ///< bytes per SPI transaction in block transfers
+
 /**************************************************************************/
 /*!
     @brief  Class for interfacing with Microchip SPI SRAM chips
@@ -37,6 +39,10 @@ class Adafruit_MCPSRAM {
   void csLow();
 
  private:
+  uint8_t transferByte(uint8_t d);
+  void transferBlock(uint8_t* buf, uint16_t num);
+  void sendCommand(uint8_t reg, uint16_t addr, bool with_addr);
+
   boolean hwSPI; ///< true if using hardware SPI
 #ifdef HAVE_PORTREG
   PortReg *mosiport, *clkport, *csport, *misoport;
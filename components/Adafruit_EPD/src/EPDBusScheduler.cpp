@@ -0,0 +1,88 @@
+/*!
+ * @file EPDBusScheduler.cpp
+ *
+ * Overlapping refreshes of several panels on one SPI bus.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#include "EPDBusScheduler.h"
+
+/**************************************************************************/
+/*!
+    @brief  Create a scheduler with no panels
+*/
+/**************************************************************************/
+EPDBusScheduler::EPDBusScheduler(void) : _panels(), _count(0) {
+  _turn = xSemaphoreCreateMutexStatic(&_turn_storage);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Wait for the refreshes still running, then stop sharing the turn
+*/
+/**************************************************************************/
+EPDBusScheduler::~EPDBusScheduler(void) {
+  waitAll();
+  for (uint8_t i = 0; i < _count; i++) {
+    _panels[i]->setBusTurn(NULL);
+  }
+  vSemaphoreDelete(_turn);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Add a panel; panels upload in the order they were added. Each
+    panel needs its own chip select (and BUSY pin for the refreshes to
+    overlap) and must be begun already
+    @param epd the panel
+    @returns false if the scheduler is full
+*/
+/**************************************************************************/
+bool EPDBusScheduler::add(Adafruit_EPD* epd) {
+  if (epd == NULL || _count >= EPD_BUS_MAX_PANELS) {
+    return false;
+  }
+  epd->setBusTurn(_turn);
+  _panels[_count++] = epd;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Start every panel's refresh with displayAsync() and return. The
+    uploads take the bus in turn, each while the panels before it refresh.
+    A panel still refreshing from the last call is waited for first, as
+    displayAsync() does
+    @param sleep passed through to each displayAsync()
+    @param cb optional callback, run on each panel's refresh task when it
+    is done (with that panel)
+    @param cb_arg argument for cb
+    @returns true if every refresh was started in the background
+*/
+/**************************************************************************/
+bool EPDBusScheduler::displayAll(bool sleep,
+                                 Adafruit_EPD::refresh_callback_t cb,
+                                 void* cb_arg) {
+  bool async = true;
+  for (uint8_t i = 0; i < _count; i++) {
+    async = _panels[i]->displayAsync(sleep, cb, cb_arg) && async;
+  }
+  return async;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Block until every panel's refresh has finished
+    @param timeout how long to wait for each panel, in ticks
+    @returns true if no refresh is running anymore
+*/
+/**************************************************************************/
+bool EPDBusScheduler::waitAll(TickType_t timeout) {
+  bool done = true;
+  for (uint8_t i = 0; i < _count; i++) {
+    done = _panels[i]->waitRefresh(timeout) && done;
+  }
+  return done;
+}
@@ -0,0 +1,59 @@
+/*!
+ * @file EPDBusScheduler.h
+ *
+ * Several panels on one SPI bus, refreshed so that their refreshes overlap:
+ * panel A's frame is uploaded and its refresh started, then B's frame goes
+ * out while A waits on its BUSY pin, and so on. Each panel uploads from its
+ * own displayAsync() task; the scheduler only hands the panels an upload
+ * turn (Adafruit_EPD::setBusTurn()), so uploads don't interleave and delay
+ * every refresh start.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#ifndef _EPDBUSSCHEDULER_H_
+#define _EPDBUSSCHEDULER_H_
+
+#include "Adafruit_EPD.h"
+
+#define EPD_BUS_MAX_PANELS 4 ///< panels one scheduler can drive
+
+/**************************************************************************/
+/*!
+    @brief  Refreshes the panels sharing a bus with overlapping refreshes.
+    A panel's turn passes on once its driver reports EPD_POWER_REFRESH
+    (IL0373); other drivers pass it when their refresh has finished, which
+    keeps their uploads in turn but doesn't overlap their refreshes
+*/
+/**************************************************************************/
+class EPDBusScheduler {
+ public:
+  EPDBusScheduler(void);
+  ~EPDBusScheduler(void);
+
+  EPDBusScheduler(const EPDBusScheduler&) = delete;
+  EPDBusScheduler& operator=(const EPDBusScheduler&) = delete;
+
+  bool add(Adafruit_EPD* epd);
+  bool displayAll(bool sleep = false,
+                  Adafruit_EPD::refresh_callback_t cb = NULL,
+                  void* cb_arg = NULL);
+  bool waitAll(TickType_t timeout = portMAX_DELAY);
+
+  /**********************************************************************/
+  /*!
+    @brief  Number of panels added
+    @returns the count
+  */
+  /**********************************************************************/
+  uint8_t count(void) const { return _count; }
+
+ private:
+  StaticSemaphore_t _turn_storage;          ///< backing for _turn
+  SemaphoreHandle_t _turn;                  ///< the shared upload turn
+  Adafruit_EPD* _panels[EPD_BUS_MAX_PANELS]; ///< panels in upload order
+  uint8_t _count;                           ///< panels added
+};
+
+#endif // _EPDBUSSCHEDULER_H_
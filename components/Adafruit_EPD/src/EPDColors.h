@@ -0,0 +1,30 @@
+/*!
+ * @file EPDColors.h
+ *
+ * The EPD color indices, on their own so that code which only produces
+ * pixels (decoders, dithering) can use them without the driver headers.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#ifndef _EPDCOLORS_H_
+#define _EPDCOLORS_H_
+
+/**************************************************************************/
+/*!
+    @brief available EPD colors
+*/
+/**************************************************************************/
+enum {
+  EPD_WHITE,  ///< white color
+  EPD_BLACK,  ///< black color
+  EPD_RED,    ///< red color
+  EPD_GRAY,   ///< gray color ('red' on grayscale)
+  EPD_DARK,   ///< darker color
+  EPD_LIGHT,  ///< lighter color
+  EPD_YELLOW, ///< fourth color on some displays
+  EPD_NUM_COLORS
+};
+
+#endif // _EPDCOLORS_H_
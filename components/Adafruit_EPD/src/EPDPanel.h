@@ -0,0 +1,75 @@
+/*!
+ * @file EPDPanel.h
+ *
+ * A ThinkInk panel described by a constexpr epd_panel_t table instead of a
+ * hand-written subclass. The panel type is final, so calls made through it
+ * bind directly to the driver's functions instead of going through the
+ * vtable, and a product that names its panel type links only that driver.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#ifndef _EPDPANEL_H_
+#define _EPDPANEL_H_
+
+#include "Adafruit_EPD.h"
+
+/**************************************************************************/
+/*!
+    @brief  A controller driver set up from a panel table
+    @tparam PANEL the panel's geometry, planes and color mapping
+    @tparam DRIVER the controller driver class, e.g. Adafruit_IL0373
+*/
+/**************************************************************************/
+template <const epd_panel_t& PANEL, class DRIVER>
+class ThinkInkPanel final : public DRIVER {
+ public:
+  /**************************************************************************/
+  /*!
+    @brief constructor if using on-chip RAM and hardware SPI
+    @param DC the data/command pin to use
+    @param RST the reset pin to use
+    @param CS the chip select pin to use
+    @param SRCS the SRAM chip select pin to use, -1 for on-chip RAM
+    @param BUSY the busy pin to use
+    @param spi the SPI bus to use
+  */
+  /**************************************************************************/
+  ThinkInkPanel(int16_t DC, int16_t RST, int16_t CS, int16_t SRCS,
+                int16_t BUSY = -1, SPIClass* spi = &SPI)
+      : DRIVER(PANEL.width, PANEL.height, DC, RST, CS, SRCS, BUSY, spi) {}
+
+  /**************************************************************************/
+  /*!
+    @brief begin communication with and set up the panel
+    @param mode the ink mode to record, the panel's own by default
+  */
+  /**************************************************************************/
+  void begin(thinkinkmode_t mode = PANEL.mode) {
+    DRIVER::begin(true);
+    this->applyPanel(PANEL, mode);
+    this->powerDown();
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief begin with another panel table on the same driver, for firmware
+    that learns which panel it drives at runtime. The framebuffers were
+    sized for PANEL, so the table must have the same geometry
+    @param panel the table to apply
+    @returns true if panel was applied, false if its geometry differs and
+    PANEL was used instead
+  */
+  /**************************************************************************/
+  bool begin(const epd_panel_t& panel) {
+    bool fits = panel.width == PANEL.width && panel.height == PANEL.height;
+    const epd_panel_t& used = fits ? panel : PANEL;
+    DRIVER::begin(true);
+    this->applyPanel(used, used.mode);
+    this->powerDown();
+    return fits;
+  }
+};
+
+#endif // _EPDPANEL_H_
@@ -0,0 +1,348 @@
+/*!
+ * @file EPDPlaneView.h
+ *
+ * Compile-time framebuffer addressing for an Adafruit_EPD whose panel size,
+ * rotation and data entry mode are fixed by the product. The address math
+ * of drawPixel() folds into constants, so a span writer built on it is
+ * straight-line arithmetic with no rotation or layout dispatch.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#ifndef _EPDPLANEVIEW_H_
+#define _EPDPLANEVIEW_H_
+
+#include "Adafruit_EPD.h"
+
+/**************************************************************************/
+/*!
+    @brief  Direct writer for the planes of an Adafruit_EPD with a known
+    layout. attach() checks the display really is laid out that way; the
+    view is only valid until the display's buffers change again (e.g.
+    swapBuffers()).
+    @tparam W native panel width (Adafruit_EPD WIDTH)
+    @tparam H native panel height (Adafruit_EPD HEIGHT)
+    @tparam ROT rotation, as setRotation()
+    @tparam MODE buffer layout, as getDataEntryMode()
+*/
+/**************************************************************************/
+template <int16_t W, int16_t H, uint8_t ROT, thinkink_sramentrymode_t MODE>
+class EPDPlaneView {
+ public:
+  static_assert(ROT < 4, "rotation is 0..3");
+
+  /// logical width in this rotation
+  static constexpr int16_t WIDTH = (ROT & 1) ? H : W;
+  /// logical height in this rotation
+  static constexpr int16_t HEIGHT = (ROT & 1) ? W : H;
+
+  /**************************************************************************/
+  /*!
+    @brief  Linear bit index of a logical pixel (byte = bit / 8, mask =
+    0x80 >> bit % 8), the same math as Adafruit_EPD::drawPixel()
+    @param x the logical x position
+    @param y the logical y position
+    @returns the bit index
+  */
+  /**************************************************************************/
+  static constexpr int32_t bitIndex(int16_t x, int16_t y) {
+    // native pixel
+    int32_t nx = ROT == 0 ? x : ROT == 1 ? W - 1 - y : ROT == 2 ? W - 1 - x : y;
+    int32_t ny = ROT == 0 ? y : ROT == 1 ? x : ROT == 2 ? H - 1 - y : H - 1 - x;
+    return MODE == THINKINK_UC8179 ? (H - 1 - ny) * W + nx
+                                   : (W - 1 - nx) * ((H + 7) & ~7) + ny;
+  }
+
+  /// bit index change for x + 1
+  static constexpr int32_t STEP_X = bitIndex(1, 0) - bitIndex(0, 0);
+  /// bit index change for y + 1
+  static constexpr int32_t STEP_Y = bitIndex(0, 1) - bitIndex(0, 0);
+  /// whether logical rows run along the buffer bytes (8 pixels a byte);
+  /// if not, columns do, and writeTile() packs whole bytes
+  static constexpr bool ROWS_ALONG_BYTES = STEP_X == 1 || STEP_X == -1;
+  /// rows a writeTile() takes
+  static constexpr int16_t TILE_ROWS = 8;
+
+  /**************************************************************************/
+  /*!
+    @brief  First row of the writeTile() block holding row y, i.e. of the
+    TILE_ROWS rows that share the buffer bytes of each column (only
+    meaningful when !ROWS_ALONG_BYTES)
+    @param y the row
+    @returns the block's first row; may be negative, or the block may end
+    past HEIGHT, when HEIGHT isn't a multiple of 8
+  */
+  /**************************************************************************/
+  static constexpr int16_t tileStart(int16_t y) {
+    return STEP_Y > 0 ? y - (bitIndex(0, y) & 7) : y - 7 + (bitIndex(0, y) & 7);
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Bind to a display's current planes
+    @param epd the display
+    @returns false if the display's size, rotation, layout or buffers don't
+    match (the view is then unusable)
+  */
+  /**************************************************************************/
+  bool attach(Adafruit_EPD& epd) {
+    _epd = NULL;
+    if (epd.WIDTH != W || epd.HEIGHT != H || epd.getRotation() != ROT ||
+        epd._data_entry_mode != MODE || epd.use_sram || !epd.spanWrites ||
+        epd.black_buffer == NULL || epd.color_buffer == NULL) {
+      return false;
+    }
+    _epd = &epd;
+    _black = epd.black_buffer;
+    _color = epd.color_buffer;
+    for (uint8_t c = 0; c < EPD_NUM_COLORS; c++) {
+      _black_on[c] = ((epd.layer_colors[c] & 0x1) != 0) != epd.blackInverted;
+      _color_on[c] = ((epd.layer_colors[c] & 0x2) != 0) != epd.colorInverted;
+    }
+    return true;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Write a horizontal run of pixels, one EPD color each, like
+    Adafruit_EPD::writeSpan()
+    @param x the x position of the first pixel
+    @param y the y position of the run
+    @param colors len EPD colors
+    @param len the number of pixels
+  */
+  /**************************************************************************/
+  void writeSpan(int16_t x, int16_t y, const uint8_t* colors, int16_t len) {
+    if (_epd == NULL || colors == NULL || y < 0 || y >= HEIGHT) {
+      return;
+    }
+    if (x < 0) {
+      colors -= x;
+      len += x;
+      x = 0;
+    }
+    if (x + len > WIDTH) {
+      len = WIDTH - x;
+    }
+    if (len <= 0) {
+      return;
+    }
+    _epd->markDirty(x, y, len, 1);
+
+    int32_t bit = bitIndex(x, y);
+    if (STEP_X == 1 || STEP_X == -1) {
+      // rows lie along the buffer bytes: walk them in increasing bit order
+      // and store up to 8 pixels per byte
+      if (STEP_X < 0) {
+        bit -= len - 1;
+      }
+      for (int16_t i = 0; i < len;) {
+        uint32_t addr = bit / 8;
+        uint8_t first = bit % 8;
+        int16_t n = 8 - first;
+        if (n > len - i) {
+          n = len - i;
+        }
+        uint8_t mask = 0, black_bits = 0, color_bits = 0;
+        for (int16_t j = 0; j < n; j++, i++) {
+          uint8_t c = colors[STEP_X > 0 ? i : len - 1 - i];
+          if (c >= EPD_NUM_COLORS) {
+            continue;
+          }
+          uint8_t m = 0x80 >> (first + j);
+          mask |= m;
+          black_bits |= _black_on[c] ? m : 0;
+          color_bits |= _color_on[c] ? m : 0;
+        }
+        // color first, then black, like drawPixel(), for shared planes;
+        // whole bytes are stored without reading them back
+        if (mask == 0xFF) {
+          _color[addr] = color_bits;
+          _black[addr] = black_bits;
+        } else {
+          _color[addr] = (_color[addr] & ~mask) | color_bits;
+          _black[addr] = (_black[addr] & ~mask) | black_bits;
+        }
+        bit += n;
+      }
+      return;
+    }
+
+    // rows cross buffer bytes: one bit per byte (writeTile() avoids this)
+    for (int16_t i = 0; i < len; i++, bit += STEP_X) {
+      uint8_t c = colors[i];
+      if (c >= EPD_NUM_COLORS) {
+        continue;
+      }
+      uint32_t addr = bit / 8;
+      uint8_t m = 0x80 >> (bit % 8);
+      _color[addr] = _color_on[c] ? (_color[addr] | m) : (_color[addr] & ~m);
+      _black[addr] = _black_on[c] ? (_black[addr] | m) : (_black[addr] & ~m);
+    }
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Open a run of a row for a caller that packs the plane bytes
+    itself, as writeSpan() does (only when ROWS_ALONG_BYTES). The run is
+    marked dirty; store color before black, like drawPixel(), for shared
+    planes
+    @param x the x position of the first pixel
+    @param y the y position of the run
+    @param len the number of pixels, all on the panel
+    @param black set to the black plane
+    @param color set to the color plane
+    @returns bit index of the run's lowest bit, which holds its first pixel
+    when STEP_X > 0 and its last otherwise; -1 if the view is unattached,
+    rows cross buffer bytes or the run is not wholly on the panel
+  */
+  /**************************************************************************/
+  int32_t openRun(int16_t x, int16_t y, int16_t len, uint8_t** black,
+                  uint8_t** color) {
+    if (!ROWS_ALONG_BYTES || _epd == NULL || y < 0 || y >= HEIGHT || x < 0 ||
+        len <= 0 || x + len > WIDTH) {
+      return -1;
+    }
+    _epd->markDirty(x, y, len, 1);
+    *black = _black;
+    *color = _color;
+    return STEP_X > 0 ? bitIndex(x, y) : bitIndex(x + len - 1, y);
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Colors that set their pixel's bit in a plane
+    @param black true for the black plane, false for the color plane
+    @returns bit c set when EPD color c sets the bit
+  */
+  /**************************************************************************/
+  uint8_t inkMask(bool black) const {
+    uint8_t mask = 0;
+    for (uint8_t c = 0; c < EPD_NUM_COLORS; c++) {
+      mask |= (black ? _black_on[c] : _color_on[c]) ? (1 << c) : 0;
+    }
+    return mask;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Write TILE_ROWS rows at once when columns run along the buffer
+    bytes (!ROWS_ALONG_BYTES). Each 8x8 block of pixels is gathered into
+    64-bit ink words, transposed with word-wide bit swaps and stored as 8
+    whole bytes per plane, so no buffer byte is read unless the block is
+    only partly written. Falls back to writeSpan() per row when rows run
+    along bytes or y isn't on a byte boundary
+    @param x the x position of the first pixel of each row
+    @param y the first row
+    @param colors TILE_ROWS rows of len EPD colors, stride apart; a color
+    of EPD_NUM_COLORS or more leaves its pixel as it was
+    @param stride colors between the starts of two rows
+    @param len the number of pixels per row
+  */
+  /**************************************************************************/
+  void writeTile(int16_t x, int16_t y, const uint8_t* colors, int16_t stride,
+                 int16_t len) {
+    if (_epd == NULL || colors == NULL) {
+      return;
+    }
+    // lowest bit of the block, where the first row lands when STEP_Y > 0
+    int32_t low = STEP_Y > 0 ? bitIndex(0, y) : bitIndex(0, y + TILE_ROWS - 1);
+    if (ROWS_ALONG_BYTES || STEP_X % 8 != 0 || y < 0 || y + TILE_ROWS > HEIGHT ||
+        low % 8 != 0) {
+      for (int16_t r = 0; r < TILE_ROWS; r++) {
+        writeSpan(x, y + r, colors + r * stride, len);
+      }
+      return;
+    }
+    if (x < 0) {
+      colors -= x;
+      len += x;
+      x = 0;
+    }
+    if (x + len > WIDTH) {
+      len = WIDTH - x;
+    }
+    if (len <= 0) {
+      return;
+    }
+    _epd->markDirty(x, y, len, TILE_ROWS);
+
+    for (int16_t i = 0; i < len; i += 8) {
+      int16_t n = len - i < 8 ? len - i : 8;
+      // byte r of each word (most significant first) is the block's row
+      // in bit order, bit 7 - j its column j
+      uint64_t mask = 0, black = 0, color = 0;
+      for (int16_t r = 0; r < TILE_ROWS; r++) {
+        const uint8_t* row = colors + r * stride + i;
+        uint8_t m = 0, b = 0, c = 0;
+        for (int16_t j = 0; j < n; j++) {
+          uint8_t ink = row[j];
+          if (ink >= EPD_NUM_COLORS) {
+            continue;
+          }
+          uint8_t bitj = 0x80 >> j;
+          m |= bitj;
+          b |= _black_on[ink] ? bitj : 0;
+          c |= _color_on[ink] ? bitj : 0;
+        }
+        int shift = 8 * (7 - (STEP_Y > 0 ? r : TILE_ROWS - 1 - r));
+        mask |= (uint64_t)m << shift;
+        black |= (uint64_t)b << shift;
+        color |= (uint64_t)c << shift;
+      }
+      if (mask == 0) {
+        continue;
+      }
+      // byte j of each word is now column j, its bits the rows in order
+      mask = transpose8x8(mask);
+      black = transpose8x8(black);
+      color = transpose8x8(color);
+
+      int32_t addr = low / 8 + (int32_t)(x + i) * (STEP_X / 8);
+      for (int16_t j = 0; j < n; j++, addr += STEP_X / 8) {
+        int shift = 8 * (7 - j);
+        uint8_t m = mask >> shift;
+        uint8_t b = black >> shift;
+        uint8_t c = color >> shift;
+        // color first, then black, like drawPixel(), for shared planes
+        if (m == 0xFF) {
+          _color[addr] = c;
+          _black[addr] = b;
+        } else if (m != 0) {
+          _color[addr] = (_color[addr] & ~m) | c;
+          _black[addr] = (_black[addr] & ~m) | b;
+        }
+      }
+    }
+  }
+
+ private:
+  /**************************************************************************/
+  /*!
+    @brief  Transpose an 8x8 bit matrix held as 8 bytes, most significant
+    first, bit 7 of each byte leftmost: three rounds of masked swaps
+    (Hacker's Delight, 7-3)
+    @param m the matrix
+    @returns its transpose
+  */
+  /**************************************************************************/
+  static uint64_t transpose8x8(uint64_t m) {
+    uint64_t t;
+    t = (m ^ (m >> 7)) & 0x00AA00AA00AA00AAULL;
+    m ^= t ^ (t << 7);
+    t = (m ^ (m >> 14)) & 0x0000CCCC0000CCCCULL;
+    m ^= t ^ (t << 14);
+    t = (m ^ (m >> 28)) & 0x00000000F0F0F0F0ULL;
+    m ^= t ^ (t << 28);
+    return m;
+  }
+
+  Adafruit_EPD* _epd = NULL; ///< attached display, NULL if none
+  uint8_t* _black = NULL;    ///< black plane
+  uint8_t* _color = NULL;    ///< color plane
+  bool _black_on[EPD_NUM_COLORS] = {}; ///< black plane bit per color
+  bool _color_on[EPD_NUM_COLORS] = {}; ///< color plane bit per color
+};
+
+#endif
@@ -0,0 +1,204 @@
+/*!
+ * @file EPDRecorder.cpp
+ *
+ * Recording of a panel's SPI transactions and BUSY waits.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#include "EPDRecorder.h"
+
+#include <string.h>
+
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+/**************************************************************************/
+/*!
+    @brief  Create a recorder without a buffer
+*/
+/**************************************************************************/
+EPDRecorder::EPDRecorder(void)
+    : _buffer(NULL), _capacity(0), _used(sizeof(epd_record_header_t)),
+      _start_us(0), _freq(0), _recording(false), _full(false) {
+  _lock = xSemaphoreCreateMutexStatic(&_lock_storage);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Free the buffer. Detach the recorder from its panel first
+*/
+/**************************************************************************/
+EPDRecorder::~EPDRecorder(void) {
+  heap_caps_free(_buffer);
+  vSemaphoreDelete(_lock);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Allocate the buffer; a plane upload takes its size plus 12 bytes
+    per transaction, a command with its arguments about 30 bytes
+    @param capacity bytes, header included
+    @returns false if there is no room for it
+*/
+/**************************************************************************/
+bool EPDRecorder::begin(size_t capacity) {
+  if (_buffer != NULL) {
+    return true;
+  }
+  if (capacity <= sizeof(epd_record_header_t)) {
+    return false;
+  }
+  _buffer = (uint8_t*)heap_caps_malloc(capacity, MALLOC_CAP_8BIT);
+  if (_buffer == NULL) {
+    return false;
+  }
+  _capacity = capacity;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Drop what was recorded and record from now on
+*/
+/**************************************************************************/
+void EPDRecorder::start(void) {
+  if (_buffer == NULL) {
+    return;
+  }
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  _used = sizeof(epd_record_header_t);
+  _start_us = esp_timer_get_time();
+  _freq = 0;
+  _full = false;
+  _recording = true;
+  xSemaphoreGive(_lock);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Stop recording; what was recorded stays until the next start()
+*/
+/**************************************************************************/
+void EPDRecorder::stop(void) {
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  _recording = false;
+  xSemaphoreGive(_lock);
+}
+
+/**************************************************************************/
+/*!
+    @brief  The log so far: header and records, ready to write to a file.
+    Stays valid until the next start()
+    @param len set to its size
+    @returns the log, NULL without a buffer
+*/
+/**************************************************************************/
+const uint8_t* EPDRecorder::log(size_t* len) {
+  if (_buffer == NULL) {
+    *len = 0;
+    return NULL;
+  }
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  epd_record_header_t header = {};
+  header.magic = EPD_RECORD_MAGIC;
+  header.version = EPD_RECORD_VERSION;
+  header.flags = _full ? EPD_RECORD_FULL : 0;
+  header.bytes = _used - sizeof(header);
+  memcpy(_buffer, &header, sizeof(header));
+  *len = _used;
+  xSemaphoreGive(_lock);
+  return _buffer;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Append a transaction, after a CLOCK record if the clock changed.
+    A transaction is at most the bus max_transfer_sz, which the SPI DMA
+    keeps below 64 KB
+    @param event the transaction, as the device's tap sees it
+*/
+/**************************************************************************/
+void EPDRecorder::transaction(const BusIOTapEvent& event) {
+  if (!_recording) {
+    return;
+  }
+  epd_record_t record = {};
+  record.time_us = (uint32_t)(event.start_us - _start_us);
+  if (event.freq != _freq) {
+    record.kind = EPD_RECORD_CLOCK;
+    record.value = event.freq;
+    if (!append(record, NULL)) {
+      return;
+    }
+    _freq = event.freq;
+  }
+  record.kind = EPD_RECORD_TRANSACTION;
+  record.flags = (event.dc_level ? EPD_RECORD_DATA : 0) |
+                 (event.queued ? EPD_RECORD_QUEUED : 0) |
+                 (event.data == NULL ? EPD_RECORD_READ : 0);
+  record.len = (uint16_t)event.len;
+  record.value = (uint32_t)(event.end_us - event.start_us);
+  append(record, event.data);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Append a BUSY wait
+    @param start_us when the wait began, esp_timer_get_time()
+    @param end_us when it ended
+    @param idle false if it timed out
+*/
+/**************************************************************************/
+void EPDRecorder::busy(int64_t start_us, int64_t end_us, bool idle) {
+  if (!_recording) {
+    return;
+  }
+  epd_record_t record = {};
+  record.kind = EPD_RECORD_BUSY;
+  record.flags = idle ? EPD_RECORD_IDLE : 0;
+  record.time_us = (uint32_t)(start_us - _start_us);
+  record.value = (uint32_t)(end_us - start_us);
+  append(record, NULL);
+}
+
+/**************************************************************************/
+/*!
+    @brief  BusIOTapCallback that records into the recorder in arg
+    @param arg the EPDRecorder
+    @param event the transaction
+*/
+/**************************************************************************/
+void EPDRecorder::tap(void* arg, const BusIOTapEvent& event) {
+  static_cast<EPDRecorder*>(arg)->transaction(event);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Append a record and its bytes, or stop recording if they don't
+    fit, so the log stays a complete prefix
+    @param record the record
+    @param data record.len bytes, or NULL for none
+    @returns false if it wasn't appended
+*/
+/**************************************************************************/
+bool EPDRecorder::append(const epd_record_t& record, const uint8_t* data) {
+  size_t len = data != NULL ? record.len : 0;
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  bool ok = _recording;
+  if (ok && _capacity - _used < sizeof(record) + len) {
+    _recording = false;
+    _full = true;
+    ok = false;
+  }
+  if (ok) {
+    memcpy(_buffer + _used, &record, sizeof(record));
+    if (len != 0) {
+      memcpy(_buffer + _used + sizeof(record), data, len);
+    }
+    _used += sizeof(record) + len;
+  }
+  xSemaphoreGive(_lock);
+  return ok;
+}
@@ -0,0 +1,118 @@
+/*!
+ * @file EPDRecorder.h
+ *
+ * A recording of a panel's SPI traffic for benchmarking drivers off the
+ * device: every transaction with its DC level, clock, bytes and times, and
+ * every BUSY wait, appended to a RAM buffer while recording. The log is a
+ * header followed by records; tools/spi_replay.py replays it into bus
+ * occupancy, transaction counts and idle gaps.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#ifndef _EPDRECORDER_H_
+#define _EPDRECORDER_H_
+
+#include "../../Adafruit_BusIO_ESPIDF/Adafruit_SPIDevice.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#define EPD_RECORD_MAGIC 0x52445045 ///< "EPDR" little-endian
+#define EPD_RECORD_VERSION 1        ///< log layout version
+
+#define EPD_RECORD_FULL (1 << 0) ///< header: recording stopped when full
+
+#define EPD_RECORD_DATA (1 << 0)   ///< transaction sent with DC high
+#define EPD_RECORD_QUEUED (1 << 1) ///< queued: value is the time to queue it
+#define EPD_RECORD_READ (1 << 2)   ///< a read, no bytes follow
+#define EPD_RECORD_IDLE (1 << 3)   ///< BUSY wait ended with the panel idle
+
+/**************************************************************************/
+/*!
+    @brief Kinds of log record
+*/
+/**************************************************************************/
+typedef enum {
+  EPD_RECORD_TRANSACTION = 1, ///< len bytes follow; value: us it blocked
+  EPD_RECORD_BUSY = 2,        ///< value: us waited on the BUSY pin
+  EPD_RECORD_CLOCK = 3,       ///< value: SPI clock in Hz from here on
+} epd_record_kind_t;
+
+#pragma pack(push, 1)
+/**************************************************************************/
+/*!
+    @brief Log header, at the start of the buffer
+*/
+/**************************************************************************/
+typedef struct {
+  uint32_t magic;     ///< EPD_RECORD_MAGIC
+  uint8_t version;    ///< EPD_RECORD_VERSION
+  uint8_t flags;      ///< EPD_RECORD_FULL
+  uint16_t reserved;  ///< zero
+  uint32_t bytes;     ///< record bytes after the header
+  uint32_t reserved2; ///< zero
+} epd_record_header_t;
+
+/**************************************************************************/
+/*!
+    @brief One record; a transaction's bytes follow it
+*/
+/**************************************************************************/
+typedef struct {
+  uint8_t kind;     ///< epd_record_kind_t
+  uint8_t flags;    ///< EPD_RECORD_DATA, _QUEUED, _READ, _IDLE
+  uint16_t len;     ///< transaction bytes
+  uint32_t time_us; ///< start, from start()
+  uint32_t value;   ///< per kind
+} epd_record_t;
+#pragma pack(pop)
+
+/**************************************************************************/
+/*!
+    @brief Records a panel's traffic, see Adafruit_EPD::setRecorder().
+    Appends from the tasks driving the panel; start() and stop() may come
+    from any task
+*/
+/**************************************************************************/
+class EPDRecorder {
+ public:
+  EPDRecorder(void);
+  ~EPDRecorder(void);
+
+  EPDRecorder(const EPDRecorder&) = delete;
+  EPDRecorder& operator=(const EPDRecorder&) = delete;
+
+  bool begin(size_t capacity);
+  void start(void);
+  void stop(void);
+  const uint8_t* log(size_t* len);
+
+  void transaction(const BusIOTapEvent& event);
+  void busy(int64_t start_us, int64_t end_us, bool idle);
+
+  static void tap(void* arg, const BusIOTapEvent& event);
+
+  /**********************************************************************/
+  /*!
+    @brief  Whether records are being appended
+    @returns false before start(), after stop() or once the buffer is full
+  */
+  /**********************************************************************/
+  bool recording(void) const { return _recording; }
+
+ private:
+  bool append(const epd_record_t& record, const uint8_t* data);
+
+  StaticSemaphore_t _lock_storage; ///< backing for _lock
+  SemaphoreHandle_t _lock;         ///< guards the buffer
+  uint8_t* _buffer;                ///< header, then records
+  size_t _capacity;                ///< bytes of _buffer
+  size_t _used;                    ///< bytes filled, header included
+  int64_t _start_us;               ///< time start() was called
+  uint32_t _freq;                  ///< clock of the last CLOCK record
+  volatile bool _recording;        ///< appending
+  bool _full;                      ///< stopped for lack of room
+};
+
+#endif // _EPDRECORDER_H_
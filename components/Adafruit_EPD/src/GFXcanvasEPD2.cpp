@@ -0,0 +1,186 @@
+/*!
+ * @file GFXcanvasEPD2.cpp
+ *
+ * Off-screen two-plane canvas in Adafruit_EPD framebuffer layout.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#include "GFXcanvasEPD2.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**************************************************************************/
+/*!
+    @brief  Create a canvas matching a display's framebuffer, in its current
+    rotation, cleared to white
+    @param epd the display whose layout to copy
+*/
+/**************************************************************************/
+GFXcanvasEPD2::GFXcanvasEPD2(const Adafruit_EPD& epd)
+    : Adafruit_GFX(epd.WIDTH, epd.HEIGHT) {
+  bool two_planes = epd.buffer2_size != 0 && epd.buffer2 != epd.buffer1 &&
+                    !epd._color_dropped;
+  plane_sizes[0] = epd.buffer1_size;
+  plane_sizes[1] = two_planes ? epd.buffer2_size : 0;
+  planes[0] = (uint8_t*)malloc(plane_sizes[0]);
+  planes[1] = two_planes ? (uint8_t*)malloc(plane_sizes[1]) : NULL;
+
+  black_plane = (epd.black_buffer == epd.buffer1 || !two_planes) ? 0 : 1;
+  color_plane = (epd.color_buffer == epd.buffer1 || !two_planes) ? 0 : 1;
+  black_inverted = epd.blackInverted;
+  color_inverted = epd.colorInverted;
+  entry_mode = epd._data_entry_mode;
+  memcpy(layer_colors, epd.layer_colors, sizeof(layer_colors));
+
+  setRotation(epd.getRotation());
+  if (ok()) {
+    fillScreen(EPD_WHITE);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Free the planes (whichever the canvas holds after swapInto())
+*/
+/**************************************************************************/
+GFXcanvasEPD2::~GFXcanvasEPD2(void) {
+  free(planes[0]);
+  free(planes[1]);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Locate a pixel in the planes, with the same math as
+    Adafruit_EPD::drawPixel()
+    @param x the x position, in the current rotation
+    @param y the y position, in the current rotation
+    @param addr receives the byte offset
+    @param mask receives the bit within the byte
+    @returns false if the pixel is off the canvas
+*/
+/**************************************************************************/
+bool GFXcanvasEPD2::pixelAddress(int16_t x, int16_t y, uint32_t& addr,
+                                 uint8_t& mask) const {
+  if ((x < 0) || (x >= width()) || (y < 0) || (y >= height()))
+    return false;
+
+  switch (getRotation()) {
+    case 1:
+      EPD_swap(x, y);
+      x = WIDTH - x - 1;
+      break;
+    case 2:
+      x = WIDTH - x - 1;
+      y = HEIGHT - y - 1;
+      break;
+    case 3:
+      EPD_swap(x, y);
+      y = HEIGHT - y - 1;
+      break;
+  }
+
+  // deal with non-8-bit heights
+  uint32_t _HEIGHT = (HEIGHT + 7) & ~7;
+  if (entry_mode == THINKINK_UC8179) {
+    addr = ((uint32_t)(HEIGHT - 1 - y) * (uint32_t)WIDTH + x) / 8;
+    mask = 0x80 >> (x % 8);
+  } else { //  THINKINK_STANDARD default!
+    addr = ((uint32_t)(WIDTH - 1 - x) * _HEIGHT + y) / 8;
+    mask = 0x80 >> (y % 8);
+  }
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Draw a pixel
+    @param x the x position
+    @param y the y position
+    @param color the EPD color
+*/
+/**************************************************************************/
+void GFXcanvasEPD2::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  uint32_t addr;
+  uint8_t mask;
+  if (!ok() || color >= EPD_NUM_COLORS || !pixelAddress(x, y, addr, mask))
+    return;
+
+  // color first, then black, like Adafruit_EPD, for shared planes
+  uint8_t* c = planes[color_plane] + addr;
+  if (((layer_colors[color] & 0x2) != 0) != color_inverted) {
+    *c |= mask;
+  } else {
+    *c &= ~mask;
+  }
+  uint8_t* b = planes[black_plane] + addr;
+  if (((layer_colors[color] & 0x1) != 0) != black_inverted) {
+    *b |= mask;
+  } else {
+    *b &= ~mask;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Fill the canvas, a memset per plane
+    @param color the EPD color
+*/
+/**************************************************************************/
+void GFXcanvasEPD2::fillScreen(uint16_t color) {
+  if (!ok() || color >= EPD_NUM_COLORS)
+    return;
+  if (plane_sizes[1] != 0) {
+    memset(planes[color_plane],
+           (((layer_colors[color] & 0x2) != 0) != color_inverted) ? 0xFF : 0x00,
+           plane_sizes[color_plane]);
+  }
+  memset(planes[black_plane],
+         (((layer_colors[color] & 0x1) != 0) != black_inverted) ? 0xFF : 0x00,
+         plane_sizes[black_plane]);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read a pixel back
+    @param x the x position
+    @param y the y position
+    @returns EPD_BLACK, EPD_RED or EPD_WHITE (EPD_WHITE when off the canvas)
+*/
+/**************************************************************************/
+uint16_t GFXcanvasEPD2::getPixel(int16_t x, int16_t y) const {
+  uint32_t addr;
+  uint8_t mask;
+  if (!ok() || !pixelAddress(x, y, addr, mask))
+    return EPD_WHITE;
+
+  bool black = ((planes[black_plane][addr] & mask) != 0) != black_inverted;
+  if (black) {
+    return EPD_BLACK;
+  }
+  if (plane_sizes[1] != 0 &&
+      ((planes[color_plane][addr] & mask) != 0) != color_inverted) {
+    return EPD_RED;
+  }
+  return EPD_WHITE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Hand the canvas planes to the display and take its planes in
+    exchange (Adafruit_EPD::swapBuffers(), which waits for a running upload).
+    The canvas then holds the previous frame and can be drawn over for the
+    next one.
+    @param epd the display the canvas was created for
+    @returns false if the display can't swap (SRAM framebuffer) or the
+    planes are missing
+*/
+/**************************************************************************/
+bool GFXcanvasEPD2::swapInto(Adafruit_EPD& epd) {
+  if (!ok() || epd.getBufferSize(0) != plane_sizes[0]) {
+    return false;
+  }
+  return epd.swapBuffers(planes[0], planes[1]);
+}
@@ -0,0 +1,82 @@
+/*!
+ * @file GFXcanvasEPD2.h
+ *
+ * Off-screen two-plane canvas with the exact framebuffer layout of an
+ * Adafruit_EPD, so a frame drawn into it can be handed to the display with
+ * a pointer exchange instead of a conversion.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#ifndef _GFXCANVASEPD2_H_
+#define _GFXCANVASEPD2_H_
+
+#include "Adafruit_EPD.h"
+
+/**************************************************************************/
+/*!
+    @brief  A GFX canvas holding a black and a color bit plane, laid out as
+    the Adafruit_EPD it was created for (native size, rotation, data entry
+    mode, plane order and inversion)
+*/
+/**************************************************************************/
+class GFXcanvasEPD2 : public Adafruit_GFX {
+ public:
+  GFXcanvasEPD2(const Adafruit_EPD& epd);
+  ~GFXcanvasEPD2(void);
+
+  GFXcanvasEPD2(const GFXcanvasEPD2&) = delete;
+  GFXcanvasEPD2& operator=(const GFXcanvasEPD2&) = delete;
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color);
+  void fillScreen(uint16_t color);
+  uint16_t getPixel(int16_t x, int16_t y) const;
+  bool swapInto(Adafruit_EPD& epd);
+
+  /**********************************************************************/
+  /*!
+    @brief  Check that the planes could be allocated
+    @returns false if out of memory
+  */
+  /**********************************************************************/
+  bool ok(void) const {
+    return planes[0] != NULL && (plane_sizes[1] == 0 || planes[1] != NULL);
+  }
+
+  /**********************************************************************/
+  /*!
+    @brief  Get a plane, in the display's buffer order
+    @param index 0 for buffer1's plane, 1 for buffer2's
+    @returns the plane, or NULL
+  */
+  /**********************************************************************/
+  uint8_t* getPlane(uint8_t index) const {
+    return index < 2 ? planes[index] : NULL;
+  }
+
+  /**********************************************************************/
+  /*!
+    @brief  Get a plane's size
+    @param index 0 for buffer1's plane, 1 for buffer2's
+    @returns the size in bytes
+  */
+  /**********************************************************************/
+  uint32_t getPlaneSize(uint8_t index) const {
+    return index < 2 ? plane_sizes[index] : 0;
+  }
+
+ private:
+  bool pixelAddress(int16_t x, int16_t y, uint32_t& addr, uint8_t& mask) const;
+
+  uint8_t* planes[2];         ///< buffer1 / buffer2 planes (malloc'd)
+  uint32_t plane_sizes[2];    ///< bytes per plane
+  uint8_t black_plane;        ///< index of the black plane
+  uint8_t color_plane;        ///< index of the color plane
+  bool black_inverted;        ///< black plane bits are inverted
+  bool color_inverted;        ///< color plane bits are inverted
+  thinkink_sramentrymode_t entry_mode; ///< buffer byte layout
+  uint8_t layer_colors[EPD_NUM_COLORS]; ///< color -> plane bits, as the EPD
+};
+
+#endif
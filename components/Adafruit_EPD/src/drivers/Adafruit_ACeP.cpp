@@ -54,11 +54,12 @@ Adafruit_ACEP::Adafruit_ACEP(int width, int height, int16_t SID, int16_t SCLK,
     buffer1_addr = 0;
     buffer2_addr = 0;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
+    buffer1 = allocFramebuffer(buffer1_size);
     buffer2 = NULL;
   }
 
-  singleByteTxns = true;
+  singleByteTxns = false; // the controller takes whole runs with CS held
+  spanWrites = false;     // drawPixel() packs its own pixel format
 }
 
 // constructor for hardware SPI - we indicate DataCommand, ChipSelect, Reset
@@ -90,11 +91,12 @@ Adafruit_ACEP::Adafruit_ACEP(int width, int height, int16_t DC, int16_t RST,
     buffer1_addr = 0;
     buffer2_addr = 0;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
+    buffer1 = allocFramebuffer(buffer1_size);
     buffer2 = buffer1;
   }
 
-  singleByteTxns = true;
+  singleByteTxns = false; // the controller takes whole runs with CS held
+  spanWrites = false;     // drawPixel() packs its own pixel format
 }
 
 /**************************************************************************/
@@ -103,11 +105,157 @@ Adafruit_ACEP::Adafruit_ACEP(int width, int height, int16_t DC, int16_t RST,
 */
 /**************************************************************************/
 void Adafruit_ACEP::clearBuffer() {
+  markDirty(0, 0, width(), height());
   if (use_sram) {
     sram.erase(colorbuffer_addr, buffer1_size, 0x11);
   } else {
     memset(color_buffer, 0x11, buffer1_size);
   }
+  setPlaneFills(0x11, 0x11);
+}
+
+/**************************************************************************/
+/*!
+    @brief Fill the whole screen, a memset with on-chip buffers
+    @param color the ACEP_COLOR_* fill
+*/
+/**************************************************************************/
+void Adafruit_ACEP::fillScreen(uint16_t color) {
+  if (use_sram) {
+    fillRect(0, 0, width(), height(), color);
+    return;
+  }
+  uint8_t fill = (color & 0xF) << 4 | (color & 0xF);
+  markDirty(0, 0, width(), height());
+  memset(color_buffer, fill, buffer1_size);
+  setPlaneFills(fill, fill);
+}
+
+/**************************************************************************/
+/*!
+    @brief Nearest of the seven inks to a color, for drawRGBBitmap()
+    @param r red
+    @param g green
+    @param b blue
+    @param x panel column (unused, the inks are not dithered)
+    @param y panel row (unused)
+    @return the ACEP_COLOR_* code
+*/
+/**************************************************************************/
+uint8_t Adafruit_ACEP::quantizeColor(uint8_t r, uint8_t g, uint8_t b,
+                                     int16_t /*x*/, int16_t /*y*/) {
+  static const uint8_t inks[7][3] = {{0, 0, 0},   {255, 255, 255},
+                                     {0, 255, 0}, {0, 0, 255},
+                                     {255, 0, 0}, {255, 255, 0},
+                                     {255, 128, 0}};
+  uint8_t best = ACEP_COLOR_WHITE;
+  uint32_t bestDistance = UINT32_MAX;
+  for (uint8_t i = 0; i < 7; i++) {
+    int32_t dr = r - inks[i][0], dg = g - inks[i][1], db = b - inks[i][2];
+    uint32_t distance = dr * dr + dg * dg + db * db;
+    if (distance < bestDistance) {
+      bestDistance = distance;
+      best = i;
+    }
+  }
+  return best;
+}
+
+/**************************************************************************/
+/*!
+    @brief Fill a rectangle one span per native row, which the buffer
+    stores as consecutive nibbles
+    @param x the x position of the top left corner
+    @param y the y position of the top left corner
+    @param w the rectangle width
+    @param h the rectangle height
+    @param color the ACEP_COLOR_* fill
+*/
+/**************************************************************************/
+void Adafruit_ACEP::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                             uint16_t color) {
+  if (w < 0) {
+    x += w + 1;
+    w = -w;
+  }
+  if (h < 0) {
+    y += h + 1;
+    h = -h;
+  }
+  if ((getRotation() & 1) == 0) {
+    int16_t end = y + h > height() ? height() : y + h;
+    for (int16_t i = y < 0 ? 0 : y; i < end; i++) {
+      writeSpanBits(x, i, w, false, NULL, color);
+    }
+  } else {
+    int16_t end = x + w > width() ? width() : x + w;
+    for (int16_t i = x < 0 ? 0 : x; i < end; i++) {
+      writeSpanBits(i, y, h, true, NULL, color);
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Nibble-packed span writer. A span along a native row (rows in
+    rotations 0 and 2, columns in 1 and 3) is written two pixels per byte
+    store, a fill as a memset; others a nibble at a time
+    @param x the x position of the first pixel, on screen
+    @param y the y position of the first pixel, on screen
+    @param len the number of pixels, all on screen
+    @param vertical run along y instead of x
+    @param colors per-pixel ACEP_COLOR_* values, or NULL to use fill
+    @param fill the color for every pixel when colors is NULL
+*/
+/**************************************************************************/
+void Adafruit_ACEP::writeClippedSpan(int16_t x, int16_t y, int16_t len,
+                                     bool vertical, const uint8_t* colors,
+                                     uint16_t fill) {
+  uint8_t rotation = getRotation();
+  if (use_sram || vertical != ((rotation & 1) != 0)) {
+    Adafruit_EPD::writeClippedSpan(x, y, len, vertical, colors, fill);
+    return;
+  }
+
+  // rotations 1 and 2 run the logical span right to left in the row
+  bool reversed = rotation == 1 || rotation == 2;
+  int16_t nx = x, ny = y;
+  toNative(nx, ny);
+  if (reversed) {
+    nx -= len - 1;
+  }
+  uint8_t* row = color_buffer + ((uint32_t)ny * WIDTH + nx) / 2;
+
+  if (colors == NULL) {
+    uint8_t c = fill & 0xF;
+    if (nx & 1) {
+      *row = (*row & 0xF0) | c;
+      row++;
+      len--;
+    }
+    memset(row, c << 4 | c, len / 2);
+    if (len & 1) {
+      row[len / 2] = (row[len / 2] & 0x0F) | c << 4;
+    }
+    return;
+  }
+
+  // color of the i-th native pixel of the run
+  auto color_at = [&](int16_t i) -> uint8_t {
+    return colors[reversed ? len - 1 - i : i] & 0xF;
+  };
+  int16_t i = 0;
+  if (nx & 1) {
+    *row = (*row & 0xF0) | color_at(0);
+    row++;
+    i = 1;
+  }
+  for (; i + 1 < len; i += 2) {
+    *row++ = color_at(i) << 4 | color_at(i + 1);
+  }
+  if (i < len) {
+    *row = (*row & 0x0F) | color_at(i) << 4;
+  }
 }
 
 /**************************************************************************/
@@ -124,15 +272,11 @@ void Adafruit_ACEP::deGhost() {
   buf[3] = 0xC0;
   EPD_command(ACEP_RESOLUTION, buf, 4);
 
-  EPD_command(ACEP_DTM);
-  uint32_t remaining = (600UL * 448UL / 2);
-  while (remaining) {
-    uint8_t block[256];
-    uint32_t numbytes = min(remaining, (uint32_t)sizeof(block));
-    memset(block, 0x77, numbytes);
-    EPD_data(block, numbytes);
-    remaining -= numbytes;
-  }
+  // every pixel "clean", sent from the constant fill chunk
+  writeRAMCommand(0);
+  dcHigh();
+  writeRAMFillToEPD(0x77, 600UL * 448UL / 2);
+  csHigh();
 
   EPD_command(ACEP_POWER_ON);
   busy_wait();
@@ -141,9 +285,7 @@ void Adafruit_ACEP::deGhost() {
   EPD_command(ACEP_POWER_OFF);
 
   if (_busy_pin >= 0) {
-    while (digitalRead(_busy_pin)) { // wait for busy LOW
-      delay(10);
-    }
+    busyWaitPin(LOW); // wait for busy LOW
   } else {
     delay(BUSY_WAIT);
   }
@@ -170,30 +312,10 @@ void Adafruit_ACEP::clearDisplay() {
 void Adafruit_ACEP::drawPixel(int16_t x, int16_t y, uint16_t color) {
   if ((x < 0) || (x >= width()) || (y < 0) || (y >= height()))
     return;
+  markDirty(x, y, 1, 1);
 
   uint8_t* pBuf;
-
-  // deal with non-8-bit heights
-  uint16_t _HEIGHT = HEIGHT;
-  if (_HEIGHT % 8 != 0) {
-    _HEIGHT += 8 - (_HEIGHT % 8);
-  }
-
-  // check rotation, move pixel around if necessary
-  switch (getRotation()) {
-    case 1:
-      EPD_swap(x, y);
-      x = WIDTH - x - 1;
-      break;
-    case 2:
-      x = WIDTH - x - 1;
-      y = _HEIGHT - y - 1;
-      break;
-    case 3:
-      EPD_swap(x, y);
-      y = _HEIGHT - y - 1;
-      break;
-  }
+  toNative(x, y);
   uint32_t addr = ((uint32_t)x + (uint32_t)y * WIDTH) / 2;
   bool lower_nibble = x % 2;
   uint8_t color_c;
@@ -218,6 +340,38 @@ void Adafruit_ACEP::drawPixel(int16_t x, int16_t y, uint16_t color) {
   }
 }
 
+/**************************************************************************/
+/*!
+    @brief Map a logical pixel to the native panel position drawPixel()
+    stores it at
+    @param x the x position, replaced by the native one
+    @param y the y position, replaced by the native one
+*/
+/**************************************************************************/
+void Adafruit_ACEP::toNative(int16_t& x, int16_t& y) {
+  // deal with non-8-bit heights
+  uint16_t _HEIGHT = HEIGHT;
+  if (_HEIGHT % 8 != 0) {
+    _HEIGHT += 8 - (_HEIGHT % 8);
+  }
+
+  // check rotation, move pixel around if necessary
+  switch (getRotation()) {
+    case 1:
+      EPD_swap(x, y);
+      x = WIDTH - x - 1;
+      break;
+    case 2:
+      x = WIDTH - x - 1;
+      y = _HEIGHT - y - 1;
+      break;
+    case 3:
+      EPD_swap(x, y);
+      y = _HEIGHT - y - 1;
+      break;
+  }
+}
+
 /**************************************************************************/
 /*!
     @brief wait for busy signal to end
@@ -225,9 +379,7 @@ void Adafruit_ACEP::drawPixel(int16_t x, int16_t y, uint16_t color) {
 /**************************************************************************/
 void Adafruit_ACEP::busy_wait(void) {
   if (_busy_pin >= 0) {
-    while (!digitalRead(_busy_pin)) { // wait for busy high
-      delay(10);
-    }
+    busyWaitPin(HIGH); // wait for busy high
   } else {
     delay(BUSY_WAIT);
   }
@@ -305,9 +457,7 @@ void Adafruit_ACEP::update(void) {
   busy_wait();
   EPD_command(ACEP_POWER_OFF);
   if (_busy_pin >= 0) {
-    while (digitalRead(_busy_pin)) { // wait for busy LOW
-      delay(10);
-    }
+    busyWaitPin(LOW); // wait for busy LOW
   } else {
     delay(BUSY_WAIT);
   }
@@ -52,11 +52,20 @@ class Adafruit_ACEP : public Adafruit_EPD {
   void clearDisplay();
   void deGhost();
   void drawPixel(int16_t x, int16_t y, uint16_t color);
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void fillScreen(uint16_t color);
+  uint8_t quantizeColor(uint8_t r, uint8_t g, uint8_t b, int16_t x,
+                        int16_t y);
 
  protected:
   uint8_t writeRAMCommand(uint8_t index);
   void setRAMAddress(uint16_t x, uint16_t y);
   void busy_wait();
+  void writeClippedSpan(int16_t x, int16_t y, int16_t len, bool vertical,
+                        const uint8_t* colors, uint16_t fill);
+
+ private:
+  void toNative(int16_t& x, int16_t& y);
 };
 
 #endif
@@ -59,8 +59,8 @@ Adafruit_EK79686::Adafruit_EK79686(int width, int height, int16_t SID,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 }
 
@@ -94,8 +94,8 @@ Adafruit_EK79686::Adafruit_EK79686(int width, int height, int16_t DC,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 }
 
@@ -106,10 +106,7 @@ Adafruit_EK79686::Adafruit_EK79686(int width, int height, int16_t DC,
 /**************************************************************************/
 void Adafruit_EK79686::busy_wait(void) {
   if (_busy_pin >= 0) {
-    do {
-      EPD_command(EK79686_FLG);
-      delay(10);
-    } while (!digitalRead(_busy_pin));
+    busyWaitPin(HIGH, EK79686_FLG, 10);
   } else {
     delay(BUSY_WAIT);
   }
@@ -1,6 +1,10 @@
 #include "Adafruit_IL0373.h"
 
 #include "../Adafruit_EPD.h"
+// Fast black/white mode (setFastMode()) uses the 2.9" mono T5 partial init
+// and register LUTs in KW mode: about a second per refresh instead of the
+// tricolor OTP waveform, at the cost of ghosting and no red
+#include "../panels/ThinkInk_290_Grayscale4_T5.h"
 
 #define EPD_RAM_BW IL0373_DTM1
 #define EPD_RAM_RED IL0373_DTM2
@@ -52,8 +56,8 @@ Adafruit_IL0373::Adafruit_IL0373(int width, int height, int16_t SID,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 }
 
@@ -85,11 +89,162 @@ Adafruit_IL0373::Adafruit_IL0373(int width, int height, int16_t DC, int16_t RST,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 }
 
+/**************************************************************************/
+/*!
+    @brief Switch to or from the fast black/white waveform. Takes effect at
+    the next display(); call it only while no frame is being uploaded (e.g.
+    after waitFramebufferFree()). Fast refreshes show red as black and leave
+    ghosting, so finish with a normal refresh once updates slow down.
+    @param fast true for the fast mono waveform, false for the normal one
+    @returns false if fast mode needs memory that isn't available, or the
+    framebuffer is in external SRAM
+*/
+/**************************************************************************/
+bool Adafruit_IL0373::setFastMode(bool fast) {
+  if (fast == _fast_mode) {
+    return true;
+  }
+  if (fast) {
+    if (use_sram) {
+      return false;
+    }
+    if (_fast_plane == NULL) {
+      _fast_plane = allocFramebuffer(buffer1_size);
+      if (_fast_plane == NULL) {
+        return false;
+      }
+    }
+    _normal_init_code = _epd_init_code;
+    _normal_lut_code = _epd_lut_code;
+    _epd_init_code = ti_290t5_monopart_init_code;
+    _epd_lut_code = ti_290t5_monopart_lut_code;
+  } else {
+    _epd_init_code = _normal_init_code;
+    _epd_lut_code = _normal_lut_code;
+  }
+  _fast_mode = fast;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Make fast refreshes differential: the frame on the glass goes to
+    DTM1 as OLD and the new one to DTM2 as NEW, so the KW waveform, which
+    leaves white-to-white and black-to-black alone, drives only the pixels
+    that change. Mostly static content such as text then updates without
+    the whole-screen flash. Needs a second merged plane. Only a fast frame
+    that follows another one is differential: after a normal refresh the
+    glass may show red, which the mono plane can't describe, so the first
+    fast frame still drives every pixel
+    @param differential true to upload the shown frame as OLD
+    @returns false if the second plane can't be allocated
+*/
+/**************************************************************************/
+bool Adafruit_IL0373::setDifferentialUpdates(bool differential) {
+  if (differential && _shown_plane == NULL) {
+    if (use_sram) {
+      return false;
+    }
+    _shown_plane = allocFramebuffer(buffer1_size);
+    if (_shown_plane == NULL) {
+      return false;
+    }
+  }
+  _differential = differential;
+  _shown_valid = false;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Read the controller's internal temperature sensor (TSC). The
+    sensor runs while the controller is powered, so a panel that was off is
+    powered up for the reading and off again after it; a running
+    displayAsync() refresh is waited for first. The reply comes back on the
+    data line, which needs the SPI driver to own CS and DC (no SRAM, no
+    panel IO)
+    @returns whole degrees C, also passed to setAmbientTemperature(), or
+    EPD_TEMPERATURE_UNKNOWN if nothing sensible was read
+*/
+/**************************************************************************/
+int8_t Adafruit_IL0373::readTemperature(void) {
+  if (_refresh_task != NULL && xTaskGetCurrentTaskHandle() != _refresh_task) {
+    waitRefresh();
+  }
+
+  bool was_on = _panel_state == PANEL_ON;
+  powerUp();
+  EPD_command(IL0373_TSC);
+  busy_wait();
+  uint8_t buf[2] = {0xFF, 0xFF};
+  bool ok = EPD_readData(buf, 2);
+  if (!was_on) {
+    powerDown();
+  }
+
+  // the first byte is whole degrees, two's complement (bit 7 of the second
+  // is the half degree); a line nobody drove reads all ones
+  int8_t celsius = (int8_t)buf[0];
+  if (!ok || (buf[0] == 0xFF && buf[1] == 0xFF) || celsius < -40 ||
+      celsius > 85) {
+    return EPD_TEMPERATURE_UNKNOWN;
+  }
+  setAmbientTemperature(celsius);
+  return celsius;
+}
+
+/**************************************************************************/
+/*!
+    @brief Send the frame for display(). In fast mode the two planes are
+    merged into one ink plane (black or red) and sent as old = inverted ink,
+    new = ink, so the KW waveform drives every pixel straight to its target.
+    @returns false in fast mode, whose refresh only approximates the frame
+*/
+/**************************************************************************/
+bool Adafruit_IL0373::writeFramebuffers(void) {
+  if (!_fast_mode || black_buffer == NULL || color_buffer == NULL) {
+    _shown_valid = false;
+    return Adafruit_EPD::writeFramebuffers();
+  }
+
+  uint8_t black_flip = blackInverted ? 0xFF : 0x00;
+  uint8_t color_flip = colorInverted ? 0xFF : 0x00;
+  if (color_buffer == black_buffer) {
+    // one shared plane (setColorPlane(false)): black is the only ink
+    for (uint32_t i = 0; i < buffer1_size; i++) {
+      _fast_plane[i] = black_buffer[i] ^ black_flip;
+    }
+  } else {
+    for (uint32_t i = 0; i < buffer1_size; i++) {
+      _fast_plane[i] =
+          (black_buffer[i] ^ black_flip) | (color_buffer[i] ^ color_flip);
+    }
+  }
+
+  // OLD is the shown frame for a differential update, else the inverse of
+  // the new one, so every pixel counts as changed
+  bool differential = _differential && _shown_valid;
+  writeRAMFramebufferToEPD(differential ? _shown_plane : _fast_plane,
+                           buffer1_size, 0, !differential);
+  delay(2);
+  writeRAMFramebufferToEPD(_fast_plane, buffer1_size, 1, false);
+
+  // both writes are collected before the next frame is merged, so the new
+  // plane is kept by swapping the buffers rather than copying
+  if (_differential && !_upload_cancelled) {
+    uint8_t* shown = _fast_plane;
+    _fast_plane = _shown_plane;
+    _shown_plane = shown;
+    _shown_valid = true;
+  }
+  return false;
+}
+
 /**************************************************************************/
 /*!
     @brief wait for busy signal to end
@@ -98,8 +253,10 @@ Adafruit_IL0373::Adafruit_IL0373(int width, int height, int16_t DC, int16_t RST,
 void Adafruit_IL0373::busy_wait(void) {
   // Serial.print("Waiting...");
   if (_busy_pin >= 0) {
-    while (!digitalRead(_busy_pin)) {
-      delay(10); // wait for busy high
+    // wait for busy high; a controller that never got there is reset and
+    // re-initialized on the next powerUp()
+    if (!busyWaitPin(HIGH)) {
+      _panel_state = PANEL_COLD;
     }
   } else {
     delay(BUSY_WAIT);
@@ -119,6 +276,7 @@ void Adafruit_IL0373::begin(bool reset) {
   setColorBuffer(1, true); // red defaults to inverted
 
   powerDown();
+  _panel_state = PANEL_COLD; // nothing has been sent to it yet
 }
 
 /**************************************************************************/
@@ -127,35 +285,59 @@ void Adafruit_IL0373::begin(bool reset) {
 */
 /**************************************************************************/
 void Adafruit_IL0373::update() {
+  epd_refresh_t mode = _partial_update ? EPD_REFRESH_PARTIAL
+                        : _fast_mode    ? EPD_REFRESH_FAST
+                                        : EPD_REFRESH_FULL;
+  _refresh_mode = mode;
+  setPowerState(EPD_POWER_REFRESH);
   EPD_command(IL0373_DISPLAY_REFRESH);
+  uint32_t start = millis();
 
   delay(100);
 
-  busy_wait();
-  if (_busy_pin <= -1) {
-    delay(default_refresh_delay);
+  waitRefreshEnd(mode, start);
+  if (_panel_state == PANEL_COLD) {
+    _shown_valid = false; // the refresh timed out, the glass is unknown
   }
+  setPowerState(EPD_POWER_ON);
 }
 
 /**************************************************************************/
 /*!
-    @brief start up the display
+    @brief start up the display. Only as much as needed is redone: a
+    controller left powered on by the last refresh just gets a changed LUT
+    and the resolution; one that was only powered off keeps its registers,
+    so the reset is skipped; anything else is reset and fully initialized.
 */
 /**************************************************************************/
 void Adafruit_IL0373::powerUp(void) {
   uint8_t buf[5];
 
-  hardwareReset();
-
   const uint8_t* init_code = il0373_default_init_code;
 
   if (_epd_init_code != NULL) {
     init_code = _epd_init_code;
   }
-  EPD_commandList(init_code);
 
-  if (_epd_lut_code) {
+  // the panel setting in the init code picks OTP or register LUTs, so
+  // dropping a loaded LUT needs the init code again
+  bool same_setup = init_code == _loaded_init_code &&
+                    (_epd_lut_code != NULL || _loaded_lut_code == NULL);
+  if (_panel_state != PANEL_ON || !same_setup) {
+    if (_panel_state == PANEL_COLD) {
+      hardwareReset();
+    }
+    EPD_commandList(init_code);
+    _loaded_init_code = init_code;
+    _loaded_lut_code = NULL;
+    _panel_state = PANEL_ON;
+    // both init codes switch the charge pumps on (IL0373_POWER_ON)
+    setPowerState(EPD_POWER_ON);
+  }
+
+  if (_epd_lut_code && _epd_lut_code != _loaded_lut_code) {
     EPD_commandList(_epd_lut_code);
+    _loaded_lut_code = _epd_lut_code;
   }
 
   buf[0] = HEIGHT & 0xFF;
@@ -180,6 +362,12 @@ void Adafruit_IL0373::powerDown() {
   EPD_command(IL0373_VCM_DC_SETTING, buf, 0);
 
   EPD_command(IL0373_POWER_OFF);
+  setPowerState(EPD_POWER_OFF);
+
+  // registers survive power off, but CDI and VCM were just changed
+  if (_panel_state == PANEL_ON) {
+    _panel_state = PANEL_OFF;
+  }
 }
 
 /**************************************************************************/
@@ -214,116 +402,51 @@ void Adafruit_IL0373::setRAMAddress(uint16_t x, uint16_t y) {
   (void)y;
 }
 
-void Adafruit_IL0373::displayPartial(uint16_t x1, uint16_t y1, uint16_t x2,
-                                     uint16_t y2) {
+/**************************************************************************/
+/*!
+    @brief Enter partial mode on a window for displayWindow(). Both planes
+    are sent, so red pixels in the window are kept.
+    @param ram the window in controller space
+    @param mode the refresh to run
+    @returns both planes
+*/
+/**************************************************************************/
+uint8_t Adafruit_IL0373::beginWindow(const epd_rect_t& ram, epd_refresh_t mode) {
+  (void)mode;
   uint8_t buf[7];
 
-  // check rotation, move window around if necessary
-  switch (getRotation()) {
-    case 0:
-      EPD_swap(x1, y1);
-      EPD_swap(x2, y2);
-      y1 = WIDTH - y1;
-      y2 = WIDTH - y2;
-      break;
-    case 1:
-      break;
-    case 2:
-      EPD_swap(x1, y1);
-      EPD_swap(x2, y2);
-      x1 = HEIGHT - x1;
-      x2 = HEIGHT - x2;
-      break;
-    case 3:
-      y1 = WIDTH - y1;
-      y2 = WIDTH - y2;
-      x1 = HEIGHT - x1;
-      x2 = HEIGHT - x2;
-  }
-  if (x1 > x2)
-    EPD_swap(x1, x2);
-  if (y1 > y2)
-    EPD_swap(y1, y2);
-
-  /*
-  Serial.print("x: ");
-  Serial.print(x1);
-  Serial.print(" -> ");
-  Serial.println(x2);
-  Serial.print("y: ");
-  Serial.print(y1);
-  Serial.print(" -> ");
-  Serial.println(y2);
-  */
-
-  // x1 and x2 must be on byte boundaries
-  x1 -= x1 % 8;           // round down;
-  x2 = (x2 + 7) & ~0b111; // round up
-
-  // Serial.println("Partial update!");
-
-  // backup & change init to the partial code
-  const uint8_t* init_code_backup = _epd_init_code;
-  const uint8_t* lut_code_backup = _epd_lut_code;
-  _epd_init_code = _epd_partial_init_code;
-  _epd_lut_code = _epd_partial_lut_code;
+  // the fast path's OLD plane no longer matches the glass
+  _shown_valid = false;
 
   // perform standard power up
   powerUp();
 
   EPD_command(IL0373_PARTIAL_ENTER);
-  buf[0] = x1;
-  buf[1] = x2 - 1;
-  buf[2] = y1 >> 8;
-  buf[3] = y1 & 0xFF;
-  buf[4] = (y2 - 1) >> 8;
-  buf[5] = (y2 - 1) & 0xFF;
+  buf[0] = ram.x1;
+  buf[1] = ram.x2 - 1;
+  buf[2] = ram.y1 >> 8;
+  buf[3] = ram.y1 & 0xFF;
+  buf[4] = (ram.y2 - 1) >> 8;
+  buf[5] = (ram.y2 - 1) & 0xFF;
   buf[6] = 0x28;
   EPD_command(IL0373_PARTIAL_WINDOW, buf, 7);
+  return EPD_WINDOW_PLANE0 | EPD_WINDOW_PLANE1;
+}
 
-  // display....
-
-  // write image
-  writeRAMCommand(0);
-  dcHigh();
-  for (uint16_t y = y1; y < y2; y++) {
-    for (uint16_t x = x1; x < x2; x += 8) {
-      uint16_t i = (x / 8) + y * 16;
-      SPItransfer(black_buffer[i]);
-      // SPItransfer(0);
-    }
-  }
-  csHigh();
-
-  delay(2);
-
-  writeRAMCommand(1);
-  dcHigh();
-
-  // Serial.print("Transfering: ");
-
-  for (uint16_t y = y1; y < y2; y++) {
-    for (uint16_t x = x1; x < x2; x += 8) {
-      uint16_t i = (x / 8) + y * 16;
-      /*
-      Serial.print(i);
-      Serial.print(" (0x");
-      Serial.print(buffer2[i]);
-      Serial.print("), ");
-      if (i % 16 == 15) Serial.println();
-      */
-      SPItransfer(~black_buffer[i]);
-      // SPItransfer(0xFF);
-    }
-  }
-  Serial.println();
-  csHigh();
-
+/**************************************************************************/
+/*!
+    @brief Refresh the window, leave partial mode and power down
+    @param mode the refresh to run
+*/
+/**************************************************************************/
+void Adafruit_IL0373::endWindow(epd_refresh_t mode) {
 #ifdef EPD_DEBUG
   Serial.println("  Update");
 #endif
 
+  _partial_update = mode == EPD_REFRESH_PARTIAL;
   update();
+  _partial_update = false;
 
   EPD_command(IL0373_PARTIAL_EXIT);
 
@@ -332,7 +455,4 @@ void Adafruit_IL0373::displayPartial(uint16_t x1, uint16_t y1, uint16_t x2,
 #endif
 
   powerDown();
-  // change init back
-  _epd_lut_code = lut_code_backup;
-  _epd_init_code = init_code_backup;
 }
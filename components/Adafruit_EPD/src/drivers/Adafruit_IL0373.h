@@ -26,6 +26,7 @@
 #define IL0373_LUTWB 0x23
 #define IL0373_LUTBB 0x24
 #define IL0373_PLL 0x30
+#define IL0373_TSC 0x40
 #define IL0373_CDI 0x50
 #define IL0373_RESOLUTION 0x61
 #define IL0373_VCM_DC_SETTING 0x82
@@ -46,17 +47,67 @@ class Adafruit_IL0373 : public Adafruit_EPD {
                   int16_t BUSY = -1);
   Adafruit_IL0373(int width, int height, int16_t DC, int16_t RST, int16_t CS,
                   int16_t SRCS, int16_t BUSY = -1, SPIClass* spi = &SPI);
+  ~Adafruit_IL0373() {
+    freeFramebuffer(_fast_plane);
+    freeFramebuffer(_shown_plane);
+  }
 
   void begin(bool reset = true);
   void powerUp();
   void powerDown();
   void update();
-  void displayPartial(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
+  bool setFastMode(bool fast);
+  bool setDifferentialUpdates(bool differential);
+  int8_t readTemperature(void);
+
+  /**************************************************************************/
+  /*!
+    @brief Check whether the fast black/white waveform is selected
+    @returns true after setFastMode(true)
+  */
+  /**************************************************************************/
+  bool fastMode(void) {
+    return _fast_mode;
+  }
 
  protected:
   uint8_t writeRAMCommand(uint8_t index);
   void setRAMAddress(uint16_t x, uint16_t y);
+  uint8_t beginWindow(const epd_rect_t& ram, epd_refresh_t mode);
+  void endWindow(epd_refresh_t mode);
   void busy_wait();
+  bool writeFramebuffers(void);
+
+  /**************************************************************************/
+  /*!
+    @brief Check whether a frame can be staged: power off keeps the
+    registers and the RAM, and powerUp() never resets a controller that was
+    only powered off
+    @returns true
+  */
+  /**************************************************************************/
+  bool canStageFrames(void) {
+    return true;
+  }
+
+  /// what powerUp() can skip
+  enum panel_state_t {
+    PANEL_COLD, ///< unknown or reset: hardware reset and full init
+    PANEL_OFF,  ///< powered off, registers kept: init without reset
+    PANEL_ON    ///< initialized and powered: nothing to resend
+  };
+  panel_state_t _panel_state = PANEL_COLD;
+  const uint8_t* _loaded_init_code = NULL; ///< init code last sent
+  const uint8_t* _loaded_lut_code = NULL;  ///< LUT last sent, NULL for OTP
+
+  bool _fast_mode = false;
+  bool _partial_update = false;             ///< update() from endWindow()
+  uint8_t* _fast_plane = NULL;              ///< merged ink plane, fast mode
+  uint8_t* _shown_plane = NULL; ///< ink plane on the glass, differential
+  bool _differential = false;   ///< see setDifferentialUpdates()
+  bool _shown_valid = false;    ///< _shown_plane matches the glass
+  const uint8_t* _normal_init_code = NULL; ///< tables to restore after fast
+  const uint8_t* _normal_lut_code = NULL;
 };
 
 #endif
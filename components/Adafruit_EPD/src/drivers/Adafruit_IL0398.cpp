@@ -49,8 +49,8 @@ Adafruit_IL0398::Adafruit_IL0398(int width, int height, int16_t SID,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 }
 
@@ -80,8 +80,8 @@ Adafruit_IL0398::Adafruit_IL0398(int width, int height, int16_t DC, int16_t RST,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 }
 
@@ -92,10 +92,7 @@ Adafruit_IL0398::Adafruit_IL0398(int width, int height, int16_t DC, int16_t RST,
 /**************************************************************************/
 void Adafruit_IL0398::busy_wait(void) {
   if (_busy_pin > -1) {
-    do {
-      EPD_command(IL0398_GETSTATUS);
-      delay(10);
-    } while (!digitalRead(_busy_pin)); // wait for busy HIGH
+    busyWaitPin(HIGH, IL0398_GETSTATUS, 10); // wait for busy HIGH
     delay(200);
   } else {
     delay(BUSY_WAIT);
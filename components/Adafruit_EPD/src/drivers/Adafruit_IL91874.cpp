@@ -86,8 +86,8 @@ Adafruit_IL91874::Adafruit_IL91874(int width, int height, int16_t SID,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 }
 
@@ -117,8 +117,8 @@ Adafruit_IL91874::Adafruit_IL91874(int width, int height, int16_t DC,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 }
 
@@ -129,9 +129,7 @@ Adafruit_IL91874::Adafruit_IL91874(int width, int height, int16_t DC,
 /**************************************************************************/
 void Adafruit_IL91874::busy_wait(void) {
   if (_busy_pin >= 0) {
-    while (!digitalRead(_busy_pin)) {
-      delay(1); // wait for busy low
-    }
+    busyWaitPin(HIGH); // wait for busy high
   } else {
     delay(BUSY_WAIT);
   }
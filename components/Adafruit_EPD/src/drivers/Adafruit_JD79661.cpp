@@ -61,11 +61,12 @@ Adafruit_JD79661::Adafruit_JD79661(int width, int height, int16_t SID,
     buffer1_addr = 0;
     buffer2_addr = 0;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
+    buffer1 = allocFramebuffer(buffer1_size);
     buffer2 = buffer1;
   }
 
   singleByteTxns = true;
+  spanWrites = false; // drawPixel() packs its own pixel format
 }
 
 // constructor for hardware SPI - we indicate DataCommand, ChipSelect, Reset
@@ -97,11 +98,12 @@ Adafruit_JD79661::Adafruit_JD79661(int width, int height, int16_t DC,
     buffer1_addr = 0;
     buffer2_addr = 0;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
+    buffer1 = allocFramebuffer(buffer1_size);
     buffer2 = buffer1;
   }
 
   singleByteTxns = true;
+  spanWrites = false; // drawPixel() packs its own pixel format
 }
 
 /**************************************************************************/
@@ -194,9 +196,7 @@ void Adafruit_JD79661::drawPixel(int16_t x, int16_t y, uint16_t color) {
 /**************************************************************************/
 void Adafruit_JD79661::busy_wait(void) {
   if (_busy_pin >= 0) {
-    while (!digitalRead(_busy_pin)) { // wait for busy HIGH!
-      delay(10);
-    }
+    busyWaitPin(HIGH); // wait for busy high
   } else {
     delay(BUSY_WAIT);
   }
@@ -42,7 +42,7 @@ Adafruit_SSD1608::Adafruit_SSD1608(int width, int height, int16_t SID,
     buffer1_addr = 0;
     buffer2_addr = 0;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
+    buffer1 = allocFramebuffer(buffer1_size);
     buffer2 = NULL;
   }
 }
@@ -76,7 +76,7 @@ Adafruit_SSD1608::Adafruit_SSD1608(int width, int height, int16_t DC,
     buffer1_addr = 0;
     buffer2_addr = 0;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
+    buffer1 = allocFramebuffer(buffer1_size);
     buffer2 = buffer1;
   }
 }
@@ -88,9 +88,7 @@ Adafruit_SSD1608::Adafruit_SSD1608(int width, int height, int16_t DC,
 /**************************************************************************/
 void Adafruit_SSD1608::busy_wait(void) {
   if (_busy_pin >= 0) {
-    while (digitalRead(_busy_pin)) { // wait for busy low
-      delay(10);
-    }
+    busyWaitPin(LOW); // wait for busy low
   } else {
     delay(BUSY_WAIT);
   }
@@ -58,8 +58,8 @@ Adafruit_SSD1675::Adafruit_SSD1675(int width, int height, int16_t SID,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 }
 
@@ -94,8 +94,8 @@ Adafruit_SSD1675::Adafruit_SSD1675(int width, int height, int16_t DC,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 }
 
@@ -106,9 +106,7 @@ Adafruit_SSD1675::Adafruit_SSD1675(int width, int height, int16_t DC,
 /**************************************************************************/
 void Adafruit_SSD1675::busy_wait(void) {
   if (_busy_pin >= 0) {
-    while (digitalRead(_busy_pin)) { // wait for busy low
-      delay(10);
-    }
+    busyWaitPin(LOW); // wait for busy low
   } else {
     delay(BUSY_WAIT);
   }
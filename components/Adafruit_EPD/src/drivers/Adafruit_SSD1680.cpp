@@ -58,8 +58,8 @@ Adafruit_SSD1680::Adafruit_SSD1680(int width, int height, int16_t SID,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 
   singleByteTxns = true;
@@ -96,8 +96,8 @@ Adafruit_SSD1680::Adafruit_SSD1680(int width, int height, int16_t DC,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 
   singleByteTxns = true;
@@ -110,9 +110,7 @@ Adafruit_SSD1680::Adafruit_SSD1680(int width, int height, int16_t DC,
 /**************************************************************************/
 void Adafruit_SSD1680::busy_wait(void) {
   if (_busy_pin >= 0) {
-    while (digitalRead(_busy_pin)) { // wait for busy low
-      delay(10);
-    }
+    busyWaitPin(LOW); // wait for busy low
   } else {
     delay(BUSY_WAIT);
   }
@@ -149,6 +147,24 @@ void Adafruit_SSD1680::update() {
   }
 }
 
+/**************************************************************************/
+/*!
+    @brief signal the display to update with the partial update sequence
+*/
+/**************************************************************************/
+void Adafruit_SSD1680::updatePartial(void) {
+  uint8_t buf[1];
+
+  buf[0] = 0xFF;
+  EPD_command(SSD1680_DISP_CTRL2, buf, 1);
+  EPD_command(SSD1680_MASTER_ACTIVATE);
+  busy_wait();
+
+  if (_busy_pin <= -1) {
+    delay(1000);
+  }
+}
+
 /**************************************************************************/
 /*!
     @brief start up the display
@@ -173,17 +189,7 @@ void Adafruit_SSD1680::powerUp() {
     height += 8 - (height % 8);
   }
 
-  // Set ram X start/end postion
-  buf[0] = _xram_offset;
-  buf[1] = height / 8 - 1 + _xram_offset;
-  EPD_command(SSD1680_SET_RAMXPOS, buf, 2);
-
-  // Set ram Y start/end postion
-  buf[0] = 0x00;
-  buf[1] = 0x00;
-  buf[2] = (WIDTH - 1);
-  buf[3] = (WIDTH - 1) >> 8;
-  EPD_command(SSD1680_SET_RAMYPOS, buf, 4);
+  setRAMWindow(0, 0, height / 8 - 1, WIDTH - 1);
 
   // Set LUT (if we have one)
   if (_epd_lut_code) {
@@ -243,17 +249,82 @@ uint8_t Adafruit_SSD1680::writeRAMCommand(uint8_t index) {
 */
 /**************************************************************************/
 void Adafruit_SSD1680::setRAMAddress(uint16_t x, uint16_t y) {
-  (void)x;
-  (void)y;
-
   uint8_t buf[2];
 
   // set RAM x address count
-  buf[0] = _xram_offset;
+  buf[0] = x + _xram_offset;
   EPD_command(SSD1680_SET_RAMXCOUNT, buf, 1);
 
   // set RAM y address count
-  buf[0] = 0;
-  buf[1] = 0;
+  buf[0] = y;
+  buf[1] = y >> 8;
   EPD_command(SSD1680_SET_RAMYCOUNT, buf, 2);
 }
+
+/**************************************************************************/
+/*!
+    @brief Set the RAM window the address counters run through
+    @param x1 first X address, in bytes
+    @param y1 first Y address
+    @param x2 last X address, in bytes
+    @param y2 last Y address
+*/
+/**************************************************************************/
+void Adafruit_SSD1680::setRAMWindow(uint16_t x1, uint16_t y1, uint16_t x2,
+                                    uint16_t y2) {
+  uint8_t buf[4];
+
+  // Set ram X start/end postion
+  buf[0] = x1 + _xram_offset;
+  buf[1] = x2 + _xram_offset;
+  EPD_command(SSD1680_SET_RAMXPOS, buf, 2);
+
+  // Set ram Y start/end postion
+  buf[0] = y1;
+  buf[1] = y1 >> 8;
+  buf[2] = y2;
+  buf[3] = y2 >> 8;
+  EPD_command(SSD1680_SET_RAMYPOS, buf, 4);
+}
+
+/**************************************************************************/
+/*!
+    @brief Power up and set the RAM window for displayWindow(). Only the
+    black plane is sent
+    @param ram the window in controller space
+    @param mode the refresh to run
+    @returns the black plane
+*/
+/**************************************************************************/
+uint8_t Adafruit_SSD1680::beginWindow(const epd_rect_t& ram, epd_refresh_t mode) {
+  (void)mode;
+  // perform standard power up
+  powerUp();
+  setRAMWindow(ram.x1 / 8, ram.y1, ram.x2 / 8 - 1, ram.y2 - 1);
+  return EPD_WINDOW_PLANE0;
+}
+
+/**************************************************************************/
+/*!
+    @brief Refresh the window, with the partial update sequence for
+    EPD_REFRESH_PARTIAL, and power down
+    @param mode the refresh to run
+*/
+/**************************************************************************/
+void Adafruit_SSD1680::endWindow(epd_refresh_t mode) {
+#ifdef EPD_DEBUG
+  Serial.println("  UpdatePartial");
+#endif
+
+  if (mode == EPD_REFRESH_PARTIAL) {
+    updatePartial();
+  } else {
+    update();
+  }
+
+#ifdef EPD_DEBUG
+  Serial.println("  partial Powering Down");
+#endif
+
+  powerDown();
+}
@@ -49,11 +49,15 @@ class Adafruit_SSD1680 : public Adafruit_EPD {
   void begin(bool reset = true);
   void powerUp();
   void update();
+  void updatePartial(void);
   void powerDown();
 
  protected:
   uint8_t writeRAMCommand(uint8_t index);
   void setRAMAddress(uint16_t x, uint16_t y);
+  void setRAMWindow(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
+  uint8_t beginWindow(const epd_rect_t& ram, epd_refresh_t mode);
+  void endWindow(epd_refresh_t mode);
   void busy_wait();
 
   int8_t _xram_offset = 1;
@@ -54,8 +54,8 @@ Adafruit_SSD1681::Adafruit_SSD1681(int width, int height, int16_t SID,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 
   singleByteTxns = true;
@@ -92,8 +92,8 @@ Adafruit_SSD1681::Adafruit_SSD1681(int width, int height, int16_t DC,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 
   singleByteTxns = true;
@@ -106,9 +106,7 @@ Adafruit_SSD1681::Adafruit_SSD1681(int width, int height, int16_t DC,
 /**************************************************************************/
 void Adafruit_SSD1681::busy_wait(void) {
   if (_busy_pin >= 0) {
-    while (digitalRead(_busy_pin)) { // wait for busy low
-      delay(10);
-    }
+    busyWaitPin(LOW); // wait for busy low
   } else {
     delay(BUSY_WAIT);
   }
@@ -149,97 +147,38 @@ void Adafruit_SSD1681::update() {
 
 /**************************************************************************/
 /*!
-    @brief signal the display to update
+    @brief Power up and set the RAM window for displayWindow(). Only the
+    black plane is sent
+    @param ram the window in controller space
+    @param mode the refresh to run
+    @returns the black plane
 */
 /**************************************************************************/
-void Adafruit_SSD1681::updatePartial(void) {
-  uint8_t buf[1];
-
-  // display update sequence
-  buf[0] = 0xFF;
-  EPD_command(SSD1681_DISP_CTRL2, buf, 1);
-
-  EPD_command(SSD1681_MASTER_ACTIVATE);
-  busy_wait();
-
-  if (_busy_pin <= -1) {
-    delay(1000);
-  }
-}
-
-void Adafruit_SSD1681::displayPartial(uint16_t x1, uint16_t y1, uint16_t x2,
-                                      uint16_t y2) {
-  // check rotation, move window around if necessary
-  switch (getRotation()) {
-    case 0:
-      EPD_swap(x1, y1);
-      EPD_swap(x2, y2);
-      y1 = WIDTH - y1;
-      y2 = WIDTH - y2;
-      break;
-    case 1:
-      break;
-    case 2:
-      EPD_swap(x1, y1);
-      EPD_swap(x2, y2);
-      x1 = HEIGHT - x1;
-      x2 = HEIGHT - x2;
-      break;
-    case 3:
-      y1 = WIDTH - y1;
-      y2 = WIDTH - y2;
-      x1 = HEIGHT - x1;
-      x2 = HEIGHT - x2;
-  }
-  if (x1 > x2)
-    EPD_swap(x1, x2);
-  if (y1 > y2)
-    EPD_swap(y1, y2);
-
-  /*
-  Serial.print("x: ");
-  Serial.print(x1);
-  Serial.print(" -> ");
-  Serial.println(x2);
-  Serial.print("y: ");
-  Serial.print(y1);
-  Serial.print(" -> ");
-  Serial.println(y2);
-  */
-
-  // x1 and x2 must be on byte boundaries
-  x1 -= x1 % 8;           // round down;
-  x2 = (x2 + 7) & ~0b111; // round up
-
-  Serial.println("---------------partial=============");
+uint8_t Adafruit_SSD1681::beginWindow(const epd_rect_t& ram, epd_refresh_t mode) {
+  (void)mode;
   // perform standard power up
   powerUp();
+  setRAMWindow(ram.x1 / 8, ram.y1, ram.x2 / 8 - 1, ram.y2 - 1);
+  return EPD_WINDOW_PLANE0;
+}
 
-  // display....
-  // setRAMWindow(0, 0, 16/8, 16);
-  setRAMWindow(x1 / 8, y1, x2 / 8, y2);
-  setRAMAddress(x1 / 8, y1);
-
-  // write image
-  writeRAMCommand(0);
-
-  Serial.print("Transfering: ");
-
-  dcHigh();
-  for (uint16_t y = y1; y < y2; y++) {
-    for (uint16_t x = x1; x < x2; x += 8) {
-      uint16_t i = (x / 8) + y * 25;
-      SPItransfer(black_buffer[i]);
-      // SPItransfer(0xAA);
-    }
-  }
-  csHigh();
-
+/**************************************************************************/
+/*!
+    @brief Refresh the window, with the partial update sequence for
+    EPD_REFRESH_PARTIAL, and power down
+    @param mode the refresh to run
+*/
+/**************************************************************************/
+void Adafruit_SSD1681::endWindow(epd_refresh_t mode) {
 #ifdef EPD_DEBUG
   Serial.println("  UpdatePartial");
 #endif
 
-  updatePartial();
+  if (mode == EPD_REFRESH_PARTIAL) {
+    updatePartial();
+  } else {
+    update();
+  }
 
 #ifdef EPD_DEBUG
   Serial.println("  partial Powering Down");
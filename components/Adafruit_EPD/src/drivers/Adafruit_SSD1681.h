@@ -50,12 +50,13 @@ class Adafruit_SSD1681 : public Adafruit_EPD {
   void update(void);
   void updatePartial(void);
   void powerDown();
-  void displayPartial(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
 
  protected:
   uint8_t writeRAMCommand(uint8_t index);
   void setRAMAddress(uint16_t x, uint16_t y);
   void setRAMWindow(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
+  uint8_t beginWindow(const epd_rect_t& ram, epd_refresh_t mode);
+  void endWindow(epd_refresh_t mode);
   void busy_wait();
   uint8_t _display_update_val = 0xF7;
 };
@@ -63,8 +63,8 @@ Adafruit_SSD1683::Adafruit_SSD1683(int width, int height, int16_t SID,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 
   singleByteTxns = true;
@@ -101,8 +101,8 @@ Adafruit_SSD1683::Adafruit_SSD1683(int width, int height, int16_t DC,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 
   singleByteTxns = true;
@@ -115,9 +115,7 @@ Adafruit_SSD1683::Adafruit_SSD1683(int width, int height, int16_t DC,
 /**************************************************************************/
 void Adafruit_SSD1683::busy_wait(void) {
   if (_busy_pin >= 0) {
-    while (digitalRead(_busy_pin)) { // wait for busy low
-      delay(10);
-    }
+    busyWaitPin(LOW); // wait for busy low
   } else {
     delay(BUSY_WAIT);
   }
@@ -156,6 +154,26 @@ void Adafruit_SSD1683::update() {
   }
 }
 
+/**************************************************************************/
+/*!
+    @brief signal the display to update with the partial update sequence
+*/
+/**************************************************************************/
+void Adafruit_SSD1683::updatePartial(void) {
+  uint8_t buf[1];
+
+  // display update sequence
+  buf[0] = 0xFF;
+  EPD_command(SSD1683_DISP_CTRL2, buf, 1);
+
+  EPD_command(SSD1683_MASTER_ACTIVATE);
+  busy_wait();
+
+  if (_busy_pin <= -1) {
+    delay(1000);
+  }
+}
+
 /**************************************************************************/
 /*!
     @brief start up the display
@@ -270,3 +288,45 @@ void Adafruit_SSD1683::setRAMWindow(uint16_t x1, uint16_t y1, uint16_t x2,
   buf[3] = y2 >> 8;
   EPD_command(SSD1683_SET_RAMYPOS, buf, 4);
 }
+
+/**************************************************************************/
+/*!
+    @brief Power up and set the RAM window for displayWindow(). Only the
+    black plane is sent
+    @param ram the window in controller space
+    @param mode the refresh to run
+    @returns the black plane
+*/
+/**************************************************************************/
+uint8_t Adafruit_SSD1683::beginWindow(const epd_rect_t& ram, epd_refresh_t mode) {
+  (void)mode;
+  // perform standard power up
+  powerUp();
+  setRAMWindow(ram.x1 / 8, ram.y1, ram.x2 / 8 - 1, ram.y2 - 1);
+  return EPD_WINDOW_PLANE0;
+}
+
+/**************************************************************************/
+/*!
+    @brief Refresh the window, with the partial update sequence for
+    EPD_REFRESH_PARTIAL, and power down
+    @param mode the refresh to run
+*/
+/**************************************************************************/
+void Adafruit_SSD1683::endWindow(epd_refresh_t mode) {
+#ifdef EPD_DEBUG
+  Serial.println("  UpdatePartial");
+#endif
+
+  if (mode == EPD_REFRESH_PARTIAL) {
+    updatePartial();
+  } else {
+    update();
+  }
+
+#ifdef EPD_DEBUG
+  Serial.println("  partial Powering Down");
+#endif
+
+  powerDown();
+}
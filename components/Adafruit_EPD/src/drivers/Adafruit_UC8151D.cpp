@@ -38,8 +38,8 @@ Adafruit_UC8151D::Adafruit_UC8151D(int width, int height, int16_t SID,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 }
 
@@ -73,8 +73,8 @@ Adafruit_UC8151D::Adafruit_UC8151D(int width, int height, int16_t DC,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 }
 
@@ -85,10 +85,7 @@ Adafruit_UC8151D::Adafruit_UC8151D(int width, int height, int16_t DC,
 /**************************************************************************/
 void Adafruit_UC8151D::busy_wait(void) {
   if (_busy_pin >= 0) {
-    do {
-      EPD_command(UC8151D_FLG);
-      delay(10);
-    } while (!digitalRead(_busy_pin));
+    busyWaitPin(HIGH, UC8151D_FLG, 10);
   } else {
     delay(BUSY_WAIT);
   }
@@ -196,57 +193,19 @@ void Adafruit_UC8151D::setRAMAddress(uint16_t x, uint16_t y) {
 
 /**************************************************************************/
 /*!
-    @brief Transfer the data stored in the buffer(s) to the display
+    @brief Enter partial mode on a window for displayWindow(). Buffer 1
+    holds what the last partial update showed (white before the first) and
+    goes out as the old data, buffer 2 as the new
+    @param ram the window in controller space
+    @param mode the refresh to run
+    @returns both planes, inverted
 */
 /**************************************************************************/
-void Adafruit_UC8151D::displayPartial(uint16_t x1, uint16_t y1, uint16_t x2,
-                                      uint16_t y2) {
+uint8_t Adafruit_UC8151D::beginWindow(const epd_rect_t& ram,
+                                      epd_refresh_t mode) {
+  (void)mode;
   uint8_t buf[7];
 
-  // check rotation, move window around if necessary
-  switch (getRotation()) {
-    case 0:
-      EPD_swap(x1, y1);
-      EPD_swap(x2, y2);
-      y1 = WIDTH - y1 - 1;
-      y2 = WIDTH - y2 - 1;
-      break;
-    case 1:
-      break;
-    case 2:
-      EPD_swap(x1, y1);
-      EPD_swap(x2, y2);
-      x1 = HEIGHT - x1 - 1;
-      x2 = HEIGHT - x2 - 1;
-      break;
-    case 3:
-      y1 = WIDTH - y1 - 1;
-      y2 = WIDTH - y2 - 1;
-      x1 = HEIGHT - x1 - 1;
-      x2 = HEIGHT - x2 - 1;
-  }
-  if (x1 > x2)
-    EPD_swap(x1, x2);
-  if (y1 > y2)
-    EPD_swap(y1, y2);
-
-  /*
-  Serial.print("x: ");
-  Serial.print(x1);
-  Serial.print(" -> ");
-  Serial.println(x2);
-  Serial.print("y: ");
-  Serial.print(y1);
-  Serial.print(" -> ");
-  Serial.println(y2);
-  */
-
-  // backup & change init to the partial code
-  const uint8_t* init_code_backup = _epd_init_code;
-  const uint8_t* lut_code_backup = _epd_lut_code;
-  _epd_init_code = _epd_partial_init_code;
-  _epd_lut_code = _epd_partial_lut_code;
-
 #ifdef EPD_DEBUG
   Serial.println("  Powering Up Partial");
   Serial.print("Partials since last full update: ");
@@ -258,41 +217,35 @@ void Adafruit_UC8151D::displayPartial(uint16_t x1, uint16_t y1, uint16_t x2,
   // This command makes the display enter partial mode
   EPD_command(UC8151D_PTIN);
 
-  buf[0] = x1;
-  buf[1] = x2;
-  buf[2] = y1 >> 8;
-  buf[3] = y1 & 0xFF;
-  buf[4] = y2 >> 8;
-  buf[5] = y2 & 0xFF;
+  buf[0] = ram.x1;
+  buf[1] = ram.x2 - 1;
+  buf[2] = ram.y1 >> 8;
+  buf[3] = ram.y1 & 0xFF;
+  buf[4] = (ram.y2 - 1) >> 8;
+  buf[5] = (ram.y2 - 1) & 0xFF;
   buf[6] = 0x28;
 
   EPD_command(UC8151D_PTL, buf, 7); // resolution setting
 
-  // buffer 1 has the old data from the last update
-  if (use_sram) {
-    if (partialsSinceLastFullUpdate == 0) {
-      // first partial update
+  if (partialsSinceLastFullUpdate == 0) {
+    // first partial update
+    if (use_sram) {
       sram.erase(buffer1_addr, buffer1_size, 0xFF);
-    }
-    writeSRAMFramebufferToEPD(buffer1_addr, buffer1_size, 0, true);
-  } else {
-    if (partialsSinceLastFullUpdate == 0) {
-      // first partial update
+    } else {
       memset(buffer1, 0xFF, buffer1_size);
     }
-
-    writeRAMFramebufferToEPD(buffer1, buffer1_size, 0, true);
-  }
-
-  delay(2);
-
-  // buffer 2 has the new data, that we're updating
-  if (use_sram) {
-    writeSRAMFramebufferToEPD(buffer2_addr, buffer2_size, 1, true);
-  } else {
-    writeRAMFramebufferToEPD(buffer2, buffer2_size, 1, true);
   }
+  return EPD_WINDOW_PLANE0 | EPD_WINDOW_PLANE1 | EPD_WINDOW_INVERT;
+}
 
+/**************************************************************************/
+/*!
+    @brief Refresh the window and keep the new data as the next old data
+    @param mode the refresh to run
+*/
+/**************************************************************************/
+void Adafruit_UC8151D::endWindow(epd_refresh_t mode) {
+  (void)mode;
 #ifdef EPD_DEBUG
   Serial.println("  Update");
 #endif
@@ -314,10 +267,4 @@ void Adafruit_UC8151D::displayPartial(uint16_t x1, uint16_t y1, uint16_t x2,
   } else {
     memcpy(buffer1, buffer2, buffer1_size); // buffer1 has the backup
   }
-
-  partialsSinceLastFullUpdate++;
-
-  // change init back
-  _epd_lut_code = lut_code_backup;
-  _epd_init_code = init_code_backup;
 }
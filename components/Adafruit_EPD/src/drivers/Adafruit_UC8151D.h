@@ -147,11 +147,11 @@ class Adafruit_UC8151D : public Adafruit_EPD {
   void powerDown();
   void update();
 
-  void displayPartial(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
-
  protected:
   uint8_t writeRAMCommand(uint8_t index);
   void setRAMAddress(uint16_t x, uint16_t y);
+  uint8_t beginWindow(const epd_rect_t& ram, epd_refresh_t mode);
+  void endWindow(epd_refresh_t mode);
   void busy_wait();
 };
 
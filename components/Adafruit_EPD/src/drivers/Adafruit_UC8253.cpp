@@ -50,8 +50,8 @@ Adafruit_UC8253::Adafruit_UC8253(int width, int height, int16_t SID,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 
   singleByteTxns = true;
@@ -88,8 +88,8 @@ Adafruit_UC8253::Adafruit_UC8253(int width, int height, int16_t DC, int16_t RST,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 
   singleByteTxns = true;
@@ -102,10 +102,7 @@ Adafruit_UC8253::Adafruit_UC8253(int width, int height, int16_t DC, int16_t RST,
 /**************************************************************************/
 void Adafruit_UC8253::busy_wait(void) {
   if (_busy_pin >= 0) {
-    while (!digitalRead(_busy_pin)) { // wait for busy HIGH
-      EPD_command(UC8253_GET_STATUS);
-      delay(50);
-    }
+    busyWaitPin(HIGH, UC8253_GET_STATUS, 50); // wait for busy HIGH
   } else {
     delay(BUSY_WAIT);
   }
@@ -51,8 +51,8 @@ Adafruit_UC8276::Adafruit_UC8276(int width, int height, int16_t SID,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 
   singleByteTxns = true;
@@ -89,8 +89,8 @@ Adafruit_UC8276::Adafruit_UC8276(int width, int height, int16_t DC, int16_t RST,
     buffer2_addr = buffer1_size;
     buffer1 = buffer2 = NULL;
   } else {
-    buffer1 = (uint8_t*)malloc(buffer1_size);
-    buffer2 = (uint8_t*)malloc(buffer2_size);
+    buffer1 = allocFramebuffer(buffer1_size);
+    buffer2 = allocFramebuffer(buffer2_size);
   }
 
   singleByteTxns = true;
@@ -103,10 +103,7 @@ Adafruit_UC8276::Adafruit_UC8276(int width, int height, int16_t DC, int16_t RST,
 /**************************************************************************/
 void Adafruit_UC8276::busy_wait(void) {
   if (_busy_pin >= 0) {
-    while (!digitalRead(_busy_pin)) { // wait for busy HIGH
-      EPD_command(UC8276_GET_STATUS);
-      delay(100);
-    }
+    busyWaitPin(HIGH, UC8276_GET_STATUS, 100); // wait for busy HIGH
   } else {
     delay(BUSY_WAIT);
   }
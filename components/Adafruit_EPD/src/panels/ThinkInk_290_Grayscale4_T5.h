@@ -146,6 +146,22 @@ const uint8_t ti_290t5_gray4_lut_code[] = {
 
 // clang-format on
 
+/// THINKINK_GRAYSCALE4: the two bits of each gray go to layers 0 and 1,
+/// both inverted, with the 4-gray init and LUTs
+static constexpr epd_panel_t thinkink_290_grayscale4_t5 = {
+    296,
+    128,
+    THINKINK_GRAYSCALE4,
+    1,
+    true,
+    0,
+    true,
+    {0b00, 0b11, 0b01, 0b10, 0b10, 0b01, 0b00}, // EPD_WHITE .. EPD_YELLOW
+    800,
+    ti_290t5_gray4_init_code,
+    ti_290t5_gray4_lut_code,
+};
+
 class ThinkInk_290_Grayscale4_T5 : public Adafruit_IL0373 {
  public:
   ThinkInk_290_Grayscale4_T5(int16_t SID, int16_t SCLK, int16_t DC, int16_t RST,
@@ -4,6 +4,21 @@
 // This file is #included by Adafruit_ThinkInk.h and does not need to
 // #include anything else to pick up the EPD header or ink mode enum.
 
+/// Layer 0 holds red and layer 1 black, both inverted
+static constexpr epd_panel_t thinkink_290_tricolor_z10 = {
+    296,
+    128,
+    THINKINK_TRICOLOR,
+    1,
+    true,
+    0,
+    true,
+    {0b00, 0b10, 0b01, 0b01, 0b10, 0b00, 0b00}, // EPD_WHITE .. EPD_YELLOW
+    13000,
+    NULL,
+    NULL,
+};
+
 class ThinkInk_290_Tricolor_Z10 : public Adafruit_IL0373 {
  public:
   ThinkInk_290_Tricolor_Z10(int16_t SID, int16_t SCLK, int16_t DC, int16_t RST,
@@ -17,20 +32,7 @@ class ThinkInk_290_Tricolor_Z10 : public Adafruit_IL0373 {
 
   void begin(thinkinkmode_t mode = THINKINK_TRICOLOR) {
     Adafruit_IL0373::begin(true);
-    setColorBuffer(0, true); // layer 0 uninverted
-    setBlackBuffer(1, true); // layer 1 uninverted
-
-    inkmode = mode; // Preserve ink mode for ImageReader or others
-
-    layer_colors[EPD_WHITE] = 0b00;
-    layer_colors[EPD_BLACK] = 0b10;
-    layer_colors[EPD_RED] = 0b01;
-    layer_colors[EPD_GRAY] = 0b01;
-    layer_colors[EPD_LIGHT] = 0b00;
-    layer_colors[EPD_DARK] = 0b10;
-
-    default_refresh_delay = 13000;
-
+    applyPanel(thinkink_290_tricolor_z10, mode);
     powerDown();
   }
 };
@@ -300,11 +300,7 @@ void Adafruit_GrayOLED::drawPixel(int16_t x, int16_t y, uint16_t color) {
       break;
     }
 
-    // adjust dirty window
-    window_x1 = min(window_x1, x);
-    window_y1 = min(window_y1, y);
-    window_x2 = max(window_x2, x);
-    window_y2 = max(window_y2, y);
+    markDirty(x, y, x, y);
 
     if (_bpp == 1) {
       switch (color) {
@@ -335,6 +331,134 @@ void Adafruit_GrayOLED::drawPixel(int16_t x, int16_t y, uint16_t color) {
   }
 }
 
+/*!
+    @brief  Fill a rectangle straight into the buffer, widening the dirty
+            window once for the whole rectangle rather than per pixel.
+            fillScreen(), the fast lines and the GFX text and shape fills
+            all end up here.
+    @param  x
+            Left column, in the current rotation.
+    @param  y
+            Top row, in the current rotation.
+    @param  w
+            Width in pixels.
+    @param  h
+            Height in pixels.
+    @param  color
+            MONOOLED_BLACK, MONOOLED_WHITE or MONOOLED_INVERSE on 1-bit
+            displays, a 4-bit gray level on 4-bit displays.
+    @note   Changes buffer contents only, no immediate effect on display.
+*/
+void Adafruit_GrayOLED::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                                 uint16_t color) {
+  // Clip in the current rotation
+  int16_t xa = max(x, (int16_t)0), ya = max(y, (int16_t)0);
+  int16_t xb = min((int16_t)(x + w - 1), (int16_t)(width() - 1));
+  int16_t yb = min((int16_t)(y + h - 1), (int16_t)(height() - 1));
+  if ((w <= 0) || (h <= 0) || (xa > xb) || (ya > yb)) {
+    return;
+  }
+
+  // The same rectangle in buffer coordinates (see drawPixel())
+  int16_t x1 = xa, y1 = ya, x2 = xb, y2 = yb;
+  switch (getRotation()) {
+  case 1:
+    x1 = WIDTH - 1 - yb;
+    x2 = WIDTH - 1 - ya;
+    y1 = xa;
+    y2 = xb;
+    break;
+  case 2:
+    x1 = WIDTH - 1 - xb;
+    x2 = WIDTH - 1 - xa;
+    y1 = HEIGHT - 1 - yb;
+    y2 = HEIGHT - 1 - ya;
+    break;
+  case 3:
+    x1 = ya;
+    x2 = yb;
+    y1 = HEIGHT - 1 - xb;
+    y2 = HEIGHT - 1 - xa;
+    break;
+  }
+  markDirty(x1, y1, x2, y2);
+
+  if (_bpp == 1) {
+    // Columns of one page share a mask of the rows inside it
+    for (int16_t page = y1 / 8; page <= y2 / 8; page++) {
+      int16_t top = max(y1, (int16_t)(page * 8));
+      int16_t bottom = min(y2, (int16_t)(page * 8 + 7));
+      uint8_t mask = (uint8_t)((0xFF << (top & 7)) & (0xFF >> (7 - (bottom & 7))));
+      uint8_t *ptr = &buffer[page * WIDTH + x1];
+      for (int16_t i = x1; i <= x2; i++, ptr++) {
+        switch (color) {
+        case MONOOLED_WHITE:
+          *ptr |= mask;
+          break;
+        case MONOOLED_BLACK:
+          *ptr &= ~mask;
+          break;
+        case MONOOLED_INVERSE:
+          *ptr ^= mask;
+          break;
+        }
+      }
+    }
+  }
+  if (_bpp == 4) {
+    // Odd edge columns by nibble, whole bytes in between
+    uint8_t level = color & 0xF;
+    uint8_t pair = (uint8_t)((level << 4) | level);
+    for (int16_t row = y1; row <= y2; row++) {
+      uint8_t *line = &buffer[row * WIDTH / 2];
+      int16_t first = x1, last = x2;
+      if (first & 1) {
+        line[first / 2] = (line[first / 2] & 0xF0) | level;
+        first++;
+      }
+      if (!(last & 1) && (last >= first)) {
+        line[last / 2] = (line[last / 2] & 0x0F) | (level << 4);
+        last--;
+      }
+      if (last > first) {
+        memset(&line[first / 2], pair, (last - first + 1) / 2);
+      }
+    }
+  }
+}
+
+/*!
+    @brief  Draw a horizontal line as a one-row fillRect().
+    @param  x
+            Left column, in the current rotation.
+    @param  y
+            Row, in the current rotation.
+    @param  w
+            Length in pixels.
+    @param  color
+            As for fillRect().
+*/
+void Adafruit_GrayOLED::drawFastHLine(int16_t x, int16_t y, int16_t w,
+                                      uint16_t color) {
+  fillRect(x, y, w, 1, color);
+}
+
+/*!
+    @brief  Draw a vertical line as a one-column fillRect().
+    @param  x
+            Column, in the current rotation.
+    @param  y
+            Top row, in the current rotation.
+    @param  h
+            Length in pixels.
+    @param  color
+            As for fillRect().
+*/
+void Adafruit_GrayOLED::drawFastVLine(int16_t x, int16_t y, int16_t h,
+                                      uint16_t color) {
+  fillRect(x, y, 1, h, color);
+}
+
 /*!
     @brief  Clear contents of display buffer (set all pixels to off).
     @note   Changes buffer contents only, no immediate effect on display.
@@ -390,6 +514,118 @@ bool Adafruit_GrayOLED::getPixel(int16_t x, int16_t y) {
 */
 uint8_t *Adafruit_GrayOLED::getBuffer(void) { return buffer; }
 
+// DIRTY WINDOW ------------------------------------------------------------
+
+/*!
+    @brief  Widen the dirty window to take in a rectangle.
+    @param  x1 Left column, in buffer (unrotated) pixels.
+    @param  y1 Top row, in buffer pixels.
+    @param  x2 Right column, in buffer pixels.
+    @param  y2 Bottom row, in buffer pixels.
+*/
+void Adafruit_GrayOLED::markDirty(int16_t x1, int16_t y1, int16_t x2,
+                                  int16_t y2) {
+  window_x1 = min(window_x1, x1);
+  window_y1 = min(window_y1, y1);
+  window_x2 = max(window_x2, x2);
+  window_y2 = max(window_y2, y2);
+}
+
+/*!
+    @brief  Get the part of the buffer changed since the last markClean().
+    @param  x1 Receives the left column, in buffer (unrotated) pixels.
+    @param  y1 Receives the top row.
+    @param  x2 Receives the right column.
+    @param  y2 Receives the bottom row.
+    @return false if nothing changed; the coordinates are then undefined.
+*/
+bool Adafruit_GrayOLED::getDirtyWindow(int16_t &x1, int16_t &y1, int16_t &x2,
+                                       int16_t &y2) {
+  x1 = window_x1;
+  y1 = window_y1;
+  x2 = window_x2;
+  y2 = window_y2;
+  return (x1 <= x2) && (y1 <= y2);
+}
+
+/*!
+    @brief  Empty the dirty window, as after the buffer has been sent.
+            Subclasses' display() calls this (oled_displayWindow() does).
+*/
+void Adafruit_GrayOLED::markClean(void) {
+  window_x1 = INT16_MAX;
+  window_y1 = INT16_MAX;
+  window_x2 = -1;
+  window_y2 = -1;
+}
+
+/*!
+    @brief  Send only the dirty window of the buffer, for subclasses'
+            display(), then empty the window.
+    @param  colCmd
+            Controller command taking the first and last column address:
+            byte columns (two pixels each) on 4-bit displays, such as
+            0x15 on the SSD1327, pixel columns on 1-bit displays, such as
+            0x21 on the SSD1306.
+    @param  rowCmd
+            Controller command taking the first and last row address:
+            pixel rows on 4-bit displays (0x75 on the SSD1327), 8-row
+            pages on 1-bit displays (0x22 on the SSD1306).
+    @param  colOffset
+            Added to the column addresses, for panels that don't start at
+            the controller's column 0.
+    @return true if the window was sent, or nothing had changed; false on
+            a bus error, and the window is then kept for the next call.
+    @note   With SPI the caller holds the transaction, as for
+            oled_command(). Each row (4-bit) or page (1-bit) is a
+            separate write, so other devices on a shared bus get a turn
+            between them.
+*/
+bool Adafruit_GrayOLED::oled_displayWindow(uint8_t colCmd, uint8_t rowCmd,
+                                           uint8_t colOffset) {
+  int16_t x1, y1, x2, y2;
+  if (!getDirtyWindow(x1, y1, x2, y2)) {
+    return true;
+  }
+  // Whole bytes: 4-bit rows pack two pixels per byte, 1-bit pages eight rows
+  int16_t first = (_bpp == 4) ? x1 / 2 : x1;
+  int16_t last = (_bpp == 4) ? x2 / 2 : x2;
+  int16_t top = (_bpp == 4) ? y1 : y1 / 8;
+  int16_t bottom = (_bpp == 4) ? y2 : y2 / 8;
+  uint16_t stride = (_bpp == 4) ? WIDTH / 2 : WIDTH;
+  uint8_t cmd[] = {colCmd,
+                   (uint8_t)(colOffset + first),
+                   (uint8_t)(colOffset + last),
+                   rowCmd,
+                   (uint8_t)top,
+                   (uint8_t)bottom};
+  if (!oled_commandList(cmd, sizeof(cmd))) {
+    return false;
+  }
+
+  size_t span = last - first + 1;
+  for (int16_t row = top; row <= bottom; row++) {
+    const uint8_t *data = &buffer[row * stride + first];
+    if (i2c_dev) {
+      uint8_t dc_byte = 0x40; // Co = 0, D/C = 1
+      size_t chunk = i2c_dev->maxBufferSize() - 1;
+      for (size_t sent = 0; sent < span; sent += chunk) {
+        if (!i2c_dev->write(data + sent, min(chunk, span - sent), true,
+                            &dc_byte, 1)) {
+          return false;
+        }
+      }
+    } else {
+      digitalWrite(dcPin, HIGH);
+      if (!spi_dev->write(data, span)) {
+        return false;
+      }
+    }
+  }
+  markClean();
+  return true;
+}
+
 // OTHER HARDWARE SETTINGS -------------------------------------------------
 
 /*!
@@ -68,14 +68,22 @@ public:
   void invertDisplay(bool i);
   void setContrast(uint8_t contrastlevel);
   void drawPixel(int16_t x, int16_t y, uint16_t color);
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
   bool getPixel(int16_t x, int16_t y);
   uint8_t *getBuffer(void);
+  bool getDirtyWindow(int16_t &x1, int16_t &y1, int16_t &x2, int16_t &y2);
+  void markClean(void);
 
   void oled_command(uint8_t c);
   bool oled_commandList(const uint8_t *c, uint8_t n);
 
 protected:
   bool _init(uint8_t i2caddr = 0x3C, bool reset = true);
+  void markDirty(int16_t x1, int16_t y1, int16_t x2, int16_t y2);
+  bool oled_displayWindow(uint8_t colCmd, uint8_t rowCmd,
+                          uint8_t colOffset = 0);
 
   Adafruit_SPIDevice *spi_dev = NULL; ///< The SPI interface BusIO device
   Adafruit_I2CDevice *i2c_dev = NULL; ///< The I2C interface BusIO device
@@ -83,6 +91,7 @@ protected:
       i2c_postclk = 100000;           ///< Configurable 'low speed' I2C rate
   uint8_t *buffer = NULL; ///< Internal 1:1 framebuffer of display mem
 
+  // Dirty window in buffer (unrotated) pixels; empty when x1 > x2
   int16_t window_x1, ///< Dirty tracking window minimum x
       window_y1,     ///< Dirty tracking window minimum y
       window_x2,     ///< Dirty tracking window maximum x
@@ -61,6 +61,25 @@
 #define digitalPinToPort(P) (&(PORT_IOBUS->Group[g_APinDescription[P].ulPort]))
 #endif // end PORT_IOBUS
 
+#if defined(USE_ESPIDF_SPI_DMA)
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_memory_utils.h"
+#include <new>
+
+static const char *TAG_TFT = "SPITFT";
+
+// A staging buffer's last queued write finished: free it for dmaStage().
+// Runs from the SPI driver's post-transaction ISR
+static void IRAM_ATTR dmaDone(void *arg) {
+  BaseType_t woken = pdFALSE;
+  xSemaphoreGiveFromISR((SemaphoreHandle_t)arg, &woken);
+  if (woken) {
+    portYIELD_FROM_ISR();
+  }
+}
+#endif // end USE_ESPIDF_SPI_DMA
+
 #if defined(USE_SPI_DMA) && (defined(__SAMD51__) || defined(ARDUINO_SAMD_ZERO))
 // #pragma message ("GFX DMA IS ENABLED. HIGHLY EXPERIMENTAL.")
 #include "wiring_private.h" // pinPeripheral() function
@@ -511,6 +530,16 @@ Adafruit_SPITFT::Adafruit_SPITFT(uint16_t w, uint16_t h, tftBusWidth busWidth,
 #endif // end USE_FAST_PINIO
 }
 
+/*!
+    @brief  Adafruit_SPITFT destructor. Releases the ESP-IDF SPI device and
+            DMA buffers, if initSPI() made them.
+*/
+Adafruit_SPITFT::~Adafruit_SPITFT() {
+#if defined(USE_ESPIDF_SPI_DMA)
+  espSpiEnd();
+#endif
+}
+
 // end constructors -------
 
 // CLASS MEMBER FUNCTIONS --------------------------------------------------
@@ -593,6 +622,9 @@ void Adafruit_SPITFT::initSPI(uint32_t freq, uint8_t spiMode) {
     ) {
       hwspi._spi->begin();
     }
+#if defined(USE_ESPIDF_SPI_DMA)
+    espSpiBegin(freq, spiMode);
+#endif
   } else if (connection == TFT_SOFT_SPI) {
 
     pinMode(swspi._mosi, OUTPUT);
@@ -900,12 +932,107 @@ void Adafruit_SPITFT::initSPI(uint32_t freq, uint8_t spiMode) {
 #endif // end USE_SPI_DMA
 }
 
+#if defined(USE_ESPIDF_SPI_DMA)
+/*!
+    @brief  Give a hardware SPI display its own Adafruit_SPIDevice on the
+            bus, with CS and DC driven per transaction, and the two DMA
+            staging buffers writePixels() and writeColor() queue from.
+            Without them hardware SPI stays on the SPIClass calls.
+    @param  freq     SPI frequency.
+    @param  spiMode  SPI_MODE0 to SPI_MODE3.
+    @return true if the device and buffers are set up.
+*/
+bool Adafruit_SPITFT::espSpiBegin(uint32_t freq, uint8_t spiMode) {
+  espSpiEnd();
+  if (_cs < 0) {
+    ESP_LOGW(TAG_TFT, "No CS pin, no DMA device");
+    return false;
+  }
+  espSpi = new (std::nothrow) Adafruit_SPIDevice(
+      _cs, freq, SPI_BITORDER_MSBFIRST, spiMode, hwspi._spi);
+  bool ok = espSpi != NULL;
+  if (ok) {
+    espSpi->setDataCommandPin(_dc);
+    ok = espSpi->begin();
+  }
+  for (uint8_t i = 0; ok && i < 2; i++) {
+    dmaBuf[i] = (uint16_t *)heap_caps_malloc(TFT_DMA_PIXELS * 2,
+                                             MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+    dmaFree[i] = xSemaphoreCreateBinary();
+    ok = dmaBuf[i] != NULL && dmaFree[i] != NULL;
+    if (ok) {
+      xSemaphoreGive(dmaFree[i]);
+    }
+  }
+  if (!ok) {
+    ESP_LOGW(TAG_TFT, "DMA setup failed, writing through SPIClass");
+    espSpiEnd();
+    return false;
+  }
+  espSpi->setDC(true);
+  dmaNext = 0;
+  return true;
+}
+
+/*!
+    @brief  Drain queued writes and free what espSpiBegin() made.
+*/
+void Adafruit_SPITFT::espSpiEnd(void) {
+  if (espSpi) {
+    espSpi->waitAsync();
+    delete espSpi;
+    espSpi = NULL;
+  }
+  for (uint8_t i = 0; i < 2; i++) {
+    heap_caps_free(dmaBuf[i]);
+    dmaBuf[i] = NULL;
+    if (dmaFree[i]) {
+      vSemaphoreDelete(dmaFree[i]);
+      dmaFree[i] = NULL;
+    }
+  }
+}
+
+/*!
+    @brief  Take the next staging buffer, waiting (without spinning) until
+            the write last queued from it is off the bus.
+    @return TFT_DMA_PIXELS pixels to fill and hand to dmaQueue().
+*/
+uint16_t *Adafruit_SPITFT::dmaStage(void) {
+  uint8_t i = dmaNext;
+  dmaNext ^= 1;
+  xSemaphoreTake(dmaFree[i], portMAX_DELAY);
+  return dmaBuf[i];
+}
+
+/*!
+    @brief  Queue len big-endian pixels from a staging buffer.
+    @param  buf   Buffer from dmaStage().
+    @param  len   Pixels, at most TFT_DMA_PIXELS.
+    @param  last  false to queue the same buffer again (writeColor()); the
+                  buffer is freed when the last write of it finishes.
+*/
+void Adafruit_SPITFT::dmaQueue(uint16_t *buf, uint32_t len, bool last) {
+  SemaphoreHandle_t done = dmaFree[buf == dmaBuf[0] ? 0 : 1];
+  bool queued = espSpi->writeAsync((const uint8_t *)buf, len * 2,
+                                   last ? dmaDone : NULL, last ? done : NULL);
+  if (!queued && last) {
+    espSpi->waitAsync();
+    xSemaphoreGive(done);
+  }
+}
+#endif // end USE_ESPIDF_SPI_DMA
+
 /*!
     @brief  Allow changing the SPI clock speed after initialization
     @param  freq Desired frequency of SPI clock, may not be the
     end frequency you get based on what the chip can do!
 */
 void Adafruit_SPITFT::setSPISpeed(uint32_t freq) {
+#if defined(USE_ESPIDF_SPI_DMA)
+  if (espSpi)
+    espSpi->setFrequency(freq);
+#endif
 #if defined(SPI_HAS_TRANSACTION)
   hwspi.settings = SPISettings(freq, MSBFIRST, hwspi._mode);
 #else
@@ -1012,6 +1139,33 @@ void Adafruit_SPITFT::writePixels(uint16_t *colors, uint32_t len, bool block,
   (void)block;
   (void)bigEndian;
 
+#if defined(USE_ESPIDF_SPI_DMA)
+  if (espSpi) {
+    // Already big-endian and DMA-readable: queue the caller's buffer as it
+    // is; it must stay untouched until dmaWait()
+    if (bigEndian && !block && esp_ptr_dma_capable(colors) &&
+        ((uintptr_t)colors & 3) == 0) {
+      espSpi->writeAsync((const uint8_t *)colors, len * 2);
+      return;
+    }
+    // Otherwise copied (and swapped) into the staging buffers, so colors
+    // is free on return and the bus drains while the caller draws on;
+    // later writes and endWrite() queue behind it
+    while (len) {
+      uint32_t count = (len < TFT_DMA_PIXELS) ? len : TFT_DMA_PIXELS;
+      uint16_t *buf = dmaStage();
+      if (bigEndian) {
+        memcpy(buf, colors, count * 2);
+      } else {
+        swapBytes(colors, count, buf);
+      }
+      dmaQueue(buf, count);
+      colors += count;
+      len -= count;
+    }
+    return;
+  }
+#endif
 #if defined(ESP32)
   if (connection == TFT_HARD_SPI) {
     if (!bigEndian) {
@@ -1176,6 +1330,10 @@ void Adafruit_SPITFT::writePixels(uint16_t *colors, uint32_t len, bool block,
             was used (as is the default case).
 */
 void Adafruit_SPITFT::dmaWait(void) {
+#if defined(USE_ESPIDF_SPI_DMA)
+  if (espSpi)
+    espSpi->waitAsync();
+#endif
 #if defined(USE_SPI_DMA) && (defined(__SAMD51__) || defined(ARDUINO_SAMD_ZERO))
   while (dma_busy)
     ;
@@ -1196,6 +1354,10 @@ void Adafruit_SPITFT::dmaWait(void) {
     @return true if DMA is enabled and transmitting data, false otherwise.
 */
 bool Adafruit_SPITFT::dmaBusy(void) const {
+#if defined(USE_ESPIDF_SPI_DMA)
+  if (espSpi)
+    return espSpi->pendingAsync() > 0; // queued and not yet collected
+#endif
 #if defined(USE_SPI_DMA) && (defined(__SAMD51__) || defined(ARDUINO_SAMD_ZERO))
   return dma_busy;
 #else
@@ -1216,6 +1378,23 @@ void Adafruit_SPITFT::writeColor(uint16_t color, uint32_t len) {
 
   uint8_t hi = color >> 8, lo = color;
 
+#if defined(USE_ESPIDF_SPI_DMA)
+  if (espSpi) {
+    // One staging buffer of the color, queued as often as the run needs
+    uint32_t count = (len < TFT_DMA_PIXELS) ? len : TFT_DMA_PIXELS;
+    uint16_t *buf = dmaStage();
+    uint16_t swapped = (uint16_t)(lo << 8 | hi);
+    for (uint32_t i = 0; i < count; i++) {
+      buf[i] = swapped;
+    }
+    while (len) {
+      uint32_t n = (len < count) ? len : count;
+      len -= n;
+      dmaQueue(buf, n, len == 0);
+    }
+    return;
+  }
+#endif
 #if defined(ESP32) // ESP32 has a special SPI pixel-writing function...
   if (connection == TFT_HARD_SPI) {
 #define SPI_MAX_PIXELS_AT_ONCE 32
@@ -2120,6 +2299,12 @@ uint16_t Adafruit_SPITFT::readcommand16(uint16_t addr) {
 */
 inline void Adafruit_SPITFT::SPI_BEGIN_TRANSACTION(void) {
   if (connection == TFT_HARD_SPI) {
+#if defined(USE_ESPIDF_SPI_DMA)
+    if (espSpi) {
+      espSpi->beginTransaction(); // Holds the bus until endWrite()
+      return;
+    }
+#endif
 #if defined(SPI_HAS_TRANSACTION)
     hwspi._spi->beginTransaction(hwspi.settings);
 #else // No transactions, configure SPI manually...
@@ -2147,6 +2332,12 @@ inline void Adafruit_SPITFT::SPI_BEGIN_TRANSACTION(void) {
             function that encapsulated both actions.
 */
 inline void Adafruit_SPITFT::SPI_END_TRANSACTION(void) {
+#if defined(USE_ESPIDF_SPI_DMA)
+  if (espSpi) {
+    espSpi->endTransaction(); // Drains the queue, then frees the bus
+    return;
+  }
+#endif
 #if defined(SPI_HAS_TRANSACTION)
   if (connection == TFT_HARD_SPI) {
     hwspi._spi->endTransaction();
@@ -2164,6 +2355,12 @@ inline void Adafruit_SPITFT::SPI_END_TRANSACTION(void) {
     @param  b  8-bit value to write.
 */
 void Adafruit_SPITFT::spiWrite(uint8_t b) {
+#if defined(USE_ESPIDF_SPI_DMA)
+  if (espSpi) {
+    espSpi->writeAsync(&b, 1); // Copied; queues behind any pixels
+    return;
+  }
+#endif
   if (connection == TFT_HARD_SPI) {
 #if defined(__AVR__)
     AVR_WRITESPI(b);
@@ -2226,6 +2423,10 @@ uint8_t Adafruit_SPITFT::spiRead(void) {
   uint8_t b = 0;
   uint16_t w = 0;
   if (connection == TFT_HARD_SPI) {
+#if defined(USE_ESPIDF_SPI_DMA)
+    if (espSpi)
+      return espSpi->transfer((uint8_t)0);
+#endif
     return hwspi._spi->transfer((uint8_t)0);
   } else if (connection == TFT_SOFT_SPI) {
     if (swspi._miso >= 0) {
@@ -2448,6 +2649,13 @@ inline bool Adafruit_SPITFT::SPI_MISO_READ(void) {
     @param  w  16-bit value to write.
 */
 void Adafruit_SPITFT::SPI_WRITE16(uint16_t w) {
+#if defined(USE_ESPIDF_SPI_DMA)
+  if (espSpi) {
+    uint8_t buf[2] = {(uint8_t)(w >> 8), (uint8_t)w};
+    espSpi->writeAsync(buf, 2); // Copied into the transaction
+    return;
+  }
+#endif
   if (connection == TFT_HARD_SPI) {
 #if defined(__AVR__)
     AVR_WRITESPI(w >> 8);
@@ -2504,6 +2712,14 @@ void Adafruit_SPITFT::SPI_WRITE16(uint16_t w) {
     @param  l  32-bit value to write.
 */
 void Adafruit_SPITFT::SPI_WRITE32(uint32_t l) {
+#if defined(USE_ESPIDF_SPI_DMA)
+  if (espSpi) {
+    uint8_t buf[4] = {(uint8_t)(l >> 24), (uint8_t)(l >> 16), (uint8_t)(l >> 8),
+                      (uint8_t)l};
+    espSpi->writeAsync(buf, 4); // Copied into the transaction
+    return;
+  }
+#endif
   if (connection == TFT_HARD_SPI) {
 #if defined(__AVR__)
     AVR_WRITESPI(l >> 24);
@@ -92,6 +92,20 @@ typedef volatile ADAGFX_PORT_t *PORTreg_t; ///< PORT register type
 #include <Adafruit_ZeroDMA.h>
 #endif
 
+// ESP-IDF through the Adafruit_BusIO_ESPIDF shim (not arduino-esp32, whose
+// Arduino.h has another guard): hardware SPI goes through an
+// Adafruit_SPIDevice of the display's own, and writePixels()/writeColor()
+// queue DMA writes from two staging buffers, one filling while the other
+// is on the bus.
+#if defined(ESP_PLATFORM) && defined(ARDUINO_H)
+#define USE_ESPIDF_SPI_DMA ///< Queued DMA through Adafruit_SPIDevice
+#include "Adafruit_SPIDevice.h"
+#include "freertos/semphr.h"
+#ifndef TFT_DMA_PIXELS
+#define TFT_DMA_PIXELS 1024 ///< Pixels per DMA staging buffer, 2 buffers
+#endif
+#endif
+
 // This is kind of a kludge. Needed a way to disambiguate the software SPI
 // and parallel constructors via their argument lists. Originally tried a
 // bool as the first argument to the parallel constructor (specifying 8-bit
@@ -168,7 +182,7 @@ public:
 
   // DESTRUCTOR ----------------------------------------------------------
 
-  ~Adafruit_SPITFT(){};
+  ~Adafruit_SPITFT();
 
   // CLASS MEMBER FUNCTIONS ----------------------------------------------
 
@@ -311,6 +325,10 @@ public:
     *csPort |= csPinMaskSet;
 #endif // end !HAS_PORT_SET_CLR
 #else  // !USE_FAST_PINIO
+#if defined(USE_ESPIDF_SPI_DMA)
+    if (espSpi)
+      return; // The driver selects the display for each transaction
+#endif
     digitalWrite(_cs, HIGH);
 #endif // end !USE_FAST_PINIO
   }
@@ -333,6 +351,10 @@ public:
     *csPort &= csPinMaskClr;
 #endif // end !HAS_PORT_SET_CLR
 #else  // !USE_FAST_PINIO
+#if defined(USE_ESPIDF_SPI_DMA)
+    if (espSpi)
+      return; // The driver selects the display for each transaction
+#endif
     digitalWrite(_cs, LOW);
 #endif // end !USE_FAST_PINIO
   }
@@ -352,6 +374,12 @@ public:
     *dcPort |= dcPinMaskSet;
 #endif // end !HAS_PORT_SET_CLR
 #else  // !USE_FAST_PINIO
+#if defined(USE_ESPIDF_SPI_DMA)
+    if (espSpi) {
+      espSpi->setDC(true); // Rides on the transactions queued from now on
+      return;
+    }
+#endif
     digitalWrite(_dc, HIGH);
 #endif // end !USE_FAST_PINIO
   }
@@ -371,6 +399,12 @@ public:
     *dcPort &= dcPinMaskClr;
 #endif // end !HAS_PORT_SET_CLR
 #else  // !USE_FAST_PINIO
+#if defined(USE_ESPIDF_SPI_DMA)
+    if (espSpi) {
+      espSpi->setDC(false); // Rides on the transactions queued from now on
+      return;
+    }
+#endif
     digitalWrite(_dc, LOW);
 #endif // end !USE_FAST_PINIO
   }
@@ -391,6 +425,12 @@ protected:
   inline void TFT_WR_STROBE(void); // Parallel interface write strobe
   inline void TFT_RD_HIGH(void);   // Parallel interface read high
   inline void TFT_RD_LOW(void);    // Parallel interface read low
+#if defined(USE_ESPIDF_SPI_DMA)
+  bool espSpiBegin(uint32_t freq, uint8_t spiMode);
+  void espSpiEnd(void);
+  uint16_t *dmaStage(void);
+  void dmaQueue(uint16_t *buf, uint32_t len, bool last = true);
+#endif
 
   // CLASS INSTANCE VARIABLES --------------------------------------------
 
@@ -511,6 +551,12 @@ protected:
   uint32_t lastFillLen = 0;          ///< # of pixels w/last fill
   uint8_t onePixelBuf;               ///< For hi==lo fill
 #endif
+#if defined(USE_ESPIDF_SPI_DMA)
+  Adafruit_SPIDevice *espSpi = NULL;           ///< Display's device, or NULL
+  uint16_t *dmaBuf[2] = {NULL, NULL};          ///< Big-endian staging
+  SemaphoreHandle_t dmaFree[2] = {NULL, NULL}; ///< Given when drained
+  uint8_t dmaNext = 0;                         ///< dmaBuf filled next
+#endif
 #if defined(USE_FAST_PINIO)
 #if defined(HAS_PORT_SET_CLR)
 #if !defined(KINETISK)
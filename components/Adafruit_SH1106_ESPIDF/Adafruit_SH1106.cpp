@@ -33,21 +33,24 @@ static const uint8_t sh1106_init_sequence[] = {
 
 Adafruit_SH1106::Adafruit_SH1106(uint16_t w, uint16_t h, TwoWire *twi, 
                                  int8_t rst_pin, uint8_t i2caddr)
-    : Adafruit_GFX(w, h), i2c_dev(nullptr), buffer(nullptr), 
-      rstpin(rst_pin), i2caddr(i2caddr), vccstate(SH1106_SWITCHCAPVCC) {
+    : Adafruit_GFX(w, h), i2c_dev(nullptr), buffer(nullptr), shown(nullptr),
+      shown_valid(false), async(false), page_cmds(), rstpin(rst_pin), i2caddr(i2caddr), vccstate(SH1106_SWITCHCAPVCC) {
     // Note: TwoWire* is not used in ESP-IDF implementation, but kept for compatibility
     (void)twi;
 }
 
 Adafruit_SH1106::~Adafruit_SH1106() {
-    if (buffer) {
-        free(buffer);
-        buffer = nullptr;
-    }
+    // First, so queued writes are done with shown
     if (i2c_dev) {
         delete i2c_dev;
         i2c_dev = nullptr;
     }
+    if (buffer) {
+        free(buffer);
+        buffer = nullptr;
+    }
+    free(shown);
+    shown = nullptr;
 }
 
 bool Adafruit_SH1106::begin(uint8_t i2caddr, bool reset) {
@@ -66,6 +69,11 @@ bool Adafruit_SH1106::begin(uint8_t i2caddr, bool reset) {
         }
         memset(buffer, 0, (WIDTH * HEIGHT) / 8);
     }
+    // Without the copy every display() is a full upload
+    if (!shown) {
+        shown = (uint8_t*)malloc((WIDTH * HEIGHT) / 8);
+    }
+    shown_valid = false;
     
     // Create or recreate I2C device if needed or address changed
     if (!i2c_dev || address_changed) {
@@ -137,31 +145,91 @@ void Adafruit_SH1106::dim(bool dim) {
     sh1106_command(contrast);
 }
 
+void Adafruit_SH1106::setPower(bool on) {
+    sh1106_command(on ? SH1106_DISPLAYON : SH1106_DISPLAYOFF);
+}
+
 void Adafruit_SH1106::display(void) {
     if (!buffer || !i2c_dev) {
         return;
     }
+    finishAsync();
+    
+    // Queued writes send from shown, so drawing can go on meanwhile
+    bool queued = async && shown;
     
     // SH1106 uses page addressing mode
     // Each page is 8 pixels tall, 128 pixels wide
     // There are 8 pages (64 pixels / 8 = 8 pages)
-    for (uint8_t page = 0; page < 8; page++) {
-        // SH1106 requires setting the page address and column address for each page
-        // Unlike SSD1306, it doesn't support automatic page increment or the 0x21/0x22 commands
+    static const uint8_t cmd_prefix = 0x00;  // Command mode
+    static const uint8_t data_prefix = 0x40; // Data mode
+    bool sent = true;
+    for (uint8_t page = 0; page < HEIGHT / 8; page++) {
+        uint8_t *page_buffer = buffer + (page * WIDTH);
         
-        // 1. Set Page Address (0xB0 - 0xB7)
-        sh1106_command(0xB0 + page);
+        // Only the span between the first and last changed column; a status
+        // redraw typically touches a few characters of one or two pages
+        int16_t first = 0;
+        int16_t last = WIDTH - 1;
+        if (shown && shown_valid) {
+            const uint8_t *page_shown = shown + (page * WIDTH);
+            while (first < WIDTH && page_buffer[first] == page_shown[first]) {
+                first++;
+            }
+            if (first == WIDTH) {
+                continue;
+            }
+            while (page_buffer[last] == page_shown[last]) {
+                last--;
+            }
+        }
+        size_t span = last - first + 1;
         
-        // 2. Set Column Address (offset by 0 for 128 pixel wide displays left-aligned in 132 RAM)
-        // Lower 4 bits of column start address (0x00 - 0x0F) -> 0 & 0x0F = 0x00
-        sh1106_command(0x00 | 0x00); 
-        // Higher 4 bits of column start address (0x10 - 0x1F) -> 0 >> 4 = 0x00 -> 0x10
-        sh1106_command(0x10 | 0x00);
+        // SH1106 requires setting the page address and column address for each page
+        // Unlike SSD1306, it doesn't support automatic page increment or the 0x21/0x22 commands.
+        // One command stream: page (0xB0 - 0xB7), then the column's lower and
+        // higher 4 bits (0x00 - 0x0F, 0x10 - 0x1F); column 0 is the left edge
+        // of 128 pixel wide displays left-aligned in 132 RAM
+        uint8_t *cmd = page_cmds[page];
+        cmd[0] = 0xB0 + page;
+        cmd[1] = 0x00 | (first & 0x0F);
+        cmd[2] = 0x10 | (first >> 4);
         
-        // Send page data with data mode prefix (0x40)
-        uint8_t *page_buffer = buffer + (page * WIDTH);
-        uint8_t data_prefix = 0x40; // Data mode
-        i2c_dev->write(page_buffer, WIDTH, true, &data_prefix, 1);
+        if (queued) {
+            uint8_t *page_shown = shown + (page * WIDTH) + first;
+            memcpy(page_shown, page_buffer + first, span);
+            sent &= i2c_dev->writeAsync(cmd, 3, &cmd_prefix, 1);
+            sent &= i2c_dev->writeAsync(page_shown, span, &data_prefix, 1);
+        } else {
+            sent &= i2c_dev->write(cmd, 3, true, &cmd_prefix, 1);
+            sent &= i2c_dev->write(page_buffer + first, span, true, &data_prefix, 1);
+        }
+    }
+    
+    // After a failed write the panel's contents are unknown: send it all next
+    // time. Queued writes that fail are caught by finishAsync()
+    if (shown) {
+        if (!queued) {
+            memcpy(shown, buffer, (WIDTH * HEIGHT) / 8);
+        }
+        shown_valid = sent;
+    }
+}
+
+uint32_t Adafruit_SH1106::negotiateClock(const uint32_t *clocks, size_t count) {
+    if (!i2c_dev) {
+        return 0;
+    }
+    finishAsync();
+    
+    // A NOP in command mode: acknowledged, changes nothing
+    static const uint8_t nop[2] = {0x00, SH1106_NOP};
+    return i2c_dev->negotiateSpeed(clocks, count, nop, sizeof(nop));
+}
+
+void Adafruit_SH1106::finishAsync(void) {
+    if (i2c_dev && !i2c_dev->waitAsync()) {
+        shown_valid = false;
     }
 }
 
@@ -247,6 +315,9 @@ void Adafruit_SH1106::sh1106_command(uint8_t c) {
         return;
     }
     
+    // After any queued upload, so commands keep their order
+    finishAsync();
+    
     // I2C command: send 0x00 (command mode) followed by command byte
     uint8_t cmd[2] = {0x00, c};
     i2c_dev->write(cmd, 2);
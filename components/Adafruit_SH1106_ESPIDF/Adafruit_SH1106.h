@@ -23,6 +23,7 @@
 #define SH1106_INVERTDISPLAY 0xA7
 #define SH1106_DISPLAYOFF 0xAE
 #define SH1106_DISPLAYON 0xAF
+#define SH1106_NOP 0xE3
 #define SH1106_SETDISPLAYOFFSET 0xD3
 #define SH1106_SETCOMPINS 0xDA
 #define SH1106_SETVCOMDETECT 0xDB
@@ -97,11 +98,37 @@ public:
      */
     void dim(bool dim);
     
+    /**
+     * @brief Switch the panel on or off (sleep mode); RAM is kept
+     * @param on If false, the panel goes dark and draws almost nothing
+     */
+    void setPower(bool on);
+    
     /**
      * @brief Display the buffer on screen
+     *
+     * Only the columns that changed since the last upload are sent, one span
+     * per page; the first call after begin() sends everything. With
+     * setAsync(true) the spans are queued and display() returns at once; the
+     * buffer may be drawn into straight away, and the next display() or
+     * command waits for the queued writes first.
      */
     void display(void);
     
+    /**
+     * @brief Queue display() uploads on the I2C worker instead of blocking
+     * @param on Needs the copy begin() allocates for diffing; ignored without
+     */
+    void setAsync(bool on) { async = on; }
+    
+    /**
+     * @brief Run the I2C clock as fast as the panel acknowledges
+     * @param clocks Clocks in Hz to try, fastest first
+     * @param count Number of clocks
+     * @return The clock chosen, 0 if none worked
+     */
+    uint32_t negotiateClock(const uint32_t *clocks, size_t count);
+    
     /**
      * @brief Start scrolling display
      */
@@ -136,6 +163,10 @@ public:
 private:
     Adafruit_I2CDevice *i2c_dev;
     uint8_t *buffer;
+    uint8_t *shown;      // What the panel RAM holds, for display() to diff
+    bool shown_valid;    // false until the first full upload
+    bool async;          // setAsync()
+    uint8_t page_cmds[8][3];  // Page and column commands, kept for queued writes
     int8_t rstpin;
     uint8_t i2caddr;
     bool vccstate;
@@ -159,5 +190,11 @@ private:
      * @return true if successful
      */
     bool initDisplay(void);
+    
+    /**
+     * @brief Wait for queued display() writes; a failed one means the next
+     *        display() sends everything
+     */
+    void finishAsync(void);
 };
 
@@ -0,0 +1,171 @@
+/**
+ * @file animation.cpp
+ * @brief Animation loading and playback
+ */
+
+#include "animation.hpp"
+#include "config.hpp"
+#include "sd_card.hpp"
+#include "esp_log.h"
+#include "../components/Adafruit_EPD/src/Adafruit_EPD.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <new>
+
+static const char* TAG_ANIM = "Animation";
+
+static std::unique_ptr<uint8_t[]> s_data;
+static size_t s_size = 0;
+static size_t s_loopStart = 0;  // First frame after the key frame
+static size_t s_next = 0;       // Frame step() draws next
+static TickType_t s_period = 0;
+static TickType_t s_lastStepTick = 0;
+static TickType_t s_lastFullTick = 0;
+
+static size_t frameBytes(const Animation::FrameHeader& frame)
+{
+    return sizeof(frame) + static_cast<size_t>((frame.width + 3) / 4) * frame.height;
+}
+
+/**
+ * @brief Check that the frames fill the data exactly and lie on the display
+ */
+static bool validFrames(const Animation::FileHeader& header)
+{
+    size_t offset = sizeof(header);
+    for (uint16_t i = 0; i < header.frameCount; i++) {
+        Animation::FrameHeader frame;
+        if (s_size - offset < sizeof(frame)) {
+            return false;
+        }
+        memcpy(&frame, &s_data[offset], sizeof(frame));
+        if (frame.x + frame.width > header.width || frame.y + frame.height > header.height ||
+            s_size - offset < frameBytes(frame)) {
+            return false;
+        }
+        offset += frameBytes(frame);
+    }
+    return offset == s_size;
+}
+
+bool Animation::open(const char* imagePath, const Adafruit_EPD& display)
+{
+    close();
+    const char* dot = strrchr(imagePath, '.');
+    if (!dot) {
+        return false;
+    }
+    char path[SDCard::ImageList::MAX_PATH];
+    int stem = static_cast<int>(dot - imagePath);
+    if (snprintf(path, sizeof(path), "%.*s%s", stem, imagePath, ANIMATION_EXTENSION) >=
+        static_cast<int>(sizeof(path))) {
+        return false;
+    }
+
+    SDCard::BusBurst burst;
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        size = ftell(file);
+    }
+    if (size < static_cast<long>(sizeof(FileHeader)) ||
+        static_cast<size_t>(size) > ANIMATION_MAX_BYTES) {
+        ESP_LOGW(TAG_ANIM, "%s: %ld bytes, at most %zu", path, size, ANIMATION_MAX_BYTES);
+        fclose(file);
+        return false;
+    }
+    s_data.reset(new (std::nothrow) uint8_t[size]);
+    s_size = static_cast<size_t>(size);
+    bool ok = s_data && fseek(file, 0, SEEK_SET) == 0 &&
+              fread(s_data.get(), 1, s_size, file) == s_size;
+    fclose(file);
+
+    FileHeader header = {};
+    if (ok) {
+        memcpy(&header, s_data.get(), sizeof(header));
+    }
+    if (!ok || header.magic != MAGIC || header.version != VERSION || header.frameCount < 2 ||
+        header.width != display.width() || header.height != display.height() ||
+        !validFrames(header)) {
+        ESP_LOGE(TAG_ANIM, "%s is damaged or for another display size", path);
+        close();
+        return false;
+    }
+
+    FrameHeader key;
+    memcpy(&key, &s_data[sizeof(header)], sizeof(key));
+    s_loopStart = sizeof(header) + frameBytes(key);
+    s_next = sizeof(header);
+    s_period = pdMS_TO_TICKS(std::max<uint32_t>(header.frameMs, ANIMATION_MIN_FRAME_MS));
+    // The slide's own refresh was the full one; the key frame is due now
+    s_lastFullTick = xTaskGetTickCount();
+    s_lastStepTick = s_lastFullTick - s_period;
+    ESP_LOGI(TAG_ANIM, "%s: %u frames, every %" PRIu32 " ms", path, header.frameCount - 1,
+             static_cast<uint32_t>(pdTICKS_TO_MS(s_period)));
+    return true;
+}
+
+void Animation::close()
+{
+    s_data.reset();
+    s_size = 0;
+}
+
+bool Animation::active()
+{
+    return s_data != nullptr;
+}
+
+TickType_t Animation::ticksUntilDue()
+{
+    if (!s_data) {
+        return portMAX_DELAY;
+    }
+    TickType_t elapsed = xTaskGetTickCount() - s_lastStepTick;
+    return elapsed >= s_period ? 0 : s_period - elapsed;
+}
+
+bool Animation::step(Adafruit_EPD& display)
+{
+    if (!s_data) {
+        return false;
+    }
+    FrameHeader frame;
+    memcpy(&frame, &s_data[s_next], sizeof(frame));
+    const uint8_t* pixels = &s_data[s_next + sizeof(frame)];
+    size_t rowBytes = (frame.width + 3) / 4;
+    s_next += frameBytes(frame);
+    if (s_next >= s_size) {
+        s_next = s_loopStart;
+    }
+
+    // An upload may still be reading the planes
+    display.waitFramebufferFree();
+    for (uint16_t y = 0; y < frame.height; y++) {
+        const uint8_t* row = pixels + y * rowBytes;
+        for (uint16_t x = 0; x < frame.width; x++) {
+            uint8_t color = (row[x / 4] >> (6 - 2 * (x % 4))) & 0x03;
+            display.drawPixel(frame.x + x, frame.y + y, color);
+        }
+    }
+
+    // The ghosting budget decides between a window and a full refresh
+    TickType_t now = xTaskGetTickCount();
+    bool fullDue = ANIMATION_FULL_REFRESH_SEC > 0 &&
+                   now - s_lastFullTick >= pdMS_TO_TICKS(ANIMATION_FULL_REFRESH_SEC * 1000);
+    if (fullDue || display.chooseRefresh(false) != EPD_REFRESH_PARTIAL) {
+        ESP_LOGI(TAG_ANIM, "Full refresh");
+        display.displayAsync();
+        s_lastFullTick = now;
+    } else {
+        display.displayDirty();
+    }
+    s_lastStepTick = xTaskGetTickCount();
+    return true;
+}
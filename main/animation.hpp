@@ -0,0 +1,94 @@
+/**
+ * @file animation.hpp
+ * @brief Short looping animations on a slide, played as partial refreshes
+ *
+ * An image's animation is the file next to it with ANIMATION_EXTENSION
+ * (tools/epd_anim.py writes it): a key frame, then the rectangles that
+ * change from each frame to the next, the last leading back to the first.
+ * Each rectangle holds the pixels it ends with, not a difference, so it
+ * can be drawn over any earlier state.
+ *
+ * open() reads the whole file into RAM once per slide. Every step() then
+ * draws one rectangle into the framebuffer and sends the dirty box as a
+ * window refresh. The ghosting budget of the display (chooseRefresh())
+ * turns a step into a full refresh when it is spent, and one is made every
+ * ANIMATION_FULL_REFRESH_SEC anyway. Steps are at least
+ * ANIMATION_MIN_FRAME_MS apart. Only for the slideshow task.
+ */
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include <cstdint>
+
+class Adafruit_EPD;
+
+namespace Animation {
+
+static constexpr uint32_t MAGIC = 0x41445045;  // "EPDA" little-endian
+static constexpr uint8_t VERSION = 1;
+
+#pragma pack(push, 1)
+/**
+ * @brief Animation file header, followed by frameCount frames
+ */
+struct FileHeader {
+    uint32_t magic;       // MAGIC
+    uint8_t version;      // VERSION
+    uint8_t reserved;
+    uint16_t frameCount;  // Key frame included
+    uint16_t frameMs;     // Period the author asked for
+    uint16_t width;       // Logical display size it was made for
+    uint16_t height;
+    uint16_t reserved2;
+};
+
+/**
+ * @brief One frame: a rectangle in logical coordinates, followed by its
+ *        pixels as 2-bit EPD colors, rows of (width + 3) / 4 bytes, MSB first
+ */
+struct FrameHeader {
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+};
+#pragma pack(pop)
+
+/**
+ * @brief Load the animation of an image, if it has one; the next step()
+ *        draws its key frame
+ * @param imagePath The image's full path
+ * @param display Its size must match the file's
+ * @return false if there is none or it can't be used
+ */
+bool open(const char* imagePath, const Adafruit_EPD& display);
+
+/**
+ * @brief Drop the loaded animation
+ */
+void close();
+
+/**
+ * @brief Whether an animation is loaded
+ */
+bool active();
+
+/**
+ * @brief Ticks until the next step is due: 0 if it is, portMAX_DELAY if
+ *        no animation is loaded
+ */
+TickType_t ticksUntilDue();
+
+/**
+ * @brief Draw the next frame and refresh it
+ *
+ * A window refresh of the dirty box is synchronous; a full one (ghosting
+ * budget spent, or ANIMATION_FULL_REFRESH_SEC passed) runs in the
+ * background. Call while the display isn't refreshing.
+ *
+ * @return false if no animation is loaded
+ */
+bool step(Adafruit_EPD& display);
+
+} // namespace Animation
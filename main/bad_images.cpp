@@ -0,0 +1,117 @@
+/**
+ * @file bad_images.cpp
+ * @brief Failed image marks implementation
+ */
+
+#include "bad_images.hpp"
+#include "config.hpp"
+#include "sd_card.hpp"
+#include "esp_log.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <new>
+
+static const char* TAG_BAD = "BadImages";
+
+/**
+ * @brief Marks file header, followed by (count + 7) / 8 bytes of bits
+ */
+#pragma pack(push, 1)
+struct MarksHeader {
+    uint32_t magic;         // MARKS_MAGIC ("BADI")
+    uint32_t listChecksum;  // Image list the bits belong to
+    uint32_t count;         // Images covered
+};
+#pragma pack(pop)
+
+static constexpr uint32_t MARKS_MAGIC = 0x49444142;  // "BADI" little-endian
+
+static std::unique_ptr<uint8_t[]> s_bits;
+static size_t s_count = 0;    // Images covered by s_bits
+static size_t s_marked = 0;
+static uint32_t s_listChecksum = 0;
+
+static size_t bitmapSize(size_t count)
+{
+    return (count + 7) / 8;
+}
+
+static void marksPath(char* out, size_t outSize)
+{
+    snprintf(out, outSize, "%s/%s", IMAGE_CACHE_DIRECTORY, BAD_IMAGES_FILE);
+}
+
+void BadImages::load(uint32_t listChecksum, size_t count)
+{
+    s_count = std::min(count, MAX_IMAGE_FILES);
+    s_listChecksum = listChecksum;
+    s_marked = 0;
+    s_bits.reset(new (std::nothrow) uint8_t[bitmapSize(s_count)]());
+    if (!s_bits) {
+        s_count = 0;
+        return;
+    }
+
+    char path[64];
+    marksPath(path, sizeof(path));
+    FILE* file = SDCard::openFile(path);
+    if (!file) {
+        return;
+    }
+    MarksHeader header;
+    bool ok = fread(&header, 1, sizeof(header), file) == sizeof(header) &&
+              header.magic == MARKS_MAGIC && header.listChecksum == listChecksum &&
+              header.count == s_count &&
+              fread(s_bits.get(), 1, bitmapSize(s_count), file) == bitmapSize(s_count);
+    fclose(file);
+    if (!ok) {
+        // Recorded for another list: those indices mean other files now
+        memset(s_bits.get(), 0, bitmapSize(s_count));
+        return;
+    }
+    for (size_t i = 0; i < bitmapSize(s_count); i++) {
+        s_marked += __builtin_popcount(s_bits[i]);
+    }
+    if (s_marked) {
+        ESP_LOGI(TAG_BAD, "%zu images failed before, skipping them", s_marked);
+    }
+}
+
+bool BadImages::contains(size_t index)
+{
+    return index < s_count && (s_bits[index / 8] & (1u << (index % 8)));
+}
+
+void BadImages::mark(size_t index)
+{
+    if (index >= s_count || contains(index)) {
+        return;
+    }
+    s_bits[index / 8] |= 1u << (index % 8);
+    s_marked++;
+
+    if (!SDCard::makeDirectory(IMAGE_CACHE_DIRECTORY)) {
+        return;
+    }
+    char path[64];
+    marksPath(path, sizeof(path));
+    FILE* file = SDCard::createFile(path);
+    if (!file) {
+        return;
+    }
+    MarksHeader header = { MARKS_MAGIC, s_listChecksum, static_cast<uint32_t>(s_count) };
+    bool ok = fwrite(&header, 1, sizeof(header), file) == sizeof(header) &&
+              fwrite(s_bits.get(), 1, bitmapSize(s_count), file) == bitmapSize(s_count);
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        ESP_LOGW(TAG_BAD, "Failed to store bad image marks");
+        remove(path);
+    }
+}
+
+size_t BadImages::count()
+{
+    return s_marked;
+}
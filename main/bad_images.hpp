@@ -0,0 +1,42 @@
+/**
+ * @file bad_images.hpp
+ * @brief Images that failed to load, remembered until the image list changes
+ *
+ * One bit per image index, kept on the card in
+ * IMAGE_CACHE_DIRECTORY/BAD_IMAGES_FILE together with the checksum of the
+ * list it was recorded for, so a broken file costs one load attempt per
+ * content change instead of one per visit, across reboots and deep sleep.
+ * Indices from MAX_IMAGE_FILES on aren't remembered. Only for the slideshow
+ * task.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace BadImages {
+
+/**
+ * @brief Load the marks recorded for this list, or start with none
+ * @param listChecksum Checksum of the image list the indices refer to
+ * @param count Number of images in it
+ */
+void load(uint32_t listChecksum, size_t count);
+
+/**
+ * @brief Whether an image failed before
+ */
+bool contains(size_t index);
+
+/**
+ * @brief Remember a failed image and write the marks back (best effort)
+ */
+void mark(size_t index);
+
+/**
+ * @brief Number of images marked
+ */
+size_t count();
+
+} // namespace BadImages
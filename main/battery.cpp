@@ -0,0 +1,192 @@
+/**
+ * @file battery.cpp
+ * @brief Battery monitor implementation
+ */
+
+#include "battery.hpp"
+#include "config.hpp"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "driver/gpio.h"
+#include <cinttypes>
+
+static const char* TAG_BATT = "Battery";
+
+// Conversions averaged per reading
+static constexpr int SAMPLES = 8;
+
+static adc_oneshot_unit_handle_t s_adc = nullptr;
+static adc_cali_handle_t s_cali = nullptr;
+static adc_channel_t s_channel;
+
+// Kept through the deep sleeps between slides
+RTC_DATA_ATTR static Battery::Level s_level = Battery::Level::NORMAL;
+RTC_DATA_ATTR static uint32_t s_millivolts = 0;
+
+static bool createCalibration(adc_unit_t unit)
+{
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    adc_cali_curve_fitting_config_t config = {};
+    config.unit_id = unit;
+    config.chan = s_channel;
+    config.atten = ADC_ATTEN_DB_12;
+    config.bitwidth = ADC_BITWIDTH_DEFAULT;
+    return adc_cali_create_scheme_curve_fitting(&config, &s_cali) == ESP_OK;
+#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+    adc_cali_line_fitting_config_t config = {};
+    config.unit_id = unit;
+    config.atten = ADC_ATTEN_DB_12;
+    config.bitwidth = ADC_BITWIDTH_DEFAULT;
+    return adc_cali_create_scheme_line_fitting(&config, &s_cali) == ESP_OK;
+#else
+    (void)unit;
+    return false;
+#endif
+}
+
+bool Battery::init()
+{
+    if (EXTERNAL_POWER_GPIO != GPIO_NUM_NC) {
+        gpio_set_direction(EXTERNAL_POWER_GPIO, GPIO_MODE_INPUT);
+        gpio_set_pull_mode(EXTERNAL_POWER_GPIO, GPIO_PULLDOWN_ONLY);
+    }
+    if (!BATTERY_MONITOR_ENABLED) {
+        s_level = Level::NORMAL;
+        return false;
+    }
+    if (s_adc) {
+        return true;
+    }
+
+    adc_unit_t unit;
+    if (adc_oneshot_io_to_channel(BATTERY_ADC_GPIO, &unit, &s_channel) != ESP_OK) {
+        ESP_LOGE(TAG_BATT, "GPIO %d is not an ADC pin", BATTERY_ADC_GPIO);
+        return false;
+    }
+    adc_oneshot_unit_init_cfg_t unitConfig = {};
+    unitConfig.unit_id = unit;
+    adc_oneshot_chan_cfg_t channelConfig = {};
+    channelConfig.atten = ADC_ATTEN_DB_12;
+    channelConfig.bitwidth = ADC_BITWIDTH_DEFAULT;
+    if (adc_oneshot_new_unit(&unitConfig, &s_adc) != ESP_OK ||
+        adc_oneshot_config_channel(s_adc, s_channel, &channelConfig) != ESP_OK) {
+        ESP_LOGE(TAG_BATT, "ADC unavailable");
+        if (s_adc) {
+            adc_oneshot_del_unit(s_adc);
+            s_adc = nullptr;
+        }
+        return false;
+    }
+    if (!createCalibration(unit)) {
+        ESP_LOGW(TAG_BATT, "No ADC calibration, readings are approximate");
+    }
+    sample();
+    return true;
+}
+
+/**
+ * @brief Level for a voltage, leaving the current level only past its
+ *        threshold plus BATTERY_HYSTERESIS_MV
+ */
+static Battery::Level levelFor(uint32_t mv, Battery::Level current)
+{
+    uint32_t critical = BATTERY_CRITICAL_MV;
+    uint32_t low = BATTERY_LOW_MV;
+    if (current == Battery::Level::CRITICAL) {
+        critical += BATTERY_HYSTERESIS_MV;
+    }
+    if (current != Battery::Level::NORMAL) {
+        low += BATTERY_HYSTERESIS_MV;
+    }
+    if (mv < critical) {
+        return Battery::Level::CRITICAL;
+    }
+    return mv < low ? Battery::Level::LOW_CHARGE : Battery::Level::NORMAL;
+}
+
+Battery::Level Battery::sample()
+{
+    if (!s_adc) {
+        return s_level;
+    }
+    int32_t sum = 0;
+    int count = 0;
+    for (int i = 0; i < SAMPLES; i++) {
+        int raw = 0;
+        int mv = 0;
+        if (adc_oneshot_read(s_adc, s_channel, &raw) != ESP_OK) {
+            continue;
+        }
+        if (!s_cali || adc_cali_raw_to_voltage(s_cali, raw, &mv) != ESP_OK) {
+            mv = raw * 3300 / 4095;  // Uncalibrated, full scale at 12 dB
+        }
+        sum += mv;
+        count++;
+    }
+    if (count == 0) {
+        return s_level;
+    }
+    s_millivolts = static_cast<uint32_t>(sum / count) * BATTERY_DIVIDER_NUM / BATTERY_DIVIDER_DEN;
+
+    Level next = levelFor(s_millivolts, s_level);
+    if (next != s_level) {
+        ESP_LOGI(TAG_BATT, "%" PRIu32 " mV: %s -> %s", s_millivolts, levelName(s_level), levelName(next));
+        s_level = next;
+    }
+    return s_level;
+}
+
+Battery::Level Battery::level()
+{
+    return s_level;
+}
+
+uint32_t Battery::millivolts()
+{
+    return s_millivolts;
+}
+
+const char* Battery::levelName(Level level)
+{
+    switch (level) {
+        case Level::NORMAL:     return "normal";
+        case Level::LOW_CHARGE: return "low";
+        case Level::CRITICAL:   return "critical";
+    }
+    return "?";
+}
+
+uint32_t Battery::dwellFactor()
+{
+    switch (s_level) {
+        case Level::LOW_CHARGE: return BATTERY_LOW_DWELL_FACTOR;
+        case Level::CRITICAL:   return BATTERY_CRITICAL_DWELL_FACTOR;
+        default:                return 1;
+    }
+}
+
+bool Battery::preferMono()
+{
+    return s_level != Level::NORMAL;
+}
+
+bool Battery::allowsRadio()
+{
+    return s_level == Level::NORMAL;
+}
+
+bool Battery::allowsPrefetch()
+{
+    return s_level != Level::CRITICAL;
+}
+
+bool Battery::externalPower()
+{
+    if (EXTERNAL_POWER_GPIO != GPIO_NUM_NC) {
+        return gpio_get_level(EXTERNAL_POWER_GPIO) != 0;
+    }
+    return s_adc && s_millivolts >= BATTERY_EXTERNAL_MV;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file battery.hpp
+ * @brief Battery voltage and the charge-saving policy that follows from it
+ *
+ * The voltage comes from an ADC pin behind a divider (BATTERY_ADC_GPIO),
+ * averaged over a few conversions and calibrated where the chip supports
+ * it. The level it falls into (with hysteresis) is kept in RTC memory, so
+ * the wakes between slides start from the last reading. Without
+ * BATTERY_MONITOR_ENABLED the level stays NORMAL and nothing changes.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace Battery {
+
+enum class Level : uint8_t {
+    NORMAL,
+    LOW_CHARGE, // Below BATTERY_LOW_MV: longer dwell, mono waveform, no radio
+    CRITICAL    // Below BATTERY_CRITICAL_MV: also a longer dwell, no prefetch
+};
+
+/**
+ * @brief Set up the ADC and take a first reading
+ * @return false if disabled or the ADC is unavailable
+ */
+bool init();
+
+/**
+ * @brief Read the voltage and update the level; slideshow task only
+ * @return The level
+ */
+Level sample();
+
+/**
+ * @brief Level at the last reading
+ */
+Level level();
+
+/**
+ * @brief Battery voltage at the last reading, 0 before one
+ */
+uint32_t millivolts();
+
+/**
+ * @brief Short level name for logs
+ */
+const char* levelName(Level level);
+
+/**
+ * @brief Multiplier for the auto-advance dwell
+ */
+uint32_t dwellFactor();
+
+/**
+ * @brief Auto-advanced slides should use the fast mono waveform
+ */
+bool preferMono();
+
+/**
+ * @brief Radio syncs may run
+ */
+bool allowsRadio();
+
+/**
+ * @brief Neighbours may be decoded ahead
+ */
+bool allowsPrefetch();
+
+/**
+ * @brief Running from USB or a supply: EXTERNAL_POWER_GPIO where there is
+ *        one, else a reading of at least BATTERY_EXTERNAL_MV
+ */
+bool externalPower();
+
+} // namespace Battery
@@ -0,0 +1,874 @@
+/**
+ * @file bench.cpp
+ * @brief On-device benchmarks implementation
+ */
+
+#include "bench.hpp"
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_sleep.h"
+#include "esp_heap_caps.h"
+#include "esp_app_desc.h"
+#include "freertos/task.h"
+
+#include "config.hpp"
+#include "sd_card.hpp"
+#include "image_loader.hpp"
+#include "slide_stats.hpp"
+#include "heap_watch.hpp"
+#include "../components/Adafruit_EPD/src/EPDPlaneView.h"
+#include "../components/Adafruit_BusIO_ESPIDF/SPI.h"
+#include "../components/Adafruit_BusIO_ESPIDF/Adafruit_SPIDevice.h"
+#include <cstdio>
+#include <cstring>
+#include <cinttypes>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <new>
+
+static const char* TAG_BENCH = "EpdBench";
+
+static Display* g_display = nullptr;  // Set for the duration of run()
+static char s_buildId[48];            // App version and ELF hash prefix, for JSON
+
+namespace {
+
+/**
+ * @brief Min/avg/max and the samples of repeated runs
+ */
+struct Stat {
+    static constexpr uint32_t MAX_SAMPLES = 16;  // Later runs count toward min/avg/max only
+
+    uint32_t runs = 0;
+    int64_t minUs = 0;
+    int64_t maxUs = 0;
+    int64_t totalUs = 0;
+    int64_t samplesUs[MAX_SAMPLES];
+
+    void add(int64_t us)
+    {
+        minUs = runs ? std::min(minUs, us) : us;
+        maxUs = std::max(maxUs, us);
+        totalUs += us;
+        if (runs < MAX_SAMPLES) {
+            samplesUs[runs] = us;
+        }
+        runs++;
+    }
+
+    int64_t avgUs() const { return runs ? totalUs / runs : 0; }
+
+    uint32_t sampleCount() const { return std::min(runs, MAX_SAMPLES); }
+
+    /**
+     * @brief Nearest-rank percentile of the samples
+     */
+    int64_t percentileUs(uint32_t percent) const
+    {
+        uint32_t count = sampleCount();
+        if (count == 0) {
+            return 0;
+        }
+        int64_t sorted[MAX_SAMPLES];
+        std::copy(samplesUs, samplesUs + count, sorted);
+        std::sort(sorted, sorted + count);
+        uint32_t rank = (percent * count + 99) / 100;
+        return sorted[rank ? rank - 1 : 0];
+    }
+};
+
+/**
+ * @brief A limit on one figure of one metric, from BENCH_BUDGET_FILE
+ */
+struct Budget {
+    enum class Field : uint8_t { MIN, AVG, MAX, P50, P90, RATE };
+
+    char metric[32];
+    Field field;
+    bool atMost;   // "<=", else ">="
+    double limit;  // ms, or the metric's rate unit
+    bool checked;  // Measured (or failed) in this run
+    bool passed;
+};
+
+/**
+ * @brief Time fn() BENCH_REPEATS times
+ */
+template <typename Fn>
+Stat measure(Fn fn, uint32_t repeats = BENCH_REPEATS)
+{
+    Stat stat;
+    for (uint32_t i = 0; i < repeats; i++) {
+        int64_t start = esp_timer_get_time();
+        fn();
+        stat.add(esp_timer_get_time() - start);
+    }
+    return stat;
+}
+
+} // namespace
+
+static constexpr const char* BUDGET_FIELDS[] = { "min", "avg", "max", "p50", "p90", "rate" };
+
+static Budget s_budgets[BENCH_MAX_BUDGETS];
+static size_t s_budgetCount = 0;
+
+/**
+ * @brief Read BENCH_BUDGET_FILE, if the card has one
+ */
+static void loadBudgets()
+{
+    s_budgetCount = 0;
+    FILE* file = fopen(BENCH_BUDGET_FILE, "r");
+    if (!file) {
+        return;
+    }
+    char line[96];
+    while (fgets(line, sizeof(line), file)) {
+        char field[8];
+        char op[3];
+        Budget budget = {};
+        if (line[strspn(line, " \t")] == '#' ||
+            sscanf(line, " %31s %7s %2s %lf", budget.metric, field, op, &budget.limit) != 4) {
+            continue;
+        }
+        size_t f = 0;
+        while (f < std::size(BUDGET_FIELDS) && strcmp(field, BUDGET_FIELDS[f]) != 0) {
+            f++;
+        }
+        if (f == std::size(BUDGET_FIELDS) || (strcmp(op, "<=") != 0 && strcmp(op, ">=") != 0)) {
+            ESP_LOGW(TAG_BENCH, "Ignoring budget: %s", line);
+            continue;
+        }
+        if (s_budgetCount == BENCH_MAX_BUDGETS) {
+            ESP_LOGW(TAG_BENCH, "More than %zu budgets, ignoring the rest", BENCH_MAX_BUDGETS);
+            break;
+        }
+        budget.field = static_cast<Budget::Field>(f);
+        budget.atMost = op[0] == '<';
+        s_budgets[s_budgetCount++] = budget;
+    }
+    fclose(file);
+    ESP_LOGI(TAG_BENCH, "%zu budgets from %s", s_budgetCount, BENCH_BUDGET_FILE);
+}
+
+/**
+ * @brief Fill s_buildId from the app description
+ */
+static void loadBuildId()
+{
+    const esp_app_desc_t* app = esp_app_get_description();
+    char sha[9];
+    esp_app_get_elf_sha256(sha, sizeof(sha));
+    snprintf(s_buildId, sizeof(s_buildId), "%s-%s", app->version, sha);
+}
+
+/**
+ * @brief Print a result as a BENCHJSON line, closing it with any budget
+ *        verdict
+ * @param values Figures in BUDGET_FIELDS order; nullptr if it failed
+ */
+static void printJson(const char* name, const Stat* stat, const double* values,
+                      const char* unit, const Budget* budget)
+{
+    if (!BENCH_JSON_ENABLED) {
+        return;
+    }
+    printf("BENCHJSON {\"metric\":\"%s\",\"unit\":\"ms\",\"build\":\"%s\",\"panel\":\"%s\"",
+           name, s_buildId, Panel::active().name);
+    if (values) {
+        printf(",\"runs\":%" PRIu32 ",\"samples\":[", stat->runs);
+        for (uint32_t i = 0; i < stat->sampleCount(); i++) {
+            printf("%s%.3f", i ? "," : "", stat->samplesUs[i] / 1000.0);
+        }
+        printf("]");
+        for (size_t f = 0; f < std::size(BUDGET_FIELDS) - 1; f++) {
+            printf(",\"%s\":%.3f", BUDGET_FIELDS[f], values[f]);
+        }
+        if (unit) {
+            printf(",\"rate\":%.3f,\"rate_unit\":\"%s\"", values[static_cast<size_t>(Budget::Field::RATE)],
+                   unit);
+        }
+    } else {
+        printf(",\"failed\":true");
+    }
+    if (budget) {
+        printf(",\"budget\":{\"field\":\"%s\",\"op\":\"%s\",\"limit\":%g,\"pass\":%s}",
+               BUDGET_FIELDS[static_cast<size_t>(budget->field)], budget->atMost ? "<=" : ">=",
+               budget->limit, budget->passed ? "true" : "false");
+    }
+    printf("}\n");
+}
+
+/**
+ * @brief Check a metric's budget, if it has one
+ * @param values Figures in BUDGET_FIELDS order; nullptr fails the budget
+ * @return The budget, or nullptr
+ */
+static const Budget* checkBudget(const char* name, const double* values, bool hasRate)
+{
+    for (size_t i = 0; i < s_budgetCount; i++) {
+        Budget& budget = s_budgets[i];
+        if (strcmp(budget.metric, name) != 0) {
+            continue;
+        }
+        budget.checked = true;
+        bool measured = values && (hasRate || budget.field != Budget::Field::RATE);
+        double value = measured ? values[static_cast<size_t>(budget.field)] : 0;
+        budget.passed = measured && (budget.atMost ? value <= budget.limit : value >= budget.limit);
+        if (!budget.passed) {
+            ESP_LOGE(TAG_BENCH, "BENCH %-20s over budget: %s %.3f, limit %s %g", name,
+                     BUDGET_FIELDS[static_cast<size_t>(budget.field)], value,
+                     budget.atMost ? "<=" : ">=", budget.limit);
+        }
+        return &budget;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief A result that couldn't be measured: logged, and failing its budget
+ */
+static void reportFailed(const char* name)
+{
+    ESP_LOGW(TAG_BENCH, "BENCH %-20s failed", name);
+    printJson(name, nullptr, nullptr, nullptr, checkBudget(name, nullptr, false));
+}
+
+/**
+ * @brief Log one result: times in ms, and the rate of units per second
+ *        at the average time (no rate when unit is nullptr); checked
+ *        against its budget and printed as JSON
+ */
+static void report(const char* name, const Stat& stat, double units = 0,
+                   const char* unit = nullptr)
+{
+    if (stat.runs == 0) {
+        ESP_LOGW(TAG_BENCH, "BENCH %-20s skipped", name);
+        printJson(name, nullptr, nullptr, nullptr, checkBudget(name, nullptr, false));
+        return;
+    }
+    const bool hasRate = unit && stat.avgUs() > 0;
+    const double values[] = {
+        stat.minUs / 1000.0, stat.avgUs() / 1000.0, stat.maxUs / 1000.0,
+        stat.percentileUs(50) / 1000.0, stat.percentileUs(90) / 1000.0,
+        hasRate ? units * 1e6 / stat.avgUs() : 0,
+    };
+    static_assert(std::size(values) == std::size(BUDGET_FIELDS));
+    if (hasRate) {
+        ESP_LOGI(TAG_BENCH, "BENCH %-20s min %9.3f avg %9.3f max %9.3f ms  %10.3f %s",
+                 name, values[0], values[1], values[2], values[5], unit);
+    } else {
+        ESP_LOGI(TAG_BENCH, "BENCH %-20s min %9.3f avg %9.3f max %9.3f ms",
+                 name, values[0], values[1], values[2]);
+    }
+    printJson(name, &stat, values, hasRate ? unit : nullptr, checkBudget(name, values, hasRate));
+}
+
+/**
+ * @brief One byte per transaction vs bulk writes, on a device with nothing
+ *        on its chip select
+ */
+static void benchSpi()
+{
+    Adafruit_SPIDevice device(BENCH_SPI_CS_PIN, BENCH_SPI_FREQ_HZ);
+    if (!device.begin()) {
+        ESP_LOGW(TAG_BENCH, "SPI benchmark device unavailable");
+        return;
+    }
+
+    size_t len = g_display->getBufferSize(0);
+    std::unique_ptr<uint8_t[]> buffer(new (std::nothrow) uint8_t[len]);
+    if (!buffer) {
+        return;
+    }
+    for (size_t i = 0; i < len; i++) {
+        buffer[i] = static_cast<uint8_t>(i);
+    }
+
+    device.beginTransaction();
+    Stat bytes = measure([&] {
+        for (size_t i = 0; i < len; i++) {
+            device.transfer(buffer[i]);
+        }
+    });
+    Stat bulk = measure([&] { device.write(buffer.get(), len); });
+    device.endTransaction();
+
+    report("spi.byte", bytes, len / 1024.0, "KB/s");
+    report("spi.bulk", bulk, len / 1024.0, "KB/s");
+}
+
+/**
+ * @brief Full-screen fills of the framebuffer through each drawing path
+ */
+static void benchDraw()
+{
+    const int16_t width = g_display->width();
+    const int16_t height = g_display->height();
+    const double pixels = static_cast<double>(width) * height / 1e6;
+
+    std::unique_ptr<uint8_t[]> colors(new (std::nothrow) uint8_t[width]);
+    if (!colors) {
+        return;
+    }
+    for (int16_t x = 0; x < width; x++) {
+        colors[x] = (x & 4) ? EPD_BLACK : ((x & 8) ? EPD_RED : EPD_WHITE);
+    }
+
+    report("draw.pixel", measure([&] {
+        for (int16_t y = 0; y < height; y++) {
+            for (int16_t x = 0; x < width; x++) {
+                g_display->drawPixel(x, y, colors[x]);
+            }
+        }
+    }), pixels, "Mpx/s");
+
+    report("draw.span", measure([&] {
+        for (int16_t y = 0; y < height; y++) {
+            g_display->writeSpan(0, y, colors.get(), width);
+        }
+    }), pixels, "Mpx/s");
+
+    // The decoders' path for the configured panel
+    EPDPlaneView<DISPLAY_NATIVE_WIDTH, DISPLAY_NATIVE_HEIGHT, DISPLAY_ROTATION,
+                 THINKINK_STANDARD> view;
+    if (view.attach(*g_display)) {
+        report("draw.planeview", measure([&] {
+            for (int16_t y = 0; y < height; y++) {
+                view.writeSpan(0, y, colors.get(), width);
+            }
+        }), pixels, "Mpx/s");
+
+        // Rows across the buffer bytes: blocks of rows, packed a byte at a
+        // time (stride 0: every row of the block is the same)
+        if (!decltype(view)::ROWS_ALONG_BYTES) {
+            report("draw.planetile", measure([&] {
+                for (int16_t y = 0; y < height; y += decltype(view)::TILE_ROWS) {
+                    view.writeTile(0, decltype(view)::tileStart(y), colors.get(), 0, width);
+                }
+            }), pixels, "Mpx/s");
+        }
+    }
+
+    uint16_t fill = EPD_BLACK;
+    report("draw.fillrect", measure([&] {
+        g_display->fillRect(0, 0, width, height, fill);
+        fill = (fill == EPD_BLACK) ? EPD_RED : EPD_BLACK;
+    }), pixels, "Mpx/s");
+
+    report("draw.clear", measure([&] { g_display->clearBuffer(); }), pixels, "Mpx/s");
+}
+
+static void putLE16(uint8_t* p, uint16_t v)
+{
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+static void putLE32(uint8_t* p, uint32_t v)
+{
+    putLE16(p, static_cast<uint16_t>(v));
+    putLE16(p + 2, static_cast<uint16_t>(v >> 16));
+}
+
+/**
+ * @brief Write a display-sized test BMP (vertical gray/red bands)
+ * @param bits 1, 4, 8 or 24
+ */
+static bool writeTestBmp(const char* path, uint16_t bits)
+{
+    const int32_t width = DISPLAY_WIDTH;
+    const int32_t height = DISPLAY_HEIGHT;
+    const uint32_t paletteSize = bits <= 8 ? (1u << bits) : 0;
+    const uint32_t rowSize = ((width * bits + 31) / 32) * 4;
+    const uint32_t dataOffset = 14 + 40 + paletteSize * 4;
+
+    uint8_t header[54] = {};
+    header[0] = 'B';
+    header[1] = 'M';
+    putLE32(header + 2, dataOffset + rowSize * height);
+    putLE32(header + 10, dataOffset);
+    putLE32(header + 14, 40);
+    putLE32(header + 18, width);
+    putLE32(header + 22, height);
+    putLE16(header + 26, 1);
+    putLE16(header + 28, bits);
+    putLE32(header + 34, rowSize * height);
+    putLE32(header + 46, paletteSize);
+
+    FILE* file = SDCard::createFile(path);
+    if (!file) {
+        return false;
+    }
+    bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+    // Gray ramp; the top quarter of the 8-bit ramp is red so all inks occur
+    for (uint32_t i = 0; ok && i < paletteSize; i++) {
+        uint8_t level = static_cast<uint8_t>(i * 255 / (paletteSize - 1));
+        uint8_t quad[4] = { level, level, level, 0 };
+        if (paletteSize == 256 && i >= 192) {
+            quad[0] = quad[1] = 0;
+            quad[2] = 0xFF;
+        }
+        ok = fwrite(quad, 1, sizeof(quad), file) == sizeof(quad);
+    }
+
+    std::unique_ptr<uint8_t[]> row(new (std::nothrow) uint8_t[rowSize]);
+    ok = ok && row;
+    for (int32_t y = 0; ok && y < height; y++) {
+        memset(row.get(), 0, rowSize);
+        for (int32_t x = 0; x < width; x++) {
+            uint32_t band = static_cast<uint32_t>((x + y) / 8);
+            switch (bits) {
+            case 1:
+                row[x / 8] |= (band & 1) << (7 - x % 8);
+                break;
+            case 4:
+                row[x / 2] |= (band & 15) << ((x & 1) ? 0 : 4);
+                break;
+            case 8:
+                row[x] = static_cast<uint8_t>(band * 16);
+                break;
+            default:
+                row[x * 3 + 0] = static_cast<uint8_t>(band * 40);
+                row[x * 3 + 1] = static_cast<uint8_t>(band * 24);
+                row[x * 3 + 2] = static_cast<uint8_t>(255 - band * 8);
+                break;
+            }
+        }
+        ok = fwrite(row.get(), 1, rowSize, file) == rowSize;
+    }
+    return (fclose(file) == 0) && ok;
+}
+
+/**
+ * @brief Decode a generated BMP per bit depth into the framebuffer
+ *
+ * Each run is also logged as a SlideStats record, which splits the time
+ * into read, decode and pack.
+ */
+static void benchBmp()
+{
+    static constexpr uint16_t DEPTHS[] = { 1, 4, 8, 24 };
+
+    bool cache = ImageLoader::isCacheEnabled();
+    ImageLoader::setCacheEnabled(false);
+    for (uint16_t bits : DEPTHS) {
+        char path[64];
+        snprintf(path, sizeof(path), "%s/BMP%u.BMP", BENCH_DIRECTORY, bits);
+        if (!writeTestBmp(path, bits)) {
+            ESP_LOGW(TAG_BENCH, "Failed to write %s", path);
+            continue;
+        }
+
+        bool ok = true;
+        Stat stat = measure([&] {
+            SlideStats::begin(bits - 1u);  // Logged as "Slide <bits>"
+            ok = ImageLoader::load(path, g_display) && ok;
+            SlideStats::log(SlideStats::end());
+        });
+        char name[32];
+        snprintf(name, sizeof(name), "bmp.decode.%ubit", bits);
+        if (ok) {
+            report(name, stat, DISPLAY_WIDTH * DISPLAY_HEIGHT / 1e6, "Mpx/s");
+        } else {
+            reportFailed(name);
+        }
+        remove(path);
+    }
+    ImageLoader::setCacheEnabled(cache);
+}
+
+/**
+ * @brief Write a test file, then read it sequentially and at random sectors
+ *        through SDCard::openFile() (so with the loader's stdio buffer)
+ */
+static void benchSd()
+{
+    static constexpr size_t CHUNK = 16 * 1024;
+    static constexpr size_t SECTOR = 512;
+    static constexpr uint32_t RANDOM_READS = 256;
+
+    std::unique_ptr<uint8_t[]> buffer(new (std::nothrow) uint8_t[CHUNK]);
+    if (!buffer) {
+        return;
+    }
+    for (size_t i = 0; i < CHUNK; i++) {
+        buffer[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "%s/SEQ.BIN", BENCH_DIRECTORY);
+    const double megabytes = BENCH_SD_FILE_SIZE / (1024.0 * 1024.0);
+
+    bool ok = true;
+    Stat write = measure([&] {
+        FILE* file = SDCard::createFile(path);
+        ok = ok && file;
+        if (!file) {
+            return;
+        }
+        SDCard::BusBurst burst;
+        for (size_t done = 0; ok && done < BENCH_SD_FILE_SIZE; done += CHUNK) {
+            ok = fwrite(buffer.get(), 1, CHUNK, file) == CHUNK;
+        }
+        ok = (fclose(file) == 0) && ok;
+    }, 1);
+    if (!ok) {
+        ESP_LOGW(TAG_BENCH, "Failed to write %s", path);
+        reportFailed("sd.write");
+        remove(path);
+        return;
+    }
+    report("sd.write", write, megabytes, "MB/s");
+
+    report("sd.read.seq", measure([&] {
+        FILE* file = SDCard::openFile(path);
+        if (!file) {
+            return;
+        }
+        SDCard::BusBurst burst;
+        while (fread(buffer.get(), 1, CHUNK, file) == CHUNK) {
+        }
+        fclose(file);
+    }), megabytes, "MB/s");
+
+    report("sd.read.random", measure([&] {
+        FILE* file = SDCard::openFile(path);
+        if (!file) {
+            return;
+        }
+        for (uint32_t i = 0; i < RANDOM_READS; i++) {
+            long sector = static_cast<long>(esp_random() % (BENCH_SD_FILE_SIZE / SECTOR));
+            SDCard::BusBurst burst;
+            if (fseek(file, sector * static_cast<long>(SECTOR), SEEK_SET) != 0 ||
+                fread(buffer.get(), 1, SECTOR, file) != SECTOR) {
+                break;
+            }
+        }
+        fclose(file);
+    }), RANDOM_READS * SECTOR / (1024.0 * 1024.0), "MB/s");
+
+    remove(path);
+}
+
+/**
+ * @brief Refresh a test pattern and report each panel stage
+ */
+static void benchRefresh(const char* mode, uint32_t repeats)
+{
+    Stat powerUp, planes[2], refresh, powerDown;
+    for (uint32_t i = 0; i < repeats; i++) {
+        // Alternate frames, so the panel's skip-identical-frame check never hits
+        g_display->clearBuffer();
+        g_display->fillRect(0, (i & 1) ? 0 : g_display->height() / 2,
+                            g_display->width(), g_display->height() / 2, EPD_BLACK);
+        g_display->fillRect(0, g_display->height() / 4, g_display->width() / 2,
+                            g_display->height() / 2, EPD_RED);
+        g_display->display();
+
+        epd_timing_t timing;
+        g_display->getTiming(timing);
+        powerUp.add(timing.power_up_us);
+        planes[0].add(timing.plane_us[0]);
+        planes[1].add(timing.plane_us[1]);
+        refresh.add(timing.refresh_us);
+        powerDown.add(timing.power_down_us);
+    }
+
+    const double kilobytes[2] = { g_display->getBufferSize(0) / 1024.0,
+                                  g_display->getBufferSize(1) / 1024.0 };
+    char name[32];
+    snprintf(name, sizeof(name), "%s.power_up", mode);
+    report(name, powerUp);
+    for (uint8_t p = 0; p < 2; p++) {
+        snprintf(name, sizeof(name), "%s.plane%u", mode, p + 1);
+        report(name, planes[p], kilobytes[p], "KB/s");
+    }
+    snprintf(name, sizeof(name), "%s.refresh", mode);
+    report(name, refresh);
+    snprintf(name, sizeof(name), "%s.power_down", mode);
+    report(name, powerDown);
+}
+
+namespace {
+
+/**
+ * @brief Heap, stack and load-time percentiles of one soak window
+ */
+struct SoakWindow {
+    uint32_t p50Us;
+    uint32_t p90Us;
+    uint32_t maxUs;
+    size_t freeHeap;
+    size_t largestBlock;
+    uint32_t stackFree;  // The running task's stack never used, bytes
+    uint32_t allocs;     // HeapWatch allocations, if HeapWatch::available()
+    uint32_t failures;   // Loads that failed in this window
+};
+
+} // namespace
+
+static uint32_t s_soakUs[BENCH_SOAK_WINDOW];  // Load times of the current window
+
+/**
+ * @brief Nearest-rank percentile of count samples, sorted
+ */
+static uint32_t soakPercentile(const uint32_t* sorted, size_t count, uint32_t percent)
+{
+    if (count == 0) {
+        return 0;
+    }
+    size_t rank = (percent * count + 99) / 100;
+    return sorted[rank ? rank - 1 : 0];
+}
+
+/**
+ * @brief Compare a window with the first one and log any drift
+ * @return true if it drifted past a BENCH_SOAK_ threshold
+ */
+static bool checkSoakDrift(uint32_t window, const SoakWindow& now, const SoakWindow& first)
+{
+    bool drift = false;
+    if (static_cast<uint64_t>(now.p90Us) * 100 >
+        static_cast<uint64_t>(first.p90Us) * (100 + BENCH_SOAK_LATENCY_DRIFT_PERCENT)) {
+        ESP_LOGE(TAG_BENCH, "BENCH %-20s window %" PRIu32 ": p90 %.1f ms, %.1f ms at first "
+                 "(limit +%" PRIu32 "%%)", "soak.drift", window, now.p90Us / 1000.0,
+                 first.p90Us / 1000.0, BENCH_SOAK_LATENCY_DRIFT_PERCENT);
+        drift = true;
+    }
+    if (static_cast<uint64_t>(now.largestBlock) * 100 <
+        static_cast<uint64_t>(first.largestBlock) * (100 - BENCH_SOAK_BLOCK_DRIFT_PERCENT)) {
+        ESP_LOGE(TAG_BENCH, "BENCH %-20s window %" PRIu32 ": largest block %zu, %zu at first "
+                 "(limit -%" PRIu32 "%%)", "soak.drift", window, now.largestBlock,
+                 first.largestBlock, BENCH_SOAK_BLOCK_DRIFT_PERCENT);
+        drift = true;
+    }
+    if (now.stackFree < STACK_FREE_ALARM_BYTES) {
+        ESP_LOGE(TAG_BENCH, "BENCH %-20s window %" PRIu32 ": %" PRIu32 " bytes of stack never "
+                 "used (alarm under %" PRIu32 ")", "soak.drift", window, now.stackFree,
+                 STACK_FREE_ALARM_BYTES);
+        drift = true;
+    }
+    // Fragmentation shows up as allocations, and so loads, that fail
+    if (now.failures > first.failures) {
+        ESP_LOGE(TAG_BENCH, "BENCH %-20s window %" PRIu32 ": %" PRIu32 " failed loads, %"
+                 PRIu32 " at first", "soak.drift", window, now.failures, first.failures);
+        drift = true;
+    }
+    return drift;
+}
+
+/**
+ * @brief Pick the next slide: mostly forward, some steps back, some jumps
+ */
+static size_t soakStep(size_t index, size_t count)
+{
+    uint32_t roll = esp_random() % 10;
+    if (roll < 6) {
+        return (index + 1) % count;
+    }
+    if (roll < 8) {
+        return (index + count - 1) % count;
+    }
+    return esp_random() % count;
+}
+
+/**
+ * @brief Power the panel down and light-sleep, as the slideshow does
+ *        between slides
+ */
+static void soakSleep()
+{
+    g_display->powerDown();
+    SDCard::suspendBus();
+    esp_sleep_enable_timer_wakeup(static_cast<uint64_t>(BENCH_SOAK_SLEEP_MS) * 1000);
+    esp_light_sleep_start();
+}
+
+/**
+ * @brief Load slides for hours and watch the load time, heap and stack
+ *        drift away from the first window
+ * @return false if a window drifted past a BENCH_SOAK_ threshold
+ */
+static bool benchSoak()
+{
+    SDCard::ImageList images;
+    if (SDCard::scanForImages(IMAGE_DIRECTORY, images) == 0) {
+        ESP_LOGW(TAG_BENCH, "No images in %s, skipping the soak", IMAGE_DIRECTORY);
+        return true;
+    }
+    ESP_LOGI(TAG_BENCH, "BENCH %-20s %" PRIu32 " loads of %zu images, windows of %" PRIu32,
+             "soak", BENCH_SOAK_RENDERS, images.size(), BENCH_SOAK_WINDOW);
+
+    const bool cache = ImageLoader::isCacheEnabled();
+    Stat loads;
+    Stat refreshes;
+    SoakWindow first = {};
+    bool hasFirst = false;  // first is the earliest window with a successful load
+    bool drifted = false;
+    uint32_t failures = 0;
+    uint32_t windowFailures = 0;
+    uint32_t allocsAt = HeapWatch::allocations();
+    size_t index = 0;
+    size_t samples = 0;
+    for (uint32_t i = 1; i <= BENCH_SOAK_RENDERS; i++) {
+        char path[SDCard::ImageList::MAX_PATH];
+        index = soakStep(index, images.size());
+        ImageLoader::setCacheEnabled(cache && esp_random() % 4 != 0);
+        int64_t start = esp_timer_get_time();
+        bool ok = images.path(index, path, sizeof(path)) && ImageLoader::load(path, g_display);
+        int64_t us = esp_timer_get_time() - start;
+        if (ok) {
+            loads.add(us);
+            s_soakUs[samples++] = static_cast<uint32_t>(std::min<int64_t>(us, UINT32_MAX));
+        } else {
+            failures++;
+            windowFailures++;
+        }
+
+        if (BENCH_SOAK_REFRESH_EVERY && i % BENCH_SOAK_REFRESH_EVERY == 0) {
+            start = esp_timer_get_time();
+            g_display->display();
+            refreshes.add(esp_timer_get_time() - start);
+        }
+        if (BENCH_SOAK_SLEEP_EVERY && i % BENCH_SOAK_SLEEP_EVERY == 0) {
+            soakSleep();
+        }
+        if (i % BENCH_SOAK_WINDOW != 0 && i != BENCH_SOAK_RENDERS) {
+            continue;
+        }
+
+        const uint32_t window = (i + BENCH_SOAK_WINDOW - 1) / BENCH_SOAK_WINDOW;
+        SoakWindow now = {};
+        std::sort(s_soakUs, s_soakUs + samples);
+        now.p50Us = soakPercentile(s_soakUs, samples, 50);
+        now.p90Us = soakPercentile(s_soakUs, samples, 90);
+        now.maxUs = soakPercentile(s_soakUs, samples, 100);
+        now.freeHeap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+        now.largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+        now.stackFree = static_cast<uint32_t>(uxTaskGetStackHighWaterMark(nullptr));
+        now.allocs = HeapWatch::allocations() - allocsAt;
+        allocsAt = HeapWatch::allocations();
+        now.failures = windowFailures;
+        windowFailures = 0;
+        const bool loaded = samples > 0;
+        samples = 0;
+
+        char allocs[24] = "hooks disabled";
+        if (HeapWatch::available()) {
+            snprintf(allocs, sizeof(allocs), "%" PRIu32, now.allocs);
+        }
+        ESP_LOGI(TAG_BENCH, "BENCH %-20s window %" PRIu32 ": p50 %.1f p90 %.1f max %.1f ms, "
+                 "heap %zu block %zu, stack %" PRIu32 ", allocs %s, %" PRIu32 " failed",
+                 "soak", window, now.p50Us / 1000.0, now.p90Us / 1000.0, now.maxUs / 1000.0,
+                 now.freeHeap, now.largestBlock, now.stackFree, allocs, now.failures);
+        if (!hasFirst) {
+            // A window of failed loads (a card slow to come up) has no times
+            // to compare with
+            first = now;
+            hasFirst = loaded;
+        } else {
+            drifted = checkSoakDrift(window, now, first) || drifted;
+        }
+    }
+    ImageLoader::setCacheEnabled(cache);
+
+    report("soak.load", loads);
+    if (BENCH_SOAK_REFRESH_EVERY) {
+        report("soak.refresh", refreshes);
+    }
+    if (drifted) {
+        ESP_LOGE(TAG_BENCH, "BENCH %-20s FAIL, drifted past the BENCH_SOAK_ thresholds", "soak");
+    } else {
+        ESP_LOGI(TAG_BENCH, "BENCH %-20s PASS, %" PRIu32 " failed loads", "soak", failures);
+    }
+    return !drifted;
+}
+
+
+const char* Bench::suiteName(Suite suite)
+{
+    static const char* const names[static_cast<size_t>(Suite::COUNT)] = {
+        "spi", "draw", "sd", "bmp", "refresh", "all", "soak",
+    };
+    size_t i = static_cast<size_t>(suite);
+    return i < static_cast<size_t>(Suite::COUNT) ? names[i] : "?";
+}
+
+bool Bench::parse(const char* name, Suite& out)
+{
+    for (size_t i = 0; name && i < static_cast<size_t>(Suite::COUNT); i++) {
+        if (strcmp(name, suiteName(static_cast<Suite>(i))) == 0) {
+            out = static_cast<Suite>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Bench::run(Display& display, Suite suite)
+{
+    g_display = &display;
+    const bool all = suite == Suite::ALL;
+    loadBuildId();
+    loadBudgets();
+
+    if (all || suite == Suite::SPI) {
+        benchSpi();
+    }
+    if (all || suite == Suite::DRAW) {
+        benchDraw();
+    }
+    if (all || suite == Suite::SD || suite == Suite::BMP) {
+        if (SDCard::makeDirectory(BENCH_DIRECTORY)) {
+            if (all || suite == Suite::SD) {
+                benchSd();
+            }
+            if (all || suite == Suite::BMP) {
+                benchBmp();
+            }
+        } else {
+            ESP_LOGW(TAG_BENCH, "No SD card, skipping SD and BMP benchmarks");
+        }
+    }
+    if (all || suite == Suite::REFRESH) {
+        benchRefresh("refresh.tricolor", BENCH_REFRESH_REPEATS);
+        if (display.setFastMode(true)) {
+            benchRefresh("refresh.fast", BENCH_REFRESH_REPEATS);
+            display.setFastMode(false);
+        }
+    }
+    bool drifted = false;
+    if (suite == Suite::SOAK) {
+        drifted = !benchSoak();
+    }
+
+    // Budgets of metrics this suite doesn't measure are left out
+    size_t checked = 0;
+    size_t failed = 0;
+    for (size_t i = 0; i < s_budgetCount; i++) {
+        checked += s_budgets[i].checked;
+        failed += s_budgets[i].checked && !s_budgets[i].passed;
+    }
+    if (failed) {
+        ESP_LOGE(TAG_BENCH, "BENCH %-20s FAIL, %zu of %zu budgets exceeded", "budgets", failed,
+                 checked);
+    } else if (checked) {
+        ESP_LOGI(TAG_BENCH, "BENCH %-20s PASS, %zu checked", "budgets", checked);
+    }
+    if (BENCH_JSON_ENABLED) {
+        printf("BENCHJSON {\"suite\":\"%s\",\"build\":\"%s\",\"panel\":\"%s\","
+               "\"budgets\":%zu,\"failed\":%zu,\"drift\":%s,\"pass\":%s}\n",
+               suiteName(suite), s_buildId, Panel::active().name, checked, failed,
+               drifted ? "true" : "false", (failed || drifted) ? "false" : "true");
+    }
+
+    ESP_LOGI(TAG_BENCH, "BENCH %-20s %s", "done", suiteName(suite));
+    g_display = nullptr;
+    return failed == 0 && !drifted;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file bench.hpp
+ * @brief On-device benchmarks, shared by the epd_bench app and the console
+ *
+ * Each suite logs one "BENCH" line per result, so runs of two library
+ * revisions can be diffed, and with BENCH_JSON_ENABLED prints it as a
+ * "BENCHJSON" line for a bench rig. Results with a budget in
+ * BENCH_BUDGET_FILE are checked against it.
+ */
+
+#pragma once
+
+#include "panel.hpp"
+#include <cstdint>
+
+namespace Bench {
+
+/**
+ * @brief Benchmark suites
+ */
+enum class Suite : uint8_t {
+    SPI,      // SPI throughput, one byte per transaction vs bulk writes
+    DRAW,     // Framebuffer drawing: drawPixel(), writeSpan(), EPDPlaneView spans, fillRect()
+    SD,       // SD card write, sequential read and random read
+    BMP,      // BMP decode per bit depth (converted-frame cache off)
+    REFRESH,  // Panel refresh stages per waveform (tricolor, fast)
+    ALL,      // All of the above, in this order
+    SOAK,     // Hours of slide loads, checked for latency and memory drift (not in ALL)
+    COUNT
+};
+
+/**
+ * @brief Suite name, as parse() accepts it
+ */
+const char* suiteName(Suite suite);
+
+/**
+ * @brief Look up a suite by name
+ * @param name Suite name, e.g. "spi" or "all"
+ * @param out Receives the suite
+ * @return false if no suite has that name
+ */
+bool parse(const char* name, Suite& out);
+
+/**
+ * @brief Run a suite on the display
+ *
+ * Overwrites the framebuffer (and the panel, for REFRESH) and leaves the
+ * display in its tricolor mode. SD and BMP need the card mounted and are
+ * skipped otherwise; their scratch files go to BENCH_DIRECTORY. SOAK needs
+ * images in IMAGE_DIRECTORY.
+ *
+ * @param display Display, begun and not refreshing
+ * @param suite Suite to run
+ * @return false if a result missed its budget or the soak drifted
+ */
+bool run(Display& display, Suite suite);
+
+} // namespace Bench
@@ -0,0 +1,516 @@
+/**
+ * @file ble_upload.cpp
+ * @brief BLE L2CAP image pack upload implementation
+ */
+
+#include "ble_upload.hpp"
+#include "config.hpp"
+#include "sd_card.hpp"
+#include "slideshow.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#if defined(CONFIG_BT_NIMBLE_ENABLED) && defined(CONFIG_BT_NIMBLE_L2CAP_COC_MAX_NUM) && \
+    CONFIG_BT_NIMBLE_L2CAP_COC_MAX_NUM > 0
+#define BLE_UPLOAD_AVAILABLE 1
+#include "nimble/nimble_port.h"
+#include "nimble/nimble_port_freertos.h"
+#include "host/ble_hs.h"
+#include "host/ble_l2cap.h"
+#else
+#define BLE_UPLOAD_AVAILABLE 0
+#endif
+
+static const char* TAG_BLE = "BleUpload";
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static BleUpload::Stats s_stats = {};
+
+#if BLE_UPLOAD_AVAILABLE
+
+static constexpr uint32_t UPLOAD_MAGIC = 0x55445045;  // "EPDU" little-endian
+static constexpr size_t UPLOAD_HEADER_SIZE = 8;       // Magic and frame count
+static constexpr size_t UPLOAD_ENTRY_SIZE = 12;       // Length, hash and name hash
+static constexpr uint8_t ANSWER_OK = 0;
+static constexpr uint8_t ANSWER_FAILED = 1;
+
+// Full-length link-layer packets: 251 bytes take 2120 us on the 1M PHY
+static constexpr uint16_t LL_MAX_OCTETS = 251;
+static constexpr uint16_t LL_MAX_TIME_US = 2120;
+
+// Each SDU is received into one mbuf this big; the rest of the room is the
+// mbuf and packet headers
+static constexpr uint16_t SDU_BLOCK_SIZE = BLE_UPLOAD_MTU + 64;
+// One buffer per queued SDU, one granted to the sender and one in flight
+static constexpr uint16_t SDU_BLOCKS = BLE_UPLOAD_BUFFERS + 2;
+
+static bool s_started = false;
+static uint8_t s_ownAddrType = 0;
+static os_membuf_t* s_poolMemory = nullptr;
+static os_mempool s_mempool;
+static os_mbuf_pool s_mbufPool;
+
+// The open channel; nullptr while none is (written by the host task only)
+static std::atomic<ble_l2cap_chan*> s_chan{ nullptr };
+// Received SDUs for the slideshow task; nullptr once the channel closed
+static QueueHandle_t s_queue = nullptr;
+// An SDU arrived with every buffer queued, so its credit waits for the card
+static bool s_stalled = false;
+// The answer is sent: whatever else arrives is dropped
+static std::atomic<bool> s_answered{ false };
+static int64_t s_firstSduUs = 0;
+
+static void advertise();
+
+/**
+ * @brief Grant the sender one more SDU
+ */
+static void grantCredit(ble_l2cap_chan* chan)
+{
+    os_mbuf* sdu = os_mbuf_get_pkthdr(&s_mbufPool, 0);
+    if (!sdu || ble_l2cap_recv_ready(chan, sdu) != 0) {
+        ESP_LOGW(TAG_BLE, "No receive buffer for the next SDU");
+        if (sdu) {
+            os_mbuf_free_chain(sdu);
+        }
+    }
+}
+
+/**
+ * @brief Queue a received SDU and grant the next one unless all buffers wait
+ */
+static void onSdu(ble_l2cap_chan* chan, os_mbuf* sdu)
+{
+    if (s_answered.load()) {
+        os_mbuf_free_chain(sdu);
+        grantCredit(chan);
+        return;
+    }
+    if (s_firstSduUs == 0) {
+        s_firstSduUs = esp_timer_get_time();
+    }
+    xQueueSend(s_queue, &sdu, 0);  // Can't be full: one buffer each
+    UBaseType_t queued = uxQueueMessagesWaiting(s_queue);
+    bool grant;
+    portENTER_CRITICAL(&s_lock);
+    s_stats.sdus++;
+    if (queued > s_stats.peakQueued) {
+        s_stats.peakQueued = queued;
+    }
+    grant = queued < BLE_UPLOAD_BUFFERS;
+    if (!grant) {
+        s_stalled = true;
+        s_stats.stalls++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (grant) {
+        grantCredit(chan);
+    }
+}
+
+/**
+ * @brief Hand back a stalled credit once the slideshow task freed a buffer
+ */
+static void resumeCredit()
+{
+    portENTER_CRITICAL(&s_lock);
+    bool stalled = s_stalled;
+    s_stalled = false;
+    portEXIT_CRITICAL(&s_lock);
+    ble_l2cap_chan* chan = s_chan.load();
+    if (stalled && chan) {
+        grantCredit(chan);
+    }
+}
+
+/**
+ * @brief Free what the slideshow task never took off the queue
+ */
+static void drainQueue()
+{
+    os_mbuf* sdu = nullptr;
+    while (xQueueReceive(s_queue, &sdu, 0) == pdTRUE) {
+        if (sdu) {
+            os_mbuf_free_chain(sdu);
+        }
+    }
+}
+
+static int onL2capEvent(ble_l2cap_event* event, void* arg)
+{
+    (void)arg;
+    switch (event->type) {
+        case BLE_L2CAP_EVENT_COC_ACCEPT:
+            // Only one upload at a time; the first credit goes out with the accept
+            if (s_chan.load()) {
+                return BLE_HS_EBUSY;
+            }
+            grantCredit(event->accept.chan);
+            return 0;
+
+        case BLE_L2CAP_EVENT_COC_CONNECTED:
+            if (event->connect.status != 0) {
+                return 0;
+            }
+            drainQueue();
+            s_stalled = false;
+            s_answered = false;
+            s_firstSduUs = 0;
+            s_chan = event->connect.chan;
+            ESP_LOGI(TAG_BLE, "Channel open");
+            if (!Slideshow::post(Slideshow::Command::UPLOAD)) {
+                ble_l2cap_disconnect(event->connect.chan);
+            }
+            return 0;
+
+        case BLE_L2CAP_EVENT_COC_DATA_RECEIVED:
+            onSdu(event->receive.chan, event->receive.sdu_rx);
+            return 0;
+
+        case BLE_L2CAP_EVENT_COC_DISCONNECTED:
+            if (event->disconnect.chan == s_chan.load()) {
+                s_chan = nullptr;
+                os_mbuf* closed = nullptr;
+                xQueueSend(s_queue, &closed, 0);  // The queue keeps a slot for it
+                ESP_LOGI(TAG_BLE, "Channel closed");
+            }
+            return 0;
+
+        default:
+            return 0;
+    }
+}
+
+static int onGapEvent(ble_gap_event* event, void* arg)
+{
+    (void)arg;
+    switch (event->type) {
+        case BLE_GAP_EVENT_CONNECT:
+            if (event->connect.status != 0) {
+                advertise();
+                return 0;
+            }
+            // Long packets on the fast PHY, if the phone has them
+            ble_gap_set_data_len(event->connect.conn_handle, LL_MAX_OCTETS, LL_MAX_TIME_US);
+            ble_gap_set_prefered_le_phy(event->connect.conn_handle, BLE_GAP_LE_PHY_2M_MASK,
+                                        BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_CODED_ANY);
+            return 0;
+
+        case BLE_GAP_EVENT_DISCONNECT:
+        case BLE_GAP_EVENT_ADV_COMPLETE:
+            advertise();
+            return 0;
+
+        default:
+            return 0;
+    }
+}
+
+static void advertise()
+{
+    ble_hs_adv_fields fields = {};
+    fields.flags = BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP;
+    fields.name = reinterpret_cast<const uint8_t*>(BLE_UPLOAD_NAME);
+    fields.name_len = strlen(BLE_UPLOAD_NAME);
+    fields.name_is_complete = 1;
+    int rc = ble_gap_adv_set_fields(&fields);
+    if (rc != 0) {
+        ESP_LOGE(TAG_BLE, "Advertising data rejected: %d", rc);
+        return;
+    }
+    ble_gap_adv_params params = {};
+    params.conn_mode = BLE_GAP_CONN_MODE_UND;
+    params.disc_mode = BLE_GAP_DISC_MODE_GEN;
+    rc = ble_gap_adv_start(s_ownAddrType, nullptr, BLE_HS_FOREVER, &params, onGapEvent, nullptr);
+    if (rc != 0 && rc != BLE_HS_EALREADY) {
+        ESP_LOGE(TAG_BLE, "Advertising failed: %d", rc);
+    }
+}
+
+static void onSync()
+{
+    if (ble_hs_id_infer_auto(0, &s_ownAddrType) != 0) {
+        ESP_LOGE(TAG_BLE, "No BLE address");
+        return;
+    }
+    int rc = ble_l2cap_create_server(BLE_UPLOAD_PSM, BLE_UPLOAD_MTU, onL2capEvent, nullptr);
+    if (rc != 0 && rc != BLE_HS_EALREADY) {
+        ESP_LOGE(TAG_BLE, "L2CAP server failed: %d", rc);
+        return;
+    }
+    advertise();
+    ESP_LOGI(TAG_BLE, "Advertising as %s, PSM 0x%02X", BLE_UPLOAD_NAME, BLE_UPLOAD_PSM);
+}
+
+static void onReset(int reason)
+{
+    ESP_LOGW(TAG_BLE, "Host reset: %d", reason);
+}
+
+static void hostTask(void* arg)
+{
+    (void)arg;
+    nimble_port_run();
+    nimble_port_freertos_deinit();
+}
+
+#endif // BLE_UPLOAD_AVAILABLE
+
+bool BleUpload::start()
+{
+    if (!BLE_UPLOAD_ENABLED) {
+        return false;
+    }
+#if BLE_UPLOAD_AVAILABLE
+    if (s_started) {
+        return true;
+    }
+    s_poolMemory = new (std::nothrow) os_membuf_t[OS_MEMPOOL_SIZE(SDU_BLOCKS, SDU_BLOCK_SIZE)];
+    // One slot per buffer plus the closed marker
+    s_queue = xQueueCreate(BLE_UPLOAD_BUFFERS + 1, sizeof(os_mbuf*));
+    if (!s_poolMemory || !s_queue ||
+        os_mempool_init(&s_mempool, SDU_BLOCKS, SDU_BLOCK_SIZE, s_poolMemory, "ble_upload") != 0 ||
+        os_mbuf_pool_init(&s_mbufPool, &s_mempool, SDU_BLOCK_SIZE, SDU_BLOCKS) != 0) {
+        ESP_LOGE(TAG_BLE, "Out of memory for %u receive buffers", SDU_BLOCKS);
+        return false;
+    }
+    if (nimble_port_init() != ESP_OK) {
+        ESP_LOGE(TAG_BLE, "NimBLE init failed");
+        return false;
+    }
+    ble_hs_cfg.sync_cb = onSync;
+    ble_hs_cfg.reset_cb = onReset;
+    nimble_port_freertos_init(hostTask);
+    s_started = true;
+    return true;
+#else
+    ESP_LOGW(TAG_BLE, "BLE uploads need NimBLE with L2CAP channels (menuconfig)");
+    return false;
+#endif
+}
+
+#if BLE_UPLOAD_AVAILABLE
+
+static uint32_t fnv1a(uint32_t hash, const void* data, size_t len)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t readLE32(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+}
+
+/**
+ * @brief The upload stream as it is parsed, SDU by SDU
+ */
+struct Upload {
+    std::vector<uint8_t> table;  // Header, then the frame table
+    std::vector<uint32_t> hashes;
+    std::vector<SDCard::ImagePackEntry> entries;
+    size_t frame = 0;            // Frame being received
+    uint32_t left = 0;           // Its bytes still to come
+    uint32_t hash = 0;
+    uint64_t bytes = 0;
+    bool done = false;
+};
+
+/**
+ * @brief Take the frame table once it is complete
+ * @return false if the stream isn't an upload
+ */
+static bool parseTable(Upload& up)
+{
+    size_t count = readLE32(up.table.data() + 4);
+    up.entries.resize(count);
+    up.hashes.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* p = up.table.data() + UPLOAD_HEADER_SIZE + i * UPLOAD_ENTRY_SIZE;
+        up.entries[i] = {};
+        up.entries[i].length = readLE32(p);
+        up.entries[i].format = SDCard::IMAGE_PACK_FORMAT_EPD;
+        up.entries[i].nameHash = readLE32(p + 8);
+        up.hashes[i] = readLE32(p + 4);
+        if (up.entries[i].length == 0) {
+            ESP_LOGE(TAG_BLE, "Frame %zu is empty", i);
+            return false;
+        }
+    }
+    ESP_LOGI(TAG_BLE, "Receiving %zu frames", count);
+    return true;
+}
+
+/**
+ * @brief Consume one SDU's bytes
+ * @return false on a bad stream or card error
+ */
+static bool consume(Upload& up, SDCard::ImagePackWriter& writer, const uint8_t* data, size_t len)
+{
+    up.bytes += len;
+    while (len > 0 && !up.done) {
+        if (up.entries.empty()) {
+            // Header, then the table it sizes
+            size_t want = UPLOAD_HEADER_SIZE;
+            if (up.table.size() >= UPLOAD_HEADER_SIZE) {
+                want += readLE32(up.table.data() + 4) * UPLOAD_ENTRY_SIZE;
+            }
+            size_t n = std::min(len, want - up.table.size());
+            up.table.insert(up.table.end(), data, data + n);
+            data += n;
+            len -= n;
+            if (up.table.size() == UPLOAD_HEADER_SIZE) {
+                uint32_t count = readLE32(up.table.data() + 4);
+                if (readLE32(up.table.data()) != UPLOAD_MAGIC || count == 0 ||
+                    count > MAX_IMAGE_FILES) {
+                    ESP_LOGE(TAG_BLE, "Not an upload stream (%" PRIu32 " frames)", count);
+                    return false;
+                }
+            } else if (up.table.size() == want && want > UPLOAD_HEADER_SIZE) {
+                if (!parseTable(up)) {
+                    return false;
+                }
+                up.left = 0;
+            }
+            continue;
+        }
+        if (up.left == 0) {
+            // Next frame, sector aligned as the packer does
+            if (!writer.align()) {
+                return false;
+            }
+            up.entries[up.frame].offset = writer.offset();
+            up.left = up.entries[up.frame].length;
+            up.hash = 2166136261u;
+        }
+        size_t n = std::min<size_t>(len, up.left);
+        if (!writer.write(data, n)) {
+            return false;
+        }
+        up.hash = fnv1a(up.hash, data, n);
+        data += n;
+        len -= n;
+        up.left -= n;
+        if (up.left == 0) {
+            if (up.hash != up.hashes[up.frame]) {
+                ESP_LOGE(TAG_BLE, "Frame %zu doesn't match its hash", up.frame);
+                return false;
+            }
+            up.done = ++up.frame == up.entries.size();
+        }
+    }
+    return true;
+}
+
+#endif // BLE_UPLOAD_AVAILABLE
+
+bool BleUpload::receive()
+{
+#if BLE_UPLOAD_AVAILABLE
+    ble_l2cap_chan* chan = s_chan.load();
+    if (!chan) {
+        return false;
+    }
+    uint8_t* chunk = new (std::nothrow) uint8_t[BLE_UPLOAD_MTU];
+    FILE* file = SDCard::createFile(BLE_UPLOAD_TEMP_FILE);
+    SDCard::ImagePackWriter writer(file, 0);
+    // Invalid until finish() writes the header
+    SDCard::ImagePackHeader blank = {};
+    bool ok = chunk && file && writer.write(&blank, sizeof(blank));
+    if (!ok) {
+        ESP_LOGE(TAG_BLE, "Cannot write %s", BLE_UPLOAD_TEMP_FILE);
+    }
+
+    Upload up;
+    while (ok && !up.done) {
+        os_mbuf* sdu = nullptr;
+        if (xQueueReceive(s_queue, &sdu, pdMS_TO_TICKS(BLE_UPLOAD_TIMEOUT_MS)) != pdTRUE) {
+            ESP_LOGE(TAG_BLE, "Nothing received for %" PRIu32 " ms", BLE_UPLOAD_TIMEOUT_MS);
+            ok = false;
+            break;
+        }
+        if (!sdu) {
+            ESP_LOGE(TAG_BLE, "Channel closed mid-upload");
+            ok = false;
+            break;
+        }
+        uint16_t len = OS_MBUF_PKTLEN(sdu);
+        os_mbuf_copydata(sdu, 0, len, chunk);
+        os_mbuf_free_chain(sdu);
+        resumeCredit();
+        ok = consume(up, writer, chunk, len);
+    }
+    delete[] chunk;
+    ok = ok && writer.align() && writer.finish(up.entries);
+    ok = file && (fclose(file) == 0) && ok;
+    if (ok) {
+        // Not atomic, as with a rebuilt WifiSync pack
+        remove(IMAGE_PACK_FILE);
+        ok = rename(BLE_UPLOAD_TEMP_FILE, IMAGE_PACK_FILE) == 0;
+    }
+    if (!ok) {
+        remove(BLE_UPLOAD_TEMP_FILE);
+    }
+
+    // Whatever comes after the answer is dropped by the host task
+    s_answered = true;
+    drainQueue();
+    resumeCredit();
+    uint8_t answer = ok ? ANSWER_OK : ANSWER_FAILED;
+    os_mbuf* reply = ble_hs_mbuf_from_flat(&answer, sizeof(answer));
+    if (!reply || ble_l2cap_send(chan, reply) != 0) {
+        ESP_LOGW(TAG_BLE, "Answer not sent");
+        if (reply) {
+            os_mbuf_free_chain(reply);
+        }
+    }
+
+    uint32_t ms = 0;
+    if (s_firstSduUs != 0) {
+        ms = static_cast<uint32_t>((esp_timer_get_time() - s_firstSduUs) / 1000);
+    }
+    portENTER_CRITICAL(&s_lock);
+    (ok ? s_stats.uploads : s_stats.failures)++;
+    s_stats.bytes = up.bytes;
+    s_stats.frames = up.entries.size();
+    s_stats.ms = ms;
+    portEXIT_CRITICAL(&s_lock);
+    if (ok) {
+        ESP_LOGI(TAG_BLE, "%zu frames, %" PRIu64 " KB in %" PRIu32 " ms (%" PRIu64 " KB/s)",
+                 up.entries.size(), up.bytes / 1024, ms, ms ? up.bytes * 1000 / 1024 / ms : 0);
+    }
+    return ok;
+#else
+    return false;
+#endif
+}
+
+void BleUpload::reject()
+{
+#if BLE_UPLOAD_AVAILABLE
+    ble_l2cap_chan* chan = s_chan.load();
+    if (chan) {
+        ble_l2cap_disconnect(chan);
+    }
+#endif
+}
+
+void BleUpload::getStats(Stats& out)
+{
+    portENTER_CRITICAL(&s_lock);
+    out = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
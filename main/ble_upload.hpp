@@ -0,0 +1,82 @@
+/**
+ * @file ble_upload.hpp
+ * @brief Image packs uploaded over a BLE L2CAP connection-oriented channel
+ *
+ * With BLE_UPLOAD_ENABLED the device advertises as BLE_UPLOAD_NAME and
+ * listens for an L2CAP CoC on BLE_UPLOAD_PSM. Unlike GATT writes, a CoC
+ * carries BLE_UPLOAD_MTU-byte SDUs, segmented by the controller into
+ * full-length (251-byte, 2M PHY) packets, with credit-based flow control:
+ * the sender may only send an SDU for which a receive buffer was granted.
+ *
+ * The host task only queues SDUs; the slideshow task (Command::UPLOAD)
+ * writes them to the card. A new credit is granted as each SDU is queued
+ * while fewer than BLE_UPLOAD_BUFFERS wait, and otherwise only once the
+ * card has taken one, so a slow card slows the sender down instead of
+ * running the heap out.
+ *
+ * The stream is, all little-endian,
+ *
+ *     "EPDU" <u32 count>
+ *     count x { <u32 length> <u32 FNV-1a of the frame> <u32 name hash> }
+ *     the count .epd frames back to back
+ *
+ * and becomes a new IMAGE_PACK_FILE with the slides in that order (written
+ * to BLE_UPLOAD_TEMP_FILE, renamed over it once complete and every frame
+ * matched its hash). The device answers with one byte, 0 if the pack was
+ * replaced, 1 if not, and the sender closes the channel. One upload per
+ * channel.
+ *
+ * NimBLE needs CONFIG_BT_ENABLED, CONFIG_BT_NIMBLE_ENABLED and
+ * CONFIG_BT_NIMBLE_L2CAP_COC_MAX_NUM >= 1 in menuconfig; without them
+ * start() only logs that BLE uploads are unavailable.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace BleUpload {
+
+/**
+ * @brief Totals since boot
+ */
+struct Stats {
+    uint32_t uploads;     // Packs replaced
+    uint32_t failures;    // Uploads that left the pack unchanged
+    uint64_t bytes;       // Stream bytes received by the last upload
+    uint32_t frames;      // Frames in the last upload
+    uint32_t ms;          // Last upload, first SDU to the renamed pack
+    uint32_t sdus;        // SDUs received, all uploads
+    uint32_t stalls;      // SDUs that found every buffer taken, so the credit waited for the card
+    uint32_t peakQueued;  // Most SDUs waiting for the card at once
+};
+
+/**
+ * @brief Start the BLE host and advertise (once; later calls do nothing)
+ * @return false if BLE_UPLOAD_ENABLED is false, NimBLE isn't built in or
+ *         the host didn't start
+ */
+bool start();
+
+/**
+ * @brief Receive the upload on the open channel into a new image pack
+ *
+ * Only on the slideshow task, with the panel idle, the pack closed and the
+ * card mounted. Returns after the answer byte has been sent.
+ *
+ * @return true if the pack was replaced
+ */
+bool receive();
+
+/**
+ * @brief Close the channel waiting for the slideshow task without reading
+ *        it (the slideshow isn't displaying slides)
+ */
+void reject();
+
+/**
+ * @brief Copy the totals
+ */
+void getStats(Stats& out);
+
+} // namespace BleUpload
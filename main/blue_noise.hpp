@@ -0,0 +1,34 @@
+/**
+ * @file blue_noise.hpp
+ * @brief Blue-noise threshold mask for Dither::Mode::BLUE_NOISE
+ *
+ * blue_noise.cpp is generated by tools/epd_blue_noise.py (void-and-cluster):
+ * a SIZE x SIZE tile of thresholds 0..255 in flash, each level evenly
+ * spread with no low-frequency clumps, that wraps without seams. The
+ * threshold of a pixel depends only on its frame position, so rows, bands,
+ * tiles and cores can be dithered independently and still meet exactly.
+ * Regenerate after changing SIZE:
+ *
+ *     tools/epd_blue_noise.py --size 64 -o main/blue_noise.cpp
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace BlueNoise {
+
+constexpr size_t SIZE = 64;  // A power of two: positions wrap with a mask
+
+extern const uint8_t MASK[SIZE * SIZE];
+
+/**
+ * @brief The mask row a frame row uses
+ */
+inline const uint8_t* row(uint32_t y)
+{
+    return &MASK[(y & (SIZE - 1)) * SIZE];
+}
+
+} // namespace BlueNoise
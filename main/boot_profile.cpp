@@ -0,0 +1,135 @@
+/**
+ * @file boot_profile.cpp
+ * @brief Boot profile implementation
+ */
+
+#include "boot_profile.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_private/esp_clk.h"
+#include "freertos/FreeRTOS.h"
+#include <cinttypes>
+#include <cstdio>
+
+static const char* TAG_BOOT = "BootProfile";
+
+static constexpr size_t MARK_COUNT = static_cast<size_t>(BootProfile::Mark::COUNT);
+
+// Kept across deep sleep and soft resets (not power loss)
+struct StoredResult {
+    uint32_t magic;  // RESULT_MAGIC when valid
+    BootProfile::Result result;
+};
+static constexpr uint32_t RESULT_MAGIC = 0x544F4F42;  // "BOOT" little-endian
+static RTC_DATA_ATTR StoredResult s_stored;
+
+static BootProfile::Result s_current = { false, -1, { -1, -1, -1, -1, -1, -1, -1, -1 } };
+static BootProfile::Result s_previous;
+static bool s_hasPrevious = false;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static_assert(MARK_COUNT == 8, "s_current's initializer lists every mark");
+
+void BootProfile::begin(bool wake)
+{
+    int64_t now = esp_timer_get_time();
+    s_hasPrevious = s_stored.magic == RESULT_MAGIC;
+    if (s_hasPrevious) {
+        s_previous = s_stored.result;
+        log("Previous boot", s_previous);
+    }
+
+    s_current.wake = wake;
+    // The RTC clock runs on through deep sleep and soft resets, so it only
+    // dates the reset after a power-on
+    if (esp_reset_reason() == ESP_RST_POWERON) {
+        int64_t rtcUs = static_cast<int64_t>(esp_clk_rtc_time());
+        s_current.preAppUs = rtcUs > now ? rtcUs - now : -1;
+    }
+    mark(Mark::APP_MAIN);
+}
+
+void BootProfile::mark(Mark mark)
+{
+    size_t i = static_cast<size_t>(mark);
+    if (i >= MARK_COUNT) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    bool first;
+    portENTER_CRITICAL(&s_lock);
+    first = s_current.us[i] < 0;
+    if (first) {
+        s_current.us[i] = now;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (first && mark == Mark::GLASS) {
+        Result result;
+        current(result);
+        s_stored.result = result;
+        s_stored.magic = RESULT_MAGIC;
+        log("This boot", result);
+    }
+}
+
+bool BootProfile::reached(Mark mark)
+{
+    Result result;
+    current(result);
+    size_t i = static_cast<size_t>(mark);
+    return i < MARK_COUNT && result.us[i] >= 0;
+}
+
+void BootProfile::current(Result& out)
+{
+    portENTER_CRITICAL(&s_lock);
+    out = s_current;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+bool BootProfile::previous(Result& out)
+{
+    if (s_hasPrevious) {
+        out = s_previous;
+    }
+    return s_hasPrevious;
+}
+
+const char* BootProfile::markName(Mark mark)
+{
+    static const char* const names[MARK_COUNT] = {
+        "app", "init", "display", "mounted", "list", "frame", "refresh", "glass",
+    };
+    size_t i = static_cast<size_t>(mark);
+    return i < MARK_COUNT ? names[i] : "?";
+}
+
+void BootProfile::log(const char* label, const Result& result)
+{
+    char line[160] = "";
+    size_t len = 0;
+    for (size_t i = 0; i < MARK_COUNT && len < sizeof(line); i++) {
+        if (result.us[i] < 0) {
+            continue;
+        }
+        int n = snprintf(line + len, sizeof(line) - len, "%s%s %" PRId64, len ? " " : "",
+                         markName(static_cast<Mark>(i)), result.us[i] / 1000);
+        len += n > 0 ? static_cast<size_t>(n) : 0;
+    }
+
+    size_t glass = static_cast<size_t>(Mark::GLASS);
+    const char* kind = result.wake ? "wake" : "cold";
+    if (result.us[glass] < 0) {
+        ESP_LOGI(TAG_BOOT, "%s (%s): no image yet (%s ms)", label, kind, line);
+    } else if (result.preAppUs >= 0) {
+        ESP_LOGI(TAG_BOOT, "%s (%s): first image %" PRId64 " ms after reset, %" PRId64
+                 " ms of it before the app (%s ms)", label, kind,
+                 (result.preAppUs + result.us[glass]) / 1000, result.preAppUs / 1000, line);
+    } else {
+        ESP_LOGI(TAG_BOOT, "%s (%s): first image %" PRId64 " ms after app start (%s ms)",
+                 label, kind, result.us[glass] / 1000, line);
+    }
+}
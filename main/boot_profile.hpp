@@ -0,0 +1,92 @@
+/**
+ * @file boot_profile.hpp
+ * @brief Time from reset to the first image on the glass, by phase
+ *
+ * Each boot records when it passes a few marks, in esp_timer time (which
+ * starts with the application), plus the ROM and bootloader time before it
+ * when that can be known. The last complete profile is kept in RTC memory,
+ * so the next boot after a deep sleep (or a soft reset) can still log it
+ * and report it to the console.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace BootProfile {
+
+/**
+ * @brief Boot milestones, in the order a normal boot reaches them
+ *
+ * The SD marks may come before DISPLAY_READY: the card is mounted on its
+ * own task while the display comes up.
+ */
+enum class Mark : uint8_t {
+    APP_MAIN,       // app_main() entered
+    INIT,           // Slideshow::init() entered
+    DISPLAY_READY,  // Display reset and begin() done
+    SD_MOUNTED,     // SDCard::init() done
+    LIST_READY,     // Image list or pack table built
+    FRAME_READY,    // First slide in the framebuffer (ImageLoader)
+    REFRESH,        // Its planes are uploaded and the refresh has started
+    GLASS,          // Its refresh is done: the first image is on the glass
+    COUNT
+};
+
+/**
+ * @brief One boot's profile
+ */
+struct Result {
+    bool wake;                                     // Woken from deep sleep
+    int64_t preAppUs;                              // Reset to app start, -1 if unknown
+    int64_t us[static_cast<size_t>(Mark::COUNT)];  // esp_timer time, -1 if not reached
+};
+
+/**
+ * @brief Start this boot's profile; call first thing in app_main()
+ *
+ * Logs the previous boot's profile if RTC memory still holds one. The
+ * ROM and bootloader time is only known after a power-on reset, when the
+ * RTC clock starts with the chip.
+ *
+ * @param wake Woken from deep sleep
+ */
+void begin(bool wake);
+
+/**
+ * @brief Record reaching a mark; only the first time counts. Safe from any task
+ *
+ * Reaching GLASS completes the profile: it is logged and kept in RTC memory.
+ */
+void mark(Mark mark);
+
+/**
+ * @brief Whether this boot has reached a mark
+ */
+bool reached(Mark mark);
+
+/**
+ * @brief This boot's profile so far
+ */
+void current(Result& out);
+
+/**
+ * @brief The last complete profile before this boot
+ * @return false if RTC memory held none (cold boot, or it never got there)
+ */
+bool previous(Result& out);
+
+/**
+ * @brief Short mark name for logs
+ */
+const char* markName(Mark mark);
+
+/**
+ * @brief Log a profile: the total to the glass, then each mark
+ * @param label Line prefix, e.g. "This boot"
+ * @param result Profile to log
+ */
+void log(const char* label, const Result& result);
+
+} // namespace BootProfile
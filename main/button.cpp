@@ -7,28 +7,165 @@
 #include "config.hpp"
 #include "esp_sleep.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include <algorithm>
+
+#if CONFIG_ULP_COPROC_TYPE_LP_CORE
+#include "driver/rtc_io.h"
+#include "ulp_lp_core.h"
+#include "ulp_lp_buttons.h"
+
+extern const uint8_t lp_buttons_bin_start[] asm("_binary_ulp_lp_buttons_bin_start");
+extern const uint8_t lp_buttons_bin_end[] asm("_binary_ulp_lp_buttons_bin_end");
+
+// ulp/lp_buttons.c: its gesture word
+static constexpr uint32_t LP_GESTURE_LONG = 0x100;
+#endif
 
 static const char* TAG_BTN = "SlideshowButtons";
 
 static QueueHandle_t s_btnQueue = nullptr;
 
+struct ButtonState {
+    gpio_num_t gpio;
+    SlideshowButtonId id;
+    esp_timer_handle_t timer;  // Debounce, then hold-time ticks while down
+    bool down;                 // Debounced level
+    bool longSent;             // LONG_PRESS already reported for this press
+    int64_t pressedAt;         // esp_timer time of the debounced press
+    int64_t edgeAt;            // esp_timer time of the edge that started the debounce
+};
+
+static ButtonState s_buttons[] = {
+    { BTN_UP_GPIO,     SlideshowButtonId::UP,     nullptr, false, false, 0, 0 },
+    { BTN_SELECT_GPIO, SlideshowButtonId::SELECT, nullptr, false, false, 0, 0 },
+    { BTN_DOWN_GPIO,   SlideshowButtonId::DOWN,   nullptr, false, false, 0, 0 },
+};
+
+/**
+ * @brief Wait for the next change of a button's debounced level
+ *
+ * Light-sleep GPIO wakeup only works with level interrupts, so those arm
+ * the opposite level; edge mode takes both edges.
+ */
+static void armInterrupt(ButtonState& btn)
+{
+    if (LIGHT_SLEEP_ENABLED) {
+        gpio_wakeup_enable(btn.gpio, btn.down ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL);
+    }
+    gpio_intr_enable(btn.gpio);
+}
+
+/**
+ * @brief Queue an event for the slideshow task
+ * @param stamp When the input happened, for the input-to-refresh latency
+ */
+static void send(const ButtonState& btn, SlideshowButtonAction action, int64_t stamp)
+{
+    SlideshowButtonEvent ev{ btn.id, action };
+    ev.stamp = stamp;
+    if (xQueueSend(s_btnQueue, &ev, 0) != pdTRUE) {
+        ESP_LOGW(TAG_BTN, "Button queue full, event dropped");
+    }
+}
+
+/**
+ * @brief Debounce and hold-time state machine, run in the esp_timer task
+ *
+ * Fires BUTTON_DEBOUNCE_MS after the last edge (the ISR restarts it on
+ * every bounce), then every hold step while the button stays down.
+ */
+static void buttonTimer(void* arg)
+{
+    ButtonState& btn = *static_cast<ButtonState*>(arg);
+    bool down = gpio_get_level(btn.gpio) == 0;
+    int64_t now = esp_timer_get_time();
+
+    if (down != btn.down) {
+        btn.down = down;
+        btn.longSent = false;
+        btn.pressedAt = now;
+        // The press happened at the edge; the debounce is part of the latency
+        send(btn, down ? SlideshowButtonAction::PRESS : SlideshowButtonAction::RELEASE,
+             btn.edgeAt);
+        if (down) {
+            esp_timer_start_once(btn.timer, BUTTON_LONG_PRESS_MS * 1000ULL);
+        }
+        armInterrupt(btn);
+        return;
+    }
+
+    if (!down) {
+        // A bounce that settled back to released
+        armInterrupt(btn);
+        return;
+    }
+
+    // Held. A bounce during the hold also lands here, so go by the clock
+    int64_t held = now - btn.pressedAt;
+    if (held < BUTTON_LONG_PRESS_MS * 1000LL) {
+        esp_timer_start_once(btn.timer, BUTTON_LONG_PRESS_MS * 1000ULL - held);
+    } else {
+        send(btn, btn.longSent ? SlideshowButtonAction::REPEAT : SlideshowButtonAction::LONG_PRESS,
+             now);
+        btn.longSent = true;
+        esp_timer_start_once(btn.timer, BUTTON_REPEAT_MS * 1000ULL);
+    }
+    armInterrupt(btn);
+}
+
 static void IRAM_ATTR gpio_isr_handler(void* arg)
 {
-    SlideshowButtonId realId = *(SlideshowButtonId*)arg;
+    ButtonState* btn = static_cast<ButtonState*>(arg);
 
-    SlideshowButtonEvent ev{ realId, true };  // Press event
-    BaseType_t hpw = pdFALSE;
-    xQueueSendFromISR(s_btnQueue, &ev, &hpw);
-    if (hpw == pdTRUE) portYIELD_FROM_ISR();
+    // Mask the pin (a level interrupt would otherwise refire at once) and
+    // let the timer sample it once the contacts have settled. Masked, this
+    // runs once per debounce, at its first edge
+    btn->edgeAt = esp_timer_get_time();
+    gpio_intr_disable(btn->gpio);
+    esp_timer_stop(btn->timer);
+    esp_timer_start_once(btn->timer, BUTTON_DEBOUNCE_MS * 1000ULL);
+}
+
+/**
+ * @brief Whether deep sleep wakes go through the LP core program
+ */
+static bool lpCoreWake()
+{
+#if CONFIG_ULP_COPROC_TYPE_LP_CORE
+    if (!LP_BUTTONS_ENABLED) {
+        return false;
+    }
+    for (const ButtonState& btn : s_buttons) {
+        if (!rtc_gpio_is_valid_gpio(btn.gpio)) {
+            ESP_LOGW(TAG_BTN, "GPIO%d is not an LP IO, EXT1 wake instead", btn.gpio);
+            return false;
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
 }
 
 bool SlideshowButtons::init(QueueHandle_t evt_queue)
 {
     s_btnQueue = evt_queue;
 
+#if CONFIG_ULP_COPROC_TYPE_LP_CORE
+    // The LP core keeps polling after it woke us: take the pins back
+    if (lpCoreWake()) {
+        ulp_lp_core_stop();
+        for (const ButtonState& btn : s_buttons) {
+            rtc_gpio_deinit(btn.gpio);
+        }
+    }
+#endif
+
     gpio_config_t io_conf{};
     io_conf.mode = GPIO_MODE_INPUT;
-    io_conf.intr_type = GPIO_INTR_NEGEDGE; // assuming buttons to GND, pull-ups
+    // Buttons to GND, pull-ups
+    io_conf.intr_type = LIGHT_SLEEP_ENABLED ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_ANYEDGE;
     io_conf.pull_up_en = GPIO_PULLUP_ENABLE;
     io_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
 
@@ -38,15 +175,30 @@ bool SlideshowButtons::init(QueueHandle_t evt_queue)
                            (1ULL << BTN_DOWN_GPIO);
     ESP_ERROR_CHECK(gpio_config(&io_conf));
 
-    ESP_ERROR_CHECK(gpio_install_isr_service(0));
+    // The EPD driver may already have installed the shared ISR service
+    esp_err_t isr_ret = gpio_install_isr_service(0);
+    if (isr_ret != ESP_OK && isr_ret != ESP_ERR_INVALID_STATE) {
+        ESP_ERROR_CHECK(isr_ret);
+    }
 
-    static SlideshowButtonId upId   = SlideshowButtonId::UP;
-    static SlideshowButtonId selId  = SlideshowButtonId::SELECT;
-    static SlideshowButtonId downId = SlideshowButtonId::DOWN;
+    for (ButtonState& btn : s_buttons) {
+        esp_timer_create_args_t args = {};
+        args.callback = buttonTimer;
+        args.arg = &btn;
+        args.name = "button";
+        ESP_ERROR_CHECK(esp_timer_create(&args, &btn.timer));
 
-    ESP_ERROR_CHECK(gpio_isr_handler_add(BTN_UP_GPIO, gpio_isr_handler, &upId));
-    ESP_ERROR_CHECK(gpio_isr_handler_add(BTN_SELECT_GPIO, gpio_isr_handler, &selId));
-    ESP_ERROR_CHECK(gpio_isr_handler_add(BTN_DOWN_GPIO, gpio_isr_handler, &downId));
+        // A button still held from the wake-up press only reports its release
+        btn.down = gpio_get_level(btn.gpio) == 0;
+        if (LIGHT_SLEEP_ENABLED) {
+            ESP_ERROR_CHECK(gpio_wakeup_enable(btn.gpio, btn.down ? GPIO_INTR_HIGH_LEVEL :
+                                                                    GPIO_INTR_LOW_LEVEL));
+        }
+        ESP_ERROR_CHECK(gpio_isr_handler_add(btn.gpio, gpio_isr_handler, &btn));
+    }
+    if (LIGHT_SLEEP_ENABLED) {
+        ESP_ERROR_CHECK(esp_sleep_enable_gpio_wakeup());
+    }
 
     ESP_LOGI(TAG_BTN, "Slideshow buttons initialized");
     return true;
@@ -54,6 +206,41 @@ bool SlideshowButtons::init(QueueHandle_t evt_queue)
 
 void SlideshowButtons::configure_wakeup()
 {
+#if CONFIG_ULP_COPROC_TYPE_LP_CORE
+    if (lpCoreWake()) {
+        // Hand the pins to the LP core; init() takes them back
+        for (const ButtonState& btn : s_buttons) {
+            rtc_gpio_init(btn.gpio);
+            rtc_gpio_set_direction(btn.gpio, RTC_GPIO_MODE_INPUT_ONLY);
+            rtc_gpio_pullup_en(btn.gpio);
+            rtc_gpio_pulldown_dis(btn.gpio);
+        }
+        esp_err_t err = ulp_lp_core_load_binary(lp_buttons_bin_start,
+                                                lp_buttons_bin_end - lp_buttons_bin_start);
+        if (err == ESP_OK) {
+            uint32_t* pins = &ulp_pins;
+            for (size_t i = 0; i < sizeof(s_buttons) / sizeof(s_buttons[0]); i++) {
+                pins[i] = static_cast<uint32_t>(s_buttons[i].gpio);
+            }
+            ulp_debounce_ticks = std::max<uint32_t>(BUTTON_DEBOUNCE_MS / LP_BUTTONS_POLL_MS, 1);
+            ulp_long_ticks = std::max<uint32_t>(BUTTON_LONG_PRESS_MS / LP_BUTTONS_POLL_MS, 1);
+
+            ulp_lp_core_cfg_t cfg = {};
+            cfg.wakeup_source = ULP_LP_CORE_WAKEUP_SOURCE_LP_TIMER;
+            cfg.lp_timer_sleep_duration_us = LP_BUTTONS_POLL_MS * 1000;
+            err = ulp_lp_core_run(&cfg);
+        }
+        if (err == ESP_OK) {
+            ESP_ERROR_CHECK(esp_sleep_enable_ulp_wakeup());
+            return;
+        }
+        ESP_LOGE(TAG_BTN, "LP core start failed (%s), EXT1 wake instead", esp_err_to_name(err));
+        for (const ButtonState& btn : s_buttons) {
+            rtc_gpio_deinit(btn.gpio);
+        }
+    }
+#endif
+
     // All buttons as EXT1 wake sources (any low)
     uint64_t mask = (1ULL << BTN_UP_GPIO) |
                     (1ULL << BTN_SELECT_GPIO) |
@@ -63,3 +250,34 @@ void SlideshowButtons::configure_wakeup()
     // NOTE: these GPIOs must be RTC-capable; adjust pins if necessary.
 }
 
+bool SlideshowButtons::wakeGesture(SlideshowButtonEvent& event)
+{
+    esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+    event.action = SlideshowButtonAction::PRESS;
+#if CONFIG_ULP_COPROC_TYPE_LP_CORE
+    if (cause == ESP_SLEEP_WAKEUP_ULP) {
+        uint32_t gesture = ulp_gesture;
+        size_t button = (gesture & 0xFF) - 1;
+        if (button >= sizeof(s_buttons) / sizeof(s_buttons[0])) {
+            return false;
+        }
+        event.id = s_buttons[button].id;
+        if (gesture & LP_GESTURE_LONG) {
+            event.action = SlideshowButtonAction::LONG_PRESS;
+        }
+        return true;
+    }
+#endif
+    if (cause != ESP_SLEEP_WAKEUP_EXT1) {
+        return false;
+    }
+    // Only which pins were low: no press length
+    uint64_t pins = esp_sleep_get_ext1_wakeup_status();
+    for (const ButtonState& btn : s_buttons) {
+        if (pins & (1ULL << btn.gpio)) {
+            event.id = btn.id;
+            return true;
+        }
+    }
+    return false;
+}
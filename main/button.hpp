@@ -12,18 +12,40 @@
 enum class SlideshowButtonId {
     UP,      // Previous image
     SELECT,  // Toggle auto-advance / Favorite
-    DOWN     // Next image
+    DOWN,    // Next image
+    COMMAND, // Not a button: a Slideshow::post() command (console)
+    RESUME   // Not a button: a RenderFlow coroutine is ready to continue
+};
+
+enum class SlideshowButtonAction {
+    PRESS,       // Debounced press
+    RELEASE,     // Debounced release
+    LONG_PRESS,  // Held for BUTTON_LONG_PRESS_MS (once per press)
+    REPEAT       // Still held, every BUTTON_REPEAT_MS after LONG_PRESS
 };
 
 struct SlideshowButtonEvent {
     SlideshowButtonId id;
-    bool pressed;  // true on press, false on release
+    SlideshowButtonAction action;
+    uint8_t command = 0;  // COMMAND only: Slideshow::Command
+    uint32_t arg = 0;     // COMMAND only: its argument
+    int64_t stamp = 0;    // esp_timer time of the input: the pin's edge, or the post()
 };
 
 namespace SlideshowButtons {
 
 bool init(QueueHandle_t evt_queue);
-void configure_wakeup();  // for deep sleep wake
+void configure_wakeup();  // for deep sleep wake, right before esp_deep_sleep_start()
+
+/**
+ * @brief The button gesture that woke the chip from deep sleep
+ *
+ * With the LP core (LP_BUTTONS_ENABLED) a debounced PRESS or LONG_PRESS,
+ * with EXT1 the first button whose pin was low, as a PRESS.
+ *
+ * @return false if no button woke it (timer, glitch, power-on)
+ */
+bool wakeGesture(SlideshowButtonEvent& event);
 
 } // namespace SlideshowButtons
 
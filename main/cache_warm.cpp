@@ -0,0 +1,109 @@
+/**
+ * @file cache_warm.cpp
+ * @brief Background conversion implementation
+ */
+
+#include "cache_warm.hpp"
+#include "config.hpp"
+#include "image_loader.hpp"
+#include "render_job.hpp"
+#include "sd_card.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "../components/Adafruit_EPD/src/Adafruit_EPD.h"
+#include <cinttypes>
+#include <memory>
+#include <new>
+
+static const char* TAG_WARM = "CacheWarm";
+
+static bool s_pending = CACHE_WARM_ENABLED;
+static size_t s_next = 0;
+static std::unique_ptr<uint8_t[]> s_planes;  // Both planes, only during a walk
+static uint32_t s_converted = 0;
+static uint32_t s_failed = 0;
+static int64_t s_busyUs = 0;
+
+/**
+ * @brief End the walk and give its planes back
+ */
+static void finish()
+{
+    if (s_converted != 0 || s_failed != 0) {
+        ESP_LOGI(TAG_WARM, "Walk done: %" PRIu32 " converted, %" PRIu32 " failed, %" PRId64 " ms decoding",
+                 s_converted, s_failed, s_busyUs / 1000);
+    }
+    s_pending = false;
+    s_planes.reset();
+}
+
+void CacheWarm::restart()
+{
+    s_pending = CACHE_WARM_ENABLED;
+    s_next = 0;
+    s_converted = 0;
+    s_failed = 0;
+    s_busyUs = 0;
+}
+
+bool CacheWarm::pending()
+{
+    return s_pending;
+}
+
+bool CacheWarm::step(size_t count, PathFn path, Adafruit_IL0373* display)
+{
+    if (!s_pending) {
+        return false;
+    }
+    if (!ImageLoader::isCacheEnabled() || !display) {
+        finish();
+        return false;
+    }
+    size_t size1 = display->getBufferSize(0);
+    size_t size2 = display->getBufferSize(1);
+    if (!s_planes) {
+        s_planes.reset(new (std::nothrow) uint8_t[size1 + size2]);
+        if (!s_planes) {
+            ESP_LOGW(TAG_WARM, "No RAM for the planes, not converting");
+            finish();
+            return false;
+        }
+    }
+
+    RenderJob::Scope job(RenderJob::Priority::BACKGROUND);
+    for (size_t checked = 0; checked < CACHE_WARM_CHECKS_PER_STEP; checked++) {
+        if (s_next >= count) {
+            finish();
+            return false;
+        }
+        char filepath[SDCard::ImageList::MAX_PATH];
+        if (!path(s_next, filepath, sizeof(filepath))) {
+            s_next++;
+            continue;
+        }
+
+        int64_t start = esp_timer_get_time();
+        ImageLoader::WarmResult result = ImageLoader::warmCache(
+            filepath, display, s_planes.get(), size2 ? s_planes.get() + size1 : nullptr);
+        if (result == ImageLoader::WarmResult::SKIPPED) {
+            s_next++;
+            continue;
+        }
+        s_busyUs += esp_timer_get_time() - start;
+        if (result == ImageLoader::WarmResult::FAILED && RenderJob::cancelled()) {
+            // Input came in: the same slide again next time
+            return true;
+        }
+        if (result == ImageLoader::WarmResult::CONVERTED) {
+            s_converted++;
+        } else {
+            s_failed++;
+        }
+        ESP_LOGD(TAG_WARM, "%s: %s", filepath,
+                 result == ImageLoader::WarmResult::CONVERTED ? "converted" : "failed");
+        s_next++;
+        return true;
+    }
+    return true;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file cache_warm.hpp
+ * @brief Background conversion of slides into the converted-frame cache
+ *
+ * Decoding a JPEG, PNG or BMP on its first visit is the slowest load the
+ * slideshow has, and without this every slide pays it once per new card or
+ * changed image. A walk goes through the slide list in order and converts
+ * each slide the cache doesn't hold yet (ImageLoader::warmCache()), one per
+ * step(), into two planes of its own: the framebuffer, the prefetch slots
+ * and the panel are untouched. The slideshow task calls step() only while
+ * idle, so a conversion never delays a render job; input cancels it
+ * (RenderJob::Priority::BACKGROUND) and the same slide is tried again on
+ * the next step. Only for the slideshow task.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+class Adafruit_IL0373;
+
+namespace CacheWarm {
+
+/**
+ * @brief Slide path by index; false skips the slide
+ */
+using PathFn = bool (*)(size_t index, char* out, size_t outSize);
+
+/**
+ * @brief Start a new walk from the first slide, e.g. after the list changed
+ */
+void restart();
+
+/**
+ * @brief Check whether the current walk has slides left
+ */
+bool pending();
+
+/**
+ * @brief Convert the next slide missing from the cache, at most one
+ * @param count Slides in the list
+ * @param path Looks up each slide's path
+ * @param display Defines the plane layout
+ * @return pending(): false once the walk has been through the list
+ */
+bool step(size_t count, PathFn path, Adafruit_IL0373* display);
+
+} // namespace CacheWarm
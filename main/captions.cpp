@@ -0,0 +1,348 @@
+/**
+ * @file captions.cpp
+ * @brief Caption layout, storage and drawing
+ */
+
+#include "captions.hpp"
+#include "config.hpp"
+#include "sd_card.hpp"
+#include "text_layout.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "../components/Adafruit_EPD/src/Adafruit_EPD.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <new>
+
+static const char* TAG_CAPTION = "Captions";
+
+static_assert(CAPTION_MAX_CHARS <= 255, "Line runs hold 8-bit offsets");
+
+static constexpr uint32_t CAPTIONS_MAGIC = 0x54504143;  // "CAPT" little-endian
+
+// Wrapped line width; the margin is kept on both sides
+static constexpr int16_t WRAP_WIDTH = DISPLAY_WIDTH - 2 * CAPTION_MARGIN;
+
+// Changes whenever a stored layout would come out differently
+static constexpr uint32_t LAYOUT_KEY =
+    (static_cast<uint32_t>(WRAP_WIDTH) << 16) | (CAPTION_TEXT_SIZE << 8) | CAPTION_MAX_LINES;
+
+#pragma pack(push, 1)
+/**
+ * @brief One wrapped line: a run of the caption text and where it starts
+ */
+struct LineRun {
+    int16_t x;       // Left edge, centered
+    uint8_t start;   // Offset in the caption text
+    uint8_t length;  // Characters
+};
+
+/**
+ * @brief A laid-out caption in the blob, followed by textLength characters
+ */
+struct Record {
+    uint32_t hash;       // FNV-1a of the text, for cache keys
+    uint8_t lineCount;
+    uint8_t textLength;
+    LineRun lines[CAPTION_MAX_LINES];
+};
+
+/**
+ * @brief Caption of one image: the image path's hash and its record
+ */
+struct Key {
+    uint32_t pathHash;
+    uint32_t offset;  // Of the Record in the blob
+};
+
+/**
+ * @brief CAPTIONS_FILE header, followed by the keys (sorted) and the blob
+ */
+struct FileHeader {
+    uint32_t magic;         // CAPTIONS_MAGIC
+    uint32_t listChecksum;  // Image list the captions belong to
+    uint32_t layout;        // LAYOUT_KEY they were wrapped with
+    uint32_t keyCount;
+    uint32_t blobSize;
+};
+#pragma pack(pop)
+
+static std::unique_ptr<Key[]> s_keys;
+static std::unique_ptr<uint8_t[]> s_blob;
+static size_t s_keyCount = 0;
+static size_t s_blobSize = 0;
+
+static uint32_t fnv1a(const char* text, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ static_cast<uint8_t>(text[i])) * 16777619u;
+    }
+    return hash;
+}
+
+static void captionsPath(char* out, size_t outSize)
+{
+    snprintf(out, outSize, "%s/%s", IMAGE_CACHE_DIRECTORY, CAPTIONS_FILE);
+}
+
+/**
+ * @brief Read an image's caption from its sidecar, "caption=" lines joined
+ *        by '\n'
+ * @return Characters read, 0 without a caption
+ */
+static size_t readCaption(const char* imagePath, char* text, size_t textSize)
+{
+    const char* dot = strrchr(imagePath, '.');
+    if (!dot) {
+        return 0;
+    }
+    char path[SDCard::ImageList::MAX_PATH];
+    int stem = static_cast<int>(dot - imagePath);
+    if (snprintf(path, sizeof(path), "%.*s%s", stem, imagePath, IMAGE_SIDECAR_EXTENSION) >=
+        static_cast<int>(sizeof(path))) {
+        return 0;
+    }
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return 0;
+    }
+    size_t len = 0;
+    char line[128];
+    while (fgets(line, sizeof(line), file)) {
+        const char* p = line + strspn(line, " \t");
+        if (strncmp(p, "caption", 7) != 0) {
+            continue;
+        }
+        p += 7;
+        p += strspn(p, " \t");
+        if (*p++ != '=') {
+            continue;
+        }
+        p += strspn(p, " \t");
+        size_t n = strcspn(p, "\r\n");
+        if (len > 0 && len + 1 < textSize) {
+            text[len++] = '\n';
+        }
+        n = std::min(n, textSize - 1 - len);
+        memcpy(text + len, p, n);
+        len += n;
+    }
+    fclose(file);
+    text[len] = '\0';
+    return len;
+}
+
+/**
+ * @brief Wrap a caption into a record
+ * @return false if nothing of it fits a line
+ */
+static bool layOut(const TextLayout::Metrics& metrics, const char* text, size_t len,
+                   Record& record)
+{
+    TextLayout::Line lines[CAPTION_MAX_LINES];
+    size_t count = TextLayout::wrap(metrics, text, WRAP_WIDTH, lines, CAPTION_MAX_LINES);
+    record = {};
+    record.hash = fnv1a(text, len);
+    record.textLength = static_cast<uint8_t>(len);
+    for (size_t i = 0; i < count; i++) {
+        record.lines[i].x = static_cast<int16_t>((DISPLAY_WIDTH - lines[i].width) / 2);
+        record.lines[i].start = static_cast<uint8_t>(lines[i].start);
+        record.lines[i].length = static_cast<uint8_t>(lines[i].length);
+    }
+    record.lineCount = static_cast<uint8_t>(count);
+    return count > 0;
+}
+
+static bool readStored(uint32_t listChecksum)
+{
+    char path[64];
+    captionsPath(path, sizeof(path));
+    FILE* file = SDCard::openFile(path);
+    if (!file) {
+        return false;
+    }
+    FileHeader header;
+    bool ok = fread(&header, 1, sizeof(header), file) == sizeof(header) &&
+              header.magic == CAPTIONS_MAGIC && header.listChecksum == listChecksum &&
+              header.layout == LAYOUT_KEY && header.keyCount <= MAX_IMAGE_FILES &&
+              header.blobSize <= CAPTION_BUDGET_BYTES;
+    if (ok) {
+        s_keys.reset(new (std::nothrow) Key[header.keyCount]);
+        s_blob.reset(new (std::nothrow) uint8_t[header.blobSize]);
+        ok = s_keys && s_blob &&
+             fread(s_keys.get(), sizeof(Key), header.keyCount, file) == header.keyCount &&
+             fread(s_blob.get(), 1, header.blobSize, file) == header.blobSize;
+    }
+    fclose(file);
+    if (!ok) {
+        s_keys.reset();
+        s_blob.reset();
+        return false;
+    }
+    s_keyCount = header.keyCount;
+    s_blobSize = header.blobSize;
+    return true;
+}
+
+static void store(uint32_t listChecksum)
+{
+    if (!SDCard::makeDirectory(IMAGE_CACHE_DIRECTORY)) {
+        return;
+    }
+    char path[64];
+    captionsPath(path, sizeof(path));
+    FILE* file = SDCard::createFile(path);
+    if (!file) {
+        return;
+    }
+    FileHeader header = { CAPTIONS_MAGIC, listChecksum, LAYOUT_KEY,
+                          static_cast<uint32_t>(s_keyCount), static_cast<uint32_t>(s_blobSize) };
+    bool ok = fwrite(&header, 1, sizeof(header), file) == sizeof(header) &&
+              fwrite(s_keys.get(), sizeof(Key), s_keyCount, file) == s_keyCount &&
+              fwrite(s_blob.get(), 1, s_blobSize, file) == s_blobSize;
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        ESP_LOGW(TAG_CAPTION, "Failed to store captions");
+        remove(path);
+    }
+}
+
+/**
+ * @brief Lay out the captions of every image from its sidecar
+ *
+ * Records fill a CAPTION_BUDGET_BYTES buffer from the front and keys from
+ * the back; both are copied out at their final size.
+ */
+static void build(size_t count, Captions::PathFn pathOf)
+{
+    std::unique_ptr<uint8_t[]> work(new (std::nothrow) uint8_t[CAPTION_BUDGET_BYTES]);
+    if (!work) {
+        ESP_LOGW(TAG_CAPTION, "No memory to lay out captions");
+        return;
+    }
+    int64_t start = esp_timer_get_time();
+    TextLayout::Metrics metrics(nullptr, CAPTION_TEXT_SIZE, CAPTION_TEXT_SIZE);
+    size_t used = 0;   // Record bytes from the front
+    size_t keys = 0;   // Keys from the back
+    size_t dropped = 0;
+    for (size_t i = 0; i < count; i++) {
+        char path[SDCard::ImageList::MAX_PATH];
+        char text[CAPTION_MAX_CHARS + 1];
+        Record record;
+        size_t len;
+        if (!pathOf(i, path, sizeof(path)) || !path[0] ||
+            (len = readCaption(path, text, sizeof(text))) == 0 ||
+            !layOut(metrics, text, len, record)) {
+            continue;
+        }
+        size_t need = sizeof(Record) + len;
+        if (used + need + (keys + 1) * sizeof(Key) > CAPTION_BUDGET_BYTES) {
+            dropped++;
+            continue;
+        }
+        memcpy(work.get() + used, &record, sizeof(record));
+        memcpy(work.get() + used + sizeof(record), text, len);
+        keys++;
+        Key key = { fnv1a(path, strlen(path)), static_cast<uint32_t>(used) };
+        memcpy(work.get() + CAPTION_BUDGET_BYTES - keys * sizeof(Key), &key, sizeof(key));
+        used += need;
+    }
+    if (dropped > 0) {
+        ESP_LOGW(TAG_CAPTION, "%zu captions past CAPTION_BUDGET_BYTES left out", dropped);
+    }
+    if (keys == 0) {
+        return;
+    }
+
+    s_keys.reset(new (std::nothrow) Key[keys]);
+    s_blob.reset(new (std::nothrow) uint8_t[used]);
+    if (!s_keys || !s_blob) {
+        s_keys.reset();
+        s_blob.reset();
+        return;
+    }
+    memcpy(s_keys.get(), work.get() + CAPTION_BUDGET_BYTES - keys * sizeof(Key),
+           keys * sizeof(Key));
+    std::sort(s_keys.get(), s_keys.get() + keys,
+              [](const Key& a, const Key& b) { return a.pathHash < b.pathHash; });
+    memcpy(s_blob.get(), work.get(), used);
+    s_keyCount = keys;
+    s_blobSize = used;
+    ESP_LOGI(TAG_CAPTION, "Laid out %zu captions (%zu bytes) in %" PRId64 " ms", keys,
+             used + keys * sizeof(Key), (esp_timer_get_time() - start) / 1000);
+}
+
+void Captions::load(uint32_t listChecksum, size_t count, PathFn path)
+{
+    s_keys.reset();
+    s_blob.reset();
+    s_keyCount = 0;
+    s_blobSize = 0;
+    if (!CAPTIONS_ENABLED || count == 0) {
+        return;
+    }
+    if (readStored(listChecksum)) {
+        ESP_LOGI(TAG_CAPTION, "%zu captions", s_keyCount);
+        return;
+    }
+    build(std::min(count, MAX_IMAGE_FILES), path);
+    // Stored even when empty, so the sidecars aren't read again next boot
+    store(listChecksum);
+}
+
+/**
+ * @brief Copy out the record of an image's caption
+ * @return false if it has none
+ */
+static bool find(const char* filepath, Record& record, const char*& text)
+{
+    if (s_keyCount == 0 || !filepath) {
+        return false;
+    }
+    uint32_t hash = fnv1a(filepath, strlen(filepath));
+    const Key* begin = s_keys.get();
+    const Key* end = begin + s_keyCount;
+    const Key* key = std::lower_bound(begin, end, hash,
+                                      [](const Key& k, uint32_t h) { return k.pathHash < h; });
+    if (key == end || key->pathHash != hash || key->offset + sizeof(Record) > s_blobSize) {
+        return false;
+    }
+    memcpy(&record, s_blob.get() + key->offset, sizeof(record));
+    text = reinterpret_cast<const char*>(s_blob.get() + key->offset + sizeof(record));
+    return key->offset + sizeof(Record) + record.textLength <= s_blobSize &&
+           record.lineCount <= CAPTION_MAX_LINES;
+}
+
+uint32_t Captions::hash(const char* filepath)
+{
+    Record record;
+    const char* text;
+    return find(filepath, record, text) ? record.hash : 0;
+}
+
+bool Captions::draw(const char* filepath, Adafruit_EPD* display)
+{
+    Record record;
+    const char* text;
+    if (!display || !find(filepath, record, text)) {
+        return false;
+    }
+    int16_t lineHeight = 8 * CAPTION_TEXT_SIZE;
+    int16_t band = record.lineCount * lineHeight + 2 * CAPTION_MARGIN;
+    int16_t top = display->height() - band;
+    display->fillRect(0, top, display->width(), band, EPD_WHITE);
+    display->setTextSize(CAPTION_TEXT_SIZE);
+    display->setTextColor(EPD_BLACK);
+    for (uint8_t i = 0; i < record.lineCount; i++) {
+        LineRun run = record.lines[i];
+        display->setCursor(run.x, top + CAPTION_MARGIN + i * lineHeight);
+        for (uint8_t c = 0; c < run.length && run.start + c < record.textLength; c++) {
+            display->write(static_cast<uint8_t>(text[run.start + c]));
+        }
+    }
+    return true;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file captions.hpp
+ * @brief Per-image captions, laid out once per image list
+ *
+ * An image's caption is the "caption=" lines of its sidecar (the file
+ * ImageLoader reads the tone from). load() reads every sidecar once when
+ * the image list changes, wraps each caption to the panel width with
+ * TextLayout and keeps the result: per caption its lines as runs of the
+ * caption text with their x positions, found by the FNV-1a hash of the
+ * image's path. The table is stored in IMAGE_CACHE_DIRECTORY/CAPTIONS_FILE
+ * with the list checksum, so later boots read it in one go.
+ *
+ * draw() is then a hash lookup and one atlas blit per character: no
+ * sidecar open, no measuring and no wrapping while a slide is shown. Image
+ * packs have no paths and so no captions. Only for the slideshow task.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class Adafruit_EPD;
+
+namespace Captions {
+
+/**
+ * @brief Full path of an image by list index
+ * @return false if it has none (image packs)
+ */
+using PathFn = bool (*)(size_t index, char* out, size_t outSize);
+
+/**
+ * @brief Take the captions of an image list: from the card when they were
+ *        laid out for this list, otherwise from the sidecars (and stored)
+ * @param listChecksum Checksum of the image list
+ * @param count Images in it; only the first MAX_IMAGE_FILES are read
+ * @param path Gives each image's path
+ */
+void load(uint32_t listChecksum, size_t count, PathFn path);
+
+/**
+ * @brief Hash of an image's laid-out caption, for cache keys
+ * @return 0 if it has none
+ */
+uint32_t hash(const char* filepath);
+
+/**
+ * @brief Draw an image's caption over the bottom of the framebuffer
+ * @return false if it has none
+ */
+bool draw(const char* filepath, Adafruit_EPD* display);
+
+} // namespace Captions
@@ -0,0 +1,103 @@
+/**
+ * @file collage.cpp
+ * @brief Collage layout implementation
+ */
+
+#include "collage.hpp"
+#include "esp_log.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <strings.h>
+
+static const char* TAG_COLLAGE = "Collage";
+
+bool Collage::isCollage(const char* filepath)
+{
+    size_t pathLen = strlen(filepath);
+    size_t extLen = strlen(COLLAGE_EXTENSION);
+    return pathLen >= extLen && strcasecmp(filepath + pathLen - extLen, COLLAGE_EXTENSION) == 0;
+}
+
+bool Collage::parse(const char* filepath, Layout& layout)
+{
+    layout.columns = 0;
+    layout.rows = 0;
+    layout.count = 0;
+
+    FILE* file = fopen(filepath, "r");
+    if (!file) {
+        ESP_LOGE(TAG_COLLAGE, "Cannot open %s", filepath);
+        return false;
+    }
+    const char* slash = strrchr(filepath, '/');
+    int dirLen = slash ? static_cast<int>(slash - filepath) : 0;
+
+    char line[SDCard::ImageList::MAX_PATH];
+    size_t skipped = 0;
+    while (fgets(line, sizeof(line), file)) {
+        size_t len = strlen(line);
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' ||
+                           line[len - 1] == ' ' || line[len - 1] == '\t')) {
+            line[--len] = '\0';
+        }
+        const char* text = line + strspn(line, " \t");
+        unsigned columns;
+        unsigned rows;
+        if (text[0] == '\0' || text[0] == '#') {
+            continue;
+        }
+        if (sscanf(text, "grid = %ux%u", &columns, &rows) == 2) {
+            layout.columns = static_cast<uint8_t>(std::min(columns, 255u));
+            layout.rows = static_cast<uint8_t>(std::min(rows, 255u));
+            continue;
+        }
+        if (layout.count >= COLLAGE_MAX_TILES) {
+            skipped++;
+            continue;
+        }
+        char* path = layout.paths[layout.count];
+        int n = text[0] == '/' ? snprintf(path, sizeof(layout.paths[0]), "%s", text) :
+                                 snprintf(path, sizeof(layout.paths[0]), "%.*s/%s", dirLen,
+                                          filepath, text);
+        if (n < 0 || n >= static_cast<int>(sizeof(layout.paths[0]))) {
+            ESP_LOGW(TAG_COLLAGE, "%s: path too long: %s", filepath, text);
+            continue;
+        }
+        layout.count++;
+    }
+    fclose(file);
+
+    if (layout.columns == 0 && layout.rows == 0) {
+        // Stacked on the portrait panel; four make a square
+        layout.columns = layout.count == 4 ? 2 : 1;
+        layout.rows = layout.count == 4 ? 2 : layout.count;
+    }
+    if (layout.count == 0 || layout.columns == 0 || layout.rows == 0 ||
+        layout.columns * layout.rows > COLLAGE_MAX_TILES ||
+        tile(layout, 0).width <= 0 || tile(layout, 0).height <= 0) {
+        ESP_LOGE(TAG_COLLAGE, "%s: no images or an invalid grid (%ux%u, at most %zu tiles)",
+                 filepath, layout.columns, layout.rows, COLLAGE_MAX_TILES);
+        return false;
+    }
+    size_t tiles = static_cast<size_t>(layout.columns) * layout.rows;
+    if (layout.count > tiles) {
+        skipped += layout.count - tiles;
+        layout.count = static_cast<uint8_t>(tiles);
+    }
+    if (skipped > 0) {
+        ESP_LOGW(TAG_COLLAGE, "%s: %zu images past the last tile left out", filepath, skipped);
+    }
+    return true;
+}
+
+ImageDecode::Tile Collage::tile(const Layout& layout, size_t index)
+{
+    int16_t width = (DISPLAY_WIDTH - (layout.columns + 1) * COLLAGE_MARGIN) / layout.columns;
+    int16_t height = (DISPLAY_HEIGHT - (layout.rows + 1) * COLLAGE_MARGIN) / layout.rows;
+    int16_t column = static_cast<int16_t>(index % layout.columns);
+    int16_t row = static_cast<int16_t>(index / layout.columns);
+    return { static_cast<int16_t>(COLLAGE_MARGIN + column * (width + COLLAGE_MARGIN)),
+             static_cast<int16_t>(COLLAGE_MARGIN + row * (height + COLLAGE_MARGIN)),
+             width, height };
+}
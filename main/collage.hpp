@@ -0,0 +1,60 @@
+/**
+ * @file collage.hpp
+ * @brief Several images on one slide, each fitted into its own tile
+ *
+ * A collage is a text file among the images with the COLLAGE_EXTENSION:
+ * one image path per line, relative to the collage's folder, and an
+ * optional "grid=COLUMNSxROWS" line. Without one the images are stacked
+ * (up to three) or laid out 2x2 (four). Tiles are separated by
+ * COLLAGE_MARGIN pixels.
+ *
+ * Only the layout is worked out here. The image loader decodes each image
+ * straight into its tile of the framebuffer through the usual streaming
+ * decoders (ImageDecode::setTile()), so the whole collage is one pass over
+ * the planes and one refresh, with no frame per image.
+ */
+
+#pragma once
+
+#include "config.hpp"
+#include "image_decode.hpp"
+#include "sd_card.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace Collage {
+
+/**
+ * @brief A parsed collage file
+ */
+struct Layout {
+    uint8_t columns;
+    uint8_t rows;
+    uint8_t count;  // Images listed, at most columns * rows
+    char paths[COLLAGE_MAX_TILES][SDCard::ImageList::MAX_PATH];  // Full paths
+};
+
+/**
+ * @brief Whether a path names a collage (by its extension)
+ */
+bool isCollage(const char* filepath);
+
+/**
+ * @brief Read a collage file
+ *
+ * Images past the last tile are left out with a warning.
+ *
+ * @param filepath The collage file
+ * @param layout Set to its grid and image paths
+ * @return false if it can't be read, lists no image or its grid is invalid
+ */
+bool parse(const char* filepath, Layout& layout);
+
+/**
+ * @brief Display rectangle of a tile, in logical (rotated) coordinates
+ * @param layout Parsed collage
+ * @param index Tile, row by row
+ */
+ImageDecode::Tile tile(const Layout& layout, size_t index);
+
+} // namespace Collage
@@ -34,6 +34,42 @@ static constexpr int EINK_RESET_PIN = 13;   // Reset pin
 static constexpr int EINK_CS_PIN    = 14;   // Chip Select pin
 static constexpr int EINK_BUSY_PIN  = 15;   // Busy pin (optional, for status checking)
 
+// Longest time to wait on the BUSY pin for one refresh before giving up
+static constexpr uint32_t EINK_BUSY_TIMEOUT_MS = 30000;
+
+// Refresh times learned on the BUSY pin (RefreshTiming): each refresh's
+// time is kept in NVS (namespace REFRESH_TIMING_NVS_NAMESPACE) per panel
+// profile, refresh kind and temperature band, the longest one seen. A board
+// without the pin (EINK_BUSY_PIN = -1) then waits that long plus
+// REFRESH_TIMING_MARGIN_PERCENT instead of the panel's fixed refresh_delay;
+// run it with the pin wired once to calibrate
+static constexpr bool REFRESH_TIMING_ENABLED = true;
+static constexpr const char* REFRESH_TIMING_NVS_NAMESPACE = "refreshtime";
+static constexpr uint32_t REFRESH_TIMING_MARGIN_PERCENT = 15;
+
+// Read the IL0373's own temperature sensor (readTemperature()) at boot and
+// before auto-advanced slides, at most every EINK_TEMPERATURE_INTERVAL_SEC
+// (the last reading is kept through deep sleep). It sets the ghosting
+// budget, the band of the learned refresh times, and whether the fast
+// waveform may be used: only from EINK_FAST_MIN_CELSIUS to
+// EINK_FAST_MAX_CELSIUS. The reply is read back on MOSI (3-wire SPI)
+static constexpr bool EINK_TEMPERATURE_ENABLED = true;
+static constexpr uint32_t EINK_TEMPERATURE_INTERVAL_SEC = 900;
+static constexpr int8_t EINK_FAST_MIN_CELSIUS = 10;
+static constexpr int8_t EINK_FAST_MAX_CELSIUS = 40;
+
+// SPI clocks of the FeatherWing's panel (Panel::Profile): commands and the
+// init sequence at a conservative rate, plane data, most of an upload's
+// bytes, at a faster one (Adafruit_EPD::setSPIClocks())
+static constexpr uint32_t EINK_SPI_COMMAND_HZ = 4000000;
+static constexpr uint32_t EINK_SPI_DATA_HZ = 16000000;
+
+// Drive the panel through ESP-IDF's esp_lcd SPI panel IO (queued DMA
+// commands and plane data, CS and DC in the driver) instead of
+// Adafruit_SPIDevice (Adafruit_EPD::usePanelIO()). The IO has one clock:
+// everything then runs at EINK_SPI_DATA_HZ.
+static constexpr bool EINK_PANEL_IO_ENABLED = false;
+
 // SPI bus pins for E-ink display
 static constexpr gpio_num_t SPI_SCK_PIN  = GPIO_NUM_18;  // SPI Clock pin
 static constexpr gpio_num_t SPI_MOSI_PIN = GPIO_NUM_23;  // SPI MOSI (Master Out Slave In)
@@ -43,18 +79,127 @@ static constexpr gpio_num_t SPI_MISO_PIN = GPIO_NUM_19;  // SPI MISO (Master In
 static constexpr uint16_t DISPLAY_WIDTH = 128;   // Portrait width
 static constexpr uint16_t DISPLAY_HEIGHT = 296;  // Portrait height
 
+// Panel as the driver sees it; decoders are specialized for this layout
+static constexpr int16_t DISPLAY_NATIVE_WIDTH = 296;
+static constexpr int16_t DISPLAY_NATIVE_HEIGHT = 128;
+static constexpr uint8_t DISPLAY_ROTATION = 1;  // setRotation(): portrait
+
+// Panel ID packed .epd frames carry (tools/epd_convert.py --panel); frames
+// for another panel are refused. 1: 2.9" IL0373 tricolor ThinkInk,
+// 2: 2.9" IL0373 4-gray ThinkInk (T5). This is the panel driven unless the
+// console's "panel" command stored another profile (Panel::active()) in
+// NVS namespace DISPLAY_NVS_NAMESPACE
+static constexpr uint8_t DISPLAY_PANEL_ID = 1;
+static constexpr const char* DISPLAY_NVS_NAMESPACE = "display";
+
+// Partial and fast refreshes leave ghosts. After DISPLAY_GHOST_MAX_REFRESHES
+// of them in a row, or once they have covered DISPLAY_GHOST_MAX_AREA_PERCENT
+// of the screen between them (a fast slide counts 100), the next slide gets
+// a full tricolor refresh even mid-navigation
+static constexpr uint8_t DISPLAY_GHOST_MAX_REFRESHES = 8;
+static constexpr uint16_t DISPLAY_GHOST_MAX_AREA_PERCENT = 800;
+
+// Draw the panel's status text from the fonts pre-rasterized into flash
+// (font_atlas.cpp, tools/epd_font_atlas.py): no rasterizing and no glyph
+// cache RAM for the classic font at the sizes generated
+static constexpr bool FONT_ATLAS_ENABLED = true;
+
+// ------------- STATUS OLED CONFIG -------------
+
+// 1.3" SH1106 OLED (128x64, I2C) for the boot steps, errors, AUTO/MANUAL
+// and index/total (StatusDisplay). With it the e-ink panel refreshes only
+// for slides: no status screens and no mode overlay, each of which is a
+// full tricolor refresh. If no OLED answers at OLED_I2C_ADDRESS, status
+// goes to the e-ink panel as without one.
+static constexpr bool STATUS_OLED_ENABLED = false;
+static constexpr gpio_num_t OLED_SDA_PIN = GPIO_NUM_21;
+static constexpr gpio_num_t OLED_SCL_PIN = GPIO_NUM_17;
+static constexpr int OLED_RESET_PIN = -1;  // -1: no reset line
+static constexpr uint8_t OLED_I2C_ADDRESS = 0x3C;
+static constexpr uint32_t OLED_I2C_FREQ_HZ = 400000;  // Until negotiated
+// I2C clocks tried after init, fastest first: fast-mode plus, then fast
+// mode. Many SH1106 modules ack at 1 MHz; those that don't stay at 400 kHz.
+// At 1 MHz a status update (a few page spans) takes well under 1 ms
+static constexpr uint32_t OLED_I2C_FREQ_STEPS_HZ[] = { 1000000, 400000 };
+static constexpr size_t NUM_OLED_I2C_FREQ_STEPS =
+    sizeof(OLED_I2C_FREQ_STEPS_HZ) / sizeof(OLED_I2C_FREQ_STEPS_HZ[0]);
+// Queue OLED uploads on the I2C worker task, so status updates overlap SD
+// reads and e-ink uploads instead of blocking the slideshow task
+static constexpr bool OLED_ASYNC_UPDATES = true;
+
 // ------------- SD CARD CONFIG -------------
 
 // SD card SPI pins (can share SPI bus with display, but needs separate CS)
 static constexpr gpio_num_t SD_CS_PIN = GPIO_NUM_5;   // SD card chip select
 // SD card uses same SPI bus (SCK, MOSI, MISO) as e-ink display
 
+// SDSPI clocks tried at mount, fastest first. Each step must mount and read
+// the first SD_VERIFY_SECTORS sectors back twice without a CRC error or
+// mismatch; otherwise the next one is tried. The clock that worked is kept
+// in NVS (namespace SD_NVS_NAMESPACE) together with the card's serial
+// number, and later boots with the same card start there.
+static constexpr int SD_SPI_FREQ_STEPS_KHZ[] = { 40000, 26000, 20000, 10000 };
+static constexpr size_t NUM_SD_SPI_FREQ_STEPS =
+    sizeof(SD_SPI_FREQ_STEPS_KHZ) / sizeof(SD_SPI_FREQ_STEPS_KHZ[0]);
+static constexpr size_t SD_VERIFY_SECTORS = 8;
+static constexpr const char* SD_NVS_NAMESPACE = "sdcard";
+
+// Load switch on the card's supply, GPIO_NUM_NC for none. SDCard::init()
+// switches it on and waits SD_POWER_UP_MS for the supply to settle;
+// deinit() switches it off. The enable line needs a pull to the off level,
+// so the card also stays off through reset and deep sleep.
+static constexpr gpio_num_t SD_POWER_PIN = GPIO_NUM_NC;
+static constexpr int SD_POWER_ON_LEVEL = 1;
+static constexpr uint32_t SD_POWER_UP_MS = 10;
+
+// SD hot-plug: while idle, the slideshow checks the card every
+// SD_HOTPLUG_POLL_SEC. With a card-detect switch on SD_DETECT_PIN (reading
+// SD_DETECT_INSERTED_LEVEL with a card in) that is a GPIO read; without
+// one, a mounted card is sent a status command and a missing one is
+// mounted again. A removed card is unmounted and the last slide stays up;
+// a new card is mounted and listed on a task of its own while slides go
+// on, so cards can be swapped without a reboot. A failed mount or an empty
+// card at boot then waits for a card instead of restarting.
+static constexpr bool SD_HOTPLUG_ENABLED = true;
+static constexpr uint32_t SD_HOTPLUG_POLL_SEC = 3;
+static constexpr gpio_num_t SD_DETECT_PIN = GPIO_NUM_NC;
+static constexpr int SD_DETECT_INSERTED_LEVEL = 0;  // Switch to ground, pulled up
+
+// Mount through the SDMMC peripheral instead of SDSPI. Only for targets with
+// an SDMMC host (ESP32, ESP32-S3; not the ESP32-C6): the card then has its own
+// pins, so image reads no longer share SPI2_HOST with display traffic.
+static constexpr bool SD_USE_SDMMC = false;
+static constexpr uint8_t SD_SDMMC_BUS_WIDTH = 4;                 // 1 or 4 data lines
+static constexpr int SD_SDMMC_FREQ_KHZ = 40000;  // SDMMC_FREQ_HIGHSPEED
+// SDMMC pins on targets with a GPIO matrix (ESP32-S3); the ESP32 uses its
+// fixed slot 1 pins (CLK 14, CMD 15, D0 2, D1 4, D2 12, D3 13)
+static constexpr int SD_SDMMC_CLK_PIN = 36;
+static constexpr int SD_SDMMC_CMD_PIN = 35;
+static constexpr int SD_SDMMC_D0_PIN  = 37;
+static constexpr int SD_SDMMC_D1_PIN  = 38;
+static constexpr int SD_SDMMC_D2_PIN  = 33;
+static constexpr int SD_SDMMC_D3_PIN  = 34;
+
 // SD card mount point
 static constexpr const char* SD_MOUNT_POINT = "/sdcard";
 
+// FAT cluster size used if the card is formatted by the firmware
+static constexpr size_t SD_ALLOCATION_UNIT_SIZE = 16 * 1024;
+
+// stdio buffer for files opened with SDCard::openFile(). One cluster, so a
+// refill is a single multi-sector transfer instead of one per 128 bytes.
+// Falls back to the default buffer when the heap is short.
+static constexpr size_t SD_READ_BUFFER_SIZE = SD_ALLOCATION_UNIT_SIZE;
+
 // Image directory on SD card
 static constexpr const char* IMAGE_DIRECTORY = "/sdcard/images";
 
+// Converted-frame cache: decoded images are stored here as packed .epd frames
+// so later visits skip decoding and scaling. The name must be 8.3 because
+// FATFS long file names are disabled (CONFIG_FATFS_LFN_NONE).
+static constexpr bool IMAGE_CACHE_ENABLED = true;
+static constexpr const char* IMAGE_CACHE_DIRECTORY = "/sdcard/EPDCACHE";
+
 // ------------- BUTTON CONFIG -------------
 
 // Button GPIOs (must be RTC-capable if you want them as deep sleep wake sources)
@@ -65,18 +210,675 @@ static constexpr gpio_num_t BTN_DOWN_GPIO   = GPIO_NUM_11;  // Next image
 // Button debounce time
 static constexpr uint32_t BUTTON_DEBOUNCE_MS = 50;
 
+// Hold time before LONG_PRESS, then the interval between REPEAT events
+static constexpr uint32_t BUTTON_LONG_PRESS_MS = 800;
+static constexpr uint32_t BUTTON_REPEAT_MS = 250;
+
+// Deep sleep button wake through the LP core (needs CONFIG_ULP_COPROC_ENABLED
+// with the LP core type). With EXT1 every bounce or brushed button boots the
+// main core; instead the LP core samples the buttons every
+// LP_BUTTONS_POLL_MS, debounces them with BUTTON_DEBOUNCE_MS and wakes the
+// main core only for a press or a BUTTON_LONG_PRESS_MS hold, which the
+// resumed show acts on before its first slide. The button GPIOs must be LP
+// IOs (GPIO0-7 on the C6); otherwise EXT1 is used
+static constexpr bool LP_BUTTONS_ENABLED = false;
+static constexpr uint32_t LP_BUTTONS_POLL_MS = 10;
+
 // ------------- SLIDESHOW SETTINGS -------------
 
-// Auto-advance delay (seconds)
+// Auto-advance delay (seconds); schedule periods set their own (SCHEDULE_ENABLED)
 static constexpr uint32_t AUTO_ADVANCE_DELAY_SEC = 10;
 
+// In auto-advance mode, deep-sleep between slides: once a slide has been
+// refreshed the panel is powered down (e-ink keeps the image) and the chip
+// sleeps with a timer wake at the next slide. Buttons still wake it, and
+// the show resumes from RTC memory without the boot screens.
+static constexpr bool AUTO_ADVANCE_DEEP_SLEEP = false;
+
+// Quick UP/DOWN presses (within FAST_NAVIGATION_WINDOW_MS of the previous
+// one, or while a refresh is still running) use the panel's fast black/white
+// waveform: about a second per slide, but red shows as black and some
+// ghosting is left. After FAST_NAVIGATION_SETTLE_MS without navigation the
+// slide gets one normal tricolor refresh, which also clears the ghosts (as
+// does any slide once the DISPLAY_GHOST_* budget is spent).
+static constexpr bool FAST_NAVIGATION_ENABLED = true;
+static constexpr uint32_t FAST_NAVIGATION_WINDOW_MS = 3000;
+static constexpr uint32_t FAST_NAVIGATION_SETTLE_MS = 2000;
+
+// Fast frames after the first one are differential: the frame on the glass
+// is uploaded as the controller's OLD frame, so the fast waveform drives
+// only the pixels that change and text-heavy slides update without the
+// whole-screen flash (Adafruit_IL0373::setDifferentialUpdates()). Costs a
+// second 4.6 KB ink plane
+static constexpr bool FAST_DIFFERENTIAL_UPDATES = true;
+
+// Progressive slides: a JPEG that has to be decoded (not in the frame
+// cache) first goes up as a preview, decoded at 1/8 and refreshed with the
+// fast mono waveform, and the full tricolor frame follows once decoded
+// (ImageLoader::loadPreview()). Something is on the glass within a second
+// or two instead of after the whole decode and refresh; it pays on large
+// panels and big JPEGs. Panels with a fast waveform only, and only while
+// the ghosting budget allows a fast refresh
+static constexpr bool PROGRESSIVE_DISPLAY_ENABLED = false;
+
+// Holding UP/DOWN past BUTTON_LONG_PRESS_MS scrolls without decoding: each
+// repeat moves a target whose index goes to the status OLED, or into a
+// strip refreshed as a partial window on the panel. Only the target is
+// decoded, and fully refreshed, on release. After
+// FAST_SCROLL_ACCELERATE_AFTER steps each repeat moves FAST_SCROLL_STRIDE slides
+static constexpr bool FAST_SCROLL_ENABLED = true;
+static constexpr uint32_t FAST_SCROLL_ACCELERATE_AFTER = 8;
+static constexpr uint32_t FAST_SCROLL_STRIDE = 10;
+
+// Play slides in a shuffled order (keyed permutation, see shuffle.hpp)
+// from power-on; the console's "shuffle" command switches it at run time
+static constexpr bool SHUFFLE_ENABLED = false;
+
+// Favorites and named playlists (Playlists), one bit per image in NVS
+// namespace PLAYLIST_NVS_NAMESPACE. A long SELECT press adds the slide to
+// the favorites or takes it out; the console's "play fav" then plays only
+// those, "playlist" edits other lists
+static constexpr const char* PLAYLIST_NVS_NAMESPACE = "playlists";
+
+// Contact sheet: the console's "grid" command, or SELECT while a held
+// UP/DOWN scrolls, tiles the pack's thumbnails (tools/epd_pack.py
+// --thumbnail) in one refresh. UP/DOWN then move the selection by partial
+// refresh, holding them turns pages and SELECT shows the selected slide
+static constexpr bool GRID_VIEW_ENABLED = true;
+static constexpr int16_t GRID_TILE_MARGIN = 4;  // Pixels around each thumbnail
+
 // Inactivity timeout before deep sleep (seconds)
 static constexpr uint32_t INACTIVITY_TIMEOUT_SEC = 300;  // 5 minutes
 
-// Maximum number of images to cache in memory
-static constexpr size_t MAX_IMAGE_FILES = 100;
+// Let the chip light-sleep whenever every task is blocked (needs
+// CONFIG_PM_ENABLE and CONFIG_FREERTOS_USE_TICKLESS_IDLE). Buttons then use
+// level interrupts, which double as light-sleep GPIO wakeup sources. The
+// clock then idles at XTAL and only runs at full speed while a slide is
+// decoded or uploaded (CpuBoost).
+static constexpr bool LIGHT_SLEEP_ENABLED = true;
+
+// Free the SPI bus through each dwell: once the refresh is over and the
+// task would wait at least SPI_IDLE_RELEASE_MIN_MS, the panel and the card
+// (still mounted, in standby) are taken off the bus and the bus is freed,
+// which gates its clock and DMA channel. The first SD access or panel
+// command afterwards, from any task, brings both back in well under a
+// millisecond. Shorter waits keep the bus
+static constexpr bool SPI_IDLE_RELEASE_ENABLED = false;
+static constexpr uint32_t SPI_IDLE_RELEASE_MIN_MS = 1000;
+
+// Staged next slide: once a slide's refresh is over and the next one is
+// prefetched, its planes are sent to the panel controller's RAM during the
+// dwell. Advancing to it (auto-advance or DOWN) is then just the refresh,
+// with no upload. Panels whose controller keeps its RAM while powered off
+// only (IL0373); elsewhere nothing is staged
+static constexpr bool STAGED_FRAME_ENABLED = true;
+
+// Resize filter: 0 = nearest neighbour, 1 = area average when shrinking
+static constexpr uint8_t IMAGE_SCALE_MODE = 1;
+
+// Dithering for RGB / grayscale images:
+// 0 = none (hard threshold), 1 = Floyd-Steinberg, 2 = Atkinson, 3 = Bayer 4x4,
+// 4 = blue noise (stateless like Bayer, position-keyed, near Floyd-Steinberg's look)
+static constexpr uint8_t IMAGE_DITHER_MODE = 1;
+
+// Tone curve for images without their own (ImageLoader::Tone): gamma x100
+// (100 = linear, higher lifts the midtones, which e-ink prints dark),
+// contrast in percent (-100..100) and brightness in levels (-128..127).
+// Baked into the palette and color tables once per image, not per pixel
+static constexpr uint16_t IMAGE_TONE_GAMMA = 100;
+static constexpr int8_t IMAGE_TONE_CONTRAST = 0;
+static constexpr int8_t IMAGE_TONE_BRIGHTNESS = 0;
+
+// Per-image settings file next to each image, same name with this
+// extension ("gamma=180" lines, see IMAGE_FORMAT.md); "" skips the lookup
+static constexpr const char* IMAGE_SIDECAR_EXTENSION = ".txt";
+
+// Captions (Captions): "caption=" lines of an image's sidecar, drawn
+// centered in a white band along the bottom of its slide in the classic font
+// at CAPTION_TEXT_SIZE (a font atlas size, so it is blitted). They are read
+// and wrapped once when the image list changes, up to CAPTION_MAX_LINES
+// lines and CAPTION_BUDGET_BYTES for all of them, and kept in
+// IMAGE_CACHE_DIRECTORY/CAPTIONS_FILE; showing a slide only looks its
+// caption up. Building opens every image's sidecar once
+static constexpr bool CAPTIONS_ENABLED = false;
+static constexpr const char* CAPTIONS_FILE = "CAPTIONS.BIN";
+static constexpr uint8_t CAPTION_TEXT_SIZE = 1;
+static constexpr size_t CAPTION_MAX_LINES = 3;
+static constexpr size_t CAPTION_MAX_CHARS = 160;  // Per caption, at most 255
+static constexpr int16_t CAPTION_MARGIN = 3;
+static constexpr size_t CAPTION_BUDGET_BYTES = 16384;
+
+// Collages: a text file with this extension among the images lists up to
+// COLLAGE_MAX_TILES images (and optionally "grid=2x2") to show together,
+// each fitted into its tile, COLLAGE_MARGIN pixels apart (Collage). They
+// are decoded tile by tile into one framebuffer and refreshed once
+static constexpr const char* COLLAGE_EXTENSION = ".col";
+static constexpr size_t COLLAGE_MAX_TILES = 4;
+static constexpr int16_t COLLAGE_MARGIN = 4;
+
+// Animations (Animation): a file next to an image, same name with this
+// extension (tools/epd_anim.py), loops small rectangles over its slide as
+// window refreshes, at most one per ANIMATION_MIN_FRAME_MS. The ghosting
+// budget turns a step into a full refresh when spent, and one is also made
+// every ANIMATION_FULL_REFRESH_SEC (0 = budget only). Files up to
+// ANIMATION_MAX_BYTES are read into RAM once per slide
+static constexpr bool ANIMATION_ENABLED = false;
+static constexpr const char* ANIMATION_EXTENSION = ".ani";
+static constexpr uint32_t ANIMATION_MIN_FRAME_MS = 1000;
+static constexpr uint32_t ANIMATION_FULL_REFRESH_SEC = 600;
+static constexpr size_t ANIMATION_MAX_BYTES = 16384;
+
+// Dashboard widgets (Widgets): "widget=" lines in an image's sidecar put a
+// clock, the date, the battery voltage, the panel temperature, the slide
+// number or a number set from the console ("widget <slot> <number>") on
+// the slide, at most WIDGET_MAX of them. Only widgets whose text changed
+// are redrawn, as window refreshes. Changed widgets share a window while
+// its box is at most WIDGET_MERGE_SLACK_PERCENT larger than the widgets in
+// it. Readings are checked every WIDGET_POLL_SEC; the clock each minute
+static constexpr bool WIDGETS_ENABLED = false;
+static constexpr size_t WIDGET_MAX = 8;
+static constexpr size_t WIDGET_VALUE_SLOTS = 4;
+static constexpr uint32_t WIDGET_POLL_SEC = 60;
+static constexpr uint32_t WIDGET_MERGE_SLACK_PERCENT = 100;
+
+// Boot status ("Initializing...", "Scanning images...") is only drawn if the
+// first image hasn't started uploading this long after the display is up.
+// Each status screen is a full refresh (~13 s on the tricolor panel) that the
+// first image then waits for, so a fast boot shows the image first.
+static constexpr uint32_t BOOT_STATUS_DELAY_MS = 3000;
+
+// Stack of the boot task that mounts the SD card and builds the image list
+// while the slideshow task brings up the display
+static constexpr uint32_t BOOT_SD_TASK_STACK = 6144;
+
+// Decode the next/previous slide into spare framebuffer planes while the
+// current one is on screen (costs 2 x 2 planes of RAM, ~19 KB on the 2.9")
+static constexpr bool PREFETCH_ENABLED = true;
+
+// Prefetch planner (PrefetchPlan): after PREFETCH_STREAK steps the same way
+// (auto-advance counts as forward) only that way is decoded ahead, up to
+// PREFETCH_MAX_DEPTH slides when slides are flipped faster than one loads.
+// Slides past the two prefetch slots are kept in the SlideCache, so the
+// depth is also bounded by SLIDE_CACHE_BUDGET.
+static constexpr uint32_t PREFETCH_STREAK = 3;
+static constexpr uint32_t PREFETCH_MAX_DEPTH = 4;
+
+// Keep recently decoded slides in RAM (SlideCache, least recently used
+// evicted first), so flipping back to one skips the SD card and the decoder.
+// Planes are kept RLE-encoded: a slide costs up to both planes, ~9.5 KB on
+// the 2.9", and mostly white tricolor slides a fifth to a tenth of that; at
+// most 64 slides. Allocated as one block at boot and compacted in place;
+// smaller than one uncompressed slide disables the cache.
+static constexpr size_t SLIDE_CACHE_BUDGET = 40 * 1024;
+
+// Background conversion (CacheWarm): slides from the image directory not
+// yet in the converted-frame cache are decoded into it one at a time while
+// the slideshow task is idle, so the first lap through new content loads
+// cached frames. Runs once prefetching is done, on external power
+// (Battery::externalPower()) or with at least CACHE_WARM_MIN_IDLE_SEC left
+// before the next slide or sleep; any input stops a conversion within a
+// row. Costs two planes of RAM while a walk is under way. At most
+// CACHE_WARM_CHECKS_PER_STEP slides are looked up per step.
+static constexpr bool CACHE_WARM_ENABLED = true;
+static constexpr uint32_t CACHE_WARM_MIN_IDLE_SEC = 20;
+static constexpr size_t CACHE_WARM_CHECKS_PER_STEP = 16;
+
+// Put the display's frame planes and the prefetch planes in PSRAM (modules
+// with CONFIG_SPIRAM, e.g. ESP32-S3), keeping internal RAM for DMA and the
+// decoders; uploads are staged through a 512-byte internal chunk. Falls
+// back to internal RAM when there is no PSRAM.
+static constexpr bool FRAMEBUFFER_IN_PSRAM = false;
+
+// When the display has no frame planes (the panel's frame didn't fit in
+// RAM, e.g. a 7.5" 800x480 tricolor beside Wi-Fi), decoded images are drawn
+// in bands of this many bytes per plane and streamed to the controller band
+// by band. Each band of each plane decodes the image again, so larger bands
+// are faster; .epd frames are streamed without it.
+static constexpr size_t BANDED_RENDER_BYTES = 8 * 1024;
+
+// Per-slide arena (SlideArena), allocated once at boot, for the decoders'
+// scratch memory and the image file's stdio buffer; it is rewound after
+// each slide instead of freeing to the heap. PNG needs the most: ~67 KB
+// (16 KB file buffer, 32 KB inflate window, inflate state, scaler) plus
+// its row buffers, and the read-ahead chunks (READ_AHEAD_CHUNKS). Whatever
+// doesn't fit comes from the heap as before.
+static constexpr size_t SLIDE_ARENA_SIZE = 96 * 1024;
+
+// Internal heap the slideshow's own buffers and task stacks may take, checked
+// at compile time (RamBudget, ram_budget.hpp) for the panel's geometry and
+// the defaults in this file: frame, prefetch and cache-warm planes, slide
+// cache, slide arena, task stacks and the enabled features' buffers. A frame
+// that doesn't fit beside the rest is modelled banded (BANDED_RENDER_BYTES)
+// without prefetch, as the slideshow falls back at runtime; a build where
+// even that is over fails to compile, and the model is logged at boot.
+// RAM_BUDGET_RADIO_BYTES comes off the budget while a Wi-Fi or BLE feature
+// is on. Leaves room for ESP-IDF itself on an ESP32 or ESP32-S3
+static constexpr size_t RAM_BUDGET_BYTES = 288 * 1024;
+static constexpr size_t RAM_BUDGET_RADIO_BYTES = 64 * 1024;
+
+// Slides whose stage timings (open, read, decode, upload, refresh, ...) are
+// kept for Slideshow::getStats(); each one is also logged once its refresh ends
+static constexpr size_t SLIDE_STATS_HISTORY = 16;
+
+// Memory alarms, checked as each slide's record closes: a warning is logged
+// (and counted in Slideshow::getStats()) when the largest free heap block is
+// under HEAP_MIN_LARGEST_BLOCK bytes or under HEAP_FRAGMENTATION_ALARM_PERCENT
+// of the free heap, or when less than STACK_FREE_ALARM_BYTES of the
+// slideshow task's stack has never been used
+static constexpr uint32_t HEAP_MIN_LARGEST_BLOCK = 16 * 1024;
+static constexpr uint32_t HEAP_FRAGMENTATION_ALARM_PERCENT = 25;
+static constexpr uint32_t STACK_FREE_ALARM_BYTES = 1024;
+
+// Binary performance log on the card (PerfLog, decoded by
+// tools/perf_log.py): a 64-byte entry per slide (stage times, SPI traffic,
+// memory lows), per power window (charge) and per failed image, appended to
+// IMAGE_CACHE_DIRECTORY/PERF_LOG_FILE one batch at a time. A batch is a
+// cluster, or PERF_LOG_BATCH_MAX_BYTES if clusters are larger, and is only
+// written while a panel refresh keeps the display off the bus. Past
+// PERF_LOG_MAX_BYTES the file becomes PERF_LOG_OLD_FILE and a new one is
+// started. Up to PERF_LOG_RTC_ENTRIES unwritten entries are kept through
+// deep sleep; more are written out, padded to a batch, before sleeping.
+static constexpr bool PERF_LOG_ENABLED = true;
+static constexpr const char* PERF_LOG_FILE = "PERF.LOG";
+static constexpr const char* PERF_LOG_OLD_FILE = "PERF.OLD";
+static constexpr size_t PERF_LOG_BATCH_MAX_BYTES = 4096;
+static constexpr uint32_t PERF_LOG_MAX_BYTES = 4 * 1024 * 1024;
+static constexpr size_t PERF_LOG_RTC_ENTRIES = 16;
+
+// Keep the sorted image list in IMAGE_CACHE_DIRECTORY/IMAGE_INDEX_FILE and
+// reuse it at boot until the mtime of one of the image directories changes
+static constexpr bool IMAGE_INDEX_ENABLED = true;
+static constexpr const char* IMAGE_INDEX_FILE = "IMAGES.IDX";
+
+// Album folders: subdirectories of IMAGE_DIRECTORY are scanned down to
+// this depth (0 = top level only), at most IMAGE_SCAN_MAX_DIRECTORIES in
+// all. The index records each directory's mtime, so a changed one is read
+// again on its own and the rest come from the index.
+static constexpr size_t IMAGE_SCAN_MAX_DEPTH = 3;
+static constexpr size_t IMAGE_SCAN_MAX_DIRECTORIES = 256;
+
+// Read each image's header while building the list (ImageLoader::probe) and
+// leave out files that can't be shown, instead of finding out per visit.
+// The result is kept in the index, so this costs one open per image only
+// when the directory changes.
+static constexpr bool IMAGE_SCAN_PROBE = true;
+
+// Images that fail to load are marked in IMAGE_CACHE_DIRECTORY/
+// BAD_IMAGES_FILE and passed over until the image list changes. One show
+// attempt gives up after MAX_IMAGE_SKIPS failures in a row rather than
+// trying the whole list.
+static constexpr const char* BAD_IMAGES_FILE = "BADIMG.BIN";
+static constexpr size_t MAX_IMAGE_SKIPS = 8;
+
+// Maximum number of images in the list (about 29 bytes of RAM each for
+// 8.3 names)
+static constexpr size_t MAX_IMAGE_FILES = 4096;
+
+// Browse the image directory in place (SDCard::ImageCursor: directory order,
+// ~40 bytes per 64 images) instead of holding a sorted list. Directories
+// with more than MAX_IMAGE_FILES images fall back to this automatically.
+static constexpr bool LAZY_IMAGE_LIST = false;
+
+// Show the slides of this image pack (tools/epd_pack.py) instead of the
+// image directory when the file exists: all frames live in one file with an
+// offset table, so each slide is one seek on a handle that stays open.
+static constexpr bool IMAGE_PACK_ENABLED = true;
+static constexpr const char* IMAGE_PACK_FILE = "/sdcard/SLIDES.PAK";
+
+// Read the frames of a pack stored in one run of clusters straight from the
+// card's sectors (sdmmc_read_sectors) instead of through VFS, FatFs and
+// stdio: whole sectors land in the planes by DMA, with no FAT chain walk or
+// stdio copy. Reads too small or unaligned for that (headers, encoded
+// planes) go through a DMA window of IMAGE_PACK_DIRECT_WINDOW bytes. Packs
+// the firmware writes are allocated in one run; a fragmented pack (copied
+// onto a full card, or appended to) is read through the file as before.
+static constexpr bool IMAGE_PACK_DIRECT_READS = true;
+static constexpr size_t IMAGE_PACK_DIRECT_WINDOW = 4096;
+
+// Show the slides of a pack kept in this flash data partition (FlashPack,
+// partitions.csv) before anything on the card: frames are read in place
+// through the flash cache, so the first slide waits for no SD mount and no
+// file system. When the card has IMAGE_PACK_FILE and its table differs, it
+// is mirrored into the partition, rewriting only the flash sectors that
+// changed; without a card the partition's slides are shown as they are.
+// The size and mtime of the pack last mirrored are kept in NVS (namespace
+// FLASH_PACK_NVS_NAMESPACE), so an unchanged card costs a stat, not a read.
+static constexpr bool FLASH_PACK_ENABLED = true;
+static constexpr const char* FLASH_PACK_PARTITION = "slides";
+static constexpr const char* FLASH_PACK_NVS_NAMESPACE = "flashpack";
+
+// Once the flash pack is current, unmount the card (and switch it off with
+// SD_POWER_PIN) until a sync or SD benchmark needs it. A wake from deep
+// sleep then never touches the card: it is checked for a new pack at
+// power-on and reset only.
+static constexpr bool FLASH_PACK_RELEASE_SD = true;
 
 // Supported image file extensions
-static constexpr const char* IMAGE_EXTENSIONS[] = { ".bmp", ".BMP" };
+static constexpr const char* IMAGE_EXTENSIONS[] = {
+    ".bmp", ".BMP", ".epd", ".EPD", ".jpg", ".JPG", ".jpeg", ".JPEG", ".png", ".PNG",
+    ".qoi", ".QOI", ".col", ".COL"
+};
 static constexpr size_t NUM_IMAGE_EXTENSIONS = sizeof(IMAGE_EXTENSIONS) / sizeof(IMAGE_EXTENSIONS[0]);
 
+
+// ------------- POWER ACCOUNTING CONFIG -------------
+
+// Board current per power state in microamps, for PowerStats' charge
+// estimate per slide. The idle baseline is always drawn; each load adds its
+// current while it is on. Defaults are typical figures for an ESP32 Feather
+// with the 2.9" tricolor FeatherWing; measure your board and replace them.
+static constexpr uint32_t POWER_IDLE_UA = LIGHT_SLEEP_ENABLED ? 1500 : 25000;
+static constexpr uint32_t POWER_CPU_UA = 30000;       // Slideshow task running
+static constexpr uint32_t POWER_SPI_UA = 5000;        // SPI transfers
+static constexpr uint32_t POWER_SD_UA = 1000;         // SD card mounted, idle
+static constexpr uint32_t POWER_PANEL_UA = 1500;      // Panel charge pumps on
+static constexpr uint32_t POWER_REFRESH_UA = 8000;    // Panel refresh, on top of PANEL
+static constexpr uint32_t POWER_RADIO_UA = 100000;    // Wi-Fi on (WIFI_SYNC_ENABLED)
+static constexpr uint32_t POWER_DEEP_SLEEP_UA = 100;  // Whole board in deep sleep
+
+// Power state changes kept for PowerStats::timeline()
+static constexpr size_t POWER_TIMELINE_LENGTH = 64;
+
+// ------------- BATTERY CONFIG -------------
+
+// Battery voltage on an ADC pin through a divider (Battery), read before
+// each auto-advanced slide and at boot. Below BATTERY_LOW_MV the show saves
+// charge: the dwell is multiplied by BATTERY_LOW_DWELL_FACTOR, auto-advanced
+// slides use the fast mono waveform where the panel has one, and the radio
+// syncs (WifiSync, the schedule's SNTP) are skipped. Below
+// BATTERY_CRITICAL_MV the dwell is multiplied by BATTERY_CRITICAL_DWELL_FACTOR
+// and neighbours are no longer prefetched. A level is left only
+// BATTERY_HYSTERESIS_MV above its threshold, so a voltage that sags under
+// load doesn't flip the policy back and forth.
+static constexpr bool BATTERY_MONITOR_ENABLED = false;
+static constexpr gpio_num_t BATTERY_ADC_GPIO = GPIO_NUM_0;  // An ADC1 pin
+static constexpr uint32_t BATTERY_DIVIDER_NUM = 2;  // Battery mV = pin mV * NUM / DEN
+static constexpr uint32_t BATTERY_DIVIDER_DEN = 1;
+static constexpr uint32_t BATTERY_LOW_MV = 3600;
+static constexpr uint32_t BATTERY_CRITICAL_MV = 3450;
+static constexpr uint32_t BATTERY_HYSTERESIS_MV = 50;
+static constexpr uint32_t BATTERY_LOW_DWELL_FACTOR = 2;
+static constexpr uint32_t BATTERY_CRITICAL_DWELL_FACTOR = 4;
+
+// External power (USB or a supply), for work worth doing only off the
+// battery: a GPIO that reads high while VBUS is present (through a
+// divider), or without one a battery reading of at least
+// BATTERY_EXTERNAL_MV, which a cell only shows on the charger.
+static constexpr gpio_num_t EXTERNAL_POWER_GPIO = GPIO_NUM_NC;
+static constexpr uint32_t BATTERY_EXTERNAL_MV = 4250;
+
+// ------------- DUAL-CORE PIPELINE CONFIG -------------
+
+// On dual-core chips (not CONFIG_FREERTOS_UNICORE) a slide is rendered by
+// three tasks: a reader pinned to PIPELINE_IO_CORE reads JPEG and PNG files
+// ahead in chunks, the slideshow task pinned to PIPELINE_DECODE_CORE
+// decodes, dithers and packs, and the panel upload (epd_refresh) runs on
+// PIPELINE_IO_CORE again. The SD reads then overlap the decode instead of
+// adding to it. Single-core chips read inline, as before.
+static constexpr bool PIPELINE_ENABLED = true;
+static constexpr int PIPELINE_IO_CORE = 0;
+static constexpr int PIPELINE_DECODE_CORE = 1;
+
+// Priority of the slideshow task, and of the reader task so neither stage
+// starves the other
+static constexpr uint32_t SLIDESHOW_TASK_PRIORITY = 5;
+static constexpr uint32_t SLIDESHOW_TASK_STACK = 8192;
+
+// Read-ahead buffering, from the slide arena: chunks in flight between the
+// reader and the decoder, and the reader task's stack
+static constexpr size_t READ_AHEAD_CHUNK_SIZE = 4096;
+static constexpr size_t READ_AHEAD_CHUNKS = 3;
+static constexpr uint32_t READ_AHEAD_TASK_STACK = 4096;
+
+// Parallel dithering (DitherPool): with the stateless dither modes (Bayer,
+// blue noise), output rows are batched DITHER_BAND_ROWS at a time and
+// dithered as DITHER_BAND_STRIPES stripes, shared between the decoding task
+// and a helper task on PIPELINE_IO_CORE. Error diffusion stays on one core.
+// The band costs DITHER_BAND_ROWS x 4 bytes per output pixel of a row, from
+// the slide arena
+static constexpr bool DITHER_PARALLEL_ENABLED = true;
+static constexpr uint32_t DITHER_BAND_ROWS = 16;
+static constexpr uint32_t DITHER_BAND_STRIPES = 4;
+static constexpr uint32_t DITHER_POOL_TASK_STACK = 3072;
+
+// RenderFlow coroutines (slideshow waits that don't block the task): flows
+// that can be ready at once, which must exceed the flows ever suspended
+// together, and the stack of the task that does their SD reads
+static constexpr size_t RENDER_FLOW_READY_DEPTH = 8;
+static constexpr uint32_t RENDER_FLOW_READ_TASK_STACK = 4096;
+
+// Flow coroutine frames come from a static pool of RENDER_FLOW_FRAME_SLOTS
+// slots (at most 32) of RENDER_FLOW_FRAME_BYTES, so a wait costs no heap
+// allocation; a larger frame, or one past the pool, comes from the heap
+// and is logged once
+static constexpr size_t RENDER_FLOW_FRAME_SLOTS = 8;
+static constexpr size_t RENDER_FLOW_FRAME_BYTES = 512;
+
+// Pipeline timeline (PipelineTrace): every SlideStats stage, each SD read on
+// the reader tasks and each panel power-up, plane write, refresh and
+// power-down, with its task and core, in a ring of the last
+// PIPELINE_TRACE_EVENTS (24 bytes each). The console's "trace" command
+// prints it as Chrome trace-event JSON for chrome://tracing or
+// ui.perfetto.dev; "trace sd" writes it to
+// IMAGE_CACHE_DIRECTORY/PIPELINE_TRACE_FILE instead. With
+// CONFIG_APPTRACE_SV_ENABLE, stages also show up as SystemView markers.
+static constexpr bool PIPELINE_TRACE_ENABLED = false;
+static constexpr size_t PIPELINE_TRACE_EVENTS = 1024;
+static constexpr const char* PIPELINE_TRACE_FILE = "TRACE.JSN";
+
+// Panel SPI recording (SpiRecord): "spirec start" on the console records
+// every transaction of the panel's SPI device (DC level, clock, bytes,
+// times) and every BUSY wait into a SPI_RECORD_BYTES buffer allocated at
+// boot, until "spirec stop" or the buffer is full. "spirec sd" writes it
+// to IMAGE_CACHE_DIRECTORY/SPI_RECORD_FILE for tools/spi_replay.py. A
+// 2.9" tricolor slide takes about 12 KB
+static constexpr bool SPI_RECORD_ENABLED = false;
+static constexpr size_t SPI_RECORD_BYTES = 32768;
+static constexpr const char* SPI_RECORD_FILE = "SPI.REC";
+
+// Tunables: prefetch depth, cache budget, panel SPI clocks, dither mode,
+// ghost policy, dwell and inactivity timeout can be overridden without
+// reflashing, from the console ("tune") or by a Wi-Fi sync's tunables.txt.
+// Overrides are kept in NVS namespace TUNABLES_NVS_NAMESPACE and read at
+// boot; the constants here stay the defaults. The cache budget and SPI
+// clocks can't be set above these
+static constexpr const char* TUNABLES_NVS_NAMESPACE = "tunables";
+static constexpr uint32_t TUNABLE_CACHE_BUDGET_MAX = 512 * 1024;
+static constexpr uint32_t TUNABLE_SPI_MAX_HZ = 40000000;
+
+// ------------- WI-FI CONFIG -------------
+
+// Network for the Wi-Fi features below (WifiRadio). The radio is on only
+// while one of them holds it.
+static constexpr const char* WIFI_SSID = "";
+static constexpr const char* WIFI_PASSWORD = "";
+static constexpr uint32_t WIFI_CONNECT_TIMEOUT_MS = 15000;
+
+// Update the image pack over Wi-Fi (WifiSync). WIFI_SYNC_BASE_URL serves
+// manifest.txt and the frames it lists as <hash>.epd (tools/epd_manifest.py
+// writes both); frames whose content hash the pack already has are kept,
+// only new ones are downloaded, straight into IMAGE_PACK_FILE. The radio is
+// on only for the sync, between slides once the panel is idle, at most
+// every WIFI_SYNC_INTERVAL_SEC (the console "sync" command forces one).
+static constexpr bool WIFI_SYNC_ENABLED = false;
+static constexpr const char* WIFI_SYNC_BASE_URL = "http://192.168.1.2:8000";  // http or https
+static constexpr uint32_t WIFI_SYNC_INTERVAL_SEC = 6 * 3600;
+static constexpr uint32_t WIFI_SYNC_HTTP_TIMEOUT_MS = 10000;
+
+// Download and copy buffer, from the slide arena
+static constexpr size_t WIFI_SYNC_CHUNK_SIZE = 4096;
+
+// Content hash of every pack frame, so the next sync can tell what it has
+// without reading the frames; a pack rebuilt when too much of it is stale
+// is written to WIFI_SYNC_TEMP_FILE first
+static constexpr const char* WIFI_SYNC_INDEX_FILE = "/sdcard/SLIDES.IDX";
+static constexpr const char* WIFI_SYNC_TEMP_FILE = "/sdcard/SLIDES.TMP";
+
+// Tunables a sync also fetches from WIFI_SYNC_BASE_URL, "key value" lines
+// stored for the next boot (see tunables.hpp for "arm" sections); nullptr
+// to never fetch them
+static constexpr const char* WIFI_SYNC_TUNABLES_FILE = "tunables.txt";
+
+// Show .epd frames POSTed to http://<device>:FRAME_PUSH_PORT/frame
+// (FramePush), e.g. a dashboard rendered by a server with
+// tools/epd_convert.py. The planes go from the socket straight into the
+// framebuffer, or to the controller in small pieces on a display
+// without one; nothing touches the SD card. The radio then stays
+// on and the slideshow never deep-sleeps between slides; a pushed frame
+// counts as activity for INACTIVITY_TIMEOUT_SEC. Set AUTO_ADVANCE_DELAY_SEC
+// long enough that slides don't replace pushed frames.
+static constexpr bool FRAME_PUSH_ENABLED = false;
+static constexpr uint16_t FRAME_PUSH_PORT = 80;
+
+// Fleet telemetry (Telemetry): stage times of every slide, time to the
+// first image per boot, refreshes per waveform and charge per slide, added
+// up as histograms in RTC memory, then published as one MQTT message to
+// TELEMETRY_MQTT_TOPIC (%s: the Wi-Fi MAC) while the radio is on for a
+// WifiSync, and cleared once the broker has it. Nothing is sent between
+// syncs. Every TELEMETRY_NVS_SAVE_SLIDES slides they are also saved to NVS
+// on the way into deep sleep, so a power loss costs at most that many.
+static constexpr bool TELEMETRY_ENABLED = false;
+static constexpr const char* TELEMETRY_MQTT_URI = "mqtt://192.168.1.2:1883";  // mqtt or mqtts
+static constexpr const char* TELEMETRY_MQTT_TOPIC = "epd/%s/telemetry";
+static constexpr uint32_t TELEMETRY_MQTT_TIMEOUT_MS = 10000;
+static constexpr size_t TELEMETRY_MESSAGE_SIZE = 3072;
+static constexpr const char* TELEMETRY_NVS_NAMESPACE = "telemetry";
+static constexpr uint32_t TELEMETRY_NVS_SAVE_SLIDES = 50;
+
+// ------------- BLE UPLOAD CONFIG -------------
+
+// Replace the image pack over a BLE L2CAP channel on BLE_UPLOAD_PSM
+// (BleUpload; stream format in ble_upload.hpp), from a phone without Wi-Fi.
+// Needs NimBLE with L2CAP channels in menuconfig (CONFIG_BT_NIMBLE_ENABLED,
+// CONFIG_BT_NIMBLE_L2CAP_COC_MAX_NUM >= 1). The device then advertises and
+// never deep-sleeps between slides. Each SDU (up to BLE_UPLOAD_MTU bytes)
+// takes one of BLE_UPLOAD_BUFFERS heap buffers until the card has it; with
+// all of them waiting the sender gets no more credits. The pack is built in
+// BLE_UPLOAD_TEMP_FILE and renamed over IMAGE_PACK_FILE once complete.
+static constexpr bool BLE_UPLOAD_ENABLED = false;
+static constexpr const char* BLE_UPLOAD_NAME = "ThinkInk";
+static constexpr uint16_t BLE_UPLOAD_PSM = 0x0081;  // Dynamic LE PSM, 0x0080-0x00FF
+static constexpr uint16_t BLE_UPLOAD_MTU = 2048;
+static constexpr uint16_t BLE_UPLOAD_BUFFERS = 4;
+static constexpr uint32_t BLE_UPLOAD_TIMEOUT_MS = 10000;  // Without data before giving up
+static constexpr const char* BLE_UPLOAD_TEMP_FILE = "/sdcard/SLIDES.BLE";
+
+// ------------- USB STORAGE CONFIG -------------
+
+// Expose the SD card to a computer as a USB mass-storage drive (UsbStorage),
+// on chips with USB OTG (ESP32-S2/S3) and esp_tinyusb with
+// CONFIG_TINYUSB_MSC_ENABLED. The console "usb" command starts a session:
+// rendering pauses and the card belongs to the host until it ejects the
+// drive or the cable is pulled, checked every USB_STORAGE_POLL_MS. The image
+// index is then dropped and the card listed again. Taking the USB PHY ends
+// a USB Serial/JTAG console until the next reset.
+static constexpr bool USB_STORAGE_ENABLED = true;
+static constexpr uint32_t USB_STORAGE_POLL_MS = 250;
+static constexpr uint32_t USB_STORAGE_CONNECT_TIMEOUT_MS = 30000;  // For a host to enumerate
+
+// ------------- FRAME CAST CONFIG -------------
+
+// Several frames showing the same slide at once (FrameCast, over ESP-NOW
+// broadcast). The leader (FRAME_CAST_LEADER) runs the slideshow as usual
+// and, for each slide, broadcasts its packed .epd frame from the image pack
+// (up to FRAME_CAST_FRAME_SIZE bytes, sent FRAME_CAST_REPEATS times), then
+// the slide index with a show time FRAME_CAST_LEAD_MS ahead. Followers
+// don't auto-advance: they upload the received frame, or the same slide of
+// their own identical image list, and every panel starts its refresh at
+// the show time. Followers need no images of their own when frames are
+// sent. All units use the same FRAME_CAST_GROUP; they stay on
+// FRAME_CAST_CHANNEL with an empty WIFI_SSID, otherwise on the access
+// point's channel. Never deep-sleeps between slides.
+static constexpr bool FRAME_CAST_ENABLED = false;
+static constexpr bool FRAME_CAST_LEADER = false;
+static constexpr uint8_t FRAME_CAST_GROUP = 1;
+static constexpr uint8_t FRAME_CAST_CHANNEL = 1;
+static constexpr bool FRAME_CAST_SEND_FRAMES = true;    // false: indices only, every unit has the pack
+static constexpr size_t FRAME_CAST_FRAME_SIZE = 32768;  // Receive buffer; larger frames go as indices
+static constexpr uint8_t FRAME_CAST_REPEATS = 2;        // Broadcasts aren't acknowledged
+static constexpr uint32_t FRAME_CAST_LEAD_MS = 2000;
+
+// ------------- SCHEDULE CONFIG -------------
+
+// Opening hours (Schedule). SCHEDULE_PERIODS lists the periods of an open
+// day as "HH:MM-HH:MM/dwell_sec/full|fast" in local time, comma-separated;
+// a period may run past midnight. Each sets the auto-advance dwell, and
+// "fast" shows auto-advanced slides with the fast black/white waveform
+// (panels with fast navigation only). Outside every period, and all day on
+// days missing from SCHEDULE_OPEN_DAYS, the frame is closed: once
+// SCHEDULE_CLOSED_IDLE_SEC pass without input it deep-sleeps straight to
+// the next opening on a single timer wake, and a sleep between slides
+// (AUTO_ADVANCE_DEEP_SLEEP) that would end in closed hours lasts until the
+// opening. Buttons still wake it. Until the clock is set the show runs as
+// if there were no schedule.
+static constexpr bool SCHEDULE_ENABLED = false;
+static constexpr const char* SCHEDULE_PERIODS = "07:30-12:00/60/full,12:00-18:30/120/fast";
+static constexpr uint8_t SCHEDULE_OPEN_DAYS = 0b0111110;  // Bit n = tm_wday n (0 = Sunday): Monday to Friday
+static constexpr uint32_t SCHEDULE_CLOSED_IDLE_SEC = 60;
+static constexpr const char* SCHEDULE_TIMEZONE = "CET-1CEST,M3.5.0,M10.5.0/3";  // POSIX TZ
+
+// The schedule's clock: set over SNTP via WIFI_SSID (between slides, like
+// WifiSync) when unset or last synced SCHEDULE_SNTP_INTERVAL_SEC ago, or by
+// hand with the console "time" command. It runs on through deep sleep but
+// not power loss. An empty server leaves it to the console.
+static constexpr const char* SCHEDULE_SNTP_SERVER = "pool.ntp.org";
+static constexpr uint32_t SCHEDULE_SNTP_INTERVAL_SEC = 24 * 3600;
+static constexpr uint32_t SCHEDULE_SNTP_TIMEOUT_MS = 10000;
+
+// ------------- SERIAL CONSOLE CONFIG -------------
+
+// Interactive console on the ESP-IDF console port (UART or USB, per
+// sdkconfig): stats, SPI and heap counters, forced refreshes, goto and the
+// Bench suites. Type "help" for the commands. Characters typed while the
+// chip light-sleeps can be lost; set LIGHT_SLEEP_ENABLED false for long sessions.
+static constexpr bool CONSOLE_ENABLED = false;
+static constexpr uint32_t CONSOLE_TASK_STACK = 4096;
+
+// ------------- BENCHMARK CONFIG (epd_bench app and console "bench") -------------
+
+// The SPI throughput test writes to its own device on the display's bus with
+// this chip select; pick a GPIO with nothing attached
+static constexpr gpio_num_t BENCH_SPI_CS_PIN = GPIO_NUM_22;
+static constexpr uint32_t BENCH_SPI_FREQ_HZ = EINK_SPI_DATA_HZ;  // The panel's plane data clock
+
+// Runs per measurement; refreshes are slow (~15 s tricolor), so fewer of them
+static constexpr uint32_t BENCH_REPEATS = 5;
+static constexpr uint32_t BENCH_REFRESH_REPEATS = 2;
+
+// Scratch directory for the SD and BMP tests, emptied again afterwards
+static constexpr const char* BENCH_DIRECTORY = "/sdcard/BENCH";
+static constexpr size_t BENCH_SD_FILE_SIZE = 1024 * 1024;
+
+// Besides the BENCH log line, each result is printed to stdout as one
+// "BENCHJSON {...}" line (metric, unit, samples, percentiles, rate, build ID,
+// panel and any budget verdict) for a bench rig to collect; see
+// tools/bench_compare.py
+static constexpr bool BENCH_JSON_ENABLED = true;
+
+// Per-metric budgets, read from the card at the start of each run; one per
+// line as "<metric> <min|avg|max|p50|p90|rate> <<=|>=> <limit>", times in ms
+// and rates in the result's own unit, e.g. "spi.bulk rate >= 2000". The run
+// ends with a BENCH pass/fail verdict over every budget it measured
+static constexpr const char* BENCH_BUDGET_FILE = "/sdcard/BUDGET.TXT";
+static constexpr size_t BENCH_MAX_BUDGETS = 32;
+
+// Soak ("bench soak", and after the other suites in epd_bench with
+// BENCH_SOAK_ENABLED): BENCH_SOAK_RENDERS loads of the images in
+// IMAGE_DIRECTORY, stepping mostly forward with some steps back and random
+// jumps, a quarter of them past the converted-frame cache. Every
+// BENCH_SOAK_REFRESH_EVERY loads the panel is refreshed (0: never), and
+// every BENCH_SOAK_SLEEP_EVERY the panel is powered down and the chip
+// light-sleeps for BENCH_SOAK_SLEEP_MS (0: never). Each window of
+// BENCH_SOAK_WINDOW loads logs its load-time percentiles, heap and stack,
+// and is compared with the first that loaded anything: a p90 more than
+// BENCH_SOAK_LATENCY_DRIFT_PERCENT slower, a largest free block more than
+// BENCH_SOAK_BLOCK_DRIFT_PERCENT smaller, more failed loads, or stack under
+// STACK_FREE_ALARM_BYTES is flagged as drift and fails the run
+static constexpr bool BENCH_SOAK_ENABLED = false;
+static constexpr uint32_t BENCH_SOAK_RENDERS = 20000;
+static constexpr uint32_t BENCH_SOAK_WINDOW = 250;
+static constexpr uint32_t BENCH_SOAK_REFRESH_EVERY = 100;
+static constexpr uint32_t BENCH_SOAK_SLEEP_EVERY = 20;
+static constexpr uint32_t BENCH_SOAK_SLEEP_MS = 100;
+static constexpr uint32_t BENCH_SOAK_LATENCY_DRIFT_PERCENT = 20;
+static constexpr uint32_t BENCH_SOAK_BLOCK_DRIFT_PERCENT = 10;
@@ -0,0 +1,623 @@
+/**
+ * @file console.cpp
+ * @brief Serial console implementation
+ */
+
+#include "console.hpp"
+#include "config.hpp"
+#include "slideshow.hpp"
+#include "slide_stats.hpp"
+#include "pipeline_trace.hpp"
+#include "sd_card.hpp"
+#include "slide_arena.hpp"
+#include "heap_watch.hpp"
+#include "power_stats.hpp"
+#include "boot_profile.hpp"
+#include "panel.hpp"
+#include "bench.hpp"
+#include "schedule.hpp"
+#include "battery.hpp"
+#include "playlists.hpp"
+#include "ble_upload.hpp"
+#include "usb_storage.hpp"
+#include "widgets.hpp"
+#include "spi_record.hpp"
+#include "tunables.hpp"
+#include "esp_console.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cinttypes>
+
+static const char* TAG_CONSOLE = "Console";
+
+static const char* stateName(Slideshow::State state)
+{
+    switch (state) {
+        case Slideshow::State::INIT:         return "init";
+        case Slideshow::State::SCANNING:     return "scanning";
+        case Slideshow::State::DISPLAYING:   return "displaying";
+        case Slideshow::State::AUTO_ADVANCE: return "auto-advance";
+        case Slideshow::State::ERROR:        return "error";
+        case Slideshow::State::SLEEPING:     return "sleeping";
+    }
+    return "?";
+}
+
+/**
+ * @brief Post a command, reporting a full queue
+ */
+static int post(Slideshow::Command command, uint32_t arg = 0)
+{
+    if (!Slideshow::post(command, arg)) {
+        printf("Slideshow busy, try again\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int cmdStatus(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+    Slideshow::Snapshot snapshot;
+    Slideshow::getSnapshot(snapshot);
+    printf("State: %s, slide %zu of %zu, auto-advance %s\n", stateName(snapshot.state),
+           snapshot.currentIndex + 1, snapshot.imageCount, snapshot.autoAdvance ? "on" : "off");
+    return 0;
+}
+
+static int cmdStats(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+    SlideStats::Summary summary;
+    Slideshow::getStats(summary);
+    printf("%zu slides in the history\n", summary.slides);
+    printf("%-10s %5s %9s %9s %9s %10s\n", "stage", "count", "min ms", "avg ms", "max ms",
+           "min heap");
+    for (size_t i = 0; i < static_cast<size_t>(SlideStats::Stage::COUNT); i++) {
+        const SlideStats::StageSummary& stage = summary.stages[i];
+        if (stage.count == 0) {
+            continue;
+        }
+        printf("%-10s %5" PRIu32 " %9.1f %9.1f %9.1f %10" PRIu32 "\n",
+               SlideStats::stageName(static_cast<SlideStats::Stage>(i)), stage.count,
+               stage.minUs / 1000.0, stage.avgUs / 1000.0, stage.maxUs / 1000.0,
+               stage.minFreeHeap);
+    }
+    const SlideStats::LatencySummary& latency = summary.latency;
+    if (latency.count) {
+        printf("Input to refresh over %" PRIu32 " slides: start p50 %.1f p90 %.1f max %.1f ms, "
+               "done p50 %.1f p90 %.1f max %.1f ms\n", latency.count,
+               latency.startP50Us / 1000.0, latency.startP90Us / 1000.0,
+               latency.startMaxUs / 1000.0, latency.doneP50Us / 1000.0,
+               latency.doneP90Us / 1000.0, latency.doneMaxUs / 1000.0);
+    }
+    return 0;
+}
+
+static int cmdHistory(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+    SlideStats::logHistory();
+    return 0;
+}
+
+static int cmdSpi(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+    SlideStats::Summary summary;
+    Slideshow::getStats(summary);
+    const SlideStats::SpiSummary& spi = summary.spi;
+    if (spi.count == 0) {
+        printf("No SPI counters yet\n");
+        return 0;
+    }
+    printf("SPI per slide over %" PRIu32 " slides:\n", spi.count);
+    printf("  transactions avg %" PRIu32 " max %" PRIu32 "\n", spi.avgTransactions,
+           spi.maxTransactions);
+    printf("  bytes        avg %" PRIu32 " max %" PRIu32 "\n", spi.avgBytes, spi.maxBytes);
+    printf("  busy         avg %.1f ms\n", spi.avgBusyUs / 1000.0);
+    printf("  queue peak   %" PRIu32 "\n", spi.queuePeak);
+    return 0;
+}
+
+static int cmdHeap(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+    printf("Heap now: %zu free, largest block %zu, lowest ever %zu\n",
+           heap_caps_get_free_size(MALLOC_CAP_8BIT),
+           heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+           heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+
+    SlideStats::Summary summary;
+    Slideshow::getStats(summary);
+    const SlideStats::MemorySummary& memory = summary.memory;
+    printf("Over the history: heap min %" PRIu32 ", largest block min %" PRIu32
+           ", slideshow stack never used %" PRIu32 ", %" PRIu32 " alarms\n",
+           memory.minFreeHeap, memory.minLargestBlock, memory.minStackFree, memory.alarms);
+    if (HeapWatch::available()) {
+        printf("Slideshow task: %" PRIu32 " allocations since boot, last %zu bytes; "
+               "%" PRIu32 " slides allocated, at most %" PRIu32 "\n", HeapWatch::allocations(),
+               HeapWatch::lastSize(), memory.allocSlides, memory.maxAllocs);
+    } else {
+        printf("Slideshow task allocations: hooks disabled (CONFIG_HEAP_USE_HOOKS)\n");
+    }
+
+    SlideArena::Stats arena;
+    SlideArena::getStats(arena);
+    printf("Slide arena: %zu bytes, peak %zu, %" PRIu32 " allocations on the heap instead\n",
+           arena.size, arena.peak, arena.overflows);
+    return 0;
+}
+
+static int cmdPower(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+    PowerStats::Usage usage;
+    PowerStats::lastWindow(usage);
+    PowerStats::log("Last slide", usage);
+    PowerStats::total(usage);
+    PowerStats::log("Since boot", usage);
+    if (BATTERY_MONITOR_ENABLED) {
+        printf("Battery: %" PRIu32 " mV, %s\n", Battery::millivolts(),
+               Battery::levelName(Battery::level()));
+    }
+    return 0;
+}
+
+static int cmdTrace(int argc, char** argv)
+{
+    if (!PIPELINE_TRACE_ENABLED) {
+        printf("Tracing is off (PIPELINE_TRACE_ENABLED)\n");
+        return 1;
+    }
+    if (argc == 1) {
+        PipelineTrace::write(stdout);
+        return 0;
+    }
+    if (argc == 2 && strcmp(argv[1], "clear") == 0) {
+        PipelineTrace::clear();
+        return 0;
+    }
+    if (argc != 2 || strcmp(argv[1], "sd") != 0) {
+        printf("Usage: trace [sd|clear]\n");
+        return 1;
+    }
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%s", IMAGE_CACHE_DIRECTORY, PIPELINE_TRACE_FILE);
+    FILE* file = SDCard::makeDirectory(IMAGE_CACHE_DIRECTORY) ? SDCard::createFile(path) : nullptr;
+    if (!file) {
+        printf("Could not create %s\n", path);
+        return 1;
+    }
+    size_t events = PipelineTrace::write(file);
+    if (fclose(file) != 0) {
+        printf("Could not write %s\n", path);
+        return 1;
+    }
+    printf("%zu events in %s\n", events, path);
+    return 0;
+}
+
+static int cmdSpiRec(int argc, char** argv)
+{
+    if (!SPI_RECORD_ENABLED) {
+        printf("SPI recording is off (SPI_RECORD_ENABLED)\n");
+        return 1;
+    }
+    const char* action = argc > 1 ? argv[1] : "";
+    if (argc == 1) {
+        printf("%s, %zu bytes recorded\n", SpiRecord::recording() ? "Recording" : "Stopped",
+               SpiRecord::size());
+        return 0;
+    }
+    if (argc == 2 && strcmp(action, "start") == 0) {
+        return SpiRecord::start() ? 0 : 1;
+    }
+    if (argc == 2 && strcmp(action, "stop") == 0) {
+        SpiRecord::stop();
+        return 0;
+    }
+    if (argc != 2 || strcmp(action, "sd") != 0) {
+        printf("Usage: spirec [start|stop|sd]\n");
+        return 1;
+    }
+    SpiRecord::stop();
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%s", IMAGE_CACHE_DIRECTORY, SPI_RECORD_FILE);
+    FILE* file = SDCard::makeDirectory(IMAGE_CACHE_DIRECTORY) ? SDCard::createFile(path) : nullptr;
+    if (!file) {
+        printf("Could not create %s\n", path);
+        return 1;
+    }
+    size_t bytes = SpiRecord::write(file);
+    if (fclose(file) != 0) {
+        printf("Could not write %s\n", path);
+        return 1;
+    }
+    printf("%zu bytes in %s\n", bytes, path);
+    return 0;
+}
+
+static int cmdBoot(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+    BootProfile::Result result;
+    BootProfile::current(result);
+    BootProfile::log("This boot", result);
+    if (BootProfile::previous(result)) {
+        BootProfile::log("Previous boot", result);
+    }
+    return 0;
+}
+
+static int cmdRefresh(int argc, char** argv)
+{
+    const char* mode = argc > 1 ? argv[1] : "full";
+    if (strcmp(mode, "full") == 0) {
+        return post(Slideshow::Command::REFRESH_FULL);
+    }
+    if (strcmp(mode, "partial") == 0) {
+        return post(Slideshow::Command::REFRESH_PARTIAL);
+    }
+    if (strcmp(mode, "fast") == 0) {
+        return post(Slideshow::Command::REFRESH_FAST);
+    }
+    printf("Usage: refresh [full|partial|fast]\n");
+    return 1;
+}
+
+static int cmdGoto(int argc, char** argv)
+{
+    char* end = nullptr;
+    unsigned long slide = argc > 1 ? strtoul(argv[1], &end, 10) : 0;
+    if (argc != 2 || *end != '\0' || slide == 0 || slide > Slideshow::getImageCount()) {
+        printf("Usage: goto <1..%zu>\n", Slideshow::getImageCount());
+        return 1;
+    }
+    return post(Slideshow::Command::GOTO, static_cast<uint32_t>(slide - 1));
+}
+
+static int cmdBench(int argc, char** argv)
+{
+    Bench::Suite suite;
+    if (argc != 2 || !Bench::parse(argv[1], suite)) {
+        printf("Usage: bench <");
+        for (size_t i = 0; i < static_cast<size_t>(Bench::Suite::COUNT); i++) {
+            printf("%s%s", i ? "|" : "", Bench::suiteName(static_cast<Bench::Suite>(i)));
+        }
+        printf(">\n");
+        return 1;
+    }
+    printf("Results are logged as BENCH (and BENCHJSON) lines; the slide is redrawn afterwards\n");
+    return post(Slideshow::Command::BENCH, static_cast<uint32_t>(suite));
+}
+
+static int cmdSync(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+    if (!WIFI_SYNC_ENABLED) {
+        printf("Wi-Fi sync is disabled (WIFI_SYNC_ENABLED)\n");
+        return 1;
+    }
+    printf("The result is logged by WifiSync\n");
+    return post(Slideshow::Command::SYNC);
+}
+
+static int cmdUsb(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+    if (!UsbStorage::available()) {
+        printf("USB storage needs USB OTG and TinyUSB MSC (USB_STORAGE_ENABLED)\n");
+        return 1;
+    }
+    printf("The SD card is a USB drive until the host ejects it\n");
+    return post(Slideshow::Command::USB);
+}
+
+static int cmdUpload(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+    if (!BLE_UPLOAD_ENABLED) {
+        printf("BLE uploads are disabled (BLE_UPLOAD_ENABLED)\n");
+        return 1;
+    }
+    BleUpload::Stats stats;
+    BleUpload::getStats(stats);
+    printf("%" PRIu32 " uploads, %" PRIu32 " failed\n", stats.uploads, stats.failures);
+    if (stats.uploads + stats.failures > 0) {
+        uint64_t kbps = stats.ms ? stats.bytes * 1000 / 1024 / stats.ms : 0;
+        printf("Last: %" PRIu32 " frames, %" PRIu64 " KB in %" PRIu32 " ms (%" PRIu64 " KB/s)\n",
+               stats.frames, stats.bytes / 1024, stats.ms, kbps);
+    }
+    printf("%" PRIu32 " SDUs, %" PRIu32 " waited for the card, at most %" PRIu32 " queued of %u\n",
+           stats.sdus, stats.stalls, stats.peakQueued, BLE_UPLOAD_BUFFERS);
+    return 0;
+}
+
+static int cmdGrid(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+    if (!GRID_VIEW_ENABLED) {
+        printf("The contact sheet is disabled (GRID_VIEW_ENABLED)\n");
+        return 1;
+    }
+    return post(Slideshow::Command::GRID);
+}
+
+static int cmdShuffle(int argc, char** argv)
+{
+    const char* mode = argc > 1 ? argv[1] : "new";
+    if (strcmp(mode, "off") == 0) {
+        return post(Slideshow::Command::SHUFFLE, 0);
+    }
+    if (strcmp(mode, "on") == 0) {
+        return post(Slideshow::Command::SHUFFLE, 1);
+    }
+    if (strcmp(mode, "new") == 0) {
+        return post(Slideshow::Command::SHUFFLE, 2);
+    }
+    printf("Usage: shuffle [on|off|new]\n");
+    return 1;
+}
+
+static int cmdFav(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+    return post(Slideshow::Command::FAVORITE);
+}
+
+static int cmdWidget(int argc, char** argv)
+{
+    char* slotEnd = nullptr;
+    char* valueEnd = nullptr;
+    unsigned long slot = argc == 3 ? strtoul(argv[1], &slotEnd, 10) : WIDGET_VALUE_SLOTS;
+    long value = argc == 3 ? strtol(argv[2], &valueEnd, 10) : 0;
+    if (argc != 3 || *slotEnd != '\0' || *valueEnd != '\0' || !Widgets::setValue(slot, value)) {
+        printf("Usage: widget <0-%zu> <number>\n", WIDGET_VALUE_SLOTS - 1);
+        return 1;
+    }
+    return post(Slideshow::Command::WIDGETS);
+}
+
+static int cmdPlaylist(int argc, char** argv)
+{
+    if (argc == 2) {
+        printf("%s: %zu slides\n", argv[1], Playlists::size(argv[1]));
+        return 0;
+    }
+    char* end = nullptr;
+    unsigned long slide = argc == 4 ? strtoul(argv[3], &end, 10) : 0;
+    bool add = argc == 4 && strcmp(argv[1], "add") == 0;
+    if (argc != 4 || (!add && strcmp(argv[1], "remove") != 0) || *end != '\0' ||
+        slide == 0 || slide > Slideshow::getImageCount()) {
+        printf("Usage: playlist <name> | playlist <add|remove> <name> <1..%zu>\n",
+               Slideshow::getImageCount());
+        return 1;
+    }
+    if (!Playlists::set(argv[2], slide - 1, add)) {
+        printf("Failed (names are 1..%zu characters, not starting with _)\n", Playlists::MAX_NAME);
+        return 1;
+    }
+    printf("%s: %zu slides\n", argv[2], Playlists::size(argv[2]));
+    return 0;
+}
+
+static int cmdPlay(int argc, char** argv)
+{
+    if (argc == 1) {
+        printf("Playing %s\n", Playlists::playing()[0] ? Playlists::playing() : "all");
+        return 0;
+    }
+    const char* name = strcmp(argv[1], "all") == 0 ? "" : argv[1];
+    if (argc != 2 || !Playlists::play(name)) {
+        printf("No slides in %s, playing all\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
+
+static int cmdPanel(int argc, char** argv)
+{
+    size_t count;
+    const Panel::Profile* profiles = Panel::profiles(count);
+    if (argc == 1) {
+        for (size_t i = 0; i < count; i++) {
+            printf("%c %u  %s\n", profiles[i].id == Panel::active().id ? '*' : ' ',
+                   profiles[i].id, profiles[i].name);
+        }
+        return 0;
+    }
+    char* end = nullptr;
+    unsigned long id = strtoul(argv[1], &end, 10);
+    if (argc != 2 || *end != '\0' || id > UINT8_MAX || !Panel::find(static_cast<uint8_t>(id))) {
+        printf("Usage: panel [id], ids as listed by \"panel\"\n");
+        return 1;
+    }
+    if (!Panel::select(static_cast<uint8_t>(id))) {
+        printf("Could not store the panel\n");
+        return 1;
+    }
+    printf("Panel %lu from the next boot on\n", id);
+    return 0;
+}
+
+static int cmdTune(int argc, char** argv)
+{
+    if (argc == 1) {
+        printf("%-16s %10s %10s %10s  %s\n", "key", "now", "next boot", "default", "range");
+        for (size_t i = 0; i < static_cast<size_t>(Tunables::Id::COUNT); i++) {
+            Tunables::Id id = static_cast<Tunables::Id>(i);
+            const Tunables::Info& info = Tunables::info(id);
+            printf("%-16s %10" PRIu32 " %10" PRIu32 " %10" PRIu32 "  %" PRIu32 "..%" PRIu32 " %s\n",
+                   info.key, Tunables::get(id), Tunables::stored(id), info.defaultValue, info.min,
+                   info.max, info.unit);
+        }
+        return 0;
+    }
+    Tunables::Id id;
+    char* end = nullptr;
+    unsigned long value = argc == 3 ? strtoul(argv[2], &end, 10) : 0;
+    if (argc != 3 || !Tunables::find(argv[1], id)) {
+        printf("Usage: tune [<key> <value|default>], keys as listed by \"tune\"\n");
+        return 1;
+    }
+    const Tunables::Info& info = Tunables::info(id);
+    if (strcmp(argv[2], "default") == 0) {
+        value = info.defaultValue;
+    } else if (*end != '\0' || value < info.min || value > info.max) {
+        printf("%s takes %" PRIu32 "..%" PRIu32 "\n", info.key, info.min, info.max);
+        return 1;
+    }
+    if (!Tunables::set(id, static_cast<uint32_t>(value))) {
+        printf("Could not store %s\n", info.key);
+        return 1;
+    }
+    printf("%s %lu from the next boot on\n", info.key, value);
+    return 0;
+}
+
+static int cmdTime(int argc, char** argv)
+{
+    if (argc == 3) {
+        struct tm local = {};
+        int year, month, day, hour, minute;
+        if (sscanf(argv[1], "%d-%d-%d", &year, &month, &day) != 3 ||
+            sscanf(argv[2], "%d:%d", &hour, &minute) != 2 ||
+            month < 1 || month > 12 || day < 1 || day > 31 || hour < 0 || hour > 23 ||
+            minute < 0 || minute > 59) {
+            printf("Usage: time [YYYY-MM-DD HH:MM], local time\n");
+            return 1;
+        }
+        local.tm_year = year - 1900;
+        local.tm_mon = month - 1;
+        local.tm_mday = day;
+        local.tm_hour = hour;
+        local.tm_min = minute;
+        if (!Schedule::setClock(local)) {
+            printf("Could not set the clock\n");
+            return 1;
+        }
+    } else if (argc != 1) {
+        printf("Usage: time [YYYY-MM-DD HH:MM], local time\n");
+        return 1;
+    }
+
+    struct tm now;
+    if (!Schedule::localTime(now)) {
+        printf("Clock not set\n");
+        return 0;
+    }
+    char text[32];
+    strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S %Z", &now);
+    if (!Schedule::active()) {
+        printf("%s, no schedule\n", text);
+    } else if (Schedule::isClosed()) {
+        printf("%s, closed, opens in %" PRId64 " min\n", text, Schedule::secondsUntilOpen() / 60);
+    } else {
+        printf("%s, open, dwell %" PRIu32 " s, %s waveform\n", text, Schedule::dwellSec(),
+               Schedule::fastWaveform() ? "fast" : "full");
+    }
+    return 0;
+}
+
+namespace {
+
+struct CommandInfo {
+    const char* name;
+    const char* help;
+    const char* hint;
+    esp_console_cmd_func_t func;
+};
+
+const CommandInfo COMMANDS[] = {
+    { "status", "Slideshow state and current slide", nullptr, cmdStatus },
+    { "stats", "Stage times over the stats history", nullptr, cmdStats },
+    { "history", "Log every record in the stats history", nullptr, cmdHistory },
+    { "spi", "SPI traffic per slide", nullptr, cmdSpi },
+    { "heap", "Free heap now and memory low points", nullptr, cmdHeap },
+    { "power", "Estimated charge of the last slide and since boot", nullptr, cmdPower },
+    { "trace", "Print the pipeline timeline as Chrome trace JSON, or write it to the card", "[sd|clear]", cmdTrace },
+    { "spirec", "Record the panel's SPI traffic, or write the recording to the card", "[start|stop|sd]", cmdSpiRec },
+    { "boot", "Time from reset to the first image, this boot and the last", nullptr, cmdBoot },
+    { "refresh", "Refresh the current slide", "[full|partial|fast]", cmdRefresh },
+    { "goto", "Show a slide", "<slide>", cmdGoto },
+    { "bench", "Run a benchmark suite", "<suite>", cmdBench },
+    { "sync", "Update the image pack over Wi-Fi now", nullptr, cmdSync },
+    { "upload", "BLE upload throughput and flow control", nullptr, cmdUpload },
+    { "usb", "Lend the SD card to a USB host until it ejects it", nullptr, cmdUsb },
+    { "grid", "Open or close the contact sheet of thumbnails", nullptr, cmdGrid },
+    { "shuffle", "Play in list order, shuffled, or in a new shuffle", "[on|off|new]", cmdShuffle },
+    { "fav", "Add the current slide to the favorites, or take it out", nullptr, cmdFav },
+    { "widget", "Set the number a value widget shows", "<slot> <number>", cmdWidget },
+    { "playlist", "Show a list's size, or add or remove a slide", "[add|remove] <name> [slide]", cmdPlaylist },
+    { "play", "Play only a list's slides (fav for the favorites), or all", "[name|all]", cmdPlay },
+    { "panel", "List panel profiles, or drive another from the next boot", "[id]", cmdPanel },
+    { "tune", "List the tunables, or set one from the next boot", "[<key> <value|default>]", cmdTune },
+    { "time", "Show or set the clock, and where the schedule stands", "[YYYY-MM-DD HH:MM]", cmdTime },
+};
+
+} // namespace
+
+bool Console::start()
+{
+    esp_console_repl_t* repl = nullptr;
+    esp_console_repl_config_t replConfig = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    replConfig.prompt = "slideshow>";
+    replConfig.task_stack_size = CONSOLE_TASK_STACK;
+
+#if CONFIG_ESP_CONSOLE_UART_DEFAULT || CONFIG_ESP_CONSOLE_UART_CUSTOM
+    esp_console_dev_uart_config_t devConfig = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+    esp_err_t ret = esp_console_new_repl_uart(&devConfig, &replConfig, &repl);
+#elif CONFIG_ESP_CONSOLE_USB_CDC
+    esp_console_dev_usb_cdc_config_t devConfig = ESP_CONSOLE_DEV_CDC_CONFIG_DEFAULT();
+    esp_err_t ret = esp_console_new_repl_usb_cdc(&devConfig, &replConfig, &repl);
+#elif CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG
+    esp_console_dev_usb_serial_jtag_config_t devConfig =
+        ESP_CONSOLE_DEV_USB_SERIAL_JTAG_CONFIG_DEFAULT();
+    esp_err_t ret = esp_console_new_repl_usb_serial_jtag(&devConfig, &replConfig, &repl);
+#else
+    esp_err_t ret = ESP_ERR_NOT_SUPPORTED;
+#endif
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG_CONSOLE, "Console unavailable: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+    esp_console_register_help_command();
+    for (const CommandInfo& info : COMMANDS) {
+        esp_console_cmd_t command = {};
+        command.command = info.name;
+        command.help = info.help;
+        command.hint = info.hint;
+        command.func = info.func;
+        ret = esp_console_cmd_register(&command);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG_CONSOLE, "Failed to register %s: %s", info.name, esp_err_to_name(ret));
+            return false;
+        }
+    }
+
+    ret = esp_console_start_repl(repl);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG_CONSOLE, "Failed to start console: %s", esp_err_to_name(ret));
+        return false;
+    }
+    ESP_LOGI(TAG_CONSOLE, "Console started, type \"help\"");
+    return true;
+}
@@ -0,0 +1,20 @@
+/**
+ * @file console.hpp
+ * @brief Serial console for inspecting and driving the slideshow
+ */
+
+#pragma once
+
+namespace Console {
+
+/**
+ * @brief Start the console task on the ESP-IDF console port
+ *
+ * Call after Slideshow::init(). Commands that change the screen are posted
+ * to the slideshow task (Slideshow::post()); the rest only read the stats.
+ *
+ * @return true if successful
+ */
+bool start();
+
+} // namespace Console
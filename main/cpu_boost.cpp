@@ -0,0 +1,61 @@
+/**
+ * @file cpu_boost.cpp
+ * @brief Full CPU clock while there is work implementation
+ */
+
+#include "cpu_boost.hpp"
+#include "config.hpp"
+#include "esp_log.h"
+#include <atomic>
+
+static const char* TAG_BOOST = "CpuBoost";
+
+static constexpr size_t HOLDER_COUNT = static_cast<size_t>(CpuBoost::Holder::COUNT);
+
+// Lock names, in Holder order; esp_pm_dump_locks() shows them
+static const char* const HOLDER_NAMES[HOLDER_COUNT] = {"boot", "slideshow", "epd_upload"};
+
+static esp_pm_lock_handle_t s_locks[HOLDER_COUNT] = {};
+static std::atomic<bool> s_held[HOLDER_COUNT] = {};
+
+bool CpuBoost::init()
+{
+#if CONFIG_PM_ENABLE
+    if (!LIGHT_SLEEP_ENABLED) {
+        return false;  // esp_pm isn't configured, so the clock never drops
+    }
+    for (size_t i = 0; i < HOLDER_COUNT; i++) {
+        if (s_locks[i]) {
+            continue;
+        }
+        esp_err_t err = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, HOLDER_NAMES[i], &s_locks[i]);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG_BOOST, "Cannot create the %s lock: %s", HOLDER_NAMES[i], esp_err_to_name(err));
+            s_locks[i] = nullptr;
+            return false;
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void CpuBoost::set(Holder holder, bool on)
+{
+    size_t i = static_cast<size_t>(holder);
+    if (i >= HOLDER_COUNT || !s_locks[i] || s_held[i].exchange(on) == on) {
+        return;
+    }
+    if (on) {
+        esp_pm_lock_acquire(s_locks[i]);
+    } else {
+        esp_pm_lock_release(s_locks[i]);
+    }
+}
+
+esp_pm_lock_handle_t CpuBoost::lock(Holder holder)
+{
+    size_t i = static_cast<size_t>(holder);
+    return i < HOLDER_COUNT ? s_locks[i] : nullptr;
+}
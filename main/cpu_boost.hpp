@@ -0,0 +1,50 @@
+/**
+ * @file cpu_boost.hpp
+ * @brief Full CPU clock while there is work, the minimum clock and light
+ *        sleep while waiting
+ *
+ * With esp_pm configured (LIGHT_SLEEP_ENABLED), the clock only leaves the
+ * minimum (XTAL) frequency while someone holds an ESP_PM_CPU_FREQ_MAX lock,
+ * and the chip only light-sleeps while no one does. Each holder has its own
+ * lock, so they switch on and off independently: decode and pack work runs
+ * at full speed and every wait (dwell, refresh, busy pin) drops back to the
+ * slowest clock. Without CONFIG_PM_ENABLE everything here does nothing.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "esp_pm.h"
+
+namespace CpuBoost {
+
+/**
+ * @brief Who wants the full clock
+ */
+enum class Holder : uint8_t {
+    BOOT,       // app_main() bringing the slideshow up
+    SLIDESHOW,  // Slideshow task running rather than blocked
+    UPLOAD,     // Panel upload, held by the driver (Adafruit_EPD::setUploadLock())
+    COUNT
+};
+
+/**
+ * @brief Create the locks; call after esp_pm_configure()
+ * @return false if esp_pm is unavailable (the clock is then left alone)
+ */
+bool init();
+
+/**
+ * @brief Hold or release the full clock for a holder; safe from any task
+ *
+ * Repeating the current state changes nothing.
+ */
+void set(Holder holder, bool on);
+
+/**
+ * @brief A holder's lock, for code that acquires it itself (the display
+ *        driver); nullptr before init() or without esp_pm
+ */
+esp_pm_lock_handle_t lock(Holder holder);
+
+} // namespace CpuBoost
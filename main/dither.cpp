@@ -0,0 +1,458 @@
+/**
+ * @file dither.cpp
+ * @brief Row-streaming dithering implementation
+ */
+
+#include "dither.hpp"
+#include "image_loader.hpp"
+#include "blue_noise.hpp"
+#include "../components/Adafruit_EPD/src/EPDColors.h"
+#include <cstring>
+
+namespace {
+
+// Ink positions in the (Y, Cr) plane, Y = (77R + 150G + 29B) >> 8, Cr = R - Y
+struct Ink {
+    int16_t y;
+    int16_t cr;
+    uint8_t color;
+};
+
+constexpr Ink INKS[] = {
+    { 0,   0,   EPD_BLACK },
+    { 255, 0,   EPD_WHITE },
+    { 76,  179, EPD_RED },   // Pure red: Y = 77 * 255 >> 8
+};
+
+// The seven ACeP inks as the panel shows them (sRGB), indexed by their
+// ACEP_COLOR_* code: black, white, green, blue, red, yellow, orange
+constexpr uint8_t ACEP_INKS[7][3] = {
+    { 57,  48,  57 },
+    { 255, 255, 255 },
+    { 58,  91,  70 },
+    { 61,  59,  94 },
+    { 156, 72,  75 },
+    { 208, 190, 71 },
+    { 177, 106, 73 },
+};
+
+/**
+ * @brief Nearest ACeP ink, evaluated at compile time only
+ *
+ * Squared distance weighted 2:4:3 (R:G:B), close to perceived difference
+ * for these muted inks at a fraction of the cost of a Lab conversion.
+ */
+constexpr uint8_t nearestAcepInk(int32_t r, int32_t g, int32_t b)
+{
+    uint8_t best = 0;
+    int32_t bestDist = INT32_MAX;
+    for (uint8_t i = 0; i < 7; i++) {
+        int32_t dr = r - ACEP_INKS[i][0];
+        int32_t dg = g - ACEP_INKS[i][1];
+        int32_t db = b - ACEP_INKS[i][2];
+        int32_t dist = 2 * dr * dr + 4 * dg * dg + 3 * db * db;
+        if (dist < bestDist) {
+            bestDist = dist;
+            best = i;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief 32x32x32 RGB555 -> ACeP ink table, 4 bits per entry (16 KB, flash)
+ *
+ * Each cell holds the ink nearest its center, like EinkColorLUT does for
+ * the tricolor thresholds.
+ */
+struct AcepInkLUT {
+    static constexpr uint32_t BITS = 5;
+    static constexpr uint32_t CELLS = 1u << (3 * BITS);
+    uint8_t packed[CELLS / 2];
+};
+
+constexpr AcepInkLUT buildAcepInkLUT()
+{
+    AcepInkLUT lut{};
+    constexpr uint32_t half = 1u << (7 - AcepInkLUT::BITS);
+    for (uint32_t index = 0; index < AcepInkLUT::CELLS; index++) {
+        uint32_t r = (index >> (2 * AcepInkLUT::BITS)) & 0x1F;
+        uint32_t g = (index >> AcepInkLUT::BITS) & 0x1F;
+        uint32_t b = index & 0x1F;
+        uint8_t ink = nearestAcepInk((r << 3) + half, (g << 3) + half, (b << 3) + half);
+        lut.packed[index / 2] |= ink << ((index % 2) * 4);
+    }
+    return lut;
+}
+
+constexpr AcepInkLUT ACEP_INK_LUT = buildAcepInkLUT();
+
+inline uint8_t acepInk(int32_t r, int32_t g, int32_t b)
+{
+    uint32_t index = ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3);
+    return (ACEP_INK_LUT.packed[index / 2] >> ((index % 2) * 4)) & 0xF;
+}
+
+// The four THINKINK_GRAYSCALE4 inks, darkest first, GRAY_STEP luma apart.
+// The panel's layer_colors put each on its two plane bits, so a span of
+// these still goes to both planes in one writeSpan() pass
+constexpr uint8_t GRAY_INKS[4] = { EPD_BLACK, EPD_DARK, EPD_LIGHT, EPD_WHITE };
+constexpr int32_t GRAY_STEP = 85;
+
+// Nearest gray level (index into GRAY_INKS) of a luma 0..255
+inline uint8_t grayLevel(int32_t y)
+{
+    return static_cast<uint8_t>((y * 3 + 127) / 255);
+}
+
+// 4x4 Bayer threshold map, values 0..15
+constexpr uint8_t BAYER4[4][4] = {
+    {  0,  8,  2, 10 },
+    { 12,  4, 14,  6 },
+    {  3, 11,  1,  9 },
+    { 15,  7, 13,  5 },
+};
+
+inline int16_t clamp(int32_t v, int16_t lo, int16_t hi)
+{
+    return static_cast<int16_t>(v < lo ? lo : (v > hi ? hi : v));
+}
+
+inline const Ink& nearestInk(int32_t y, int32_t cr)
+{
+    const Ink* best = &INKS[0];
+    int32_t bestDist = INT32_MAX;
+    for (const Ink& ink : INKS) {
+        int32_t dy = y - ink.y;
+        int32_t dcr = cr - ink.cr;
+        int32_t dist = dy * dy + dcr * dcr;
+        if (dist < bestDist) {
+            bestDist = dist;
+            best = &ink;
+        }
+    }
+    return *best;
+}
+
+inline void toLumaChroma(const uint8_t* rgb, int32_t& y, int32_t& cr)
+{
+    y = (77 * rgb[0] + 150 * rgb[1] + 29 * rgb[2]) >> 8;
+    cr = rgb[0] - y;
+}
+
+// Add weight/2^shift of the error to one (Y, Cr) term pair
+inline void spread(int16_t* term, int32_t ey, int32_t ecr, int32_t weight, int shift)
+{
+    term[0] += static_cast<int16_t>((ey * weight) >> shift);
+    term[1] += static_cast<int16_t>((ecr * weight) >> shift);
+}
+
+// Add weight/2^shift of the error to one Y term
+inline void spreadY(int16_t* term, int32_t ey, int32_t weight, int shift)
+{
+    *term += static_cast<int16_t>((ey * weight) >> shift);
+}
+
+// Add weight/2^shift of the error to one (R, G, B) term triplet
+inline void spreadRGB(int16_t* term, const int32_t* e, int32_t weight, int shift)
+{
+    term[0] += static_cast<int16_t>((e[0] * weight) >> shift);
+    term[1] += static_cast<int16_t>((e[1] * weight) >> shift);
+    term[2] += static_cast<int16_t>((e[2] * weight) >> shift);
+}
+
+} // namespace
+
+uint8_t Dither::inkFor(Palette palette, uint8_t r, uint8_t g, uint8_t b)
+{
+    if (palette == Palette::ACEP7) {
+        return acepInk(r, g, b);
+    }
+    if (palette == Palette::GRAY4) {
+        const uint8_t rgb[3] = { r, g, b };
+        int32_t y, cr;
+        toLumaChroma(rgb, y, cr);
+        return GRAY_INKS[grayLevel(y)];
+    }
+    return static_cast<uint8_t>(ImageLoader::rgbToEinkColor(r, g, b));
+}
+
+bool Dither::exactInk(Palette palette, const uint8_t* rgb, uint8_t& ink)
+{
+    switch (palette) {
+    case Palette::ACEP7:
+        for (uint8_t i = 0; i < 7; i++) {
+            if (memcmp(rgb, ACEP_INKS[i], 3) == 0) {
+                ink = i;
+                return true;
+            }
+        }
+        return false;
+    case Palette::GRAY4:
+        if (rgb[0] != rgb[1] || rgb[1] != rgb[2] || rgb[0] % GRAY_STEP != 0) {
+            return false;
+        }
+        ink = GRAY_INKS[rgb[0] / GRAY_STEP];
+        return true;
+    default:
+        if (rgb[1] != rgb[2] || (rgb[1] != 0 && rgb[1] != 255)) {
+            return false;
+        }
+        if (rgb[0] == 0 && rgb[1] == 0) {
+            ink = EPD_BLACK;
+        } else if (rgb[0] == 255) {
+            ink = rgb[1] ? EPD_WHITE : EPD_RED;
+        } else {
+            return false;
+        }
+        return true;
+    }
+}
+
+Dither::RowDitherer::RowDitherer(Mode mode, uint16_t width, Palette palette)
+    : mode_(mode), width_(width), palette_(palette),
+      terms_(palette == Palette::ACEP7 ? 3 : (palette == Palette::GRAY4 ? 1 : 2)), y_(0)
+{
+    if (mode_ == Mode::FLOYD_STEINBERG || mode_ == Mode::ATKINSON) {
+        size_t terms = ERROR_ROWS * (width_ + 2 * PAD) * terms_;
+        errors_ = SlideArena::makeArray<int16_t>(terms);
+        if (errors_) {
+            memset(errors_.get(), 0, terms * sizeof(int16_t));
+        }
+    }
+}
+
+bool Dither::RowDitherer::ok() const
+{
+    return errors_ != nullptr ||
+           (mode_ != Mode::FLOYD_STEINBERG && mode_ != Mode::ATKINSON);
+}
+
+int16_t* Dither::RowDitherer::errorRow(size_t ahead)
+{
+    size_t index = (y_ + ahead) % ERROR_ROWS;
+    // Point at column 0; columns -PAD..-1 and width..width+PAD-1 absorb the
+    // error pushed past the edges
+    return errors_.get() + (index * (width_ + 2 * PAD) + PAD) * terms_;
+}
+
+void Dither::RowDitherer::processRow(const uint8_t* rgb, uint8_t* colors)
+{
+    if (mode_ == Mode::NONE || !ok()) {
+        for (uint16_t x = 0; x < width_; x++) {
+            colors[x] = inkFor(palette_, rgb[x * 3], rgb[x * 3 + 1], rgb[x * 3 + 2]);
+        }
+        y_++;
+        return;
+    }
+    if (mode_ == Mode::BLUE_NOISE) {
+        processBlueNoiseRow(rgb, colors);
+        return;
+    }
+    if (palette_ == Palette::ACEP7) {
+        processAcepRow(rgb, colors);
+        return;
+    }
+    if (palette_ == Palette::GRAY4) {
+        processGrayRow(rgb, colors);
+        return;
+    }
+
+    if (mode_ == Mode::BAYER) {
+        const uint8_t* thresholds = BAYER4[rowY_ & 3];
+        for (uint16_t x = 0; x < width_; x++) {
+            int32_t y, cr;
+            toLumaChroma(&rgb[x * 3], y, cr);
+            // Offset -120..+120 on luma only, centered so flat areas average
+            // to the input; chroma is left alone so blacks never pick up red
+            int32_t offset = (thresholds[(x_ + x) & 3] * 2 - 15) * 8;
+            colors[x] = nearestInk(y + offset, cr).color;
+        }
+        rowY_++;
+        y_++;
+        return;
+    }
+
+    int16_t* cur = errorRow(0);
+    int16_t* next = errorRow(1);
+    int16_t* after = errorRow(2);
+
+    for (int32_t x = 0; x < width_; x++) {
+        int32_t y, cr;
+        toLumaChroma(&rgb[x * 3], y, cr);
+
+        // Clamp to the ink hull so accumulated error can't run away
+        int32_t vy = clamp(y + cur[x * 2], 0, 255);
+        int32_t vcr = clamp(cr + cur[x * 2 + 1], -179, 179);
+
+        const Ink& ink = nearestInk(vy, vcr);
+        colors[x] = ink.color;
+
+        int32_t ey = vy - ink.y;
+        int32_t ecr = vcr - ink.cr;
+
+        if (mode_ == Mode::FLOYD_STEINBERG) {
+            spread(&cur[(x + 1) * 2], ey, ecr, 7, 4);
+            spread(&next[(x - 1) * 2], ey, ecr, 3, 4);
+            spread(&next[x * 2], ey, ecr, 5, 4);
+            spread(&next[(x + 1) * 2], ey, ecr, 1, 4);
+        } else {
+            // Atkinson: 1/8 to six neighbours, the remaining 2/8 is dropped
+            spread(&cur[(x + 1) * 2], ey, ecr, 1, 3);
+            spread(&cur[(x + 2) * 2], ey, ecr, 1, 3);
+            spread(&next[(x - 1) * 2], ey, ecr, 1, 3);
+            spread(&next[x * 2], ey, ecr, 1, 3);
+            spread(&next[(x + 1) * 2], ey, ecr, 1, 3);
+            spread(&after[x * 2], ey, ecr, 1, 3);
+        }
+    }
+
+    // The current row's terms are spent; reuse them as the row two ahead
+    memset(cur - PAD * 2, 0, (width_ + 2 * PAD) * 2 * sizeof(int16_t));
+    y_++;
+}
+
+/**
+ * @brief processRow() for the ACeP inks: the same algorithms in RGB
+ */
+void Dither::RowDitherer::processAcepRow(const uint8_t* rgb, uint8_t* colors)
+{
+    if (mode_ == Mode::BAYER) {
+        const uint8_t* thresholds = BAYER4[rowY_ & 3];
+        for (uint16_t x = 0; x < width_; x++) {
+            // Offset -60..+60 on all three channels: a lightness shift that
+            // leaves the hue alone
+            int32_t offset = (thresholds[(x_ + x) & 3] * 2 - 15) * 4;
+            colors[x] = acepInk(clamp(rgb[x * 3] + offset, 0, 255),
+                                clamp(rgb[x * 3 + 1] + offset, 0, 255),
+                                clamp(rgb[x * 3 + 2] + offset, 0, 255));
+        }
+        rowY_++;
+        y_++;
+        return;
+    }
+
+    int16_t* cur = errorRow(0);
+    int16_t* next = errorRow(1);
+    int16_t* after = errorRow(2);
+
+    for (int32_t x = 0; x < width_; x++) {
+        // Clamp to the RGB cube so accumulated error can't run away
+        int32_t v[3];
+        for (int c = 0; c < 3; c++) {
+            v[c] = clamp(rgb[x * 3 + c] + cur[x * 3 + c], 0, 255);
+        }
+
+        uint8_t ink = acepInk(v[0], v[1], v[2]);
+        colors[x] = ink;
+
+        int32_t e[3] = { v[0] - ACEP_INKS[ink][0], v[1] - ACEP_INKS[ink][1],
+                         v[2] - ACEP_INKS[ink][2] };
+
+        if (mode_ == Mode::FLOYD_STEINBERG) {
+            spreadRGB(&cur[(x + 1) * 3], e, 7, 4);
+            spreadRGB(&next[(x - 1) * 3], e, 3, 4);
+            spreadRGB(&next[x * 3], e, 5, 4);
+            spreadRGB(&next[(x + 1) * 3], e, 1, 4);
+        } else {
+            spreadRGB(&cur[(x + 1) * 3], e, 1, 3);
+            spreadRGB(&cur[(x + 2) * 3], e, 1, 3);
+            spreadRGB(&next[(x - 1) * 3], e, 1, 3);
+            spreadRGB(&next[x * 3], e, 1, 3);
+            spreadRGB(&next[(x + 1) * 3], e, 1, 3);
+            spreadRGB(&after[x * 3], e, 1, 3);
+        }
+    }
+
+    memset(cur - PAD * 3, 0, (width_ + 2 * PAD) * 3 * sizeof(int16_t));
+    y_++;
+}
+
+/**
+ * @brief processRow() for the four grays: the same algorithms on luma alone
+ */
+void Dither::RowDitherer::processGrayRow(const uint8_t* rgb, uint8_t* colors)
+{
+    if (mode_ == Mode::BAYER) {
+        const uint8_t* thresholds = BAYER4[rowY_ & 3];
+        for (uint16_t x = 0; x < width_; x++) {
+            int32_t y, cr;
+            toLumaChroma(&rgb[x * 3], y, cr);
+            // Offset -39..+39: just under half a gray step either way
+            int32_t offset = (thresholds[(x_ + x) & 3] * 2 - 15) * GRAY_STEP / 32;
+            colors[x] = GRAY_INKS[grayLevel(clamp(y + offset, 0, 255))];
+        }
+        rowY_++;
+        y_++;
+        return;
+    }
+
+    int16_t* cur = errorRow(0);
+    int16_t* next = errorRow(1);
+    int16_t* after = errorRow(2);
+
+    for (int32_t x = 0; x < width_; x++) {
+        int32_t y, cr;
+        toLumaChroma(&rgb[x * 3], y, cr);
+
+        int32_t v = clamp(y + cur[x], 0, 255);
+        uint8_t level = grayLevel(v);
+        colors[x] = GRAY_INKS[level];
+
+        int32_t ey = v - level * GRAY_STEP;
+
+        if (mode_ == Mode::FLOYD_STEINBERG) {
+            spreadY(&cur[x + 1], ey, 7, 4);
+            spreadY(&next[x - 1], ey, 3, 4);
+            spreadY(&next[x], ey, 5, 4);
+            spreadY(&next[x + 1], ey, 1, 4);
+        } else {
+            spreadY(&cur[x + 1], ey, 1, 3);
+            spreadY(&cur[x + 2], ey, 1, 3);
+            spreadY(&next[x - 1], ey, 1, 3);
+            spreadY(&next[x], ey, 1, 3);
+            spreadY(&next[x + 1], ey, 1, 3);
+            spreadY(&after[x], ey, 1, 3);
+        }
+    }
+
+    memset(cur - PAD, 0, (width_ + 2 * PAD) * sizeof(int16_t));
+    y_++;
+}
+
+/**
+ * @brief processRow() for BLUE_NOISE, any palette: the mask's threshold at
+ *        each pixel's frame position offsets it by as much as Bayer does
+ */
+void Dither::RowDitherer::processBlueNoiseRow(const uint8_t* rgb, uint8_t* colors)
+{
+    const uint8_t* mask = BlueNoise::row(rowY_);
+    constexpr uint32_t WRAP = BlueNoise::SIZE - 1;
+    if (palette_ == Palette::ACEP7) {
+        for (uint16_t x = 0; x < width_; x++) {
+            int32_t offset = (mask[(x_ + x) & WRAP] - 128) * 15 / 32;  // -60..+59
+            colors[x] = acepInk(clamp(rgb[x * 3] + offset, 0, 255),
+                                clamp(rgb[x * 3 + 1] + offset, 0, 255),
+                                clamp(rgb[x * 3 + 2] + offset, 0, 255));
+        }
+    } else if (palette_ == Palette::GRAY4) {
+        for (uint16_t x = 0; x < width_; x++) {
+            int32_t y, cr;
+            toLumaChroma(&rgb[x * 3], y, cr);
+            // -42..+42: a gray step wide, so a flat gray between two levels
+            // mixes them in proportion
+            int32_t offset = (mask[(x_ + x) & WRAP] - 128) * GRAY_STEP / 256;
+            colors[x] = GRAY_INKS[grayLevel(clamp(y + offset, 0, 255))];
+        }
+    } else {
+        for (uint16_t x = 0; x < width_; x++) {
+            int32_t y, cr;
+            toLumaChroma(&rgb[x * 3], y, cr);
+            // Luma only, as for Bayer, so blacks never pick up red
+            int32_t offset = (mask[(x_ + x) & WRAP] - 128) * 15 / 16;  // -120..+119
+            colors[x] = nearestInk(y + offset, cr).color;
+        }
+    }
+    rowY_++;
+    y_++;
+}
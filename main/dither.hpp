@@ -0,0 +1,127 @@
+/**
+ * @file dither.hpp
+ * @brief Row-streaming dithering into the e-ink palettes
+ */
+
+#pragma once
+
+#include "slide_arena.hpp"
+#include <cstdint>
+#include <cstddef>
+
+namespace Dither {
+
+/**
+ * @brief Dithering algorithms
+ */
+enum class Mode : uint8_t {
+    NONE,             // Hard threshold (ImageLoader::rgbToEinkColor)
+    FLOYD_STEINBERG,  // Error diffusion, 7/3/5/1 over two rows
+    ATKINSON,         // Error diffusion, 6/8 of the error over three rows (crisper)
+    BAYER,            // Ordered 4x4 threshold map, no state between rows
+    BLUE_NOISE        // Tiled blue-noise threshold mask, keyed by frame position
+};
+
+/**
+ * @brief Ink sets rows are quantized to
+ */
+enum class Palette : uint8_t {
+    TRICOLOR,  // EPD_WHITE, EPD_BLACK, EPD_RED: the ThinkInk tricolor panels
+    ACEP7,     // ACEP_COLOR_BLACK .. ACEP_COLOR_ORANGE (0-6): 7-color ACeP panels
+    GRAY4      // EPD_WHITE, EPD_LIGHT, EPD_DARK, EPD_BLACK: THINKINK_GRAYSCALE4
+};
+
+/**
+ * @brief Nearest ink of a palette, without dithering
+ *
+ * TRICOLOR is ImageLoader::rgbToEinkColor(). ACEP7 looks the color up in a
+ * compile-time RGB555 table of the nearest measured ACeP ink (16 KB, flash).
+ * GRAY4 rounds luma to the nearest of four even steps (0, 85, 170, 255).
+ */
+uint8_t inkFor(Palette palette, uint8_t r, uint8_t g, uint8_t b);
+
+/**
+ * @brief Check whether a color is exactly one of a palette's inks
+ *
+ * Images drawn in the panel's own inks (indexed PNGs) skip dithering.
+ *
+ * @param ink Set to the ink on a match
+ */
+bool exactInk(Palette palette, const uint8_t* rgb, uint8_t& ink);
+
+/**
+ * @brief Quantizes RGB rows to a palette's inks, one row at a time
+ *
+ * Tricolor pixels are compared in a luma / red-chroma plane (Y, Cr = R - Y),
+ * where the three inks sit far apart and neutral grays never land nearest
+ * to red, so red only appears in warm areas. ACeP pixels are matched in RGB
+ * against the inks as the panel actually shows them, through the
+ * inkFor() table, and carry an R, G, B error term each. Grayscale pixels
+ * carry only a luma error term. Rows must be
+ * fed in order, top to bottom or bottom to top (the error then flows
+ * upwards). All math is integer; error diffusion keeps only the
+ * error terms of the rows still ahead (current + 1 for Floyd-Steinberg,
+ * + 2 for Atkinson), so memory scales with row width, not image size.
+ *
+ * BAYER and BLUE_NOISE keep no state at all: each pixel is offset by the
+ * threshold BAYER4 or BlueNoise::MASK holds for its frame position
+ * (setPosition()), so rows may come in any order and bands, collage tiles
+ * or row halves dithered apart join without seams. Blue noise comes close
+ * to Floyd-Steinberg's look.
+ */
+class RowDitherer {
+public:
+    /**
+     * @brief Create a ditherer for rows of a fixed width
+     * @param mode Dithering algorithm
+     * @param width Pixels per row
+     * @param palette Inks to quantize to
+     */
+    RowDitherer(Mode mode, uint16_t width, Palette palette = Palette::TRICOLOR);
+
+    RowDitherer(const RowDitherer&) = delete;
+    RowDitherer& operator=(const RowDitherer&) = delete;
+
+    /**
+     * @brief Check that the error rows could be allocated
+     * @return false if an error-diffusion mode is out of memory
+     */
+    bool ok() const;
+
+    /**
+     * @brief Quantize the next row
+     * @param rgb width pixels as R, G, B byte triplets
+     * @param colors Output, width inks of the palette
+     */
+    void processRow(const uint8_t* rgb, uint8_t* colors);
+
+    /**
+     * @brief Frame position of the next row's first pixel, for BAYER and
+     *        BLUE_NOISE; rows count on from it. Without it rows start at (0, 0)
+     */
+    void setPosition(uint32_t x, uint32_t y)
+    {
+        x_ = x;
+        rowY_ = y;
+    }
+
+private:
+    static constexpr size_t ERROR_ROWS = 3;
+    static constexpr int32_t PAD = 2;  // Error columns left/right of the row
+
+    int16_t* errorRow(size_t ahead);
+    void processAcepRow(const uint8_t* rgb, uint8_t* colors);
+    void processGrayRow(const uint8_t* rgb, uint8_t* colors);
+    void processBlueNoiseRow(const uint8_t* rgb, uint8_t* colors);
+
+    Mode mode_;
+    uint16_t width_;
+    Palette palette_;
+    uint8_t terms_;  // Error terms per pixel: {Y, Cr}, {R, G, B} or {Y}
+    uint32_t y_;
+    uint32_t x_ = 0;     // Frame position of the next row (BAYER, BLUE_NOISE)
+    uint32_t rowY_ = 0;
+    SlideArena::Ptr<int16_t[]> errors_;  // ERROR_ROWS rows of (width + 2 * PAD) x terms_
+};
+
+} // namespace Dither
@@ -0,0 +1,102 @@
+/**
+ * @file dither_pool.cpp
+ * @brief Two-core stripe runner implementation
+ */
+
+#include "dither_pool.hpp"
+#include "config.hpp"
+#include "image_decode.hpp"
+#include "stripe_queue.hpp"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <atomic>
+
+static const char* TAG_POOL = "DitherPool";
+
+// A job is OPEN until the helper joins it or the caller, done first,
+// closes it; only a helper that joined signals s_done
+enum class JobState : uint8_t { CLOSED, OPEN, JOINED };
+
+static TaskHandle_t s_task = nullptr;
+static SemaphoreHandle_t s_start = nullptr;
+static SemaphoreHandle_t s_done = nullptr;
+static StripeQueue s_queue;
+static std::atomic<JobState> s_state{JobState::CLOSED};
+static void (*s_work)(void* ctx, size_t index) = nullptr;
+static void* s_ctx = nullptr;
+
+static void drain(size_t worker)
+{
+    uint16_t index;
+    while (s_queue.next(worker, index)) {
+        s_work(s_ctx, index);
+    }
+}
+
+static void helperTask(void*)
+{
+    for (;;) {
+        xSemaphoreTake(s_start, portMAX_DELAY);
+        // A start given for a job the caller already finished alone finds
+        // it closed (or finds the next one open, which is as good)
+        JobState open = JobState::OPEN;
+        if (!s_state.compare_exchange_strong(open, JobState::JOINED,
+                                             std::memory_order_acq_rel)) {
+            continue;
+        }
+        drain(1);
+        xSemaphoreGive(s_done);
+    }
+}
+
+/**
+ * @brief ImageDecode::StripeRunner on the decoding task and the helper
+ */
+static void runStripes(size_t count, void (*work)(void* ctx, size_t index), void* ctx)
+{
+    s_work = work;
+    s_ctx = ctx;
+    s_queue.reset(static_cast<uint16_t>(count));
+    s_state.store(JobState::OPEN, std::memory_order_release);
+    xSemaphoreGive(s_start);
+
+    drain(0);
+
+    JobState open = JobState::OPEN;
+    if (!s_state.compare_exchange_strong(open, JobState::CLOSED, std::memory_order_acq_rel)) {
+        // The helper joined: wait for its last stripe
+        xSemaphoreTake(s_done, portMAX_DELAY);
+        s_state.store(JobState::CLOSED, std::memory_order_relaxed);
+    }
+}
+
+bool DitherPool::init()
+{
+#if CONFIG_FREERTOS_UNICORE
+    return false;
+#else
+    if (!DITHER_PARALLEL_ENABLED || !PIPELINE_ENABLED) {
+        return false;
+    }
+    if (s_task) {
+        return true;
+    }
+
+    s_start = xSemaphoreCreateBinary();
+    s_done = xSemaphoreCreateBinary();
+    if (!s_start || !s_done ||
+        xTaskCreatePinnedToCore(helperTask, "dither_pool", DITHER_POOL_TASK_STACK, nullptr,
+                                SLIDESHOW_TASK_PRIORITY, &s_task,
+                                PIPELINE_IO_CORE) != pdPASS) {
+        ESP_LOGW(TAG_POOL, "No helper task, dithering on one core");
+        s_task = nullptr;
+        return false;
+    }
+    ImageDecode::setStripeRunner(runStripes);
+    ESP_LOGI(TAG_POOL, "Helper task on core %d", PIPELINE_IO_CORE);
+    return true;
+#endif
+}
@@ -0,0 +1,25 @@
+/**
+ * @file dither_pool.hpp
+ * @brief The other core's share of dithering
+ *
+ * A helper task pinned to PIPELINE_IO_CORE that works through the stripes
+ * of each ImageDecode::DitherBand together with the decoding task on
+ * PIPELINE_DECODE_CORE (DITHER_PARALLEL_ENABLED). The stripes go through a
+ * StripeQueue: each side starts on its own half and steals from the other's
+ * when done, so when the reader or the panel upload holds the IO core, the
+ * decoding task finishes the band alone instead of waiting for it. Only the
+ * stateless dither modes use it; single-core chips dither inline.
+ */
+
+#pragma once
+
+namespace DitherPool {
+
+/**
+ * @brief Create the helper task and install it as ImageDecode's stripe
+ *        runner (once; later calls do nothing)
+ * @return true if bands will be dithered on two cores
+ */
+bool init();
+
+} // namespace DitherPool
@@ -0,0 +1,78 @@
+/**
+ * @file epd_bench.cpp
+ * @brief On-device benchmark application (APP_TYPE epd_bench)
+ *
+ * Brings up the slideshow hardware and runs every Bench suite once (see
+ * bench.hpp), logging one "BENCH" line per result, so runs of two library
+ * revisions can be diffed, and a pass/fail verdict against the budgets on
+ * the card; then the soak, with BENCH_SOAK_ENABLED. The ui_slideshow
+ * console runs the same suites on demand.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "nvs_flash.h"
+
+#include "config.hpp"
+#include "panel.hpp"
+#include "sd_card.hpp"
+#include "slide_stats.hpp"
+#include "slide_arena.hpp"
+#include "heap_watch.hpp"
+#include "bench.hpp"
+#include "../components/Adafruit_BusIO_ESPIDF/SPI.h"
+#include <cinttypes>
+
+static const char* TAG_BENCH = "EpdBench";
+
+static Display* g_display = nullptr;
+
+static void benchTask(void* arg)
+{
+    (void)arg;
+
+    SlideStats::init();
+    SlideArena::init(SLIDE_ARENA_SIZE);
+    HeapWatch::watchCurrentTask();  // For the soak's allocation counts
+    SPI.begin(SPI_SCK_PIN, SPI_MOSI_PIN, SPI_MISO_PIN);
+    g_display = new Display(EINK_DC_PIN, EINK_RESET_PIN, EINK_CS_PIN, -1, EINK_BUSY_PIN);
+    g_display->setBusyTimeout(EINK_BUSY_TIMEOUT_MS);
+    g_display->setSPIClocks(Panel::active().spiCommandHz, Panel::active().spiDataHz);
+    if (EINK_PANEL_IO_ENABLED) {
+        g_display->usePanelIO(SPI.getHost(), Panel::active().spiDataHz);
+    }
+    g_display->begin(*Panel::active().table);
+    g_display->setRotation(DISPLAY_ROTATION);
+
+    ESP_LOGI(TAG_BENCH, "BENCH %-20s %" PRIu32 " runs, %dx%d, SPI %" PRIu32 " Hz", "config",
+             BENCH_REPEATS, DISPLAY_WIDTH, DISPLAY_HEIGHT, BENCH_SPI_FREQ_HZ);
+
+    SDCard::init();  // Bench skips the SD and BMP suites without a card
+    if (!Bench::run(*g_display, Bench::Suite::ALL)) {
+        ESP_LOGE(TAG_BENCH, "Performance budgets exceeded, see the BENCH lines above");
+    }
+    if (BENCH_SOAK_ENABLED && !Bench::run(*g_display, Bench::Suite::SOAK)) {
+        ESP_LOGE(TAG_BENCH, "Soak drifted or missed a budget, see the BENCH lines above");
+    }
+
+    vTaskDelete(nullptr);
+}
+
+extern "C" void app_main(void)
+{
+    ESP_LOGI(TAG_BENCH, "E-Ink Benchmark Starting...");
+
+    // NVS holds the SD card clock learned by the slideshow
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        nvs_flash_erase();
+        ret = nvs_flash_init();
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG_BENCH, "NVS unavailable: %s", esp_err_to_name(ret));
+    }
+
+    // The decoders need the same stack as the slideshow task
+    xTaskCreate(benchTask, "epd_bench", 8192, nullptr, 5, nullptr);
+}
@@ -0,0 +1,336 @@
+/**
+ * @file flash_pack.cpp
+ * @brief Flash partition image pack implementation
+ */
+
+#include "flash_pack.hpp"
+#include "config.hpp"
+#include "sd_card.hpp"
+#include "panel.hpp"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <vector>
+
+static const char* TAG_FLASH = "FlashPack";
+
+static const esp_partition_t* s_partition = nullptr;
+static esp_partition_mmap_handle_t s_mapping = 0;
+static const uint8_t* s_base = nullptr;  // Partition start, while mapped
+static const SDCard::ImagePackEntry* s_entries = nullptr;  // Into the mapping, or s_selected
+static size_t s_count = 0;
+static std::vector<SDCard::ImagePackEntry> s_selected;  // This panel's variants, if the pack has several
+static const uint8_t* s_thumbs = nullptr;  // Thumbnail table, nullptr without one
+static uint8_t s_thumbWidth = 0;
+static uint8_t s_thumbHeight = 0;
+
+static const esp_partition_t* findPartition()
+{
+    if (!s_partition) {
+        s_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                               ESP_PARTITION_SUBTYPE_ANY, FLASH_PACK_PARTITION);
+    }
+    return s_partition;
+}
+
+/**
+ * @brief Check a mapped pack's header and table against the partition size
+ * @return Number of table entries (slides x variants), 0 if the pack is invalid
+ */
+static size_t checkPack(const uint8_t* base, uint32_t size)
+{
+    SDCard::ImagePackHeader header;
+    memcpy(&header, base, sizeof(header));
+    bool ok = SDCard::imagePackHeaderValid(header) &&
+              header.indexOffset + uint64_t(header.entryCount) * sizeof(SDCard::ImagePackEntry) <= size;
+    if (!ok) {
+        return 0;
+    }
+    auto entries = reinterpret_cast<const SDCard::ImagePackEntry*>(base + header.indexOffset);
+    for (size_t i = 0; i < header.entryCount; i++) {
+        // frame() hands out whole frames; delta packs are read from the card
+        if (uint64_t(entries[i].offset) + entries[i].length > size ||
+            entries[i].format == SDCard::IMAGE_PACK_FORMAT_DELTA) {
+            return 0;
+        }
+    }
+    return header.entryCount;
+}
+
+bool FlashPack::open()
+{
+    close();
+
+    const esp_partition_t* partition = findPartition();
+    if (!partition) {
+        ESP_LOGI(TAG_FLASH, "No \"%s\" partition", FLASH_PACK_PARTITION);
+        return false;
+    }
+    if (partition->size < sizeof(SDCard::ImagePackHeader)) {
+        return false;
+    }
+
+    const void* mapped = nullptr;
+    esp_err_t err = esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA,
+                                       &mapped, &s_mapping);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG_FLASH, "Cannot map the slides partition: %s", esp_err_to_name(err));
+        return false;
+    }
+
+    s_base = static_cast<const uint8_t*>(mapped);
+    s_count = checkPack(s_base, partition->size);
+    if (s_count == 0) {
+        ESP_LOGI(TAG_FLASH, "No image pack in flash");
+        close();
+        return false;
+    }
+    SDCard::ImagePackHeader header;
+    memcpy(&header, s_base, sizeof(header));
+    s_entries = reinterpret_cast<const SDCard::ImagePackEntry*>(s_base + header.indexOffset);
+    if (SDCard::imagePackVariants(header) > 1) {
+        // Only this panel's entries, copied out of the mapping (16 bytes a slide)
+        s_selected.assign(s_entries, s_entries + s_count);
+        SDCard::selectImagePackVariants(header, s_selected, Panel::active().id);
+        s_entries = s_selected.data();
+        s_count = s_selected.size();
+    }
+    size_t thumbBytes = SDCard::imagePackThumbBytes(header);
+    if (thumbBytes != 0 &&
+        SDCard::imagePackThumbOffset(header) + uint64_t(s_count) * thumbBytes <= partition->size) {
+        s_thumbs = s_base + SDCard::imagePackThumbOffset(header);
+        s_thumbWidth = header.thumbWidth;
+        s_thumbHeight = header.thumbHeight;
+    }
+    ESP_LOGI(TAG_FLASH, "Image pack in flash: %zu images, thumbnails %ux%u",
+             s_count, s_thumbWidth, s_thumbHeight);
+    return true;
+}
+
+void FlashPack::close()
+{
+    if (s_base) {
+        esp_partition_munmap(s_mapping);
+    }
+    s_mapping = 0;
+    s_base = nullptr;
+    s_entries = nullptr;
+    s_count = 0;
+    std::vector<SDCard::ImagePackEntry>().swap(s_selected);
+    s_thumbs = nullptr;
+    s_thumbWidth = s_thumbHeight = 0;
+}
+
+bool FlashPack::isOpen()
+{
+    return s_base != nullptr;
+}
+
+size_t FlashPack::size()
+{
+    return s_count;
+}
+
+const SDCard::ImagePackEntry& FlashPack::entry(size_t index)
+{
+    return s_entries[index];
+}
+
+const uint8_t* FlashPack::frame(size_t index, size_t& length)
+{
+    if (index >= s_count || s_entries[index].format != SDCard::IMAGE_PACK_FORMAT_EPD) {
+        return nullptr;
+    }
+    length = s_entries[index].length;
+    return s_base + s_entries[index].offset;
+}
+
+const uint8_t* FlashPack::thumbnail(size_t index, uint8_t& width, uint8_t& height)
+{
+    if (!s_thumbs || index >= s_count) {
+        return nullptr;
+    }
+    width = s_thumbWidth;
+    height = s_thumbHeight;
+    return s_thumbs + index * ((s_thumbWidth + 7) / 8 * size_t(s_thumbHeight));
+}
+
+uint32_t FlashPack::checksum()
+{
+    uint32_t hash = 2166136261u;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(s_entries);
+    for (size_t i = 0; i < s_count * sizeof(SDCard::ImagePackEntry); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Size and mtime of the card's pack, tied to the table in flash
+ */
+static uint32_t packStamp(int32_t size, int64_t mtime)
+{
+    uint32_t hash = FlashPack::checksum();
+    auto mix = [&hash](const void* data, size_t len) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < len; i++) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+    };
+    mix(&size, sizeof(size));
+    mix(&mtime, sizeof(mtime));
+    return hash;
+}
+
+static bool loadStamp(uint32_t& stamp)
+{
+    nvs_handle_t handle;
+    if (nvs_open(FLASH_PACK_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return false;
+    }
+    bool ok = nvs_get_u32(handle, "stamp", &stamp) == ESP_OK;
+    nvs_close(handle);
+    return ok;
+}
+
+static void storeStamp(uint32_t stamp)
+{
+    nvs_handle_t handle;
+    if (nvs_open(FLASH_PACK_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        return;
+    }
+    if (nvs_set_u32(handle, "stamp", stamp) != ESP_OK || nvs_commit(handle) != ESP_OK) {
+        ESP_LOGW(TAG_FLASH, "Failed to store the pack stamp");
+    }
+    nvs_close(handle);
+}
+
+/**
+ * @brief Bring the partition in line with the pack file, one erase sector
+ *        at a time
+ *
+ * Sectors that already hold the file's bytes are left alone, so frames the
+ * two packs share at the same offsets cost no erase or write. The magic is
+ * zeroed first (clearing bits needs no erase) and sector 0 goes last, so
+ * until the copy is complete the partition holds no pack.
+ *
+ * @return false on a read or flash error, or if the file doesn't fit
+ */
+static bool copyPack(const char* filepath)
+{
+    const esp_partition_t* partition = findPartition();
+    int32_t fileSize = -1;
+    FILE* file = SDCard::openFile(filepath, &fileSize);
+    if (!file) {
+        return false;
+    }
+    if (fileSize < static_cast<int32_t>(sizeof(SDCard::ImagePackHeader)) ||
+        static_cast<uint32_t>(fileSize) > partition->size) {
+        ESP_LOGE(TAG_FLASH, "%s is %" PRId32 " bytes, the partition holds %" PRIu32,
+                 filepath, fileSize, partition->size);
+        fclose(file);
+        return false;
+    }
+    const uint32_t sector = partition->erase_size;
+    std::unique_ptr<uint8_t[]> buffers(new (std::nothrow) uint8_t[2 * sector]);
+    if (!buffers) {
+        fclose(file);
+        return false;
+    }
+    uint8_t* data = buffers.get();
+    uint8_t* flash = data + sector;
+
+    int64_t start = esp_timer_get_time();
+    uint32_t size = static_cast<uint32_t>(fileSize);
+    uint32_t sectors = (size + sector - 1) / sector;
+    uint32_t written = 0;
+    const uint32_t noMagic = 0;
+    bool ok = esp_partition_write(partition, 0, &noMagic, sizeof(noMagic)) == ESP_OK &&
+              fseek(file, std::min(size, sector), SEEK_SET) == 0;
+    for (uint32_t i = 1; ok && i <= sectors; i++) {
+        // Sector 0, with the header, comes last
+        uint32_t offset = (i == sectors) ? 0 : i * sector;
+        size_t len = std::min<size_t>(sector, size - offset);
+        if (offset == 0) {
+            ok = fseek(file, 0, SEEK_SET) == 0;
+        }
+        {
+            SDCard::BusBurst burst;
+            ok = ok && fread(data, 1, len, file) == len;
+        }
+        if (ok && offset != 0 && esp_partition_read(partition, offset, flash, len) == ESP_OK &&
+            memcmp(data, flash, len) == 0) {
+            continue;
+        }
+        ok = ok && esp_partition_erase_range(partition, offset, sector) == ESP_OK &&
+             esp_partition_write(partition, offset, data, len) == ESP_OK;
+        written++;
+    }
+    fclose(file);
+    if (!ok) {
+        ESP_LOGE(TAG_FLASH, "Failed to copy %s into flash", filepath);
+        return false;
+    }
+    ESP_LOGI(TAG_FLASH, "Mirrored %s into flash: %" PRIu32 " of %" PRIu32 " sectors rewritten in %" PRId64 " ms",
+             filepath, written, sectors, (esp_timer_get_time() - start) / 1000);
+    return true;
+}
+
+/**
+ * @brief Check whether a pack has delta entries, which need the card
+ */
+static bool hasDeltas(SDCard::ImagePack& pack)
+{
+    for (size_t i = 0; i < pack.size(); i++) {
+        if (pack.entry(i).format == SDCard::IMAGE_PACK_FORMAT_DELTA) {
+            return true;
+        }
+    }
+    return false;
+}
+
+FlashPack::SyncResult FlashPack::sync(const char* filepath)
+{
+    if (!findPartition()) {
+        return SyncResult::UNCHANGED;
+    }
+
+    SyncResult result = SyncResult::UNCHANGED;
+    int32_t size = 0;
+    int64_t mtime = 0;
+    uint32_t stamp = 0;
+    bool onCard = SDCard::getFileInfo(filepath, size, mtime);
+    bool current = onCard && isOpen() && loadStamp(stamp) && stamp == packStamp(size, mtime);
+    bool checked = false;
+    if (onCard && !current) {
+        SDCard::ImagePack pack;
+        checked = pack.open(filepath, Panel::active().id);
+        if (checked && hasDeltas(pack)) {
+            // Showing the flash copy would hide the card's pack, so leave
+            // the slides to the card and the partition as it is
+            ESP_LOGI(TAG_FLASH, "%s has delta frames, not mirroring it", filepath);
+            close();
+            return SyncResult::UNCHANGED;
+        }
+        if (checked && !(isOpen() && pack.checksum() == checksum())) {
+            pack.close();
+            close();
+            result = copyPack(filepath) ? SyncResult::UPDATED : SyncResult::FAILED;
+        }
+    }
+    if (!isOpen()) {
+        open();
+    }
+    if (checked && result != SyncResult::FAILED && isOpen()) {
+        // Until the card's pack changes, the next sync needs no more than a stat
+        storeStamp(packStamp(size, mtime));
+    }
+    return result;
+}
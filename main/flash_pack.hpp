@@ -0,0 +1,95 @@
+/**
+ * @file flash_pack.hpp
+ * @brief Image pack in a flash data partition, read in place through the
+ *        cache (esp_partition_mmap)
+ *
+ * The partition (FLASH_PACK_PARTITION in partitions.csv) holds an image
+ * pack byte for byte as tools/epd_pack.py writes it: header, entry table,
+ * frames. open() maps it and checks the header and table where they lie, so
+ * nothing is copied to RAM and slides need no SD card, file system or file
+ * handle; frame() hands out pointers into the mapping. sync() mirrors
+ * IMAGE_PACK_FILE in when the card has a different pack, which keeps the
+ * card an optional content source that can stay unmounted otherwise.
+ * Only for one task at a time.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace SDCard { struct ImagePackEntry; }
+
+namespace FlashPack {
+
+/**
+ * @brief Map the partition and check the pack in it
+ * @return false without the partition, or if it holds no valid pack
+ */
+bool open();
+
+/**
+ * @brief Unmap the partition
+ */
+void close();
+
+bool isOpen();
+
+/**
+ * @brief Slides in the pack, 0 when not open
+ */
+size_t size();
+
+/**
+ * @brief Entry table record of a slide, index < size()
+ */
+const SDCard::ImagePackEntry& entry(size_t index);
+
+/**
+ * @brief A slide's .epd frame where it is mapped
+ * @param index Slide index
+ * @param length Output bytes of the frame
+ * @return nullptr if the index is out of range or the entry isn't a frame
+ * @note Valid until close() or sync()
+ */
+const uint8_t* frame(size_t index, size_t& length);
+
+/**
+ * @brief A slide's thumbnail where it is mapped (SDCard::ImagePackHeader
+ *        has the layout)
+ * @param index Slide index
+ * @param width, height Output thumbnail size
+ * @return nullptr if the index is out of range or the pack has none
+ * @note Valid until close() or sync()
+ */
+const uint8_t* thumbnail(size_t index, uint8_t& width, uint8_t& height);
+
+/**
+ * @brief Hash of the entry table, the same as SDCard::ImagePack::checksum()
+ *        gives for the file it was copied from
+ */
+uint32_t checksum();
+
+enum class SyncResult : uint8_t {
+    UNCHANGED,  // No pack on the card, or the same one as in flash
+    UPDATED,    // The card's pack was copied in
+    FAILED      // The copy failed; the partition keeps the old pack only if
+                // nothing was erased yet
+};
+
+/**
+ * @brief Mirror a pack file into the partition if its table differs, then
+ *        (re)open the partition
+ *
+ * A file whose size and mtime match the stamp stored with the last mirror
+ * (NVS, FLASH_PACK_NVS_NAMESPACE) isn't even opened. Otherwise only the
+ * flash sectors whose bytes differ from the file are erased and written.
+ * Pointers from frame() are invalid afterwards. The header's magic is
+ * written last, so a copy cut short by a reset leaves no pack rather than
+ * a broken one.
+ *
+ * @param filepath Pack on the SD card (IMAGE_PACK_FILE)
+ */
+SyncResult sync(const char* filepath);
+
+} // namespace FlashPack
@@ -0,0 +1,461 @@
+/**
+ * @file font_atlas.cpp
+ * @brief Generated by tools/epd_font_atlas.py, do not edit
+ *
+ * classic:1x1 classic:2x2
+ */
+
+#include "font_atlas.hpp"
+
+// classic at text size 1x1: 760 bytes
+static const uint8_t ATLAS_0_BITMAP[] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x20, 0x00,
+    0x50, 0x50, 0x50, 0x00, 0x00, 0x00, 0x00, 0x00, 0x50, 0x50, 0xF8, 0x50, 0xF8, 0x50, 0x50, 0x00,
+    0x20, 0x78, 0xA0, 0x70, 0x28, 0xF0, 0x20, 0x00, 0xC0, 0xC8, 0x10, 0x20, 0x40, 0x98, 0x18, 0x00,
+    0x40, 0xA0, 0xA0, 0x40, 0xA8, 0x90, 0x68, 0x00, 0x30, 0x30, 0x20, 0x40, 0x00, 0x00, 0x00, 0x00,
+    0x10, 0x20, 0x40, 0x40, 0x40, 0x20, 0x10, 0x00, 0x40, 0x20, 0x10, 0x10, 0x10, 0x20, 0x40, 0x00,
+    0x20, 0xA8, 0x70, 0xF8, 0x70, 0xA8, 0x20, 0x00, 0x00, 0x20, 0x20, 0xF8, 0x20, 0x20, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x30, 0x30, 0x20, 0x40, 0x00, 0x00, 0x00, 0xF8, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x30, 0x00, 0x00, 0x08, 0x10, 0x20, 0x40, 0x80, 0x00, 0x00,
+    0x70, 0x88, 0x98, 0xA8, 0xC8, 0x88, 0x70, 0x00, 0x20, 0x60, 0x20, 0x20, 0x20, 0x20, 0x70, 0x00,
+    0x70, 0x88, 0x08, 0x70, 0x80, 0x80, 0xF8, 0x00, 0xF8, 0x08, 0x10, 0x30, 0x08, 0x88, 0x70, 0x00,
+    0x10, 0x30, 0x50, 0x90, 0xF8, 0x10, 0x10, 0x00, 0xF8, 0x80, 0xF0, 0x08, 0x08, 0x88, 0x70, 0x00,
+    0x38, 0x40, 0x80, 0xF0, 0x88, 0x88, 0x70, 0x00, 0xF8, 0x08, 0x08, 0x10, 0x20, 0x40, 0x80, 0x00,
+    0x70, 0x88, 0x88, 0x70, 0x88, 0x88, 0x70, 0x00, 0x70, 0x88, 0x88, 0x78, 0x08, 0x10, 0xE0, 0x00,
+    0x00, 0x00, 0x20, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x00, 0x20, 0x20, 0x40, 0x00,
+    0x08, 0x10, 0x20, 0x40, 0x20, 0x10, 0x08, 0x00, 0x00, 0x00, 0xF8, 0x00, 0xF8, 0x00, 0x00, 0x00,
+    0x40, 0x20, 0x10, 0x08, 0x10, 0x20, 0x40, 0x00, 0x70, 0x88, 0x08, 0x30, 0x20, 0x00, 0x20, 0x00,
+    0x70, 0x88, 0xA8, 0xB8, 0xB0, 0x80, 0x78, 0x00, 0x20, 0x50, 0x88, 0x88, 0xF8, 0x88, 0x88, 0x00,
+    0xF0, 0x88, 0x88, 0xF0, 0x88, 0x88, 0xF0, 0x00, 0x70, 0x88, 0x80, 0x80, 0x80, 0x88, 0x70, 0x00,
+    0xF0, 0x88, 0x88, 0x88, 0x88, 0x88, 0xF0, 0x00, 0xF8, 0x80, 0x80, 0xF0, 0x80, 0x80, 0xF8, 0x00,
+    0xF8, 0x80, 0x80, 0xF0, 0x80, 0x80, 0x80, 0x00, 0x78, 0x88, 0x80, 0x80, 0x98, 0x88, 0x78, 0x00,
+    0x88, 0x88, 0x88, 0xF8, 0x88, 0x88, 0x88, 0x00, 0x70, 0x20, 0x20, 0x20, 0x20, 0x20, 0x70, 0x00,
+    0x38, 0x10, 0x10, 0x10, 0x10, 0x90, 0x60, 0x00, 0x88, 0x90, 0xA0, 0xC0, 0xA0, 0x90, 0x88, 0x00,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0xF8, 0x00, 0x88, 0xD8, 0xA8, 0xA8, 0xA8, 0x88, 0x88, 0x00,
+    0x88, 0x88, 0xC8, 0xA8, 0x98, 0x88, 0x88, 0x00, 0x70, 0x88, 0x88, 0x88, 0x88, 0x88, 0x70, 0x00,
+    0xF0, 0x88, 0x88, 0xF0, 0x80, 0x80, 0x80, 0x00, 0x70, 0x88, 0x88, 0x88, 0xA8, 0x90, 0x68, 0x00,
+    0xF0, 0x88, 0x88, 0xF0, 0xA0, 0x90, 0x88, 0x00, 0x70, 0x88, 0x80, 0x70, 0x08, 0x88, 0x70, 0x00,
+    0xF8, 0xA8, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x70, 0x00,
+    0x88, 0x88, 0x88, 0x88, 0x88, 0x50, 0x20, 0x00, 0x88, 0x88, 0x88, 0xA8, 0xA8, 0xA8, 0x50, 0x00,
+    0x88, 0x88, 0x50, 0x20, 0x50, 0x88, 0x88, 0x00, 0x88, 0x88, 0x50, 0x20, 0x20, 0x20, 0x20, 0x00,
+    0xF8, 0x08, 0x10, 0x70, 0x40, 0x80, 0xF8, 0x00, 0x78, 0x40, 0x40, 0x40, 0x40, 0x40, 0x78, 0x00,
+    0x00, 0x80, 0x40, 0x20, 0x10, 0x08, 0x00, 0x00, 0x78, 0x08, 0x08, 0x08, 0x08, 0x08, 0x78, 0x00,
+    0x20, 0x50, 0x88, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF8, 0x00,
+    0x60, 0x60, 0x20, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x10, 0x70, 0x90, 0x78, 0x00,
+    0x80, 0x80, 0xB0, 0xC8, 0x88, 0xC8, 0xB0, 0x00, 0x00, 0x00, 0x70, 0x88, 0x80, 0x88, 0x70, 0x00,
+    0x08, 0x08, 0x68, 0x98, 0x88, 0x98, 0x68, 0x00, 0x00, 0x00, 0x70, 0x88, 0xF8, 0x80, 0x70, 0x00,
+    0x10, 0x28, 0x20, 0x70, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00, 0x70, 0x98, 0x98, 0x68, 0x08, 0x70,
+    0x80, 0x80, 0xB0, 0xC8, 0x88, 0x88, 0x88, 0x00, 0x20, 0x00, 0x60, 0x20, 0x20, 0x20, 0x70, 0x00,
+    0x10, 0x00, 0x10, 0x10, 0x10, 0x90, 0x60, 0x00, 0x80, 0x80, 0x90, 0xA0, 0xC0, 0xA0, 0x90, 0x00,
+    0x60, 0x20, 0x20, 0x20, 0x20, 0x20, 0x70, 0x00, 0x00, 0x00, 0xD0, 0xA8, 0xA8, 0xA8, 0xA8, 0x00,
+    0x00, 0x00, 0xB0, 0xC8, 0x88, 0x88, 0x88, 0x00, 0x00, 0x00, 0x70, 0x88, 0x88, 0x88, 0x70, 0x00,
+    0x00, 0x00, 0xB0, 0xC8, 0xC8, 0xB0, 0x80, 0x80, 0x00, 0x00, 0x68, 0x98, 0x98, 0x68, 0x08, 0x08,
+    0x00, 0x00, 0xB0, 0xC8, 0x80, 0x80, 0x80, 0x00, 0x00, 0x00, 0x78, 0x80, 0x70, 0x08, 0xF0, 0x00,
+    0x20, 0x20, 0xF8, 0x20, 0x20, 0x28, 0x10, 0x00, 0x00, 0x00, 0x88, 0x88, 0x88, 0x98, 0x68, 0x00,
+    0x00, 0x00, 0x88, 0x88, 0x88, 0x50, 0x20, 0x00, 0x00, 0x00, 0x88, 0x88, 0xA8, 0xA8, 0x50, 0x00,
+    0x00, 0x00, 0x88, 0x50, 0x20, 0x50, 0x88, 0x00, 0x00, 0x00, 0x88, 0x88, 0x78, 0x08, 0x88, 0x70,
+    0x00, 0x00, 0xF8, 0x10, 0x20, 0x40, 0xF8, 0x00, 0x10, 0x20, 0x20, 0x40, 0x20, 0x20, 0x10, 0x00,
+    0x20, 0x20, 0x20, 0x00, 0x20, 0x20, 0x20, 0x00, 0x40, 0x20, 0x20, 0x10, 0x20, 0x20, 0x40, 0x00,
+    0x40, 0xA8, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+static const epd_atlas_glyph_t ATLAS_0_GLYPHS[] = {
+    {0, 5, 8, 0, 0}, // 0x20
+    {8, 5, 8, 0, 0}, // 0x21
+    {16, 5, 8, 0, 0}, // 0x22
+    {24, 5, 8, 0, 0}, // 0x23
+    {32, 5, 8, 0, 0}, // 0x24
+    {40, 5, 8, 0, 0}, // 0x25
+    {48, 5, 8, 0, 0}, // 0x26
+    {56, 5, 8, 0, 0}, // 0x27
+    {64, 5, 8, 0, 0}, // 0x28
+    {72, 5, 8, 0, 0}, // 0x29
+    {80, 5, 8, 0, 0}, // 0x2A
+    {88, 5, 8, 0, 0}, // 0x2B
+    {96, 5, 8, 0, 0}, // 0x2C
+    {104, 5, 8, 0, 0}, // 0x2D
+    {112, 5, 8, 0, 0}, // 0x2E
+    {120, 5, 8, 0, 0}, // 0x2F
+    {128, 5, 8, 0, 0}, // 0x30
+    {136, 5, 8, 0, 0}, // 0x31
+    {144, 5, 8, 0, 0}, // 0x32
+    {152, 5, 8, 0, 0}, // 0x33
+    {160, 5, 8, 0, 0}, // 0x34
+    {168, 5, 8, 0, 0}, // 0x35
+    {176, 5, 8, 0, 0}, // 0x36
+    {184, 5, 8, 0, 0}, // 0x37
+    {192, 5, 8, 0, 0}, // 0x38
+    {200, 5, 8, 0, 0}, // 0x39
+    {208, 5, 8, 0, 0}, // 0x3A
+    {216, 5, 8, 0, 0}, // 0x3B
+    {224, 5, 8, 0, 0}, // 0x3C
+    {232, 5, 8, 0, 0}, // 0x3D
+    {240, 5, 8, 0, 0}, // 0x3E
+    {248, 5, 8, 0, 0}, // 0x3F
+    {256, 5, 8, 0, 0}, // 0x40
+    {264, 5, 8, 0, 0}, // 0x41
+    {272, 5, 8, 0, 0}, // 0x42
+    {280, 5, 8, 0, 0}, // 0x43
+    {288, 5, 8, 0, 0}, // 0x44
+    {296, 5, 8, 0, 0}, // 0x45
+    {304, 5, 8, 0, 0}, // 0x46
+    {312, 5, 8, 0, 0}, // 0x47
+    {320, 5, 8, 0, 0}, // 0x48
+    {328, 5, 8, 0, 0}, // 0x49
+    {336, 5, 8, 0, 0}, // 0x4A
+    {344, 5, 8, 0, 0}, // 0x4B
+    {352, 5, 8, 0, 0}, // 0x4C
+    {360, 5, 8, 0, 0}, // 0x4D
+    {368, 5, 8, 0, 0}, // 0x4E
+    {376, 5, 8, 0, 0}, // 0x4F
+    {384, 5, 8, 0, 0}, // 0x50
+    {392, 5, 8, 0, 0}, // 0x51
+    {400, 5, 8, 0, 0}, // 0x52
+    {408, 5, 8, 0, 0}, // 0x53
+    {416, 5, 8, 0, 0}, // 0x54
+    {424, 5, 8, 0, 0}, // 0x55
+    {432, 5, 8, 0, 0}, // 0x56
+    {440, 5, 8, 0, 0}, // 0x57
+    {448, 5, 8, 0, 0}, // 0x58
+    {456, 5, 8, 0, 0}, // 0x59
+    {464, 5, 8, 0, 0}, // 0x5A
+    {472, 5, 8, 0, 0}, // 0x5B
+    {480, 5, 8, 0, 0}, // 0x5C
+    {488, 5, 8, 0, 0}, // 0x5D
+    {496, 5, 8, 0, 0}, // 0x5E
+    {504, 5, 8, 0, 0}, // 0x5F
+    {512, 5, 8, 0, 0}, // 0x60
+    {520, 5, 8, 0, 0}, // 0x61
+    {528, 5, 8, 0, 0}, // 0x62
+    {536, 5, 8, 0, 0}, // 0x63
+    {544, 5, 8, 0, 0}, // 0x64
+    {552, 5, 8, 0, 0}, // 0x65
+    {560, 5, 8, 0, 0}, // 0x66
+    {568, 5, 8, 0, 0}, // 0x67
+    {576, 5, 8, 0, 0}, // 0x68
+    {584, 5, 8, 0, 0}, // 0x69
+    {592, 5, 8, 0, 0}, // 0x6A
+    {600, 5, 8, 0, 0}, // 0x6B
+    {608, 5, 8, 0, 0}, // 0x6C
+    {616, 5, 8, 0, 0}, // 0x6D
+    {624, 5, 8, 0, 0}, // 0x6E
+    {632, 5, 8, 0, 0}, // 0x6F
+    {640, 5, 8, 0, 0}, // 0x70
+    {648, 5, 8, 0, 0}, // 0x71
+    {656, 5, 8, 0, 0}, // 0x72
+    {664, 5, 8, 0, 0}, // 0x73
+    {672, 5, 8, 0, 0}, // 0x74
+    {680, 5, 8, 0, 0}, // 0x75
+    {688, 5, 8, 0, 0}, // 0x76
+    {696, 5, 8, 0, 0}, // 0x77
+    {704, 5, 8, 0, 0}, // 0x78
+    {712, 5, 8, 0, 0}, // 0x79
+    {720, 5, 8, 0, 0}, // 0x7A
+    {728, 5, 8, 0, 0}, // 0x7B
+    {736, 5, 8, 0, 0}, // 0x7C
+    {744, 5, 8, 0, 0}, // 0x7D
+    {752, 5, 8, 0, 0}, // 0x7E
+};
+static const epd_font_atlas_t ATLAS_0 = {
+    0x00000000, 1, 1, 0x20, 0x7E, ATLAS_0_GLYPHS, ATLAS_0_BITMAP,
+};
+
+// classic at text size 2x2: 3040 bytes
+static const uint8_t ATLAS_1_BITMAP[] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x33, 0x00, 0x33, 0x00, 0x33, 0x00, 0x33, 0x00, 0x33, 0x00, 0x33, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x33, 0x00, 0x33, 0x00, 0x33, 0x00, 0x33, 0x00, 0xFF, 0xC0, 0xFF, 0xC0, 0x33, 0x00, 0x33, 0x00,
+    0xFF, 0xC0, 0xFF, 0xC0, 0x33, 0x00, 0x33, 0x00, 0x33, 0x00, 0x33, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x3F, 0xC0, 0x3F, 0xC0, 0xCC, 0x00, 0xCC, 0x00, 0x3F, 0x00, 0x3F, 0x00,
+    0x0C, 0xC0, 0x0C, 0xC0, 0xFF, 0x00, 0xFF, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xF0, 0x00, 0xF0, 0x00, 0xF0, 0xC0, 0xF0, 0xC0, 0x03, 0x00, 0x03, 0x00, 0x0C, 0x00, 0x0C, 0x00,
+    0x30, 0x00, 0x30, 0x00, 0xC3, 0xC0, 0xC3, 0xC0, 0x03, 0xC0, 0x03, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0x30, 0x00, 0x30, 0x00, 0xCC, 0x00, 0xCC, 0x00, 0xCC, 0x00, 0xCC, 0x00, 0x30, 0x00, 0x30, 0x00,
+    0xCC, 0xC0, 0xCC, 0xC0, 0xC3, 0x00, 0xC3, 0x00, 0x3C, 0xC0, 0x3C, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0x0F, 0x00, 0x0F, 0x00, 0x0F, 0x00, 0x0F, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x30, 0x00, 0x30, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x03, 0x00, 0x03, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x30, 0x00, 0x30, 0x00, 0x30, 0x00, 0x30, 0x00,
+    0x30, 0x00, 0x30, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x03, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x30, 0x00, 0x30, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x03, 0x00, 0x03, 0x00, 0x03, 0x00, 0x03, 0x00,
+    0x03, 0x00, 0x03, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x30, 0x00, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0xCC, 0xC0, 0xCC, 0xC0, 0x3F, 0x00, 0x3F, 0x00, 0xFF, 0xC0, 0xFF, 0xC0,
+    0x3F, 0x00, 0x3F, 0x00, 0xCC, 0xC0, 0xCC, 0xC0, 0x0C, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0xFF, 0xC0, 0xFF, 0xC0,
+    0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x0F, 0x00, 0x0F, 0x00, 0x0F, 0x00, 0x0F, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x30, 0x00, 0x30, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xC0, 0xFF, 0xC0,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x0F, 0x00, 0x0F, 0x00, 0x0F, 0x00, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x00, 0xC0, 0x03, 0x00, 0x03, 0x00, 0x0C, 0x00, 0x0C, 0x00,
+    0x30, 0x00, 0x30, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x3F, 0x00, 0x3F, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xC0, 0xC3, 0xC0, 0xCC, 0xC0, 0xCC, 0xC0,
+    0xF0, 0xC0, 0xF0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x3F, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x3C, 0x00, 0x3C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x3F, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x3F, 0x00, 0x3F, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x3F, 0x00, 0x3F, 0x00,
+    0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xFF, 0xC0, 0xFF, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0xFF, 0xC0, 0xFF, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x03, 0x00, 0x03, 0x00, 0x0F, 0x00, 0x0F, 0x00,
+    0x00, 0xC0, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x3F, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x03, 0x00, 0x03, 0x00, 0x0F, 0x00, 0x0F, 0x00, 0x33, 0x00, 0x33, 0x00, 0xC3, 0x00, 0xC3, 0x00,
+    0xFF, 0xC0, 0xFF, 0xC0, 0x03, 0x00, 0x03, 0x00, 0x03, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xFF, 0xC0, 0xFF, 0xC0, 0xC0, 0x00, 0xC0, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0x00, 0xC0, 0x00, 0xC0,
+    0x00, 0xC0, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x3F, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x0F, 0xC0, 0x0F, 0xC0, 0x30, 0x00, 0x30, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xFF, 0x00, 0xFF, 0x00,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x3F, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xFF, 0xC0, 0xFF, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x03, 0x00, 0x03, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x30, 0x00, 0x30, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x3F, 0x00, 0x3F, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x3F, 0x00, 0x3F, 0x00,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x3F, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x3F, 0x00, 0x3F, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x3F, 0xC0, 0x3F, 0xC0,
+    0x00, 0xC0, 0x00, 0xC0, 0x03, 0x00, 0x03, 0x00, 0xFC, 0x00, 0xFC, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x30, 0x00, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0xC0, 0x00, 0xC0, 0x03, 0x00, 0x03, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x30, 0x00, 0x30, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x03, 0x00, 0x03, 0x00, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xC0, 0xFF, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0xFF, 0xC0, 0xFF, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x30, 0x00, 0x30, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x03, 0x00, 0x03, 0x00, 0x00, 0xC0, 0x00, 0xC0,
+    0x03, 0x00, 0x03, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x30, 0x00, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x3F, 0x00, 0x3F, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x0F, 0x00, 0x0F, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x3F, 0x00, 0x3F, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xCC, 0xC0, 0xCC, 0xC0, 0xCF, 0xC0, 0xCF, 0xC0,
+    0xCF, 0x00, 0xCF, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0x3F, 0xC0, 0x3F, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x33, 0x00, 0x33, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0,
+    0xFF, 0xC0, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0xFF, 0x00, 0xFF, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xFF, 0x00, 0xFF, 0x00,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xFF, 0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x3F, 0x00, 0x3F, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00,
+    0xC0, 0x00, 0xC0, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0x3F, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xFF, 0x00, 0xFF, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xFF, 0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xFF, 0xC0, 0xFF, 0xC0, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xFF, 0x00, 0xFF, 0x00,
+    0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xFF, 0xC0, 0xFF, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0xFF, 0xC0, 0xFF, 0xC0, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xFF, 0x00, 0xFF, 0x00,
+    0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x3F, 0xC0, 0x3F, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00,
+    0xC3, 0xC0, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x3F, 0xC0, 0x3F, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xFF, 0xC0, 0xFF, 0xC0,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0x3F, 0x00, 0x3F, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x3F, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x0F, 0xC0, 0x0F, 0xC0, 0x03, 0x00, 0x03, 0x00, 0x03, 0x00, 0x03, 0x00, 0x03, 0x00, 0x03, 0x00,
+    0x03, 0x00, 0x03, 0x00, 0xC3, 0x00, 0xC3, 0x00, 0x3C, 0x00, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0x00, 0xC3, 0x00, 0xCC, 0x00, 0xCC, 0x00, 0xF0, 0x00, 0xF0, 0x00,
+    0xCC, 0x00, 0xCC, 0x00, 0xC3, 0x00, 0xC3, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00,
+    0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xFF, 0xC0, 0xFF, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xF3, 0xC0, 0xF3, 0xC0, 0xCC, 0xC0, 0xCC, 0xC0, 0xCC, 0xC0, 0xCC, 0xC0,
+    0xCC, 0xC0, 0xCC, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xF0, 0xC0, 0xF0, 0xC0, 0xCC, 0xC0, 0xCC, 0xC0,
+    0xC3, 0xC0, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0x3F, 0x00, 0x3F, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x3F, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xFF, 0x00, 0xFF, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xFF, 0x00, 0xFF, 0x00,
+    0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x3F, 0x00, 0x3F, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0,
+    0xCC, 0xC0, 0xCC, 0xC0, 0xC3, 0x00, 0xC3, 0x00, 0x3C, 0xC0, 0x3C, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0xFF, 0x00, 0xFF, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xFF, 0x00, 0xFF, 0x00,
+    0xCC, 0x00, 0xCC, 0x00, 0xC3, 0x00, 0xC3, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0x3F, 0x00, 0x3F, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0xC0, 0x00, 0x3F, 0x00, 0x3F, 0x00,
+    0x00, 0xC0, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x3F, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xFF, 0xC0, 0xFF, 0xC0, 0xCC, 0xC0, 0xCC, 0xC0, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x3F, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0,
+    0xC0, 0xC0, 0xC0, 0xC0, 0x33, 0x00, 0x33, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xCC, 0xC0, 0xCC, 0xC0,
+    0xCC, 0xC0, 0xCC, 0xC0, 0xCC, 0xC0, 0xCC, 0xC0, 0x33, 0x00, 0x33, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x33, 0x00, 0x33, 0x00, 0x0C, 0x00, 0x0C, 0x00,
+    0x33, 0x00, 0x33, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x33, 0x00, 0x33, 0x00, 0x0C, 0x00, 0x0C, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xFF, 0xC0, 0xFF, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x03, 0x00, 0x03, 0x00, 0x3F, 0x00, 0x3F, 0x00,
+    0x30, 0x00, 0x30, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xFF, 0xC0, 0xFF, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0x3F, 0xC0, 0x3F, 0xC0, 0x30, 0x00, 0x30, 0x00, 0x30, 0x00, 0x30, 0x00, 0x30, 0x00, 0x30, 0x00,
+    0x30, 0x00, 0x30, 0x00, 0x30, 0x00, 0x30, 0x00, 0x3F, 0xC0, 0x3F, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0x30, 0x00, 0x30, 0x00, 0x0C, 0x00, 0x0C, 0x00,
+    0x03, 0x00, 0x03, 0x00, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x3F, 0xC0, 0x3F, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0,
+    0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x3F, 0xC0, 0x3F, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x33, 0x00, 0x33, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xC0, 0xFF, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0x3C, 0x00, 0x3C, 0x00, 0x3C, 0x00, 0x3C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x03, 0x00, 0x03, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3C, 0x00, 0x3C, 0x00, 0x03, 0x00, 0x03, 0x00,
+    0x3F, 0x00, 0x3F, 0x00, 0xC3, 0x00, 0xC3, 0x00, 0x3F, 0xC0, 0x3F, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xCF, 0x00, 0xCF, 0x00, 0xF0, 0xC0, 0xF0, 0xC0,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xF0, 0xC0, 0xF0, 0xC0, 0xCF, 0x00, 0xCF, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x00, 0x3F, 0x00, 0xC0, 0xC0, 0xC0, 0xC0,
+    0xC0, 0x00, 0xC0, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0x3F, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x3C, 0xC0, 0x3C, 0xC0, 0xC3, 0xC0, 0xC3, 0xC0,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xC0, 0xC3, 0xC0, 0x3C, 0xC0, 0x3C, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x00, 0x3F, 0x00, 0xC0, 0xC0, 0xC0, 0xC0,
+    0xFF, 0xC0, 0xFF, 0xC0, 0xC0, 0x00, 0xC0, 0x00, 0x3F, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x03, 0x00, 0x03, 0x00, 0x0C, 0xC0, 0x0C, 0xC0, 0x0C, 0x00, 0x0C, 0x00, 0x3F, 0x00, 0x3F, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x00, 0x3F, 0x00, 0xC3, 0xC0, 0xC3, 0xC0,
+    0xC3, 0xC0, 0xC3, 0xC0, 0x3C, 0xC0, 0x3C, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x3F, 0x00, 0x3F, 0x00,
+    0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xCF, 0x00, 0xCF, 0x00, 0xF0, 0xC0, 0xF0, 0xC0,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3C, 0x00, 0x3C, 0x00, 0x0C, 0x00, 0x0C, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x3F, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x03, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x03, 0x00, 0x03, 0x00, 0x03, 0x00,
+    0x03, 0x00, 0x03, 0x00, 0xC3, 0x00, 0xC3, 0x00, 0x3C, 0x00, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC3, 0x00, 0xC3, 0x00, 0xCC, 0x00, 0xCC, 0x00,
+    0xF0, 0x00, 0xF0, 0x00, 0xCC, 0x00, 0xCC, 0x00, 0xC3, 0x00, 0xC3, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x3C, 0x00, 0x3C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x3F, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF3, 0x00, 0xF3, 0x00, 0xCC, 0xC0, 0xCC, 0xC0,
+    0xCC, 0xC0, 0xCC, 0xC0, 0xCC, 0xC0, 0xCC, 0xC0, 0xCC, 0xC0, 0xCC, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xCF, 0x00, 0xCF, 0x00, 0xF0, 0xC0, 0xF0, 0xC0,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x00, 0x3F, 0x00, 0xC0, 0xC0, 0xC0, 0xC0,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x3F, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xCF, 0x00, 0xCF, 0x00, 0xF0, 0xC0, 0xF0, 0xC0,
+    0xF0, 0xC0, 0xF0, 0xC0, 0xCF, 0x00, 0xCF, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3C, 0xC0, 0x3C, 0xC0, 0xC3, 0xC0, 0xC3, 0xC0,
+    0xC3, 0xC0, 0xC3, 0xC0, 0x3C, 0xC0, 0x3C, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xCF, 0x00, 0xCF, 0x00, 0xF0, 0xC0, 0xF0, 0xC0,
+    0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0xC0, 0x3F, 0xC0, 0xC0, 0x00, 0xC0, 0x00,
+    0x3F, 0x00, 0x3F, 0x00, 0x00, 0xC0, 0x00, 0xC0, 0xFF, 0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0xFF, 0xC0, 0xFF, 0xC0, 0x0C, 0x00, 0x0C, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x0C, 0xC0, 0x0C, 0xC0, 0x03, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0,
+    0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xC0, 0xC3, 0xC0, 0x3C, 0xC0, 0x3C, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0,
+    0xC0, 0xC0, 0xC0, 0xC0, 0x33, 0x00, 0x33, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0,
+    0xCC, 0xC0, 0xCC, 0xC0, 0xCC, 0xC0, 0xCC, 0xC0, 0x33, 0x00, 0x33, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0x33, 0x00, 0x33, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x33, 0x00, 0x33, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0,
+    0x3F, 0xC0, 0x3F, 0xC0, 0x00, 0xC0, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x3F, 0x00, 0x3F, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xC0, 0xFF, 0xC0, 0x03, 0x00, 0x03, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x30, 0x00, 0x30, 0x00, 0xFF, 0xC0, 0xFF, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0x03, 0x00, 0x03, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x30, 0x00, 0x30, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x03, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x30, 0x00, 0x30, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x03, 0x00, 0x03, 0x00,
+    0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x0C, 0x00, 0x30, 0x00, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x30, 0x00, 0x30, 0x00, 0xCC, 0xC0, 0xCC, 0xC0, 0x03, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+static const epd_atlas_glyph_t ATLAS_1_GLYPHS[] = {
+    {0, 10, 16, 0, 0}, // 0x20
+    {32, 10, 16, 0, 0}, // 0x21
+    {64, 10, 16, 0, 0}, // 0x22
+    {96, 10, 16, 0, 0}, // 0x23
+    {128, 10, 16, 0, 0}, // 0x24
+    {160, 10, 16, 0, 0}, // 0x25
+    {192, 10, 16, 0, 0}, // 0x26
+    {224, 10, 16, 0, 0}, // 0x27
+    {256, 10, 16, 0, 0}, // 0x28
+    {288, 10, 16, 0, 0}, // 0x29
+    {320, 10, 16, 0, 0}, // 0x2A
+    {352, 10, 16, 0, 0}, // 0x2B
+    {384, 10, 16, 0, 0}, // 0x2C
+    {416, 10, 16, 0, 0}, // 0x2D
+    {448, 10, 16, 0, 0}, // 0x2E
+    {480, 10, 16, 0, 0}, // 0x2F
+    {512, 10, 16, 0, 0}, // 0x30
+    {544, 10, 16, 0, 0}, // 0x31
+    {576, 10, 16, 0, 0}, // 0x32
+    {608, 10, 16, 0, 0}, // 0x33
+    {640, 10, 16, 0, 0}, // 0x34
+    {672, 10, 16, 0, 0}, // 0x35
+    {704, 10, 16, 0, 0}, // 0x36
+    {736, 10, 16, 0, 0}, // 0x37
+    {768, 10, 16, 0, 0}, // 0x38
+    {800, 10, 16, 0, 0}, // 0x39
+    {832, 10, 16, 0, 0}, // 0x3A
+    {864, 10, 16, 0, 0}, // 0x3B
+    {896, 10, 16, 0, 0}, // 0x3C
+    {928, 10, 16, 0, 0}, // 0x3D
+    {960, 10, 16, 0, 0}, // 0x3E
+    {992, 10, 16, 0, 0}, // 0x3F
+    {1024, 10, 16, 0, 0}, // 0x40
+    {1056, 10, 16, 0, 0}, // 0x41
+    {1088, 10, 16, 0, 0}, // 0x42
+    {1120, 10, 16, 0, 0}, // 0x43
+    {1152, 10, 16, 0, 0}, // 0x44
+    {1184, 10, 16, 0, 0}, // 0x45
+    {1216, 10, 16, 0, 0}, // 0x46
+    {1248, 10, 16, 0, 0}, // 0x47
+    {1280, 10, 16, 0, 0}, // 0x48
+    {1312, 10, 16, 0, 0}, // 0x49
+    {1344, 10, 16, 0, 0}, // 0x4A
+    {1376, 10, 16, 0, 0}, // 0x4B
+    {1408, 10, 16, 0, 0}, // 0x4C
+    {1440, 10, 16, 0, 0}, // 0x4D
+    {1472, 10, 16, 0, 0}, // 0x4E
+    {1504, 10, 16, 0, 0}, // 0x4F
+    {1536, 10, 16, 0, 0}, // 0x50
+    {1568, 10, 16, 0, 0}, // 0x51
+    {1600, 10, 16, 0, 0}, // 0x52
+    {1632, 10, 16, 0, 0}, // 0x53
+    {1664, 10, 16, 0, 0}, // 0x54
+    {1696, 10, 16, 0, 0}, // 0x55
+    {1728, 10, 16, 0, 0}, // 0x56
+    {1760, 10, 16, 0, 0}, // 0x57
+    {1792, 10, 16, 0, 0}, // 0x58
+    {1824, 10, 16, 0, 0}, // 0x59
+    {1856, 10, 16, 0, 0}, // 0x5A
+    {1888, 10, 16, 0, 0}, // 0x5B
+    {1920, 10, 16, 0, 0}, // 0x5C
+    {1952, 10, 16, 0, 0}, // 0x5D
+    {1984, 10, 16, 0, 0}, // 0x5E
+    {2016, 10, 16, 0, 0}, // 0x5F
+    {2048, 10, 16, 0, 0}, // 0x60
+    {2080, 10, 16, 0, 0}, // 0x61
+    {2112, 10, 16, 0, 0}, // 0x62
+    {2144, 10, 16, 0, 0}, // 0x63
+    {2176, 10, 16, 0, 0}, // 0x64
+    {2208, 10, 16, 0, 0}, // 0x65
+    {2240, 10, 16, 0, 0}, // 0x66
+    {2272, 10, 16, 0, 0}, // 0x67
+    {2304, 10, 16, 0, 0}, // 0x68
+    {2336, 10, 16, 0, 0}, // 0x69
+    {2368, 10, 16, 0, 0}, // 0x6A
+    {2400, 10, 16, 0, 0}, // 0x6B
+    {2432, 10, 16, 0, 0}, // 0x6C
+    {2464, 10, 16, 0, 0}, // 0x6D
+    {2496, 10, 16, 0, 0}, // 0x6E
+    {2528, 10, 16, 0, 0}, // 0x6F
+    {2560, 10, 16, 0, 0}, // 0x70
+    {2592, 10, 16, 0, 0}, // 0x71
+    {2624, 10, 16, 0, 0}, // 0x72
+    {2656, 10, 16, 0, 0}, // 0x73
+    {2688, 10, 16, 0, 0}, // 0x74
+    {2720, 10, 16, 0, 0}, // 0x75
+    {2752, 10, 16, 0, 0}, // 0x76
+    {2784, 10, 16, 0, 0}, // 0x77
+    {2816, 10, 16, 0, 0}, // 0x78
+    {2848, 10, 16, 0, 0}, // 0x79
+    {2880, 10, 16, 0, 0}, // 0x7A
+    {2912, 10, 16, 0, 0}, // 0x7B
+    {2944, 10, 16, 0, 0}, // 0x7C
+    {2976, 10, 16, 0, 0}, // 0x7D
+    {3008, 10, 16, 0, 0}, // 0x7E
+};
+static const epd_font_atlas_t ATLAS_1 = {
+    0x00000000, 2, 2, 0x20, 0x7E, ATLAS_1_GLYPHS, ATLAS_1_BITMAP,
+};
+
+const epd_font_atlas_t* const FontAtlas::ATLASES[] = {
+    &ATLAS_0,
+    &ATLAS_1,
+};
+
+const uint8_t FontAtlas::COUNT = 2;
@@ -0,0 +1,31 @@
+/**
+ * @file font_atlas.hpp
+ * @brief Fonts pre-rasterized into flash for the panel's fixed UI text
+ *
+ * font_atlas.cpp is generated by tools/epd_font_atlas.py: the classic font
+ * at the text sizes the slideshow prints at. Handed to the display with
+ * setFontAtlases() (FONT_ATLAS_ENABLED), so that text is blitted a byte at
+ * a time from flash instead of being rasterized into the glyph cache.
+ * Regenerate after changing a text size:
+ *
+ *     tools/epd_font_atlas.py classic:1 classic:2 -o main/font_atlas.cpp
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "../components/Adafruit_EPD/src/Adafruit_EPD.h"
+
+namespace FontAtlas {
+
+/**
+ * @brief The generated atlases
+ */
+extern const epd_font_atlas_t* const ATLASES[];
+
+/**
+ * @brief Number of ATLASES
+ */
+extern const uint8_t COUNT;
+
+} // namespace FontAtlas
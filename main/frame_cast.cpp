@@ -0,0 +1,318 @@
+/**
+ * @file frame_cast.cpp
+ * @brief ESP-NOW frame cast implementation
+ */
+
+#include "frame_cast.hpp"
+#include "slideshow.hpp"
+#include "wifi_radio.hpp"
+#include "esp_log.h"
+#include "esp_now.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "../components/Adafruit_EPD/src/Adafruit_EPD.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <new>
+
+static const char* TAG_CAST = "FrameCast";
+
+static constexpr uint32_t CAST_MAGIC = 0x43445045;  // "EPDC" little-endian
+static constexpr uint8_t TYPE_CHUNK = 1;
+static constexpr uint8_t TYPE_SHOW = 2;
+
+#pragma pack(push, 1)
+struct CastHeader {
+    uint32_t magic;   // CAST_MAGIC
+    uint8_t  type;    // TYPE_*
+    uint8_t  group;   // FRAME_CAST_GROUP
+    uint16_t seq;     // Slide cast number, the same for its chunks and show
+};
+
+struct ChunkMessage {
+    CastHeader header;
+    uint32_t length;  // Frame bytes
+    uint32_t offset;  // Of this chunk's data, which follows
+};
+
+struct ShowMessage {
+    CastHeader header;
+    uint32_t index;         // Slide in the leader's image list
+    uint32_t listChecksum;  // Of that list
+    uint32_t length;        // Frame bytes, 0 if only the index was cast
+    uint32_t hash;          // FNV-1a of the frame
+    uint32_t showInUs;      // From sending this message to the show time
+};
+#pragma pack(pop)
+
+static constexpr size_t CHUNK_DATA = ESP_NOW_MAX_DATA_LEN - sizeof(ChunkMessage);
+static constexpr size_t MAX_CHUNKS = (FRAME_CAST_FRAME_SIZE + CHUNK_DATA - 1) / CHUNK_DATA;
+
+// esp_now_send() queue full: wait a tick and retry, this many times
+static constexpr int SEND_RETRIES = 20;
+
+static const uint8_t BROADCAST_ADDR[ESP_NOW_ETH_ALEN] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+static WifiRadio::Link* s_link = nullptr;
+static bool s_started = false;
+static uint8_t* s_frame = nullptr;  // Cast (leader) or receive (follower) buffer
+static uint16_t s_seq = 0;
+
+// Follower state, written by the Wi-Fi task under s_lock
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint16_t s_rxSeq = 0;
+static uint32_t s_rxLength = 0;
+static size_t s_rxChunks = 0;                    // Distinct chunks received
+static uint32_t s_rxHave[(MAX_CHUNKS + 31) / 32];
+static bool s_reading = false;                   // The slideshow task reads s_frame
+static bool s_showPending = false;
+static ShowMessage s_show;
+static int64_t s_showAtUs = 0;
+
+static uint32_t fnv1a(uint32_t hash, const void* data, size_t len)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Take a chunk into the frame buffer; a new seq starts a new frame
+ */
+static void onChunk(const ChunkMessage& msg, const uint8_t* data, size_t len)
+{
+    if (msg.length > FRAME_CAST_FRAME_SIZE || msg.offset % CHUNK_DATA != 0 ||
+        msg.offset + len > msg.length) {
+        return;
+    }
+    size_t chunk = msg.offset / CHUNK_DATA;
+    portENTER_CRITICAL(&s_lock);
+    if (s_reading) {
+        portEXIT_CRITICAL(&s_lock);
+        return;
+    }
+    if (msg.header.seq != s_rxSeq || msg.length != s_rxLength) {
+        s_rxSeq = msg.header.seq;
+        s_rxLength = msg.length;
+        s_rxChunks = 0;
+        memset(s_rxHave, 0, sizeof(s_rxHave));
+    }
+    bool fresh = (s_rxHave[chunk / 32] & (1u << (chunk % 32))) == 0;
+    if (fresh) {
+        s_rxHave[chunk / 32] |= 1u << (chunk % 32);
+        s_rxChunks++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    // The buffer isn't read until the show message, which follows every chunk
+    if (fresh) {
+        memcpy(s_frame + msg.offset, data, len);
+    }
+}
+
+/**
+ * @brief ESP-NOW receive callback (Wi-Fi task)
+ */
+static void onReceive(const esp_now_recv_info_t* info, const uint8_t* data, int len)
+{
+    (void)info;
+    int64_t now = esp_timer_get_time();
+    if (len < static_cast<int>(sizeof(CastHeader))) {
+        return;
+    }
+    CastHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != CAST_MAGIC || header.group != FRAME_CAST_GROUP) {
+        return;
+    }
+    if (header.type == TYPE_CHUNK && len > static_cast<int>(sizeof(ChunkMessage))) {
+        ChunkMessage msg;
+        memcpy(&msg, data, sizeof(msg));
+        onChunk(msg, data + sizeof(msg), len - sizeof(msg));
+    } else if (header.type == TYPE_SHOW && len == static_cast<int>(sizeof(ShowMessage))) {
+        portENTER_CRITICAL(&s_lock);
+        // s_show keeps the last one, taken or not
+        bool repeat = s_show.header.magic == CAST_MAGIC && s_show.header.seq == header.seq;
+        if (!repeat) {
+            memcpy(&s_show, data, sizeof(s_show));
+            s_showAtUs = now + s_show.showInUs;
+            s_showPending = true;
+        }
+        portEXIT_CRITICAL(&s_lock);
+        if (!repeat && !Slideshow::post(Slideshow::Command::CAST)) {
+            ESP_LOGW(TAG_CAST, "Slideshow busy, cast slide dropped");
+        }
+    }
+}
+
+/**
+ * @brief Broadcast one message, waiting for room in the send queue
+ */
+static bool send(const void* data, size_t len)
+{
+    for (int attempt = 0; attempt < SEND_RETRIES; attempt++) {
+        esp_err_t err = esp_now_send(BROADCAST_ADDR, static_cast<const uint8_t*>(data), len);
+        if (err == ESP_OK) {
+            return true;
+        }
+        if (err != ESP_ERR_ESPNOW_NO_MEM) {
+            ESP_LOGW(TAG_CAST, "Send failed: %s", esp_err_to_name(err));
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    return false;
+}
+
+bool FrameCast::start()
+{
+    if (!FRAME_CAST_ENABLED) {
+        return false;
+    }
+    if (s_started) {
+        return true;
+    }
+
+    // Held for good: slides may be cast at any time
+    if (!s_link) {
+        s_link = new (std::nothrow) WifiRadio::Link();
+        if (!s_link) {
+            return false;
+        }
+    }
+    if (!s_frame) {
+        s_frame = new (std::nothrow) uint8_t[FRAME_CAST_FRAME_SIZE];
+        if (!s_frame) {
+            ESP_LOGE(TAG_CAST, "No memory for the %zu-byte frame buffer", FRAME_CAST_FRAME_SIZE);
+            return false;
+        }
+    }
+    // Joined to an access point, the radio is on its channel
+    if (!s_link->connected()) {
+        esp_wifi_set_channel(FRAME_CAST_CHANNEL, WIFI_SECOND_CHAN_NONE);
+    }
+
+    esp_err_t err = esp_now_init();
+    if (err == ESP_OK && !FRAME_CAST_LEADER) {
+        err = esp_now_register_recv_cb(onReceive);
+    }
+    if (err == ESP_OK) {
+        esp_now_peer_info_t peer = {};
+        memcpy(peer.peer_addr, BROADCAST_ADDR, ESP_NOW_ETH_ALEN);
+        peer.channel = 0;  // Whichever the radio is on
+        peer.ifidx = WIFI_IF_STA;
+        err = esp_now_add_peer(&peer);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG_CAST, "ESP-NOW start failed: %s", esp_err_to_name(err));
+        esp_now_deinit();
+        return false;
+    }
+    s_started = true;
+    ESP_LOGI(TAG_CAST, "%s group %u", FRAME_CAST_LEADER ? "Leading" : "Following",
+             FRAME_CAST_GROUP);
+    return true;
+}
+
+bool FrameCast::leads()
+{
+    return FRAME_CAST_LEADER && s_started;
+}
+
+int64_t FrameCast::cast(size_t index, uint32_t listChecksum, ImageLoader::FrameReader read,
+                        void* ctx, size_t length)
+{
+    if (!leads()) {
+        return 0;
+    }
+    int64_t start = esp_timer_get_time();
+    s_seq++;
+
+    // Read it all first: a frame that can't be read goes as the index alone
+    uint32_t hash = 2166136261u;
+    if (!FRAME_CAST_SEND_FRAMES || length > FRAME_CAST_FRAME_SIZE || !read ||
+        read(ctx, s_frame, length) != length) {
+        length = 0;
+    }
+    hash = fnv1a(hash, s_frame, length);
+
+    size_t packets = 0;
+    uint8_t packet[ESP_NOW_MAX_DATA_LEN];
+    ChunkMessage chunk = {};
+    chunk.header = { CAST_MAGIC, TYPE_CHUNK, FRAME_CAST_GROUP, s_seq };
+    chunk.length = length;
+    for (uint8_t round = 0; round < FRAME_CAST_REPEATS && length > 0; round++) {
+        for (uint32_t offset = 0; offset < length; offset += CHUNK_DATA) {
+            size_t n = std::min<size_t>(CHUNK_DATA, length - offset);
+            chunk.offset = offset;
+            memcpy(packet, &chunk, sizeof(chunk));
+            memcpy(packet + sizeof(chunk), s_frame + offset, n);
+            packets += send(packet, sizeof(chunk) + n) ? 1 : 0;
+        }
+    }
+
+    ShowMessage show = {};
+    show.header = { CAST_MAGIC, TYPE_SHOW, FRAME_CAST_GROUP, s_seq };
+    show.index = index;
+    show.listChecksum = listChecksum;
+    show.length = length;
+    show.hash = hash;
+    int64_t showAt = start + FRAME_CAST_LEAD_MS * 1000;
+    int64_t now = esp_timer_get_time();
+    show.showInUs = showAt > now ? static_cast<uint32_t>(showAt - now) : 0;
+    // Twice, for the same reason the chunks are repeated
+    send(&show, sizeof(show));
+    send(&show, sizeof(show));
+
+    ESP_LOGI(TAG_CAST, "Cast slide %zu: %zu bytes in %zu packets, %" PRId64 " ms", index + 1,
+             length, packets, (esp_timer_get_time() - start) / 1000);
+    return showAt;
+}
+
+FrameCast::Received FrameCast::showPending(Adafruit_IL0373* display, uint32_t listChecksum,
+                                           size_t& index)
+{
+    ShowMessage show;
+    int64_t showAt;
+    bool complete;
+    portENTER_CRITICAL(&s_lock);
+    bool pending = s_showPending;
+    s_showPending = false;
+    show = s_show;
+    showAt = s_showAtUs;
+    complete = show.length > 0 && s_rxSeq == show.header.seq && s_rxLength == show.length &&
+               s_rxChunks == (show.length + CHUNK_DATA - 1) / CHUNK_DATA;
+    s_reading = complete;
+    portEXIT_CRITICAL(&s_lock);
+    if (!pending) {
+        return Received::NONE;
+    }
+
+    Received result = Received::NONE;
+    if (complete && fnv1a(2166136261u, s_frame, show.length) == show.hash) {
+        display->setRefreshTime(showAt);
+        if (ImageLoader::loadAndDisplayEPD(s_frame, show.length, display)) {
+            result = Received::FRAME;
+        }
+    }
+    portENTER_CRITICAL(&s_lock);
+    s_reading = false;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (result == Received::NONE && show.listChecksum == listChecksum) {
+        display->setRefreshTime(showAt);
+        index = show.index;
+        result = Received::INDEX;
+    }
+    if (result == Received::NONE) {
+        display->setRefreshTime(0);
+        ESP_LOGW(TAG_CAST, "Cast slide %" PRIu32 " neither received (%zu of %" PRIu32
+                 " bytes) nor held here", show.index + 1, complete ? size_t(show.length) : 0,
+                 show.length);
+    }
+    return result;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file frame_cast.hpp
+ * @brief One slideshow shown on several frames at once, over ESP-NOW
+ *
+ * With FRAME_CAST_ENABLED every unit holds the radio and listens for
+ * ESP-NOW broadcasts of its FRAME_CAST_GROUP. The leader casts each slide
+ * it shows: the packed .epd frame in pieces of one ESP-NOW packet, all of
+ * it FRAME_CAST_REPEATS times since broadcasts are never acknowledged or
+ * retried, then a show message with the slide index, the leader's image
+ * list checksum and the time left until the show time. Clocks are never
+ * compared: each follower takes its show time as the arrival of that
+ * message plus the time left, which is off by the air time of one packet.
+ *
+ * A follower's Wi-Fi task only fills the frame buffer and posts
+ * Slideshow::Command::CAST; the slideshow task uploads the frame, or the
+ * slide with the same index when its own image list is the leader's, and
+ * holds the refresh until the show time
+ * (Adafruit_EPD::setRefreshTime()). The leader holds its own refresh the
+ * same way, so the panels change together.
+ */
+
+#pragma once
+
+#include "config.hpp"
+#include "image_loader.hpp"
+#include <cstddef>
+#include <cstdint>
+
+class Adafruit_IL0373;
+
+namespace FrameCast {
+
+/**
+ * @brief What a follower was told to show
+ */
+enum class Received : uint8_t {
+    NONE,   // Nothing, or a slide it neither received nor holds
+    FRAME,  // The cast frame was uploaded
+    INDEX   // Show this slide of the local image list (same checksum)
+};
+
+/**
+ * @brief Take the radio and start ESP-NOW (once; later calls do nothing)
+ * @return false if FRAME_CAST_ENABLED is false or ESP-NOW didn't start
+ */
+bool start();
+
+/**
+ * @brief Whether this unit leads a started cast
+ */
+bool leads();
+
+/**
+ * @brief Whether this unit follows a leader (FRAME_CAST_ENABLED without
+ *        FRAME_CAST_LEADER): it doesn't auto-advance
+ */
+constexpr bool follows()
+{
+    return FRAME_CAST_ENABLED && !FRAME_CAST_LEADER;
+}
+
+/**
+ * @brief Leader: cast a slide, then return when its refresh should start
+ *
+ * Only on the slideshow task. The frame is read through read into the
+ * cast buffer before anything is sent; pass length 0 (or a frame over
+ * FRAME_CAST_FRAME_SIZE) to send only the index.
+ *
+ * @param index Slide index in the leader's image list
+ * @param listChecksum The list's checksum, so followers with the same list
+ *        can show index themselves
+ * @param read Reads the packed .epd frame, nullptr with length 0
+ * @param ctx Passed to read
+ * @param length Frame bytes
+ * @return esp_timer time of the show, for Adafruit_EPD::setRefreshTime();
+ *         0 if not leading
+ */
+int64_t cast(size_t index, uint32_t listChecksum, ImageLoader::FrameReader read, void* ctx,
+             size_t length);
+
+/**
+ * @brief Follower: show what the last show message asked for
+ *
+ * Only on the slideshow task. The display's next refresh is held until the
+ * show time in every case but NONE; with FRAME the refresh is started with
+ * displayAsync() and still running on return.
+ *
+ * @param display Display
+ * @param listChecksum Checksum of the local image list
+ * @param index Set to the slide to show with INDEX
+ */
+Received showPending(Adafruit_IL0373* display, uint32_t listChecksum, size_t& index);
+
+} // namespace FrameCast
@@ -0,0 +1,248 @@
+/**
+ * @file frame_codec.cpp
+ * @brief Plane encoder and decoder implementation
+ */
+
+#include "frame_codec.hpp"
+#include "image_loader.hpp"
+#include <algorithm>
+#include <cstring>
+
+using ImageLoader::EPD_ENCODING_RAW;
+using ImageLoader::EPD_ENCODING_RLE;
+using ImageLoader::EPD_ENCODING_LZ;
+
+bool FrameCodec::supported(uint8_t encoding)
+{
+    return encoding == EPD_ENCODING_RAW || encoding == EPD_ENCODING_RLE ||
+           encoding == EPD_ENCODING_LZ;
+}
+
+size_t FrameCodec::workSize(uint8_t encoding)
+{
+    switch (encoding) {
+        case EPD_ENCODING_RLE:
+            return INPUT_SIZE;
+        case EPD_ENCODING_LZ:
+            return INPUT_SIZE + LZ_WINDOW_SIZE;
+        default:
+            return 0;
+    }
+}
+
+size_t FrameCodec::encodeRLE(const uint8_t* src, size_t len, uint8_t* dst)
+{
+    size_t out = 0;
+    size_t literalStart = 0;
+    auto literals = [&](size_t end) {
+        while (literalStart < end) {
+            size_t n = std::min<size_t>(end - literalStart, RLE_MAX_LITERAL);
+            if (dst) {
+                dst[out] = static_cast<uint8_t>(n - 1);
+                memcpy(dst + out + 1, src + literalStart, n);
+            }
+            out += 1 + n;
+            literalStart += n;
+        }
+    };
+
+    size_t i = 0;
+    while (i < len) {
+        size_t run = 1;
+        while (i + run < len && run < RLE_MAX_RUN && src[i + run] == src[i]) {
+            run++;
+        }
+        if (run >= RLE_MIN_RUN) {
+            literals(i);
+            if (dst) {
+                dst[out] = static_cast<uint8_t>(0x80 + (run - RLE_MIN_RUN));
+                dst[out + 1] = src[i];
+            }
+            out += 2;
+            literalStart = i + run;
+        }
+        i += run;
+    }
+    literals(len);
+    return out;
+}
+
+bool FrameCodec::decodeRLE(const uint8_t* src, size_t stored, uint8_t* dst, size_t len)
+{
+    size_t in = 0;
+    size_t out = 0;
+    while (in < stored) {
+        uint8_t control = src[in++];
+        if (control < 0x80) {
+            size_t n = control + 1u;
+            if (in + n > stored || out + n > len) {
+                return false;
+            }
+            memcpy(dst + out, src + in, n);
+            in += n;
+            out += n;
+        } else {
+            size_t n = (control - 0x80u) + RLE_MIN_RUN;
+            if (in >= stored || out + n > len) {
+                return false;
+            }
+            memset(dst + out, src[in++], n);
+            out += n;
+        }
+    }
+    return out == len;
+}
+
+FrameCodec::PlaneDecoder::PlaneDecoder(Reader read, void* ctx, uint8_t encoding, uint32_t stored,
+                                       uint8_t* work)
+    : read_(read), ctx_(ctx), encoding_(encoding), storedLeft_(stored),
+      input_(work), inputPos_(0), inputLen_(0), literal_(0), repeat_(0), repeatByte_(0),
+      bits_(0), bitCount_(0), window_(nullptr), windowPos_(0), copyOffset_(0)
+{
+    if (encoding == EPD_ENCODING_LZ && work) {
+        window_ = work + INPUT_SIZE;
+        memset(window_, 0, LZ_WINDOW_SIZE);
+    }
+}
+
+/**
+ * @brief Refill the input buffer from the source, up to the end of the plane
+ */
+bool FrameCodec::PlaneDecoder::fill()
+{
+    if (storedLeft_ == 0 || !input_) {
+        return false;
+    }
+    size_t want = std::min<size_t>(INPUT_SIZE, storedLeft_);
+    size_t got = read_(ctx_, input_, want);
+    storedLeft_ -= got;
+    inputPos_ = 0;
+    inputLen_ = got;
+    if (got != want) {
+        storedLeft_ = 0;  // Truncated source: nothing more will come
+    }
+    return got > 0;
+}
+
+bool FrameCodec::PlaneDecoder::nextByte(uint8_t& out)
+{
+    if (inputLen_ == 0 && !fill()) {
+        return false;
+    }
+    out = input_[inputPos_++];
+    inputLen_--;
+    return true;
+}
+
+bool FrameCodec::PlaneDecoder::nextBits(uint8_t count, uint32_t& out)
+{
+    while (bitCount_ < count) {
+        uint8_t byte;
+        if (!nextByte(byte)) {
+            return false;
+        }
+        bits_ = (bits_ << 8) | byte;
+        bitCount_ += 8;
+    }
+    bitCount_ -= count;
+    out = (bits_ >> bitCount_) & ((1u << count) - 1);
+    return true;
+}
+
+size_t FrameCodec::PlaneDecoder::read(uint8_t* dst, size_t len)
+{
+    switch (encoding_) {
+        case EPD_ENCODING_RAW: {
+            size_t want = std::min<size_t>(len, storedLeft_);
+            size_t got = read_(ctx_, dst, want);
+            storedLeft_ = got == want ? storedLeft_ - got : 0;
+            return got;
+        }
+        case EPD_ENCODING_RLE:
+            return readRLE(dst, len);
+        case EPD_ENCODING_LZ:
+            return window_ ? readLZ(dst, len) : 0;
+        default:
+            return 0;
+    }
+}
+
+size_t FrameCodec::PlaneDecoder::readRLE(uint8_t* dst, size_t len)
+{
+    size_t out = 0;
+    while (out < len) {
+        if (repeat_ > 0) {
+            size_t n = std::min<size_t>(repeat_, len - out);
+            memset(dst + out, repeatByte_, n);
+            repeat_ -= n;
+            out += n;
+            continue;
+        }
+        if (literal_ > 0) {
+            if (inputLen_ == 0 && !fill()) {
+                break;
+            }
+            size_t n = std::min<size_t>({ literal_, len - out, inputLen_ });
+            memcpy(dst + out, input_ + inputPos_, n);
+            inputPos_ += n;
+            inputLen_ -= n;
+            literal_ -= n;
+            out += n;
+            continue;
+        }
+
+        uint8_t control;
+        if (!nextByte(control)) {
+            break;
+        }
+        if (control < 0x80) {
+            literal_ = control + 1u;
+        } else if (nextByte(repeatByte_)) {
+            repeat_ = (control - 0x80u) + RLE_MIN_RUN;
+        } else {
+            break;
+        }
+    }
+    return out;
+}
+
+size_t FrameCodec::PlaneDecoder::readLZ(uint8_t* dst, size_t len)
+{
+    constexpr uint32_t mask = LZ_WINDOW_SIZE - 1;
+    size_t out = 0;
+    while (out < len) {
+        if (repeat_ > 0) {
+            // Back-reference: byte by byte, as it may overlap what it writes
+            size_t n = std::min<size_t>(repeat_, len - out);
+            for (size_t i = 0; i < n; i++) {
+                uint8_t byte = window_[(windowPos_ - copyOffset_) & mask];
+                window_[windowPos_++ & mask] = byte;
+                dst[out++] = byte;
+            }
+            repeat_ -= n;
+            continue;
+        }
+
+        uint32_t tag;
+        if (!nextBits(1, tag)) {
+            break;
+        }
+        if (tag) {
+            uint32_t byte;
+            if (!nextBits(8, byte)) {
+                break;
+            }
+            window_[windowPos_++ & mask] = static_cast<uint8_t>(byte);
+            dst[out++] = static_cast<uint8_t>(byte);
+            continue;
+        }
+        uint32_t offset;
+        uint32_t count;
+        if (!nextBits(LZ_WINDOW_BITS, offset) || !nextBits(LZ_LOOKAHEAD_BITS, count)) {
+            break;
+        }
+        copyOffset_ = offset + 1;
+        repeat_ = count + 1;
+    }
+    return out;
+}
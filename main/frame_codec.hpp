@@ -0,0 +1,139 @@
+/**
+ * @file frame_codec.hpp
+ * @brief Plane encodings of packed .epd frames, decoded as they stream in
+ *
+ * Each plane of a version 2 frame is stored with the header's encoding:
+ *
+ * - EPD_ENCODING_RAW: the framebuffer bytes as they are.
+ * - EPD_ENCODING_RLE: a control byte c, then
+ *     c < 0x80:  c + 1 literal bytes follow;
+ *     c >= 0x80: one byte follows, repeated c - 0x80 + RLE_MIN_RUN times.
+ *   Blank stretches of a plane (long white runs, most of the red plane)
+ *   shrink to two bytes per RLE_MAX_RUN and decode to memset().
+ * - EPD_ENCODING_LZ: heatshrink's LZSS bit stream, window 2^LZ_WINDOW_BITS,
+ *   lookahead 2^LZ_LOOKAHEAD_BITS, MSB first. Tag 1: an 8-bit literal;
+ *   tag 0: a LZ_WINDOW_BITS offset - 1, then a LZ_LOOKAHEAD_BITS count - 1,
+ *   copied from that far back in the output. Repeating patterns (text,
+ *   dither textures, chart grids) compress where RLE barely helps.
+ *   The window starts zeroed for each plane.
+ *
+ * tools/epd_convert.py writes all three and picks the smallest by default;
+ * encodeRLE() writes RLE on the device, e.g. for the SlideCache.
+ * A PlaneDecoder expands one plane into whatever the caller hands it, the
+ * framebuffer itself or an upload chunk, reading the encoded bytes through
+ * a small input buffer and, for LZ, keeping only the window; it never
+ * needs the whole frame.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace FrameCodec {
+
+static constexpr uint8_t RLE_MIN_RUN = 3;
+static constexpr uint32_t RLE_MAX_RUN = 0x7F + RLE_MIN_RUN;
+static constexpr uint32_t RLE_MAX_LITERAL = 0x80;
+
+static constexpr uint8_t LZ_WINDOW_BITS = 10;
+static constexpr uint8_t LZ_LOOKAHEAD_BITS = 8;
+static constexpr size_t LZ_WINDOW_SIZE = size_t(1) << LZ_WINDOW_BITS;
+
+// Encoded bytes fetched from the source per read
+static constexpr size_t INPUT_SIZE = 512;
+
+/**
+ * @brief Reads the next encoded bytes (ImageLoader::FrameReader)
+ * @return Bytes read; fewer than len at the end of the source or on an error
+ */
+using Reader = size_t (*)(void* ctx, void* dst, size_t len);
+
+/**
+ * @brief Check whether an encoding can be decoded
+ */
+bool supported(uint8_t encoding);
+
+/**
+ * @brief Scratch bytes a PlaneDecoder needs for an encoding (0 for RAW)
+ */
+size_t workSize(uint8_t encoding);
+
+/**
+ * @brief RLE-encode a plane held in memory (EPD_ENCODING_RLE)
+ * @param src Plane bytes
+ * @param len Plane size
+ * @param dst Room for the encoding, or nullptr to only measure it
+ * @return Bytes of the encoding
+ */
+size_t encodeRLE(const uint8_t* src, size_t len, uint8_t* dst);
+
+/**
+ * @brief Decode a whole RLE plane held in memory, without a PlaneDecoder's
+ *        input buffer
+ * @param src Encoded plane
+ * @param stored Its bytes
+ * @param dst Plane to fill
+ * @param len Plane size
+ * @return false if the encoding doesn't decode to exactly len bytes
+ */
+bool decodeRLE(const uint8_t* src, size_t stored, uint8_t* dst, size_t len);
+
+/**
+ * @brief Decodes one stored plane, a piece at a time
+ */
+class PlaneDecoder {
+public:
+    /**
+     * @param read Source of the encoded bytes, positioned at the plane
+     * @param ctx Passed to read
+     * @param encoding EPD_ENCODING_* of the plane
+     * @param stored Encoded bytes of the plane; never read past
+     * @param work workSize(encoding) bytes for the input buffer and LZ
+     *             window (unused for RAW, which reads straight into the
+     *             destination)
+     */
+    PlaneDecoder(Reader read, void* ctx, uint8_t encoding, uint32_t stored, uint8_t* work);
+
+    /**
+     * @brief Decode the next bytes of the plane
+     * @return Bytes decoded; fewer than len when the stored plane ran out
+     *         or is corrupt
+     */
+    size_t read(uint8_t* dst, size_t len);
+
+    /**
+     * @brief Every stored byte was consumed and no run is left half-decoded
+     */
+    bool finished() const
+    {
+        // LZ pads its last byte with zero bits
+        return storedLeft_ == 0 && inputLen_ == 0 && literal_ == 0 && repeat_ == 0 &&
+               bitCount_ < 8;
+    }
+
+private:
+    bool fill();
+    bool nextByte(uint8_t& out);
+    bool nextBits(uint8_t count, uint32_t& out);
+    size_t readRLE(uint8_t* dst, size_t len);
+    size_t readLZ(uint8_t* dst, size_t len);
+
+    Reader read_;
+    void* ctx_;
+    uint8_t encoding_;
+    uint32_t storedLeft_;   // Encoded bytes not read from the source yet
+    uint8_t* input_;
+    size_t inputPos_;
+    size_t inputLen_;       // Unconsumed bytes in input_ from inputPos_
+    uint32_t literal_;      // RLE: literal bytes left in the current run
+    uint32_t repeat_;       // RLE: repeats left of repeatByte_; LZ: bytes left to copy
+    uint8_t repeatByte_;
+    uint32_t bits_;         // LZ: bits read ahead, MSB first
+    uint8_t bitCount_;
+    uint8_t* window_;       // LZ: the last LZ_WINDOW_SIZE bytes written
+    uint32_t windowPos_;    // LZ: bytes written so far (ring index)
+    uint32_t copyOffset_;   // LZ: distance of the back-reference being copied
+};
+
+} // namespace FrameCodec
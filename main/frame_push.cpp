@@ -0,0 +1,144 @@
+/**
+ * @file frame_push.cpp
+ * @brief Pushed frame server implementation
+ */
+
+#include "frame_push.hpp"
+#include "config.hpp"
+#include "image_loader.hpp"
+#include "slideshow.hpp"
+#include "wifi_radio.hpp"
+#include "esp_log.h"
+#include "esp_http_server.h"
+#include <atomic>
+#include <new>
+
+static const char* TAG_PUSH = "FramePush";
+
+// Receive timeouts (the server's recv_wait_timeout each) before a stalled
+// sender is given up on; the slideshow task waits for it meanwhile
+static constexpr int RECV_TIMEOUT_RETRIES = 3;
+
+static WifiRadio::Link* s_link = nullptr;
+static httpd_handle_t s_server = nullptr;
+
+// The request handed to the slideshow task, taken back by it
+static std::atomic<httpd_req_t*> s_pending{ nullptr };
+
+/**
+ * @brief ImageLoader::FrameReader over the request body
+ */
+static size_t readBody(void* ctx, void* dst, size_t len)
+{
+    httpd_req_t* req = static_cast<httpd_req_t*>(ctx);
+    char* out = static_cast<char*>(dst);
+    size_t got = 0;
+    int timeouts = 0;
+    while (got < len) {
+        int n = httpd_req_recv(req, out + got, len - got);
+        if (n == HTTPD_SOCK_ERR_TIMEOUT && ++timeouts < RECV_TIMEOUT_RETRIES) {
+            continue;  // Slow sender, not the end of the body
+        }
+        if (n <= 0) {
+            break;
+        }
+        got += n;
+    }
+    return got;
+}
+
+/**
+ * @brief POST /frame: hand the request to the slideshow task
+ *
+ * Runs on the server task, which must not touch the display, so the body
+ * is left unread on the socket until the slideshow task gets to it.
+ */
+static esp_err_t onFrame(httpd_req_t* req)
+{
+    if (req->content_len < ImageLoader::EPD_IMAGE_V1_HEADER_SIZE) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected an .epd frame");
+    }
+    if (s_pending.load()) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_sendstr(req, "Busy with another frame\n");
+    }
+
+    httpd_req_t* async = nullptr;
+    if (httpd_req_async_handler_begin(req, &async) != ESP_OK) {
+        return httpd_resp_send_500(req);
+    }
+    s_pending.store(async);
+    if (!Slideshow::post(Slideshow::Command::PUSH)) {
+        s_pending.store(nullptr);
+        httpd_resp_set_status(async, "503 Service Unavailable");
+        httpd_resp_sendstr(async, "Slideshow busy\n");
+        httpd_req_async_handler_complete(async);
+    }
+    return ESP_OK;
+}
+
+bool FramePush::start()
+{
+    if (!FRAME_PUSH_ENABLED) {
+        return false;
+    }
+    if (s_server) {
+        return true;
+    }
+
+    // Held for good: frames may arrive at any time
+    if (!s_link) {
+        s_link = new (std::nothrow) WifiRadio::Link();
+        if (!s_link) {
+            return false;
+        }
+    }
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = FRAME_PUSH_PORT;
+    config.lru_purge_enable = true;
+    if (httpd_start(&s_server, &config) != ESP_OK) {
+        ESP_LOGE(TAG_PUSH, "Server failed to start on port %u", FRAME_PUSH_PORT);
+        s_server = nullptr;
+        return false;
+    }
+    httpd_uri_t frame = {};
+    frame.uri = "/frame";
+    frame.method = HTTP_POST;
+    frame.handler = onFrame;
+    httpd_register_uri_handler(s_server, &frame);
+
+    ESP_LOGI(TAG_PUSH, "Accepting frames on port %u%s", FRAME_PUSH_PORT,
+             s_link->connected() ? "" : " once the network is joined");
+    return true;
+}
+
+bool FramePush::showPending(Adafruit_IL0373* display)
+{
+    httpd_req_t* req = s_pending.exchange(nullptr);
+    if (!req) {
+        return false;
+    }
+
+    bool ok = ImageLoader::loadAndDisplayEPD(readBody, req, display);
+    if (ok) {
+        httpd_resp_sendstr(req, "Shown\n");
+    } else {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
+                            "Not an .epd frame for this panel, or truncated");
+    }
+    httpd_req_async_handler_complete(req);
+    ESP_LOGI(TAG_PUSH, "Pushed frame %s", ok ? "shown" : "rejected");
+    return ok;
+}
+
+void FramePush::rejectPending()
+{
+    httpd_req_t* req = s_pending.exchange(nullptr);
+    if (!req) {
+        return;
+    }
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_sendstr(req, "Not showing slides\n");
+    httpd_req_async_handler_complete(req);
+}
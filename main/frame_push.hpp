@@ -0,0 +1,49 @@
+/**
+ * @file frame_push.hpp
+ * @brief Frames pushed over HTTP, streamed from the socket to the panel
+ *
+ * With FRAME_PUSH_ENABLED the device holds the radio and serves
+ * POST /frame on FRAME_PUSH_PORT. The body is one packed .epd frame (as
+ * tools/epd_convert.py writes it). The server task only accepts the
+ * request and hands it to the slideshow task (Slideshow::Command::PUSH),
+ * which reads the header, checks it against the panel and then reads the
+ * planes from the socket straight into the framebuffer, or chunk by chunk
+ * to the controller (ImageLoader::loadAndDisplayEPD(FrameReader, ...)).
+ * Nothing is staged or written to the SD card.
+ *
+ * One frame is taken at a time; a second POST while one waits gets 503.
+ *
+ *     curl --data-binary @dashboard.epd http://<device>/frame
+ */
+
+#pragma once
+
+class Adafruit_IL0373;
+
+namespace FramePush {
+
+/**
+ * @brief Join the network and start the server (once; later calls do nothing)
+ * @return false if FRAME_PUSH_ENABLED is false or the server didn't start.
+ *         The radio stays held even when the first join fails, and keeps trying
+ */
+bool start();
+
+/**
+ * @brief Show the frame waiting for the slideshow task and answer its request
+ *
+ * Only on the slideshow task. The refresh is started with displayAsync()
+ * and still running on return, as with the loaders.
+ *
+ * @return true if a frame was read and its refresh started; the framebuffer
+ *         no longer holds the slide either way once a frame was waiting
+ */
+bool showPending(Adafruit_IL0373* display);
+
+/**
+ * @brief Answer the frame waiting with 503 without showing it (the
+ *        slideshow isn't displaying slides)
+ */
+void rejectPending();
+
+} // namespace FramePush
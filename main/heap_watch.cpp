@@ -0,0 +1,64 @@
+/**
+ * @file heap_watch.cpp
+ * @brief Heap allocation counting through ESP-IDF's heap hooks
+ */
+
+#include "heap_watch.hpp"
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#if CONFIG_HEAP_USE_HOOKS
+#include "esp_attr.h"
+#endif
+
+static const char* TAG_HEAP = "HeapWatch";
+
+// Written from the hook, in whichever task allocates
+static TaskHandle_t volatile s_task = nullptr;
+static volatile uint32_t s_allocations = 0;
+static volatile size_t s_lastSize = 0;
+
+#if CONFIG_HEAP_USE_HOOKS
+/**
+ * @brief Called by the heap after every successful allocation; also from
+ *        interrupts, so kept in IRAM and short
+ */
+extern "C" IRAM_ATTR void esp_heap_trace_alloc_hook(void* ptr, size_t size, uint32_t caps)
+{
+    (void)caps;
+    if (ptr && s_task && xTaskGetCurrentTaskHandle() == s_task) {
+        s_allocations = s_allocations + 1;
+        s_lastSize = size;
+    }
+}
+#endif
+
+bool HeapWatch::available()
+{
+#if CONFIG_HEAP_USE_HOOKS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void HeapWatch::watchCurrentTask()
+{
+    s_allocations = 0;
+    s_lastSize = 0;
+    s_task = xTaskGetCurrentTaskHandle();
+    if (!available()) {
+        ESP_LOGD(TAG_HEAP, "CONFIG_HEAP_USE_HOOKS is off, allocations aren't counted");
+    }
+}
+
+uint32_t HeapWatch::allocations()
+{
+    return s_allocations;
+}
+
+size_t HeapWatch::lastSize()
+{
+    return s_lastSize;
+}
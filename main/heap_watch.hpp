@@ -0,0 +1,43 @@
+/**
+ * @file heap_watch.hpp
+ * @brief Counts the heap allocations one task makes, to check that the
+ *        slideshow's steady state makes none
+ *
+ * Uses ESP-IDF's heap hooks: with CONFIG_HEAP_USE_HOOKS=y in sdkconfig,
+ * every successful allocation of the watched task is counted. SlideStats
+ * records the count per slide, so a slide that allocates shows up in its
+ * log line and in the console's heap command. The option is on in
+ * sdkconfig.defaults; without it nothing is counted, available() is false
+ * and callers report "hooks disabled" instead of a count.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace HeapWatch {
+
+/**
+ * @brief Check whether the heap hooks are built in (CONFIG_HEAP_USE_HOOKS)
+ */
+bool available();
+
+/**
+ * @brief Count the allocations of the calling task from now on
+ */
+void watchCurrentTask();
+
+/**
+ * @brief Allocations the watched task has made since watchCurrentTask()
+ *
+ * Only grows (wrapping); take the difference of two readings.
+ */
+uint32_t allocations();
+
+/**
+ * @brief Size of the watched task's last allocation, bytes; 0 if none yet
+ */
+size_t lastSize();
+
+} // namespace HeapWatch
@@ -0,0 +1,1319 @@
+/**
+ * @file image_decode.cpp
+ * @brief Decode pipeline implementation
+ */
+
+#include "image_decode.hpp"
+#include "slide_stats.hpp"
+#include "slide_arena.hpp"
+#include "render_job.hpp"
+#include "esp_log.h"
+#include "../components/Adafruit_EPD/src/EPDColors.h"
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+#include <unistd.h>
+
+static const char* TAG_DEC = "ImageDecode";
+
+static Dither::Mode s_ditherMode = static_cast<Dither::Mode>(IMAGE_DITHER_MODE);
+static ImageLoader::ScaleMode s_scaleMode = static_cast<ImageLoader::ScaleMode>(IMAGE_SCALE_MODE);
+static Dither::Palette s_palette = Dither::Palette::TRICOLOR;
+static ImageLoader::Tone s_tone = {IMAGE_TONE_GAMMA, IMAGE_TONE_CONTRAST, IMAGE_TONE_BRIGHTNESS};
+static ImageLoader::Tone s_imageTone = s_tone;
+static ImageDecode::Tile s_tile = ImageDecode::FULL_SCREEN;
+
+// toneCurve() table and the tone it was built for
+static uint8_t s_toneCurve[256];
+static ImageLoader::Tone s_toneCurveOf = {100, 0, 0};
+
+static ImageDecode::StripeRunner s_stripeRunner = nullptr;
+
+void ImageLoader::setScaleMode(ScaleMode mode)
+{
+    s_scaleMode = mode;
+}
+
+ImageLoader::ScaleMode ImageLoader::getScaleMode()
+{
+    return s_scaleMode;
+}
+
+void ImageLoader::setDitherMode(Dither::Mode mode)
+{
+    s_ditherMode = mode;
+}
+
+Dither::Mode ImageLoader::getDitherMode()
+{
+    return s_ditherMode;
+}
+
+void ImageLoader::setPalette(Dither::Palette palette)
+{
+    s_palette = palette;
+}
+
+Dither::Palette ImageLoader::getPalette()
+{
+    return s_palette;
+}
+
+void ImageLoader::setTone(const Tone& tone)
+{
+    s_tone = tone;
+    s_imageTone = tone;
+}
+
+ImageLoader::Tone ImageLoader::getTone()
+{
+    return s_tone;
+}
+
+void ImageDecode::setImageTone(const ImageLoader::Tone& tone)
+{
+    s_imageTone = tone;
+}
+
+const uint8_t* ImageDecode::toneCurve()
+{
+    if (s_imageTone.linear()) {
+        return nullptr;
+    }
+    if (!(s_imageTone == s_toneCurveOf)) {
+        // 256 powf() on a core without an FPU: well under a millisecond,
+        // and only when the tone changes
+        float exponent = 100.0f / std::max<uint16_t>(s_imageTone.gamma, 10);
+        int32_t contrast = std::clamp<int32_t>(s_imageTone.contrast, -100, 100);
+        for (int32_t level = 0; level < 256; level++) {
+            int32_t curved = static_cast<int32_t>(255.0f * powf(level / 255.0f, exponent) + 0.5f);
+            int32_t out = (curved - 128) * (100 + contrast) / 100 + 128 + s_imageTone.brightness;
+            s_toneCurve[level] = static_cast<uint8_t>(std::clamp<int32_t>(out, 0, 255));
+        }
+        s_toneCurveOf = s_imageTone;
+    }
+    return s_toneCurve;
+}
+
+void ImageDecode::applyTone(const uint8_t* curve, uint8_t* rgb, uint32_t count)
+{
+    for (uint32_t i = 0; i < count * 3; i++) {
+        rgb[i] = curve[rgb[i]];
+    }
+}
+
+void ImageDecode::setStripeRunner(StripeRunner runner)
+{
+    s_stripeRunner = runner;
+}
+
+bool ImageDecode::aborted()
+{
+    if (RenderJob::cancelled()) {
+        ESP_LOGI(TAG_DEC, "Decode abandoned for newer input");
+        return true;
+    }
+    return false;
+}
+
+size_t ImageDecode::readFile(void* dst, size_t size, size_t count, FILE* file)
+{
+    SlideStats::Timer timer(SlideStats::Stage::READ);
+    return fread(dst, size, count, file);
+}
+
+using ImageDecode::DecodeScratch;
+using ImageDecode::FitScale;
+using ImageDecode::PlaneSink;
+using ImageDecode::PlaneRun;
+using ImageDecode::readFile;
+
+/**
+ * @brief Hand one output row to the sink, timed as SlideStats::Stage::PACK
+ */
+static void writeSpan(PlaneSink& sink, uint32_t x, uint32_t y, const uint8_t* colors,
+                      uint32_t len)
+{
+    SlideStats::Timer timer(SlideStats::Stage::PACK);
+    sink.writeSpan(static_cast<int16_t>(x), static_cast<int16_t>(y), colors,
+                   static_cast<int16_t>(len));
+}
+
+/**
+ * @brief PlaneSink::openRun() with the decoder's unsigned coordinates
+ */
+static bool openRun(PlaneSink& sink, uint32_t x, uint32_t y, uint32_t len, PlaneRun& run)
+{
+    return sink.openRun(static_cast<int16_t>(x), static_cast<int16_t>(y),
+                        static_cast<int16_t>(len), run);
+}
+
+namespace {
+
+/**
+ * @brief Tricolor threshold heuristic, evaluated at compile time only
+ */
+constexpr uint8_t thresholdColor(uint8_t r, uint8_t g, uint8_t b)
+{
+    // Simple color quantization for tricolor e-ink
+    // Convert RGB to grayscale first
+    uint8_t gray = (r * 30 + g * 59 + b * 11) / 100;
+
+    // Determine if pixel should be red (warm colors)
+    bool isRed = (r > 128 && r > g && r > b);
+
+    // Determine if pixel should be black (dark) or white (light)
+    if (gray < 85) {
+        return EPD_BLACK;
+    } else if (isRed && gray > 100) {
+        return EPD_RED;
+    } else {
+        return EPD_WHITE;
+    }
+}
+
+/**
+ * @brief 32x32x32 RGB555 -> EPD color table, 2 bits per entry (8 KB, flash)
+ *
+ * Each cell holds thresholdColor() of its center, so results match the
+ * heuristic to within 4 levels per channel.
+ */
+struct EinkColorLUT {
+    static constexpr uint32_t BITS = 5;
+    static constexpr uint32_t CELLS = 1u << (3 * BITS);
+    uint8_t packed[CELLS / 4];
+};
+
+constexpr EinkColorLUT buildEinkColorLUT()
+{
+    EinkColorLUT lut{};
+    constexpr uint32_t half = 1u << (7 - EinkColorLUT::BITS);
+    for (uint32_t index = 0; index < EinkColorLUT::CELLS; index++) {
+        uint32_t r = (index >> (2 * EinkColorLUT::BITS)) & 0x1F;
+        uint32_t g = (index >> EinkColorLUT::BITS) & 0x1F;
+        uint32_t b = index & 0x1F;
+        uint8_t color = thresholdColor((r << 3) + half, (g << 3) + half, (b << 3) + half);
+        lut.packed[index / 4] |= color << ((index % 4) * 2);
+    }
+    return lut;
+}
+
+constexpr EinkColorLUT EINK_COLOR_LUT = buildEinkColorLUT();
+
+static_assert(EPD_WHITE < 4 && EPD_BLACK < 4 && EPD_RED < 4,
+              "LUT packs EPD colors in 2 bits");
+
+} // namespace
+
+uint16_t ImageLoader::rgbToEinkColor(uint8_t r, uint8_t g, uint8_t b)
+{
+    uint32_t index = ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3);
+    return (EINK_COLOR_LUT.packed[index / 4] >> ((index % 4) * 2)) & 0x3;
+}
+
+namespace {
+
+/**
+ * @brief Source of BMP pixel rows, with a small cache of recent rows
+ *
+ * Rows are handed out in the uncompressed BMP row layout whatever the file
+ * encoding, so the scaler only deals with one format. A few recently used
+ * rows are kept so upscaled images (which sample the same source row for
+ * several output rows) don't hit the card again.
+ */
+class BMPRowSource {
+public:
+    static constexpr size_t CACHE_ROWS = 2;
+
+    explicit BMPRowSource(uint32_t rowSize)
+        : rowSize_(rowSize), nextSlot_(0)
+    {
+        for (size_t i = 0; i < CACHE_ROWS; i++) {
+            rows_[i] = SlideArena::makeArray<uint8_t>(rowSize_);
+            rowIndex_[i] = -1;
+        }
+    }
+
+    virtual ~BMPRowSource() = default;
+
+    BMPRowSource(const BMPRowSource&) = delete;
+    BMPRowSource& operator=(const BMPRowSource&) = delete;
+
+    /** @brief Check that the buffers could be allocated */
+    virtual bool ok() const
+    {
+        for (size_t i = 0; i < CACHE_ROWS; i++) {
+            if (!rows_[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Get a source row in top-down image order
+     * @param srcY Row index, 0 = top of the image
+     * @return Pointer to rowSize bytes of pixel data, or nullptr on read error
+     */
+    const uint8_t* row(uint32_t srcY)
+    {
+        for (size_t i = 0; i < CACHE_ROWS; i++) {
+            if (rowIndex_[i] == static_cast<int32_t>(srcY)) {
+                return rows_[i].get();
+            }
+        }
+
+        size_t slot = nextSlot_;
+        nextSlot_ = (nextSlot_ + 1) % CACHE_ROWS;
+        rowIndex_[slot] = -1;
+
+        if (!readRow(srcY, rows_[slot].get())) {
+            return nullptr;
+        }
+        rowIndex_[slot] = static_cast<int32_t>(srcY);
+        return rows_[slot].get();
+    }
+
+protected:
+    /** @brief Fill dst with rowSize bytes of row srcY (top-down) */
+    virtual bool readRow(uint32_t srcY, uint8_t* dst) = 0;
+
+    uint32_t rowSize_;
+
+private:
+    SlideArena::Ptr<uint8_t[]> rows_[CACHE_ROWS];
+    int32_t rowIndex_[CACHE_ROWS];
+    size_t nextSlot_;
+};
+
+/**
+ * @brief Uncompressed rows, one fread each
+ *
+ * Only the source rows the scaler asks for are read. The file is only
+ * seeked when a row doesn't start where the last one ended, so rows asked
+ * for in file order read the card sequentially. When the rows asked for are
+ * further apart than the stdio buffer (a large image shrunk by nearest
+ * neighbour), each would cost a whole buffer refill for one row: such rows
+ * are read straight from the file descriptor instead, only their own bytes.
+ */
+class BMPRowReader : public BMPRowSource {
+public:
+    BMPRowReader(FILE* file, uint32_t dataOffset, uint32_t rowSize,
+                 uint32_t imgHeight, bool topDown, bool sparse)
+        : BMPRowSource(rowSize), file_(file), dataOffset_(dataOffset),
+          imgHeight_(imgHeight), topDown_(topDown), fd_(sparse ? fileno(file) : -1),
+          filePos_(-1)
+    {
+    }
+
+protected:
+    bool readRow(uint32_t srcY, uint8_t* dst) override
+    {
+        // BMP is typically bottom-up: the first stored row is the bottom one
+        uint32_t fileRow = topDown_ ? srcY : (imgHeight_ - 1 - srcY);
+        long offset = static_cast<long>(dataOffset_) +
+                      static_cast<long>(fileRow) * static_cast<long>(rowSize_);
+
+        if (fd_ >= 0) {
+            return readDirect(offset, dst);
+        }
+        if (offset != filePos_ && fseek(file_, offset, SEEK_SET) != 0) {
+            filePos_ = -1;
+            return false;
+        }
+        if (readFile(dst, 1, rowSize_, file_) != rowSize_) {
+            filePos_ = -1;
+            return false;
+        }
+        filePos_ = offset + static_cast<long>(rowSize_);
+        return true;
+    }
+
+private:
+    /**
+     * @brief One row at offset through the file descriptor, timed as
+     *        SlideStats::Stage::READ
+     *
+     * Every read seeks absolutely, so the stdio buffer left behind by the
+     * header reads is never consulted again.
+     */
+    bool readDirect(long offset, uint8_t* dst)
+    {
+        SlideStats::Timer timer(SlideStats::Stage::READ);
+        if (offset != filePos_ && lseek(fd_, offset, SEEK_SET) != offset) {
+            filePos_ = -1;
+            return false;
+        }
+        if (read(fd_, dst, rowSize_) != static_cast<ssize_t>(rowSize_)) {
+            filePos_ = -1;
+            return false;
+        }
+        filePos_ = offset + static_cast<long>(rowSize_);
+        return true;
+    }
+
+    FILE* file_;
+    uint32_t dataOffset_;
+    uint32_t imgHeight_;
+    bool topDown_;
+    int fd_;        // File descriptor for sparse rows, -1 to go through stdio
+    long filePos_;  // Where the file is positioned, -1 if unknown
+};
+
+/**
+ * @brief BI_RLE8 / BI_RLE4 rows, expanded to the uncompressed layout
+ *
+ * RLE rows have no fixed size, so the constructor walks the stream once and
+ * records where each row's codes start (file offset plus starting column,
+ * since a delta escape can land mid-row). Rows are then decoded on demand
+ * from there, in any order; pixels the stream skips are left at index 0.
+ */
+class RLERowReader : public BMPRowSource {
+public:
+    RLERowReader(FILE* file, uint32_t dataOffset, uint32_t rowSize,
+                 uint32_t imgWidth, uint32_t imgHeight, uint16_t bpp)
+        : BMPRowSource(rowSize), file_(file), imgWidth_(imgWidth),
+          imgHeight_(imgHeight), bpp_(bpp), bufPos_(0), bufLen_(0), filePos_(0),
+          starts_(SlideArena::makeArray<RowStart>(imgHeight)),
+          buf_(SlideArena::makeArray<uint8_t>(BUF_SIZE))
+    {
+        if (ok()) {
+            indexRows(dataOffset);
+        }
+    }
+
+    bool ok() const override
+    {
+        return BMPRowSource::ok() && starts_ && buf_;
+    }
+
+protected:
+    bool readRow(uint32_t srcY, uint8_t* dst) override
+    {
+        memset(dst, 0, rowSize_);
+
+        // RLE bitmaps are always bottom-up
+        const RowStart& start = starts_[imgHeight_ - 1 - srcY];
+        if (start.offset == EMPTY_ROW) {
+            return true;
+        }
+        if (!seek(start.offset)) {
+            return false;
+        }
+
+        uint32_t x = start.x;
+        int count, value;
+        while ((count = next()) >= 0 && (value = next()) >= 0) {
+            if (count > 0) {
+                // Encoded run; RLE4 alternates the two nibbles of value
+                for (int i = 0; i < count; i++, x++) {
+                    put(dst, x, bpp_ == 8 ? value : ((i & 1) ? (value & 0x0F) : (value >> 4)));
+                }
+                continue;
+            }
+            if (value == 0 || value == 1) {
+                return true;  // End of line / end of bitmap
+            }
+            if (value == 2) {
+                int dx = next();
+                int dy = next();
+                if (dx < 0 || dy < 0 || dy > 0) {
+                    return true;  // The rest of this row is skipped
+                }
+                x += dx;
+                continue;
+            }
+            // Absolute run of value pixels, padded to a 16-bit boundary
+            uint32_t bytes = bpp_ == 8 ? value : (value + 1) / 2;
+            for (uint32_t i = 0; i < bytes; i++) {
+                int data = next();
+                if (data < 0) {
+                    return true;
+                }
+                if (bpp_ == 8) {
+                    put(dst, x++, data);
+                } else {
+                    put(dst, x++, data >> 4);
+                    if (i * 2 + 1 < static_cast<uint32_t>(value)) {
+                        put(dst, x++, data & 0x0F);
+                    }
+                }
+            }
+            if (bytes & 1) {
+                next();
+            }
+        }
+        // Truncated stream: keep what was decoded
+        return true;
+    }
+
+private:
+    static constexpr uint32_t EMPTY_ROW = UINT32_MAX;
+    static constexpr size_t BUF_SIZE = 512;
+
+    struct RowStart {
+        uint32_t offset;  // File offset of the row's first code
+        uint32_t x;       // Column the codes start at
+    };
+
+    /** @brief Record where every (bottom-up) file row's codes begin */
+    void indexRows(uint32_t dataOffset)
+    {
+        for (uint32_t y = 0; y < imgHeight_; y++) {
+            starts_[y].offset = EMPTY_ROW;
+            starts_[y].x = 0;
+        }
+        if (!seek(dataOffset)) {
+            return;
+        }
+        starts_[0].offset = dataOffset;
+
+        uint32_t y = 0;
+        uint32_t x = 0;
+        int count, value;
+        while ((count = next()) >= 0 && (value = next()) >= 0) {
+            if (count > 0) {
+                x += count;
+                continue;
+            }
+            if (value == 1) {
+                break;
+            }
+            if (value == 0 || value == 2) {
+                uint32_t dy = 1;
+                if (value == 2) {
+                    int dx = next();
+                    int d = next();
+                    if (dx < 0 || d < 0) {
+                        break;
+                    }
+                    x += dx;
+                    dy = d;
+                } else {
+                    x = 0;
+                }
+                if (dy == 0) {
+                    continue;
+                }
+                // Rows jumped over by a delta stay empty
+                y += dy;
+                if (y >= imgHeight_) {
+                    break;
+                }
+                starts_[y].offset = filePos_;
+                starts_[y].x = x;
+                continue;
+            }
+            uint32_t bytes = bpp_ == 8 ? value : (value + 1) / 2;
+            for (uint32_t i = 0; i < bytes + (bytes & 1); i++) {
+                next();
+            }
+            x += value;
+        }
+    }
+
+    inline void put(uint8_t* dst, uint32_t x, int index) const
+    {
+        if (x >= imgWidth_) {
+            return;
+        }
+        if (bpp_ == 8) {
+            dst[x] = static_cast<uint8_t>(index);
+        } else {
+            dst[x / 2] |= (x & 1) ? index : (index << 4);
+        }
+    }
+
+    bool seek(uint32_t offset)
+    {
+        bufPos_ = bufLen_ = 0;
+        filePos_ = offset;
+        return fseek(file_, offset, SEEK_SET) == 0;
+    }
+
+    /** @brief Next stream byte, or -1 at end of file */
+    inline int next()
+    {
+        if (bufPos_ == bufLen_) {
+            bufLen_ = readFile(buf_.get(), 1, BUF_SIZE, file_);
+            bufPos_ = 0;
+            if (bufLen_ == 0) {
+                return -1;
+            }
+        }
+        filePos_++;
+        return buf_[bufPos_++];
+    }
+
+    FILE* file_;
+    uint32_t imgWidth_;
+    uint32_t imgHeight_;
+    uint16_t bpp_;
+    size_t bufPos_;
+    size_t bufLen_;
+    uint32_t filePos_;  // File offset of the next byte next() returns
+    SlideArena::Ptr<RowStart[]> starts_;
+    SlideArena::Ptr<uint8_t[]> buf_;
+};
+
+/**
+ * @brief Read the palette index of one pixel of a 1/4/8 bpp row
+ */
+inline uint8_t readIndex(const uint8_t* row, uint16_t bpp, uint32_t x)
+{
+    if (bpp == 8) {
+        return row[x];
+    }
+    if (bpp == 4) {
+        return (x & 1) ? (row[x / 2] & 0x0F) : (row[x / 2] >> 4);
+    }
+    return (row[x / 8] >> (7 - (x % 8))) & 1;
+}
+
+/**
+ * @brief Read one source pixel as RGB
+ * @param row Raw BMP row
+ * @param bpp Bits per pixel
+ * @param x Source column
+ * @param palette Color table for 1/4/8 bpp
+ * @param rgb Output R, G, B
+ */
+inline void readPixel(const uint8_t* row, uint16_t bpp, uint32_t x,
+                      const uint8_t (*palette)[3], uint8_t* rgb)
+{
+    if (bpp == 24) {
+        // BMP stores as BGR
+        rgb[0] = row[x * 3 + 2];
+        rgb[1] = row[x * 3 + 1];
+        rgb[2] = row[x * 3];
+    } else {
+        const uint8_t* entry = palette[readIndex(row, bpp, x)];
+        rgb[0] = entry[0];
+        rgb[1] = entry[1];
+        rgb[2] = entry[2];
+    }
+}
+
+/**
+ * @brief Tricolor ink of one BGR24 pixel: rgbToEinkColor() without the
+ *        channel shuffle
+ */
+inline uint8_t bgrTricolorInk(const uint8_t* bgr)
+{
+    uint32_t index = ((bgr[2] & 0xF8u) << 7) | ((bgr[1] & 0xF8u) << 2) | (bgr[0] >> 3);
+    return (EINK_COLOR_LUT.packed[index / 4] >> ((index % 4) * 2)) & 0x3;
+}
+
+/**
+ * @brief bgrTricolorInk() through scratch->toneIndex, which folds the tone
+ *        curve into the LUT index: the same three loads, no extra work
+ */
+inline uint8_t tonedTricolorInk(const uint8_t* bgr, const DecodeScratch* scratch)
+{
+    uint32_t index = scratch->toneIndex[0][bgr[2]] | scratch->toneIndex[1][bgr[1]] |
+                     scratch->toneIndex[2][bgr[0]];
+    return (EINK_COLOR_LUT.packed[index / 4] >> ((index % 4) * 2)) & 0x3;
+}
+
+/**
+ * @brief Fill scratch->toneIndex from scratch->tone, for toned BGR24 rows
+ */
+void buildToneIndex(DecodeScratch* scratch)
+{
+    for (uint32_t level = 0; level < 256; level++) {
+        uint32_t toned = scratch->tone[level];
+        scratch->toneIndex[0][level] = static_cast<uint16_t>((toned & 0xF8u) << 7);
+        scratch->toneIndex[1][level] = static_cast<uint16_t>((toned & 0xF8u) << 2);
+        scratch->toneIndex[2][level] = static_cast<uint16_t>(toned >> 3);
+    }
+}
+
+/**
+ * @brief Inks of a run of BGR24 pixels, undithered
+ *
+ * Tricolor goes 16 pixels a block through the LUT, with the block loop
+ * fully unrolled; other palettes call Dither::inkFor() per pixel. Either
+ * way there is no RGB row in between.
+ * @param bgr Source pixels, 3 bytes each
+ * @param cols Source column of each output pixel, nullptr for 1:1
+ * @param inks Output, count inks
+ * @param scratch Its tone, if set, goes through toneIndex (tricolor) or
+ *        the curve (others)
+ */
+void bgrRowToInks(const uint8_t* bgr, const uint32_t* cols, uint8_t* inks, uint32_t count,
+                  const DecodeScratch* scratch)
+{
+    constexpr uint32_t BLOCK = 16;
+    uint32_t x = 0;
+    const uint8_t* tone = scratch->tone;
+    if (s_palette != Dither::Palette::TRICOLOR) {
+        for (; x < count; x++) {
+            const uint8_t* px = bgr + (cols ? cols[x] : x) * 3;
+            inks[x] = tone ? Dither::inkFor(s_palette, tone[px[2]], tone[px[1]], tone[px[0]])
+                           : Dither::inkFor(s_palette, px[2], px[1], px[0]);
+        }
+        return;
+    }
+    if (tone) {
+        for (; x < count; x++) {
+            inks[x] = tonedTricolorInk(bgr + (cols ? cols[x] : x) * 3, scratch);
+        }
+        return;
+    }
+    if (!cols) {
+        for (; x + BLOCK <= count; x += BLOCK) {
+            const uint8_t* block = bgr + x * 3;
+            uint8_t* out = inks + x;
+#pragma GCC unroll 16
+            for (uint32_t i = 0; i < BLOCK; i++) {
+                out[i] = bgrTricolorInk(block + i * 3);
+            }
+        }
+        for (; x < count; x++) {
+            inks[x] = bgrTricolorInk(bgr + x * 3);
+        }
+        return;
+    }
+    for (; x < count; x++) {
+        inks[x] = bgrTricolorInk(bgr + cols[x] * 3);
+    }
+}
+
+/**
+ * @brief Ink of a source pixel for the fused row kernels: a palette
+ *        index of a 1/4/8 bpp row
+ */
+template <uint16_t BPP>
+struct IndexInk {
+    static uint8_t at(const uint8_t* row, uint32_t x, const DecodeScratch* scratch)
+    {
+        return scratch->paletteInk[readIndex(row, BPP, x)];
+    }
+};
+
+/**
+ * @brief Ink of a BGR24 pixel, tricolor through the LUT
+ */
+struct TricolorInk {
+    static uint8_t at(const uint8_t* row, uint32_t x, const DecodeScratch*)
+    {
+        return bgrTricolorInk(row + x * 3);
+    }
+};
+
+/**
+ * @brief TricolorInk with the tone folded into the LUT index
+ */
+struct TonedTricolorInk {
+    static uint8_t at(const uint8_t* row, uint32_t x, const DecodeScratch* scratch)
+    {
+        return tonedTricolorInk(row + x * 3, scratch);
+    }
+};
+
+/**
+ * @brief Ink of a BGR24 pixel in the other palettes
+ */
+struct BgrInk {
+    static uint8_t at(const uint8_t* row, uint32_t x, const DecodeScratch*)
+    {
+        const uint8_t* px = row + x * 3;
+        return Dither::inkFor(s_palette, px[2], px[1], px[0]);
+    }
+};
+
+/**
+ * @brief BgrInk through the tone curve
+ */
+struct TonedBgrInk {
+    static uint8_t at(const uint8_t* row, uint32_t x, const DecodeScratch* scratch)
+    {
+        const uint8_t* px = row + x * 3;
+        const uint8_t* tone = scratch->tone;
+        return Dither::inkFor(s_palette, tone[px[2]], tone[px[1]], tone[px[0]]);
+    }
+};
+
+/**
+ * @brief A row that already is EPD colors (RowScaler::pushInkRow())
+ */
+struct ColorInk {
+    static uint8_t at(const uint8_t* row, uint32_t x, const DecodeScratch*)
+    {
+        return row[x];
+    }
+};
+
+/**
+ * @brief Fused kernel: one output row from source pixels to plane bytes
+ *
+ * Each pixel is read, scaled (by its source column), quantized and packed
+ * in the same pass, 8 to a byte, and whole bytes are stored without being
+ * read back; the row never exists as EPD colors. Only for rows that are
+ * neither averaged nor dithered, which need whole rows between stages.
+ * @tparam Ink Source pixel format, with at(row, x, scratch)
+ * @tparam SAMPLED Output pixel x reads source column cols[x], else x
+ * @tparam REVERSED The run's first pixel is at its highest bit
+ * @param run Opened by PlaneSink::openRun()
+ * @param row Source row
+ * @param cols Source column of each output pixel, if SAMPLED
+ * @param scratch Palette inks and tone tables, for the Ink types that use them
+ * @param len Output pixels
+ */
+template <typename Ink, bool SAMPLED, bool REVERSED>
+void packRun(const PlaneRun& run, const uint8_t* row, const uint32_t* cols,
+             const DecodeScratch* scratch, uint32_t len)
+{
+    // i counts pixels in bit order, from the lowest bit of the run
+    auto ink = [&](uint32_t i) {
+        uint32_t x = REVERSED ? len - 1 - i : i;
+        return Ink::at(row, SAMPLED ? cols[x] : x, scratch);
+    };
+    uint32_t bit = run.bit;
+    for (uint32_t i = 0; i < len;) {
+        uint32_t addr = bit / 8;
+        uint32_t first = bit % 8;
+        uint32_t n = std::min(8 - first, len - i);
+        uint8_t black = 0;
+        uint8_t color = 0;
+        if (n == 8) {
+#pragma GCC unroll 8
+            for (uint32_t j = 0; j < 8; j++) {
+                uint8_t c = ink(i + j);
+                black = static_cast<uint8_t>((black << 1) | ((run.blackInks >> c) & 1));
+                color = static_cast<uint8_t>((color << 1) | ((run.colorInks >> c) & 1));
+            }
+            run.color[addr] = color;
+            run.black[addr] = black;
+        } else {
+            uint8_t mask = 0;
+            for (uint32_t j = 0; j < n; j++) {
+                uint8_t c = ink(i + j);
+                uint8_t m = 0x80 >> (first + j);
+                mask |= m;
+                black |= ((run.blackInks >> c) & 1) ? m : 0;
+                color |= ((run.colorInks >> c) & 1) ? m : 0;
+            }
+            run.color[addr] = (run.color[addr] & ~mask) | color;
+            run.black[addr] = (run.black[addr] & ~mask) | black;
+        }
+        i += n;
+        bit += n;
+    }
+}
+
+using RunKernel = void (*)(const PlaneRun&, const uint8_t*, const uint32_t*,
+                           const DecodeScratch*, uint32_t);
+
+template <typename Ink>
+RunKernel runKernelFor(bool sampled, bool reversed)
+{
+    if (sampled) {
+        return reversed ? packRun<Ink, true, true> : packRun<Ink, true, false>;
+    }
+    return reversed ? packRun<Ink, false, true> : packRun<Ink, false, false>;
+}
+
+/**
+ * @brief Fused kernel for an undithered, unaveraged image, chosen once per
+ *        image by source format, scale and the sink's bit order
+ * @param bpp Source bits per pixel, 0 for rows of EPD colors
+ * @param sampled Scaled, rather than 1:1
+ * @param reversed PlaneRun::reversed of the sink
+ * @param toned BGR24 pixels go through the tone; palettes carry it already
+ */
+RunKernel selectRunKernel(uint16_t bpp, bool sampled, bool reversed, bool toned)
+{
+    if (bpp == 24 && toned) {
+        return s_palette == Dither::Palette::TRICOLOR
+                   ? runKernelFor<TonedTricolorInk>(sampled, reversed)
+                   : runKernelFor<TonedBgrInk>(sampled, reversed);
+    }
+    switch (bpp) {
+        case 0:  return runKernelFor<ColorInk>(sampled, reversed);
+        case 1:  return runKernelFor<IndexInk<1>>(sampled, reversed);
+        case 4:  return runKernelFor<IndexInk<4>>(sampled, reversed);
+        case 8:  return runKernelFor<IndexInk<8>>(sampled, reversed);
+        case 24:
+            return s_palette == Dither::Palette::TRICOLOR
+                       ? runKernelFor<TricolorInk>(sampled, reversed)
+                       : runKernelFor<BgrInk>(sampled, reversed);
+        default: return nullptr;
+    }
+}
+
+/**
+ * @brief Load the BMP color table into scratch->palette / paletteInk
+ *
+ * Entries missing from the file (colorsUsed < 2^bpp) read as black.
+ * Without a usable table, indices fall back to a gray ramp. The entries
+ * carry scratch->tone, so the pixels that index them never need it.
+ */
+void readPalette(FILE* file, const ImageLoader::BMPHeader& header, DecodeScratch* scratch)
+{
+    uint32_t maxColors = 1u << header.bitsPerPixel;
+    uint32_t count = header.colorsUsed ? std::min(header.colorsUsed, maxColors) : maxColors;
+
+    memset(scratch->palette, 0, sizeof(scratch->palette));
+    bool ok = fseek(file, 14 + header.headerSize, SEEK_SET) == 0;
+    for (uint32_t i = 0; i < count && ok; i++) {
+        uint8_t quad[4];  // B, G, R, reserved
+        ok = readFile(quad, 1, sizeof(quad), file) == sizeof(quad);
+        scratch->palette[i][0] = quad[2];
+        scratch->palette[i][1] = quad[1];
+        scratch->palette[i][2] = quad[0];
+    }
+    if (!ok) {
+        ESP_LOGW(TAG_DEC, "No BMP color table, assuming grayscale");
+        for (uint32_t i = 0; i < maxColors; i++) {
+            uint8_t gray = static_cast<uint8_t>(i * 255 / (maxColors - 1));
+            scratch->palette[i][0] = scratch->palette[i][1] = scratch->palette[i][2] = gray;
+        }
+    }
+
+    if (scratch->tone) {
+        ImageDecode::applyTone(scratch->tone, scratch->palette[0], maxColors);
+    }
+    for (uint32_t i = 0; i < maxColors; i++) {
+        scratch->paletteInk[i] = Dither::inkFor(s_palette, scratch->palette[i][0],
+                                                scratch->palette[i][1], scratch->palette[i][2]);
+    }
+}
+
+} // namespace
+
+void ImageDecode::setTile(const Tile& tile)
+{
+    s_tile = tile;
+}
+
+const ImageDecode::Tile& ImageDecode::tile()
+{
+    return s_tile;
+}
+
+FitScale ImageDecode::fitScale(uint32_t imgWidth, uint32_t imgHeight)
+{
+    uint32_t width = s_tile.width;
+    uint32_t height = s_tile.height;
+    FitScale fit;
+    // width / imgWidth <= height / imgHeight, without dividing
+    if (static_cast<uint64_t>(width) * imgHeight <= static_cast<uint64_t>(height) * imgWidth) {
+        fit.num = width;
+        fit.den = imgWidth;
+    } else {
+        fit.num = height;
+        fit.den = imgHeight;
+    }
+    fit.outWidth = std::min<uint32_t>(static_cast<uint64_t>(imgWidth) * fit.num / fit.den, width);
+    fit.outHeight = std::min<uint32_t>(
+        static_cast<uint64_t>(imgHeight) * fit.num / fit.den, height);
+    fit.offsetX = s_tile.x + (width - fit.outWidth) / 2;
+    fit.offsetY = s_tile.y + (height - fit.outHeight) / 2;
+    return fit;
+}
+
+ImageDecode::DitherBand::DitherBand(const FitScale& fit, const uint8_t* tone, PlaneSink& sink)
+    : sink_(sink), tone_(tone), mode_(s_ditherMode), palette_(s_palette),
+      offsetX_(fit.offsetX), offsetY_(fit.offsetY), width_(fit.outWidth), count_(0),
+      flushed_(0)
+{
+    if (!s_stripeRunner ||
+        (mode_ != Dither::Mode::BAYER && mode_ != Dither::Mode::BLUE_NOISE)) {
+        return;
+    }
+    colors_ = SlideArena::makeArray<uint8_t>(DITHER_BAND_ROWS * width_);
+    if (colors_) {
+        rgb_ = SlideArena::makeArray<uint8_t>(DITHER_BAND_ROWS * width_ * 3);
+    }
+}
+
+void ImageDecode::DitherBand::push(uint32_t y)
+{
+    rows_[count_++] = y;
+    if (count_ == DITHER_BAND_ROWS) {
+        flush();
+    }
+}
+
+void ImageDecode::DitherBand::flush()
+{
+    if (count_ == 0) {
+        return;
+    }
+    uint32_t perStripe = rowsPerStripe();
+    s_stripeRunner((count_ + perStripe - 1) / perStripe, stripe, this);
+    for (uint32_t i = 0; i < count_; i++) {
+        writeSpan(sink_, offsetX_, offsetY_ + rows_[i], &colors_[i * width_], width_);
+    }
+    flushed_ += count_;
+    count_ = 0;
+}
+
+/**
+ * @brief One stripe of the band, on whichever core the runner gives it
+ *
+ * The modes are stateless, so a ditherer per stripe, positioned at each
+ * row, gives the pixels they would get dithered in order. It allocates nothing, which matters off the
+ * decoding task.
+ */
+void ImageDecode::DitherBand::stripe(void* ctx, size_t index)
+{
+    DitherBand* band = static_cast<DitherBand*>(ctx);
+    uint32_t perStripe = band->rowsPerStripe();
+    uint32_t end = std::min<uint32_t>((index + 1) * perStripe, band->count_);
+    Dither::RowDitherer ditherer(band->mode_, static_cast<uint16_t>(band->width_),
+                                 band->palette_);
+    for (uint32_t i = index * perStripe; i < end; i++) {
+        uint8_t* rgb = &band->rgb_[i * band->width_ * 3];
+        if (band->tone_) {
+            applyTone(band->tone_, rgb, band->width_);
+        }
+        ditherer.setPosition(band->offsetX_, band->offsetY_ + band->rows_[i]);
+        ditherer.processRow(rgb, &band->colors_[i * band->width_]);
+    }
+}
+
+ImageDecode::RowScaler::RowScaler(const FitScale& fit, uint32_t imgWidth, uint32_t imgHeight,
+                                  DecodeScratch* scratch, PlaneSink& sink)
+    : fit_(fit), imgHeight_(imgHeight), scratch_(scratch), sink_(sink),
+      offsetX_(fit.offsetX),
+      offsetY_(fit.offsetY),
+      average_(s_scaleMode == ImageLoader::ScaleMode::AREA && fit.den > fit.num),
+      ditherer_(s_ditherMode, static_cast<uint16_t>(fit.outWidth), s_palette),
+      tone_(toneCurve()), band_(fit, tone_, sink), y_(0)
+{
+    for (uint32_t x = 0; x <= fit_.outWidth; x++) {
+        scratch_->colStart[x] = std::min(fit_.source(x), imgWidth);
+    }
+    memset(scratch_->sums, 0, sizeof(scratch_->sums));
+    if (!ditherer_.ok()) {
+        ESP_LOGW(TAG_DEC, "No memory for dithering, using threshold");
+    }
+}
+
+void ImageDecode::RowScaler::pushInkRow(uint32_t srcY, const uint8_t* inks)
+{
+    while (!done() && rowStart(y_) == srcY) {
+        PlaneRun run;
+        if (openRun(sink_, offsetX_, offsetY_ + y_, fit_.outWidth, run)) {
+            SlideStats::Timer timer(SlideStats::Stage::PACK);
+            selectRunKernel(0, true, run.reversed, false)(run, inks, scratch_->colStart,
+                                                         nullptr, fit_.outWidth);
+            y_++;
+            continue;
+        }
+        for (uint32_t x = 0; x < fit_.outWidth; x++) {
+            scratch_->spanColors[x] = inks[scratch_->colStart[x]];
+        }
+        writeSpan(sink_, offsetX_, offsetY_ + y_, scratch_->spanColors, fit_.outWidth);
+        y_++;
+    }
+}
+
+void ImageDecode::RowScaler::pushRow(uint32_t srcY, const uint8_t* rgb)
+{
+    const uint32_t* colStart = scratch_->colStart;
+    if (!average_) {
+        // Upscaling samples one source row for several output rows
+        while (!done() && rowStart(y_) == srcY) {
+            uint8_t* out = outRow();
+            for (uint32_t x = 0; x < fit_.outWidth; x++) {
+                memcpy(&out[x * 3], &rgb[colStart[x] * 3], 3);
+            }
+            emitRow();
+        }
+        return;
+    }
+
+    if (done() || srcY < rowStart(y_)) {
+        return;
+    }
+    for (uint32_t x = 0; x < fit_.outWidth; x++) {
+        uint32_t sxEnd = std::max(colStart[x] + 1, colStart[x + 1]);
+        uint32_t* sum = &scratch_->sums[x * 3];
+        for (uint32_t sx = colStart[x]; sx < sxEnd; sx++) {
+            sum[0] += rgb[sx * 3];
+            sum[1] += rgb[sx * 3 + 1];
+            sum[2] += rgb[sx * 3 + 2];
+        }
+    }
+    // Box of source rows [rowStart(y), srcYEnd) x columns [colStart[x], colStart[x+1])
+    uint32_t srcYEnd = std::max(rowStart(y_) + 1, std::min(fit_.source(y_ + 1), imgHeight_));
+    if (srcY + 1 < srcYEnd) {
+        return;
+    }
+    uint8_t* out = outRow();
+    for (uint32_t x = 0; x < fit_.outWidth; x++) {
+        uint32_t sxEnd = std::max(colStart[x] + 1, colStart[x + 1]);
+        uint32_t count = (srcYEnd - rowStart(y_)) * (sxEnd - colStart[x]);
+        for (int c = 0; c < 3; c++) {
+            out[x * 3 + c] = static_cast<uint8_t>(scratch_->sums[x * 3 + c] / count);
+        }
+    }
+    memset(scratch_->sums, 0, sizeof(scratch_->sums));
+    emitRow();
+}
+
+void ImageDecode::RowScaler::emitRow()
+{
+    if (band_.active()) {
+        band_.push(y_);
+        if (++y_ == fit_.outHeight) {
+            band_.flush();
+        }
+        return;
+    }
+    if (tone_) {
+        applyTone(tone_, scratch_->rgbRow, fit_.outWidth);
+    }
+    ditherer_.setPosition(offsetX_, offsetY_ + y_);
+    ditherer_.processRow(scratch_->rgbRow, scratch_->spanColors);
+    writeSpan(sink_, offsetX_, offsetY_ + y_, scratch_->spanColors, fit_.outWidth);
+    y_++;
+}
+
+bool ImageDecode::checkBMPHeader(const ImageLoader::BMPHeader& header)
+{
+    // Check signature
+    if (header.signature != 0x4D42) {  // "BM"
+        ESP_LOGE(TAG_DEC, "Invalid BMP signature");
+        return false;
+    }
+
+    // Fields past the core header (bitsPerPixel onwards) need BITMAPINFOHEADER
+    if (header.headerSize < 40) {
+        ESP_LOGE(TAG_DEC, "Unsupported BMP header size: %u", (unsigned)header.headerSize);
+        return false;
+    }
+
+    // Check bits per pixel (support 1, 4, 8, 24)
+    if (header.bitsPerPixel != 1 && header.bitsPerPixel != 4 && 
+        header.bitsPerPixel != 8 && header.bitsPerPixel != 24) {
+        ESP_LOGE(TAG_DEC, "Unsupported bits per pixel: %d", header.bitsPerPixel);
+        return false;
+    }
+
+    // BI_RGB, or run-length encoding at its only legal depth
+    bool rle = header.compression == ImageLoader::BMP_BI_RLE8 ||
+               header.compression == ImageLoader::BMP_BI_RLE4;
+    if ((header.compression != ImageLoader::BMP_BI_RGB && !rle) ||
+        (header.compression == ImageLoader::BMP_BI_RLE8 && header.bitsPerPixel != 8) ||
+        (header.compression == ImageLoader::BMP_BI_RLE4 && header.bitsPerPixel != 4) ||
+        (rle && header.height < 0)) {
+        ESP_LOGE(TAG_DEC, "Unsupported BMP compression: %u at %d bpp",
+                 (unsigned)header.compression, header.bitsPerPixel);
+        return false;
+    }
+
+    if (header.width == 0 || header.height == 0) {
+        ESP_LOGE(TAG_DEC, "Invalid BMP dimensions");
+        return false;
+    }
+
+    return true;
+}
+
+bool ImageDecode::decodeBMP(FILE* file, PlaneSink& sink)
+{
+    // Read just the header; pixel rows are streamed below
+    ImageLoader::BMPHeader header;
+    if (fseek(file, 0, SEEK_SET) != 0 || readFile(&header, 1, sizeof(header), file) != sizeof(header)) {
+        ESP_LOGE(TAG_DEC, "Invalid file size or cannot read file");
+        return false;
+    }
+
+    if (!ImageDecode::checkBMPHeader(header)) {
+        return false;
+    }
+
+    bool rle = header.compression == ImageLoader::BMP_BI_RLE8 ||
+               header.compression == ImageLoader::BMP_BI_RLE4;
+    uint32_t imgWidth = abs(header.width);
+    uint32_t imgHeight = abs(header.height);
+    bool topDown = (header.height < 0);  // Negative height means top-down
+
+    ESP_LOGI(TAG_DEC, "BMP: %dx%d, %d bpp%s", imgWidth, imgHeight, header.bitsPerPixel,
+             rle ? ", RLE" : "");
+
+    // Row size is padded to 4 bytes
+    uint32_t rowSize = ((imgWidth * header.bitsPerPixel + 31) / 32) * 4;
+
+    // Exact aspect-fit ratio; all scaling below is integer
+    FitScale fit = fitScale(imgWidth, imgHeight);
+    uint32_t offsetX = fit.offsetX;
+    uint32_t offsetY = fit.offsetY;
+
+    // Area-average when shrinking so every source pixel contributes;
+    // upscaling always samples the nearest pixel
+    bool average = (s_scaleMode == ImageLoader::ScaleMode::AREA) && fit.den > fit.num;
+
+    // Nearest neighbour reads one source row per output row; rows further
+    // apart than the stdio buffer are read on their own
+    bool sparse = !average && static_cast<uint64_t>(rowSize) * fit.den >
+                                  static_cast<uint64_t>(SD_READ_BUFFER_SIZE) * fit.num;
+
+    // Copies: make() forwards references, which can't bind to packed fields
+    uint32_t dataOffset = header.dataOffset;
+    uint16_t bitsPerPixel = header.bitsPerPixel;
+    SlideArena::Ptr<BMPRowSource> rows;
+    if (rle) {
+        rows = SlideArena::make<RLERowReader>(
+            file, dataOffset, rowSize, imgWidth, imgHeight, bitsPerPixel);
+    } else {
+        rows = SlideArena::make<BMPRowReader>(file, dataOffset, rowSize, imgHeight, topDown,
+                                              sparse);
+    }
+    if (!rows || !rows->ok()) {
+        ESP_LOGE(TAG_DEC, "No memory for row reader");
+        return false;
+    }
+
+    // Everything white; on the device this waits for a previous upload
+    sink.begin();
+
+    SlideArena::Ptr<DecodeScratch> scratch = SlideArena::make<DecodeScratch>();
+    if (!scratch) {
+        ESP_LOGE(TAG_DEC, "No memory for decode buffers");
+        return false;
+    }
+
+    // The tone goes into the color table, or for 24-bit into the tricolor
+    // LUT index, once here; only dithered or averaged 24-bit rows take it
+    // per output pixel
+    scratch->tone = toneCurve();
+    if (header.bitsPerPixel <= 8) {
+        readPalette(file, header, scratch.get());
+    } else if (scratch->tone) {
+        buildToneIndex(scratch.get());
+    }
+
+    // Source column where each output column starts, computed once per image
+    for (uint32_t x = 0; x <= fit.outWidth; x++) {
+        scratch->colStart[x] = std::min(fit.source(x), imgWidth);
+    }
+
+    // Dither in output space, row by row as the scaler produces them
+    Dither::RowDitherer ditherer(s_ditherMode, static_cast<uint16_t>(fit.outWidth), s_palette);
+    if (!ditherer.ok()) {
+        ESP_LOGW(TAG_DEC, "No memory for dithering, using threshold");
+    }
+    bool dithered = s_ditherMode != Dither::Mode::NONE && ditherer.ok();
+    // Only 24-bit rows take the tone per pixel
+    DitherBand band(fit, header.bitsPerPixel == 24 ? scratch->tone : nullptr, sink);
+
+    uint8_t* spanColors = scratch->spanColors;
+    const uint8_t (*palette)[3] = scratch->palette;
+    uint16_t bpp = header.bitsPerPixel;
+
+    // Palettized and neither dithered nor averaged: one table load per pixel
+    bool direct = bpp <= 8 && !dithered && !average;
+    // 24-bit, neither dithered nor averaged: BGR straight to inks
+    bool bgrDirect = bpp == 24 && !dithered && !average;
+    const uint32_t* bgrCols = fit.num == fit.den ? nullptr : scratch->colStart;
+    // Either, into a sink that opens plane runs: straight to plane bytes.
+    // Chosen at the first run, which tells the sink's bit order
+    RunKernel kernel = nullptr;
+
+    // Bottom-up files (and RLE, always bottom-up) are decoded bottom row
+    // first, so the file is read front to back with no backward seek; the
+    // sink takes rows in any order. Error diffusion then runs upwards
+    bool bottomUp = rle || !topDown;
+
+    bool ok = true;
+    for (uint32_t i = 0; i < fit.outHeight && ok; i++) {
+        if (ImageDecode::aborted()) {
+            ok = false;
+            break;
+        }
+        uint32_t y = bottomUp ? fit.outHeight - 1 - i : i;
+        uint32_t srcY = std::min(fit.source(y), imgHeight - 1);
+        uint8_t* rgbRow = band.active() ? band.row() : scratch->rgbRow;
+
+        if (!average) {
+            const uint8_t* pixelData = rows->row(srcY);
+            if (!pixelData) {
+                ESP_LOGE(TAG_DEC, "Failed to read row %u", (unsigned)srcY);
+                ok = false;
+                break;
+            }
+            PlaneRun run;
+            if ((direct || bgrDirect) && openRun(sink, offsetX, offsetY + y, fit.outWidth, run)) {
+                if (!kernel) {
+                    kernel = selectRunKernel(bpp, fit.num != fit.den, run.reversed,
+                                             scratch->tone != nullptr);
+                }
+                SlideStats::Timer timer(SlideStats::Stage::PACK);
+                kernel(run, pixelData, scratch->colStart, scratch.get(), fit.outWidth);
+                continue;
+            }
+            if (direct) {
+                for (uint32_t x = 0; x < fit.outWidth; x++) {
+                    spanColors[x] = scratch->paletteInk[readIndex(pixelData, bpp, scratch->colStart[x])];
+                }
+            } else if (bgrDirect) {
+                bgrRowToInks(pixelData, bgrCols, spanColors, fit.outWidth, scratch.get());
+            } else {
+                for (uint32_t x = 0; x < fit.outWidth; x++) {
+                    readPixel(pixelData, bpp, scratch->colStart[x], palette, &rgbRow[x * 3]);
+                }
+            }
+        } else {
+            // Box of source rows [srcY, srcYEnd) x columns [colStart[x], colStart[x+1])
+            uint32_t srcYEnd = std::max(srcY + 1, std::min(fit.source(y + 1), imgHeight));
+            memset(scratch->sums, 0, sizeof(scratch->sums));
+            for (uint32_t k = 0; k < srcYEnd - srcY; k++) {
+                uint32_t sy = bottomUp ? srcYEnd - 1 - k : srcY + k;
+                const uint8_t* pixelData = rows->row(sy);
+                if (!pixelData) {
+                    ESP_LOGE(TAG_DEC, "Failed to read row %u", (unsigned)sy);
+                    ok = false;
+                    break;
+                }
+                for (uint32_t x = 0; x < fit.outWidth; x++) {
+                    uint32_t sxEnd = std::max(scratch->colStart[x] + 1, scratch->colStart[x + 1]);
+                    uint32_t* sum = &scratch->sums[x * 3];
+                    for (uint32_t sx = scratch->colStart[x]; sx < sxEnd; sx++) {
+                        uint8_t px[3];
+                        readPixel(pixelData, bpp, sx, palette, px);
+                        sum[0] += px[0];
+                        sum[1] += px[1];
+                        sum[2] += px[2];
+                    }
+                }
+            }
+            if (!ok) {
+                break;
+            }
+            for (uint32_t x = 0; x < fit.outWidth; x++) {
+                uint32_t sxEnd = std::max(scratch->colStart[x] + 1, scratch->colStart[x + 1]);
+                uint32_t count = (srcYEnd - srcY) * (sxEnd - scratch->colStart[x]);
+                for (int c = 0; c < 3; c++) {
+                    rgbRow[x * 3 + c] = static_cast<uint8_t>(scratch->sums[x * 3 + c] / count);
+                }
+            }
+        }
+
+        if (band.active()) {
+            band.push(y);
+            continue;
+        }
+        if (!direct && !bgrDirect) {
+            if (scratch->tone && bpp == 24) {
+                applyTone(scratch->tone, rgbRow, fit.outWidth);
+            }
+            ditherer.setPosition(offsetX, offsetY + y);
+            ditherer.processRow(rgbRow, spanColors);
+        }
+
+        // One span per output row: the framebuffer address is computed once
+        // and pixels are packed a byte at a time
+        writeSpan(sink, offsetX, offsetY + y, spanColors, fit.outWidth);
+    }
+    if (ok) {
+        band.flush();
+    }
+
+    return ok;
+}
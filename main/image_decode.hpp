@@ -0,0 +1,353 @@
+/**
+ * @file image_decode.hpp
+ * @brief Decode pipeline shared by the image formats: scale, dither, pack
+ *
+ * Nothing here depends on the panel driver or the SD card: files are plain
+ * FILE* and decoded rows go to a PlaneSink as spans of EPD colors. The
+ * image loader puts the display framebuffer behind the sink;
+ * tools/host_bench runs the same code on a workstation.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <algorithm>
+#include "config.hpp"
+#include "dither.hpp"
+#include "image_loader.hpp"
+
+namespace ImageDecode {
+
+/**
+ * @brief A run of a row in two bit planes, 8 pixels a byte, that the fused
+ *        row kernels pack directly; see PlaneSink::openRun()
+ */
+struct PlaneRun {
+    uint8_t* black;     // Black plane
+    uint8_t* color;     // Color plane, stored before black (they may be one)
+    uint32_t bit;       // Lowest bit of the run: byte bit / 8, mask 0x80 >> bit % 8
+    bool reversed;      // The first pixel is at the highest bit, not the lowest
+    uint8_t blackInks;  // Bit c set: EPD color c sets its black plane bit
+    uint8_t colorInks;  // Bit c set: EPD color c sets its color plane bit
+};
+
+/**
+ * @brief Where decoded rows go
+ */
+class PlaneSink {
+public:
+    virtual ~PlaneSink() = default;
+
+    /**
+     * @brief Start a frame: every pixel of the tile() white and safe to write
+     */
+    virtual void begin() = 0;
+
+    /**
+     * @brief Write a horizontal run of pixels
+     *
+     * Rows may come in any order: bottom-up BMPs are written bottom row
+     * first.
+     * @param x Leftmost pixel, logical (rotated) coordinates
+     * @param y Row
+     * @param colors One EPD color per pixel
+     * @param len Number of pixels
+     */
+    virtual void writeSpan(int16_t x, int16_t y, const uint8_t* colors, int16_t len) = 0;
+
+    /**
+     * @brief Open a run of a row for packing in place, in place of a
+     *        writeSpan() of the same pixels
+     *
+     * Sinks whose rows lie along the bytes of two bit planes return them
+     * here; the decoder then goes from source pixels to plane bytes in one
+     * pass, without a row of EPD colors in between.
+     * @param run Set to the run's planes and bit position
+     * @return false to take the row through writeSpan(), the default
+     */
+    virtual bool openRun(int16_t /* x */, int16_t /* y */, int16_t /* len */,
+                         PlaneRun& /* run */)
+    {
+        return false;
+    }
+};
+
+/**
+ * @brief fread(), timed as SlideStats::Stage::READ
+ */
+size_t readFile(void* dst, size_t size, size_t count, FILE* file);
+
+/**
+ * @brief Poll RenderJob::cancelled() between rows
+ * @return true if the current decode should be abandoned
+ */
+bool aborted();
+
+/**
+ * @brief Set the tone of the image about to be decoded: its sidecar's, or
+ *        ImageLoader::getTone() (which ImageLoader::setTone() also sets)
+ */
+void setImageTone(const ImageLoader::Tone& tone);
+
+/**
+ * @brief Tone of the image being decoded as a table of 256 levels
+ *
+ * Rebuilt only when the tone changes, so an unchanged tone costs nothing
+ * at image start either.
+ * @return nullptr if the tone is linear
+ */
+const uint8_t* toneCurve();
+
+/**
+ * @brief Put count RGB triplets through a toneCurve() table, in place
+ */
+void applyTone(const uint8_t* curve, uint8_t* rgb, uint32_t count);
+
+/**
+ * @brief Runs work(ctx, i) for every i in [0, count), on as many cores as it
+ *        has, and returns once all have finished
+ */
+using StripeRunner = void (*)(size_t count, void (*work)(void* ctx, size_t index), void* ctx);
+
+/**
+ * @brief Install the runner DitherBand spreads its stripes over
+ * @param runner nullptr: rows are dithered one at a time as they come (the default)
+ */
+void setStripeRunner(StripeRunner runner);
+
+/**
+ * @brief Rectangle of the display that images are fitted into, in logical
+ *        (rotated) coordinates
+ */
+struct Tile {
+    int16_t x;
+    int16_t y;
+    int16_t width;
+    int16_t height;
+
+    bool fullScreen() const
+    {
+        return x == 0 && y == 0 && width == DISPLAY_WIDTH && height == DISPLAY_HEIGHT;
+    }
+};
+
+static constexpr Tile FULL_SCREEN = { 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT };
+
+/**
+ * @brief Fit the images decoded from now on into tile instead of the whole
+ *        display (collage tiles); FULL_SCREEN goes back
+ *
+ * Sinks clear only the tile in begin(), so the tiles already decoded stay.
+ */
+void setTile(const Tile& tile);
+
+/**
+ * @brief The tile images are fitted into, FULL_SCREEN unless setTile()
+ */
+const Tile& tile();
+
+/**
+ * @brief Aspect-fit scale factor as an exact ratio num/den
+ */
+struct FitScale {
+    uint32_t num;
+    uint32_t den;
+    uint32_t outWidth;   // Scaled image size, within the tile()
+    uint32_t outHeight;
+    uint32_t offsetX;    // Display position of the scaled image, centered in the tile()
+    uint32_t offsetY;
+
+    /** @brief Source index where output index i starts (floor(i * den / num)) */
+    uint32_t source(uint32_t i) const
+    {
+        return static_cast<uint32_t>(static_cast<uint64_t>(i) * den / num);
+    }
+};
+
+/**
+ * @brief Fit an image into the tile() (the whole display unless a collage
+ *        set one), keeping its aspect
+ */
+FitScale fitScale(uint32_t imgWidth, uint32_t imgHeight);
+
+/**
+ * @brief Per-image decode buffers, kept off the (small) caller stack
+ */
+struct DecodeScratch {
+    uint32_t colStart[DISPLAY_WIDTH + 1];  // Source column per output column
+    uint32_t sums[DISPLAY_WIDTH * 3];      // Area-average accumulators
+    uint8_t rgbRow[DISPLAY_WIDTH * 3];     // One scaled output row, RGB
+    uint8_t spanColors[DISPLAY_WIDTH];     // Its EPD colors
+    uint8_t palette[256][3];               // Color table as RGB (1/4/8 bpp)
+    uint8_t paletteInk[256];               // Color table index -> EPD color
+    const uint8_t* tone;                   // toneCurve(), nullptr if linear
+    uint16_t toneIndex[3][256];            // R, G, B level -> toned tricolor LUT index bits
+};
+
+/**
+ * @brief Output rows dithered DITHER_BAND_ROWS at a time, in stripes that
+ *        a StripeRunner works through on several cores
+ *
+ * Only for the modes that keep no state between rows (Bayer, blue noise),
+ * with a runner installed and memory for the band; active() tells. Error
+ * diffusion can't be split this way: each row needs the error of the one
+ * before. The stripes are toned and dithered in parallel; the spans are
+ * then written in the order the rows were pushed by the task that decodes,
+ * so sinks need no locking.
+ */
+class DitherBand {
+public:
+    /**
+     * @param tone toneCurve() for rows that still need it, else nullptr
+     */
+    DitherBand(const FitScale& fit, const uint8_t* tone, PlaneSink& sink);
+
+    DitherBand(const DitherBand&) = delete;
+    DitherBand& operator=(const DitherBand&) = delete;
+
+    /** @brief Rows go through the band (otherwise dither them directly) */
+    bool active() const
+    {
+        return rgb_ != nullptr;
+    }
+
+    /** @brief Where the next row's RGB goes, fit.outWidth triplets */
+    uint8_t* row()
+    {
+        return &rgb_[count_ * width_ * 3];
+    }
+
+    /** @brief The rows after this one were already toned */
+    void setTone(const uint8_t* tone)
+    {
+        tone_ = tone;
+    }
+
+    /**
+     * @brief row() is filled with output row y; dithers and writes the band
+     *        once it is full
+     */
+    void push(uint32_t y);
+
+    /** @brief Dither and write the rows pushed so far */
+    void flush();
+
+private:
+    static void stripe(void* ctx, size_t index);
+
+    uint32_t rowsPerStripe() const
+    {
+        return (count_ + DITHER_BAND_STRIPES - 1) / DITHER_BAND_STRIPES;
+    }
+
+    PlaneSink& sink_;
+    const uint8_t* tone_;
+    Dither::Mode mode_;
+    Dither::Palette palette_;
+    uint32_t offsetX_;
+    uint32_t offsetY_;
+    uint32_t width_;
+    uint32_t count_;
+    uint32_t flushed_;  // Rows of earlier bands, which Bayer's pattern counts
+    uint32_t rows_[DITHER_BAND_ROWS];  // Output row of each band row
+    SlideArena::Ptr<uint8_t[]> rgb_;
+    SlideArena::Ptr<uint8_t[]> colors_;
+};
+
+/**
+ * @brief Fits source rows pushed in top-down order onto the display
+ *
+ * For decoders that produce the whole image sequentially (JPEG, PNG). Each
+ * output row is either sampled from its first source row or area-averaged
+ * over all of them as they arrive, then dithered and written as one span.
+ */
+class RowScaler {
+public:
+    RowScaler(const FitScale& fit, uint32_t imgWidth, uint32_t imgHeight,
+              DecodeScratch* scratch, PlaneSink& sink);
+
+    /** @brief All output rows have been written */
+    bool done() const
+    {
+        return y_ >= fit_.outHeight;
+    }
+
+    /** @brief Output rows are area-averaged (so pushInkRow() can't be used) */
+    bool averaging() const
+    {
+        return average_;
+    }
+
+    /**
+     * @brief Consume the next source row, already quantized to EPD colors
+     *
+     * Pixels are only sampled: no averaging, no dithering.
+     *
+     * @param srcY Row index, must increase by one per call
+     * @param inks Source row, one EPD color per pixel
+     */
+    void pushInkRow(uint32_t srcY, const uint8_t* inks);
+
+    /**
+     * @brief Consume the next source row
+     *
+     * Output rows go through toneCurve() before they are dithered, unless
+     * tonedSource() was called.
+     * @param srcY Row index, must increase by one per call
+     * @param rgb Source row as R, G, B byte triplets
+     */
+    void pushRow(uint32_t srcY, const uint8_t* rgb);
+
+    /** @brief Source rows already carry the tone (read from a toned palette) */
+    void tonedSource()
+    {
+        tone_ = nullptr;
+        band_.setTone(nullptr);
+    }
+
+private:
+    uint32_t rowStart(uint32_t y) const
+    {
+        return std::min(fit_.source(y), imgHeight_ - 1);
+    }
+
+    // Where pushRow() puts the next output row
+    uint8_t* outRow()
+    {
+        return band_.active() ? band_.row() : scratch_->rgbRow;
+    }
+
+    void emitRow();
+
+    FitScale fit_;
+    uint32_t imgHeight_;
+    DecodeScratch* scratch_;
+    PlaneSink& sink_;
+    uint32_t offsetX_;
+    uint32_t offsetY_;
+    bool average_;
+    Dither::RowDitherer ditherer_;
+    const uint8_t* tone_;
+    DitherBand band_;
+    uint32_t y_;
+};
+
+/**
+ * @brief Check that decodeBMP() supports a file with this header
+ *
+ * Signature, BITMAPINFOHEADER or later, 1/4/8/24 bpp, BI_RGB or RLE at its
+ * depth (bottom-up only) and a non-empty size; logs what is wrong.
+ */
+bool checkBMPHeader(const ImageLoader::BMPHeader& header);
+
+/**
+ * @brief Decode a BMP (1/4/8/24 bpp, BI_RGB or RLE) into the sink
+ * @param file Open BMP file, positioned anywhere; the caller closes it
+ * @param sink Receives the fitted, dithered frame
+ * @return true if every output row was written
+ */
+bool decodeBMP(FILE* file, PlaneSink& sink);
+
+} // namespace ImageDecode
@@ -4,33 +4,1343 @@
  */
 
 #include "image_loader.hpp"
+#include "image_decode.hpp"
+#include "collage.hpp"
+#include "captions.hpp"
+#include "frame_codec.hpp"
+#include "dither.hpp"
 #include "sd_card.hpp"
 #include "config.hpp"
+#include "slide_stats.hpp"
+#include "slide_arena.hpp"
+#include "read_ahead.hpp"
+#include "panel.hpp"
+#include "boot_profile.hpp"
 #include "esp_log.h"
+#include "sdkconfig.h"
 #include "../components/Adafruit_EPD/src/Adafruit_EPD.h"
+#include "../components/Adafruit_EPD/src/EPDPlaneView.h"
 #include <cstring>
 #include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cinttypes>
+#include <memory>
+#include <new>
+#include <strings.h>
+
+#include "miniz.h"
+
+#if CONFIG_JD_USE_ROM
+#include "rom/tjpgd.h"
+using JpegSize = unsigned int;       // ROM TJpgDec callback types
+using JpegOutResult = unsigned int;
+#else
+#include "tjpgd.h"
+using JpegSize = size_t;
+using JpegOutResult = int;
+#endif
 
 static const char* TAG_IMG = "ImageLoader";
 
-uint16_t ImageLoader::rgbToEinkColor(uint8_t r, uint8_t g, uint8_t b)
-{
-    // Simple color quantization for tricolor e-ink
-    // Convert RGB to grayscale first
-    uint8_t gray = (r * 30 + g * 59 + b * 11) / 100;
-    
-    // Determine if pixel should be red (warm colors)
-    bool isRed = (r > 128 && r > g && r > b);
-    
-    // Determine if pixel should be black (dark) or white (light)
-    if (gray < 85) {
-        return EPD_BLACK;
-    } else if (isRed && gray > 100) {
-        return EPD_RED;
-    } else {
-        return EPD_WHITE;
+// TJpgDec work area (ROM: 3100 bytes) and the tallest MCU (4:2:0, 16 rows)
+static constexpr size_t JPEG_WORK_SIZE = 3500;
+static constexpr uint32_t JPEG_MAX_MCU_ROWS = 16;
+
+// PNG IHDR color types, and the compressed-data read size
+static constexpr uint8_t PNG_GRAY = 0;
+static constexpr uint8_t PNG_RGB = 2;
+static constexpr uint8_t PNG_PALETTE = 3;
+static constexpr uint8_t PNG_GRAY_ALPHA = 4;
+static constexpr uint8_t PNG_RGBA = 6;
+static constexpr size_t PNG_INPUT_SIZE = 1024;
+
+// QOI header and chunk tags (qoiformat.org), and the encoded-data read size
+static constexpr size_t QOI_HEADER_SIZE = 14;
+static constexpr uint8_t QOI_OP_INDEX = 0x00;
+static constexpr uint8_t QOI_OP_DIFF = 0x40;
+static constexpr uint8_t QOI_OP_LUMA = 0x80;
+static constexpr uint8_t QOI_OP_RUN = 0xC0;
+static constexpr uint8_t QOI_OP_RGB = 0xFE;
+static constexpr uint8_t QOI_OP_RGBA = 0xFF;
+static constexpr size_t QOI_INPUT_SIZE = 512;
+static constexpr size_t EPD_STREAM_CHUNK_SIZE = 512;  // One sector per SD read
+static constexpr int JPEG_PROBE_MAX_SEGMENTS = 32;    // Markers probe() reads before SOF
+
+using ImageDecode::DecodeScratch;
+using ImageDecode::FitScale;
+using ImageDecode::RowScaler;
+using ImageDecode::fitScale;
+using ImageDecode::readFile;
+
+static bool s_cacheEnabled = IMAGE_CACHE_ENABLED;
+
+void ImageLoader::setCacheEnabled(bool enabled)
+{
+    s_cacheEnabled = enabled;
+}
+
+bool ImageLoader::isCacheEnabled()
+{
+    return s_cacheEnabled;
+}
+
+/**
+ * @brief Adafruit_EPD::waitFramebufferFree(), timed as SlideStats::Stage::WAIT
+ */
+static void waitFramebufferFree(Adafruit_IL0373* display)
+{
+    SlideStats::Timer timer(SlideStats::Stage::WAIT);
+    display->waitFramebufferFree();
+}
+
+/**
+ * @brief Decoded rows into the display framebuffer
+ *
+ * Uses the panel layout fixed in config.hpp, with the address math resolved
+ * at compile time, when the display matches it; Adafruit_EPD::writeSpan()
+ * otherwise. When that layout runs rows across the buffer bytes (landscape
+ * on THINKINK_STANDARD), rows are gathered into blocks of
+ * PanelView::TILE_ROWS and packed a whole byte at a time with
+ * EPDPlaneView::writeTile(); when it runs them along the bytes, undithered
+ * rows are packed by the decoder's fused kernels through openRun(). Create
+ * one per decode, after any swapBuffers(), inside the decode's
+ * SlideArena::Scope; the last block is written when the sink is destroyed.
+ */
+class DisplaySink : public ImageDecode::PlaneSink {
+public:
+    using PanelView = EPDPlaneView<DISPLAY_NATIVE_WIDTH, DISPLAY_NATIVE_HEIGHT,
+                                   DISPLAY_ROTATION, THINKINK_STANDARD>;
+
+    explicit DisplaySink(Adafruit_IL0373* display)
+        : display_(display), direct_(view_.attach(*display)),
+          blackInks_(view_.inkMask(true)), colorInks_(view_.inkMask(false))
+    {
+    }
+
+    ~DisplaySink() override
+    {
+        flushTile();
+    }
+
+    void begin() override
+    {
+        // A previous displayAsync() may still be uploading the framebuffer
+        waitFramebufferFree(display_);
+        const ImageDecode::Tile& area = ImageDecode::tile();
+        if (area.fullScreen()) {
+            display_->clearBuffer();
+        } else {
+            display_->fillRect(area.x, area.y, area.width, area.height, EPD_WHITE);
+        }
+
+        if (!PanelView::ROWS_ALONG_BYTES && direct_ && !tile_) {
+            // Without it, rows go one bit per byte through writeSpan()
+            tile_ = SlideArena::makeArray<uint8_t>(PanelView::TILE_ROWS * PanelView::WIDTH);
+            if (tile_) {
+                memset(tile_.get(), SKIP, PanelView::TILE_ROWS * PanelView::WIDTH);
+            }
+        }
+    }
+
+    void writeSpan(int16_t x, int16_t y, const uint8_t* colors, int16_t len) override
+    {
+        if (tile_) {
+            gatherRow(x, y, colors, len);
+        } else if (direct_) {
+            view_.writeSpan(x, y, colors, len);
+        } else {
+            display_->writeSpan(x, y, colors, len);
+        }
+    }
+
+    bool openRun(int16_t x, int16_t y, int16_t len, ImageDecode::PlaneRun& run) override
+    {
+        if (!PanelView::ROWS_ALONG_BYTES || !direct_) {
+            return false;
+        }
+        int32_t bit = view_.openRun(x, y, len, &run.black, &run.color);
+        if (bit < 0) {
+            return false;
+        }
+        run.bit = static_cast<uint32_t>(bit);
+        run.reversed = PanelView::STEP_X < 0;
+        run.blackInks = blackInks_;
+        run.colorInks = colorInks_;
+        return true;
+    }
+
+private:
+    // Tile color for pixels no span covered: writeTile() leaves them alone
+    static constexpr uint8_t SKIP = 0xFF;
+
+    /**
+     * @brief Copy a row into its block, writing out the previous block first
+     */
+    void gatherRow(int16_t x, int16_t y, const uint8_t* colors, int16_t len)
+    {
+        if (x < 0) {
+            colors -= x;
+            len += x;
+            x = 0;
+        }
+        len = std::min<int16_t>(len, PanelView::WIDTH - x);
+        if (len <= 0 || y < 0 || y >= PanelView::HEIGHT) {
+            return;
+        }
+        int16_t start = PanelView::tileStart(y);
+        if (tileMinX_ < tileMaxX_ && start != tileY_) {
+            flushTile();
+        }
+        tileY_ = start;
+        memcpy(tile_.get() + (y - start) * PanelView::WIDTH + x, colors, len);
+        tileMinX_ = std::min<int16_t>(tileMinX_, x);
+        tileMaxX_ = std::max<int16_t>(tileMaxX_, x + len);
+    }
+
+    /**
+     * @brief Write the gathered block and mark it empty again
+     */
+    void flushTile()
+    {
+        if (!tile_ || tileMinX_ >= tileMaxX_) {
+            return;
+        }
+        int16_t len = tileMaxX_ - tileMinX_;
+        view_.writeTile(tileMinX_, tileY_, tile_.get() + tileMinX_, PanelView::WIDTH, len);
+        for (int16_t r = 0; r < PanelView::TILE_ROWS; r++) {
+            memset(tile_.get() + r * PanelView::WIDTH + tileMinX_, SKIP, len);
+        }
+        tileMinX_ = PanelView::WIDTH;
+        tileMaxX_ = 0;
+    }
+
+    Adafruit_IL0373* display_;
+    PanelView view_;
+    bool direct_;
+    uint8_t blackInks_;                         // PlaneRun masks, from the view
+    uint8_t colorInks_;
+    SlideArena::Ptr<uint8_t[]> tile_;           // TILE_ROWS rows of colors, SKIP if unset
+    int16_t tileY_ = 0;                         // First row of the gathered block
+    int16_t tileMinX_ = PanelView::WIDTH;       // Columns written so far, empty if
+    int16_t tileMaxX_ = 0;                      // tileMinX_ >= tileMaxX_
+};
+
+/**
+ * @brief SDCard::openFile() with its stdio buffer in the slide arena
+ *
+ * Call inside a SlideArena::Scope and fclose() before it ends.
+ */
+static FILE* openImageFile(const char* filepath)
+{
+    return SDCard::openFile(filepath, nullptr, SlideArena::alloc(SD_READ_BUFFER_SIZE, 4));
+}
+
+static bool hasExtension(const char* filepath, const char* ext)
+{
+    size_t pathLen = strlen(filepath);
+    size_t extLen = strlen(ext);
+    return pathLen >= extLen && strcasecmp(filepath + pathLen - extLen, ext) == 0;
+}
+
+/**
+ * @brief Where a packed frame's bytes come from: an open file, or a
+ *        caller's reader (loadAndDisplayEPD(FrameReader, ...))
+ */
+struct FrameSource {
+    ImageLoader::FrameReader read;
+    void* ctx;
+};
+
+static size_t readFromFile(void* ctx, void* dst, size_t len)
+{
+    SDCard::BusBurst burst;
+    return readFile(dst, 1, len, static_cast<FILE*>(ctx));
+}
+
+static FrameSource fileSource(FILE* file)
+{
+    return FrameSource{ readFromFile, file };
+}
+
+/**
+ * @brief A pack entry read through SDCard::ImagePack::read(), front to back
+ */
+struct PackFrame {
+    SDCard::ImagePack* pack;
+    uint32_t offset;
+    uint32_t left;
+};
+
+static size_t readFromPack(void* ctx, void* dst, size_t len)
+{
+    PackFrame* frame = static_cast<PackFrame*>(ctx);
+    size_t n = frame->pack->read(frame->offset, dst, std::min<size_t>(len, frame->left));
+    frame->offset += n;
+    frame->left -= n;
+    return n;
+}
+
+/**
+ * @brief Source for a pack entry: the card's sectors for a direct() pack,
+ *        else the pack handle positioned at the entry
+ * @param frame Holds the read position of a direct() source; must outlive it
+ * @return false if the entry can't be reached
+ */
+static bool packSource(SDCard::ImagePack& pack, size_t index, PackFrame& frame,
+                       FrameSource& source)
+{
+    if (pack.direct() && index < pack.size()) {
+        frame = PackFrame{ &pack, pack.entry(index).offset, pack.entry(index).length };
+        source = FrameSource{ readFromPack, &frame };
+        return true;
+    }
+    FILE* file = pack.seek(index);
+    if (!file) {
+        ESP_LOGE(TAG_IMG, "Cannot seek to pack entry %zu", index);
+        return false;
+    }
+    source = fileSource(file);
+    return true;
+}
+
+/**
+ * @brief A frame already in memory (mapped from flash), read front to back
+ */
+struct MemoryFrame {
+    const uint8_t* pos;
+    size_t left;
+};
+
+static size_t readFromMemory(void* ctx, void* dst, size_t len)
+{
+    MemoryFrame* frame = static_cast<MemoryFrame*>(ctx);
+    len = std::min(len, frame->left);
+    memcpy(dst, frame->pos, len);
+    frame->pos += len;
+    frame->left -= len;
+    return len;
+}
+
+/**
+ * @brief Consume the next bytes of a memory source without copying them
+ * @return Where they lie, or nullptr if the source isn't in memory or is
+ *         shorter than len
+ */
+static const uint8_t* takeFromMemory(const FrameSource& source, size_t len)
+{
+    if (source.read != readFromMemory) {
+        return nullptr;
+    }
+    MemoryFrame* frame = static_cast<MemoryFrame*>(source.ctx);
+    if (frame->left < len) {
+        return nullptr;
+    }
+    const uint8_t* bytes = frame->pos;
+    frame->pos += len;
+    frame->left -= len;
+    return bytes;
+}
+
+/**
+ * @brief Read an EPDImageHeader and check it against the display's layout
+ *
+ * A version 1 header is completed as the RAW frame it is.
+ */
+static bool readPackedHeader(const FrameSource& source, Adafruit_IL0373* display,
+                             ImageLoader::EPDImageHeader& header)
+{
+    constexpr size_t v1Size = ImageLoader::EPD_IMAGE_V1_HEADER_SIZE;
+    static_assert(sizeof(header) > v1Size, "version 2 extends the version 1 header");
+    if (source.read(source.ctx, &header, v1Size) != v1Size ||
+        header.magic != ImageLoader::EPD_IMAGE_MAGIC) {
+        ESP_LOGE(TAG_IMG, "Invalid .epd header");
+        return false;
+    }
+    if (header.version == 1) {
+        header.encoding = ImageLoader::EPD_ENCODING_RAW;
+        header.panel = 0;
+        header.rotation = display->getRotation();
+        header.plane1Stored = header.plane1Size;
+        header.plane2Stored = header.plane2Size;
+    } else if (header.version != ImageLoader::EPD_IMAGE_VERSION ||
+               source.read(source.ctx, reinterpret_cast<uint8_t*>(&header) + v1Size,
+                           sizeof(header) - v1Size) != sizeof(header) - v1Size) {
+        ESP_LOGE(TAG_IMG, "Unsupported .epd version %d", header.version);
+        return false;
+    }
+    if (!FrameCodec::supported(header.encoding) ||
+        (header.panel != 0 && header.panel != Panel::active().id)) {
+        ESP_LOGE(TAG_IMG, ".epd encoding %d for panel %d can't be shown here",
+                 header.encoding, header.panel);
+        return false;
+    }
+
+    // The planes are framebuffer bytes, so they only fit the exact layout
+    // they were packed for
+    bool planesMatch =
+        header.rotation == display->getRotation() &&
+        header.entryMode == display->getDataEntryMode() &&
+        header.width == display->width() && header.height == display->height() &&
+        header.plane1Size == display->getBufferSize(0) &&
+        (header.planeCount == 1 ||
+         (header.planeCount == 2 && display->getBufferSize(1) != 0 &&
+          header.plane2Size == display->getBufferSize(1)));
+    if (!planesMatch) {
+        ESP_LOGE(TAG_IMG, ".epd v%d %dx%d mode %d doesn't match display %dx%d mode %d",
+                 header.version, header.width, header.height, header.entryMode,
+                 display->width(), display->height(), display->getDataEntryMode());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Decode one stored plane into a buffer of its decoded size
+ * @param work FrameCodec::workSize() bytes; may be empty for RAW planes
+ */
+static bool readPackedPlane(const FrameSource& source, const ImageLoader::EPDImageHeader& header,
+                            uint8_t plane, uint8_t* dst, uint8_t* work)
+{
+    uint32_t size = plane == 0 ? header.plane1Size : header.plane2Size;
+    uint32_t stored = plane == 0 ? header.plane1Stored : header.plane2Stored;
+    FrameCodec::PlaneDecoder decoder(source.read, source.ctx, header.encoding, stored, work);
+    return decoder.read(dst, size) == size && decoder.finished();
+}
+
+/**
+ * @brief Decoder scratch for a frame's encoded planes, none for RAW frames
+ *
+ * From the slide arena: call inside a SlideArena::Scope.
+ */
+static SlideArena::Ptr<uint8_t[]> decoderWork(const ImageLoader::EPDImageHeader& header)
+{
+    size_t size = FrameCodec::workSize(header.encoding);
+    if (size == 0) {
+        return SlideArena::Ptr<uint8_t[]>();
+    }
+    return SlideArena::makeArray<uint8_t>(size);
+}
+
+/**
+ * @brief Read a packed .epd frame straight into the display framebuffer
+ * @param source Positioned at the EPDImageHeader
+ * @param display Display whose buffers receive the planes
+ * @return true if the header matched the display and both planes were read
+ */
+static bool readPackedFrame(const FrameSource& source, Adafruit_IL0373* display)
+{
+    uint8_t* plane1 = display->getBuffer(0);
+    uint8_t* plane2 = display->getBuffer(1);
+    if (!plane1) {
+        ESP_LOGE(TAG_IMG, "Display has no on-chip framebuffer");
+        return false;
+    }
+
+    ImageLoader::EPDImageHeader header;
+    if (!readPackedHeader(source, display, header)) {
+        return false;
+    }
+    SlideArena::Ptr<uint8_t[]> work = decoderWork(header);
+    if (header.encoding != ImageLoader::EPD_ENCODING_RAW && !work) {
+        ESP_LOGE(TAG_IMG, "Out of memory for the .epd decoder");
+        return false;
+    }
+
+    // A previous displayAsync() may still be uploading the framebuffer
+    waitFramebufferFree(display);
+
+    if (header.planeCount == 1) {
+        // Black-only frame: leave the color plane blank
+        display->clearBuffer();
+    }
+
+    bool ok = readPackedPlane(source, header, 0, plane1, work.get());
+    if (ok && header.planeCount == 2) {
+        ok = readPackedPlane(source, header, 1, plane2, work.get());
+    }
+    if (!ok) {
+        ESP_LOGE(TAG_IMG, "Truncated or corrupt .epd plane data");
+        return false;
+    }
+    BootProfile::mark(BootProfile::Mark::FRAME_READY);
+    return true;
+}
+
+static bool readPackedFrame(FILE* file, Adafruit_IL0373* display)
+{
+    return readPackedFrame(fileSource(file), display);
+}
+
+/**
+ * @brief XOR a delta pack entry's planes onto the framebuffer, which holds
+ *        the entry before it
+ * @param source Positioned at the EPDImageHeader
+ */
+static bool applyPackedDelta(const FrameSource& source, Adafruit_IL0373* display)
+{
+    ImageLoader::EPDImageHeader header;
+    if (!readPackedHeader(source, display, header)) {
+        return false;
+    }
+    SlideArena::Ptr<uint8_t[]> work = decoderWork(header);
+    SlideArena::Ptr<uint8_t[]> chunk = SlideArena::makeArray<uint8_t>(EPD_STREAM_CHUNK_SIZE);
+    if (!chunk || (header.encoding != ImageLoader::EPD_ENCODING_RAW && !work)) {
+        ESP_LOGE(TAG_IMG, "Out of memory for the .epd decoder");
+        return false;
+    }
+
+    for (uint8_t plane = 0; plane < header.planeCount; plane++) {
+        uint8_t* dst = display->getBuffer(plane);
+        uint32_t size = plane == 0 ? header.plane1Size : header.plane2Size;
+        uint32_t stored = plane == 0 ? header.plane1Stored : header.plane2Stored;
+        FrameCodec::PlaneDecoder decoder(source.read, source.ctx, header.encoding, stored,
+                                         work.get());
+        for (uint32_t done = 0; done < size;) {
+            size_t len = std::min<size_t>(EPD_STREAM_CHUNK_SIZE, size - done);
+            if (decoder.read(chunk.get(), len) != len) {
+                ESP_LOGE(TAG_IMG, "Truncated or corrupt .epd delta");
+                return false;
+            }
+            for (size_t i = 0; i < len; i++) {
+                dst[done + i] ^= chunk[i];
+            }
+            done += len;
+        }
+        if (!decoder.finished()) {
+            ESP_LOGE(TAG_IMG, "Corrupt .epd delta");
+            return false;
+        }
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Delta pack entries
+// ---------------------------------------------------------------------------
+
+/**
+ * @brief A pack entry known to be in a set of planes, to apply the next
+ *        delta to
+ *
+ * The planes are the display's and the prefetch slots', which are never
+ * freed. Anything may have written over them since (another image, the
+ * slide cache, a menu), so the hash of their bytes is checked before use.
+ */
+struct DeltaBase {
+    const uint8_t* planes[2];
+    SDCard::ImagePackEntry entry;  // Which frame, should the pack change
+    size_t index;
+    uint32_t hash;
+};
+
+// The display's planes and the prefetch slots, with one to spare
+static constexpr size_t DELTA_BASES = 4;
+static DeltaBase s_deltaBases[DELTA_BASES];
+static size_t s_deltaBaseCount = 0;
+static size_t s_deltaBaseNext = 0;
+
+static uint32_t planesHash(const uint8_t* const planes[2], Adafruit_IL0373* display)
+{
+    uint32_t hash = 2166136261u;
+    for (uint8_t p = 0; p < 2; p++) {
+        for (uint32_t i = 0; planes[p] && i < display->getBufferSize(p); i++) {
+            hash = (hash ^ planes[p][i]) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+static bool sameEntry(const SDCard::ImagePackEntry& a, const SDCard::ImagePackEntry& b)
+{
+    return a.offset == b.offset && a.length == b.length && a.format == b.format &&
+           a.nameHash == b.nameHash;
+}
+
+/**
+ * @brief Note that the framebuffer now holds a pack entry
+ */
+static void recordDeltaBase(SDCard::ImagePack& pack, size_t index, Adafruit_IL0373* display)
+{
+    const uint8_t* planes[2] = { display->getBuffer(0), display->getBuffer(1) };
+    DeltaBase* base = nullptr;
+    for (size_t i = 0; i < s_deltaBaseCount; i++) {
+        if (s_deltaBases[i].planes[0] == planes[0]) {
+            base = &s_deltaBases[i];
+        }
+    }
+    if (!base) {
+        base = &s_deltaBases[s_deltaBaseNext];
+        s_deltaBaseNext = (s_deltaBaseNext + 1) % DELTA_BASES;
+        s_deltaBaseCount = std::min(s_deltaBaseCount + 1, DELTA_BASES);
+    }
+    *base = DeltaBase{ { planes[0], planes[1] }, pack.entry(index), index,
+                       planesHash(planes, display) };
+}
+
+/**
+ * @brief The latest frame of [first, last) still held in some planes
+ */
+static const DeltaBase* findDeltaBase(SDCard::ImagePack& pack, size_t first, size_t last,
+                                      Adafruit_IL0373* display)
+{
+    const DeltaBase* best = nullptr;
+    for (size_t i = 0; i < s_deltaBaseCount; i++) {
+        const DeltaBase& base = s_deltaBases[i];
+        if (base.index >= first && base.index < last && (!best || base.index > best->index) &&
+            sameEntry(base.entry, pack.entry(base.index)) &&
+            base.hash == planesHash(base.planes, display)) {
+            best = &base;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Read a delta entry into the framebuffer
+ *
+ * A delta needs the frame before it. When some planes still hold it (the
+ * slide on screen while the next one loads, stepping forward) it is one
+ * read of the delta, applied in place or onto a copy. Otherwise the frame
+ * is rebuilt from the keyframe that starts the chain and every delta after
+ * it, as many reads as the pack's keyframe interval.
+ */
+static bool readDeltaEntry(SDCard::ImagePack& pack, size_t index, Adafruit_IL0373* display)
+{
+    if (!display->getBuffer(0)) {
+        ESP_LOGE(TAG_IMG, "Delta pack entries need a framebuffer");
+        return false;
+    }
+    size_t key = index;
+    while (key > 0 && pack.entry(key).format == SDCard::IMAGE_PACK_FORMAT_DELTA) {
+        key--;
+    }
+    if (pack.entry(key).format != SDCard::IMAGE_PACK_FORMAT_EPD) {
+        ESP_LOGE(TAG_IMG, "Pack entry %zu has no keyframe before it", index);
+        return false;
+    }
+
+    size_t next = key;
+    const DeltaBase* base = findDeltaBase(pack, key, index, display);
+    if (base) {
+        waitFramebufferFree(display);
+        for (uint8_t p = 0; p < 2; p++) {
+            uint8_t* dst = display->getBuffer(p);
+            if (dst && dst != base->planes[p]) {
+                memcpy(dst, base->planes[p], display->getBufferSize(p));
+            }
+        }
+        next = base->index + 1;
+    }
+    ESP_LOGI(TAG_IMG, "Pack entry %zu: %zu delta(s) from entry %zu", index, index + 1 - next,
+             next == key ? key : next - 1);
+
+    for (size_t i = next; i <= index; i++) {
+        PackFrame frame;
+        FrameSource source;
+        if (!packSource(pack, i, frame, source)) {
+            return false;
+        }
+        bool ok = i == key ? readPackedFrame(source, display) : applyPackedDelta(source, display);
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Pipe a packed .epd frame from its source to the controller and refresh
+ *
+ * For displays without an on-chip framebuffer: the planes go through one
+ * EPD_STREAM_CHUNK_SIZE buffer instead. Synchronous, the refresh has finished
+ * on return.
+ *
+ * @param source Positioned at the EPDImageHeader
+ * @param display Display to refresh
+ * @return true if the header matched and every plane was sent
+ */
+static bool streamPackedFrame(const FrameSource& source, Adafruit_IL0373* display)
+{
+    ImageLoader::EPDImageHeader header;
+    if (!readPackedHeader(source, display, header)) {
+        return false;
+    }
+    if (header.planeCount == 1 && display->getBufferSize(1) != 0) {
+        // There is no framebuffer to clear the color plane in
+        ESP_LOGE(TAG_IMG, "Black-only .epd frames can't be streamed to a tricolor panel");
+        return false;
+    }
+
+    // RAW planes in memory go to the controller from where they lie
+    bool inPlace = header.encoding == ImageLoader::EPD_ENCODING_RAW &&
+                   source.read == readFromMemory;
+    SlideArena::Ptr<uint8_t[]> chunk;
+    SlideArena::Ptr<uint8_t[]> work = decoderWork(header);
+    if (!inPlace) {
+        chunk = SlideArena::makeArray<uint8_t>(EPD_STREAM_CHUNK_SIZE);
+    }
+    if ((!inPlace && !chunk) || (header.encoding != ImageLoader::EPD_ENCODING_RAW && !work)) {
+        ESP_LOGE(TAG_IMG, "Out of memory for the stream buffer");
+        return false;
+    }
+
+    const uint32_t sizes[2] = { header.plane1Size, header.plane2Size };
+    const uint32_t stored[2] = { header.plane1Stored, header.plane2Stored };
+    for (uint8_t plane = 0; plane < header.planeCount; plane++) {
+        const uint8_t* mapped = inPlace ? takeFromMemory(source, sizes[plane]) : nullptr;
+        if (inPlace && !mapped) {
+            ESP_LOGE(TAG_IMG, "Truncated .epd plane data");
+            return false;
+        }
+        FrameCodec::PlaneDecoder decoder(source.read, source.ctx, header.encoding,
+                                         mapped ? 0 : stored[plane], work.get());
+        display->beginPlaneWrite(plane);
+        for (uint32_t sent = 0; sent < sizes[plane];) {
+            size_t len = std::min<size_t>(EPD_STREAM_CHUNK_SIZE, sizes[plane] - sent);
+            const uint8_t* bytes = mapped ? mapped + sent : chunk.get();
+            if (!mapped && decoder.read(chunk.get(), len) != len) {
+                // The planes already sent are left in controller RAM, unshown
+                ESP_LOGE(TAG_IMG, "Truncated or corrupt .epd plane data");
+                display->endPlaneWrite();
+                return false;
+            }
+            display->writePlaneChunk(bytes, len);
+            sent += len;
+        }
+        display->endPlaneWrite();
+        if (!decoder.finished()) {
+            ESP_LOGE(TAG_IMG, "Corrupt .epd plane data");
+            return false;
+        }
+    }
+
+    BootProfile::mark(BootProfile::Mark::FRAME_READY);
+    display->displayStreamed();
+    return true;
+}
+
+/**
+ * @brief Show a packed .epd frame: through the framebuffer with
+ *        displayAsync(), or streamed when the display has none
+ */
+static bool displayPackedFrame(const FrameSource& source, Adafruit_IL0373* display)
+{
+    if (!display->getBuffer(0)) {
+        return streamPackedFrame(source, display);
+    }
+    if (!readPackedFrame(source, display)) {
+        return false;
+    }
+    display->displayAsync();
+    return true;
+}
+
+static bool displayPackedFrame(FILE* file, Adafruit_IL0373* display)
+{
+    return displayPackedFrame(fileSource(file), display);
+}
+
+/**
+ * @brief Tone of an image: ImageLoader::getTone(), overridden by any
+ *        "gamma=", "contrast=" or "brightness=" lines of its sidecar
+ *
+ * The sidecar is the image's path with IMAGE_SIDECAR_EXTENSION in place of
+ * its own; other lines are left to whatever else reads it.
+ */
+static ImageLoader::Tone imageTone(const char* filepath)
+{
+    ImageLoader::Tone tone = ImageLoader::getTone();
+    const char* dot = strrchr(filepath, '.');
+    if (IMAGE_SIDECAR_EXTENSION[0] == '\0' || !dot) {
+        return tone;
+    }
+    char path[SDCard::ImageList::MAX_PATH];
+    int stem = static_cast<int>(dot - filepath);
+    if (snprintf(path, sizeof(path), "%.*s%s", stem, filepath, IMAGE_SIDECAR_EXTENSION) >=
+        static_cast<int>(sizeof(path))) {
+        return tone;
+    }
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return tone;
+    }
+    char line[64];
+    while (fgets(line, sizeof(line), file)) {
+        int value;
+        if (sscanf(line, " gamma = %d", &value) == 1) {
+            tone.gamma = static_cast<uint16_t>(std::clamp(value, 10, 1000));
+        } else if (sscanf(line, " contrast = %d", &value) == 1) {
+            tone.contrast = static_cast<int8_t>(std::clamp(value, -100, 100));
+        } else if (sscanf(line, " brightness = %d", &value) == 1) {
+            tone.brightness = static_cast<int8_t>(std::clamp(value, -128, 127));
+        }
+    }
+    fclose(file);
+    ESP_LOGI(TAG_IMG, "Tone from %s: gamma %u, contrast %d, brightness %d", path,
+             tone.gamma, tone.contrast, tone.brightness);
+    return tone;
+}
+
+/**
+ * @brief Build the cache file path for a source image
+ *
+ * The key hashes path, size, mtime, dither and scale mode and the image's
+ * tone (FNV-1a), so editing or replacing the source, or switching modes,
+ * yields a new entry. The name is 8 hex digits to stay 8.3-safe.
+ *
+ * @return false if the source doesn't exist
+ */
+static bool cachePathFor(const char* filepath, const ImageLoader::Tone& tone, char* out,
+                         size_t outSize)
+{
+    int32_t size = 0;
+    int64_t mtime = 0;
+    if (!SDCard::getFileInfo(filepath, size, mtime)) {
+        return false;
+    }
+
+    uint32_t hash = 2166136261u;
+    auto mix = [&hash](const void* data, size_t len) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < len; i++) {
+            hash = (hash ^ p[i]) * 16777619u;
+        }
+    };
+    mix(filepath, strlen(filepath));
+    mix(&size, sizeof(size));
+    mix(&mtime, sizeof(mtime));
+    Dither::Mode ditherMode = ImageLoader::getDitherMode();
+    ImageLoader::ScaleMode scaleMode = ImageLoader::getScaleMode();
+    mix(&ditherMode, sizeof(ditherMode));
+    mix(&scaleMode, sizeof(scaleMode));
+    uint32_t caption = Captions::hash(filepath);
+    if (caption != 0) {
+        // The caption is drawn into the cached frame
+        mix(&caption, sizeof(caption));
+    }
+    if (!tone.linear()) {
+        // Linear keeps the keys of entries written before tones existed
+        mix(&tone.gamma, sizeof(tone.gamma));
+        mix(&tone.contrast, sizeof(tone.contrast));
+        mix(&tone.brightness, sizeof(tone.brightness));
+    }
+
+    snprintf(out, outSize, "%s/%08" PRIX32 ".EPD", IMAGE_CACHE_DIRECTORY, hash);
+    return true;
+}
+
+/**
+ * @brief Try to load a source image's frame from the converted-frame cache
+ * @return true if a valid cached frame was read into the framebuffer
+ */
+static bool loadCachedFrame(const char* cachePath, Adafruit_IL0373* display)
+{
+    FILE* file = openImageFile(cachePath);
+    if (!file) {
+        return false;
+    }
+    bool ok = readPackedFrame(file, display);
+    fclose(file);
+
+    if (!ok) {
+        // Stale or truncated entry (e.g. written for another panel); rebuild it
+        remove(cachePath);
+        return false;
+    }
+
+    ESP_LOGI(TAG_IMG, "Loaded from cache: %s", cachePath);
+    return true;
+}
+
+/**
+ * @brief Write the current framebuffer to the converted-frame cache
+ *
+ * Written to a temporary name and renamed so a power loss mid-write never
+ * leaves a truncated entry under the real key. Only reads the framebuffer,
+ * so it may run while displayAsync() is uploading it.
+ */
+static void storeCachedFrame(const char* cachePath, Adafruit_IL0373* display)
+{
+    uint8_t* plane1 = display->getBuffer(0);
+    uint8_t* plane2 = display->getBuffer(1);
+    if (!plane1 || !SDCard::makeDirectory(IMAGE_CACHE_DIRECTORY)) {
+        return;
+    }
+
+    ImageLoader::EPDImageHeader header = {};
+    header.magic = ImageLoader::EPD_IMAGE_MAGIC;
+    header.version = ImageLoader::EPD_IMAGE_VERSION;
+    header.entryMode = display->getDataEntryMode();
+    header.planeCount = plane2 ? 2 : 1;
+    header.width = display->width();
+    header.height = display->height();
+    header.plane1Size = display->getBufferSize(0);
+    header.plane2Size = plane2 ? display->getBufferSize(1) : 0;
+    header.encoding = ImageLoader::EPD_ENCODING_RAW;
+    header.panel = Panel::active().id;
+    header.rotation = display->getRotation();
+    header.plane1Stored = header.plane1Size;
+    header.plane2Stored = header.plane2Size;
+
+    char tmpPath[64];
+    snprintf(tmpPath, sizeof(tmpPath), "%s/CACHE.TMP", IMAGE_CACHE_DIRECTORY);
+
+    FILE* file = SDCard::createFile(tmpPath);
+    if (!file) {
+        return;
+    }
+    SDCard::BusBurst burst;
+    bool ok = fwrite(&header, 1, sizeof(header), file) == sizeof(header) &&
+              fwrite(plane1, 1, header.plane1Size, file) == header.plane1Size &&
+              (!plane2 || fwrite(plane2, 1, header.plane2Size, file) == header.plane2Size);
+    ok = (fclose(file) == 0) && ok;
+
+    remove(cachePath);
+    if (!ok || rename(tmpPath, cachePath) != 0) {
+        ESP_LOGW(TAG_IMG, "Failed to write cache entry %s", cachePath);
+        remove(tmpPath);
+        return;
+    }
+    ESP_LOGI(TAG_IMG, "Cached converted frame: %s", cachePath);
+}
+
+/**
+ * @brief Read a .epd file into the framebuffer, or with refresh set, show it
+ *        (displayPackedFrame())
+ */
+static bool renderEPD(const char* filepath, Adafruit_IL0373* display, bool refresh)
+{
+    ESP_LOGI(TAG_IMG, "Loading packed image: %s", filepath);
+
+    SlideArena::Scope arena;
+    FILE* file = openImageFile(filepath);
+    if (!file) {
+        ESP_LOGE(TAG_IMG, "Cannot open file");
+        return false;
+    }
+
+    // A caption goes over the frame before it is shown
+    bool captioned = display->getBuffer(0) && Captions::hash(filepath) != 0;
+    bool ok = refresh && !captioned ? displayPackedFrame(file, display) :
+                                      readPackedFrame(file, display);
+    fclose(file);
+    if (ok && captioned) {
+        Captions::draw(filepath, display);
+        if (refresh) {
+            display->displayAsync();
+        }
+    }
+    return ok;
+}
+
+/**
+ * @brief Read one pack entry into the framebuffer, or with refresh set, show
+ *        it (displayPackedFrame())
+ */
+static bool renderPackEntry(SDCard::ImagePack& pack, size_t index, Adafruit_IL0373* display,
+                            bool refresh)
+{
+    if (index >= pack.size()) {
+        return false;
+    }
+
+    SlideArena::Scope arena;
+    const SDCard::ImagePackEntry& entry = pack.entry(index);
+    bool delta = entry.format == SDCard::IMAGE_PACK_FORMAT_DELTA;
+    if ((entry.format != SDCard::IMAGE_PACK_FORMAT_EPD && !delta) ||
+        entry.length < ImageLoader::EPD_IMAGE_V1_HEADER_SIZE) {
+        ESP_LOGE(TAG_IMG, "Unsupported pack entry %zu (format %d, %" PRIu32 " bytes)",
+                 index, entry.format, entry.length);
+        return false;
+    }
+
+    ESP_LOGI(TAG_IMG, "Loading pack entry %zu (%08" PRIX32 ")", index, entry.nameHash);
+    bool ok;
+    if (delta) {
+        ok = readDeltaEntry(pack, index, display);
+        if (ok && refresh) {
+            display->displayAsync();
+        }
+    } else {
+        PackFrame frame;
+        FrameSource source;
+        if (!packSource(pack, index, frame, source)) {
+            return false;
+        }
+        ok = refresh ? displayPackedFrame(source, display) : readPackedFrame(source, display);
+    }
+    if (ok && display->getBuffer(0)) {
+        recordDeltaBase(pack, index, display);
+    }
+    return ok;
+}
+
+static bool renderBMP(const char* filepath, Adafruit_IL0373* display)
+{
+    ESP_LOGI(TAG_IMG, "Loading image: %s", filepath);
+
+    SlideArena::Scope arena;
+    FILE* file = openImageFile(filepath);
+    if (!file) {
+        ESP_LOGE(TAG_IMG, "Cannot open file");
+        return false;
+    }
+
+    DisplaySink sink(display);
+    bool ok = ImageDecode::decodeBMP(file, sink);
+    fclose(file);
+    return ok;
+}
+
+static bool renderJPEG(const char* filepath, Adafruit_IL0373* display, bool preview = false);
+static bool renderPNG(const char* filepath, Adafruit_IL0373* display);
+static bool renderQOI(const char* filepath, Adafruit_IL0373* display);
+
+static bool isJPEG(const char* filepath)
+{
+    return hasExtension(filepath, ".jpg") || hasExtension(filepath, ".jpeg");
+}
+
+static bool renderImage(const char* filepath, Adafruit_IL0373* display)
+{
+    if (isJPEG(filepath)) {
+        return renderJPEG(filepath, display);
+    }
+    if (hasExtension(filepath, ".png")) {
+        return renderPNG(filepath, display);
+    }
+    if (hasExtension(filepath, ".qoi")) {
+        return renderQOI(filepath, display);
+    }
+    return renderBMP(filepath, display);
+}
+
+/**
+ * @brief Decode a collage's images, each straight into its tile
+ *
+ * An image that fails leaves its tile blank; the collage fails only if
+ * none could be shown. Packed frames and nested collages can't be tiled.
+ */
+static bool renderCollage(const char* filepath, Adafruit_IL0373* display)
+{
+    // The tiles' Scopes nest inside this one and leave the layout alone
+    SlideArena::Scope arena;
+    SlideArena::Ptr<Collage::Layout> layout = SlideArena::make<Collage::Layout>();
+    if (!layout || !Collage::parse(filepath, *layout)) {
+        return false;
+    }
+    ESP_LOGI(TAG_IMG, "Collage %s: %u images in %ux%u", filepath, layout->count,
+             layout->columns, layout->rows);
+
+    waitFramebufferFree(display);
+    display->clearBuffer();
+    size_t shown = 0;
+    for (size_t i = 0; i < layout->count; i++) {
+        const char* path = layout->paths[i];
+        if (hasExtension(path, ".epd") || Collage::isCollage(path)) {
+            ESP_LOGW(TAG_IMG, "%s can't go into a collage tile", path);
+            continue;
+        }
+        ImageDecode::setImageTone(imageTone(path));
+        ImageDecode::setTile(Collage::tile(*layout, i));
+        bool ok = renderImage(path, display);
+        ImageDecode::setTile(ImageDecode::FULL_SCREEN);
+        if (ImageDecode::aborted()) {
+            return false;
+        }
+        if (ok) {
+            shown++;
+        } else {
+            ESP_LOGW(TAG_IMG, "Collage tile %zu (%s) left blank", i + 1, path);
+        }
+    }
+    return shown > 0;
+}
+
+static bool renderDecoded(const char* filepath, Adafruit_IL0373* display)
+{
+    SlideStats::Timer timer(SlideStats::Stage::DECODE);
+    if (Collage::isCollage(filepath)) {
+        return renderCollage(filepath, display);
+    }
+    return renderImage(filepath, display);
+}
+
+/**
+ * @brief Decode an image once per band and refresh, for displays without
+ *        frame planes; synchronous, the refresh has finished on return
+ */
+static bool renderBanded(const char* filepath, Adafruit_IL0373* display)
+{
+    if (!display->beginBands(BANDED_RENDER_BYTES)) {
+        ESP_LOGE(TAG_IMG, "Out of memory for a %zu-byte band", BANDED_RENDER_BYTES);
+        return false;
+    }
+    do {
+        if (!renderDecoded(filepath, display)) {
+            // The panel keeps the previous slide
+            display->cancelBands();
+            return false;
+        }
+    } while (display->nextBand());
+    return true;
+}
+
+/**
+ * @brief Render any supported image into the framebuffer, via the cache
+ * @param refresh Start displayAsync() as soon as the frame is ready (before
+ *                the cache entry is written, so the upload isn't delayed)
+ */
+static bool renderFrame(const char* filepath, Adafruit_IL0373* display, bool refresh)
+{
+    if (hasExtension(filepath, ".epd")) {
+        return renderEPD(filepath, display, refresh);
+    }
+
+    if (!display->getBuffer(0) || (display->getBufferSize(1) && !display->getBuffer(1))) {
+        // No frame in RAM to decode into or to cache
+        if (!refresh) {
+            ESP_LOGE(TAG_IMG, "No frame planes to decode into");
+            return false;
+        }
+        ImageDecode::setImageTone(imageTone(filepath));
+        return renderBanded(filepath, display);
+    }
+
+    ImageLoader::Tone tone = imageTone(filepath);
+    ImageDecode::setImageTone(tone);
+
+    SlideArena::Scope arena;
+    char cachePath[64];
+    // A collage's key wouldn't change with its images
+    bool cacheable = s_cacheEnabled && !Collage::isCollage(filepath) &&
+                     cachePathFor(filepath, tone, cachePath, sizeof(cachePath));
+    if (cacheable && loadCachedFrame(cachePath, display)) {
+        Captions::draw(filepath, display);
+        BootProfile::mark(BootProfile::Mark::FRAME_READY);
+        if (refresh) {
+            display->displayAsync();
+        }
+        return true;
+    }
+
+    if (!renderDecoded(filepath, display)) {
+        return false;
+    }
+    Captions::draw(filepath, display);
+    BootProfile::mark(BootProfile::Mark::FRAME_READY);
+    if (refresh) {
+        display->displayAsync();
+    }
+
+    if (cacheable) {
+        storeCachedFrame(cachePath, display);
+    }
+    return true;
+}
+
+bool ImageLoader::load(const char* filepath, Adafruit_IL0373* display)
+{
+    if (!filepath || !display) {
+        return false;
+    }
+    return renderFrame(filepath, display, false);
+}
+
+bool ImageLoader::loadPreview(const char* filepath, Adafruit_IL0373* display)
+{
+    if (!filepath || !display || !isJPEG(filepath) || !display->getBuffer(0)) {
+        return false;
+    }
+    // A cached frame loads faster than any preview
+    ImageLoader::Tone tone = imageTone(filepath);
+    char cachePath[64];
+    int32_t size = 0;
+    int64_t mtime = 0;
+    if (s_cacheEnabled && cachePathFor(filepath, tone, cachePath, sizeof(cachePath)) &&
+        SDCard::getFileInfo(cachePath, size, mtime)) {
+        return false;
+    }
+
+    ImageDecode::setImageTone(tone);
+    Dither::Mode mode = getDitherMode();
+    setDitherMode(Dither::Mode::BLUE_NOISE);  // No error rows to carry
+    bool ok = renderJPEG(filepath, display, true);
+    setDitherMode(mode);
+    return ok;
+}
+
+ImageLoader::WarmResult ImageLoader::warmCache(const char* filepath, Adafruit_IL0373* display,
+                                               uint8_t* plane1, uint8_t* plane2)
+{
+    if (!filepath || !display || !s_cacheEnabled || hasExtension(filepath, ".epd") ||
+        Collage::isCollage(filepath)) {
+        return WarmResult::SKIPPED;
+    }
+    ImageLoader::Tone tone = imageTone(filepath);
+    char cachePath[64];
+    int32_t size = 0;
+    int64_t mtime = 0;
+    if (!cachePathFor(filepath, tone, cachePath, sizeof(cachePath))) {
+        return WarmResult::FAILED;
+    }
+    if (SDCard::getFileInfo(cachePath, size, mtime)) {
+        return WarmResult::SKIPPED;
+    }
+
+    ImageDecode::setImageTone(tone);
+    SlideArena::Scope arena;
+    if (!display->swapBuffers(plane1, plane2)) {
+        return WarmResult::FAILED;
+    }
+    bool ok = renderDecoded(filepath, display);
+    if (ok) {
+        Captions::draw(filepath, display);
+        storeCachedFrame(cachePath, display);
+    }
+    display->swapBuffers(plane1, plane2);
+    return ok ? WarmResult::CONVERTED : WarmResult::FAILED;
+}
+
+bool ImageLoader::loadIntoPlanes(const char* filepath, Adafruit_IL0373* display,
+                                 uint8_t* plane1, uint8_t* plane2)
+{
+    if (!filepath || !display) {
+        return false;
+    }
+
+    // Point the display at the caller's planes so the decoders draw into
+    // them, then hand the display its own planes back
+    if (!display->swapBuffers(plane1, plane2)) {
+        return false;
+    }
+    bool ok = renderFrame(filepath, display, false);
+    display->swapBuffers(plane1, plane2);
+    return ok;
+}
+
+bool ImageLoader::loadAndDisplay(const char* filepath, Adafruit_IL0373* display)
+{
+    if (!filepath || !display) {
+        return false;
+    }
+
+    if (!renderFrame(filepath, display, true)) {
+        return false;
+    }
+
+    ESP_LOGI(TAG_IMG, "Image uploaded, refresh started");
+    return true;
+}
+
+bool ImageLoader::loadAndDisplay(SDCard::ImagePack& pack, size_t index,
+                                 Adafruit_IL0373* display)
+{
+    if (!display || !renderPackEntry(pack, index, display, true)) {
+        return false;
+    }
+
+    ESP_LOGI(TAG_IMG, "Image uploaded, refresh started");
+    return true;
+}
+
+bool ImageLoader::loadIntoPlanes(SDCard::ImagePack& pack, size_t index,
+                                 Adafruit_IL0373* display, uint8_t* plane1, uint8_t* plane2)
+{
+    if (!display || !display->swapBuffers(plane1, plane2)) {
+        return false;
+    }
+    bool ok = renderPackEntry(pack, index, display, false);
+    display->swapBuffers(plane1, plane2);
+    return ok;
+}
+
+bool ImageLoader::loadAndDisplayEPD(const char* filepath, Adafruit_IL0373* display)
+{
+    if (!filepath || !display || !renderEPD(filepath, display, true)) {
+        return false;
+    }
+
+    ESP_LOGI(TAG_IMG, "Image uploaded, refresh started");
+    return true;
+}
+
+bool ImageLoader::loadAndDisplayEPD(FrameReader read, void* ctx, Adafruit_IL0373* display)
+{
+    if (!read || !display) {
+        return false;
+    }
+
+    SlideArena::Scope arena;
+    if (!displayPackedFrame(FrameSource{ read, ctx }, display)) {
+        return false;
+    }
+
+    ESP_LOGI(TAG_IMG, "Image uploaded, refresh started");
+    return true;
+}
+
+bool ImageLoader::loadAndDisplayEPD(const uint8_t* frame, size_t length, Adafruit_IL0373* display)
+{
+    if (!frame || !display) {
+        return false;
+    }
+
+    SlideArena::Scope arena;
+    MemoryFrame memory{ frame, length };
+    if (!displayPackedFrame(FrameSource{ readFromMemory, &memory }, display)) {
+        return false;
+    }
+
+    ESP_LOGI(TAG_IMG, "Image uploaded, refresh started");
+    return true;
+}
+
+bool ImageLoader::loadIntoPlanes(const uint8_t* frame, size_t length, Adafruit_IL0373* display,
+                                 uint8_t* plane1, uint8_t* plane2)
+{
+    if (!frame || !display || !display->swapBuffers(plane1, plane2)) {
+        return false;
+    }
+    SlideArena::Scope arena;
+    MemoryFrame memory{ frame, length };
+    bool ok = readPackedFrame(FrameSource{ readFromMemory, &memory }, display);
+    display->swapBuffers(plane1, plane2);
+    return ok;
+}
+
+bool ImageLoader::loadAndDisplayJPEG(const char* filepath, Adafruit_IL0373* display)
+{
+    if (!filepath || !display) {
+        return false;
+    }
+    ImageDecode::setImageTone(imageTone(filepath));
+    if (!renderJPEG(filepath, display)) {
+        return false;
+    }
+
+    display->displayAsync();
+
+    ESP_LOGI(TAG_IMG, "Image uploaded, refresh started");
+    return true;
+}
+
+bool ImageLoader::loadAndDisplayPNG(const char* filepath, Adafruit_IL0373* display)
+{
+    if (!filepath || !display) {
+        return false;
     }
+    ImageDecode::setImageTone(imageTone(filepath));
+    if (!renderPNG(filepath, display)) {
+        return false;
+    }
+
+    display->displayAsync();
+
+    ESP_LOGI(TAG_IMG, "Image uploaded, refresh started");
+    return true;
 }
 
 bool ImageLoader::loadAndDisplayBMP(const char* filepath, Adafruit_IL0373* display)
@@ -38,139 +1348,877 @@ bool ImageLoader::loadAndDisplayBMP(const char* filepath, Adafruit_IL0373* displ
     if (!filepath || !display) {
         return false;
     }
+    ImageDecode::setImageTone(imageTone(filepath));
+    if (!renderBMP(filepath, display)) {
+        return false;
+    }
 
-    ESP_LOGI(TAG_IMG, "Loading image: %s", filepath);
+    // Refresh display in the background; the caller gets control back while
+    // the panel refreshes and can already decode into the framebuffer
+    display->displayAsync();
+
+    ESP_LOGI(TAG_IMG, "Image uploaded, refresh started");
+    return true;
+}
+
+
+/**
+ * @brief TJpgDec session state, shared with its input/output callbacks
+ */
+struct JpegDecodeContext {
+    JDEC decoder;
+    uint8_t work[JPEG_WORK_SIZE];
+    ReadAhead::Stream* stream;
+    uint32_t width;          // Image size after DCT scaling
+    uint32_t height;
+    uint8_t* strip;          // One MCU row of RGB pixels
+    uint32_t stripTop;
+    RowScaler* scaler;
+};
+
+static JpegSize jpegInput(JDEC* decoder, uint8_t* buffer, JpegSize length)
+{
+    JpegDecodeContext* ctx = static_cast<JpegDecodeContext*>(decoder->device);
+    if (!buffer) {
+        return ctx->stream->skip(length) ? length : 0;
+    }
+    return static_cast<JpegSize>(ctx->stream->read(buffer, length));
+}
+
+static JpegOutResult jpegOutput(JDEC* decoder, void* bitmap, JRECT* rect)
+{
+    JpegDecodeContext* ctx = static_cast<JpegDecodeContext*>(decoder->device);
+
+    // MCUs arrive left to right, top to bottom: collect one MCU row
+    if (rect->left == 0) {
+        ctx->stripTop = rect->top;
+    }
+    uint32_t blockWidth = rect->right - rect->left + 1;
+    const uint8_t* pixels = static_cast<const uint8_t*>(bitmap);
+    for (uint32_t y = rect->top; y <= rect->bottom; y++) {
+        memcpy(&ctx->strip[((y - ctx->stripTop) * ctx->width + rect->left) * 3],
+               pixels, blockWidth * 3);
+        pixels += blockWidth * 3;
+    }
+
+    if (rect->right + 1u == ctx->width) {
+        if (ImageDecode::aborted()) {
+            return 0;
+        }
+        for (uint32_t y = rect->top; y <= rect->bottom; y++) {
+            ctx->scaler->pushRow(y, &ctx->strip[(y - ctx->stripTop) * ctx->width * 3]);
+        }
+    }
+
+    // Stop decoding once the last output row is out
+    return ctx->scaler->done() ? 0 : 1;
+}
+
+/**
+ * @param preview Decode at 1/8 whatever the fitted size (DC coefficients
+ *                only) and let the scaler blow it up
+ */
+static bool renderJPEG(const char* filepath, Adafruit_IL0373* display, bool preview)
+{
+    ESP_LOGI(TAG_IMG, "Loading JPEG%s: %s", preview ? " preview" : "", filepath);
+
+    SlideArena::Scope arena;
+    SlideArena::Ptr<JpegDecodeContext> ctx = SlideArena::make<JpegDecodeContext>();
+    SlideArena::Ptr<DecodeScratch> scratch = SlideArena::make<DecodeScratch>();
+    if (!ctx || !scratch) {
+        ESP_LOGE(TAG_IMG, "No memory for decode buffers");
+        return false;
+    }
 
-    // Read file size
-    int32_t fileSize = SDCard::getFileSize(filepath);
-    if (fileSize < 0 || fileSize < static_cast<int32_t>(sizeof(BMPHeader))) {
-        ESP_LOGE(TAG_IMG, "Invalid file size or cannot read file");
+    FILE* file = openImageFile(filepath);
+    if (!file) {
+        ESP_LOGE(TAG_IMG, "Cannot open file");
         return false;
     }
+    ReadAhead::Stream stream(file);
+    ctx->stream = &stream;
 
-    // Allocate buffer for file
-    uint8_t* fileBuffer = new uint8_t[fileSize];
-    if (!fileBuffer) {
-        ESP_LOGE(TAG_IMG, "Failed to allocate buffer");
+    JRESULT res = jd_prepare(&ctx->decoder, jpegInput, ctx->work, sizeof(ctx->work), ctx.get());
+    if (res != JDR_OK) {
+        // Progressive and arithmetic-coded files end up here (JDR_FMT3)
+        ESP_LOGE(TAG_IMG, "Unsupported JPEG (error %d)", static_cast<int>(res));
         return false;
     }
 
-    // Read entire file
-    int32_t bytesRead = SDCard::readFile(filepath, fileBuffer, fileSize);
-    if (bytesRead != fileSize) {
-        ESP_LOGE(TAG_IMG, "Failed to read file completely");
-        delete[] fileBuffer;
+    uint32_t imgWidth = ctx->decoder.width;
+    uint32_t imgHeight = ctx->decoder.height;
+
+    // Let the IDCT shrink by 1/2, 1/4 or 1/8 as long as the result still
+    // covers the fitted size; the integer scaler does the rest
+    FitScale target = fitScale(imgWidth, imgHeight);
+    uint8_t dctScale = preview ? 3 : 0;
+    while (dctScale < 3 &&
+           (imgWidth >> (dctScale + 1)) >= target.outWidth &&
+           (imgHeight >> (dctScale + 1)) >= target.outHeight) {
+        dctScale++;
+    }
+    ctx->width = imgWidth >> dctScale;
+    ctx->height = imgHeight >> dctScale;
+
+    ESP_LOGI(TAG_IMG, "JPEG: %ux%u, decoding at 1/%u (%ux%u)", (unsigned)imgWidth,
+             (unsigned)imgHeight, 1u << dctScale, (unsigned)ctx->width, (unsigned)ctx->height);
+
+    if (ctx->width == 0 || ctx->height == 0) {
+        ESP_LOGE(TAG_IMG, "Invalid JPEG dimensions");
         return false;
     }
 
-    // Parse BMP header
-    BMPHeader* header = reinterpret_cast<BMPHeader*>(fileBuffer);
-    
-    // Check signature
-    if (header->signature != 0x4D42) {  // "BM"
-        ESP_LOGE(TAG_IMG, "Invalid BMP signature");
-        delete[] fileBuffer;
+    uint32_t stripRows = std::max<uint32_t>(JPEG_MAX_MCU_ROWS >> dctScale, 1);
+    SlideArena::Ptr<uint8_t[]> strip = SlideArena::makeArray<uint8_t>(ctx->width * stripRows * 3);
+    if (!strip) {
+        ESP_LOGE(TAG_IMG, "No memory for MCU row (%u px wide)", (unsigned)ctx->width);
         return false;
     }
+    ctx->strip = strip.get();
+
+    DisplaySink sink(display);
+    sink.begin();
+
+    RowScaler scaler(fitScale(ctx->width, ctx->height), ctx->width, ctx->height,
+                     scratch.get(), sink);
+    ctx->scaler = &scaler;
+
+    res = jd_decomp(&ctx->decoder, jpegOutput, dctScale);
 
-    // Check bits per pixel (support 1, 4, 8, 24)
-    if (header->bitsPerPixel != 1 && header->bitsPerPixel != 4 && 
-        header->bitsPerPixel != 8 && header->bitsPerPixel != 24) {
-        ESP_LOGE(TAG_IMG, "Unsupported bits per pixel: %d", header->bitsPerPixel);
-        delete[] fileBuffer;
+    // JDR_INTR: the output callback stopped early after the last row
+    if (res != JDR_OK && !(res == JDR_INTR && scaler.done())) {
+        ESP_LOGE(TAG_IMG, "JPEG decode failed (error %d)", static_cast<int>(res));
         return false;
     }
+    return true;
+}
+
+static uint32_t readBE32(const uint8_t* p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+/**
+ * @brief Reassembles inflated PNG scanlines, unfilters them and feeds the scaler
+ *
+ * Only the current and previous scanline are kept. Indexed rows (palette,
+ * or gray up to 8 bits) can skip the RGB stage: each index goes through the
+ * precomputed paletteInk table straight to an EPD color.
+ */
+class PngRowDecoder {
+public:
+    PngRowDecoder(uint32_t width, uint32_t height, uint8_t bitDepth, uint8_t colorType,
+                  const DecodeScratch* scratch, RowScaler* scaler, bool direct)
+        : width_(width), height_(height), bitDepth_(bitDepth), colorType_(colorType),
+          scratch_(scratch), scaler_(scaler), direct_(direct), fill_(0), y_(0)
+    {
+        uint32_t channels = colorType == PNG_RGB ? 3 :
+                            colorType == PNG_GRAY_ALPHA ? 2 :
+                            colorType == PNG_RGBA ? 4 : 1;
+        rowBytes_ = static_cast<uint32_t>((static_cast<uint64_t>(width) * channels * bitDepth + 7) / 8);
+        filterStep_ = std::max<uint32_t>(channels * bitDepth / 8, 1);
+
+        // Scanlines keep their filter type byte in front
+        cur_ = SlideArena::makeArray<uint8_t>(rowBytes_ + 1);
+        prev_ = SlideArena::makeArray<uint8_t>(rowBytes_ + 1);
+        out_ = SlideArena::makeArray<uint8_t>(direct ? width : width * 3);
+        if (prev_) {
+            memset(prev_.get(), 0, rowBytes_ + 1);
+        }
+    }
+
+    bool ok() const
+    {
+        return cur_ && prev_ && out_;
+    }
+
+    /** @brief Every row is decoded, or the rest is not visible */
+    bool finished() const
+    {
+        return y_ >= height_ || scaler_->done();
+    }
 
-    // Get image dimensions
-    uint32_t imgWidth = abs(header->width);
-    uint32_t imgHeight = abs(header->height);
-    bool topDown = (header->height < 0);  // Negative height means top-down
+    /**
+     * @brief Append inflated bytes
+     * @return false on an invalid filter type
+     */
+    bool consume(const uint8_t* data, size_t length)
+    {
+        while (length > 0 && !finished()) {
+            size_t take = std::min<size_t>(length, rowBytes_ + 1 - fill_);
+            memcpy(cur_.get() + fill_, data, take);
+            fill_ += take;
+            data += take;
+            length -= take;
+            if (fill_ == rowBytes_ + 1) {
+                if (!finishRow()) {
+                    return false;
+                }
+                fill_ = 0;
+            }
+        }
+        return true;
+    }
 
-    ESP_LOGI(TAG_IMG, "BMP: %dx%d, %d bpp", imgWidth, imgHeight, header->bitsPerPixel);
+private:
+    bool finishRow()
+    {
+        if (ImageDecode::aborted()) {
+            return false;
+        }
+        if (!unfilter()) {
+            ESP_LOGE(TAG_IMG, "Invalid PNG filter %u in row %u",
+                     (unsigned)cur_[0], (unsigned)y_);
+            return false;
+        }
 
-    // Get pixel data pointer
-    uint8_t* pixelData = fileBuffer + header->dataOffset;
+        const uint8_t* row = cur_.get() + 1;
+        uint8_t* out = out_.get();
+        if (direct_) {
+            for (uint32_t x = 0; x < width_; x++) {
+                out[x] = scratch_->paletteInk[readIndex(row, x)];
+            }
+            scaler_->pushInkRow(y_, out);
+        } else {
+            for (uint32_t x = 0; x < width_; x++) {
+                readRGB(row, x, &out[x * 3]);
+            }
+            scaler_->pushRow(y_, out);
+        }
 
-    // Clear display
-    display->clearBuffer();
+        std::swap(cur_, prev_);
+        y_++;
+        return true;
+    }
+
+    /** @brief Undo the scanline filter in place, against the previous row */
+    bool unfilter()
+    {
+        uint8_t* row = cur_.get() + 1;
+        const uint8_t* up = prev_.get() + 1;
+        uint32_t step = filterStep_;
+
+        switch (cur_[0]) {
+        case 0:  // None
+            break;
+        case 1:  // Sub
+            for (uint32_t i = step; i < rowBytes_; i++) {
+                row[i] += row[i - step];
+            }
+            break;
+        case 2:  // Up
+            for (uint32_t i = 0; i < rowBytes_; i++) {
+                row[i] += up[i];
+            }
+            break;
+        case 3:  // Average
+            for (uint32_t i = 0; i < rowBytes_; i++) {
+                uint32_t left = i >= step ? row[i - step] : 0;
+                row[i] += static_cast<uint8_t>((left + up[i]) >> 1);
+            }
+            break;
+        case 4:  // Paeth
+            for (uint32_t i = 0; i < rowBytes_; i++) {
+                int32_t a = i >= step ? row[i - step] : 0;
+                int32_t b = up[i];
+                int32_t c = i >= step ? up[i - step] : 0;
+                int32_t p = a + b - c;
+                int32_t pa = abs(p - a);
+                int32_t pb = abs(p - b);
+                int32_t pc = abs(p - c);
+                row[i] += static_cast<uint8_t>((pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c));
+            }
+            break;
+        default:
+            return false;
+        }
+        return true;
+    }
+
+    /** @brief Palette index / gray level of a 1/2/4/8-bit pixel */
+    inline uint8_t readIndex(const uint8_t* row, uint32_t x) const
+    {
+        if (bitDepth_ == 8) {
+            return row[x];
+        }
+        uint32_t bit = x * bitDepth_;
+        uint32_t shift = 8 - bitDepth_ - (bit % 8);
+        return (row[bit / 8] >> shift) & ((1u << bitDepth_) - 1);
+    }
+
+    /** @brief One pixel as RGB; alpha is composited over white (the paper) */
+    inline void readRGB(const uint8_t* row, uint32_t x, uint8_t* rgb) const
+    {
+        if (colorType_ == PNG_PALETTE || (colorType_ == PNG_GRAY && bitDepth_ <= 8)) {
+            memcpy(rgb, scratch_->palette[readIndex(row, x)], 3);
+            return;
+        }
+
+        // 8 or 16-bit samples; 16-bit keeps the most significant byte
+        uint32_t sampleBytes = bitDepth_ / 8;
+        uint32_t channels = colorType_ == PNG_GRAY ? 1 :
+                            colorType_ == PNG_GRAY_ALPHA ? 2 :
+                            colorType_ == PNG_RGB ? 3 : 4;
+        const uint8_t* px = row + x * channels * sampleBytes;
+        bool gray = colorType_ == PNG_GRAY || colorType_ == PNG_GRAY_ALPHA;
+        for (int c = 0; c < 3; c++) {
+            rgb[c] = px[gray ? 0 : c * sampleBytes];
+        }
+        if (colorType_ == PNG_GRAY_ALPHA || colorType_ == PNG_RGBA) {
+            uint32_t alpha = px[(channels - 1) * sampleBytes];
+            for (int c = 0; c < 3; c++) {
+                rgb[c] = static_cast<uint8_t>((rgb[c] * alpha + 255 * (255 - alpha) + 127) / 255);
+            }
+        }
+    }
+
+    uint32_t width_;
+    uint32_t height_;
+    uint8_t bitDepth_;
+    uint8_t colorType_;
+    const DecodeScratch* scratch_;
+    RowScaler* scaler_;
+    bool direct_;
+    uint32_t rowBytes_;
+    uint32_t filterStep_;  // Bytes per complete pixel (at least 1)
+    SlideArena::Ptr<uint8_t[]> cur_;
+    SlideArena::Ptr<uint8_t[]> prev_;
+    SlideArena::Ptr<uint8_t[]> out_;  // Row as EPD colors (direct) or RGB
+    size_t fill_;
+    uint32_t y_;
+};
+
+static bool validPngFormat(uint8_t colorType, uint8_t bitDepth)
+{
+    switch (colorType) {
+    case PNG_GRAY:
+        return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16;
+    case PNG_PALETTE:
+        return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8;
+    case PNG_RGB:
+    case PNG_GRAY_ALPHA:
+    case PNG_RGBA:
+        return bitDepth == 8 || bitDepth == 16;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Build paletteInk for an indexed PNG
+ *
+ * Unless the entries are all panel inks, they take the image's tone here,
+ * once, rather than every pixel that indexes them.
+ * @return true if every entry is exactly one of the palette's inks
+ */
+static bool buildPngPaletteInks(DecodeScratch* scratch, uint32_t entries)
+{
+    const Dither::Palette palette = ImageLoader::getPalette();
+    bool inkPalette = true;
+    for (uint32_t i = 0; i < entries; i++) {
+        uint8_t ink;
+        if (!Dither::exactInk(palette, scratch->palette[i], ink)) {
+            inkPalette = false;
+            break;
+        }
+    }
+    const uint8_t* tone = ImageDecode::toneCurve();
+    if (!inkPalette && tone) {
+        ImageDecode::applyTone(tone, scratch->palette[0], entries);
+    }
+    for (uint32_t i = 0; i < entries; i++) {
+        const uint8_t* rgb = scratch->palette[i];
+        uint8_t ink = EPD_WHITE;
+        if (!inkPalette || !Dither::exactInk(palette, rgb, ink)) {
+            ink = Dither::inkFor(palette, rgb[0], rgb[1], rgb[2]);
+        }
+        scratch->paletteInk[i] = ink;
+    }
+    return inkPalette;
+}
+
+static bool renderPNG(const char* filepath, Adafruit_IL0373* display)
+{
+    static const uint8_t PNG_SIGNATURE[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+
+    ESP_LOGI(TAG_IMG, "Loading PNG: %s", filepath);
+
+    SlideArena::Scope arena;
+    FILE* file = openImageFile(filepath);
+    if (!file) {
+        ESP_LOGE(TAG_IMG, "Cannot open file");
+        return false;
+    }
+    ReadAhead::Stream stream(file);
+
+    // Signature, then IHDR must be the first chunk
+    uint8_t head[8 + 8 + 13 + 4];
+    if (stream.read(head, sizeof(head)) != sizeof(head) ||
+        memcmp(head, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) != 0 ||
+        readBE32(&head[8]) != 13 || memcmp(&head[12], "IHDR", 4) != 0) {
+        ESP_LOGE(TAG_IMG, "Invalid PNG header");
+        return false;
+    }
+    const uint8_t* ihdr = &head[16];
+    uint32_t imgWidth = readBE32(&ihdr[0]);
+    uint32_t imgHeight = readBE32(&ihdr[4]);
+    uint8_t bitDepth = ihdr[8];
+    uint8_t colorType = ihdr[9];
+    uint8_t interlace = ihdr[12];
+
+    ESP_LOGI(TAG_IMG, "PNG: %ux%u, type %u, %u-bit", (unsigned)imgWidth,
+             (unsigned)imgHeight, colorType, bitDepth);
+
+    if (imgWidth == 0 || imgHeight == 0 || !validPngFormat(colorType, bitDepth) ||
+        ihdr[10] != 0 || ihdr[11] != 0) {
+        ESP_LOGE(TAG_IMG, "Unsupported PNG format");
+        return false;
+    }
+    if (interlace != 0) {
+        ESP_LOGE(TAG_IMG, "Interlaced PNG not supported");
+        return false;
+    }
+
+    // Inflate state; the 32 KB window is the LZ77 dictionary deflate requires
+    SlideArena::Ptr<DecodeScratch> scratch = SlideArena::make<DecodeScratch>();
+    SlideArena::Ptr<tinfl_decompressor> inflator = SlideArena::make<tinfl_decompressor>();
+    SlideArena::Ptr<uint8_t[]> window = SlideArena::makeArray<uint8_t>(TINFL_LZ_DICT_SIZE);
+    SlideArena::Ptr<uint8_t[]> input = SlideArena::makeArray<uint8_t>(PNG_INPUT_SIZE);
+    if (!scratch || !inflator || !window || !input) {
+        ESP_LOGE(TAG_IMG, "No memory for decode buffers");
+        return false;
+    }
+    tinfl_init(inflator.get());
+
+    bool indexed = colorType == PNG_PALETTE || (colorType == PNG_GRAY && bitDepth <= 8);
+    uint32_t paletteEntries = 0;
+    if (colorType == PNG_GRAY && bitDepth <= 8) {
+        paletteEntries = 1u << bitDepth;
+        for (uint32_t i = 0; i < paletteEntries; i++) {
+            uint8_t gray = static_cast<uint8_t>(i * 255 / (paletteEntries - 1));
+            scratch->palette[i][0] = scratch->palette[i][1] = scratch->palette[i][2] = gray;
+        }
+    }
+
+    DisplaySink sink(display);
+    sink.begin();
+
+    RowScaler scaler(fitScale(imgWidth, imgHeight), imgWidth, imgHeight, scratch.get(), sink);
+    SlideArena::Ptr<PngRowDecoder> rows;
+
+    size_t windowPos = 0;
+    bool ok = true;
+    bool streamEnd = false;
+    while (ok && !streamEnd) {
+        uint8_t chunk[8];
+        if (stream.read(chunk, sizeof(chunk)) != sizeof(chunk)) {
+            break;  // Truncated: keep the rows decoded so far
+        }
+        uint32_t length = readBE32(chunk);
+        const uint8_t* type = &chunk[4];
+
+        if (memcmp(type, "PLTE", 4) == 0 && colorType == PNG_PALETTE) {
+            paletteEntries = std::min<uint32_t>(length / 3, 256);
+            ok = stream.read(scratch->palette, paletteEntries * 3) == paletteEntries * 3;
+            length -= paletteEntries * 3;
+        } else if (memcmp(type, "tRNS", 4) == 0 && colorType == PNG_PALETTE) {
+            // Per-entry alpha: composite the palette over white once
+            uint32_t count = std::min<uint32_t>(length, 256);
+            ok = stream.read(scratch->paletteInk, count) == count;
+            for (uint32_t i = 0; i < count && ok; i++) {
+                uint32_t alpha = scratch->paletteInk[i];
+                for (int c = 0; c < 3; c++) {
+                    scratch->palette[i][c] = static_cast<uint8_t>(
+                        (scratch->palette[i][c] * alpha + 255 * (255 - alpha) + 127) / 255);
+                }
+            }
+            length -= count;
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            if (!rows) {
+                // Palette chunks precede the image data
+                bool inkPalette = indexed && buildPngPaletteInks(scratch.get(), paletteEntries);
+                bool direct = indexed && !scaler.averaging() &&
+                              (inkPalette || ImageLoader::getDitherMode() == Dither::Mode::NONE);
+                if (inkPalette) {
+                    ESP_LOGI(TAG_IMG, "Palette is all panel inks, mapping indices directly");
+                }
+                if (indexed) {
+                    // Toned above, or left exact
+                    scaler.tonedSource();
+                }
+                rows = SlideArena::make<PngRowDecoder>(imgWidth, imgHeight, bitDepth,
+                                                       colorType, scratch.get(), &scaler, direct);
+                if (!rows || !rows->ok()) {
+                    ESP_LOGE(TAG_IMG, "No memory for PNG rows");
+                    ok = false;
+                    break;
+                }
+            }
+
+            while (length > 0 && ok && !streamEnd) {
+                size_t inLen = stream.read(input.get(), std::min<size_t>(length, PNG_INPUT_SIZE));
+                if (inLen == 0) {
+                    ok = false;
+                    break;
+                }
+                length -= inLen;
+
+                const uint8_t* in = input.get();
+                for (;;) {
+                    size_t inSize = inLen;
+                    size_t outSize = TINFL_LZ_DICT_SIZE - windowPos;
+                    tinfl_status status = tinfl_decompress(
+                        inflator.get(), in, &inSize, window.get(), window.get() + windowPos,
+                        &outSize, TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+                    in += inSize;
+                    inLen -= inSize;
+
+                    if (!rows->consume(window.get() + windowPos, outSize)) {
+                        ok = false;
+                        break;
+                    }
+                    windowPos = (windowPos + outSize) & (TINFL_LZ_DICT_SIZE - 1);
+
+                    if (status < 0) {
+                        ESP_LOGE(TAG_IMG, "PNG inflate failed (%d)", static_cast<int>(status));
+                        ok = false;
+                        break;
+                    }
+                    if (status == TINFL_STATUS_DONE || rows->finished()) {
+                        streamEnd = true;
+                        break;
+                    }
+                    if (inLen == 0 && status == TINFL_STATUS_NEEDS_MORE_INPUT) {
+                        break;
+                    }
+                }
+            }
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            break;
+        }
+
+        // Skip whatever is left of the chunk, and its CRC
+        if (ok && !streamEnd && !stream.skip(static_cast<size_t>(length) + 4)) {
+            break;
+        }
+    }
+
+    if (ok && !rows) {
+        ESP_LOGE(TAG_IMG, "PNG has no image data");
+        ok = false;
+    }
+    return ok;
+}
+
+/**
+ * @brief Check a QOI header: magic, a non-empty size, RGB or RGBA
+ */
+static bool parseQoiHeader(const uint8_t* head, uint32_t& width, uint32_t& height,
+                           uint8_t& channels)
+{
+    width = readBE32(&head[4]);
+    height = readBE32(&head[8]);
+    channels = head[12];
+    return memcmp(head, "qoif", 4) == 0 && width != 0 && height != 0 &&
+           (channels == 3 || channels == 4) && head[13] <= 1;
+}
+
+/**
+ * @brief Decode a QOI image in one pass over its chunks
+ *
+ * The whole decoder state is the previous pixel, the 64-entry table of
+ * recently seen ones and a run count: each row is rebuilt into one RGB line
+ * for the scaler, and the file is read front to back in small blocks.
+ * Alpha is composited over white, as for PNG.
+ */
+static bool renderQOI(const char* filepath, Adafruit_IL0373* display)
+{
+    ESP_LOGI(TAG_IMG, "Loading QOI: %s", filepath);
+
+    SlideArena::Scope arena;
+    FILE* file = openImageFile(filepath);
+    if (!file) {
+        ESP_LOGE(TAG_IMG, "Cannot open file");
+        return false;
+    }
+    ReadAhead::Stream stream(file);
+
+    uint8_t head[QOI_HEADER_SIZE];
+    uint32_t imgWidth;
+    uint32_t imgHeight;
+    uint8_t channels;
+    if (stream.read(head, sizeof(head)) != sizeof(head) ||
+        !parseQoiHeader(head, imgWidth, imgHeight, channels)) {
+        ESP_LOGE(TAG_IMG, "Invalid QOI header");
+        return false;
+    }
+    ESP_LOGI(TAG_IMG, "QOI: %ux%u, %u channels", (unsigned)imgWidth, (unsigned)imgHeight,
+             channels);
+
+    SlideArena::Ptr<DecodeScratch> scratch = SlideArena::make<DecodeScratch>();
+    SlideArena::Ptr<uint8_t[]> input = SlideArena::makeArray<uint8_t>(QOI_INPUT_SIZE);
+    SlideArena::Ptr<uint8_t[]> row = SlideArena::makeArray<uint8_t>(imgWidth * 3);
+    if (!scratch || !input || !row) {
+        ESP_LOGE(TAG_IMG, "No memory for decode buffers");
+        return false;
+    }
+
+    DisplaySink sink(display);
+    sink.begin();
+    RowScaler scaler(fitScale(imgWidth, imgHeight), imgWidth, imgHeight, scratch.get(), sink);
+
+    size_t inPos = 0;
+    size_t inLen = 0;
+    auto next = [&](uint8_t* dst, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            if (inPos == inLen) {
+                inLen = stream.read(input.get(), QOI_INPUT_SIZE);
+                inPos = 0;
+                if (inLen == 0) {
+                    return false;
+                }
+            }
+            dst[i] = input[inPos++];
+        }
+        return true;
+    };
+
+    uint8_t seen[64][4] = {};
+    uint8_t px[4] = { 0, 0, 0, 255 };
+    uint32_t run = 0;
+    for (uint32_t y = 0; y < imgHeight && !scaler.done(); y++) {
+        if (ImageDecode::aborted()) {
+            return false;
+        }
+        uint8_t* out = row.get();
+        for (uint32_t x = 0; x < imgWidth; x++, out += 3) {
+            if (run > 0) {
+                run--;
+            } else {
+                uint8_t op;
+                uint8_t arg[4];
+                bool ok = next(&op, 1);
+                if (ok && op == QOI_OP_RGB) {
+                    ok = next(px, 3);
+                } else if (ok && op == QOI_OP_RGBA) {
+                    ok = next(px, 4);
+                } else if (ok && (op & 0xC0) == QOI_OP_INDEX) {
+                    memcpy(px, seen[op], 4);
+                } else if (ok && (op & 0xC0) == QOI_OP_DIFF) {
+                    px[0] += ((op >> 4) & 0x03) - 2;
+                    px[1] += ((op >> 2) & 0x03) - 2;
+                    px[2] += (op & 0x03) - 2;
+                } else if (ok && (op & 0xC0) == QOI_OP_LUMA) {
+                    ok = next(arg, 1);
+                    int dg = (op & 0x3F) - 32;
+                    px[0] += dg - 8 + (arg[0] >> 4);
+                    px[1] += dg;
+                    px[2] += dg - 8 + (arg[0] & 0x0F);
+                } else if (ok) {
+                    run = op & 0x3F;  // QOI_OP_RUN: this pixel and run more
+                }
+                if (!ok) {
+                    ESP_LOGE(TAG_IMG, "QOI data ends in row %u", (unsigned)y);
+                    return false;
+                }
+                memcpy(seen[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64], px, 4);
+            }
+            if (px[3] == 255) {
+                memcpy(out, px, 3);
+            } else {
+                uint32_t alpha = px[3];
+                for (int c = 0; c < 3; c++) {
+                    out[c] = static_cast<uint8_t>(
+                        (px[c] * alpha + 255 * (255 - alpha) + 127) / 255);
+                }
+            }
+        }
+        scaler.pushRow(y, row.get());
+    }
+    return true;
+}
+
+static uint16_t clampDimension(uint32_t value)
+{
+    return static_cast<uint16_t>(std::min<uint32_t>(value, UINT16_MAX));
+}
+
+static bool probeBMP(FILE* file, SDCard::ImageInfo& info)
+{
+    ImageLoader::BMPHeader header;
+    if (fread(&header, 1, sizeof(header), file) != sizeof(header) ||
+        !ImageDecode::checkBMPHeader(header)) {
+        return false;
+    }
+    info.format = SDCard::ImageFormat::BMP;
+    info.bitsPerPixel = static_cast<uint8_t>(header.bitsPerPixel);
+    info.compression = static_cast<uint8_t>(header.compression);
+    info.width = clampDimension(abs(header.width));
+    info.height = clampDimension(abs(header.height));
+    info.dataOffset = header.dataOffset;
+    return true;
+}
+
+static bool probePNG(FILE* file, SDCard::ImageInfo& info)
+{
+    static const uint8_t PNG_SIGNATURE[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+
+    // Same checks as renderPNG()
+    uint8_t head[8 + 8 + 13];
+    if (fread(head, 1, sizeof(head), file) != sizeof(head) ||
+        memcmp(head, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) != 0 ||
+        readBE32(&head[8]) != 13 || memcmp(&head[12], "IHDR", 4) != 0) {
+        ESP_LOGE(TAG_IMG, "Invalid PNG header");
+        return false;
+    }
+    const uint8_t* ihdr = &head[16];
+    uint32_t imgWidth = readBE32(&ihdr[0]);
+    uint32_t imgHeight = readBE32(&ihdr[4]);
+    if (imgWidth == 0 || imgHeight == 0 || !validPngFormat(ihdr[9], ihdr[8]) ||
+        ihdr[10] != 0 || ihdr[11] != 0 || ihdr[12] != 0) {
+        ESP_LOGE(TAG_IMG, "Unsupported PNG format");
+        return false;
+    }
+    info.format = SDCard::ImageFormat::PNG;
+    info.bitsPerPixel = ihdr[8];
+    info.compression = ihdr[9];
+    info.width = clampDimension(imgWidth);
+    info.height = clampDimension(imgHeight);
+    return true;
+}
+
+static bool probeQOI(FILE* file, SDCard::ImageInfo& info)
+{
+    uint8_t head[QOI_HEADER_SIZE];
+    uint32_t imgWidth;
+    uint32_t imgHeight;
+    uint8_t channels;
+    if (fread(head, 1, sizeof(head), file) != sizeof(head) ||
+        !parseQoiHeader(head, imgWidth, imgHeight, channels)) {
+        ESP_LOGE(TAG_IMG, "Invalid QOI header");
+        return false;
+    }
+    info.format = SDCard::ImageFormat::QOI;
+    info.bitsPerPixel = static_cast<uint8_t>(channels * 8);
+    info.width = clampDimension(imgWidth);
+    info.height = clampDimension(imgHeight);
+    return true;
+}
+
+/**
+ * @brief Walk the JPEG markers to the frame header
+ *
+ * TJpgDec decodes baseline (SOF0) only; any other frame type is rejected
+ * here rather than after a jd_prepare() per visit.
+ */
+static bool probeJPEG(FILE* file, SDCard::ImageInfo& info)
+{
+    uint8_t soi[2];
+    if (fread(soi, 1, sizeof(soi), file) != sizeof(soi) || soi[0] != 0xFF || soi[1] != 0xD8) {
+        ESP_LOGE(TAG_IMG, "Invalid JPEG header");
+        return false;
+    }
+    for (int i = 0; i < JPEG_PROBE_MAX_SEGMENTS; i++) {
+        uint8_t segment[4];
+        if (fread(segment, 1, sizeof(segment), file) != sizeof(segment) || segment[0] != 0xFF) {
+            break;
+        }
+        uint8_t marker = segment[1];
+        uint16_t length = static_cast<uint16_t>((segment[2] << 8) | segment[3]);
+        if (marker == 0xC0) {
+            uint8_t frame[6];  // Precision, height, width, components
+            if (length < 2 + sizeof(frame) ||
+                fread(frame, 1, sizeof(frame), file) != sizeof(frame)) {
+                break;
+            }
+            info.format = SDCard::ImageFormat::JPEG;
+            info.bitsPerPixel = static_cast<uint8_t>(frame[5] * 8);
+            info.width = static_cast<uint16_t>((frame[3] << 8) | frame[4]);
+            info.height = static_cast<uint16_t>((frame[1] << 8) | frame[2]);
+            return info.width != 0 && info.height != 0;
+        }
+        // SOF1..SOF15, except DHT (C4), JPG (C8) and DAC (CC)
+        if (marker > 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            ESP_LOGE(TAG_IMG, "JPEG frame type 0x%02X not supported (baseline only)", marker);
+            return false;
+        }
+        if (marker == 0xDA || marker == 0xD9 || length < 2 ||
+            fseek(file, length - 2, SEEK_CUR) != 0) {
+            break;
+        }
+    }
+    ESP_LOGE(TAG_IMG, "No JPEG frame header");
+    return false;
+}
+
+static bool probeEPD(FILE* file, SDCard::ImageInfo& info)
+{
+    // Layout is checked against the display when the frame is shown
+    ImageLoader::EPDImageHeader header = {};
+    constexpr size_t v1Size = ImageLoader::EPD_IMAGE_V1_HEADER_SIZE;
+    if (fread(&header, 1, v1Size, file) != v1Size ||
+        header.magic != ImageLoader::EPD_IMAGE_MAGIC ||
+        (header.version != 1 && header.version != ImageLoader::EPD_IMAGE_VERSION) ||
+        (header.version != 1 &&
+         fread(reinterpret_cast<uint8_t*>(&header) + v1Size, 1, sizeof(header) - v1Size, file) !=
+             sizeof(header) - v1Size)) {
+        ESP_LOGE(TAG_IMG, "Invalid .epd header");
+        return false;
+    }
+    if (!FrameCodec::supported(header.encoding) ||
+        (header.panel != 0 && header.panel != Panel::active().id) ||
+        header.planeCount < 1 || header.planeCount > 2) {
+        ESP_LOGE(TAG_IMG, ".epd encoding %d for panel %d can't be shown here",
+                 header.encoding, header.panel);
+        return false;
+    }
+    info.format = SDCard::ImageFormat::EPD;
+    info.compression = header.encoding;
+    info.width = header.width;
+    info.height = header.height;
+    info.dataOffset = header.version == 1 ? v1Size : sizeof(header);
+    return true;
+}
 
-    // Calculate scaling to fit display
-    float scaleX = static_cast<float>(DISPLAY_WIDTH) / imgWidth;
-    float scaleY = static_cast<float>(DISPLAY_HEIGHT) / imgHeight;
-    float scale = std::min(scaleX, scaleY);  // Maintain aspect ratio
-
-    uint32_t scaledWidth = static_cast<uint32_t>(imgWidth * scale);
-    uint32_t scaledHeight = static_cast<uint32_t>(imgHeight * scale);
-    uint32_t offsetX = (DISPLAY_WIDTH - scaledWidth) / 2;
-    uint32_t offsetY = (DISPLAY_HEIGHT - scaledHeight) / 2;
-
-    // Process pixels based on bit depth
-    if (header->bitsPerPixel == 24) {
-        // 24-bit RGB
-        uint32_t rowSize = ((imgWidth * 3 + 3) / 4) * 4;  // Row size is padded to 4 bytes
-        for (uint32_t y = 0; y < scaledHeight; y++) {
-            uint32_t srcY = static_cast<uint32_t>((y / scale));
-            if (!topDown) {
-                srcY = imgHeight - 1 - srcY;  // BMP is typically bottom-up
-            }
-            
-            for (uint32_t x = 0; x < scaledWidth; x++) {
-                uint32_t srcX = static_cast<uint32_t>((x / scale));
-                uint32_t pixelOffset = srcY * rowSize + srcX * 3;
-                
-                // BMP stores as BGR
-                uint8_t b = pixelData[pixelOffset];
-                uint8_t g = pixelData[pixelOffset + 1];
-                uint8_t r = pixelData[pixelOffset + 2];
-                
-                uint16_t color = rgbToEinkColor(r, g, b);
-                display->drawPixel(offsetX + x, offsetY + y, color);
-            }
-        }
-    } else if (header->bitsPerPixel == 8) {
-        // 8-bit grayscale (with palette)
-        // Simplified: treat as grayscale
-        uint32_t rowSize = ((imgWidth + 3) / 4) * 4;
-        for (uint32_t y = 0; y < scaledHeight; y++) {
-            uint32_t srcY = static_cast<uint32_t>((y / scale));
-            if (!topDown) {
-                srcY = imgHeight - 1 - srcY;
-            }
-            
-            for (uint32_t x = 0; x < scaledWidth; x++) {
-                uint32_t srcX = static_cast<uint32_t>((x / scale));
-                uint8_t gray = pixelData[srcY * rowSize + srcX];
-                
-                uint16_t color = (gray < 128) ? EPD_BLACK : EPD_WHITE;
-                display->drawPixel(offsetX + x, offsetY + y, color);
-            }
-        }
-    } else if (header->bitsPerPixel == 1) {
-        // 1-bit monochrome
-        uint32_t rowSize = ((imgWidth + 7) / 8 + 3) / 4 * 4;
-        for (uint32_t y = 0; y < scaledHeight; y++) {
-            uint32_t srcY = static_cast<uint32_t>((y / scale));
-            if (!topDown) {
-                srcY = imgHeight - 1 - srcY;
-            }
-            
-            for (uint32_t x = 0; x < scaledWidth; x++) {
-                uint32_t srcX = static_cast<uint32_t>((x / scale));
-                uint32_t byteOffset = srcY * rowSize + (srcX / 8);
-                uint8_t bitOffset = 7 - (srcX % 8);
-                uint8_t bit = (pixelData[byteOffset] >> bitOffset) & 1;
-                
-                uint16_t color = bit ? EPD_BLACK : EPD_WHITE;
-                display->drawPixel(offsetX + x, offsetY + y, color);
-            }
-        }
-    }
-
-    // Refresh display
-    display->display();
-    
-    delete[] fileBuffer;
-    ESP_LOGI(TAG_IMG, "Image displayed successfully");
+static bool probeCollage(const char* filepath, SDCard::ImageInfo& info)
+{
+    std::unique_ptr<Collage::Layout> layout(new (std::nothrow) Collage::Layout());
+    if (!layout || !Collage::parse(filepath, *layout)) {
+        return false;
+    }
+    info.format = SDCard::ImageFormat::COLLAGE;
+    info.compression = layout->count;
+    info.width = DISPLAY_WIDTH;
+    info.height = DISPLAY_HEIGHT;
     return true;
 }
 
+bool ImageLoader::probe(const char* filepath, SDCard::ImageInfo& info)
+{
+    SDCard::BusBurst burst;
+    FILE* file = fopen(filepath, "rb");
+    if (!file) {
+        return false;
+    }
+    // A few small reads: FatFs' own sector buffer is enough
+    setvbuf(file, nullptr, _IONBF, 0);
+
+    info = SDCard::ImageInfo();
+    bool ok;
+    if (Collage::isCollage(filepath)) {
+        ok = probeCollage(filepath, info);
+    } else if (hasExtension(filepath, ".epd")) {
+        ok = probeEPD(file, info);
+    } else if (isJPEG(filepath)) {
+        ok = probeJPEG(file, info);
+    } else if (hasExtension(filepath, ".png")) {
+        ok = probePNG(file, info);
+    } else if (hasExtension(filepath, ".qoi")) {
+        ok = probeQOI(file, info);
+    } else {
+        ok = probeBMP(file, info);
+    }
+    fclose(file);
+    return ok;
+}
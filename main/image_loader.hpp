@@ -7,10 +7,12 @@
 
 #include <cstdint>
 #include <cstddef>
+#include "dither.hpp"
 
 // Forward declarations
 class Adafruit_GFX;
 class Adafruit_IL0373;
+namespace SDCard { class ImagePack; struct ImageInfo; }
 
 namespace ImageLoader {
 
@@ -29,7 +31,7 @@ struct BMPHeader {
     int32_t  height;
     uint16_t planes;          // Must be 1
     uint16_t bitsPerPixel;    // 1, 4, 8, 24
-    uint32_t compression;     // 0 = none
+    uint32_t compression;     // BMP_BI_RGB, BMP_BI_RLE8 or BMP_BI_RLE4
     uint32_t imageSize;
     int32_t  xPixelsPerM;
     int32_t  yPixelsPerM;
@@ -38,14 +40,374 @@ struct BMPHeader {
 };
 #pragma pack(pop)
 
+// BMPHeader::compression values
+static constexpr uint32_t BMP_BI_RGB = 0;
+static constexpr uint32_t BMP_BI_RLE8 = 1;  // 8 bpp only
+static constexpr uint32_t BMP_BI_RLE4 = 2;  // 4 bpp only
+
+/**
+ * @brief Native pre-packed ".epd" image header
+ *
+ * The header is followed directly by the plane data as it sits in the
+ * display's framebuffer (Adafruit_EPD buffer1, then buffer2): controller
+ * bit order and inversion already applied, so a server can dither and pack
+ * for the panel and the device does no per-pixel work. Each plane is stored
+ * with the header's encoding (frame_codec.hpp: raw, RLE or LZ) and expanded
+ * straight into its buffer. Produced on the host by tools/epd_convert.py.
+ *
+ * Version 1 frames end the header after plane2Size and are always RAW;
+ * they are still read.
+ */
+#pragma pack(push, 1)
+struct EPDImageHeader {
+    uint32_t magic;         // EPD_IMAGE_MAGIC ("EPDI")
+    uint8_t  version;       // EPD_IMAGE_VERSION, or 1
+    uint8_t  entryMode;     // thinkink_sramentrymode_t the planes are packed for
+    uint8_t  planeCount;    // 1 = black only, 2 = black + color
+    uint8_t  encoding;      // EPD_ENCODING_* of both planes (0 in version 1)
+    uint16_t width;         // Logical width the frame was rendered for (after rotation)
+    uint16_t height;        // Logical height
+    uint32_t plane1Size;    // Bytes of plane 1 (buffer1)
+    uint32_t plane2Size;    // Bytes of plane 2 (buffer2), 0 when planeCount == 1
+    // Version 2
+    uint8_t  panel;         // Panel::Profile::id it was rendered for, 0 = any
+    uint8_t  rotation;      // setRotation() it was rendered for
+    uint16_t reserved;
+    uint32_t plane1Stored;  // Bytes of plane 1 as encoded
+    uint32_t plane2Stored;  // Bytes of plane 2 as encoded
+};
+#pragma pack(pop)
+
+static constexpr uint32_t EPD_IMAGE_MAGIC = 0x49445045;  // "EPDI" little-endian
+static constexpr uint8_t EPD_IMAGE_VERSION = 2;
+static constexpr size_t EPD_IMAGE_V1_HEADER_SIZE = 20;
+
+// EPDImageHeader::encoding values
+static constexpr uint8_t EPD_ENCODING_RAW = 0;
+static constexpr uint8_t EPD_ENCODING_RLE = 1;  // Byte runs, see frame_codec.hpp
+static constexpr uint8_t EPD_ENCODING_LZ = 2;   // heatshrink LZSS, see frame_codec.hpp
+
+/**
+ * @brief Load and display an image, picking the decoder from the file extension
+ *
+ * Decoded (non-.epd) images are stored in IMAGE_CACHE_DIRECTORY as packed
+ * frames keyed by path, size and mtime, so later visits load the cached
+ * planes instead of decoding again.
+ *
+ * @param filepath Path to a .bmp, .jpg, .png, .qoi or .epd file
+ * @param display Display object (Adafruit_IL0373)
+ * @return true if successful, false otherwise
+ */
+bool loadAndDisplay(const char* filepath, Adafruit_IL0373* display);
+
+/**
+ * @brief Render an image into the display framebuffer without refreshing
+ *
+ * Same decoding and caching as loadAndDisplay(); call display() or
+ * displayAsync() afterwards to show it.
+ *
+ * @param filepath Path to a .bmp, .jpg, .png, .qoi or .epd file
+ * @param display Display object (Adafruit_IL0373)
+ * @return true if successful, false otherwise
+ */
+bool load(const char* filepath, Adafruit_IL0373* display);
+
+/**
+ * @brief Render a quick low-resolution preview of a JPEG into the display
+ *        framebuffer without refreshing
+ *
+ * The IDCT runs at 1/8 (DC coefficients only), the result is scaled up to
+ * the fitted size and ordered-dithered: a fraction of the full decode's
+ * time, for a fast-waveform refresh while the full frame decodes. Other
+ * formats, and JPEGs whose frame is in the cache, get no preview.
+ *
+ * @param filepath Path to the image
+ * @param display Display object (Adafruit_IL0373)
+ * @return true if a preview is in the framebuffer
+ */
+bool loadPreview(const char* filepath, Adafruit_IL0373* display);
+
+/**
+ * @brief Render an image into caller-owned framebuffer planes
+ *
+ * Used to decode the next slide ahead of time; the frame can later be shown
+ * with Adafruit_EPD::swapBuffers() + displayAsync(). The display's own
+ * framebuffer is left untouched.
+ *
+ * @param filepath Path to a .bmp, .jpg, .png, .qoi or .epd file
+ * @param display Display object, defines the plane layout
+ * @param plane1 Buffer of display->getBufferSize(0) bytes
+ * @param plane2 Buffer of display->getBufferSize(1) bytes
+ * @return true if successful, false otherwise
+ */
+bool loadIntoPlanes(const char* filepath, Adafruit_IL0373* display,
+                    uint8_t* plane1, uint8_t* plane2);
+
+/**
+ * @brief Load and display one slide of an image pack
+ * @param pack Open image pack
+ * @param index Slide index
+ * @param display Display object (Adafruit_IL0373)
+ * @return true if successful, false if the entry is invalid or doesn't match the panel
+ * @note The refresh is started with displayAsync() and still running on return
+ */
+bool loadAndDisplay(SDCard::ImagePack& pack, size_t index, Adafruit_IL0373* display);
+
+/**
+ * @brief Read one slide of an image pack into caller-owned framebuffer planes
+ *
+ * The pack counterpart of loadIntoPlanes(const char*, ...), for prefetching.
+ *
+ * @param pack Open image pack
+ * @param index Slide index
+ * @param display Display object, defines the plane layout
+ * @param plane1 Buffer of display->getBufferSize(0) bytes
+ * @param plane2 Buffer of display->getBufferSize(1) bytes
+ * @return true if successful, false otherwise
+ */
+bool loadIntoPlanes(SDCard::ImagePack& pack, size_t index, Adafruit_IL0373* display,
+                    uint8_t* plane1, uint8_t* plane2);
+
+/**
+ * @brief Load and display a pre-packed .epd image (no per-pixel work)
+ * @param filepath Path to .epd file
+ * @param display Display object (Adafruit_IL0373)
+ * @return true if successful, false if the file is invalid or doesn't match the panel
+ * @note The refresh is started with displayAsync() and still running on return.
+ *       A display without an on-chip framebuffer gets the planes streamed
+ *       chunk by chunk (Adafruit_EPD::beginPlaneWrite()) and refreshes
+ *       synchronously; the same goes for pack entries.
+ */
+bool loadAndDisplayEPD(const char* filepath, Adafruit_IL0373* display);
+
+/**
+ * @brief Reads the next bytes of a frame for loadAndDisplayEPD(FrameReader, ...)
+ * @param ctx The caller's context
+ * @param dst Where the bytes go: the framebuffer planes themselves, or the
+ *            stream chunk on a display without them
+ * @param len Bytes wanted
+ * @return Bytes read; fewer than len ends the frame as truncated
+ */
+using FrameReader = size_t (*)(void* ctx, void* dst, size_t len);
+
+/**
+ * @brief Display a packed .epd frame read from anywhere but a file, e.g. a
+ *        socket
+ *
+ * Validated and shown exactly like loadAndDisplayEPD(const char*, ...); the
+ * bytes are read in place, so nothing holds the frame but the display.
+ *
+ * @param read Called for the header, then for each plane (or chunk)
+ * @param ctx Passed to read
+ * @param display Display object (Adafruit_IL0373)
+ * @return true if successful, false if the frame is invalid, truncated or
+ *         doesn't match the panel
+ */
+bool loadAndDisplayEPD(FrameReader read, void* ctx, Adafruit_IL0373* display);
+
+/**
+ * @brief Display a packed .epd frame that is already in memory, e.g. mapped
+ *        from flash (FlashPack::frame())
+ *
+ * Validated and shown like loadAndDisplayEPD(const char*, ...). The planes
+ * are expanded from where they lie into the framebuffer; on a display
+ * without one, RAW planes go to the controller straight from the mapping,
+ * with no copy at all.
+ *
+ * @param frame Header followed by the planes
+ * @param length Bytes at frame
+ * @param display Display object (Adafruit_IL0373)
+ * @return true if successful, false if the frame is invalid, truncated or
+ *         doesn't match the panel
+ */
+bool loadAndDisplayEPD(const uint8_t* frame, size_t length, Adafruit_IL0373* display);
+
+/**
+ * @brief Read a packed .epd frame in memory into caller-owned framebuffer
+ *        planes
+ *
+ * The in-memory counterpart of loadIntoPlanes(const char*, ...), for
+ * prefetching.
+ *
+ * @param frame Header followed by the planes
+ * @param length Bytes at frame
+ * @param display Display object, defines the plane layout
+ * @param plane1 Buffer of display->getBufferSize(0) bytes
+ * @param plane2 Buffer of display->getBufferSize(1) bytes
+ * @return true if successful, false otherwise
+ */
+bool loadIntoPlanes(const uint8_t* frame, size_t length, Adafruit_IL0373* display,
+                    uint8_t* plane1, uint8_t* plane2);
+
+/**
+ * @brief Load and display a baseline JPEG on e-ink display
+ *
+ * Decoded one MCU row at a time, using IDCT scaling (1/2, 1/4, 1/8) to
+ * shrink large photos before the fit scaler and ditherer.
+ *
+ * @param filepath Path to JPEG file
+ * @param display Display object (Adafruit_IL0373)
+ * @return true if successful, false otherwise (progressive JPEGs are not supported)
+ * @note The refresh is started with displayAsync() and still running on return
+ */
+bool loadAndDisplayJPEG(const char* filepath, Adafruit_IL0373* display);
+
+/**
+ * @brief Load and display a PNG on e-ink display
+ *
+ * Inflated one scanline at a time. Indexed images whose palette is pure
+ * black/white/red are mapped index -> ink with no color conversion.
+ *
+ * @param filepath Path to PNG file
+ * @param display Display object (Adafruit_IL0373)
+ * @return true if successful, false otherwise (interlaced PNGs are not supported)
+ * @note The refresh is started with displayAsync() and still running on return
+ */
+bool loadAndDisplayPNG(const char* filepath, Adafruit_IL0373* display);
+
 /**
  * @brief Load and display BMP image on e-ink display
  * @param filepath Path to BMP file
  * @param display Display object (Adafruit_IL0373)
  * @return true if successful, false otherwise
+ * @note The refresh is started with displayAsync() and still running on return
  */
 bool loadAndDisplayBMP(const char* filepath, Adafruit_IL0373* display);
 
+/**
+ * @brief Read an image's header and check that its decoder supports it
+ *
+ * Only the header is read (for a JPEG, the markers up to the frame header),
+ * with no stdio buffer. Matches SDCard::ImageProbe, for scanForImages().
+ *
+ * @param filepath Path to a .bmp, .jpg, .png, .qoi or .epd file
+ * @param info Output dimensions, depth, compression and data offset
+ * @return false if the file is damaged or in a variant that can't be shown
+ *         (progressive JPEG, interlaced PNG, .epd for another panel)
+ */
+bool probe(const char* filepath, SDCard::ImageInfo& info);
+
+/**
+ * @brief How images are resized to fit the display
+ */
+enum class ScaleMode : uint8_t {
+    NEAREST,  // Sample one source pixel per output pixel
+    AREA      // Average the source pixels under each output pixel when shrinking
+};
+
+/**
+ * @brief Select the resize filter (initially IMAGE_SCALE_MODE)
+ * @param mode Scale mode; enlarging always uses NEAREST
+ */
+void setScaleMode(ScaleMode mode);
+
+/**
+ * @brief Get the current resize filter
+ * @return Scale mode
+ */
+ScaleMode getScaleMode();
+
+/**
+ * @brief Select how RGB and grayscale images are quantized to the three inks
+ * @param mode Dithering mode; Dither::Mode::NONE uses rgbToEinkColor() thresholds
+ */
+void setDitherMode(Dither::Mode mode);
+
+/**
+ * @brief Get the current dithering mode (initially IMAGE_DITHER_MODE)
+ * @return Dithering mode
+ */
+Dither::Mode getDitherMode();
+
+/**
+ * @brief Tone curve applied to every color before it is quantized
+ *
+ * Per channel, in levels: out = (curve(in) - 128) * (100 + contrast) / 100
+ * + 128 + brightness, clamped, where curve(in) = 255 * (in / 255) ^ (100 /
+ * gamma).
+ */
+struct Tone {
+    uint16_t gamma;      // x100: 100 is linear, higher lifts the midtones
+    int8_t contrast;     // Percent, -100..100
+    int8_t brightness;   // Levels, -128..127
+
+    /** @brief The curve changes nothing */
+    bool linear() const
+    {
+        return gamma == 100 && contrast == 0 && brightness == 0;
+    }
+
+    bool operator==(const Tone& other) const
+    {
+        return gamma == other.gamma && contrast == other.contrast &&
+               brightness == other.brightness;
+    }
+};
+
+/**
+ * @brief Set the tone of images without a sidecar (initially IMAGE_TONE_*)
+ * @param tone Tone curve
+ */
+void setTone(const Tone& tone);
+
+/**
+ * @brief Get the tone of images without a sidecar
+ * @return Tone curve
+ */
+Tone getTone();
+
+/**
+ * @brief Select the inks the shared decode pipeline (ImageDecode) quantizes to
+ *
+ * Initially Dither::Palette::TRICOLOR; the slideshow sets the active panel
+ * profile's (Panel::active()). ACEP7 spans carry
+ * ACEP_COLOR_* codes for a sink that writes them to a 7-color panel
+ * (Adafruit_EPD::writeSpan() on an Adafruit_ACEP).
+ *
+ * @param palette Ink set
+ */
+void setPalette(Dither::Palette palette);
+
+/**
+ * @brief Get the inks decoded rows are quantized to
+ * @return Palette
+ */
+Dither::Palette getPalette();
+
+/**
+ * @brief Use the converted-frame cache or not (initially IMAGE_CACHE_ENABLED)
+ * @param enabled false decodes every image from its source
+ */
+void setCacheEnabled(bool enabled);
+
+/**
+ * @brief Check whether the converted-frame cache is used
+ * @return true if decoded frames are looked up and stored in the cache
+ */
+bool isCacheEnabled();
+
+/**
+ * @brief Outcome of warmCache()
+ */
+enum class WarmResult : uint8_t {
+    SKIPPED,    // Nothing to convert: an .epd, a collage, already cached or the cache is off
+    CONVERTED,  // Decoded and stored in the cache
+    FAILED      // Unreadable, out of memory or cancelled (RenderJob::cancelled())
+};
+
+/**
+ * @brief Convert a source image into the converted-frame cache ahead of
+ *        its first visit, decoding into caller-owned planes
+ *
+ * The framebuffer and the panel are left alone, so this may run between
+ * slides while one is on screen.
+ *
+ * @param plane1 Buffer of display->getBufferSize(0) bytes
+ * @param plane2 Buffer of display->getBufferSize(1) bytes
+ */
+WarmResult warmCache(const char* filepath, Adafruit_IL0373* display, uint8_t* plane1,
+                     uint8_t* plane2);
+
 /**
  * @brief Convert RGB pixel to e-ink color
  * @param r Red component (0-255)
@@ -11,18 +11,60 @@
 #include "esp_log.h"
 #include "esp_sleep.h"
 #include "esp_system.h"
+#include "nvs_flash.h"
+#include "esp_pm.h"
+#include "sdkconfig.h"
 
 #include "config.hpp"
 #include "slideshow.hpp"
-#include "button.hpp"
+#include "console.hpp"
+#include "boot_profile.hpp"
+#include "cpu_boost.hpp"
+#include "tunables.hpp"
 
 static const char* TAG_MAIN = "SlideshowMain";
 
 extern "C" void app_main(void)
 {
+    BootProfile::begin(esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_UNDEFINED);
     ESP_LOGI(TAG_MAIN, "E-Ink Slideshow Application Starting...");
     ESP_LOGI(TAG_MAIN, "Wakeup cause: %d", (int)esp_sleep_get_wakeup_cause());
 
+    // Spurious wakes go back to sleep before any subsystem is brought up
+    Slideshow::handleWake();
+
+    // NVS holds settings learned at runtime (e.g. the SD card clock)
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        nvs_flash_erase();
+        ret = nvs_flash_init();
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG_MAIN, "NVS unavailable: %s", esp_err_to_name(ret));
+    }
+    // Before anything sizes or clocks itself from them
+    Tunables::init();
+
+#if CONFIG_PM_ENABLE
+    // Drop to the XTAL clock and light-sleep while all tasks are blocked;
+    // drivers hold PM locks around their own transfers, CpuBoost the full
+    // clock while slides are decoded and uploaded
+    if (LIGHT_SLEEP_ENABLED) {
+        esp_pm_config_t pm_config = {};
+        pm_config.max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+        pm_config.min_freq_mhz = CONFIG_XTAL_FREQ;
+        pm_config.light_sleep_enable = true;
+        ret = esp_pm_configure(&pm_config);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG_MAIN, "Light sleep unavailable: %s", esp_err_to_name(ret));
+        } else {
+            // The clock otherwise stays at the minimum while decoding too
+            CpuBoost::init();
+        }
+    }
+#endif
+    CpuBoost::set(CpuBoost::Holder::BOOT, true);
+
     // Initialize slideshow system
     if (!Slideshow::init()) {
         ESP_LOGE(TAG_MAIN, "Failed to initialize slideshow");
@@ -31,12 +73,22 @@ extern "C" void app_main(void)
         return;
     }
 
-    // Configure deep sleep wake from buttons
-    SlideshowButtons::configure_wakeup();
-
     // Launch slideshow task
-    xTaskCreate(Slideshow::task, "slideshow_task", 8192, nullptr, 5, nullptr);
+#if CONFIG_FREERTOS_UNICORE
+    xTaskCreate(Slideshow::task, "slideshow_task", SLIDESHOW_TASK_STACK, nullptr,
+                SLIDESHOW_TASK_PRIORITY, nullptr);
+#else
+    // Decoding gets a core to itself; SD reads and panel uploads use the other
+    xTaskCreatePinnedToCore(Slideshow::task, "slideshow_task", SLIDESHOW_TASK_STACK, nullptr,
+                            SLIDESHOW_TASK_PRIORITY, nullptr,
+                            PIPELINE_ENABLED ? PIPELINE_DECODE_CORE : tskNO_AFFINITY);
+#endif
+
+    if (CONSOLE_ENABLED) {
+        Console::start();
+    }
 
     ESP_LOGI(TAG_MAIN, "Slideshow application started");
+    CpuBoost::set(CpuBoost::Holder::BOOT, false);
 }
 
@@ -0,0 +1,98 @@
+/**
+ * @file panel.cpp
+ * @brief Panel profiles and the one selected for this boot
+ */
+
+#include "panel.hpp"
+#include "tunables.hpp"
+#include "esp_log.h"
+#include "nvs.h"
+#include "../components/Adafruit_EPD/src/panels/ThinkInk_290_Grayscale4_T5.h"
+
+static const char* TAG_PANEL = "Panel";
+
+// Every entry shares Display's driver and DISPLAY_NATIVE_WIDTH x
+// DISPLAY_NATIVE_HEIGHT; Display::begin() refuses any other geometry
+static const Panel::Profile PROFILES[] = {
+    { DISPLAY_PANEL_ID, "il0373-2.9", &SLIDESHOW_PANEL, Dither::Palette::TRICOLOR, true,
+      DISPLAY_GHOST_MAX_REFRESHES, DISPLAY_GHOST_MAX_AREA_PERCENT,
+      EINK_SPI_COMMAND_HZ, EINK_SPI_DATA_HZ },
+    // The fast waveform merges both planes into one ink, which would lose
+    // the grays
+    { 2, "il0373-2.9-gray4", &thinkink_290_grayscale4_t5, Dither::Palette::GRAY4, false,
+      DISPLAY_GHOST_MAX_REFRESHES, DISPLAY_GHOST_MAX_AREA_PERCENT,
+      EINK_SPI_COMMAND_HZ, EINK_SPI_DATA_HZ },
+};
+
+static const Panel::Profile* s_active = nullptr;
+static Panel::Profile s_tuned;  // *s_active with the tunables applied
+
+const Panel::Profile* Panel::profiles(size_t& count)
+{
+    count = sizeof(PROFILES) / sizeof(PROFILES[0]);
+    return PROFILES;
+}
+
+const Panel::Profile* Panel::find(uint8_t id)
+{
+    for (const Profile& profile : PROFILES) {
+        if (profile.id == id) {
+            return &profile;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief A tunable's value, or the profile's own where it is 0
+ */
+template <typename T>
+static T tuned(Tunables::Id id, T profileValue)
+{
+    uint32_t value = Tunables::get(id);
+    return value != 0 ? static_cast<T>(value) : profileValue;
+}
+
+const Panel::Profile& Panel::active()
+{
+    if (s_active) {
+        return s_tuned;
+    }
+    uint8_t id = DISPLAY_PANEL_ID;
+    nvs_handle_t handle;
+    if (nvs_open(DISPLAY_NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        nvs_get_u8(handle, "panel", &id);
+        nvs_close(handle);
+    }
+    s_active = find(id);
+    if (!s_active) {
+        ESP_LOGW(TAG_PANEL, "Unknown panel %u in NVS, using %u", id, DISPLAY_PANEL_ID);
+        s_active = find(DISPLAY_PANEL_ID);
+    }
+    ESP_LOGI(TAG_PANEL, "Driving %s (panel %u)", s_active->name, s_active->id);
+    s_tuned = *s_active;
+    s_tuned.spiCommandHz = tuned(Tunables::Id::SPI_COMMAND_HZ, s_active->spiCommandHz);
+    s_tuned.spiDataHz = tuned(Tunables::Id::SPI_DATA_HZ, s_active->spiDataHz);
+    s_tuned.ghostMaxRefreshes =
+        tuned(Tunables::Id::GHOST_MAX_REFRESHES, s_active->ghostMaxRefreshes);
+    s_tuned.ghostMaxAreaPercent =
+        tuned(Tunables::Id::GHOST_MAX_AREA_PERCENT, s_active->ghostMaxAreaPercent);
+    return s_tuned;
+}
+
+bool Panel::select(uint8_t id)
+{
+    if (!find(id)) {
+        return false;
+    }
+    nvs_handle_t handle;
+    if (nvs_open(DISPLAY_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        return false;
+    }
+    bool ok = nvs_set_u8(handle, "panel", id) == ESP_OK && nvs_commit(handle) == ESP_OK;
+    nvs_close(handle);
+    if (!ok) {
+        ESP_LOGW(TAG_PANEL, "Failed to store panel %u", id);
+    }
+    return ok;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file panel.hpp
+ * @brief The display panel the apps drive, as a ThinkInkPanel type, and the
+ *        panels one firmware image can drive with it
+ *
+ * Display is the FeatherWing's 2.9" IL0373 panel. Other panels on the same
+ * controller and native geometry (the fleet's 2.9" boards) are Profiles:
+ * each names its panel table, the inks the decoders quantize to and the
+ * refresh policy and SPI clocks. The active profile is read from NVS at boot (console
+ * "panel <id>", applied on the next boot) and defaults to DISPLAY_PANEL_ID;
+ * Display::begin(*Panel::active().table) applies it. The framebuffers and
+ * decode buffers stay sized by config.hpp, so a panel of another size needs
+ * its own build.
+ */
+
+#pragma once
+
+#include "config.hpp"
+#include "dither.hpp"
+#include "../components/Adafruit_EPD/src/Adafruit_EPD.h"
+#include "../components/Adafruit_EPD/src/EPDPanel.h"
+#include <cstddef>
+
+// The FeatherWing's panel with the IL0373 driver's own plane order (black
+// in buffer 1, both inverted), which tools/epd_convert.py writes .epd files in
+inline constexpr epd_panel_t SLIDESHOW_PANEL = {
+    DISPLAY_NATIVE_WIDTH,
+    DISPLAY_NATIVE_HEIGHT,
+    THINKINK_TRICOLOR,
+    0,
+    true,
+    1,
+    true,
+    { 0b00, 0b01, 0b10, 0b10, 0b01, 0b10, 0b00 },  // EPD_WHITE .. EPD_YELLOW
+    15000,
+    nullptr,
+    nullptr,
+};
+using Display = ThinkInkPanel<SLIDESHOW_PANEL, Adafruit_IL0373>;
+
+namespace Panel {
+
+/**
+ * @brief A panel Display can drive, and how the pipeline treats it
+ */
+struct Profile {
+    uint8_t id;                    // .epd panel ID (tools/epd_convert.py --panel)
+    const char* name;
+    const epd_panel_t* table;      // Geometry, planes, color mapping, waveform
+    Dither::Palette palette;       // Inks decoded images are quantized to
+    bool fastNavigation;           // IL0373 fast waveform (setFastMode()) can show it
+    uint8_t ghostMaxRefreshes;     // Adafruit_EPD::setGhostPolicy()
+    uint16_t ghostMaxAreaPercent;
+    uint32_t spiCommandHz;         // Adafruit_EPD::setSPIClocks()
+    uint32_t spiDataHz;
+};
+
+/**
+ * @brief The profiles this build knows
+ * @param count Set to the number of entries
+ */
+const Profile* profiles(size_t& count);
+
+/**
+ * @brief Look up a profile by panel ID
+ * @return nullptr if no profile has that ID
+ */
+const Profile* find(uint8_t id);
+
+/**
+ * @brief The profile this boot drives (read from NVS on the first call),
+ *        with the SPI clock and ghost policy tunables applied
+ */
+const Profile& active();
+
+/**
+ * @brief Store the profile to drive from the next boot on
+ * @return false if the ID is unknown or NVS could not be written
+ */
+bool select(uint8_t id);
+
+} // namespace Panel
@@ -0,0 +1,301 @@
+/**
+ * @file perf_log.cpp
+ * @brief Binary performance log implementation
+ */
+
+#include "perf_log.hpp"
+#include "config.hpp"
+#include "sd_card.hpp"
+#include "slide_stats.hpp"
+#include "battery.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <new>
+
+static const char* TAG_PERF = "PerfLog";
+
+static constexpr size_t STAGE_COUNT = static_cast<size_t>(SlideStats::Stage::COUNT);
+static constexpr size_t LOAD_COUNT = static_cast<size_t>(PowerStats::Load::COUNT);
+
+namespace {
+
+enum class Kind : uint8_t {
+    PADDING,  // All zero: the rest of a batch written out early
+    SLIDE,
+    POWER,
+    FAILURE,
+};
+
+/**
+ * @brief One log entry; tools/perf_log.py reads the same layout
+ */
+#pragma pack(push, 1)
+struct Entry {
+    uint8_t magic;      // ENTRY_MAGIC, 0 for padding
+    Kind kind;
+    uint16_t index;     // Slide index, 0xFFFF for boot
+    uint32_t seq;       // Counts up from 0 at power-on; a gap is a dropped entry
+    uint32_t unixTime;  // Wall clock, 0 if it wasn't set
+    uint32_t uptimeMs;  // Since boot or the last wake
+    union {
+        struct {
+            uint16_t ms[STAGE_COUNT];  // Time per stage, saturated
+            uint16_t mask;             // Stages that ran
+            uint8_t flags;             // SLIDE_FLAG_*
+            int8_t celsius;            // Panel temperature, -128 if unknown
+            uint32_t spiBytes;
+            uint16_t spiTransactions;  // Saturated
+            uint16_t spiBusyMs;        // Saturated
+            uint32_t minFreeHeap;      // 0 if never sampled
+            uint32_t minLargestBlock;
+            uint16_t minStackFree;
+            uint16_t batteryMv;        // 0 without a battery monitor
+        } slide;
+        struct {
+            uint32_t elapsedMs;
+            uint32_t chargeUAs;          // Saturated
+            uint32_t onMs[LOAD_COUNT];   // Time per PowerStats::Load
+        } power;
+        uint8_t payload[48];
+    };
+};
+#pragma pack(pop)
+
+static_assert(sizeof(Entry) == 64, "Entries tile sectors and clusters exactly");
+static_assert((PERF_LOG_BATCH_MAX_BYTES & (PERF_LOG_BATCH_MAX_BYTES - 1)) == 0 &&
+              PERF_LOG_BATCH_MAX_BYTES >= 512,
+              "Batches divide clusters evenly, so PERF_LOG_BATCH_MAX_BYTES is a power of two");
+
+static constexpr uint8_t ENTRY_MAGIC = 0xE1;
+static constexpr uint8_t SLIDE_FLAG_ALARM = 0x01;  // Crossed a memory alarm threshold
+static constexpr uint8_t SLIDE_FLAG_SPI = 0x02;    // SPI counters are valid
+
+/**
+ * @brief Unwritten entries and the sequence number, kept through deep sleep
+ */
+struct RtcState {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t count;
+    Entry entries[PERF_LOG_RTC_ENTRIES];
+};
+
+static constexpr uint32_t RTC_MAGIC = 0x474F4C50;  // "PLOG" little-endian
+
+} // namespace
+
+static RTC_DATA_ATTR RtcState s_rtc;
+
+static std::unique_ptr<uint8_t[]> s_buffer;  // PERF_LOG_BATCH_MAX_BYTES
+static size_t s_used = 0;
+static uint32_t s_seq = 0;
+
+static uint16_t saturate16(uint64_t value)
+{
+    return static_cast<uint16_t>(std::min<uint64_t>(value, UINT16_MAX));
+}
+
+static uint32_t saturate32(uint64_t value)
+{
+    return static_cast<uint32_t>(std::min<uint64_t>(value, UINT32_MAX));
+}
+
+static void logPath(char* out, size_t outSize, const char* name)
+{
+    snprintf(out, outSize, "%s/%s", IMAGE_CACHE_DIRECTORY, name);
+}
+
+/**
+ * @brief Claim the next entry in the buffer, header filled in
+ * @return nullptr if the buffer is full (the entry is dropped)
+ */
+static Entry* append(Kind kind, size_t index)
+{
+    uint32_t seq = s_seq++;
+    if (!s_buffer || s_used + sizeof(Entry) > PERF_LOG_BATCH_MAX_BYTES) {
+        return nullptr;
+    }
+    Entry* entry = reinterpret_cast<Entry*>(s_buffer.get() + s_used);
+    s_used += sizeof(Entry);
+    memset(entry, 0, sizeof(Entry));
+    entry->magic = ENTRY_MAGIC;
+    entry->kind = kind;
+    entry->index = index >= UINT16_MAX ? UINT16_MAX : static_cast<uint16_t>(index);
+    entry->seq = seq;
+    time_t now = time(nullptr);
+    entry->unixTime = now > 0 ? static_cast<uint32_t>(now) : 0;
+    entry->uptimeMs = static_cast<uint32_t>(esp_timer_get_time() / 1000);
+    return entry;
+}
+
+/**
+ * @brief Start a new file once the current one is full
+ */
+static void rotate(const char* path)
+{
+    int32_t size = SDCard::getFileSize(path);
+    if (size < 0 || static_cast<uint32_t>(size) < PERF_LOG_MAX_BYTES) {
+        return;
+    }
+    char oldPath[64];
+    logPath(oldPath, sizeof(oldPath), PERF_LOG_OLD_FILE);
+    remove(oldPath);
+    if (rename(path, oldPath) != 0) {
+        ESP_LOGW(TAG_PERF, "Failed to rotate %s", path);
+        remove(path);
+    }
+}
+
+/**
+ * @brief Append the full batches in the buffer to the file
+ * @param pad Pad the last partial batch and write it too
+ */
+static void writeBatches(bool pad)
+{
+    if (!s_buffer || s_used == 0 || !SDCard::isMounted()) {
+        return;
+    }
+    size_t batch = std::min(SDCard::clusterSize(), PERF_LOG_BATCH_MAX_BYTES);
+    if (batch < sizeof(Entry) || (!pad && s_used < batch)) {
+        return;
+    }
+    if (pad && s_used % batch != 0) {
+        size_t padded = (s_used / batch + 1) * batch;
+        memset(s_buffer.get() + s_used, 0, padded - s_used);
+        s_used = padded;
+    }
+    size_t bytes = s_used / batch * batch;
+
+    if (!SDCard::makeDirectory(IMAGE_CACHE_DIRECTORY)) {
+        return;
+    }
+    char path[64];
+    logPath(path, sizeof(path), PERF_LOG_FILE);
+    rotate(path);
+    FILE* file = fopen(path, "ab");
+    if (!file) {
+        ESP_LOGW(TAG_PERF, "Failed to open %s", path);
+        return;
+    }
+    // Whole sectors go to the card without passing through a stdio buffer
+    setvbuf(file, nullptr, _IONBF, 0);
+
+    bool ok = true;
+    {
+        SDCard::BusBurst burst;
+        // A torn write or another card's cluster size leaves the end off a
+        // batch boundary: pad up to the next one
+        int32_t size = SDCard::getFileSize(file);
+        static const uint8_t zeros[sizeof(Entry)] = {};
+        for (size_t gap = size > 0 ? (batch - size % batch) % batch : 0; ok && gap > 0;) {
+            size_t n = std::min(gap, sizeof(zeros));
+            ok = fwrite(zeros, 1, n, file) == n;
+            gap -= n;
+        }
+        ok = ok && fwrite(s_buffer.get(), 1, bytes, file) == bytes;
+    }
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        // Dropped rather than retried: the card may be failing or full
+        ESP_LOGW(TAG_PERF, "Failed to write %zu bytes to %s", bytes, path);
+    }
+    memmove(s_buffer.get(), s_buffer.get() + bytes, s_used - bytes);
+    s_used -= bytes;
+}
+
+bool PerfLog::init()
+{
+    if (!PERF_LOG_ENABLED) {
+        return false;
+    }
+    s_buffer.reset(new (std::nothrow) uint8_t[PERF_LOG_BATCH_MAX_BYTES]);
+    if (!s_buffer) {
+        ESP_LOGE(TAG_PERF, "Failed to allocate %zu byte batch buffer", PERF_LOG_BATCH_MAX_BYTES);
+        return false;
+    }
+    s_used = 0;
+    s_seq = 0;
+    if (s_rtc.magic == RTC_MAGIC) {
+        size_t count = std::min<size_t>(s_rtc.count, PERF_LOG_RTC_ENTRIES);
+        memcpy(s_buffer.get(), s_rtc.entries, count * sizeof(Entry));
+        s_used = count * sizeof(Entry);
+        s_seq = s_rtc.seq;
+    }
+    s_rtc.magic = 0;
+    return true;
+}
+
+void PerfLog::slide(uint32_t statsId, int8_t celsius)
+{
+    SlideStats::RecordView record;
+    if (!s_buffer || !SlideStats::get(statsId, record)) {
+        return;
+    }
+    Entry* entry = append(Kind::SLIDE, record.index);
+    if (!entry) {
+        return;
+    }
+    for (size_t i = 0; i < STAGE_COUNT; i++) {
+        entry->slide.ms[i] = saturate16((record.us[i] + 500) / 1000);
+    }
+    entry->slide.mask = record.mask;
+    entry->slide.flags = (record.alarm ? SLIDE_FLAG_ALARM : 0) | (record.hasSpi ? SLIDE_FLAG_SPI : 0);
+    entry->slide.celsius = celsius;
+    entry->slide.spiBytes = record.spi.bytes;
+    entry->slide.spiTransactions = saturate16(record.spi.transactions);
+    entry->slide.spiBusyMs = saturate16(record.spi.busyUs / 1000);
+    entry->slide.minFreeHeap = record.minFreeHeap;
+    entry->slide.minLargestBlock = record.minLargestBlock;
+    entry->slide.minStackFree = saturate16(record.minStackFree);
+    entry->slide.batteryMv = saturate16(Battery::millivolts());
+}
+
+void PerfLog::power(size_t index, const PowerStats::Usage& usage)
+{
+    if (!s_buffer) {
+        return;
+    }
+    Entry* entry = append(Kind::POWER, index);
+    if (!entry) {
+        return;
+    }
+    entry->power.elapsedMs = saturate32(std::max<int64_t>(usage.elapsedUs, 0) / 1000);
+    entry->power.chargeUAs = saturate32(usage.chargeUAs);
+    for (size_t i = 0; i < LOAD_COUNT; i++) {
+        entry->power.onMs[i] = saturate32(std::max<int64_t>(usage.onUs[i], 0) / 1000);
+    }
+}
+
+void PerfLog::failure(size_t index)
+{
+    if (s_buffer) {
+        append(Kind::FAILURE, index);
+    }
+}
+
+void PerfLog::flush()
+{
+    writeBatches(false);
+}
+
+void PerfLog::sleep()
+{
+    if (!s_buffer) {
+        return;
+    }
+    if (s_used > PERF_LOG_RTC_ENTRIES * sizeof(Entry)) {
+        writeBatches(true);
+    }
+    // Whatever didn't fit or couldn't be written, newest entries kept
+    size_t keep = std::min(s_used, PERF_LOG_RTC_ENTRIES * sizeof(Entry));
+    memcpy(s_rtc.entries, s_buffer.get() + s_used - keep, keep);
+    s_rtc.count = static_cast<uint32_t>(keep / sizeof(Entry));
+    s_rtc.seq = s_seq;
+    s_rtc.magic = RTC_MAGIC;
+}
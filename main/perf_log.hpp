@@ -0,0 +1,63 @@
+/**
+ * @file perf_log.hpp
+ * @brief Binary performance log on the SD card, for units in the field
+ *
+ * Fixed 64-byte entries (slide stage times, power windows, failed images)
+ * are collected in RAM and appended to IMAGE_CACHE_DIRECTORY/PERF_LOG_FILE
+ * a whole batch at a time: a cluster, or PERF_LOG_BATCH_MAX_BYTES of it,
+ * from a batch-aligned offset, so every write goes straight from the buffer
+ * to the card in whole sectors. Batches are only written from flush(),
+ * which the slideshow calls while a panel refresh keeps the display off
+ * the bus, so logging takes no time from decoding or uploads. Decode the
+ * file with tools/perf_log.py. Only for the slideshow task.
+ */
+
+#pragma once
+
+#include "power_stats.hpp"
+#include <cstdint>
+#include <cstddef>
+
+namespace PerfLog {
+
+/**
+ * @brief Allocate the batch buffer and take back the entries kept through
+ *        deep sleep (sleep())
+ * @return true if logging is enabled and the buffer was allocated
+ */
+bool init();
+
+/**
+ * @brief Add a slide's stage times, SPI traffic and memory lows
+ * @param statsId Closed SlideStats record, once its refresh stages are in
+ * @param celsius Panel temperature, EPD_TEMPERATURE_UNKNOWN if not read
+ */
+void slide(uint32_t statsId, int8_t celsius);
+
+/**
+ * @brief Add a closed power window (PowerStats::mark())
+ * @param index Slide the window belongs to, SIZE_MAX for boot
+ * @param usage Usage over the window
+ */
+void power(size_t index, const PowerStats::Usage& usage);
+
+/**
+ * @brief Add an image that failed to load
+ */
+void failure(size_t index);
+
+/**
+ * @brief Write the batches that are full, if any; call while the panel
+ *        refreshes
+ */
+void flush();
+
+/**
+ * @brief Keep the unwritten entries through deep sleep
+ *
+ * Up to PERF_LOG_RTC_ENTRIES stay in RTC memory for init() after the wake;
+ * more are written out now, the last batch padded.
+ */
+void sleep();
+
+} // namespace PerfLog
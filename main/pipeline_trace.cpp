@@ -0,0 +1,225 @@
+/**
+ * @file pipeline_trace.cpp
+ * @brief Pipeline timeline implementation
+ */
+
+#include "pipeline_trace.hpp"
+#include "config.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#if CONFIG_APPTRACE_SV_ENABLE
+#include "SEGGER_SYSVIEW.h"
+#endif
+#include <cinttypes>
+#include <cstring>
+#include <memory>
+#include <new>
+
+static const char* TAG_TRACE = "PipelineTrace";
+
+static constexpr uint8_t SLIDE_MARK = 0xFF;  // Event::stage of slide()
+static constexpr uint8_t INPUT_MARK = 0xFE;  // Event::stage of input()
+static constexpr size_t MAX_TASKS = 8;       // Tasks past this share the last slot
+
+using PipelineTrace::Event;
+
+namespace {
+
+struct Task {
+    TaskHandle_t handle;
+    uint8_t core;  // Last core it traced on
+    char name[16];
+};
+
+} // namespace
+
+// The ring and task table are filled from several tasks and cores; one
+// short critical section per event keeps them consistent
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static std::unique_ptr<Event[]> s_ring;
+static size_t s_head = 0;   // Next slot written
+static size_t s_count = 0;  // Events in the ring
+static bool s_paused = false;
+static Task s_tasks[MAX_TASKS];
+static size_t s_taskCount = 0;
+
+/**
+ * @brief Slot of the calling task, added on first sight; s_lock held
+ */
+static uint8_t taskSlot(TaskHandle_t handle, uint8_t core)
+{
+    size_t i = 0;
+    while (i < s_taskCount && s_tasks[i].handle != handle) {
+        i++;
+    }
+    if (i == s_taskCount) {
+        if (s_taskCount == MAX_TASKS) {
+            i = MAX_TASKS - 1;
+            strncpy(s_tasks[i].name, "other", sizeof(s_tasks[i].name));
+        } else {
+            s_taskCount++;
+            s_tasks[i].handle = handle;
+            strncpy(s_tasks[i].name, pcTaskGetName(handle), sizeof(s_tasks[i].name) - 1);
+            s_tasks[i].name[sizeof(s_tasks[i].name) - 1] = '\0';
+        }
+    }
+    s_tasks[i].core = core;
+    return static_cast<uint8_t>(i);
+}
+
+static void record(char phase, uint8_t stage, int64_t us, uint32_t durUs = 0, uint16_t arg = 0)
+{
+    if (!s_ring) {
+        return;
+    }
+    TaskHandle_t handle = xTaskGetCurrentTaskHandle();
+    uint8_t core = static_cast<uint8_t>(xPortGetCoreID());
+    portENTER_CRITICAL(&s_lock);
+    if (!s_paused) {
+        Event& event = s_ring[s_head];
+        event.us = us;
+        event.durUs = durUs;
+        event.arg = arg;
+        event.stage = stage;
+        event.phase = phase;
+        event.core = core;
+        event.task = taskSlot(handle, core);
+        s_head = (s_head + 1) % PIPELINE_TRACE_EVENTS;
+        if (s_count < PIPELINE_TRACE_EVENTS) {
+            s_count++;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+bool PipelineTrace::init()
+{
+    if (!PIPELINE_TRACE_ENABLED || s_ring) {
+        return static_cast<bool>(s_ring);
+    }
+    s_ring.reset(new (std::nothrow) Event[PIPELINE_TRACE_EVENTS]);
+    if (!s_ring) {
+        ESP_LOGE(TAG_TRACE, "Failed to allocate %zu trace events", PIPELINE_TRACE_EVENTS);
+        return false;
+    }
+#if CONFIG_APPTRACE_SV_ENABLE
+    for (size_t i = 0; i < static_cast<size_t>(SlideStats::Stage::COUNT); i++) {
+        SEGGER_SYSVIEW_NameMarker(i, SlideStats::stageName(static_cast<SlideStats::Stage>(i)));
+    }
+#endif
+    ESP_LOGI(TAG_TRACE, "Tracing the last %zu pipeline events", PIPELINE_TRACE_EVENTS);
+    return true;
+}
+
+void PipelineTrace::begin(SlideStats::Stage stage)
+{
+    record('B', static_cast<uint8_t>(stage), esp_timer_get_time());
+#if CONFIG_APPTRACE_SV_ENABLE
+    if (s_ring) {
+        SEGGER_SYSVIEW_MarkStart(static_cast<unsigned>(stage));
+    }
+#endif
+}
+
+void PipelineTrace::end(SlideStats::Stage stage)
+{
+    record('E', static_cast<uint8_t>(stage), esp_timer_get_time());
+#if CONFIG_APPTRACE_SV_ENABLE
+    if (s_ring) {
+        SEGGER_SYSVIEW_MarkStop(static_cast<unsigned>(stage));
+    }
+#endif
+}
+
+void PipelineTrace::span(SlideStats::Stage stage, int64_t startUs, int64_t endUs)
+{
+    int64_t durUs = endUs > startUs ? endUs - startUs : 0;
+    record('X', static_cast<uint8_t>(stage), startUs,
+           static_cast<uint32_t>(durUs < UINT32_MAX ? durUs : UINT32_MAX));
+}
+
+void PipelineTrace::slide(size_t index)
+{
+    record('i', SLIDE_MARK, esp_timer_get_time(), 0,
+           static_cast<uint16_t>(index < UINT16_MAX ? index : UINT16_MAX));
+}
+
+void PipelineTrace::input(int64_t at)
+{
+    record('i', INPUT_MARK, at);
+}
+
+size_t PipelineTrace::write(FILE* out)
+{
+    if (!s_ring) {
+        fprintf(out, "{\"traceEvents\":[]}\n");
+        return 0;
+    }
+    // Writers skip the ring while it is read, so it can be read unlocked
+    portENTER_CRITICAL(&s_lock);
+    s_paused = true;
+    size_t count = s_count;
+    size_t first = (s_head + PIPELINE_TRACE_EVENTS - count) % PIPELINE_TRACE_EVENTS;
+    size_t taskCount = s_taskCount;
+    portEXIT_CRITICAL(&s_lock);
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"slideshow\"}}");
+    for (size_t i = 0; i < taskCount; i++) {
+        fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,"
+                "\"args\":{\"name\":\"%s (core %u)\"}}",
+                i, s_tasks[i].name, s_tasks[i].core);
+    }
+
+    // The ring may have dropped the start of a stage still open at its
+    // oldest event: its end is left out rather than closing the wrong one
+    uint32_t depth[MAX_TASKS] = {};
+    size_t written = 0;
+    for (size_t n = 0; n < count; n++) {
+        const Event& event = s_ring[(first + n) % PIPELINE_TRACE_EVENTS];
+        if (event.phase == 'E' && depth[event.task] == 0) {
+            continue;
+        }
+        if (event.phase == 'B') {
+            depth[event.task]++;
+        } else if (event.phase == 'E') {
+            depth[event.task]--;
+        }
+        if (event.stage == SLIDE_MARK) {
+            fprintf(out, ",\n{\"name\":\"slide %u\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%" PRId64
+                    ",\"pid\":1,\"tid\":%u,\"args\":{\"core\":%u}}",
+                    event.arg + 1u, event.us, event.task, event.core);
+        } else if (event.stage == INPUT_MARK) {
+            fprintf(out, ",\n{\"name\":\"input\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%" PRId64
+                    ",\"pid\":1,\"tid\":%u,\"args\":{\"core\":%u}}",
+                    event.us, event.task, event.core);
+        } else {
+            fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"stage\",\"ph\":\"%c\",\"ts\":%" PRId64,
+                    SlideStats::stageName(static_cast<SlideStats::Stage>(event.stage)),
+                    event.phase, event.us);
+            if (event.phase == 'X') {
+                fprintf(out, ",\"dur\":%" PRIu32, event.durUs);
+            }
+            fprintf(out, ",\"pid\":1,\"tid\":%u,\"args\":{\"core\":%u,\"stage\":%u}}",
+                    event.task, event.core, event.stage);
+        }
+        written++;
+    }
+    fprintf(out, "\n]}\n");
+
+    portENTER_CRITICAL(&s_lock);
+    s_paused = false;
+    portEXIT_CRITICAL(&s_lock);
+    return written;
+}
+
+void PipelineTrace::clear()
+{
+    portENTER_CRITICAL(&s_lock);
+    s_head = 0;
+    s_count = 0;
+    portEXIT_CRITICAL(&s_lock);
+}
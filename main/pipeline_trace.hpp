@@ -0,0 +1,107 @@
+/**
+ * @file pipeline_trace.hpp
+ * @brief Timeline of pipeline stages across tasks and cores, exported as
+ *        Chrome trace-event JSON
+ *
+ * SlideStats adds up how long each stage took; this keeps when each one ran
+ * and on which task and core, so the overlap between SD reads on the
+ * reader tasks, decoding on the slideshow task and plane writes and
+ * refreshes on epd_refresh can be checked by eye. Events go into a ring of
+ * the last PIPELINE_TRACE_EVENTS; write() prints them for chrome://tracing
+ * or ui.perfetto.dev. With CONFIG_APPTRACE_SV_ENABLE, begin() and end()
+ * also send SystemView start/stop markers named after the stage. Safe from
+ * any task; a no-op until init() with PIPELINE_TRACE_ENABLED.
+ */
+
+#pragma once
+
+#include "slide_stats.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+
+namespace PipelineTrace {
+
+/**
+ * @brief One entry of the ring; here so RamBudget can size the ring
+ */
+struct Event {
+    int64_t us;      // esp_timer time; the start of a span
+    uint32_t durUs;  // Spans only
+    uint16_t arg;    // Slide index of a slide mark
+    uint8_t stage;   // SlideStats::Stage, SLIDE_MARK or INPUT_MARK
+    char phase;      // 'B', 'E', 'X' (span) or 'i' (mark)
+    uint8_t core;
+    uint8_t task;    // Slot in the traced-task table
+};
+
+/**
+ * @brief Allocate the ring; call once, before the tasks that trace start
+ * @return true if tracing is enabled and the ring was allocated
+ */
+bool init();
+
+/**
+ * @brief A stage starts on the calling task
+ */
+void begin(SlideStats::Stage stage);
+
+/**
+ * @brief The stage begin() started on the calling task ends
+ */
+void end(SlideStats::Stage stage);
+
+/**
+ * @brief A stage that has already run on the calling task, e.g. one the
+ *        panel driver reports once it ends
+ * @param stage Stage
+ * @param startUs esp_timer time it started
+ * @param endUs esp_timer time it ended
+ */
+void span(SlideStats::Stage stage, int64_t startUs, int64_t endUs);
+
+/**
+ * @brief Mark the start of a slide on the timeline
+ * @param index Slide index
+ */
+void slide(size_t index);
+
+/**
+ * @brief Mark a button press or command on the timeline, where it happened
+ * @param at esp_timer time of the input (SlideshowButtonEvent::stamp)
+ */
+void input(int64_t at);
+
+/**
+ * @brief Traces a stage on the calling task for as long as it is in scope
+ */
+class Scope {
+public:
+    explicit Scope(SlideStats::Stage stage) : stage_(stage) { begin(stage); }
+    ~Scope() { end(stage_); }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    SlideStats::Stage stage_;
+};
+
+/**
+ * @brief Write the ring as Chrome trace-event JSON, oldest event first
+ *
+ * One thread per task, named with the task and the core it last ran a
+ * stage on; every event carries its core and stage id in args. Events that
+ * arrive while this runs are dropped.
+ *
+ * @param out Open stream, e.g. stdout or a file on the card
+ * @return Number of events written
+ */
+size_t write(FILE* out);
+
+/**
+ * @brief Drop every event in the ring
+ */
+void clear();
+
+} // namespace PipelineTrace
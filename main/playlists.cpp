@@ -0,0 +1,340 @@
+/**
+ * @file playlists.cpp
+ * @brief Favorites and playlists implementation
+ */
+
+#include "playlists.hpp"
+#include "config.hpp"
+#include "shuffle.hpp"
+#include "esp_log.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+static const char* TAG_PLAY = "Playlists";
+
+// NVS key of the name of the list being played
+static constexpr const char* PLAYING_KEY = "_play";
+
+/**
+ * @brief Blob header, followed by (count + 31) / 32 words of bits
+ */
+struct ListHeader {
+    uint32_t listChecksum;  // Image list the bits belong to
+    uint32_t count;         // Images covered
+};
+
+/**
+ * @brief One bit per image index
+ */
+class IndexSet {
+public:
+    void reset(size_t count)
+    {
+        count_ = count;
+        members_ = 0;
+        words_.assign((count + 31) / 32, 0);
+    }
+
+    size_t count() const { return count_; }
+    size_t members() const { return members_; }
+    bool test(size_t i) const { return i < count_ && (words_[i / 32] >> (i % 32) & 1); }
+
+    void set(size_t i, bool on)
+    {
+        if (i >= count_ || test(i) == on) {
+            return;
+        }
+        words_[i / 32] ^= 1u << (i % 32);
+        if (on) {
+            members_++;
+        } else {
+            members_--;
+        }
+    }
+
+    /**
+     * @brief First member after i, wrapping round; i itself comes last
+     */
+    size_t next(size_t i) const
+    {
+        size_t words = words_.size();
+        size_t from = (i + 1) % count_;
+        for (size_t n = 0; n <= words; n++) {
+            size_t w = (from / 32 + n) % words;
+            uint32_t bits = words_[w];
+            if (n == 0) {
+                bits &= ~0u << (from % 32);
+            } else if (n == words) {
+                bits &= (1u << (from % 32)) - 1;  // Back round to before from
+            }
+            if (bits) {
+                return w * 32 + __builtin_ctz(bits);
+            }
+        }
+        return i;
+    }
+
+    /**
+     * @brief Last member before i, wrapping round; i itself comes last
+     */
+    size_t previous(size_t i) const
+    {
+        size_t words = words_.size();
+        size_t from = (i + count_ - 1) % count_;
+        for (size_t n = 0; n <= words; n++) {
+            size_t w = (from / 32 + words - n) % words;
+            uint32_t bits = words_[w];
+            uint32_t upTo = from % 32 == 31 ? ~0u : (1u << (from % 32 + 1)) - 1;
+            if (n == 0) {
+                bits &= upTo;
+            } else if (n == words) {
+                bits &= ~upTo;  // Back round to after from
+            }
+            if (bits) {
+                return w * 32 + 31 - __builtin_clz(bits);
+            }
+        }
+        return i;
+    }
+
+    /**
+     * @brief Read a list recorded for this image list
+     * @return false if it is missing or was recorded for other content
+     */
+    bool read(nvs_handle_t handle, const char* name, uint32_t listChecksum)
+    {
+        size_t bytes = sizeof(ListHeader) + words_.size() * sizeof(uint32_t);
+        std::vector<uint8_t> blob(bytes);
+        size_t length = bytes;
+        ListHeader header;
+        if (nvs_get_blob(handle, name, blob.data(), &length) != ESP_OK || length != bytes) {
+            return false;
+        }
+        memcpy(&header, blob.data(), sizeof(header));
+        if (header.listChecksum != listChecksum || header.count != count_) {
+            return false;
+        }
+        memcpy(words_.data(), blob.data() + sizeof(header), words_.size() * sizeof(uint32_t));
+        members_ = 0;
+        for (uint32_t word : words_) {
+            members_ += __builtin_popcount(word);
+        }
+        return true;
+    }
+
+    bool write(nvs_handle_t handle, const char* name, uint32_t listChecksum) const
+    {
+        ListHeader header = { listChecksum, static_cast<uint32_t>(count_) };
+        std::vector<uint8_t> blob(sizeof(header) + words_.size() * sizeof(uint32_t));
+        memcpy(blob.data(), &header, sizeof(header));
+        memcpy(blob.data() + sizeof(header), words_.data(), words_.size() * sizeof(uint32_t));
+        return nvs_set_blob(handle, name, blob.data(), blob.size()) == ESP_OK &&
+               nvs_commit(handle) == ESP_OK;
+    }
+
+private:
+    std::vector<uint32_t> words_;
+    size_t count_ = 0;
+    size_t members_ = 0;
+};
+
+static SemaphoreHandle_t s_lock = nullptr;
+static bool s_loaded = false;
+static uint32_t s_listChecksum = 0;
+static IndexSet s_favorites;
+static IndexSet s_playing;  // Members of the list being played
+static char s_playName[Playlists::MAX_NAME + 1] = "";
+
+/**
+ * @brief Holds s_lock for as long as it is in scope
+ */
+class Lock {
+public:
+    Lock()
+    {
+        if (!s_lock) {
+            // Created before the console task, on the slideshow's first call
+            s_lock = xSemaphoreCreateMutex();
+        }
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+    }
+    ~Lock() { xSemaphoreGive(s_lock); }
+};
+
+static bool validName(const char* name)
+{
+    size_t len = name ? strlen(name) : 0;
+    return len > 0 && len <= Playlists::MAX_NAME && name[0] != '_';
+}
+
+/**
+ * @brief Read a list into a set sized for the loaded image list
+ */
+static bool readList(const char* name, IndexSet& out)
+{
+    out.reset(s_favorites.count());
+    nvs_handle_t handle;
+    if (nvs_open(PLAYLIST_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return false;
+    }
+    bool ok = out.read(handle, name, s_listChecksum);
+    nvs_close(handle);
+    if (!ok) {
+        out.reset(s_favorites.count());
+    }
+    return ok;
+}
+
+static bool writeList(const char* name, const IndexSet& set)
+{
+    nvs_handle_t handle;
+    if (nvs_open(PLAYLIST_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        return false;
+    }
+    bool ok = set.write(handle, name, s_listChecksum);
+    nvs_close(handle);
+    if (!ok) {
+        ESP_LOGW(TAG_PLAY, "Failed to store list %s", name);
+    }
+    return ok;
+}
+
+void Playlists::load(uint32_t listChecksum, size_t count)
+{
+    Lock lock;
+    count = std::min(count, MAX_IMAGE_FILES);
+    if (s_loaded && s_listChecksum == listChecksum && s_favorites.count() == count) {
+        return;
+    }
+    s_loaded = true;
+    s_listChecksum = listChecksum;
+    s_favorites.reset(count);
+    s_playing.reset(count);
+    s_playName[0] = '\0';
+    if (count == 0) {
+        return;
+    }
+    readList(FAVORITES, s_favorites);
+
+    nvs_handle_t handle;
+    size_t length = sizeof(s_playName);
+    if (nvs_open(PLAYLIST_NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        if (nvs_get_str(handle, PLAYING_KEY, s_playName, &length) != ESP_OK) {
+            s_playName[0] = '\0';
+        }
+        nvs_close(handle);
+    }
+    if (s_playName[0] && (!readList(s_playName, s_playing) || s_playing.members() == 0)) {
+        ESP_LOGW(TAG_PLAY, "List %s is empty for these images, playing all", s_playName);
+        s_playName[0] = '\0';
+    }
+    ESP_LOGI(TAG_PLAY, "%zu favorites, playing %s", s_favorites.members(),
+             s_playName[0] ? s_playName : "all");
+}
+
+bool Playlists::isFavorite(size_t index)
+{
+    Lock lock;
+    return s_favorites.test(index);
+}
+
+bool Playlists::toggleFavorite(size_t index)
+{
+    bool member;
+    {
+        Lock lock;
+        member = !s_favorites.test(index);
+    }
+    set(FAVORITES, index, member);
+    return isFavorite(index);
+}
+
+bool Playlists::set(const char* name, size_t index, bool member)
+{
+    Lock lock;
+    if (!validName(name) || index >= s_favorites.count()) {
+        return false;
+    }
+    bool favorites = strcmp(name, FAVORITES) == 0;
+    bool played = strcmp(name, s_playName) == 0;
+    IndexSet loaded;
+    IndexSet& list = favorites ? s_favorites : played ? s_playing : loaded;
+    if (&list == &loaded) {
+        readList(name, loaded);
+    }
+    list.set(index, member);
+    if (played && favorites) {
+        s_playing.set(index, member);
+    }
+    ESP_LOGI(TAG_PLAY, "Image %zu %s %s (%zu)", index + 1, member ? "added to" : "removed from",
+             name, list.members());
+    return writeList(name, list);
+}
+
+size_t Playlists::size(const char* name)
+{
+    Lock lock;
+    if (!validName(name)) {
+        return 0;
+    }
+    IndexSet list;
+    readList(name, list);
+    return list.members();
+}
+
+bool Playlists::play(const char* name)
+{
+    Lock lock;
+    if (name && name[0] && (!validName(name) || !readList(name, s_playing) ||
+                            s_playing.members() == 0)) {
+        s_playing.reset(s_favorites.count());
+        s_playName[0] = '\0';
+        return false;
+    }
+    strlcpy(s_playName, name ? name : "", sizeof(s_playName));
+    nvs_handle_t handle;
+    if (nvs_open(PLAYLIST_NVS_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK) {
+        if (nvs_set_str(handle, PLAYING_KEY, s_playName) != ESP_OK || nvs_commit(handle) != ESP_OK) {
+            ESP_LOGW(TAG_PLAY, "Failed to store the playing list");
+        }
+        nvs_close(handle);
+    }
+    ESP_LOGI(TAG_PLAY, "Playing %s", s_playName[0] ? s_playName : "all");
+    return true;
+}
+
+const char* Playlists::playing()
+{
+    return s_playName;
+}
+
+size_t Playlists::step(size_t index, long steps, size_t count)
+{
+    Lock lock;
+    if (!s_playName[0] || s_playing.members() == 0 || count != s_playing.count() ||
+        index >= count || steps == 0) {
+        return Shuffle::step(index, steps, count);
+    }
+    size_t moves = static_cast<size_t>(steps < 0 ? -steps : steps);
+    moves = (moves - 1) % s_playing.members() + 1;
+
+    if (!Shuffle::enabled()) {
+        for (size_t i = 0; i < moves; i++) {
+            index = steps > 0 ? s_playing.next(index) : s_playing.previous(index);
+        }
+        return index;
+    }
+    // Shuffled: walk play positions to the next member, count / members
+    // positions a move on average
+    size_t position = Shuffle::positionOf(index, count);
+    for (size_t i = 0; i < moves; i++) {
+        do {
+            position = (position + (steps > 0 ? 1 : count - 1)) % count;
+        } while (!s_playing.test(Shuffle::at(position, count)));
+    }
+    return Shuffle::at(position, count);
+}
@@ -0,0 +1,78 @@
+/**
+ * @file playlists.hpp
+ * @brief Favorites and named playlists as bitsets over the image indices
+ *
+ * Each list is one bit per index, stored in NVS (PLAYLIST_NVS_NAMESPACE,
+ * the list name as key) with the checksum of the image list it was made
+ * for. A list recorded for other content reads as empty: its indices mean
+ * other images now. Favorites are the list FAVORITES, toggled with a long
+ * SELECT press. Playback can be limited to one list (play()); stepping
+ * then scans for the next set bit a 32-bit word at a time, so it stays
+ * cheap at thousands of images. The console edits lists from its own
+ * task, so every call takes a lock.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Playlists {
+
+static constexpr const char* FAVORITES = "fav";
+
+/**
+ * @brief Longest list name (an NVS key)
+ */
+static constexpr size_t MAX_NAME = 15;
+
+/**
+ * @brief Load favorites and the playing list for an image list; does
+ *        nothing if they are loaded for it already
+ * @param listChecksum Checksum of the image list the indices refer to
+ * @param count Number of images in it
+ */
+void load(uint32_t listChecksum, size_t count);
+
+/**
+ * @brief Whether a slide is a favorite
+ */
+bool isFavorite(size_t index);
+
+/**
+ * @brief Add a slide to the favorites, or take it out
+ * @return Whether it is a favorite now
+ */
+bool toggleFavorite(size_t index);
+
+/**
+ * @brief Put a slide in a list or take it out, creating the list as needed
+ * @return false for a bad name or index, or if NVS fails
+ */
+bool set(const char* name, size_t index, bool member);
+
+/**
+ * @brief Slides in a list, 0 if it doesn't exist
+ */
+size_t size(const char* name);
+
+/**
+ * @brief Play only the slides of a list, kept across reboots
+ * @param name List name, nullptr or "" for every slide
+ * @return false if the list doesn't exist or is empty
+ */
+bool play(const char* name);
+
+/**
+ * @brief Name of the list being played, "" for every slide
+ */
+const char* playing();
+
+/**
+ * @brief The slide steps places from a slide in play order: within the
+ *        playing list if there is one, shuffled when Shuffle is on
+ * @param index Slide index, < count (need not be in the list)
+ */
+size_t step(size_t index, long steps, size_t count);
+
+} // namespace Playlists
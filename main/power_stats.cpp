@@ -0,0 +1,191 @@
+/**
+ * @file power_stats.cpp
+ * @brief Power-state timeline and estimated charge per slide implementation
+ */
+
+#include "power_stats.hpp"
+#include "config.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <cinttypes>
+#include <cstdio>
+#include <algorithm>
+#include <iterator>
+
+static const char* TAG_POWER = "PowerStats";
+
+static constexpr size_t LOAD_COUNT = static_cast<size_t>(PowerStats::Load::COUNT);
+
+// Current per load, in Load order
+static constexpr uint32_t LOAD_UA[LOAD_COUNT] = {
+    POWER_CPU_UA, POWER_SPI_UA, POWER_SD_UA, POWER_PANEL_UA, POWER_REFRESH_UA, POWER_RADIO_UA,
+};
+
+// s_lock guards everything below; loads switch from the refresh task too
+static int64_t s_onUs[LOAD_COUNT];      // Closed on-time per load
+static int64_t s_onSince[LOAD_COUNT];   // When a load switched on, -1 if off
+static int64_t s_startUs = 0;           // init()
+static PowerStats::Usage s_windowStart; // total() when the window began
+static PowerStats::Usage s_last;        // Last closed window
+static PowerStats::Event s_events[POWER_TIMELINE_LENGTH];
+static size_t s_eventCount = 0;         // Events ever recorded
+static SemaphoreHandle_t s_lock = nullptr;
+
+static void lock()
+{
+    if (s_lock) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+    }
+}
+
+static void unlock()
+{
+    if (s_lock) {
+        xSemaphoreGive(s_lock);
+    }
+}
+
+static uint64_t charge(const PowerStats::Usage& usage)
+{
+    uint64_t uAus = static_cast<uint64_t>(std::max<int64_t>(usage.elapsedUs, 0)) * POWER_IDLE_UA;
+    for (size_t i = 0; i < LOAD_COUNT; i++) {
+        uAus += static_cast<uint64_t>(std::max<int64_t>(usage.onUs[i], 0)) * LOAD_UA[i];
+    }
+    return uAus / 1000000;
+}
+
+/**
+ * @brief Usage since init() up to now, loads still on included; call locked
+ */
+static PowerStats::Usage totalLocked()
+{
+    int64_t now = esp_timer_get_time();
+    PowerStats::Usage usage = {};
+    usage.elapsedUs = now - s_startUs;
+    for (size_t i = 0; i < LOAD_COUNT; i++) {
+        usage.onUs[i] = s_onUs[i] + (s_onSince[i] >= 0 ? now - s_onSince[i] : 0);
+    }
+    usage.chargeUAs = charge(usage);
+    return usage;
+}
+
+bool PowerStats::init()
+{
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+        std::fill(std::begin(s_onSince), std::end(s_onSince), -1);
+        s_startUs = esp_timer_get_time();
+        s_windowStart = {};
+        set(Load::CPU, true);
+    }
+    return s_lock != nullptr;
+}
+
+const char* PowerStats::loadName(Load load)
+{
+    static const char* const names[LOAD_COUNT] = {
+        "cpu", "spi", "sd", "panel", "refresh", "radio",
+    };
+    size_t i = static_cast<size_t>(load);
+    return i < LOAD_COUNT ? names[i] : "?";
+}
+
+void PowerStats::set(Load load, bool on)
+{
+    size_t i = static_cast<size_t>(load);
+    if (i >= LOAD_COUNT || !s_lock) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    lock();
+    bool wasOn = s_onSince[i] >= 0;
+    if (on != wasOn) {
+        if (on) {
+            s_onSince[i] = now;
+        } else {
+            s_onUs[i] += now - s_onSince[i];
+            s_onSince[i] = -1;
+        }
+        s_events[s_eventCount % POWER_TIMELINE_LENGTH] = {now, load, on};
+        s_eventCount++;
+    }
+    unlock();
+}
+
+void PowerStats::add(Load load, int64_t us)
+{
+    size_t i = static_cast<size_t>(load);
+    if (i >= LOAD_COUNT || us <= 0 || !s_lock) {
+        return;
+    }
+    lock();
+    s_onUs[i] += us;
+    unlock();
+}
+
+size_t PowerStats::timeline(Event* out, size_t max)
+{
+    lock();
+    size_t count = std::min({s_eventCount, POWER_TIMELINE_LENGTH, max});
+    size_t first = s_eventCount - count;
+    for (size_t i = 0; i < count; i++) {
+        out[i] = s_events[(first + i) % POWER_TIMELINE_LENGTH];
+    }
+    unlock();
+    return count;
+}
+
+void PowerStats::mark(Usage& out)
+{
+    lock();
+    Usage now = totalLocked();
+    out = {};
+    out.elapsedUs = now.elapsedUs - s_windowStart.elapsedUs;
+    for (size_t i = 0; i < LOAD_COUNT; i++) {
+        out.onUs[i] = now.onUs[i] - s_windowStart.onUs[i];
+    }
+    out.chargeUAs = charge(out);
+    s_windowStart = now;
+    s_last = out;
+    unlock();
+}
+
+void PowerStats::lastWindow(Usage& out)
+{
+    lock();
+    out = s_last;
+    unlock();
+}
+
+void PowerStats::total(Usage& out)
+{
+    lock();
+    out = totalLocked();
+    unlock();
+}
+
+void PowerStats::addDeepSleep(Usage& usage, uint64_t sleepUs)
+{
+    usage.elapsedUs += static_cast<int64_t>(sleepUs);
+    usage.chargeUAs += sleepUs * POWER_DEEP_SLEEP_UA / 1000000;
+}
+
+void PowerStats::log(const char* label, const Usage& usage)
+{
+    char line[128] = "idle";
+    size_t len = 0;
+    for (size_t i = 0; i < LOAD_COUNT && len < sizeof(line); i++) {
+        if (usage.onUs[i] <= 0) {
+            continue;
+        }
+        int n = snprintf(line + len, sizeof(line) - len, "%s%s %" PRId64, len ? " " : "",
+                         loadName(static_cast<Load>(i)), usage.onUs[i] / 1000);
+        len += n > 0 ? static_cast<size_t>(n) : 0;
+    }
+    // uAh with one decimal
+    uint64_t deciUAh = usage.chargeUAs / 360;
+    ESP_LOGI(TAG_POWER, "%s: ~%" PRIu64 ".%" PRIu64 " uAh in %" PRId64 " ms (%s%s)", label,
+             deciUAh / 10, deciUAh % 10, usage.elapsedUs / 1000, line, len ? " ms" : "");
+}
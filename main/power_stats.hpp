@@ -0,0 +1,115 @@
+/**
+ * @file power_stats.hpp
+ * @brief Power-state timeline and estimated charge per slide
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace PowerStats {
+
+/**
+ * @brief Loads that draw current on top of the idle baseline
+ *
+ * Each one is switched on and off on its own; the charge estimate adds
+ * its POWER_*_UA current (config.hpp) for the time it was on.
+ */
+enum class Load : uint8_t {
+    CPU,      // Slideshow task running rather than blocked
+    SPI,      // SPI transfers; timed by the bus counters, no timeline events
+    SD,       // SD card mounted
+    PANEL,    // Panel charge pumps on (IL0373_POWER_ON to POWER_OFF)
+    REFRESH,  // Panel refresh running, on top of PANEL
+    RADIO,    // Wi-Fi on for a sync (WifiSync)
+    COUNT
+};
+
+/**
+ * @brief Create the lock and start the clock with the CPU on; nothing is
+ *        recorded before this
+ * @return true if successful
+ */
+bool init();
+
+/**
+ * @brief Short load name for logs
+ */
+const char* loadName(Load load);
+
+/**
+ * @brief Switch a load on or off; safe from any task
+ *
+ * Repeating the current state changes nothing and adds no event.
+ */
+void set(Load load, bool on);
+
+/**
+ * @brief Add on-time measured elsewhere (SPI)
+ * @param load Load
+ * @param us Time it was on, in microseconds
+ */
+void add(Load load, int64_t us);
+
+/**
+ * @brief One power state change
+ */
+struct Event {
+    int64_t us;  // esp_timer time
+    Load load;
+    bool on;
+};
+
+/**
+ * @brief Copy the most recent state changes, oldest first
+ * @param out Receives up to max events
+ * @param max Capacity of out
+ * @return Number of events copied (at most POWER_TIMELINE_LENGTH)
+ */
+size_t timeline(Event* out, size_t max);
+
+/**
+ * @brief Time per load and estimated charge over a stretch of time
+ */
+struct Usage {
+    int64_t elapsedUs;
+    int64_t onUs[static_cast<size_t>(Load::COUNT)];
+    uint64_t chargeUAs;  // Microamp-seconds (3600 per uAh), idle baseline included
+};
+
+/**
+ * @brief End the current accounting window and start the next
+ *
+ * The slideshow marks each slide as it begins, so a window is one slide:
+ * decode, upload, refresh and the dwell until the next one.
+ *
+ * @param out Usage over the window that just ended
+ */
+void mark(Usage& out);
+
+/**
+ * @brief Usage of the last window closed by mark()
+ */
+void lastWindow(Usage& out);
+
+/**
+ * @brief Usage since init()
+ */
+void total(Usage& out);
+
+/**
+ * @brief Add time in deep sleep, charged at POWER_DEEP_SLEEP_UA
+ * @param usage Usage to extend
+ * @param sleepUs Sleep time, in microseconds
+ */
+void addDeepSleep(Usage& usage, uint64_t sleepUs);
+
+/**
+ * @brief Log usage on a single line: charge, time, then time per load
+ * @param label Line prefix, e.g. "Slide 3"
+ * @param usage Usage to log
+ */
+void log(const char* label, const Usage& usage);
+
+} // namespace PowerStats
@@ -0,0 +1,82 @@
+/**
+ * @file prefetch_plan.cpp
+ * @brief Prefetch planner implementation
+ */
+
+#include "prefetch_plan.hpp"
+#include "config.hpp"
+#include "tunables.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <algorithm>
+
+static const char* TAG_PLAN = "PrefetchPlan";
+
+static int s_direction = 1;       // Of the last step
+static uint32_t s_streak = 0;     // Steps in a row that way
+static int64_t s_lastStepUs = 0;  // 0 before the first step
+static uint32_t s_stepUs = 0;     // Average time between steps, 0 unknown
+static uint32_t s_loadUs = 0;     // Average read + decode time, 0 unknown
+
+/**
+ * @brief Exponential moving average weighted 1/4 to the new sample
+ */
+static uint32_t average(uint32_t current, uint32_t sample)
+{
+    return current == 0 ? sample : current - current / 4 + sample / 4;
+}
+
+void PrefetchPlan::step(long steps)
+{
+    if (steps == 0) {
+        return;
+    }
+    int direction = steps > 0 ? 1 : -1;
+    if (direction != s_direction) {
+        // The slides decoded the other way are stale; the next plan drops them
+        ESP_LOGD(TAG_PLAN, "Direction %+d after %u steps", direction, static_cast<unsigned>(s_streak));
+        s_direction = direction;
+        s_streak = 0;
+    }
+    s_streak++;
+
+    int64_t now = esp_timer_get_time();
+    if (s_lastStepUs != 0) {
+        // A coalesced jump took as long as one step per slide
+        uint64_t each = static_cast<uint64_t>(now - s_lastStepUs) /
+                        static_cast<uint64_t>(steps > 0 ? steps : -steps);
+        s_stepUs = average(s_stepUs, static_cast<uint32_t>(std::min<uint64_t>(each, UINT32_MAX)));
+    }
+    s_lastStepUs = now;
+}
+
+void PrefetchPlan::loaded(uint32_t us)
+{
+    s_loadUs = average(s_loadUs, us);
+}
+
+size_t PrefetchPlan::plan(long* offsets, size_t max)
+{
+    if (max == 0) {
+        return 0;
+    }
+    if (s_streak < PREFETCH_STREAK) {
+        offsets[0] = s_direction;
+        if (max < 2) {
+            return 1;
+        }
+        offsets[1] = -s_direction;
+        return 2;
+    }
+
+    // Deep enough to cover the loads that fall into one step, plus one
+    size_t depth = 1;
+    if (s_stepUs != 0 && s_loadUs != 0) {
+        depth += s_loadUs / s_stepUs;
+    }
+    depth = std::min<size_t>({depth, Tunables::get(Tunables::Id::PREFETCH_DEPTH), max});
+    for (size_t i = 0; i < depth; i++) {
+        offsets[i] = s_direction * static_cast<long>(i + 1);
+    }
+    return depth;
+}
@@ -0,0 +1,43 @@
+/**
+ * @file prefetch_plan.hpp
+ * @brief Which neighbours to decode ahead, from how the slides are being
+ *        browsed
+ *
+ * A plain +/-1 prefetch decodes the previous slide for nothing when the
+ * user only moves forward, and is one slide deep when they flip faster
+ * than a slide loads. The planner keeps the direction of the last steps,
+ * the time between them and the time a prefetched slide took to read and
+ * decode (SD and decoder together). After PREFETCH_STREAK steps the same
+ * way only that way is planned, PREFETCH_MAX_DEPTH deep at most, deeper
+ * the more loads fit in one step; otherwise it is one slide each way,
+ * the direction of the last step first. Only for the slideshow task.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace PrefetchPlan {
+
+/**
+ * @brief Record a step through the slides: UP/DOWN (coalesced presses
+ *        count once) or an auto-advance (+1)
+ * @param steps Play-order steps, negative for back
+ */
+void step(long steps);
+
+/**
+ * @brief Record how long a prefetched slide took to read and decode
+ */
+void loaded(uint32_t us);
+
+/**
+ * @brief Play-order offsets from the current slide to prefetch, most
+ *        wanted first
+ * @param offsets Receives at most max offsets
+ * @return Number of offsets
+ */
+size_t plan(long* offsets, size_t max);
+
+} // namespace PrefetchPlan
@@ -0,0 +1,44 @@
+/**
+ * @file ram_budget.cpp
+ * @brief Build-time check of the RAM model, and its boot log line
+ */
+
+#include "ram_budget.hpp"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+static const char* TAG_RAM = "RamBudget";
+
+namespace {
+
+/**
+ * @brief Fails to instantiate when Needed > Budget; the compiler's note
+ *        names both, in bytes
+ */
+template <size_t Needed, size_t Budget>
+struct Fits {
+    static_assert(Needed <= Budget,
+                  "Over RAM_BUDGET_BYTES even with banded rendering: lower SLIDE_ARENA_SIZE, "
+                  "SLIDE_CACHE_BUDGET or BANDED_RENDER_BYTES, or turn features off");
+    static constexpr bool value = true;
+};
+
+} // namespace
+
+static_assert(RAM_BUDGET_RADIO_BYTES < RAM_BUDGET_BYTES,
+              "RAM_BUDGET_RADIO_BYTES leaves nothing of RAM_BUDGET_BYTES");
+static_assert(Fits<RamBudget::BUILD.total(), RamBudget::budget()>::value);
+
+void RamBudget::log()
+{
+    const Model& m = BUILD;
+    ESP_LOGI(TAG_RAM, "%s %zu, prefetch %zu, cache warm %zu, slide cache %zu, arena %zu, "
+             "stacks %zu, features %zu bytes", m.banded ? "Bands" : "Frame", m.frame, m.prefetch,
+             m.cacheWarm, m.slideCache, m.arena, m.stacks, m.features);
+    ESP_LOGI(TAG_RAM, "Modelled %zu of %zu bytes budgeted, %zu free now", m.total(), budget(),
+             heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    if (m.banded) {
+        ESP_LOGW(TAG_RAM, "The %dx%d frame doesn't fit the budget: %zu-byte bands, no prefetch",
+                 SLIDESHOW_PANEL.width, SLIDESHOW_PANEL.height, BANDED_RENDER_BYTES);
+    }
+}
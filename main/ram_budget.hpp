@@ -0,0 +1,149 @@
+/**
+ * @file ram_budget.hpp
+ * @brief Compile-time model of the internal RAM the slideshow takes, from
+ *        the panel's geometry and the config.hpp defaults
+ *
+ * Counts what is allocated at boot and kept, or kept for as long as a slide
+ * is shown: frame planes, prefetch and cache-warm planes, the slide cache
+ * and arena, task stacks and the buffers of the features that are on. What
+ * ESP-IDF itself and the radios take is left out of the model; it is what
+ * RAM_BUDGET_BYTES and RAM_BUDGET_RADIO_BYTES hold back.
+ *
+ * A frame that doesn't fit beside the rest is modelled as the slideshow
+ * falls back at runtime: banded rendering and no prefetch. ram_budget.cpp
+ * fails the build when even that is over budget.
+ */
+
+#pragma once
+
+#include "config.hpp"
+#include "panel.hpp"
+#include "pipeline_trace.hpp"
+#include <cstddef>
+
+namespace RamBudget {
+
+// Adafruit_IL0373 keeps a black and a color plane in every mode
+static constexpr size_t PLANES = 2;
+
+/**
+ * @brief Bytes of one frame plane of a panel
+ */
+constexpr size_t planeBytes(const epd_panel_t& panel)
+{
+    return (static_cast<size_t>(panel.width) * static_cast<size_t>(panel.height) + 7) / 8;
+}
+
+/**
+ * @brief The internal RAM of one build, item by item
+ */
+struct Model {
+    size_t frame;       // Display planes, or its two bands when banded
+    size_t prefetch;    // Two prefetch slots of PLANES planes
+    size_t cacheWarm;   // CacheWarm's planes while a walk is under way
+    size_t slideCache;  // SLIDE_CACHE_BUDGET (the tunable's default)
+    size_t arena;       // SLIDE_ARENA_SIZE
+    size_t stacks;      // Task stacks
+    size_t features;    // Rings and buffers of the optional features
+    bool banded;        // The frame didn't fit, so it is drawn in bands
+
+    constexpr size_t total() const
+    {
+        return frame + prefetch + cacheWarm + slideCache + arena + stacks + features;
+    }
+};
+
+/**
+ * @brief The internal heap the model may take: RAM_BUDGET_BYTES, less the
+ *        radio's share when a Wi-Fi or BLE feature is on
+ */
+constexpr size_t budget()
+{
+    bool radio = WIFI_SYNC_ENABLED || FRAME_PUSH_ENABLED || FRAME_CAST_ENABLED ||
+                 TELEMETRY_ENABLED || BLE_UPLOAD_ENABLED || SCHEDULE_ENABLED;
+    return RAM_BUDGET_BYTES - (radio ? RAM_BUDGET_RADIO_BYTES : 0);
+}
+
+/**
+ * @brief Task stacks: the slideshow, the SD task (boot, then card scans),
+ *        and the pipeline's and console's when they run
+ */
+constexpr size_t stackBytes()
+{
+    size_t bytes = SLIDESHOW_TASK_STACK + BOOT_SD_TASK_STACK + RENDER_FLOW_READ_TASK_STACK;
+    if (PIPELINE_ENABLED) {
+        bytes += READ_AHEAD_TASK_STACK;
+    }
+    if (PIPELINE_ENABLED && DITHER_PARALLEL_ENABLED) {
+        bytes += DITHER_POOL_TASK_STACK;
+    }
+    if (CONSOLE_ENABLED) {
+        bytes += CONSOLE_TASK_STACK;
+    }
+    return bytes;
+}
+
+/**
+ * @brief Buffers the optional features allocate at boot or hold while on
+ */
+constexpr size_t featureBytes()
+{
+    size_t bytes = RENDER_FLOW_FRAME_SLOTS * RENDER_FLOW_FRAME_BYTES;
+    if (IMAGE_PACK_DIRECT_READS) {
+        bytes += IMAGE_PACK_DIRECT_WINDOW;
+    }
+    if (PERF_LOG_ENABLED) {
+        bytes += PERF_LOG_BATCH_MAX_BYTES;
+    }
+    if (PIPELINE_TRACE_ENABLED) {
+        bytes += PIPELINE_TRACE_EVENTS * sizeof(PipelineTrace::Event);
+    }
+    if (SPI_RECORD_ENABLED) {
+        bytes += SPI_RECORD_BYTES;
+    }
+    if (TELEMETRY_ENABLED) {
+        bytes += TELEMETRY_MESSAGE_SIZE;
+    }
+    if (FRAME_CAST_ENABLED) {
+        bytes += FRAME_CAST_FRAME_SIZE;
+    }
+    return bytes;
+}
+
+/**
+ * @brief The model of a build driving a panel, with frame planes if they fit
+ */
+constexpr Model model(const epd_panel_t& panel)
+{
+    // In PSRAM the planes cost no internal RAM
+    size_t frame = FRAMEBUFFER_IN_PSRAM ? 0 : PLANES * planeBytes(panel);
+    Model full = {
+        frame,
+        PREFETCH_ENABLED ? 2 * frame : 0,
+        CACHE_WARM_ENABLED ? PLANES * planeBytes(panel) : 0,
+        SLIDE_CACHE_BUDGET,
+        SLIDE_ARENA_SIZE,
+        stackBytes(),
+        featureBytes(),
+        false,
+    };
+    if (full.total() <= budget()) {
+        return full;
+    }
+    // No frame planes: bands instead, and nothing to swap prefetched slides into
+    Model banded = full;
+    banded.frame = PLANES * BANDED_RENDER_BYTES;
+    banded.prefetch = 0;
+    banded.banded = true;
+    return banded;
+}
+
+// This build's panel (Display)
+inline constexpr Model BUILD = model(SLIDESHOW_PANEL);
+
+/**
+ * @brief Log the model, the budget and the heap free now, one line each
+ */
+void log();
+
+} // namespace RamBudget
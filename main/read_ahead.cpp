@@ -0,0 +1,226 @@
+/**
+ * @file read_ahead.cpp
+ * @brief Read-ahead stage implementation
+ */
+
+#include "read_ahead.hpp"
+#include "config.hpp"
+#include "sd_card.hpp"
+#include "image_decode.hpp"
+#include "slide_stats.hpp"
+#include "pipeline_trace.hpp"
+#include "spsc_ring.hpp"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <atomic>
+#include <cstring>
+#include <algorithm>
+
+static const char* TAG_READ = "ReadAhead";
+
+/**
+ * @brief What the reader task works on, set before s_jobSeq is bumped
+ */
+struct Job {
+    FILE* file;
+    long offset;
+};
+
+// Chunks travel in an SpscRing over the Stream's buffer. A chunk shorter
+// than READ_AHEAD_CHUNK_SIZE (possibly empty) is the reader's last for the job.
+static TaskHandle_t s_task = nullptr;
+static SpscRing s_ring;
+static Job s_job;
+static std::atomic<uint32_t> s_jobSeq(0);
+static std::atomic<bool> s_cancel(false);
+
+static void readerTask(void* arg)
+{
+    (void)arg;
+    uint32_t seen = 0;
+    for (;;) {
+        // Notifications also come from the ring, so check for a new job
+        while (s_jobSeq.load() == seen) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+        seen = s_jobSeq.load();
+
+        bool ok;
+        {
+            SDCard::BusBurst burst;
+            ok = fseek(s_job.file, s_job.offset, SEEK_SET) == 0;
+        }
+        for (;;) {
+            uint8_t* chunk = s_ring.acquire();
+            if (!ok || s_cancel.load()) {
+                s_ring.commit(0);
+                break;
+            }
+            size_t got;
+            {
+                PipelineTrace::Scope trace(SlideStats::Stage::READ);
+                SDCard::BusBurst burst;
+                got = fread(chunk, 1, READ_AHEAD_CHUNK_SIZE, s_job.file);
+            }
+            s_ring.commit(got);
+            if (got < READ_AHEAD_CHUNK_SIZE) {
+                break;
+            }
+        }
+    }
+}
+
+bool ReadAhead::init()
+{
+#if CONFIG_FREERTOS_UNICORE
+    return false;
+#else
+    if (!PIPELINE_ENABLED) {
+        return false;
+    }
+    if (s_task) {
+        return true;
+    }
+
+    if (xTaskCreatePinnedToCore(readerTask, "read_ahead", READ_AHEAD_TASK_STACK, nullptr,
+                                SLIDESHOW_TASK_PRIORITY, &s_task,
+                                PIPELINE_IO_CORE) != pdPASS) {
+        ESP_LOGW(TAG_READ, "No reader task, reading inline");
+        s_task = nullptr;
+        return false;
+    }
+    ESP_LOGI(TAG_READ, "Reader task on core %d", PIPELINE_IO_CORE);
+    return true;
+#endif
+}
+
+ReadAhead::Stream::Stream(FILE* file)
+    : file_(file), offset_(file ? ftell(file) : 0), data_(nullptr), available_(0),
+      holding_(false), running_(false), finished_(false)
+{
+    if (s_task && file_) {
+        buffer_ = SlideArena::makeArray<uint8_t>(READ_AHEAD_CHUNKS * READ_AHEAD_CHUNK_SIZE);
+    }
+    if (buffer_) {
+        start(offset_);
+    }
+}
+
+ReadAhead::Stream::~Stream()
+{
+    stop();
+    if (file_) {
+        fclose(file_);
+    }
+}
+
+bool ReadAhead::Stream::start(long offset)
+{
+    offset_ = offset;
+    data_ = nullptr;
+    available_ = 0;
+    holding_ = false;
+    finished_ = false;
+
+    // The reader is idle: every chunk is free again
+    if (!s_ring.attach(buffer_.get(), READ_AHEAD_CHUNK_SIZE, READ_AHEAD_CHUNKS)) {
+        return false;
+    }
+    s_job = { file_, offset };
+    s_cancel.store(false);
+    s_jobSeq++;
+    xTaskNotifyGive(s_task);
+    running_ = true;
+    return true;
+}
+
+void ReadAhead::Stream::stop()
+{
+    if (!running_) {
+        return;
+    }
+    if (holding_) {
+        s_ring.release();
+        holding_ = false;
+    }
+    if (!finished_) {
+        // Wait for the reader to let go of the file and the chunks
+        s_cancel.store(true);
+        size_t len;
+        do {
+            s_ring.peek(len);
+            s_ring.release();
+        } while (len == READ_AHEAD_CHUNK_SIZE);
+    }
+    running_ = false;
+}
+
+bool ReadAhead::Stream::nextChunk()
+{
+    if (holding_) {
+        s_ring.release();
+        holding_ = false;
+    }
+    if (finished_) {
+        return false;
+    }
+
+    {
+        // Time spent waiting on the SD card, as inline reads are timed
+        SlideStats::Timer timer(SlideStats::Stage::READ);
+        data_ = s_ring.peek(available_);
+    }
+    holding_ = true;
+    finished_ = available_ < READ_AHEAD_CHUNK_SIZE;
+    return available_ > 0;
+}
+
+size_t ReadAhead::Stream::read(void* dst, size_t len)
+{
+    if (!buffer_) {
+        size_t got = file_ ? ImageDecode::readFile(dst, 1, len, file_) : 0;
+        offset_ += static_cast<long>(got);
+        return got;
+    }
+
+    uint8_t* out = static_cast<uint8_t*>(dst);
+    size_t done = 0;
+    while (done < len && (available_ > 0 || nextChunk())) {
+        size_t take = std::min(len - done, available_);
+        memcpy(out + done, data_, take);
+        data_ += take;
+        available_ -= take;
+        done += take;
+    }
+    offset_ += static_cast<long>(done);
+    return done;
+}
+
+bool ReadAhead::Stream::skip(size_t len)
+{
+    if (!buffer_) {
+        if (!file_ || fseek(file_, static_cast<long>(len), SEEK_CUR) != 0) {
+            return false;
+        }
+        offset_ += static_cast<long>(len);
+        return true;
+    }
+
+    // Past what is in flight: restart the reader at the target
+    if (len > available_ + READ_AHEAD_CHUNKS * READ_AHEAD_CHUNK_SIZE) {
+        stop();
+        return start(offset_ + static_cast<long>(len));
+    }
+
+    size_t done = 0;
+    while (done < len && (available_ > 0 || nextChunk())) {
+        size_t take = std::min(len - done, available_);
+        data_ += take;
+        available_ -= take;
+        done += take;
+    }
+    offset_ += static_cast<long>(done);
+    return done == len;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file read_ahead.hpp
+ * @brief SD reads on a reader task pinned to the other core, ahead of the decoder
+ *
+ * The first stage of the dual-core pipeline (PIPELINE_ENABLED): a Stream
+ * hands a file to the reader task, which fills READ_AHEAD_CHUNKS chunks of
+ * READ_AHEAD_CHUNK_SIZE and passes them through an SpscRing while the
+ * slideshow task decodes the previous ones. Without a second core, or
+ * without memory for the chunks, a Stream reads inline like fread(). Only
+ * one Stream may be open at a time.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include "slide_arena.hpp"
+
+namespace ReadAhead {
+
+/**
+ * @brief Create the reader task (once; later calls do nothing)
+ * @return true if reads will run ahead, false if they stay inline
+ */
+bool init();
+
+/**
+ * @brief Sequential reads of one open file
+ *
+ * Reading starts at the file's position when the Stream is created. Call
+ * inside a SlideArena::Scope (the chunks come from the arena).
+ */
+class Stream {
+public:
+    /**
+     * @param file Open file; the Stream owns it and closes it
+     */
+    explicit Stream(FILE* file);
+    ~Stream();
+
+    Stream(const Stream&) = delete;
+    Stream& operator=(const Stream&) = delete;
+
+    /**
+     * @brief Copy the next bytes, waiting for the reader if needed (timed
+     *        as SlideStats::Stage::READ)
+     * @return Bytes copied; fewer than len only at the end of the file or
+     *         on a read error
+     */
+    size_t read(void* dst, size_t len);
+
+    /**
+     * @brief Skip bytes, seeking when they reach past the chunks in flight
+     * @return false at the end of the file or on an error
+     */
+    bool skip(size_t len);
+
+private:
+    bool start(long offset);
+    void stop();
+    bool nextChunk();
+
+    FILE* file_;
+    SlideArena::Ptr<uint8_t[]> buffer_;  // READ_AHEAD_CHUNKS chunks; empty: read inline
+    long offset_;                        // File offset of the next byte read()
+    const uint8_t* data_;                // Unread part of the current chunk
+    size_t available_;
+    bool holding_;                       // data_ is in a peeked chunk
+    bool running_;                       // The reader has a job for this Stream
+    bool finished_;                      // The reader reached the end or an error
+};
+
+} // namespace ReadAhead
@@ -0,0 +1,117 @@
+/**
+ * @file refresh_timing.cpp
+ * @brief Refresh time learning implementation
+ */
+
+#include "refresh_timing.hpp"
+#include "config.hpp"
+#include "panel.hpp"
+#include "esp_log.h"
+#include "nvs.h"
+#include <cinttypes>
+#include <cstdio>
+
+static const char* TAG_TIMING = "RefreshTiming";
+
+static constexpr int MODES = EPD_REFRESH_PARTIAL + 1;
+static constexpr char MODE_KEYS[MODES] = {'f', 'x', 'p'};  // Full, fast, partial
+
+// Waveforms run slower in the cold, so each band learns its own times
+enum Band : uint8_t { ROOM, COLD, FREEZING, BANDS };
+static constexpr char BAND_KEYS[BANDS] = {'r', 'c', 'z'};
+
+// Learned times per band and kind, read from NVS on first use
+static uint32_t s_learned[BANDS][MODES];
+static bool s_loaded[BANDS];
+
+static Band bandOf(Adafruit_EPD& display)
+{
+    int8_t celsius = display.getAmbientTemperature();
+    if (celsius == EPD_TEMPERATURE_UNKNOWN || celsius >= EPD_COLD_CELSIUS) {
+        return ROOM;
+    }
+    return celsius < EPD_FREEZING_CELSIUS ? FREEZING : COLD;
+}
+
+/**
+ * @brief NVS key of a panel, band and kind, e.g. "p1rf"
+ */
+static void makeKey(char (&key)[16], Band band, int mode)
+{
+    snprintf(key, sizeof(key), "p%u%c%c", Panel::active().id, BAND_KEYS[band], MODE_KEYS[mode]);
+}
+
+static void load(Band band)
+{
+    if (s_loaded[band]) {
+        return;
+    }
+    s_loaded[band] = true;
+    nvs_handle_t handle;
+    if (nvs_open(REFRESH_TIMING_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return;
+    }
+    for (int mode = 0; mode < MODES; mode++) {
+        char key[16];
+        makeKey(key, band, mode);
+        nvs_get_u32(handle, key, &s_learned[band][mode]);
+    }
+    nvs_close(handle);
+}
+
+static void store(Band band, int mode, uint32_t ms)
+{
+    nvs_handle_t handle;
+    if (nvs_open(REFRESH_TIMING_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        return;
+    }
+    char key[16];
+    makeKey(key, band, mode);
+    if (nvs_set_u32(handle, key, ms) != ESP_OK || nvs_commit(handle) != ESP_OK) {
+        ESP_LOGW(TAG_TIMING, "Failed to store %s", key);
+    }
+    nvs_close(handle);
+}
+
+void RefreshTiming::apply(Adafruit_EPD& display)
+{
+    if (!REFRESH_TIMING_ENABLED || display.hasBusyPin()) {
+        return;
+    }
+    Band band = bandOf(display);
+    load(band);
+    for (int mode = 0; mode < MODES; mode++) {
+        uint32_t ms = s_learned[band][mode];
+        if (ms != 0) {
+            ms += ms * REFRESH_TIMING_MARGIN_PERCENT / 100;
+            ESP_LOGI(TAG_TIMING, "%c refresh: %" PRIu32 " ms", MODE_KEYS[mode], ms);
+        }
+        display.setRefreshDelay(static_cast<epd_refresh_t>(mode), ms);
+    }
+}
+
+void RefreshTiming::learn(Adafruit_EPD& display)
+{
+    epd_refresh_t mode;
+    uint32_t ms = display.takeRefreshDuration(mode);
+    if (!REFRESH_TIMING_ENABLED || ms == 0) {
+        return;
+    }
+    // Only the longest is kept, so NVS is written while it still grows
+    Band band = bandOf(display);
+    load(band);
+    if (ms <= s_learned[band][mode]) {
+        return;
+    }
+    ESP_LOGI(TAG_TIMING, "%c refresh: %" PRIu32 " ms, was %" PRIu32,
+             MODE_KEYS[mode], ms, s_learned[band][mode]);
+    s_learned[band][mode] = ms;
+    store(band, mode, ms);
+}
+
+uint32_t RefreshTiming::learned(Adafruit_EPD& display, epd_refresh_t mode)
+{
+    Band band = bandOf(display);
+    load(band);
+    return s_learned[band][mode];
+}
@@ -0,0 +1,38 @@
+/**
+ * @file refresh_timing.hpp
+ * @brief Refresh times learned on the BUSY pin, for boards without one
+ *
+ * With the pin wired, every refresh's time from the command to BUSY release
+ * is read back from the display and the longest per panel profile, refresh
+ * kind and temperature band is kept in NVS. Without the pin the display
+ * waits the learned time plus REFRESH_TIMING_MARGIN_PERCENT for each kind
+ * it has one for, and the panel table's fixed refresh_delay otherwise.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "../components/Adafruit_EPD/src/Adafruit_EPD.h"
+
+namespace RefreshTiming {
+
+/**
+ * @brief Without a BUSY pin, give the display the learned times for the
+ *        active panel at its current temperature; call after begin()
+ */
+void apply(Adafruit_EPD& display);
+
+/**
+ * @brief Record the last refresh's time if it is new and the longest yet;
+ *        call when no refresh is running
+ */
+void learn(Adafruit_EPD& display);
+
+/**
+ * @brief Learned time of a refresh kind for the active panel at the
+ *        display's current temperature
+ * @return Milliseconds, 0 if none has been learned
+ */
+uint32_t learned(Adafruit_EPD& display, epd_refresh_t mode);
+
+} // namespace RefreshTiming
@@ -0,0 +1,252 @@
+/**
+ * @file render_flow.cpp
+ * @brief Coroutine render steps implementation
+ */
+
+#include "render_flow.hpp"
+#include "config.hpp"
+#include "button.hpp"
+#include "sd_card.hpp"
+#include "pipeline_trace.hpp"
+#include "../components/Adafruit_EPD/src/Adafruit_EPD.h"
+#include "../components/Adafruit_BusIO_ESPIDF/Adafruit_SPIDevice.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "freertos/task.h"
+#include <cinttypes>
+#include <new>
+
+static const char* TAG_FLOW = "RenderFlow";
+
+static QueueHandle_t s_wakeQueue = nullptr;   // Owner's event queue
+static QueueHandle_t s_readyQueue = nullptr;  // Frame addresses of ready flows
+static QueueHandle_t s_readJobs = nullptr;    // FileRead* for the worker
+static TaskHandle_t s_readTask = nullptr;
+
+// Frames are made and freed on the owner task only, so the pool needs no lock
+alignas(std::max_align_t) static uint8_t s_frames[RENDER_FLOW_FRAME_SLOTS][RENDER_FLOW_FRAME_BYTES];
+static uint32_t s_framesUsed = 0;  // One bit per slot
+static_assert(RENDER_FLOW_FRAME_SLOTS <= 32, "s_framesUsed holds one bit per slot");
+
+// ------------- Flow -------------
+
+void* RenderFlow::Flow::promise_type::operator new(size_t size) noexcept
+{
+    if (size <= RENDER_FLOW_FRAME_BYTES) {
+        for (size_t i = 0; i < RENDER_FLOW_FRAME_SLOTS; i++) {
+            if (!(s_framesUsed & (1u << i))) {
+                s_framesUsed |= 1u << i;
+                return s_frames[i];
+            }
+        }
+    }
+    static bool warned = false;
+    if (!warned) {
+        warned = true;
+        ESP_LOGW(TAG_FLOW, "Frame of %zu bytes from the heap: %zu slots of %zu bytes", size,
+                 RENDER_FLOW_FRAME_SLOTS, RENDER_FLOW_FRAME_BYTES);
+    }
+    return ::operator new(size, std::nothrow);
+}
+
+void RenderFlow::Flow::promise_type::operator delete(void* frame) noexcept
+{
+    uint8_t* bytes = static_cast<uint8_t*>(frame);
+    if (bytes >= &s_frames[0][0] && bytes < &s_frames[0][0] + sizeof(s_frames)) {
+        s_framesUsed &= ~(1u << ((bytes - &s_frames[0][0]) / RENDER_FLOW_FRAME_BYTES));
+        return;
+    }
+    ::operator delete(frame);
+}
+
+std::coroutine_handle<> RenderFlow::Flow::FinalAwaiter::await_suspend(Handle finished) noexcept
+{
+    std::coroutine_handle<> next = finished.promise().continuation;
+    if (finished.promise().detached) {
+        finished.destroy();
+    }
+    return next ? next : std::noop_coroutine();
+}
+
+RenderFlow::Flow& RenderFlow::Flow::operator=(Flow&& other) noexcept
+{
+    if (this != &other) {
+        if (handle_) {
+            handle_.destroy();
+        }
+        handle_ = other.handle_;
+        other.handle_ = nullptr;
+    }
+    return *this;
+}
+
+RenderFlow::Flow::~Flow()
+{
+    // Ended (awaited) or never run; start() takes the handle
+    if (handle_) {
+        handle_.destroy();
+    }
+}
+
+std::coroutine_handle<> RenderFlow::Flow::await_suspend(std::coroutine_handle<> awaiting) noexcept
+{
+    handle_.promise().continuation = awaiting;
+    return handle_;
+}
+
+// ------------- Scheduling -------------
+
+bool RenderFlow::init(QueueHandle_t wakeQueue)
+{
+    s_wakeQueue = wakeQueue;
+    if (!s_readyQueue) {
+        s_readyQueue = xQueueCreate(RENDER_FLOW_READY_DEPTH, sizeof(void*));
+    }
+    if (!s_readyQueue) {
+        ESP_LOGE(TAG_FLOW, "Failed to create the ready queue");
+        return false;
+    }
+    return true;
+}
+
+bool RenderFlow::start(Flow flow)
+{
+    if (!flow.handle_ || !s_readyQueue) {
+        return false;
+    }
+    Flow::Handle handle = flow.handle_;
+    flow.handle_ = nullptr;
+    handle.promise().detached = true;
+    handle.resume();
+    return true;
+}
+
+void RenderFlow::runReady()
+{
+    void* frame;
+    while (s_readyQueue && xQueueReceive(s_readyQueue, &frame, 0) == pdTRUE) {
+        std::coroutine_handle<>::from_address(frame).resume();
+    }
+}
+
+// Only wakes the owner; runReady() finds the flow in the ready queue. Dropped
+// when the owner's queue is full, as the owner is awake then anyway
+static DRAM_ATTR const SlideshowButtonEvent RESUME_EVENT{SlideshowButtonId::RESUME, SlideshowButtonAction::PRESS};
+
+void RenderFlow::post(std::coroutine_handle<> handle)
+{
+    void* frame = handle.address();
+    // Never full while fewer than RENDER_FLOW_READY_DEPTH flows are suspended
+    xQueueSend(s_readyQueue, &frame, portMAX_DELAY);
+    xQueueSend(s_wakeQueue, &RESUME_EVENT, 0);
+}
+
+void IRAM_ATTR RenderFlow::postFromISR(std::coroutine_handle<> handle, BaseType_t* woken)
+{
+    void* frame = handle.address();
+    xQueueSendFromISR(s_readyQueue, &frame, woken);
+    xQueueSendFromISR(s_wakeQueue, &RESUME_EVENT, woken);
+}
+
+// ------------- Awaitables -------------
+
+static void onRefreshed(Adafruit_EPD* epd, void* frame)
+{
+    (void)epd;
+    RenderFlow::post(std::coroutine_handle<>::from_address(frame));
+}
+
+bool RenderFlow::Refreshed::await_suspend(std::coroutine_handle<> awaiting) noexcept
+{
+    // The callback may fire before this returns; the flow still only
+    // resumes on the owner, from runReady()
+    return epd.whenRefreshed(onRefreshed, awaiting.address());
+}
+
+static void onTimer(void* frame)
+{
+    RenderFlow::post(std::coroutine_handle<>::from_address(frame));
+}
+
+bool RenderFlow::Delay::await_suspend(std::coroutine_handle<> awaiting) noexcept
+{
+    esp_timer_create_args_t args = {};
+    args.callback = onTimer;
+    args.arg = awaiting.address();
+    args.name = "render_flow";
+    if (esp_timer_create(&args, &timer) != ESP_OK ||
+        esp_timer_start_once(timer, static_cast<uint64_t>(ms) * 1000) != ESP_OK) {
+        ESP_LOGW(TAG_FLOW, "Cannot start a %" PRIu32 " ms timer", ms);
+        return false;  // Carry on undelayed
+    }
+    return true;
+}
+
+void RenderFlow::Delay::await_resume() noexcept
+{
+    if (timer) {
+        esp_timer_delete(timer);
+        timer = nullptr;
+    }
+}
+
+static void IRAM_ATTR onSpiWritten(void* frame)
+{
+    BaseType_t woken = pdFALSE;
+    RenderFlow::postFromISR(std::coroutine_handle<>::from_address(frame), &woken);
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+bool RenderFlow::SpiWritten::await_suspend(std::coroutine_handle<> awaiting) noexcept
+{
+    queued = device.writeAsync(buffer, len, onSpiWritten, awaiting.address());
+    return queued;
+}
+
+bool RenderFlow::SpiWritten::await_resume() noexcept
+{
+    // Collects the finished slots; doesn't block once the callback has run
+    return queued && device.waitAsync();
+}
+
+/**
+ * @brief Read worker: one fread() per job, then the job's flow is ready
+ */
+static void readTask(void* arg)
+{
+    (void)arg;
+    RenderFlow::FileRead* job;
+    while (true) {
+        if (xQueueReceive(s_readJobs, &job, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        {
+            PipelineTrace::Scope trace(SlideStats::Stage::READ);
+            SDCard::BusBurst burst;
+            job->result = fread(job->dst, 1, job->len, job->file);
+        }
+        RenderFlow::post(job->awaiting);
+    }
+}
+
+bool RenderFlow::FileRead::await_suspend(std::coroutine_handle<> handle) noexcept
+{
+    if (!s_readJobs) {
+        s_readJobs = xQueueCreate(RENDER_FLOW_READY_DEPTH, sizeof(FileRead*));
+        if (s_readJobs && xTaskCreate(readTask, "render_flow_io", RENDER_FLOW_READ_TASK_STACK,
+                                      nullptr, SLIDESHOW_TASK_PRIORITY, &s_readTask) != pdPASS) {
+            s_readTask = nullptr;
+        }
+    }
+    awaiting = handle;
+    FileRead* job = this;
+    if (!s_readTask || xQueueSend(s_readJobs, &job, portMAX_DELAY) != pdTRUE) {
+        // No worker: read here, blocking as before
+        SDCard::BusBurst burst;
+        result = fread(dst, 1, len, file);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file render_flow.hpp
+ * @brief Coroutines for the slideshow's waits: render steps written as
+ *        straight-line code that suspends on the panel, the SPI bus, a timer
+ *        or an SD read instead of blocking the task
+ *
+ * A Flow is a C++20 coroutine that runs on the task owning the queue given
+ * to init() (the slideshow task). What it awaits completes elsewhere (the
+ * refresh task, the SPI ISR, an esp_timer, the read worker) and marks it
+ * ready; the owner resumes ready flows with runReady(). A suspended flow
+ * costs a frame from a fixed pool (RENDER_FLOW_FRAME_SLOTS) rather than a
+ * blocked task, so the owner keeps
+ * handling buttons, or light-sleeps, meanwhile. Flows co_await other Flows;
+ * the outermost one is handed to start() and frees itself when it ends.
+ */
+
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+
+class Adafruit_EPD;
+class Adafruit_SPIDevice;
+
+namespace RenderFlow {
+
+/**
+ * @brief Coroutine return type; lazily started
+ */
+class Flow {
+public:
+    struct promise_type;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    /**
+     * @brief Hands control to whoever waits for the flow once it ends
+     */
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(Handle finished) noexcept;
+        void await_resume() const noexcept {}
+    };
+
+    struct promise_type {
+        std::coroutine_handle<> continuation;  // Flow awaiting this one
+        bool detached = false;                 // start()ed: frees itself at the end
+
+        // Frames come from the pool, else the heap, without throwing; on
+        // failure the Flow is empty and awaiting or starting it does nothing
+        static void* operator new(size_t size) noexcept;
+        static void operator delete(void* frame) noexcept;
+        static Flow get_return_object_on_allocation_failure() noexcept { return Flow(); }
+
+        Flow get_return_object() noexcept { return Flow(Handle::from_promise(*this)); }
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        FinalAwaiter final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept {}  // Built without exceptions
+    };
+
+    Flow() = default;
+    Flow(Flow&& other) noexcept : handle_(other.handle_) { other.handle_ = nullptr; }
+    Flow& operator=(Flow&& other) noexcept;
+    Flow(const Flow&) = delete;
+    Flow& operator=(const Flow&) = delete;
+    ~Flow();
+
+    bool valid() const { return static_cast<bool>(handle_); }
+
+    // co_await: runs the flow; the awaiting one continues when it ends
+    bool await_ready() const noexcept { return !handle_; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept;
+    void await_resume() const noexcept {}
+
+private:
+    explicit Flow(Handle handle) : handle_(handle) {}
+    friend bool start(Flow flow);
+
+    Handle handle_;
+};
+
+/**
+ * @brief Set up the ready queue
+ * @param wakeQueue The owner's event queue; a SlideshowButtonId::RESUME
+ *        event is posted to it whenever a flow becomes ready
+ * @return false if the ready queue cannot be created
+ */
+bool init(QueueHandle_t wakeQueue);
+
+/**
+ * @brief Run a flow up to its first suspension, detached
+ * @return false if the flow has no frame (out of memory) or init() failed
+ */
+bool start(Flow flow);
+
+/**
+ * @brief Resume every ready flow; call on the owner task whenever its queue
+ *        yields an event, RESUME or not
+ */
+void runReady();
+
+/**
+ * @brief Mark a suspended flow ready; safe from any task
+ */
+void post(std::coroutine_handle<> handle);
+
+/**
+ * @brief Mark a suspended flow ready from an ISR
+ */
+void postFromISR(std::coroutine_handle<> handle, BaseType_t* woken);
+
+/**
+ * @brief co_await refreshed(epd): the displayAsync() refresh in progress is
+ *        done (busy pin released, panel powered down if asked); ready at
+ *        once when none is running
+ */
+struct Refreshed {
+    Adafruit_EPD& epd;
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> awaiting) noexcept;
+    void await_resume() const noexcept {}
+};
+inline Refreshed refreshed(Adafruit_EPD& epd) { return Refreshed{epd}; }
+
+/**
+ * @brief co_await delay(ms): an esp_timer one-shot
+ */
+struct Delay {
+    uint32_t ms;
+    esp_timer_handle_t timer = nullptr;
+
+    bool await_ready() const noexcept { return ms == 0; }
+    bool await_suspend(std::coroutine_handle<> awaiting) noexcept;
+    void await_resume() noexcept;
+};
+inline Delay delay(uint32_t ms) { return Delay{ms}; }
+
+/**
+ * @brief co_await spiWrite(device, buf, len): an Adafruit_SPIDevice
+ *        writeAsync(); buf must stay valid until the flow resumes
+ * @return (from co_await) false if the write could not be queued
+ */
+struct SpiWritten {
+    Adafruit_SPIDevice& device;
+    const uint8_t* buffer;
+    size_t len;
+    bool queued = false;
+
+    bool await_ready() const noexcept { return len == 0; }
+    bool await_suspend(std::coroutine_handle<> awaiting) noexcept;
+    bool await_resume() noexcept;
+};
+inline SpiWritten spiWrite(Adafruit_SPIDevice& device, const uint8_t* buffer, size_t len)
+{
+    return SpiWritten{device, buffer, len};
+}
+
+/**
+ * @brief co_await readFile(file, dst, len): fread() on the read worker task,
+ *        inside an SDCard::BusBurst
+ * @return (from co_await) Bytes read
+ */
+struct FileRead {
+    FILE* file;
+    void* dst;
+    size_t len;
+    size_t result = 0;
+    std::coroutine_handle<> awaiting = {};
+
+    bool await_ready() const noexcept { return len == 0 || !file; }
+    bool await_suspend(std::coroutine_handle<> handle) noexcept;
+    size_t await_resume() const noexcept { return result; }
+};
+inline FileRead readFile(FILE* file, void* dst, size_t len) { return FileRead{file, dst, len}; }
+
+} // namespace RenderFlow
@@ -0,0 +1,42 @@
+/**
+ * @file render_job.cpp
+ * @brief Render job implementation
+ */
+
+#include "render_job.hpp"
+
+static bool (*s_preemptCheck)(RenderJob::Priority running) = nullptr;
+static RenderJob::Scope* s_current = nullptr;
+
+void RenderJob::setPreemptCheck(bool (*check)(Priority running))
+{
+    s_preemptCheck = check;
+}
+
+bool RenderJob::preempted(Priority running)
+{
+    bool (*check)(Priority) = s_preemptCheck;
+    return check && check(running);
+}
+
+RenderJob::Scope::Scope(Priority priority)
+    : outer_(s_current), priority_(priority), cancelled_(false)
+{
+    s_current = this;
+}
+
+RenderJob::Scope::~Scope()
+{
+    s_current = outer_;
+}
+
+bool RenderJob::cancelled()
+{
+    if (!s_current) {
+        return false;
+    }
+    if (!s_current->cancelled_ && preempted(s_current->priority_)) {
+        s_current->cancelled_ = true;
+    }
+    return s_current->cancelled_;
+}
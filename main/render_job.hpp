@@ -0,0 +1,72 @@
+/**
+ * @file render_job.hpp
+ * @brief Priorities and cancellation for slide decodes and uploads
+ *
+ * Every decode the slideshow runs is a job with a priority. The decoders
+ * poll cancelled() between rows (ImageDecode::aborted()) and the display
+ * polls preempted() between upload chunks, so newer work that outranks a
+ * job stops it within one row or one EPD_UPLOAD_CHUNK_SIZE chunk instead of
+ * one frame. What is waiting, and how urgent it is, comes from the check
+ * installed with setPreemptCheck().
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace RenderJob {
+
+/**
+ * @brief How much a job yields; waiting work at or above its level stops it
+ */
+enum class Priority : uint8_t {
+    BACKGROUND,  // Converting a slide into the frame cache: yields to any input
+    PREFETCH,    // Decoding a neighbour ahead of time: yields to any input
+    DISPLAY      // The slide going on screen: yields to input that replaces it
+};
+
+/**
+ * @brief Install the check for waiting work
+ * @param check Returns true when work waiting would stop a job running at
+ *              the given priority; called from the decoding task and the
+ *              display's refresh task. nullptr: jobs always finish (the default)
+ */
+void setPreemptCheck(bool (*check)(Priority running));
+
+/**
+ * @brief Ask the check whether a job at a priority would be stopped now
+ *
+ * For work that isn't the current job, e.g. the refresh task's upload.
+ */
+bool preempted(Priority running);
+
+/**
+ * @brief The current job, for as long as it is in scope
+ *
+ * Only on the task that decodes (the slideshow task). Scopes nest; the
+ * inner one is the current job until it ends.
+ */
+class Scope {
+public:
+    explicit Scope(Priority priority);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    Scope* outer_;
+    Priority priority_;
+    bool cancelled_;
+
+    friend bool cancelled();
+};
+
+/**
+ * @brief Check whether the current job should stop
+ *
+ * Once true it stays true until the job ends. Always false outside a Scope.
+ */
+bool cancelled();
+
+} // namespace RenderJob
@@ -0,0 +1,275 @@
+/**
+ * @file schedule.cpp
+ * @brief Opening hours implementation
+ */
+
+#include "schedule.hpp"
+#include "config.hpp"
+#include "tunables.hpp"
+#include "wifi_radio.hpp"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_netif_sntp.h"
+#include "freertos/FreeRTOS.h"
+#include <sys/time.h>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const char* TAG_SCHED = "Schedule";
+
+// Anything earlier is a clock nobody has set (it starts at 1970)
+static constexpr time_t CLOCK_VALID_AFTER = 1704067200;  // 2024-01-01
+
+// SNTP attempts that fail are retried after this long
+static constexpr int64_t SNTP_RETRY_SEC = 3600;
+
+static constexpr size_t MAX_PERIODS = 8;
+
+struct Period {
+    uint16_t startMin;  // Minutes after midnight
+    uint16_t endMin;    // Exclusive; below startMin for a period past midnight
+    uint32_t dwellSec;
+    bool fast;
+};
+
+static Period s_periods[MAX_PERIODS];
+static size_t s_periodCount = 0;
+
+// Last SNTP attempt (wall clock, which runs through deep sleep) and its result
+RTC_DATA_ATTR static int64_t s_lastSntpSec = 0;
+RTC_DATA_ATTR static bool s_lastSntpOk = false;
+
+static bool clockValid()
+{
+    return time(nullptr) > CLOCK_VALID_AFTER;
+}
+
+static bool dayOpen(int wday)
+{
+    return (SCHEDULE_OPEN_DAYS >> ((wday + 7) % 7)) & 1;
+}
+
+/**
+ * @brief The period in force at a time, nullptr when closed
+ */
+static const Period* periodAt(time_t t)
+{
+    struct tm local;
+    localtime_r(&t, &local);
+    int minute = local.tm_hour * 60 + local.tm_min;
+    for (size_t i = 0; i < s_periodCount; i++) {
+        const Period& p = s_periods[i];
+        if (p.startMin < p.endMin) {
+            if (minute >= p.startMin && minute < p.endMin && dayOpen(local.tm_wday)) {
+                return &p;
+            }
+        } else if ((minute >= p.startMin && dayOpen(local.tm_wday)) ||
+                   (minute < p.endMin && dayOpen(local.tm_wday - 1))) {
+            // Past midnight: the period belongs to the day it started on
+            return &p;
+        }
+    }
+    return nullptr;
+}
+
+static const Period* currentPeriod()
+{
+    return Schedule::active() ? periodAt(time(nullptr)) : nullptr;
+}
+
+/**
+ * @brief Parse "HH:MM" into minutes after midnight
+ */
+static bool parseClock(const char* text, uint16_t& minutes)
+{
+    unsigned hours = 0;
+    unsigned mins = 0;
+    if (sscanf(text, "%2u:%2u", &hours, &mins) != 2 || hours > 24 || mins > 59 ||
+        hours * 60 + mins > 24 * 60) {
+        return false;
+    }
+    minutes = static_cast<uint16_t>(hours * 60 + mins);
+    return true;
+}
+
+/**
+ * @brief Parse one "HH:MM-HH:MM/dwell/full|fast" entry
+ */
+static bool parsePeriod(const char* entry, Period& out)
+{
+    char start[6] = "";
+    char end[6] = "";
+    unsigned dwell = 0;
+    char waveform[8] = "full";
+    int fields = sscanf(entry, " %5[0-9:]-%5[0-9:]/%u/%7[a-z]", start, end, &dwell, waveform);
+    if (fields < 3 || !parseClock(start, out.startMin) || !parseClock(end, out.endMin) ||
+        out.startMin == out.endMin || dwell == 0) {
+        return false;
+    }
+    if (out.endMin == 24 * 60) {
+        out.endMin = 0;  // "24:00" ends at midnight
+    }
+    if (strcmp(waveform, "full") != 0 && strcmp(waveform, "fast") != 0) {
+        return false;
+    }
+    out.dwellSec = dwell;
+    out.fast = strcmp(waveform, "fast") == 0;
+    return true;
+}
+
+bool Schedule::init()
+{
+    setenv("TZ", SCHEDULE_TIMEZONE, 1);
+    tzset();
+    s_periodCount = 0;
+    if (!SCHEDULE_ENABLED) {
+        return false;
+    }
+
+    char entry[48];
+    const char* cursor = SCHEDULE_PERIODS;
+    while (*cursor) {
+        size_t len = strcspn(cursor, ",");
+        if (len >= sizeof(entry) || s_periodCount == MAX_PERIODS) {
+            ESP_LOGE(TAG_SCHED, "SCHEDULE_PERIODS: too long at \"%s\"", cursor);
+            s_periodCount = 0;
+            return false;
+        }
+        memcpy(entry, cursor, len);
+        entry[len] = '\0';
+        if (!parsePeriod(entry, s_periods[s_periodCount])) {
+            ESP_LOGE(TAG_SCHED, "SCHEDULE_PERIODS: cannot parse \"%s\"", entry);
+            s_periodCount = 0;
+            return false;
+        }
+        s_periodCount++;
+        cursor += len;
+        if (*cursor == ',') {
+            cursor++;
+        }
+    }
+    ESP_LOGI(TAG_SCHED, "%zu periods, clock %s", s_periodCount, clockValid() ? "set" : "not set yet");
+    return s_periodCount > 0;
+}
+
+bool Schedule::active()
+{
+    return s_periodCount > 0 && clockValid();
+}
+
+bool Schedule::isClosed()
+{
+    return active() && !currentPeriod();
+}
+
+uint32_t Schedule::dwellSec()
+{
+    const Period* period = currentPeriod();
+    return period ? period->dwellSec : Tunables::get(Tunables::Id::DWELL_SEC);
+}
+
+bool Schedule::fastWaveform()
+{
+    const Period* period = currentPeriod();
+    return period && period->fast;
+}
+
+int64_t Schedule::secondsUntilOpen(uint32_t fromSec)
+{
+    if (!active()) {
+        return 0;
+    }
+    time_t now = time(nullptr);
+    time_t from = now + fromSec;
+    if (periodAt(from)) {
+        return 0;
+    }
+
+    // The earliest period start after `from` on an open day; mktime() puts
+    // each one on the right side of a DST change
+    struct tm base;
+    localtime_r(&from, &base);
+    time_t best = 0;
+    for (int day = 0; day <= 7; day++) {
+        for (size_t i = 0; i < s_periodCount; i++) {
+            struct tm start = base;
+            start.tm_mday += day;
+            start.tm_hour = s_periods[i].startMin / 60;
+            start.tm_min = s_periods[i].startMin % 60;
+            start.tm_sec = 0;
+            start.tm_isdst = -1;
+            time_t t = mktime(&start);
+            if (t > from && (best == 0 || t < best) && periodAt(t)) {
+                best = t;
+            }
+        }
+        if (best != 0) {
+            break;  // Later days only start later
+        }
+    }
+    return best != 0 ? static_cast<int64_t>(best - now) : 0;
+}
+
+bool Schedule::setClock(const struct tm& local)
+{
+    struct tm copy = local;
+    copy.tm_isdst = -1;
+    time_t t = mktime(&copy);
+    if (t <= CLOCK_VALID_AFTER) {
+        return false;
+    }
+    struct timeval tv = {t, 0};
+    if (settimeofday(&tv, nullptr) != 0) {
+        return false;
+    }
+    ESP_LOGI(TAG_SCHED, "Clock set by hand");
+    return true;
+}
+
+bool Schedule::localTime(struct tm& out)
+{
+    if (!clockValid()) {
+        return false;
+    }
+    time_t now = time(nullptr);
+    localtime_r(&now, &out);
+    return true;
+}
+
+bool Schedule::clockSyncDue()
+{
+    if (!SCHEDULE_ENABLED || SCHEDULE_SNTP_SERVER[0] == '\0' || WIFI_SSID[0] == '\0') {
+        return false;
+    }
+    if (s_lastSntpSec == 0) {
+        return true;
+    }
+    int64_t interval = s_lastSntpOk ? SCHEDULE_SNTP_INTERVAL_SEC : SNTP_RETRY_SEC;
+    return static_cast<int64_t>(time(nullptr)) - s_lastSntpSec >= interval;
+}
+
+bool Schedule::syncClock()
+{
+    bool ok = false;
+    {
+        WifiRadio::Link link;
+        if (link.connected()) {
+            esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG(SCHEDULE_SNTP_SERVER);
+            if (esp_netif_sntp_init(&config) == ESP_OK) {
+                ok = esp_netif_sntp_sync_wait(pdMS_TO_TICKS(SCHEDULE_SNTP_TIMEOUT_MS)) == ESP_OK;
+                esp_netif_sntp_deinit();
+            }
+        }
+    }
+    // After the sync, so the interval counts from the corrected clock
+    s_lastSntpSec = time(nullptr);
+    s_lastSntpOk = ok;
+    if (ok) {
+        ESP_LOGI(TAG_SCHED, "Clock set over SNTP");
+    } else {
+        ESP_LOGW(TAG_SCHED, "SNTP failed, retrying in %" PRId64 " s", SNTP_RETRY_SEC);
+    }
+    return ok;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file schedule.hpp
+ * @brief Opening hours: per-period dwell and waveform, and closed hours the
+ *        frame sleeps through
+ *
+ * SCHEDULE_PERIODS lists the periods of an open day (SCHEDULE_OPEN_DAYS) in
+ * local time (SCHEDULE_TIMEZONE). Everything else is closed. The schedule
+ * needs the wall clock: set over SNTP (syncClock()) or by hand (setClock()),
+ * it runs on through deep sleep; until it has been set the schedule stays
+ * out of the way and the show runs as configured without it.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+
+namespace Schedule {
+
+/**
+ * @brief Parse SCHEDULE_PERIODS and set the time zone
+ * @return false if the schedule is disabled or the periods don't parse
+ */
+bool init();
+
+/**
+ * @brief Enabled, parsed, and the clock has been set
+ */
+bool active();
+
+/**
+ * @brief Outside every period; false while the schedule isn't active()
+ */
+bool isClosed();
+
+/**
+ * @brief Auto-advance dwell of the current period, the dwell_sec tunable
+ *        outside any period or without a schedule
+ */
+uint32_t dwellSec();
+
+/**
+ * @brief The current period asks for the fast waveform
+ */
+bool fastWaveform();
+
+/**
+ * @brief Seconds from now until the schedule is open
+ * @param fromSec Start looking this many seconds from now
+ * @return 0 if it is open then (or the schedule isn't active), else the
+ *         seconds from now to the next opening
+ */
+int64_t secondsUntilOpen(uint32_t fromSec = 0);
+
+/**
+ * @brief Set the wall clock by hand
+ * @param local Local time (SCHEDULE_TIMEZONE)
+ * @return false if the time is invalid
+ */
+bool setClock(const struct tm& local);
+
+/**
+ * @brief Current local time
+ * @return false until the clock has been set
+ */
+bool localTime(struct tm& out);
+
+/**
+ * @brief SNTP is configured and the clock is unset, or was last synced more
+ *        than SCHEDULE_SNTP_INTERVAL_SEC ago
+ */
+bool clockSyncDue();
+
+/**
+ * @brief Join WIFI_SSID and set the clock over SNTP; blocks for up to
+ *        WIFI_CONNECT_TIMEOUT_MS + SCHEDULE_SNTP_TIMEOUT_MS
+ * @return true if the clock was set
+ */
+bool syncClock();
+
+} // namespace Schedule
@@ -5,69 +5,338 @@
 
 #include "sd_card.hpp"
 #include "config.hpp"
+#include "slide_stats.hpp"
+#include "power_stats.hpp"
+#include "boot_profile.hpp"
+#include "sdkconfig.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_vfs_fat.h"
 #include "driver/sdspi_host.h"
 #include "driver/spi_common.h"
+#include "soc/soc_caps.h"
+#if SOC_SDMMC_HOST_SUPPORTED
+#include "driver/sdmmc_host.h"
+#endif
 #include "sdmmc_cmd.h"
+#include "sd_protocol_defs.h"
+#include "ff.h"
+#include "diskio_sdmmc.h"
+#include "esp_heap_caps.h"
+#include "esp_memory_utils.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "../components/Adafruit_BusIO_ESPIDF/SPI.h"
 #include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cctype>
+#include <cerrno>
 #include <cstring>
 #include <string>
 #include <cstdio>
+#include <algorithm>
+#include <memory>
+#include <new>
 
 static const char* TAG_SD = "SDCard";
 
 static bool s_mounted = false;
 static const char* s_mount_point = SD_MOUNT_POINT;
+static sdmmc_card_t* s_card = nullptr;
+static bool s_busSuspended = false;  // suspendBus(): SDSPI device off the bus
 
-bool SDCard::init()
+static constexpr uint32_t SECTOR_SIZE = 512;
+
+#if SOC_SDMMC_HOST_SUPPORTED
+/**
+ * @brief Mount through the SDMMC peripheral (own pins, 1- or 4-bit bus)
+ */
+static esp_err_t mountSDMMC(const esp_vfs_fat_mount_config_t& mount_config, sdmmc_card_t** card)
 {
-    if (s_mounted) {
-        return true;
+    sdmmc_host_t host = SDMMC_HOST_DEFAULT();
+    host.max_freq_khz = SD_SDMMC_FREQ_KHZ;
+
+    sdmmc_slot_config_t slot_config = SDMMC_SLOT_CONFIG_DEFAULT();
+    slot_config.width = SD_SDMMC_BUS_WIDTH;
+#if SOC_SDMMC_USE_GPIO_MATRIX
+    slot_config.clk = static_cast<gpio_num_t>(SD_SDMMC_CLK_PIN);
+    slot_config.cmd = static_cast<gpio_num_t>(SD_SDMMC_CMD_PIN);
+    slot_config.d0 = static_cast<gpio_num_t>(SD_SDMMC_D0_PIN);
+    if (SD_SDMMC_BUS_WIDTH == 4) {
+        slot_config.d1 = static_cast<gpio_num_t>(SD_SDMMC_D1_PIN);
+        slot_config.d2 = static_cast<gpio_num_t>(SD_SDMMC_D2_PIN);
+        slot_config.d3 = static_cast<gpio_num_t>(SD_SDMMC_D3_PIN);
     }
+#endif
+    // Most breakouts rely on these; external 10k pull-ups are still better
+    slot_config.flags |= SDMMC_SLOT_FLAG_INTERNAL_PULLUP;
 
-    ESP_LOGI(TAG_SD, "Initializing SD card...");
+    return esp_vfs_fat_sdmmc_mount(s_mount_point, &host, &slot_config, &mount_config, card);
+}
+#else
+static_assert(!SD_USE_SDMMC, "SD_USE_SDMMC needs a target with an SDMMC host (ESP32, ESP32-S3)");
+#endif
 
-    // Configure SPI bus for SD card
-    // ESP32-C6 only has SPI2_HOST, so we share the SPI bus with the display
-    // Both devices use different CS pins, so they can share the same SPI bus
-    spi_bus_config_t bus_cfg = {
-        .mosi_io_num = SPI_MOSI_PIN,
-        .miso_io_num = SPI_MISO_PIN,
-        .sclk_io_num = SPI_SCK_PIN,
-        .quadwp_io_num = -1,
-        .quadhd_io_num = -1,
-        .max_transfer_sz = 4000,
-    };
+/**
+ * @brief The card's SDSPI device, on the SPI bus shared with the display
+ */
+static sdspi_device_config_t sdspiSlot()
+{
+    sdspi_device_config_t slot_config = SDSPI_DEVICE_CONFIG_DEFAULT();
+    slot_config.gpio_cs = SD_CS_PIN;
+    slot_config.host_id = SPI2_HOST;  // ESP32-C6 only has SPI2_HOST
+    return slot_config;
+}
 
-    // Try to initialize SPI bus (may fail if already initialized by display)
-    // ESP32-C6 only has SPI2_HOST
-    esp_err_t ret = spi_bus_initialize(SPI2_HOST, &bus_cfg, SPI_DMA_CH_AUTO);
-    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
-        ESP_LOGE(TAG_SD, "Failed to initialize SPI bus: %s", esp_err_to_name(ret));
-        return false;
+/**
+ * @brief Mount through SDSPI on the SPI bus shared with the display
+ */
+static esp_err_t mountSDSPI(const esp_vfs_fat_mount_config_t& mount_config, int freqKhz,
+                            sdmmc_card_t** card)
+{
+    // ESP32-C6 only has SPI2_HOST, so we share the SPI bus with the display
+    // Both devices use different CS pins, so they can share the same SPI bus.
+    // SPIClass owns the bus: whichever of the display and the card comes up
+    // first initializes it, with one config, and later calls are no-ops.
+    SPI.begin(SPI_SCK_PIN, SPI_MOSI_PIN, SPI_MISO_PIN);
+    if (!SPI.isInitialized()) {
+        ESP_LOGE(TAG_SD, "Failed to initialize SPI bus");
+        return ESP_ERR_INVALID_STATE;
     }
 
     // Get default SDSPI host configuration
     sdmmc_host_t host = SDSPI_HOST_DEFAULT();
     host.slot = SPI2_HOST;
+    host.max_freq_khz = freqKhz;
 
-    // Configure SD card slot
-    sdspi_device_config_t slot_config = SDSPI_DEVICE_CONFIG_DEFAULT();
-    slot_config.gpio_cs = SD_CS_PIN;
-    slot_config.host_id = SPI2_HOST;  // ESP32-C6 only has SPI2_HOST
+    sdspi_device_config_t slot_config = sdspiSlot();
+    return esp_vfs_fat_sdspi_mount(s_mount_point, &host, &slot_config, &mount_config, card);
+}
+
+/**
+ * @brief Put the card's SDSPI device back on the bus after suspendBus(),
+ *        bringing the bus up first if it was freed; under the SPI burst lock
+ *
+ * The card stayed powered and in SPI mode, so it needs no initialisation:
+ * only the clock it was mounted at and its CRC mode, which the SDSPI host
+ * keeps per device, are set again.
+ */
+static esp_err_t resumeBus()
+{
+    int64_t start = esp_timer_get_time();
+    SPI.begin(SPI_SCK_PIN, SPI_MOSI_PIN, SPI_MISO_PIN);
+    sdspi_device_config_t slot_config = sdspiSlot();
+    sdspi_dev_handle_t handle;
+    esp_err_t ret = SPI.isInitialized() ? sdspi_host_init_device(&slot_config, &handle) :
+                                          ESP_ERR_INVALID_STATE;
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG_SD, "Cannot bring the card back on the bus: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    s_card->host.slot = handle;
+    s_busSuspended = false;
+    sdspi_host_set_card_clk(handle, s_card->real_freq_khz);
+
+    sdmmc_command_t crc = {};
+    crc.opcode = SD_CRC_ON_OFF;
+    crc.arg = 1;
+    crc.flags = SCF_CMD_AC | SCF_RSP_R1;
+    ret = sdspi_host_do_transaction(handle, &crc);
+    ESP_LOGD(TAG_SD, "Card back on the bus in %lld us", (long long)(esp_timer_get_time() - start));
+    return ret;
+}
+
+/**
+ * @brief The mounted card's SDSPI transactions: each one first brings the
+ *        device back if suspendBus() took it off, whichever task it is on
+ */
+static esp_err_t sdspiTransaction(int slot, sdmmc_command_t* cmd)
+{
+    (void)slot;  // Replaced by resumeBus()
+    SPI.lock();
+    esp_err_t ret = s_busSuspended ? resumeBus() : ESP_OK;
+    if (ret == ESP_OK) {
+        ret = sdspi_host_do_transaction(s_card->host.slot, cmd);
+    }
+    SPI.unlock();
+    return ret;
+}
+
+/**
+ * @brief Check that the card reads back reliably at the current clock
+ *
+ * SDSPI checks data CRCs, so a marginal clock shows up as a failed read;
+ * reading the start of the card twice also catches errors the CRC lets
+ * through, and sector 0 must end in the MBR / FAT boot signature.
+ */
+static bool verifyCardReads(sdmmc_card_t* card)
+{
+    size_t bytes = SD_VERIFY_SECTORS * SECTOR_SIZE;
+    uint8_t* data = static_cast<uint8_t*>(heap_caps_malloc(bytes * 2, MALLOC_CAP_DMA));
+    if (!data) {
+        return true;  // Can't tell; the mount itself succeeded
+    }
+
+    bool ok = sdmmc_read_sectors(card, data, 0, SD_VERIFY_SECTORS) == ESP_OK &&
+              sdmmc_read_sectors(card, data + bytes, 0, SD_VERIFY_SECTORS) == ESP_OK &&
+              memcmp(data, data + bytes, bytes) == 0 &&
+              data[510] == 0x55 && data[511] == 0xAA;
+    heap_caps_free(data);
+    return ok;
+}
+
+/**
+ * @brief Last SDSPI clock that worked, and the card (CID serial) it worked for
+ */
+static bool loadSpiClock(uint32_t& freqKhz, uint32_t& serial)
+{
+    nvs_handle_t handle;
+    if (nvs_open(SD_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return false;
+    }
+    bool ok = nvs_get_u32(handle, "spi_khz", &freqKhz) == ESP_OK &&
+              nvs_get_u32(handle, "serial", &serial) == ESP_OK;
+    nvs_close(handle);
+    return ok;
+}
+
+static void storeSpiClock(uint32_t freqKhz, uint32_t serial)
+{
+    nvs_handle_t handle;
+    if (nvs_open(SD_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        return;
+    }
+    if (nvs_set_u32(handle, "spi_khz", freqKhz) != ESP_OK ||
+        nvs_set_u32(handle, "serial", serial) != ESP_OK ||
+        nvs_commit(handle) != ESP_OK) {
+        ESP_LOGW(TAG_SD, "Failed to store SD clock");
+    }
+    nvs_close(handle);
+}
+
+/**
+ * @brief Mount over SDSPI at the fastest clock in SD_SPI_FREQ_STEPS_KHZ that
+ *        reads back reliably
+ *
+ * Starts at the clock stored for this card on an earlier boot, so only a
+ * new card (or one that got worse) pays for the probing.
+ */
+static esp_err_t mountSDSPINegotiated(const esp_vfs_fat_mount_config_t& mount_config,
+                                      sdmmc_card_t** card)
+{
+    uint32_t knownKhz = 0;
+    uint32_t knownSerial = 0;
+    bool known = loadSpiClock(knownKhz, knownSerial);
+
+    size_t first = 0;
+    while (known && first + 1 < NUM_SD_SPI_FREQ_STEPS &&
+           static_cast<uint32_t>(SD_SPI_FREQ_STEPS_KHZ[first]) > knownKhz) {
+        first++;
+    }
+
+    esp_err_t ret = ESP_FAIL;
+    size_t step = first;
+    while (step < NUM_SD_SPI_FREQ_STEPS) {
+        int freqKhz = SD_SPI_FREQ_STEPS_KHZ[step];
+        ret = mountSDSPI(mount_config, freqKhz, card);
+        uint32_t serial = (ret == ESP_OK) ? static_cast<uint32_t>((*card)->cid.serial) : 0;
+        if (ret == ESP_OK && known && step > 0 && serial != knownSerial) {
+            // The stored clock was found for another card; probe this one from the top
+            esp_vfs_fat_sdcard_unmount(s_mount_point, *card);
+            known = false;
+            step = 0;
+            continue;
+        }
+        if (ret == ESP_OK && verifyCardReads(*card)) {
+            ESP_LOGI(TAG_SD, "SD card clock %d kHz", freqKhz);
+            if (!known || knownKhz != static_cast<uint32_t>(freqKhz) || knownSerial != serial) {
+                storeSpiClock(freqKhz, serial);
+            }
+            return ESP_OK;
+        }
+        if (ret == ESP_OK) {
+            esp_vfs_fat_sdcard_unmount(s_mount_point, *card);
+            ret = ESP_ERR_INVALID_CRC;
+        }
+        ESP_LOGW(TAG_SD, "SD card unreliable at %d kHz (%s)", freqKhz, esp_err_to_name(ret));
+        step++;
+    }
+    return ret;
+}
+
+/**
+ * @brief Switch the card's supply (SD_POWER_PIN), if it has a switch
+ *
+ * Off, chip select is driven low too, so the unpowered card isn't fed
+ * through its CS line; the next mount configures CS again.
+ */
+static void setCardPower(bool on)
+{
+    if (SD_POWER_PIN == GPIO_NUM_NC) {
+        return;
+    }
+    gpio_set_direction(SD_POWER_PIN, GPIO_MODE_OUTPUT);
+    gpio_set_level(SD_POWER_PIN, on ? SD_POWER_ON_LEVEL : !SD_POWER_ON_LEVEL);
+    if (on) {
+        vTaskDelay(pdMS_TO_TICKS(SD_POWER_UP_MS));
+    } else if (!SD_USE_SDMMC) {
+        gpio_set_direction(SD_CS_PIN, GPIO_MODE_OUTPUT);
+        gpio_set_level(SD_CS_PIN, 0);
+    }
+}
+
+bool SDCard::hasDetectPin()
+{
+    return SD_DETECT_PIN != GPIO_NUM_NC;
+}
+
+bool SDCard::present()
+{
+    if (SD_DETECT_PIN != GPIO_NUM_NC) {
+        static bool configured = false;
+        if (!configured) {
+            gpio_set_direction(SD_DETECT_PIN, GPIO_MODE_INPUT);
+            gpio_set_pull_mode(SD_DETECT_PIN, SD_DETECT_INSERTED_LEVEL ? GPIO_PULLDOWN_ONLY :
+                                                                         GPIO_PULLUP_ONLY);
+            configured = true;
+        }
+        return gpio_get_level(SD_DETECT_PIN) == SD_DETECT_INSERTED_LEVEL;
+    }
+    // A swapped card comes back uninitialised and doesn't answer CMD13
+    return s_mounted && sdmmc_get_status(s_card) == ESP_OK;
+}
+
+bool SDCard::init()
+{
+    if (s_mounted) {
+        return true;
+    }
+
+    if (SD_DETECT_PIN != GPIO_NUM_NC && !present()) {
+        ESP_LOGW(TAG_SD, "No SD card in the slot");
+        return false;
+    }
+    ESP_LOGI(TAG_SD, "Initializing SD card (%s)...", SD_USE_SDMMC ? "SDMMC" : "SDSPI");
 
     // Mount filesystem
     esp_vfs_fat_sdmmc_mount_config_t mount_config = {
         .format_if_mount_failed = false,
         .max_files = 5,
-        .allocation_unit_size = 16 * 1024,
+        .allocation_unit_size = SD_ALLOCATION_UNIT_SIZE,
         .disk_status_check_enable = false,
         .use_one_fat = false
     };
 
+    setCardPower(true);
     sdmmc_card_t* card;
-    ret = esp_vfs_fat_sdspi_mount(s_mount_point, &host, &slot_config, &mount_config, &card);
+#if SOC_SDMMC_HOST_SUPPORTED
+    esp_err_t ret = SD_USE_SDMMC ? mountSDMMC(mount_config, &card) :
+                                   mountSDSPINegotiated(mount_config, &card);
+#else
+    esp_err_t ret = mountSDSPINegotiated(mount_config, &card);
+#endif
 
     if (ret != ESP_OK) {
         if (ret == ESP_FAIL) {
@@ -77,12 +346,23 @@ bool SDCard::init()
         } else {
             ESP_LOGE(TAG_SD, "Failed to mount SD card: %s", esp_err_to_name(ret));
         }
+        setCardPower(false);
         return false;
     }
 
+#if !CONFIG_FATFS_USE_FASTSEEK
+    ESP_LOGW(TAG_SD, "CONFIG_FATFS_USE_FASTSEEK is off: seeks in large files walk the cluster chain");
+#endif
+
     // Print card info
     sdmmc_card_print_info(stdout, card);
+    s_card = card;
     s_mounted = true;
+    if (!SD_USE_SDMMC) {
+        s_card->host.do_transaction = sdspiTransaction;
+    }
+    PowerStats::set(PowerStats::Load::SD, true);
+    BootProfile::mark(BootProfile::Mark::SD_MOUNTED);
     ESP_LOGI(TAG_SD, "SD card mounted successfully at %s", s_mount_point);
     return true;
 }
@@ -93,9 +373,19 @@ void SDCard::deinit()
         return;
     }
 
-    esp_vfs_fat_sdcard_unmount(s_mount_point, nullptr);
-    spi_bus_free(SPI2_HOST);
+    // The unmount removes the SDSPI device, so it has to be on the bus.
+    // The SPI bus stays up: the display is still on it
+    SPI.lock();
+    if (s_busSuspended) {
+        resumeBus();
+    }
+    s_busSuspended = false;
+    esp_vfs_fat_sdcard_unmount(s_mount_point, s_card);
+    SPI.unlock();
+    s_card = nullptr;
     s_mounted = false;
+    setCardPower(false);
+    PowerStats::set(PowerStats::Load::SD, false);
     ESP_LOGI(TAG_SD, "SD card unmounted");
 }
 
@@ -104,88 +394,1264 @@ bool SDCard::isMounted()
     return s_mounted;
 }
 
-size_t SDCard::scanForImages(const char* directory, std::vector<std::string>& imageFiles)
+sdmmc_card_t* SDCard::card()
 {
-    imageFiles.clear();
+    return s_mounted ? s_card : nullptr;
+}
 
-    if (!s_mounted) {
-        ESP_LOGE(TAG_SD, "SD card not mounted");
-        return 0;
+bool SDCard::suspendBus()
+{
+    if (SD_USE_SDMMC || !s_mounted) {
+        return true;
     }
+    SPI.lock();
+    if (!s_busSuspended && sdspi_host_remove_device(s_card->host.slot) == ESP_OK) {
+        s_busSuspended = true;
+    }
+    SPI.unlock();
+    return s_busSuspended;
+}
 
-    DIR* dir = opendir(directory);
-    if (dir == nullptr) {
-        ESP_LOGE(TAG_SD, "Failed to open directory: %s", directory);
-        return 0;
+SDCard::BusBurst::BusBurst()
+    : held_(!SD_USE_SDMMC && SPI.lock())
+{
+}
+
+SDCard::BusBurst::~BusBurst()
+{
+    if (held_) {
+        SPI.unlock();
     }
+}
 
-    struct dirent* entry;
-    size_t count = 0;
+namespace {
 
-    while ((entry = readdir(dir)) != nullptr && count < MAX_IMAGE_FILES) {
-        // Skip . and ..
-        if (entry->d_name[0] == '.') {
-            continue;
-        }
+/**
+ * @brief On-card image list, so boot doesn't have to readdir + stat
+ *
+ * Header, then one record per directory scanned, one entry per image, the
+ * images' NUL-terminated paths (relative to the image directory) in list
+ * (natural) order, and the directories' relative paths, "" for the image
+ * directory itself. All fields are little-endian. The sort happens when
+ * the index is built; loading it compares no names.
+ */
+#pragma pack(push, 1)
+struct ImageIndexHeader {
+    uint32_t magic;         // IMAGE_INDEX_MAGIC ("IIDX")
+    uint16_t version;       // IMAGE_INDEX_VERSION
+    uint16_t dirCount;      // Directory records
+    uint32_t count;         // Number of entries
+    uint32_t configHash;    // Directory path, extensions, limits, probed
+    uint32_t namesSize;     // Bytes of image paths after the entries
+    uint32_t dirNamesSize;  // Bytes of directory paths after the image paths
+};
 
-        // Check file extension
-        std::string filename(entry->d_name);
-        bool isImage = false;
-        for (size_t i = 0; i < NUM_IMAGE_EXTENSIONS; i++) {
-            if (filename.length() >= strlen(IMAGE_EXTENSIONS[i])) {
-                std::string ext = filename.substr(filename.length() - strlen(IMAGE_EXTENSIONS[i]));
-                if (ext == IMAGE_EXTENSIONS[i]) {
-                    isImage = true;
-                    break;
-                }
-            }
-        }
+struct ImageIndexDir {
+    int64_t  mtime;       // Directory mtime when it was last read
+    uint32_t nameOffset;  // Its path in the directory path block
+    uint16_t parent;      // Record of the directory holding it, NO_PARENT for the root
+    uint16_t reserved;
+};
+
+struct ImageIndexEntry {
+    int32_t  size;           // File size in bytes
+    uint32_t stamp;          // FAT modification date << 16 | time
+    SDCard::ImageInfo info;  // Header as probed, all zero if not
+    uint16_t dir;            // Record of the directory holding the file
+    uint16_t reserved;
+};
+#pragma pack(pop)
+
+constexpr uint32_t IMAGE_INDEX_MAGIC = 0x58444949;  // "IIDX" little-endian
+constexpr uint16_t IMAGE_INDEX_VERSION = 4;         // 3: natural order, 4: directory tree
+constexpr uint16_t NO_PARENT = 0xFFFF;
+
+/**
+ * @brief What the index records besides the image list itself
+ */
+struct ImageIndex {
+    struct Dir {
+        std::string path;  // Relative to the image directory, "" for itself
+        int64_t mtime;
+        uint16_t parent;
+    };
+    struct File {
+        int32_t size;
+        uint32_t stamp;
+        uint16_t dir;
+    };
+    std::vector<Dir> dirs;
+    std::vector<File> files;  // One per image, in list order
+};
+
+uint32_t fnv1a(uint32_t hash, const void* data, size_t len)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/** @brief Hash of everything besides the directories that decides the list */
+uint32_t indexConfigHash(const char* directory, bool probed)
+{
+    uint32_t hash = fnv1a(2166136261u, directory, strlen(directory) + 1);
+    for (size_t i = 0; i < NUM_IMAGE_EXTENSIONS; i++) {
+        hash = fnv1a(hash, IMAGE_EXTENSIONS[i], strlen(IMAGE_EXTENSIONS[i]) + 1);
+    }
+    uint32_t limits[3] = { MAX_IMAGE_FILES, IMAGE_SCAN_MAX_DEPTH, IMAGE_SCAN_MAX_DIRECTORIES };
+    hash = fnv1a(hash, limits, sizeof(limits));
+    // An unprobed list may still hold files a probe would drop
+    return fnv1a(hash, &probed, sizeof(probed));
+}
+
+/** @brief Directory mtime; adding, removing or renaming a file changes it */
+bool directoryStamp(const char* directory, int64_t& mtime)
+{
+    struct stat st;
+    if (stat(directory, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        return false;
+    }
+    mtime = static_cast<int64_t>(st.st_mtime);
+    return true;
+}
+
+/**
+ * @brief Full path of a directory or file given relative to the image directory
+ */
+bool joinPath(const char* directory, const char* relative, char* out, size_t outSize)
+{
+    int len = snprintf(out, outSize, "%s%s%s", directory, relative[0] ? "/" : "", relative);
+    return len >= 0 && static_cast<size_t>(len) < outSize;
+}
+
+void indexPath(char* out, size_t outSize)
+{
+    snprintf(out, outSize, "%s/%s", IMAGE_CACHE_DIRECTORY, IMAGE_INDEX_FILE);
+}
+
+/**
+ * @brief Load the image list and its directory records from the index, in
+ *        one read; the caller checks whether the directories changed since
+ * @return false if the index is missing, damaged or built for other settings
+ */
+bool loadImageIndex(const char* directory, bool probed, SDCard::ImageList& images,
+                    ImageIndex& index)
+{
+    char path[64];
+    indexPath(path, sizeof(path));
+
+    SDCard::BusBurst burst;
+    int32_t fileSize = -1;
+    FILE* file = SDCard::openFile(path, &fileSize);
+    if (!file) {
+        return false;
+    }
+    std::unique_ptr<uint8_t[]> data;
+    if (fileSize >= static_cast<int32_t>(sizeof(ImageIndexHeader))) {
+        data.reset(new (std::nothrow) uint8_t[fileSize]);
+    }
+    bool ok = data && fread(data.get(), 1, fileSize, file) == static_cast<size_t>(fileSize);
+    fclose(file);
+    if (!ok) {
+        return false;
+    }
+
+    ImageIndexHeader header;
+    memcpy(&header, data.get(), sizeof(header));
+    size_t dirsSize = static_cast<size_t>(header.dirCount) * sizeof(ImageIndexDir);
+    size_t entriesSize = static_cast<size_t>(header.count) * sizeof(ImageIndexEntry);
+    if (header.magic != IMAGE_INDEX_MAGIC || header.version != IMAGE_INDEX_VERSION ||
+        header.configHash != indexConfigHash(directory, probed) || header.dirCount == 0 ||
+        sizeof(header) + dirsSize + entriesSize + header.namesSize + header.dirNamesSize !=
+            static_cast<size_t>(fileSize)) {
+        return false;
+    }
 
-        if (isImage) {
-            std::string fullPath = std::string(directory) + "/" + filename;
-            imageFiles.push_back(fullPath);
-            count++;
+    // The name block is already in ImageList's layout
+    const uint8_t* dirs = data.get() + sizeof(header);
+    const uint8_t* entries = dirs + dirsSize;
+    const char* names = reinterpret_cast<const char*>(entries + entriesSize);
+    const char* dirNames = names + header.namesSize;
+    if (!images.assign(names, header.namesSize, header.count) ||
+        header.dirNamesSize == 0 || dirNames[header.dirNamesSize - 1] != '\0') {
+        images.reset(directory);
+        return false;
+    }
+    index.dirs.resize(header.dirCount);
+    for (size_t i = 0; i < index.dirs.size(); i++) {
+        ImageIndexDir dir;
+        memcpy(&dir, dirs + i * sizeof(dir), sizeof(dir));
+        if (dir.nameOffset >= header.dirNamesSize ||
+            (dir.parent != NO_PARENT && dir.parent >= header.dirCount)) {
+            images.reset(directory);
+            return false;
         }
+        index.dirs[i] = { dirNames + dir.nameOffset, dir.mtime, dir.parent };
     }
+    index.files.resize(images.size());
+    for (size_t i = 0; i < images.size(); i++) {
+        ImageIndexEntry entry;
+        memcpy(&entry, entries + i * sizeof(entry), sizeof(entry));
+        images.setInfo(i, entry.info);
+        index.files[i] = { entry.size, entry.stamp, entry.dir };
+    }
+    return true;
+}
 
-    closedir(dir);
-    ESP_LOGI(TAG_SD, "Found %zu image files in %s", count, directory);
-    return count;
+/**
+ * @brief Whether no directory in the index has changed since it was read
+ */
+bool indexCurrent(const char* directory, const ImageIndex& index)
+{
+    char path[SDCard::ImageList::MAX_PATH];
+    for (const ImageIndex::Dir& dir : index.dirs) {
+        int64_t mtime = 0;
+        if (!joinPath(directory, dir.path.c_str(), path, sizeof(path)) ||
+            !directoryStamp(path, mtime) || mtime != dir.mtime) {
+            return false;
+        }
+    }
+    return true;
 }
 
-int32_t SDCard::readFile(const char* filepath, uint8_t* buffer, size_t maxSize)
+/**
+ * @brief Write the index for a freshly scanned, sorted list (best effort)
+ */
+void storeImageIndex(bool probed, const SDCard::ImageList& images, const ImageIndex& index)
 {
-    if (!s_mounted || !buffer || maxSize == 0) {
-        return -1;
+    if (!SDCard::makeDirectory(IMAGE_CACHE_DIRECTORY)) {
+        return;
     }
 
-    FILE* file = fopen(filepath, "rb");
-    if (file == nullptr) {
-        ESP_LOGE(TAG_SD, "Failed to open file: %s", filepath);
-        return -1;
+    std::string dirNames;
+    std::vector<ImageIndexDir> dirs(index.dirs.size());
+    for (size_t i = 0; i < dirs.size(); i++) {
+        dirs[i] = { index.dirs[i].mtime, static_cast<uint32_t>(dirNames.size()),
+                    index.dirs[i].parent, 0 };
+        dirNames.append(index.dirs[i].path.c_str(), index.dirs[i].path.size() + 1);
     }
 
-    size_t bytesRead = fread(buffer, 1, maxSize, file);
-    fclose(file);
+    ImageIndexHeader header = {};
+    header.magic = IMAGE_INDEX_MAGIC;
+    header.version = IMAGE_INDEX_VERSION;
+    header.dirCount = static_cast<uint16_t>(dirs.size());
+    header.count = static_cast<uint32_t>(images.size());
+    header.configHash = indexConfigHash(images.directory(), probed);
+    header.namesSize = static_cast<uint32_t>(images.namesSize());
+    header.dirNamesSize = static_cast<uint32_t>(dirNames.size());
 
-    return static_cast<int32_t>(bytesRead);
+    char path[64];
+    char tmpPath[64];
+    indexPath(path, sizeof(path));
+    snprintf(tmpPath, sizeof(tmpPath), "%s/INDEX.TMP", IMAGE_CACHE_DIRECTORY);
+
+    FILE* file = fopen(tmpPath, "wb");
+    if (!file) {
+        ESP_LOGW(TAG_SD, "Cannot write image index");
+        return;
+    }
+
+    bool ok = fwrite(&header, 1, sizeof(header), file) == sizeof(header) &&
+              fwrite(dirs.data(), sizeof(ImageIndexDir), dirs.size(), file) == dirs.size();
+    for (size_t i = 0; i < images.size() && ok; i++) {
+        const ImageIndex::File& stamp = index.files[i];
+        ImageIndexEntry entry = { stamp.size, stamp.stamp, images.info(i), stamp.dir, 0 };
+        ok = fwrite(&entry, 1, sizeof(entry), file) == sizeof(entry);
+    }
+    ok = ok && fwrite(images.names(), 1, images.namesSize(), file) == images.namesSize();
+    ok = ok && fwrite(dirNames.data(), 1, dirNames.size(), file) == dirNames.size();
+    ok = (fclose(file) == 0) && ok;
+
+    // Replace the old index only once the new one is complete
+    remove(path);
+    if (!ok || rename(tmpPath, path) != 0) {
+        ESP_LOGW(TAG_SD, "Failed to store image index");
+        remove(tmpPath);
+        return;
+    }
+    ESP_LOGI(TAG_SD, "Image index updated (%zu files in %zu directories)",
+             images.size(), dirs.size());
 }
 
-int32_t SDCard::getFileSize(const char* filepath)
+/**
+ * @brief Natural order: digit runs compare by value ("img2" before
+ *        "img10"), letters without case; ties fall back to byte order
+ */
+bool naturalLess(const char* a, const char* b)
 {
-    if (!s_mounted) {
-        return -1;
+    const char* x = a;
+    const char* y = b;
+    while (*x && *y) {
+        if (isdigit(static_cast<unsigned char>(*x)) && isdigit(static_cast<unsigned char>(*y))) {
+            while (*x == '0') {
+                x++;
+            }
+            while (*y == '0') {
+                y++;
+            }
+            size_t xDigits = 0;
+            size_t yDigits = 0;
+            while (isdigit(static_cast<unsigned char>(x[xDigits]))) {
+                xDigits++;
+            }
+            while (isdigit(static_cast<unsigned char>(y[yDigits]))) {
+                yDigits++;
+            }
+            if (xDigits != yDigits) {
+                return xDigits < yDigits;
+            }
+            int order = memcmp(x, y, xDigits);
+            if (order != 0) {
+                return order < 0;
+            }
+            x += xDigits;
+            y += yDigits;
+            continue;
+        }
+        int cx = tolower(static_cast<unsigned char>(*x));
+        int cy = tolower(static_cast<unsigned char>(*y));
+        if (cx != cy) {
+            return cx < cy;
+        }
+        x++;
+        y++;
+    }
+    if (*x || *y) {
+        return *y != '\0';
     }
+    // Equal but for case or leading zeros ("a01", "A1")
+    return strcmp(a, b) < 0;
+}
 
-    FILE* file = fopen(filepath, "rb");
-    if (file == nullptr) {
-        return -1;
+bool hasImageExtension(const char* name)
+{
+    size_t nameLen = strlen(name);
+    for (size_t i = 0; i < NUM_IMAGE_EXTENSIONS; i++) {
+        size_t extLen = strlen(IMAGE_EXTENSIONS[i]);
+        if (nameLen >= extLen && strcmp(name + nameLen - extLen, IMAGE_EXTENSIONS[i]) == 0) {
+            return true;
+        }
     }
+    return false;
+}
 
-    fseek(file, 0, SEEK_END);
-    long size = ftell(file);
-    fclose(file);
+/**
+ * @brief Map a VFS path under the mount point to a FatFs path ("0:/images")
+ */
+bool toFatPath(const char* path, char* out, size_t outSize)
+{
+    size_t mountLen = strlen(s_mount_point);
+    if (strncmp(path, s_mount_point, mountLen) != 0 ||
+        (path[mountLen] != '/' && path[mountLen] != '\0')) {
+        return false;
+    }
+    BYTE pdrv = ff_diskio_get_pdrv_card(s_card);
+    if (pdrv == 0xFF) {
+        return false;
+    }
+    const char* rest = path[mountLen] ? path + mountLen : "/";
+    int len = snprintf(out, outSize, "%u:%s", static_cast<unsigned>(pdrv), rest);
+    return len >= 0 && static_cast<size_t>(len) < outSize;
+}
+
+/**
+ * @brief One pass over the image directory tree, reusing what the previous
+ *        index knew about directories that haven't changed
+ */
+struct TreeScan {
+    const char* root;
+    SDCard::ImageProbe probe;
+    const SDCard::ImageList* oldImages;  // nullptr without a usable index
+    const ImageIndex* old;
+    std::vector<std::vector<uint32_t>> oldFiles;     // Old images per old directory, by name
+    std::vector<std::vector<uint16_t>> oldChildren;  // Old subdirectories per old directory
+    SDCard::ImageList& images;
+    ImageIndex& index;
+    size_t reused = 0;   // Directories taken from the old index
+    size_t read = 0;     // Directories read from the card
+    size_t dropped = 0;  // Files the probe rejected
+};
+
+/**
+ * @brief Add an image found in a directory that was read again; a file the
+ *        old index holds with the same size and date keeps its header info
+ */
+void addScannedFile(TreeScan& scan, const char* path, const ImageIndex::File& file,
+                    const std::vector<uint32_t>& known)
+{
+    SDCard::ImageInfo header = {};
+    auto it = std::lower_bound(known.begin(), known.end(), path,
+                               [&scan](uint32_t i, const char* name) {
+                                   return strcmp(scan.oldImages->name(i), name) < 0;
+                               });
+    if (it != known.end() && strcmp(scan.oldImages->name(*it), path) == 0 &&
+        scan.old->files[*it].size == file.size && scan.old->files[*it].stamp == file.stamp) {
+        header = scan.oldImages->info(*it);
+    } else if (scan.probe) {
+        char fullPath[SDCard::ImageList::MAX_PATH];
+        if (!joinPath(scan.root, path, fullPath, sizeof(fullPath)) ||
+            !scan.probe(fullPath, header)) {
+            ESP_LOGW(TAG_SD, "Skipping %s: unsupported or damaged", path);
+            scan.dropped++;
+            return;
+        }
+    }
+    scan.images.add(path, header);
+    scan.index.files.push_back(file);
+}
+
+/**
+ * @brief Read a changed directory: its images, and the subdirectories to visit
+ * @param subdirs Receives the subdirectories' paths, as names in an arena
+ */
+void readDirectory(TreeScan& scan, const char* fullPath, const char* path, uint16_t dir,
+                   int oldDir, SDCard::ImageList& subdirs)
+{
+    char fatPath[SDCard::ImageList::MAX_PATH];
+    std::unique_ptr<FF_DIR> handle(new (std::nothrow) FF_DIR);
+    std::unique_ptr<FILINFO> info(new (std::nothrow) FILINFO);
+    if (!handle || !info || !toFatPath(fullPath, fatPath, sizeof(fatPath)) ||
+        f_opendir(handle.get(), fatPath) != FR_OK) {
+        ESP_LOGE(TAG_SD, "Failed to open directory: %s", fullPath);
+        return;
+    }
+    // Probing opens files, so the directory is read to the end first; the
+    // names wait in a list of their own (an arena, no string per file)
+    SDCard::ImageList names;
+    std::vector<ImageIndex::File> files;
+    names.reset("");
+    while (f_readdir(handle.get(), info.get()) == FR_OK && info->fname[0] != '\0') {
+        if (info->fname[0] == '.') {
+            continue;
+        }
+        char child[SDCard::ImageList::MAX_PATH];
+        int len = snprintf(child, sizeof(child), "%s%s%s", path, path[0] ? "/" : "", info->fname);
+        if (len < 0 || static_cast<size_t>(len) >= sizeof(child)) {
+            continue;
+        }
+        if (info->fattrib & AM_DIR) {
+            subdirs.add(child);
+        } else if (hasImageExtension(info->fname) && names.size() < MAX_IMAGE_FILES) {
+            names.add(child);
+            files.push_back({ static_cast<int32_t>(info->fsize),
+                              static_cast<uint32_t>(info->fdate) << 16 | info->ftime, dir });
+        }
+    }
+    f_closedir(handle.get());
 
-    return static_cast<int32_t>(size);
+    static const std::vector<uint32_t> none;
+    const std::vector<uint32_t>& known = oldDir >= 0 ? scan.oldFiles[oldDir] : none;
+    for (size_t i = 0; i < names.size() && scan.images.size() < MAX_IMAGE_FILES; i++) {
+        addScannedFile(scan, names.name(i), files[i], known);
+    }
 }
 
+/**
+ * @brief Visit a directory and, up to IMAGE_SCAN_MAX_DEPTH, the ones in it
+ */
+void scanTree(TreeScan& scan, const char* path, uint16_t parent, size_t depth)
+{
+    char fullPath[SDCard::ImageList::MAX_PATH];
+    int64_t mtime = 0;
+    if (scan.index.dirs.size() >= IMAGE_SCAN_MAX_DIRECTORIES ||
+        scan.images.size() >= MAX_IMAGE_FILES ||
+        !joinPath(scan.root, path, fullPath, sizeof(fullPath)) ||
+        !directoryStamp(fullPath, mtime)) {
+        return;
+    }
+    uint16_t dir = static_cast<uint16_t>(scan.index.dirs.size());
+    scan.index.dirs.push_back({ path, mtime, parent });
+
+    int oldDir = -1;
+    for (size_t i = 0; scan.old && i < scan.old->dirs.size(); i++) {
+        if (scan.old->dirs[i].path == path) {
+            oldDir = static_cast<int>(i);
+            break;
+        }
+    }
+
+    SDCard::ImageList subdirs;
+    subdirs.reset("");
+    if (oldDir >= 0 && scan.old->dirs[oldDir].mtime == mtime) {
+        // Unchanged: same files, same subdirectories (which are checked on their own)
+        scan.reused++;
+        for (uint32_t i : scan.oldFiles[oldDir]) {
+            if (scan.images.size() >= MAX_IMAGE_FILES) {
+                break;
+            }
+            scan.images.add(scan.oldImages->name(i), scan.oldImages->info(i));
+            scan.index.files.push_back({ scan.old->files[i].size, scan.old->files[i].stamp, dir });
+        }
+        for (uint16_t child : scan.oldChildren[oldDir]) {
+            subdirs.add(scan.old->dirs[child].path.c_str());
+        }
+    } else {
+        scan.read++;
+        readDirectory(scan, fullPath, path, dir, oldDir, subdirs);
+    }
+
+    if (depth < IMAGE_SCAN_MAX_DEPTH) {
+        for (size_t i = 0; i < subdirs.size(); i++) {
+            scanTree(scan, subdirs.name(i), dir, depth + 1);
+        }
+    }
+}
+
+} // namespace
+
+/**
+ * FF_DIR holds the complete read position (cluster, sector, entry offset)
+ * and no heap state, so a copy taken between two f_readdir() calls resumes
+ * from exactly that entry while the volume stays mounted. IDF's seekdir()
+ * can't be used for this: it rewinds and re-reads up to the offset.
+ */
+struct SDCard::ImageCursor::State {
+    std::string directory;
+    FF_DIR dir;                       // Live read position
+    FILINFO info;                     // Last entry read
+    size_t position = 0;              // Index of the image the next read returns
+    std::vector<FF_DIR> checkpoints;  // Position before image k * CHECKPOINT_INTERVAL
+
+    /** @brief Advance to the next image entry; info holds its name */
+    bool readNext()
+    {
+        while (f_readdir(&dir, &info) == FR_OK && info.fname[0] != '\0') {
+            if (info.fname[0] == '.' || (info.fattrib & AM_DIR)) {
+                continue;
+            }
+            if (hasImageExtension(info.fname)) {
+                position++;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+SDCard::ImageCursor::ImageCursor() = default;
+
+SDCard::ImageCursor::~ImageCursor()
+{
+    close();
+}
+
+bool SDCard::ImageCursor::open(const char* directory)
+{
+    close();
+
+    if (!s_mounted) {
+        ESP_LOGE(TAG_SD, "SD card not mounted");
+        return false;
+    }
+
+    char fatPath[ImageList::MAX_PATH];
+    std::unique_ptr<State> state(new (std::nothrow) State);
+    if (!state || !toFatPath(directory, fatPath, sizeof(fatPath)) ||
+        f_opendir(&state->dir, fatPath) != FR_OK) {
+        ESP_LOGE(TAG_SD, "Failed to open directory: %s", directory);
+        return false;
+    }
+    state->directory = directory;
+
+    // Snapshot before the read that returns image 0, INTERVAL, 2 * INTERVAL...
+    do {
+        if (state->position % CHECKPOINT_INTERVAL == 0 &&
+            state->checkpoints.size() == state->position / CHECKPOINT_INTERVAL) {
+            state->checkpoints.push_back(state->dir);
+        }
+    } while (state->readNext());
+
+    count_ = state->position;
+    state->dir = state->checkpoints[0];
+    state->position = 0;
+    state_ = std::move(state);
+
+    ESP_LOGI(TAG_SD, "Found %zu image files in %s (%zu checkpoints)",
+             count_, directory, state_->checkpoints.size());
+    return true;
+}
+
+void SDCard::ImageCursor::close()
+{
+    if (state_) {
+        f_closedir(&state_->dir);
+        state_.reset();
+    }
+    count_ = 0;
+}
+
+uint32_t SDCard::ImageCursor::checksum() const
+{
+    if (!state_) {
+        return 0;
+    }
+    uint32_t hash = fnv1a(2166136261u, state_->directory.c_str(), state_->directory.size() + 1);
+    uint32_t count = count_;
+    return fnv1a(hash, &count, sizeof(count));
+}
+
+bool SDCard::ImageCursor::path(size_t index, char* out, size_t outSize)
+{
+    if (!state_ || index >= count_) {
+        return false;
+    }
+
+    // Read forward from where we are if that's no further than from the
+    // checkpoint; otherwise jump to the checkpoint
+    size_t checkpoint = index / CHECKPOINT_INTERVAL;
+    if (index + 1 == state_->position) {
+        // Same image as the last lookup; info still holds its name
+    } else if (index < state_->position ||
+               checkpoint > state_->position / CHECKPOINT_INTERVAL) {
+        state_->dir = state_->checkpoints[checkpoint];
+        state_->position = checkpoint * CHECKPOINT_INTERVAL;
+    }
+    while (state_->position <= index) {
+        if (!state_->readNext()) {
+            state_->position = SIZE_MAX;  // Unknown; the next lookup re-seeks
+            return false;
+        }
+    }
+
+    int len = snprintf(out, outSize, "%s/%s", state_->directory.c_str(), state_->info.fname);
+    return len >= 0 && static_cast<size_t>(len) < outSize;
+}
+
+SDCard::ImagePack::~ImagePack()
+{
+    close();
+}
+
+bool SDCard::imagePackHeaderValid(const ImagePackHeader& header)
+{
+    return header.magic == IMAGE_PACK_MAGIC &&
+           (header.version == IMAGE_PACK_VERSION || (header.version == 1 && header.variants == 0)) &&
+           header.variants <= IMAGE_PACK_MAX_VARIANTS &&
+           header.entryCount > 0 && header.entryCount % imagePackVariants(header) == 0 &&
+           header.entryCount / imagePackVariants(header) <= MAX_IMAGE_FILES;
+}
+
+void SDCard::selectImagePackVariants(const ImagePackHeader& header,
+                                     std::vector<ImagePackEntry>& entries, uint8_t panel)
+{
+    size_t variants = imagePackVariants(header);
+    if (variants == 1) {
+        return;
+    }
+    size_t slides = entries.size() / variants;
+    for (size_t slide = 0; slide < slides; slide++) {
+        // Row slide starts at or past entry slide, so no row still to come is overwritten
+        const ImagePackEntry* row = &entries[slide * variants];
+        size_t pick = 0;
+        for (size_t v = 0; v < variants; v++) {
+            if (row[v].panel == panel) {
+                pick = v;
+                break;
+            }
+            if (row[v].panel == 0 && row[pick].panel != 0) {
+                pick = v;
+            }
+        }
+        entries[slide] = row[pick];
+    }
+    entries.resize(slides);
+}
+
+bool SDCard::ImagePack::open(const char* filepath, uint8_t panel)
+{
+    close();
+
+    int32_t fileSize = -1;
+    FILE* file = openFile(filepath, &fileSize);
+    if (!file) {
+        return false;
+    }
+
+    ImagePackHeader header;
+    bool ok = fread(&header, 1, sizeof(header), file) == sizeof(header) &&
+              imagePackHeaderValid(header) && fileSize > 0 &&
+              header.indexOffset + uint64_t(header.entryCount) * sizeof(ImagePackEntry) <=
+                  static_cast<uint64_t>(fileSize);
+    if (!ok) {
+        ESP_LOGE(TAG_SD, "Invalid image pack header: %s", filepath);
+        fclose(file);
+        return false;
+    }
+
+    std::vector<ImagePackEntry> entries(header.entryCount);
+    {
+        BusBurst burst;
+        size_t bytes = entries.size() * sizeof(ImagePackEntry);
+        ok = fseek(file, header.indexOffset, SEEK_SET) == 0 &&
+             fread(entries.data(), 1, bytes, file) == bytes;
+    }
+    for (size_t i = 0; ok && i < entries.size(); i++) {
+        ok = uint64_t(entries[i].offset) + entries[i].length <= static_cast<uint64_t>(fileSize);
+    }
+    if (!ok) {
+        ESP_LOGE(TAG_SD, "Invalid image pack table: %s", filepath);
+        fclose(file);
+        return false;
+    }
+
+    // A thumbnail table cut short is dropped; the slides still show
+    size_t thumbBytes = imagePackThumbBytes(header);
+    thumbWidth_ = thumbHeight_ = 0;
+    if (thumbBytes != 0) {
+        uint32_t slides = header.entryCount / imagePackVariants(header);
+        if (imagePackThumbOffset(header) + uint64_t(slides) * thumbBytes <=
+            static_cast<uint64_t>(fileSize)) {
+            thumbOffset_ = static_cast<uint32_t>(imagePackThumbOffset(header));
+            thumbWidth_ = header.thumbWidth;
+            thumbHeight_ = header.thumbHeight;
+        } else {
+            ESP_LOGW(TAG_SD, "Image pack thumbnails truncated: %s", filepath);
+        }
+    }
+
+    selectImagePackVariants(header, entries, panel);
+    file_ = file;
+    entries_ = std::move(entries);
+    fileSize_ = static_cast<uint32_t>(fileSize);
+    if (IMAGE_PACK_DIRECT_READS) {
+        openDirect(filepath);
+    }
+    ESP_LOGI(TAG_SD, "Opened image pack %s: %zu images, %u variant(s), thumbnails %ux%u, %s reads",
+             filepath, entries_.size(), static_cast<unsigned>(imagePackVariants(header)),
+             thumbWidth_, thumbHeight_, direct() ? "sector" : "file");
+    return true;
+}
+
+/**
+ * @brief Find the card sector a pack in one run of clusters starts at, and
+ *        allocate the window for reads around it
+ */
+bool SDCard::ImagePack::openDirect(const char* filepath)
+{
+    bool contiguous = false;
+    if (esp_vfs_fat_test_contiguous_file(s_mount_point, filepath, &contiguous) != ESP_OK ||
+        !contiguous) {
+        ESP_LOGI(TAG_SD, "Image pack is fragmented");
+        return false;
+    }
+
+    // FatFs sector numbers are the card's: the SD diskio passes them through
+    char fatPath[64];
+    FIL fil;
+    if (!toFatPath(filepath, fatPath, sizeof(fatPath)) || f_open(&fil, fatPath, FA_READ) != FR_OK) {
+        return false;
+    }
+    const FATFS* fs = fil.obj.fs;
+    uint64_t sector = fs->database + uint64_t(fil.obj.sclust - 2) * fs->csize;
+    uint64_t end = sector + (fileSize_ + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    bool ok = fil.obj.sclust >= 2 && s_card->csd.sector_size == SECTOR_SIZE &&
+              end <= static_cast<uint64_t>(s_card->csd.capacity);
+    f_close(&fil);
+    if (!ok) {
+        return false;
+    }
+
+    window_ = static_cast<uint8_t*>(heap_caps_malloc(IMAGE_PACK_DIRECT_WINDOW, MALLOC_CAP_DMA));
+    if (!window_) {
+        ESP_LOGW(TAG_SD, "No DMA memory for sector reads of the image pack");
+        return false;
+    }
+    startSector_ = static_cast<uint32_t>(sector);
+    windowBytes_ = 0;
+    return true;
+}
+
+void SDCard::ImagePack::close()
+{
+    if (file_) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+    std::vector<ImagePackEntry>().swap(entries_);
+    thumbWidth_ = thumbHeight_ = 0;
+    heap_caps_free(window_);
+    window_ = nullptr;
+    windowBytes_ = 0;
+}
+
+/**
+ * @brief Read the sectors around a file offset into the window
+ */
+bool SDCard::ImagePack::fillWindow(uint32_t offset)
+{
+    // The file ends in a whole cluster, so its last sector can be read whole
+    windowOffset_ = offset / SECTOR_SIZE * SECTOR_SIZE;
+    uint32_t left = fileSize_ - windowOffset_;
+    size_t sectors = std::min<size_t>(IMAGE_PACK_DIRECT_WINDOW, left + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    windowBytes_ = 0;
+    if (sdmmc_read_sectors(s_card, window_, startSector_ + windowOffset_ / SECTOR_SIZE,
+                           sectors) != ESP_OK) {
+        ESP_LOGE(TAG_SD, "Image pack sector read failed at %u", static_cast<unsigned>(offset));
+        return false;
+    }
+    windowBytes_ = std::min<uint32_t>(sectors * SECTOR_SIZE, left);
+    return true;
+}
+
+size_t SDCard::ImagePack::read(uint32_t offset, void* dst, size_t len)
+{
+    BusBurst burst;
+    if (!direct()) {
+        if (!file_ || fseek(file_, offset, SEEK_SET) != 0) {
+            return 0;
+        }
+        return fread(dst, 1, len, file_);
+    }
+    if (!s_mounted || offset >= fileSize_) {
+        return 0;
+    }
+    len = std::min<size_t>(len, fileSize_ - offset);
+
+    uint8_t* out = static_cast<uint8_t*>(dst);
+    size_t done = 0;
+    while (done < len) {
+        uint32_t at = offset + static_cast<uint32_t>(done);
+        size_t left = len - done;
+        if (at >= windowOffset_ && at < windowOffset_ + windowBytes_) {
+            size_t n = std::min<size_t>(left, windowOffset_ + windowBytes_ - at);
+            memcpy(out + done, window_ + (at - windowOffset_), n);
+            done += n;
+            continue;
+        }
+        // Whole sectors go straight into a buffer DMA can reach
+        size_t sectors = left / SECTOR_SIZE;
+        uint8_t* to = out + done;
+        if (at % SECTOR_SIZE == 0 && sectors > 0 && esp_ptr_dma_capable(to) &&
+            reinterpret_cast<uintptr_t>(to) % 4 == 0) {
+            if (sdmmc_read_sectors(s_card, to, startSector_ + at / SECTOR_SIZE, sectors) != ESP_OK) {
+                ESP_LOGE(TAG_SD, "Image pack sector read failed at %u", static_cast<unsigned>(at));
+                break;
+            }
+            done += sectors * SECTOR_SIZE;
+            continue;
+        }
+        if (!fillWindow(at)) {
+            break;
+        }
+    }
+    return done;
+}
+
+uint32_t SDCard::ImagePack::checksum() const
+{
+    return fnv1a(2166136261u, entries_.data(), entries_.size() * sizeof(ImagePackEntry));
+}
+
+FILE* SDCard::ImagePack::seek(size_t index)
+{
+    SlideStats::Timer timer(SlideStats::Stage::OPEN);
+    if (!file_ || index >= entries_.size() ||
+        fseek(file_, entries_[index].offset, SEEK_SET) != 0) {
+        return nullptr;
+    }
+    return file_;
+}
+
+bool SDCard::ImagePack::readThumbnail(size_t index, uint8_t* out)
+{
+    size_t bytes = (thumbWidth_ + 7) / 8 * size_t(thumbHeight_);
+    if (!file_ || bytes == 0 || index >= entries_.size()) {
+        return false;
+    }
+    return read(static_cast<uint32_t>(thumbOffset_ + index * bytes), out, bytes) == bytes;
+}
+
+SDCard::ImagePackWriter::ImagePackWriter(FILE* file, uint32_t offset)
+    : file_(file), offset_(offset), ok_(false)
+{
+    ok_ = file_ && fseek(file_, offset_, SEEK_SET) == 0;
+}
+
+bool SDCard::ImagePackWriter::write(const void* data, size_t len)
+{
+    if (ok_) {
+        BusBurst burst;
+        ok_ = fwrite(data, 1, len, file_) == len;
+    }
+    offset_ += static_cast<uint32_t>(len);
+    return ok_;
+}
+
+bool SDCard::ImagePackWriter::align()
+{
+    static const uint8_t zeros[64] = {};
+    while (ok_ && offset_ % IMAGE_PACK_FRAME_ALIGN != 0) {
+        write(zeros, std::min<size_t>(sizeof(zeros),
+                                      IMAGE_PACK_FRAME_ALIGN - offset_ % IMAGE_PACK_FRAME_ALIGN));
+    }
+    return ok_;
+}
+
+bool SDCard::ImagePackWriter::finish(const std::vector<ImagePackEntry>& entries)
+{
+    uint32_t tableOffset = offset_;
+    write(entries.data(), entries.size() * sizeof(ImagePackEntry));
+    ok_ = ok_ && fflush(file_) == 0 && ftruncate(fileno(file_), offset_) == 0 &&
+          fsync(fileno(file_)) == 0;
+
+    ImagePackHeader header = {};
+    header.magic = IMAGE_PACK_MAGIC;
+    header.version = IMAGE_PACK_VERSION;
+    header.entryCount = static_cast<uint32_t>(entries.size());
+    header.indexOffset = tableOffset;
+    ok_ = ok_ && fseek(file_, 0, SEEK_SET) == 0 &&
+          fwrite(&header, 1, sizeof(header), file_) == sizeof(header) &&
+          fflush(file_) == 0 && fsync(fileno(file_)) == 0;
+    return ok_;
+}
+
+void SDCard::ImageList::reset(const char* directory)
+{
+    directory_ = directory;
+    // Release the storage too: the list may be dropped for an ImageCursor
+    std::vector<char>().swap(arena_);
+    std::vector<uint32_t>().swap(offsets_);
+    std::vector<ImageInfo>().swap(infos_);
+}
+
+uint32_t SDCard::ImageList::checksum() const
+{
+    uint32_t hash = fnv1a(2166136261u, directory_.c_str(), directory_.size() + 1);
+    return fnv1a(hash, arena_.data(), arena_.size());
+}
+
+void SDCard::ImageList::add(const char* name, const ImageInfo& info)
+{
+    offsets_.push_back(static_cast<uint32_t>(arena_.size()));
+    arena_.insert(arena_.end(), name, name + strlen(name) + 1);
+    infos_.push_back(info);
+}
+
+bool SDCard::ImageList::assign(const char* names, size_t size, size_t count)
+{
+    arena_.assign(names, names + size);
+    offsets_.clear();
+    offsets_.reserve(count);
+
+    size_t pos = 0;
+    while (pos < size && offsets_.size() < count) {
+        size_t len = strnlen(arena_.data() + pos, size - pos);
+        if (len == size - pos) {
+            break;  // Unterminated
+        }
+        offsets_.push_back(static_cast<uint32_t>(pos));
+        pos += len + 1;
+    }
+    if (offsets_.size() != count || pos != size) {
+        arena_.clear();
+        offsets_.clear();
+        infos_.clear();
+        return false;
+    }
+    infos_.assign(count, ImageInfo());
+    return true;
+}
+
+void SDCard::ImageList::sort(std::vector<uint32_t>* permutation)
+{
+    const char* base = arena_.data();
+    std::vector<uint32_t> order(offsets_.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = static_cast<uint32_t>(i);
+    }
+    std::sort(order.begin(), order.end(), [this, base](uint32_t a, uint32_t b) {
+        return naturalLess(base + offsets_[a], base + offsets_[b]);
+    });
+
+    // Re-pack the arena in list order so names() can be written out as-is
+    std::vector<char> sorted;
+    std::vector<uint32_t> offsets;
+    std::vector<ImageInfo> infos;
+    sorted.reserve(arena_.size());
+    offsets.reserve(order.size());
+    infos.reserve(order.size());
+    for (uint32_t i : order) {
+        const char* name = base + offsets_[i];
+        offsets.push_back(static_cast<uint32_t>(sorted.size()));
+        sorted.insert(sorted.end(), name, name + strlen(name) + 1);
+        infos.push_back(infos_[i]);
+    }
+    arena_.swap(sorted);
+    offsets_.swap(offsets);
+    infos_.swap(infos);
+    if (permutation) {
+        permutation->swap(order);
+    }
+}
+
+size_t SDCard::ImageList::filter(ImageProbe probe)
+{
+    // Compact in place: kept names only ever move towards the front
+    char fullPath[MAX_PATH];
+    size_t kept = 0;
+    size_t end = 0;
+    for (size_t i = 0; i < offsets_.size(); i++) {
+        ImageInfo info = {};
+        if (!path(i, fullPath, sizeof(fullPath)) || !probe(fullPath, info)) {
+            ESP_LOGW(TAG_SD, "Skipping %s: unsupported or damaged", name(i));
+            continue;
+        }
+        const char* entry = arena_.data() + offsets_[i];
+        size_t len = strlen(entry) + 1;
+        memmove(arena_.data() + end, entry, len);
+        offsets_[kept] = static_cast<uint32_t>(end);
+        infos_[kept] = info;
+        end += len;
+        kept++;
+    }
+    size_t dropped = offsets_.size() - kept;
+    arena_.resize(end);
+    offsets_.resize(kept);
+    infos_.resize(kept);
+    return dropped;
+}
+
+bool SDCard::ImageList::path(size_t index, char* out, size_t outSize) const
+{
+    if (index >= offsets_.size()) {
+        return false;
+    }
+    int len = snprintf(out, outSize, "%s/%s", directory_.c_str(), name(index));
+    return len >= 0 && static_cast<size_t>(len) < outSize;
+}
+
+void SDCard::invalidateImageIndex()
+{
+    char path[64];
+    indexPath(path, sizeof(path));
+    if (remove(path) == 0) {
+        ESP_LOGI(TAG_SD, "Image index dropped");
+    }
+}
+
+size_t SDCard::scanForImages(const char* directory, ImageList& images, ImageProbe probe)
+{
+    images.reset(directory);
+
+    if (!s_mounted) {
+        ESP_LOGE(TAG_SD, "SD card not mounted");
+        return 0;
+    }
+
+    // The index is trusted as long as none of its directories changed since
+    ImageList oldImages;
+    ImageIndex old;
+    oldImages.reset(directory);
+    bool haveIndex = IMAGE_INDEX_ENABLED &&
+                     loadImageIndex(directory, probe != nullptr, oldImages, old);
+    if (haveIndex && indexCurrent(directory, old)) {
+        images = std::move(oldImages);
+        ESP_LOGI(TAG_SD, "Loaded %zu image files from index", images.size());
+        return images.size();
+    }
+
+    ImageIndex index;
+    TreeScan scan = { directory, probe, haveIndex ? &oldImages : nullptr, haveIndex ? &old : nullptr,
+                      {}, {}, images, index };
+    if (haveIndex) {
+        scan.oldFiles.resize(old.dirs.size());
+        scan.oldChildren.resize(old.dirs.size());
+        for (uint32_t i = 0; i < old.files.size(); i++) {
+            if (old.files[i].dir < old.dirs.size()) {
+                scan.oldFiles[old.files[i].dir].push_back(i);
+            }
+        }
+        for (size_t i = 0; i < old.dirs.size(); i++) {
+            if (old.dirs[i].parent != NO_PARENT) {
+                scan.oldChildren[old.dirs[i].parent].push_back(static_cast<uint16_t>(i));
+            }
+        }
+        for (std::vector<uint32_t>& files : scan.oldFiles) {
+            std::sort(files.begin(), files.end(), [&oldImages](uint32_t a, uint32_t b) {
+                return strcmp(oldImages.name(a), oldImages.name(b)) < 0;
+            });
+        }
+    }
+    scanTree(scan, "", NO_PARENT, 0);
+    if (index.dirs.empty()) {
+        ESP_LOGE(TAG_SD, "Failed to open directory: %s", directory);
+        return 0;
+    }
+
+    // Natural order, independent of the order entries sit in the directories;
+    // stored that way, so the next boot reads it back without sorting
+    std::vector<uint32_t> order;
+    images.sort(&order);
+    std::vector<ImageIndex::File> files;
+    files.reserve(order.size());
+    for (uint32_t i : order) {
+        files.push_back(index.files[i]);
+    }
+    index.files.swap(files);
+    ESP_LOGI(TAG_SD, "Found %zu image files in %s (%zu directories read, %zu unchanged, %zu skipped)",
+             images.size(), directory, scan.read, scan.reused, scan.dropped);
+
+    if (IMAGE_INDEX_ENABLED && !images.empty()) {
+        storeImageIndex(probe != nullptr, images, index);
+    }
+    return images.size();
+}
+
+int32_t SDCard::readFile(const char* filepath, uint8_t* buffer, size_t maxSize)
+{
+    if (!s_mounted || !buffer || maxSize == 0) {
+        return -1;
+    }
+
+    FILE* file = fopen(filepath, "rb");
+    if (file == nullptr) {
+        ESP_LOGE(TAG_SD, "Failed to open file: %s", filepath);
+        return -1;
+    }
+
+    // One read straight into the caller's buffer: unbuffered, FATFS moves
+    // whole sectors without staging them through the stdio buffer
+    setvbuf(file, nullptr, _IONBF, 0);
+    BusBurst burst;
+    int32_t size = getFileSize(file);
+    size_t wanted = (size >= 0 && static_cast<size_t>(size) < maxSize) ? size : maxSize;
+    size_t bytesRead = fread(buffer, 1, wanted, file);
+    fclose(file);
+
+    return static_cast<int32_t>(bytesRead);
+}
+
+FILE* SDCard::openFile(const char* filepath, int32_t* size, void* buffer)
+{
+    if (!s_mounted || !filepath) {
+        return nullptr;
+    }
+
+    SlideStats::Timer timer(SlideStats::Stage::OPEN);
+    FILE* file = fopen(filepath, "rb");
+    if (file == nullptr) {
+        // Callers report missing files in their own terms (cache misses are normal)
+        if (errno == ENOENT) {
+            ESP_LOGD(TAG_SD, "No such file: %s", filepath);
+        } else {
+            ESP_LOGE(TAG_SD, "Failed to open file: %s", filepath);
+        }
+        return nullptr;
+    }
+
+    // Refill a cluster at a time; without a caller buffer newlib allocates
+    // one and frees it in fclose(), or keeps its default one if that fails
+    setvbuf(file, static_cast<char*>(buffer), _IOFBF, SD_READ_BUFFER_SIZE);
+
+    if (size) {
+        *size = getFileSize(file);
+    }
+    return file;
+}
+
+FILE* SDCard::createFile(const char* filepath)
+{
+    if (!s_mounted || !filepath) {
+        return nullptr;
+    }
+
+    FILE* file = fopen(filepath, "wb");
+    if (file == nullptr) {
+        ESP_LOGE(TAG_SD, "Failed to create file: %s", filepath);
+    }
+    return file;
+}
+
+FILE* SDCard::createContiguousFile(const char* filepath, uint32_t size)
+{
+    if (!s_mounted || !filepath) {
+        return nullptr;
+    }
+
+    // f_expand() only allocates for an empty file
+    remove(filepath);
+    if (size == 0 || esp_vfs_fat_create_contiguous_file(s_mount_point, filepath, size, true) != ESP_OK) {
+        ESP_LOGW(TAG_SD, "No contiguous %u KB free for %s", static_cast<unsigned>(size / 1024),
+                 filepath);
+        return createFile(filepath);
+    }
+    FILE* file = fopen(filepath, "r+b");
+    if (file == nullptr) {
+        ESP_LOGE(TAG_SD, "Failed to create file: %s", filepath);
+    }
+    return file;
+}
+
+int32_t SDCard::getFileSize(const char* filepath)
+{
+    if (!s_mounted || !filepath) {
+        return -1;
+    }
+
+    struct stat st;
+    if (stat(filepath, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return -1;
+    }
+    return static_cast<int32_t>(st.st_size);
+}
+
+int32_t SDCard::getFileSize(FILE* file)
+{
+    struct stat st;
+    if (!file || fstat(fileno(file), &st) != 0) {
+        return -1;
+    }
+    return static_cast<int32_t>(st.st_size);
+}
+
+bool SDCard::getFileInfo(const char* filepath, int32_t& size, int64_t& mtime)
+{
+    if (!s_mounted || !filepath) {
+        return false;
+    }
+
+    struct stat st;
+    if (stat(filepath, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+
+    size = static_cast<int32_t>(st.st_size);
+    mtime = static_cast<int64_t>(st.st_mtime);
+    return true;
+}
+
+bool SDCard::makeDirectory(const char* path)
+{
+    if (!s_mounted || !path) {
+        return false;
+    }
+
+    if (mkdir(path, 0775) != 0 && errno != EEXIST) {
+        ESP_LOGE(TAG_SD, "Failed to create directory: %s", path);
+        return false;
+    }
+    return true;
+}
+
+size_t SDCard::clusterSize()
+{
+    if (!s_mounted) {
+        return 0;
+    }
+    // Any open directory carries the volume object; the root is always there
+    char fatPath[16];
+    FF_DIR dir;
+    if (!toFatPath(s_mount_point, fatPath, sizeof(fatPath)) || f_opendir(&dir, fatPath) != FR_OK) {
+        return 0;
+    }
+#if FF_MAX_SS != FF_MIN_SS
+    size_t sectorSize = dir.obj.fs->ssize;
+#else
+    size_t sectorSize = FF_MAX_SS;
+#endif
+    size_t size = dir.obj.fs->csize * sectorSize;
+    f_closedir(&dir);
+    return size;
+}
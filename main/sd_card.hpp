@@ -5,13 +5,438 @@
 
 #pragma once
 
+#include "sdmmc_cmd.h"
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <memory>
 #include <vector>
 #include <string>
 
 namespace SDCard {
 
+/**
+ * @brief What an image's header says, read once when the list is built
+ */
+enum class ImageFormat : uint8_t { BMP, JPEG, PNG, EPD, COLLAGE, QOI };
+
+struct ImageInfo {
+    ImageFormat format;
+    uint8_t  bitsPerPixel;  // Per pixel as stored (BMP/PNG), channels * 8 (JPEG/QOI), 0 (.epd)
+    uint8_t  compression;   // BMP compression, PNG color type, .epd encoding, collage images
+    uint8_t  reserved;
+    uint16_t width;
+    uint16_t height;
+    uint32_t dataOffset;    // First byte of pixel data (BMP, .epd); 0 otherwise
+};
+static_assert(sizeof(ImageInfo) == 12, "ImageInfo is stored in the image index as-is");
+
+/**
+ * @brief Reads an image's header and checks that a decoder supports it
+ * @return false to leave the file out of the list
+ */
+typedef bool (*ImageProbe)(const char* filepath, ImageInfo& info);
+
+/**
+ * @brief Image file list: one directory plus a pool of file names
+ *
+ * Names are stored back to back, NUL-terminated, in a single arena, and
+ * addressed through an offset table, so an entry costs its name length + 17
+ * bytes (~29 bytes for an 8.3 name) and no allocation of its own: the
+ * offset and the entry's ImageInfo. Full paths are built on demand into a
+ * caller buffer.
+ */
+class ImageList {
+public:
+    static constexpr size_t MAX_PATH = 128;  // Longest path path() builds
+
+    /**
+     * @brief Drop all entries and set the directory names are relative to
+     */
+    void reset(const char* directory);
+
+    /**
+     * @brief Append a file name (relative to the directory, e.g.
+     *        "album/img1.bmp") and its header info
+     */
+    void add(const char* name, const ImageInfo& info = ImageInfo());
+
+    /**
+     * @brief Replace the entries with a block of NUL-terminated names
+     * @param names count names back to back
+     * @param size Bytes in names
+     * @param count Number of names
+     * @return false (and an empty list) if the block doesn't hold count names
+     */
+    bool assign(const char* names, size_t size, size_t count);
+
+    /**
+     * @brief Sort entries by name in natural order (numbers by value,
+     *        "img2" before "img10", case-insensitive); infos move with
+     *        their names
+     * @param permutation Optional output: old index of each sorted entry
+     */
+    void sort(std::vector<uint32_t>* permutation = nullptr);
+
+    /**
+     * @brief Keep only the entries probe accepts, storing what it read
+     * @return Number of entries dropped
+     */
+    size_t filter(ImageProbe probe);
+
+    size_t size() const { return offsets_.size(); }
+    bool empty() const { return offsets_.empty(); }
+    const char* directory() const { return directory_.c_str(); }
+
+    /**
+     * @brief File name of an entry, relative to the directory
+     */
+    const char* name(size_t index) const { return arena_.data() + offsets_[index]; }
+
+    /**
+     * @brief Header info of an entry (all zero unless the list was probed)
+     */
+    const ImageInfo& info(size_t index) const { return infos_[index]; }
+    void setInfo(size_t index, const ImageInfo& info) { infos_[index] = info; }
+
+    /**
+     * @brief Build the full path of an entry
+     * @param index Entry index
+     * @param out Output buffer (MAX_PATH is always enough)
+     * @param outSize Size of out
+     * @return false if the path didn't fit
+     */
+    bool path(size_t index, char* out, size_t outSize) const;
+
+    /**
+     * @brief All names in list order, back to back and NUL-terminated
+     */
+    const char* names() const { return arena_.data(); }
+    size_t namesSize() const { return arena_.size(); }
+
+    /**
+     * @brief Hash of the directory and all names in list order
+     */
+    uint32_t checksum() const;
+
+private:
+    std::string directory_;
+    std::vector<char> arena_;
+    std::vector<uint32_t> offsets_;
+    std::vector<ImageInfo> infos_;
+};
+
+/**
+ * @brief Lazy image enumeration, for directories too large to list in RAM
+ *
+ * Images are visited in directory order (not sorted, and without
+ * subdirectories). open() makes one counting pass over the directory and
+ * snapshots the FatFs read position every CHECKPOINT_INTERVAL images;
+ * path() resumes from the nearest snapshot at or before the wanted image,
+ * or keeps reading forward when it is just ahead of the previous lookup.
+ * That costs one snapshot (~40 bytes) per CHECKPOINT_INTERVAL images, and a
+ * lookup reads at most one interval of directory entries, however large
+ * the directory is. Files added or removed
+ * while the cursor is open are not picked up until it is reopened.
+ */
+class ImageCursor {
+public:
+    static constexpr size_t CHECKPOINT_INTERVAL = 64;
+
+    ImageCursor();
+    ~ImageCursor();
+
+    ImageCursor(const ImageCursor&) = delete;
+    ImageCursor& operator=(const ImageCursor&) = delete;
+
+    /**
+     * @brief Count the images in a directory and build the checkpoint table
+     * @param directory Directory under the SD card mount point
+     * @return false if the card isn't mounted or the directory can't be read
+     */
+    bool open(const char* directory);
+
+    /**
+     * @brief Release the directory and the checkpoint table
+     */
+    void close();
+
+    bool isOpen() const { return state_ != nullptr; }
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+
+    /**
+     * @brief Hash of the directory and image count (names aren't held in RAM)
+     */
+    uint32_t checksum() const;
+
+    /**
+     * @brief Build the full path of an image, seeking the directory to it
+     * @param index Image index in directory order
+     * @param out Output buffer (ImageList::MAX_PATH is always enough)
+     * @param outSize Size of out
+     * @return false if the image is gone or the path didn't fit
+     */
+    bool path(size_t index, char* out, size_t outSize);
+
+private:
+    struct State;  // FatFs directory object and checkpoints (sd_card.cpp)
+
+    std::unique_ptr<State> state_;
+    size_t count_ = 0;
+};
+
+/**
+ * @brief Image pack file header
+ *
+ * A pack holds many slides in one file: this header, entryCount
+ * ImagePackEntry records at indexOffset, then the frames back to back.
+ * When thumbWidth and thumbHeight are set, one thumbnail per slide follows
+ * the entry table: 1 bit per pixel, set for ink, rows MSB first and padded
+ * to whole bytes (the GFXcanvas1 layout), imagePackThumbBytes() each.
+ * Produced on the host by tools/epd_pack.py.
+ *
+ * A version 2 pack may hold each slide rendered for several panels: with
+ * variants above 1, every slide has that many entries in a row, one per
+ * panel (ImagePackEntry::panel), and a unit keeps only those for its own
+ * panel (selectImagePackVariants()). Version 1 packs have one per slide.
+ */
+#pragma pack(push, 1)
+struct ImagePackHeader {
+    uint32_t magic;        // IMAGE_PACK_MAGIC ("EPDP")
+    uint8_t  version;      // IMAGE_PACK_VERSION, or 1
+    uint8_t  thumbWidth;   // Thumbnail size in pixels, 0 without thumbnails
+    uint8_t  thumbHeight;
+    uint8_t  variants;     // Entries per slide, 0 in version 1 (one)
+    uint32_t entryCount;   // Entries in the table: slides x variants
+    uint32_t indexOffset;  // File offset of the first ImagePackEntry
+};
+
+/**
+ * @brief One slide in an image pack, or one variant of it
+ */
+struct ImagePackEntry {
+    uint32_t offset;       // File offset of the slide data
+    uint32_t length;       // Bytes of slide data
+    uint8_t  format;       // IMAGE_PACK_FORMAT_*
+    uint8_t  panel;        // Panel::Profile::id the frame is for, 0 = any (version 1)
+    uint8_t  reserved[2];
+    uint32_t nameHash;     // FNV-1a of the source file name, for logs and tools
+};
+#pragma pack(pop)
+
+static constexpr uint32_t IMAGE_PACK_MAGIC = 0x50445045;  // "EPDP" little-endian
+static constexpr uint8_t IMAGE_PACK_VERSION = 2;
+static constexpr uint8_t IMAGE_PACK_MAX_VARIANTS = 8;     // Panels one pack may serve
+static constexpr uint8_t IMAGE_PACK_FORMAT_EPD = 1;       // A complete .epd frame
+static constexpr uint8_t IMAGE_PACK_FORMAT_DELTA = 2;     // An .epd frame of planes to XOR onto
+                                                          // the previous entry's
+static constexpr uint32_t IMAGE_PACK_FRAME_ALIGN = 512;   // One sector, as tools/epd_pack.py aligns
+
+/**
+ * @brief Entries per slide in a pack
+ */
+constexpr uint32_t imagePackVariants(const ImagePackHeader& header)
+{
+    return header.variants > 1 ? header.variants : 1;
+}
+
+/**
+ * @brief Check a pack header's magic, version and counts (not its offsets):
+ *        at most MAX_IMAGE_FILES slides, each with every variant
+ */
+bool imagePackHeaderValid(const ImagePackHeader& header);
+
+/**
+ * @brief Keep each slide's entry for a panel, dropping its other variants
+ *
+ * A slide without a variant for the panel keeps its variant for any panel
+ * (0), else its first, which the loader then refuses as for another panel.
+ *
+ * @param entries The pack's whole table; left with one entry per slide
+ * @param panel Panel::Profile::id of the panel driven
+ */
+void selectImagePackVariants(const ImagePackHeader& header, std::vector<ImagePackEntry>& entries,
+                             uint8_t panel);
+
+/**
+ * @brief Bytes of one thumbnail in a pack, 0 if it has none
+ */
+constexpr size_t imagePackThumbBytes(const ImagePackHeader& header)
+{
+    return header.thumbHeight == 0 ? 0 : (header.thumbWidth + 7) / 8 * size_t(header.thumbHeight);
+}
+
+/**
+ * @brief File offset of a pack's thumbnail table, just past the entry table
+ */
+constexpr uint64_t imagePackThumbOffset(const ImagePackHeader& header)
+{
+    return header.indexOffset + uint64_t(header.entryCount) * sizeof(ImagePackEntry);
+}
+
+/**
+ * @brief Random access into an image pack
+ *
+ * open() reads the whole entry table into RAM (16 bytes per slide) and keeps
+ * the pack open, so reaching slide N is one fseek on a handle that is
+ * already open: no directory lookup or FAT chain walk per slide, and no
+ * file handles (max_files) spent beyond this one.
+ *
+ * With IMAGE_PACK_DIRECT_READS, open() also finds out whether the file lies
+ * in one run of clusters and, if so, the card sector it starts at; read()
+ * then takes the frames from the card's sectors without the file system.
+ */
+class ImagePack {
+public:
+    ImagePack() = default;
+    ~ImagePack();
+
+    ImagePack(const ImagePack&) = delete;
+    ImagePack& operator=(const ImagePack&) = delete;
+
+    /**
+     * @brief Open a pack and load its entry table
+     * @param filepath Full path to the pack file
+     * @param panel Panel::Profile::id whose variant of each slide to keep,
+     *              in a pack with several (selectImagePackVariants())
+     * @return false if the file is missing or the header or table is invalid
+     */
+    bool open(const char* filepath, uint8_t panel = 0);
+
+    /**
+     * @brief Close the pack and drop the entry table
+     */
+    void close();
+
+    bool isOpen() const { return file_ != nullptr; }
+    size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+    const ImagePackEntry& entry(size_t index) const { return entries_[index]; }
+
+    /**
+     * @brief Thumbnail size, 0x0 if the pack has none
+     */
+    uint8_t thumbWidth() const { return thumbWidth_; }
+    uint8_t thumbHeight() const { return thumbHeight_; }
+
+    /**
+     * @brief Read a slide's thumbnail
+     * @param index Slide index
+     * @param out imagePackThumbBytes() bytes
+     * @return false without thumbnails or on a read error
+     */
+    bool readThumbnail(size_t index, uint8_t* out);
+
+    /**
+     * @brief Hash of the entry table
+     */
+    uint32_t checksum() const;
+
+    /**
+     * @brief Position the pack handle at the first byte of a slide
+     * @param index Slide index
+     * @return The pack's FILE handle (do not close it), or nullptr on error
+     */
+    FILE* seek(size_t index);
+
+    /**
+     * @brief Whether read() goes to the card's sectors directly
+     */
+    bool direct() const { return window_ != nullptr; }
+
+    /**
+     * @brief Read bytes of the pack, straight from the card's sectors
+     *
+     * Whole sectors into a DMA-capable, word-aligned buffer are one
+     * multi-sector DMA transfer into it; anything else is copied out of the
+     * DMA window, which keeps the sectors it last read. Without direct()
+     * this is an fseek() and fread() on the pack handle.
+     *
+     * @param offset File offset
+     * @return Bytes read, short at the end of the file or on a card error
+     */
+    size_t read(uint32_t offset, void* dst, size_t len);
+
+private:
+    bool openDirect(const char* filepath);
+    bool fillWindow(uint32_t offset);
+
+    FILE* file_ = nullptr;
+    std::vector<ImagePackEntry> entries_;
+    uint32_t fileSize_ = 0;
+    uint32_t startSector_ = 0;      // Card sector of file offset 0 (direct())
+    uint8_t* window_ = nullptr;     // IMAGE_PACK_DIRECT_WINDOW bytes, DMA-capable
+    uint32_t windowOffset_ = 0;     // File offset of window_[0]
+    uint32_t windowBytes_ = 0;      // Valid bytes in window_
+    uint32_t thumbOffset_ = 0;
+    uint8_t thumbWidth_ = 0;
+    uint8_t thumbHeight_ = 0;
+};
+
+/**
+ * @brief Sequential writes of a pack file: frames at any offset past the
+ *        old contents, then the entry table and the header that points to it
+ *
+ * Until finish() rewrites the header the file keeps whatever header it had,
+ * so appending to a live pack leaves it valid if the update stops halfway.
+ * Errors stick: once a write fails every later call returns false.
+ */
+class ImagePackWriter {
+public:
+    /**
+     * @param file Open for writing, nullptr to fail every call
+     * @param offset Where the first write goes
+     */
+    ImagePackWriter(FILE* file, uint32_t offset);
+
+    uint32_t offset() const { return offset_; }
+
+    bool write(const void* data, size_t len);
+
+    /**
+     * @brief Pad with zeros up to the next IMAGE_PACK_FRAME_ALIGN boundary
+     */
+    bool align();
+
+    /**
+     * @brief Write the entry table, then the header that points to it; each
+     *        reaches the card before the next, so the old header stays
+     *        valid until the new table is complete
+     *
+     * The file is cut off after the table, dropping whatever a
+     * createContiguousFile() allocation had left over.
+     */
+    bool finish(const std::vector<ImagePackEntry>& entries);
+
+private:
+    FILE* file_;
+    uint32_t offset_;
+    bool ok_;
+};
+
+/**
+ * @brief Keep display traffic off the shared SPI bus during a bulk SD transfer
+ *
+ * Each SD command is atomic on its own; a burst additionally stops the
+ * display's command/plane writes from slotting in between the commands of
+ * one multi-sector read or write, so neither side keeps re-arbitrating the
+ * bus. The display waits for the burst, so hold one around a bulk transfer,
+ * not a whole decode, and never wait on the display (waitFramebufferFree(),
+ * display()) while holding it. A no-op with SD_USE_SDMMC.
+ */
+class BusBurst {
+public:
+    BusBurst();
+    ~BusBurst();
+
+    BusBurst(const BusBurst&) = delete;
+    BusBurst& operator=(const BusBurst&) = delete;
+
+private:
+    bool held_;
+};
+
 /**
  * @brief Initialize SD card and mount filesystem
  * @return true if successful, false otherwise
@@ -20,6 +445,8 @@ bool init();
 
 /**
  * @brief Deinitialize SD card and unmount filesystem
+ *
+ * With SD_POWER_PIN, the card is switched off too; init() brings it back.
  */
 void deinit();
 
@@ -29,13 +456,63 @@ void deinit();
  */
 bool isMounted();
 
+/**
+ * @brief The mounted card, for sector access beside the file system
+ *        (UsbStorage); nullptr when nothing is mounted
+ */
+sdmmc_card_t* card();
+
+/**
+ * @brief Drop the image index, so the next scan lists every directory again
+ *
+ * For after something else wrote to the card (a USB host): FAT directory
+ * times, which the index is checked against, aren't kept by every writer.
+ */
+void invalidateImageIndex();
+
+/**
+ * @brief Take the mounted card's SDSPI device off the SPI bus, so the bus
+ *        can be freed for an idle stretch (SPIClass::end())
+ *
+ * The card stays mounted and powered, deselected and unclocked, which is
+ * its standby. The next access from any task puts the device back, and
+ * brings the bus up if it was freed, in well under a millisecond.
+ *
+ * @return true if the card is off the bus (or never on it: SD_USE_SDMMC,
+ *         nothing mounted)
+ */
+bool suspendBus();
+
+/**
+ * @brief Whether SD_DETECT_PIN is wired
+ */
+bool hasDetectPin();
+
+/**
+ * @brief Whether a card is in the slot
+ *
+ * With SD_DETECT_PIN, the switch's level. Without it, whether the mounted
+ * card still answers a status command; false when nothing is mounted, as
+ * only a mount attempt can tell then.
+ */
+bool present();
+
 /**
  * @brief Scan directory for image files
+ *
+ * Subdirectories (albums) are scanned too, down to IMAGE_SCAN_MAX_DEPTH.
+ * With IMAGE_INDEX_ENABLED, a directory whose mtime matches the index is
+ * taken from it without being read, and only changed directories are
+ * listed again, so adding one album costs one album's scan. With a probe, each file's header is read once here, files it rejects are
+ * left out, and what it read is kept in the list and the image index, so a
+ * rescan from the index opens no image at all.
+ *
  * @param directory Directory path to scan (e.g., "/sdcard/images")
- * @param imageFiles Output vector of image file paths
+ * @param images Output list of image files, in natural name order
+ * @param probe Optional header check (e.g. ImageLoader::probe)
  * @return Number of images found
  */
-size_t scanForImages(const char* directory, std::vector<std::string>& imageFiles);
+size_t scanForImages(const char* directory, ImageList& images, ImageProbe probe = nullptr);
 
 /**
  * @brief Read file from SD card
@@ -46,6 +523,48 @@ size_t scanForImages(const char* directory, std::vector<std::string>& imageFiles
  */
 int32_t readFile(const char* filepath, uint8_t* buffer, size_t maxSize);
 
+/**
+ * @brief Open a file on the SD card for streaming reads
+ *
+ * The handle reads through an SD_READ_BUFFER_SIZE buffer, so small freads
+ * cost a memcpy and the card sees cluster-sized transfers. With
+ * CONFIG_FATFS_USE_FASTSEEK, the VFS also builds a cluster link map for
+ * each read-only handle, so fseek() to any offset (bottom-up BMP rows,
+ * entries deep in a large file) costs no FAT chain walk. Files split into
+ * more fragments than CONFIG_FATFS_FAST_SEEK_BUFFER_SIZE / 2 fall back to
+ * normal seeking.
+ *
+ * @param filepath Full path to file
+ * @param size Optional output file size (fstat on the open handle, -1 on error)
+ * @param buffer Optional SD_READ_BUFFER_SIZE stdio buffer that outlives the
+ *               handle (e.g. from SlideArena); nullptr lets newlib allocate one
+ * @return FILE handle (close with fclose), or nullptr if not mounted / not found
+ */
+FILE* openFile(const char* filepath, int32_t* size = nullptr, void* buffer = nullptr);
+
+/**
+ * @brief Create (or truncate) a file on the SD card for writing
+ * @param filepath Full path to file
+ * @return FILE handle (close with fclose), or nullptr if not mounted / cannot create
+ */
+FILE* createFile(const char* filepath);
+
+/**
+ * @brief Create a file of a given size in one run of clusters, open for
+ *        writing from its start
+ *
+ * For a file about to be written front to back (an image pack), so its
+ * data can later be read sector by sector (ImagePack::direct()). Any file
+ * at the path is replaced. When the free space has no run that long the
+ * file is created as createFile() would.
+ *
+ * @param size Bytes to allocate; the file is this long, whatever the
+ *             clusters held past what is written, until it is truncated
+ *             (ImagePackWriter::finish() does)
+ * @return FILE handle (close with fclose), or nullptr if not mounted / cannot create
+ */
+FILE* createContiguousFile(const char* filepath, uint32_t size);
+
 /**
  * @brief Get file size
  * @param filepath Full path to file
@@ -53,5 +572,40 @@ int32_t readFile(const char* filepath, uint8_t* buffer, size_t maxSize);
  */
 int32_t getFileSize(const char* filepath);
 
+/**
+ * @brief Get the size of an open file without seeking
+ * @param file Open FILE handle
+ * @return File size in bytes, or -1 on error
+ */
+int32_t getFileSize(FILE* file);
+
+/**
+ * @brief Get file size and modification time without opening the file
+ * @param filepath Full path to file
+ * @param size Output file size in bytes
+ * @param mtime Output modification time (seconds since epoch, FAT resolution)
+ * @return true if the file exists, false otherwise
+ */
+bool getFileInfo(const char* filepath, int32_t& size, int64_t& mtime);
+
+/**
+ * @brief Create a directory if it doesn't exist yet
+ * @param path Full path to directory
+ * @return true if the directory exists afterwards, false otherwise
+ */
+bool makeDirectory(const char* path);
+
+/**
+ * @brief Bytes per cluster of the mounted volume
+ *
+ * A write of whole sectors at a sector-aligned offset goes from the
+ * caller's buffer straight to the card, without FatFs's sector window or a
+ * read of the partial sector first; writing whole clusters at a time also
+ * costs at most one FAT update each.
+ *
+ * @return Cluster size, or 0 if not mounted
+ */
+size_t clusterSize();
+
 } // namespace SDCard
 
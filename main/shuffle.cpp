@@ -0,0 +1,140 @@
+/**
+ * @file shuffle.cpp
+ * @brief Keyed permutation implementation
+ */
+
+#include "shuffle.hpp"
+#include "config.hpp"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include <cinttypes>
+
+static const char* TAG_SHUFFLE = "Shuffle";
+
+static constexpr int ROUNDS = 4;
+
+// Kept through deep sleep; a zero key means power-on, before the first draw
+RTC_DATA_ATTR static uint32_t s_key = 0;
+RTC_DATA_ATTR static bool s_enabled = SHUFFLE_ENABLED;
+
+/**
+ * @brief Feistel round function: a half, the key and the round mixed
+ *        into a half (murmur3 finalizer)
+ */
+static uint32_t mix(uint32_t half, uint32_t key, int r, uint32_t mask)
+{
+    uint32_t h = half ^ key ^ (static_cast<uint32_t>(r) * 0x9E3779B9u);
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h & mask;
+}
+
+/**
+ * @brief Half width in bits of the smallest even-width domain holding count
+ */
+static int halfBits(size_t count)
+{
+    int bits = 2;
+    while ((uint64_t(1) << bits) < count) {
+        bits += 2;
+    }
+    return bits / 2;
+}
+
+static uint32_t encrypt(uint32_t x, int half, uint32_t key)
+{
+    uint32_t mask = (1u << half) - 1;
+    uint32_t left = x >> half;
+    uint32_t right = x & mask;
+    for (int r = 0; r < ROUNDS; r++) {
+        uint32_t next = left ^ mix(right, key, r, mask);
+        left = right;
+        right = next;
+    }
+    return (left << half) | right;
+}
+
+static uint32_t decrypt(uint32_t x, int half, uint32_t key)
+{
+    uint32_t mask = (1u << half) - 1;
+    uint32_t left = x >> half;
+    uint32_t right = x & mask;
+    for (int r = ROUNDS - 1; r >= 0; r--) {
+        uint32_t previous = right ^ mix(left, key, r, mask);
+        right = left;
+        left = previous;
+    }
+    return (left << half) | right;
+}
+
+static uint32_t currentKey()
+{
+    if (s_key == 0) {
+        Shuffle::reshuffle();
+    }
+    return s_key;
+}
+
+bool Shuffle::enabled()
+{
+    return s_enabled;
+}
+
+void Shuffle::setEnabled(bool on)
+{
+    if (on && !s_enabled) {
+        Shuffle::reshuffle();
+    }
+    s_enabled = on;
+}
+
+void Shuffle::reshuffle()
+{
+    do {
+        s_key = esp_random();
+    } while (s_key == 0);
+    ESP_LOGI(TAG_SHUFFLE, "New order, key %08" PRIx32, s_key);
+}
+
+size_t Shuffle::at(size_t position, size_t count)
+{
+    if (!s_enabled || count < 2) {
+        return position;
+    }
+    // The domain is under 4x count, so the walk is short
+    int half = halfBits(count);
+    uint32_t x = static_cast<uint32_t>(position);
+    do {
+        x = encrypt(x, half, currentKey());
+    } while (x >= count);
+    return x;
+}
+
+size_t Shuffle::positionOf(size_t index, size_t count)
+{
+    if (!s_enabled || count < 2) {
+        return index;
+    }
+    int half = halfBits(count);
+    uint32_t x = static_cast<uint32_t>(index);
+    do {
+        x = decrypt(x, half, currentKey());
+    } while (x >= count);
+    return x;
+}
+
+size_t Shuffle::step(size_t index, long steps, size_t count)
+{
+    if (count == 0) {
+        return 0;
+    }
+    size_t offset = static_cast<size_t>(steps < 0 ? -steps : steps) % count;
+    if (steps < 0) {
+        offset = (count - offset) % count;
+    }
+    return at((positionOf(index, count) + offset) % count, count);
+}
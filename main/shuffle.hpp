@@ -0,0 +1,54 @@
+/**
+ * @file shuffle.hpp
+ * @brief Shuffled play order as a keyed permutation of the slide indices
+ *
+ * The order is never stored: a 4-round Feistel network over the smallest
+ * even bit width that holds the slide count, cycle-walked back into range,
+ * maps each play position to a slide and back. Only the 32-bit key lives
+ * in RTC memory, so a shuffle costs nothing per slide at any count, goes
+ * through deep sleep unchanged, and a slide's neighbours in play order are
+ * two calls away. The key is drawn again at power-on and by reshuffle().
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Shuffle {
+
+/**
+ * @brief Whether the play order is shuffled; SHUFFLE_ENABLED at power-on
+ */
+bool enabled();
+
+/**
+ * @brief Turn shuffling on or off; turning it on draws a new order
+ */
+void setEnabled(bool on);
+
+/**
+ * @brief Draw a new order
+ */
+void reshuffle();
+
+/**
+ * @brief The slide steps places from a slide in play order (list order
+ *        when shuffling is off); negative steps go back
+ * @param index Slide index, < count
+ */
+size_t step(size_t index, long steps, size_t count);
+
+/**
+ * @brief The slide at a play position
+ * @param position < count
+ */
+size_t at(size_t position, size_t count);
+
+/**
+ * @brief Play position of a slide, the inverse of at()
+ * @param index < count
+ */
+size_t positionOf(size_t index, size_t count);
+
+} // namespace Shuffle
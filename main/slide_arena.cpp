@@ -0,0 +1,76 @@
+/**
+ * @file slide_arena.cpp
+ * @brief Per-slide bump allocator implementation
+ */
+
+#include "slide_arena.hpp"
+#include "esp_log.h"
+#include <cstdlib>
+#include <algorithm>
+
+static const char* TAG_ARENA = "SlideArena";
+
+// The decoding task is the only user, so there is no lock
+static uint8_t* s_base = nullptr;
+static size_t s_size = 0;
+static size_t s_used = 0;
+static size_t s_peak = 0;
+static uint32_t s_overflows = 0;
+static uint32_t s_depth = 0;  // Open Scopes
+
+bool SlideArena::init(size_t size)
+{
+    for (size_t want = size; !s_base && want >= size / 8 && want > 0; want /= 2) {
+        s_base = static_cast<uint8_t*>(malloc(want));
+        s_size = s_base ? want : 0;
+    }
+    if (!s_base) {
+        ESP_LOGW(TAG_ARENA, "No memory for the arena, decoding from the heap");
+        return false;
+    }
+    if (s_size < size) {
+        ESP_LOGW(TAG_ARENA, "Arena reduced to %zu bytes", s_size);
+    }
+    return true;
+}
+
+void* SlideArena::alloc(size_t size, size_t align)
+{
+    if (!s_base || s_depth == 0 || size == 0) {
+        return nullptr;
+    }
+    size_t start = (s_used + align - 1) & ~(align - 1);
+    if (start > s_size || size > s_size - start) {
+        s_overflows++;
+        ESP_LOGD(TAG_ARENA, "%zu bytes don't fit (%zu of %zu used)", size, s_used, s_size);
+        return nullptr;
+    }
+    s_used = start + size;
+    s_peak = std::max(s_peak, s_used);
+    return s_base + start;
+}
+
+bool SlideArena::owns(const void* p)
+{
+    const uint8_t* byte = static_cast<const uint8_t*>(p);
+    return s_base && byte >= s_base && byte < s_base + s_size;
+}
+
+SlideArena::Scope::Scope()
+    : mark_(s_used)
+{
+    s_depth++;
+}
+
+SlideArena::Scope::~Scope()
+{
+    s_used = mark_;
+    s_depth--;
+}
+
+void SlideArena::getStats(Stats& out)
+{
+    out.size = s_size;
+    out.peak = s_peak;
+    out.overflows = s_overflows;
+}
@@ -0,0 +1,145 @@
+/**
+ * @file slide_arena.hpp
+ * @brief Per-slide bump allocator for decode scratch memory
+ *
+ * One block, allocated at boot, serves every decode buffer of a slide:
+ * file buffer, row caches, dither error rows, JPEG and PNG work memory. A
+ * Scope rewinds it when the slide is done, so decoding costs no heap
+ * allocations and leaves no fragmentation behind. Allocations that don't
+ * fit, or happen outside a Scope or before init(), come from the heap as
+ * before. Only for the task that decodes (the slideshow task).
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace SlideArena {
+
+/**
+ * @brief Allocate the arena once; later calls do nothing
+ *
+ * Halves the size until the allocation succeeds, down to 1/8 of it.
+ *
+ * @param size Bytes wanted
+ * @return true if an arena is available
+ */
+bool init(size_t size);
+
+/**
+ * @brief Bump-allocate from the arena
+ * @param size Bytes
+ * @param align Alignment, a power of two
+ * @return The memory, or nullptr outside a Scope, before init() or when
+ *         it doesn't fit (counted in Stats::overflows)
+ */
+void* alloc(size_t size, size_t align = alignof(std::max_align_t));
+
+/**
+ * @brief Check whether memory came from the arena
+ */
+bool owns(const void* p);
+
+/**
+ * @brief Everything allocated while it is in scope is released when it ends
+ *
+ * Scopes nest. Objects from the arena must be destroyed before the Scope
+ * they were allocated in ends; declare the Scope first.
+ */
+class Scope {
+public:
+    Scope();
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    size_t mark_;
+};
+
+/**
+ * @brief Arena size and use since boot
+ */
+struct Stats {
+    size_t size;         // 0 if init() failed or wasn't called
+    size_t peak;         // Most bytes in use at once
+    uint32_t overflows;  // Allocations that went to the heap instead
+};
+
+/**
+ * @brief Get the arena statistics
+ * @param out Receives them
+ */
+void getStats(Stats& out);
+
+/**
+ * @brief unique_ptr deleter for make() / makeArray(): destroys arena
+ *        objects in place, deletes heap ones
+ */
+template <typename T>
+struct Deleter {
+    Deleter() = default;
+
+    // Ptr<Derived> converts to Ptr<Base>, like std::default_delete
+    template <typename U, typename = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+    Deleter(const Deleter<U>&)
+    {
+    }
+
+    void operator()(T* p) const
+    {
+        if (owns(p)) {
+            p->~T();
+        } else {
+            delete p;
+        }
+    }
+};
+
+template <typename T>
+struct Deleter<T[]> {
+    void operator()(T* p) const
+    {
+        if (!owns(p)) {
+            delete[] p;
+        }
+    }
+};
+
+template <typename T>
+using Ptr = std::unique_ptr<T, Deleter<T>>;
+
+/**
+ * @brief Construct an object in the arena, or on the heap when it doesn't fit
+ * @return The object, empty if out of memory
+ */
+template <typename T, typename... Args>
+Ptr<T> make(Args&&... args)
+{
+    if (void* p = alloc(sizeof(T), alignof(T))) {
+        return Ptr<T>(new (p) T(std::forward<Args>(args)...));
+    }
+    return Ptr<T>(new (std::nothrow) T(std::forward<Args>(args)...));
+}
+
+/**
+ * @brief Uninitialized array of a trivial type, in the arena or on the heap
+ * @return The array, empty if out of memory
+ */
+template <typename T>
+Ptr<T[]> makeArray(size_t count)
+{
+    static_assert(std::is_trivial<T>::value, "arena arrays are never constructed or destroyed");
+    if (void* p = alloc(sizeof(T) * count, alignof(T))) {
+        return Ptr<T[]>(static_cast<T*>(p));
+    }
+    return Ptr<T[]>(new (std::nothrow) T[count]);
+}
+
+} // namespace SlideArena
@@ -0,0 +1,239 @@
+/**
+ * @file slide_cache.cpp
+ * @brief In-memory slide cache implementation
+ */
+
+#include "slide_cache.hpp"
+#include "config.hpp"
+#include "frame_codec.hpp"
+#include "tunables.hpp"
+#include "esp_log.h"
+#include "../components/Adafruit_EPD/src/Adafruit_EPD.h"
+#include <cinttypes>
+#include <cstring>
+#include <algorithm>
+
+static const char* TAG_CACHE = "SlideCache";
+
+// Entries are found by linear search; a few dozen are still cheap
+static constexpr size_t MAX_ENTRIES = 64;
+
+struct Entry {
+    uint8_t* data = nullptr;                   // Both planes back to back, in s_pool
+    uint32_t stored[2] = { 0, 0 };             // Bytes of each plane at data
+    bool encoded[2] = { false, false };        // RLE, or raw where that didn't pay
+    size_t index = SIZE_MAX;                   // SIZE_MAX when empty
+    uint32_t lastUse = 0;
+};
+
+static Entry s_entries[MAX_ENTRIES];
+static uint32_t s_sizes[2] = { 0, 0 };
+static size_t s_used = 0;      // Bytes held by entries
+static size_t s_budget = SLIDE_CACHE_BUDGET;  // The cache_budget tunable, then the block's size
+static uint8_t* s_pool = nullptr;  // s_budget bytes, from init()
+static size_t s_top = 0;       // End of the highest entry; stores append here
+static uint32_t s_clock = 0;   // Bumped on every use, for LRU order
+static bool s_initialized = false;
+
+bool SlideCache::init(uint32_t plane1Size, uint32_t plane2Size)
+{
+    if (!s_initialized) {
+        s_initialized = true;
+        s_sizes[0] = plane1Size;
+        s_sizes[1] = plane2Size;
+        s_budget = Tunables::get(Tunables::Id::CACHE_BUDGET);
+        size_t slideSize = static_cast<size_t>(plane1Size) + plane2Size;
+        while (slideSize > 0 && s_budget >= slideSize && !s_pool) {
+            s_pool = Adafruit_EPD::allocFramebuffer(s_budget);
+            if (!s_pool) {
+                s_budget = s_budget / 2 >= slideSize ? s_budget / 2 : 0;
+            }
+        }
+        if (!s_pool) {
+            s_budget = 0;
+        }
+        ESP_LOGI(TAG_CACHE, "%zu bytes for slides of %" PRIu32 " bytes before compression",
+                 s_budget, plane1Size + plane2Size);
+    }
+    return s_pool && s_budget >= static_cast<size_t>(s_sizes[0]) + s_sizes[1];
+}
+
+size_t SlideCache::capacity()
+{
+    size_t slideSize = static_cast<size_t>(s_sizes[0]) + s_sizes[1];
+    if (slideSize == 0 || s_budget < slideSize) {
+        return 0;
+    }
+    // At the compression of the slides held so far; raw ones until there are any
+    size_t held = 0;
+    for (const Entry& entry : s_entries) {
+        held += entry.index != SIZE_MAX ? 1 : 0;
+    }
+    size_t average = held ? std::max<size_t>(s_used / held, 1) : slideSize;
+    return std::min(s_budget / average, MAX_ENTRIES);
+}
+
+static Entry* find(size_t index)
+{
+    for (Entry& entry : s_entries) {
+        if (entry.index == index) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+static size_t bytes(const Entry& entry)
+{
+    return static_cast<size_t>(entry.stored[0]) + entry.stored[1];
+}
+
+static void release(Entry& entry)
+{
+    if (entry.data) {
+        s_used -= bytes(entry);
+        // Freed at the top: the next store may append lower
+        if (entry.data + bytes(entry) == s_pool + s_top) {
+            s_top = 0;
+            for (const Entry& other : s_entries) {
+                if (other.data && &other != &entry) {
+                    s_top = std::max<size_t>(s_top, other.data + bytes(other) - s_pool);
+                }
+            }
+        }
+    }
+    entry.data = nullptr;
+    entry.stored[0] = entry.stored[1] = 0;
+    entry.index = SIZE_MAX;
+}
+
+/**
+ * @brief Move the entries down to the start of the block, in address
+ *        order, so the room evictions left is in one piece at the top
+ */
+static void compact()
+{
+    Entry* order[MAX_ENTRIES];
+    size_t count = 0;
+    for (Entry& entry : s_entries) {
+        if (entry.data) {
+            order[count++] = &entry;
+        }
+    }
+    std::sort(order, order + count, [](const Entry* a, const Entry* b) {
+        return a->data < b->data;
+    });
+    s_top = 0;
+    for (size_t i = 0; i < count; i++) {
+        memmove(s_pool + s_top, order[i]->data, bytes(*order[i]));
+        order[i]->data = s_pool + s_top;
+        s_top += bytes(*order[i]);
+    }
+}
+
+bool SlideCache::fetch(size_t index, uint8_t* plane1, uint8_t* plane2)
+{
+    Entry* entry = find(index);
+    if (!entry) {
+        return false;
+    }
+    uint8_t* planes[2] = { plane1, plane2 };
+    const uint8_t* src = entry->data;
+    for (uint8_t p = 0; p < 2 && s_sizes[p]; p++) {
+        if (!entry->encoded[p]) {
+            memcpy(planes[p], src, s_sizes[p]);
+        } else if (!FrameCodec::decodeRLE(src, entry->stored[p], planes[p], s_sizes[p])) {
+            release(*entry);  // Can't happen short of memory corruption
+            return false;
+        }
+        src += entry->stored[p];
+    }
+    entry->lastUse = ++s_clock;
+    return true;
+}
+
+bool SlideCache::contains(size_t index)
+{
+    return find(index) != nullptr;
+}
+
+/**
+ * @brief The least recently used entry holding a slide, other than keep
+ */
+static Entry* oldest(const Entry* keep)
+{
+    Entry* found = nullptr;
+    for (Entry& entry : s_entries) {
+        if (&entry != keep && entry.index != SIZE_MAX &&
+            (!found || entry.lastUse < found->lastUse)) {
+            found = &entry;
+        }
+    }
+    return found;
+}
+
+void SlideCache::store(size_t index, const uint8_t* plane1, const uint8_t* plane2)
+{
+    size_t slideSize = static_cast<size_t>(s_sizes[0]) + s_sizes[1];
+    if (!s_pool || slideSize == 0 || s_budget < slideSize) {
+        return;
+    }
+
+    // Measure first, so the entry is allocated at its encoded size
+    const uint8_t* planes[2] = { plane1, plane2 };
+    uint32_t stored[2] = { 0, 0 };
+    bool encoded[2] = { false, false };
+    for (uint8_t p = 0; p < 2 && s_sizes[p]; p++) {
+        size_t rle = FrameCodec::encodeRLE(planes[p], s_sizes[p], nullptr);
+        encoded[p] = rle < s_sizes[p];
+        stored[p] = encoded[p] ? rle : s_sizes[p];
+    }
+    size_t need = static_cast<size_t>(stored[0]) + stored[1];
+
+    // The slide's own entry, else an empty one, else the oldest; it is
+    // written anew at the top
+    Entry* entry = find(index);
+    for (size_t i = 0; i < MAX_ENTRIES && !entry; i++) {
+        if (s_entries[i].index == SIZE_MAX) {
+            entry = &s_entries[i];
+        }
+    }
+    if (!entry) {
+        entry = oldest(nullptr);
+    }
+    release(*entry);
+    // Evict until the block has room; need never exceeds it
+    while (s_used + need > s_budget) {
+        release(*oldest(entry));
+    }
+    if (s_top + need > s_budget) {
+        compact();
+    }
+    entry->data = s_pool + s_top;
+    s_top += need;
+    s_used += need;
+
+    uint8_t* dst = entry->data;
+    for (uint8_t p = 0; p < 2 && s_sizes[p]; p++) {
+        if (encoded[p]) {
+            FrameCodec::encodeRLE(planes[p], s_sizes[p], dst);
+        } else {
+            memcpy(dst, planes[p], s_sizes[p]);
+        }
+        entry->stored[p] = stored[p];
+        entry->encoded[p] = encoded[p];
+        dst += stored[p];
+    }
+    entry->index = index;
+    entry->lastUse = ++s_clock;
+    ESP_LOGD(TAG_CACHE, "Slide %zu: %zu of %zu bytes, %zu cached in %zu", index + 1, need,
+             slideSize, capacity(), s_used);
+}
+
+void SlideCache::clear()
+{
+    for (Entry& entry : s_entries) {
+        release(entry);
+    }
+    s_top = 0;
+}
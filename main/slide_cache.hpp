@@ -0,0 +1,75 @@
+/**
+ * @file slide_cache.hpp
+ * @brief In-memory LRU of decoded slides, keyed by image index
+ *
+ * Holds copies of recently decoded frames (both packed planes, as the
+ * display keeps them), so going back to one costs an RLE decode, the SPI
+ * upload and the refresh instead of an SD read and a full decode. Each
+ * plane is kept RLE-encoded (FrameCodec::encodeRLE()), or raw when that
+ * wouldn't be smaller: mostly white planes and a nearly empty color plane
+ * shrink several times over, so the budget (the cache_budget tunable,
+ * SLIDE_CACHE_BUDGET by default) holds that many more slides. A hit
+ * decodes straight into the destination planes.
+ * Entries live in one block of the budget's size, allocated by init() with
+ * Adafruit_EPD::allocFramebuffer() so it follows the framebuffer memory
+ * policy. A store appends at the block's end and compacts the entries
+ * when evictions left the room in holes, so caching never touches the
+ * heap after init(). Only for the slideshow task.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace SlideCache {
+
+/**
+ * @brief Size the cache for the display's planes and allocate its block;
+ *        later calls do nothing
+ *
+ * A block the heap refuses is halved until it fits, down to one
+ * uncompressed slide.
+ *
+ * @param plane1Size Black plane bytes
+ * @param plane2Size Color plane bytes, 0 for a single-plane display
+ * @return true if the block holds at least one uncompressed slide
+ */
+bool init(uint32_t plane1Size, uint32_t plane2Size);
+
+/**
+ * @brief Decode a cached slide into planes, making it the most recently used
+ * @param index Image index
+ * @param plane1 Destination black plane
+ * @param plane2 Destination color plane (ignored for a single-plane display)
+ * @return false if the slide isn't cached
+ */
+bool fetch(size_t index, uint8_t* plane1, uint8_t* plane2);
+
+/**
+ * @brief Slides the budget holds at the compression of those cached so far
+ *        (uncompressed while it is empty), 0 before init() or when disabled
+ */
+size_t capacity();
+
+/**
+ * @brief Check whether a slide is cached, without touching its age
+ */
+bool contains(size_t index);
+
+/**
+ * @brief Encode a decoded slide into the cache, evicting the least recently
+ *        used ones until the budget has room for it
+ * @param index Image index
+ * @param plane1 Black plane
+ * @param plane2 Color plane (ignored for a single-plane display)
+ */
+void store(size_t index, const uint8_t* plane1, const uint8_t* plane2);
+
+/**
+ * @brief Forget every slide, e.g. when the images behind the indices
+ *        change; the block is kept
+ */
+void clear();
+
+} // namespace SlideCache
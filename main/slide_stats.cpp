@@ -0,0 +1,518 @@
+/**
+ * @file slide_stats.cpp
+ * @brief Per-slide pipeline stage timing, SPI traffic and memory watermarks
+ */
+
+#include "slide_stats.hpp"
+#include "pipeline_trace.hpp"
+#include "heap_watch.hpp"
+#include "config.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <cinttypes>
+#include <cstdio>
+#include <algorithm>
+#include <iterator>
+
+static const char* TAG_STATS = "SlideStats";
+
+static constexpr size_t STAGE_COUNT = static_cast<size_t>(SlideStats::Stage::COUNT);
+
+namespace {
+
+struct Record {
+    uint32_t id;               // 0 = unused slot
+    size_t index;              // Slide index
+    uint32_t us[STAGE_COUNT];  // Time per stage
+    uint16_t mask;             // Stages that ran
+    bool hasSpi;               // addSpi() was called
+    SlideStats::SpiCounters spi;
+    // Memory low points, UINT32_MAX until sampled (clearMemory())
+    uint32_t heapMin[STAGE_COUNT];  // Least free heap at the stage's boundaries
+    uint32_t minFree;               // Least free heap over the whole record
+    uint32_t minBlock;              // Least largest free block
+    uint32_t minStack;              // Least stack high-water mark, bytes
+    bool alarm;                     // Crossed a config.hpp alarm threshold
+    uint32_t allocs;                // HeapWatch allocations between begin() and end()
+    int64_t inputAt;                // Input the slide answers, 0 for none
+    bool hasLatency;                // addRefresh() came after an input
+    uint32_t toStartUs;             // Input to refresh start
+    uint32_t toDoneUs;              // Input to refresh done
+};
+static_assert(STAGE_COUNT <= 16, "Record::mask holds one bit per stage");
+
+} // namespace
+
+// Closed records, slot (id - 1) % SLIDE_STATS_HISTORY. s_lock guards the
+// history and s_boot, which summarize() reads from other tasks.
+static Record s_history[SLIDE_STATS_HISTORY];
+static Record s_boot;            // Stages timed outside any record
+static Record s_current;         // The open record, slideshow task only
+static bool s_open = false;
+static uint32_t s_nextId = 1;
+static SlideStats::Timer* s_active = nullptr;
+static uint32_t s_allocsAtBegin = 0;  // HeapWatch::allocations() when s_current began
+static SemaphoreHandle_t s_lock = nullptr;
+
+static void lock()
+{
+    if (s_lock) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+    }
+}
+
+static void unlock()
+{
+    if (s_lock) {
+        xSemaphoreGive(s_lock);
+    }
+}
+
+static void clearMemory(Record& record)
+{
+    std::fill(std::begin(record.heapMin), std::end(record.heapMin), UINT32_MAX);
+    record.minFree = UINT32_MAX;
+    record.minBlock = UINT32_MAX;
+    record.minStack = UINT32_MAX;
+}
+
+namespace {
+
+/**
+ * @brief One reading of the heap and, for full samples, block and stack
+ */
+struct MemorySample {
+    uint32_t freeHeap;
+    uint32_t largestBlock;  // UINT32_MAX if not read
+    uint32_t stackFree;     // UINT32_MAX if not read
+};
+
+} // namespace
+
+static MemorySample readMemory(bool full)
+{
+    MemorySample sample = {static_cast<uint32_t>(heap_caps_get_free_size(MALLOC_CAP_8BIT)),
+                           UINT32_MAX, UINT32_MAX};
+    if (full) {
+        sample.largestBlock =
+            static_cast<uint32_t>(heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+        // Bytes on ESP-IDF, where stacks are sized in bytes
+        sample.stackFree = static_cast<uint32_t>(uxTaskGetStackHighWaterMark(nullptr));
+    }
+    return sample;
+}
+
+static void applyMemory(Record& record, SlideStats::Stage stage, const MemorySample& sample)
+{
+    size_t i = static_cast<size_t>(stage);
+    if (i < STAGE_COUNT) {
+        record.heapMin[i] = std::min(record.heapMin[i], sample.freeHeap);
+    }
+    record.minFree = std::min(record.minFree, sample.freeHeap);
+    record.minBlock = std::min(record.minBlock, sample.largestBlock);
+    record.minStack = std::min(record.minStack, sample.stackFree);
+}
+
+/**
+ * @brief Sample memory at a stage boundary into the open or the boot record
+ * @param full Also read the largest free block and the stack watermark
+ */
+static void sampleMemory(SlideStats::Stage stage, bool full)
+{
+    MemorySample sample = readMemory(full);
+    if (s_open) {
+        applyMemory(s_current, stage, sample);
+        return;
+    }
+    lock();
+    applyMemory(s_boot, stage, sample);
+    unlock();
+}
+
+/**
+ * @brief Raise the alarm if the heap is fragmented or the stack nearly full
+ * @param record Record being closed, sampled just now
+ * @param now The closing sample
+ */
+static void checkMemory(Record& record, const MemorySample& now)
+{
+    bool fragmented = now.largestBlock < HEAP_MIN_LARGEST_BLOCK ||
+                      static_cast<uint64_t>(now.largestBlock) * 100 <
+                          static_cast<uint64_t>(now.freeHeap) * HEAP_FRAGMENTATION_ALARM_PERCENT;
+    bool stackLow = record.minStack < STACK_FREE_ALARM_BYTES;
+    if (fragmented) {
+        ESP_LOGW(TAG_STATS, "Slide %zu: heap fragmented, largest block %" PRIu32 " of %" PRIu32
+                 " bytes free", record.index + 1, now.largestBlock, now.freeHeap);
+    }
+    if (stackLow) {
+        ESP_LOGW(TAG_STATS, "Slide %zu: only %" PRIu32 " bytes of stack never used",
+                 record.index + 1, record.minStack);
+    }
+    record.alarm = fragmented || stackLow;
+}
+
+static uint32_t saturate(int64_t us)
+{
+    return static_cast<uint32_t>(std::clamp<int64_t>(us, 0, UINT32_MAX));
+}
+
+/**
+ * @brief Nearest-rank percentile of count samples, sorted in place
+ */
+static uint32_t percentile(uint32_t* samples, size_t count, uint32_t percent)
+{
+    if (count == 0) {
+        return 0;
+    }
+    std::sort(samples, samples + count);
+    size_t rank = (percent * count + 99) / 100;
+    return samples[rank ? rank - 1 : 0];
+}
+
+static void accumulate(Record& record, SlideStats::Stage stage, int64_t us)
+{
+    size_t i = static_cast<size_t>(stage);
+    if (i >= STAGE_COUNT || us < 0) {
+        return;
+    }
+    uint64_t total = static_cast<uint64_t>(record.us[i]) + static_cast<uint64_t>(us);
+    record.us[i] = static_cast<uint32_t>(std::min<uint64_t>(total, UINT32_MAX));
+    record.mask |= 1u << i;
+}
+
+/**
+ * @brief Add a timer's share to the open record, or to the boot record
+ */
+static void charge(SlideStats::Stage stage, int64_t us)
+{
+    if (s_open) {
+        accumulate(s_current, stage, us);
+        return;
+    }
+    lock();
+    accumulate(s_boot, stage, us);
+    unlock();
+}
+
+bool SlideStats::init()
+{
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+        clearMemory(s_boot);
+    }
+    return s_lock != nullptr;
+}
+
+const char* SlideStats::stageName(Stage stage)
+{
+    static const char* const names[STAGE_COUNT] = {
+        "mount", "scan", "open", "read", "decode", "pack", "wait",
+        "power-up", "plane1", "plane2", "refresh", "power-down",
+    };
+    size_t i = static_cast<size_t>(stage);
+    return i < STAGE_COUNT ? names[i] : "?";
+}
+
+SlideStats::Timer::Timer(Stage stage)
+    : stage_(stage), start_(esp_timer_get_time()), outer_(s_active)
+{
+    // Boot stages aren't split: an OPEN inside SCAN is scanning
+    if (outer_ && !s_open) {
+        stage_ = outer_->stage_;
+    }
+    // Stop the outer stage's clock; it restarts when this timer ends
+    if (outer_) {
+        charge(outer_->stage_, start_ - outer_->start_);
+    }
+    sampleMemory(stage_, false);
+    s_active = this;
+    PipelineTrace::begin(stage_);
+}
+
+SlideStats::Timer::~Timer()
+{
+    int64_t now = esp_timer_get_time();
+    PipelineTrace::end(stage_);
+    charge(stage_, now - start_);
+    sampleMemory(stage_, outer_ == nullptr);
+    s_active = outer_;
+    if (outer_) {
+        outer_->start_ = now;
+    }
+}
+
+void SlideStats::begin(size_t index, int64_t inputAt)
+{
+    if (s_open) {
+        end();
+    }
+    s_current = {};
+    clearMemory(s_current);
+    s_current.id = s_nextId++;
+    if (s_nextId == 0) {
+        s_nextId = 1;  // 0 means "no record"
+    }
+    s_current.index = index;
+    s_current.inputAt = inputAt;
+    s_open = true;
+    s_allocsAtBegin = HeapWatch::allocations();
+    // Track the heap's low point in between samples too
+    heap_caps_monitor_local_minimum_free_size_start();
+}
+
+uint32_t SlideStats::end()
+{
+    if (!s_open) {
+        return 0;
+    }
+    MemorySample now = readMemory(true);
+    applyMemory(s_current, Stage::COUNT, now);
+    // The monitor also caught the lows in between samples
+    s_current.minFree = std::min(
+        s_current.minFree, static_cast<uint32_t>(heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT)));
+    heap_caps_monitor_local_minimum_free_size_stop();
+    checkMemory(s_current, now);
+    s_current.allocs = HeapWatch::allocations() - s_allocsAtBegin;
+
+    // Running timers carry on into whatever comes next
+    s_open = false;
+    lock();
+    s_history[(s_current.id - 1) % SLIDE_STATS_HISTORY] = s_current;
+    unlock();
+    return s_current.id;
+}
+
+void SlideStats::add(uint32_t id, Stage stage, int64_t us)
+{
+    if (id == 0) {
+        return;
+    }
+    lock();
+    Record& record = s_history[(id - 1) % SLIDE_STATS_HISTORY];
+    if (record.id == id) {
+        accumulate(record, stage, us);
+    }
+    unlock();
+}
+
+void SlideStats::addRefresh(uint32_t id, int64_t startAt, int64_t doneAt)
+{
+    if (id == 0) {
+        return;
+    }
+    lock();
+    Record& record = s_history[(id - 1) % SLIDE_STATS_HISTORY];
+    if (record.id == id && record.inputAt != 0 && startAt >= record.inputAt) {
+        record.toStartUs = saturate(startAt - record.inputAt);
+        record.toDoneUs = saturate(doneAt - record.inputAt);
+        record.hasLatency = true;
+    }
+    unlock();
+}
+
+void SlideStats::addSpi(uint32_t id, const SpiCounters& counters)
+{
+    if (id == 0) {
+        return;
+    }
+    lock();
+    Record& record = s_history[(id - 1) % SLIDE_STATS_HISTORY];
+    if (record.id == id) {
+        record.spi.transactions += counters.transactions;
+        record.spi.bytes += counters.bytes;
+        record.spi.busyUs += counters.busyUs;
+        record.spi.queuePeak = std::max(record.spi.queuePeak, counters.queuePeak);
+        record.hasSpi = true;
+    }
+    unlock();
+}
+
+bool SlideStats::get(uint32_t id, RecordView& out)
+{
+    if (id == 0) {
+        return false;
+    }
+    lock();
+    Record record = s_history[(id - 1) % SLIDE_STATS_HISTORY];
+    unlock();
+    if (record.id != id) {
+        return false;
+    }
+
+    auto sampled = [](uint32_t value) {
+        return value == UINT32_MAX ? 0 : value;
+    };
+    out.index = record.index;
+    std::copy(std::begin(record.us), std::end(record.us), out.us);
+    out.mask = record.mask;
+    out.hasSpi = record.hasSpi;
+    out.spi = record.spi;
+    out.minFreeHeap = sampled(record.minFree);
+    out.minLargestBlock = sampled(record.minBlock);
+    out.minStackFree = sampled(record.minStack);
+    out.alarm = record.alarm;
+    out.heapAllocs = record.allocs;
+    out.hasLatency = record.hasLatency;
+    out.inputToStartUs = record.toStartUs;
+    out.inputToDoneUs = record.toDoneUs;
+    return true;
+}
+
+void SlideStats::log(uint32_t id)
+{
+    if (id == 0) {
+        return;
+    }
+    lock();
+    Record record = s_history[(id - 1) % SLIDE_STATS_HISTORY];
+    unlock();
+    if (record.id != id) {
+        return;
+    }
+
+    char line[192];
+    size_t len = 0;
+    uint64_t total = 0;
+    for (size_t i = 0; i < STAGE_COUNT && len < sizeof(line); i++) {
+        if (!(record.mask & (1u << i))) {
+            continue;
+        }
+        total += record.us[i];
+        int n = snprintf(line + len, sizeof(line) - len, " %s %" PRIu32 ".%" PRIu32,
+                         stageName(static_cast<Stage>(i)), record.us[i] / 1000,
+                         (record.us[i] / 100) % 10);
+        len += n > 0 ? static_cast<size_t>(n) : 0;
+    }
+    line[std::min(len, sizeof(line) - 1)] = '\0';
+
+    char spi[80] = "";
+    if (record.hasSpi) {
+        snprintf(spi, sizeof(spi),
+                 ", SPI %" PRIu32 " txn %" PRIu32 " B busy %" PRIu32 " ms queue %" PRIu32,
+                 record.spi.transactions, record.spi.bytes, record.spi.busyUs / 1000,
+                 record.spi.queuePeak);
+    }
+    char latency[48] = "";
+    if (record.hasLatency) {
+        snprintf(latency, sizeof(latency), ", input to refresh %" PRIu32 "/%" PRIu32 " ms",
+                 record.toStartUs / 1000, record.toDoneUs / 1000);
+    }
+    char allocs[24] = "";
+    if (HeapWatch::available()) {
+        snprintf(allocs, sizeof(allocs), " allocs %" PRIu32, record.allocs);
+    }
+    ESP_LOGI(TAG_STATS, "Slide %zu:%s ms (total %" PRIu32 " ms)%s%s, heap min %" PRIu32
+             " block %" PRIu32 " stack %" PRIu32 "%s", record.index + 1, line,
+             static_cast<uint32_t>(total / 1000), spi, latency, record.minFree, record.minBlock,
+             record.minStack, allocs);
+}
+
+void SlideStats::logHistory()
+{
+    uint32_t ids[SLIDE_STATS_HISTORY];
+    size_t count = 0;
+    lock();
+    for (const Record& record : s_history) {
+        if (record.id != 0) {
+            ids[count++] = record.id;
+        }
+    }
+    unlock();
+    // Ids only grow, and the ring holds a window of them
+    std::sort(ids, ids + count);
+    for (size_t i = 0; i < count; i++) {
+        log(ids[i]);
+    }
+}
+
+void SlideStats::summarize(Summary& out)
+{
+    out = {};
+    uint64_t sums[STAGE_COUNT] = {};
+    uint64_t spiTransactions = 0;
+    uint64_t spiBytes = 0;
+    uint64_t spiBusyUs = 0;
+    uint32_t toStart[SLIDE_STATS_HISTORY];
+    uint32_t toDone[SLIDE_STATS_HISTORY];
+
+    Record low = {};  // Memory low points over every record
+    clearMemory(low);
+
+    auto include = [&out, &sums, &low](const Record& record) {
+        for (size_t i = 0; i < STAGE_COUNT; i++) {
+            low.heapMin[i] = std::min(low.heapMin[i], record.heapMin[i]);
+            if (!(record.mask & (1u << i))) {
+                continue;
+            }
+            StageSummary& stage = out.stages[i];
+            uint32_t us = record.us[i];
+            stage.minUs = stage.count ? std::min(stage.minUs, us) : us;
+            stage.maxUs = std::max(stage.maxUs, us);
+            stage.count++;
+            sums[i] += us;
+        }
+        low.minFree = std::min(low.minFree, record.minFree);
+        low.minBlock = std::min(low.minBlock, record.minBlock);
+        low.minStack = std::min(low.minStack, record.minStack);
+        out.memory.alarms += record.alarm ? 1 : 0;
+    };
+
+    lock();
+    for (const Record& record : s_history) {
+        if (record.id != 0) {
+            out.slides++;
+            include(record);
+        }
+        if (record.id != 0 && record.hasSpi) {
+            SpiSummary& spi = out.spi;
+            spi.count++;
+            spi.maxTransactions = std::max(spi.maxTransactions, record.spi.transactions);
+            spi.maxBytes = std::max(spi.maxBytes, record.spi.bytes);
+            spi.queuePeak = std::max(spi.queuePeak, record.spi.queuePeak);
+            spiTransactions += record.spi.transactions;
+            spiBytes += record.spi.bytes;
+            spiBusyUs += record.spi.busyUs;
+        }
+        if (record.id != 0 && record.allocs != 0) {
+            out.memory.allocSlides++;
+            out.memory.maxAllocs = std::max(out.memory.maxAllocs, record.allocs);
+        }
+        if (record.id != 0 && record.hasLatency) {
+            toStart[out.latency.count] = record.toStartUs;
+            toDone[out.latency.count] = record.toDoneUs;
+            out.latency.count++;
+        }
+    }
+    include(s_boot);
+    unlock();
+
+    // Never sampled reads as 0
+    auto sampled = [](uint32_t value) {
+        return value == UINT32_MAX ? 0 : value;
+    };
+    for (size_t i = 0; i < STAGE_COUNT; i++) {
+        if (out.stages[i].count) {
+            out.stages[i].avgUs = static_cast<uint32_t>(sums[i] / out.stages[i].count);
+        }
+        out.stages[i].minFreeHeap = sampled(low.heapMin[i]);
+    }
+    out.memory.minFreeHeap = sampled(low.minFree);
+    out.memory.minLargestBlock = sampled(low.minBlock);
+    out.memory.minStackFree = sampled(low.minStack);
+    if (out.spi.count) {
+        out.spi.avgTransactions = static_cast<uint32_t>(spiTransactions / out.spi.count);
+        out.spi.avgBytes = static_cast<uint32_t>(spiBytes / out.spi.count);
+        out.spi.avgBusyUs = static_cast<uint32_t>(spiBusyUs / out.spi.count);
+    }
+    LatencySummary& latency = out.latency;
+    latency.startP50Us = percentile(toStart, latency.count, 50);
+    latency.startP90Us = percentile(toStart, latency.count, 90);
+    latency.startMaxUs = percentile(toStart, latency.count, 100);
+    latency.doneP50Us = percentile(toDone, latency.count, 50);
+    latency.doneP90Us = percentile(toDone, latency.count, 90);
+    latency.doneMaxUs = percentile(toDone, latency.count, 100);
+}
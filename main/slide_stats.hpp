@@ -0,0 +1,241 @@
+/**
+ * @file slide_stats.hpp
+ * @brief Per-slide pipeline stage timing, SPI traffic and memory watermarks
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace SlideStats {
+
+/**
+ * @brief Pipeline stages, in the order a slide goes through them
+ */
+enum class Stage : uint8_t {
+    MOUNT,       // SD card mount (boot only)
+    SCAN,        // Image list / pack table (boot only)
+    OPEN,        // Opening the image file
+    READ,        // fread() of image data
+    DECODE,      // Decoding, scaling and dithering, without READ and PACK
+    PACK,        // Writing decoded rows into the framebuffer planes
+    WAIT,        // Waiting for the previous upload to free the framebuffer
+    POWER_UP,    // Panel reset and init before the upload
+    PLANE1,      // SPI upload of the first plane
+    PLANE2,      // SPI upload of the second plane
+    REFRESH,     // update(): the panel refresh (BUSY)
+    POWER_DOWN,  // Panel power down after the refresh
+    COUNT
+};
+
+/**
+ * @brief Create the lock summarize() takes; call once before anything is timed
+ * @return true if successful
+ */
+bool init();
+
+/**
+ * @brief Short stage name for logs
+ */
+const char* stageName(Stage stage);
+
+/**
+ * @brief Times a stage for as long as it is in scope
+ *
+ * Timers nest: while an inner timer runs, the outer stage's clock is
+ * stopped, so a READ inside a DECODE is not counted twice. Outside a
+ * record (boot), inner timers count towards the outer stage instead. Only
+ * for the slideshow task.
+ *
+ * Free heap is sampled whenever a timer starts or ends. The largest free
+ * block and the task's stack high-water mark cost more, so they are only
+ * sampled when a top-level (not nested) timer ends.
+ */
+class Timer {
+public:
+    explicit Timer(Stage stage);
+    ~Timer();
+
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
+private:
+    Stage stage_;
+    int64_t start_;
+    Timer* outer_;
+};
+
+/**
+ * @brief Start a record for one slide; stages timed until end() go into it
+ * @param index Slide index
+ * @param inputAt esp_timer time of the button press or command the slide
+ *        answers (SlideshowButtonEvent::stamp), 0 for none
+ */
+void begin(size_t index, int64_t inputAt = 0);
+
+/**
+ * @brief Close the current record and add it to the history
+ * @return Record id for add() and log(), 0 if no record was open
+ */
+uint32_t end();
+
+/**
+ * @brief Add a stage time to a closed record
+ *
+ * The panel refresh runs in the background, so its stages usually arrive
+ * after end(). Ignored once the record has dropped out of the history.
+ *
+ * @param id Record id from end()
+ * @param stage Stage
+ * @param us Time spent, in microseconds
+ */
+void add(uint32_t id, Stage stage, int64_t us);
+
+/**
+ * @brief Add the panel refresh to a closed record, for its input latency
+ *
+ * Only records begun with an input stamp get a latency. Ignored once the
+ * record has dropped out of the history.
+ *
+ * @param id Record id from end()
+ * @param startAt esp_timer time the panel started to change (REFRESH began)
+ * @param doneAt esp_timer time the refresh ended
+ */
+void addRefresh(uint32_t id, int64_t startAt, int64_t doneAt);
+
+/**
+ * @brief SPI traffic of one slide (see BusIOStats in the BusIO component)
+ */
+struct SpiCounters {
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t busyUs;     // Time blocked in transmits
+    uint32_t queuePeak;  // Most transactions in flight at once
+};
+
+/**
+ * @brief Add SPI traffic to a closed record
+ *
+ * Counts add up over calls, so the display and the bus can be added
+ * separately. Ignored once the record has dropped out of the history.
+ *
+ * @param id Record id from end()
+ * @param counters Traffic since the slide began
+ */
+void addSpi(uint32_t id, const SpiCounters& counters);
+
+/**
+ * @brief One closed record, as get() copies it out
+ */
+struct RecordView {
+    size_t index;  // Slide index
+    uint32_t us[static_cast<size_t>(Stage::COUNT)];  // Time per stage
+    uint16_t mask;  // Stages that ran, one bit each
+    bool hasSpi;
+    SpiCounters spi;
+    uint32_t minFreeHeap;      // Least free heap during the slide, 0 if never sampled
+    uint32_t minLargestBlock;  // Least largest free block, 0 if never sampled
+    uint32_t minStackFree;     // Least stack never used, 0 if never sampled
+    bool alarm;                // Crossed a memory alarm threshold
+    uint32_t heapAllocs;       // Heap allocations of the slideshow task (HeapWatch)
+    bool hasLatency;           // Answered an input and its refresh ran
+    uint32_t inputToStartUs;   // Input to the panel starting to change
+    uint32_t inputToDoneUs;    // Input to the refresh being done
+};
+
+/**
+ * @brief Copy a closed record out of the history
+ * @param id Record id from end()
+ * @param out Receives the record
+ * @return false once the record has dropped out of the history
+ */
+bool get(uint32_t id, RecordView& out);
+
+/**
+ * @brief Log one record's stages on a single line
+ * @param id Record id from end()
+ */
+void log(uint32_t id);
+
+/**
+ * @brief Log every record in the history, oldest first; safe from any task
+ */
+void logHistory();
+
+/**
+ * @brief Time spent in a stage over the records that include it
+ */
+struct StageSummary {
+    uint32_t count;  // Records that include the stage
+    uint32_t minUs;
+    uint32_t avgUs;
+    uint32_t maxUs;
+    uint32_t minFreeHeap;  // Least free heap as the stage started or ended, 0 if unknown
+};
+
+/**
+ * @brief SPI traffic per slide over the records that have it
+ */
+struct SpiSummary {
+    uint32_t count;  // Records with SPI counters
+    uint32_t avgTransactions;
+    uint32_t maxTransactions;
+    uint32_t avgBytes;
+    uint32_t maxBytes;
+    uint32_t avgBusyUs;
+    uint32_t queuePeak;  // Highest over all of them
+};
+
+/**
+ * @brief Memory low points over the history, boot included
+ *
+ * Checked against the HEAP_ and STACK_ alarm thresholds in config.hpp as
+ * each slide ends; a slide that crosses one is logged as a warning and
+ * counted here. Fields never sampled read 0.
+ */
+struct MemorySummary {
+    uint32_t minFreeHeap;      // Least free heap at any time during a slide
+    uint32_t minLargestBlock;  // Least largest free block
+    uint32_t minStackFree;     // Least stack never used by the timing task
+    uint32_t alarms;           // Slides in the history that raised an alarm
+    uint32_t allocSlides;      // Slides that allocated from the heap (HeapWatch)
+    uint32_t maxAllocs;        // Most heap allocations in one slide
+};
+
+/**
+ * @brief Input latency over the records that answered a button or command
+ *
+ * Nearest-rank percentiles; with at most SLIDE_STATS_HISTORY samples, p90
+ * is the worst slide or close to it.
+ */
+struct LatencySummary {
+    uint32_t count;       // Records with a latency
+    uint32_t startP50Us;  // Input to refresh start
+    uint32_t startP90Us;
+    uint32_t startMaxUs;
+    uint32_t doneP50Us;   // Input to refresh done
+    uint32_t doneP90Us;
+    uint32_t doneMaxUs;
+};
+
+/**
+ * @brief Stage statistics over the last SLIDE_STATS_HISTORY slides
+ *
+ * MOUNT and SCAN come from boot and have a count of at most 1.
+ */
+struct Summary {
+    size_t slides;  // Records in the history
+    StageSummary stages[static_cast<size_t>(Stage::COUNT)];
+    SpiSummary spi;
+    MemorySummary memory;
+    LatencySummary latency;
+};
+
+/**
+ * @brief Summarize the history; safe from any task
+ * @param out Receives the statistics
+ */
+void summarize(Summary& out);
+
+} // namespace SlideStats
@@ -8,39 +8,320 @@
 #include "sd_card.hpp"
 #include "image_loader.hpp"
 #include "button.hpp"
+#include "text_layout.hpp"
+#include "font_atlas.hpp"
+#include "panel.hpp"
+#include "slide_stats.hpp"
+#include "perf_log.hpp"
+#include "pipeline_trace.hpp"
+#include "telemetry.hpp"
+#include "slide_arena.hpp"
+#include "slide_cache.hpp"
+#include "bad_images.hpp"
+#include "captions.hpp"
+#include "flash_pack.hpp"
+#include "read_ahead.hpp"
+#include "dither_pool.hpp"
+#include "render_job.hpp"
+#include "wifi_sync.hpp"
+#include "wifi_radio.hpp"
+#include "frame_push.hpp"
+#include "ble_upload.hpp"
+#include "frame_cast.hpp"
+#include "power_stats.hpp"
+#include "boot_profile.hpp"
+#include "cpu_boost.hpp"
+#include "render_flow.hpp"
+#include "schedule.hpp"
+#include "shuffle.hpp"
+#include "playlists.hpp"
+#include "prefetch_plan.hpp"
+#include "cache_warm.hpp"
+#include "usb_storage.hpp"
+#include "battery.hpp"
+#include "refresh_timing.hpp"
+#include "status_display.hpp"
+#include "bench.hpp"
+#include "animation.hpp"
+#include "widgets.hpp"
+#include "spi_record.hpp"
+#include "tunables.hpp"
+#include "ram_budget.hpp"
+#include "heap_watch.hpp"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "esp_sleep.h"
+#include "esp_attr.h"
+#include "sdkconfig.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
 #include "../components/Adafruit_EPD/src/Adafruit_EPD.h"
 #include "../components/Adafruit_BusIO_ESPIDF/SPI.h"
 #include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cinttypes>
+#include <sys/time.h>
 #include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <new>
 
 static const char* TAG_SLIDE = "Slideshow";
 
 // Display object
-static Adafruit_IL0373* g_display = nullptr;
+static Display* g_display = nullptr;
 
 // State
 static Slideshow::State s_state = Slideshow::State::INIT;
-static std::vector<std::string> s_imageFiles;
+static SDCard::ImageList s_imageFiles;
+static SDCard::ImageCursor s_imageCursor;  // Replaces s_imageFiles when open
+static SDCard::ImagePack s_imagePack;      // Replaces both when open; FlashPack replaces all three
 static size_t s_currentImageIndex = 0;
 static bool s_autoAdvance = false;
+
+// What other tasks see of the above (getSnapshot()): odd sequence numbers
+// mark an update in progress
+static std::atomic<uint32_t> s_snapshotSeq{0};
+static Slideshow::Snapshot s_snapshot{Slideshow::State::INIT, 0, 0, false};
 static TickType_t s_lastActivityTick = 0;
 static TickType_t s_lastAutoAdvanceTick = 0;
 
+// Where the show stood when it went to deep sleep. RTC slow memory keeps it
+// across deep sleep (not power loss), so a button wake can skip the status
+// screens and continue from here if the image list is still the same.
+struct ResumeState {
+    uint32_t magic;        // RESUME_MAGIC when valid
+    uint32_t listChecksum; // imageListChecksum() at sleep
+    uint32_t count;        // imageCount() at sleep
+    uint32_t index;        // s_currentImageIndex at sleep
+    bool autoAdvance;
+    // Timed auto-advance sleep only (nextSlideUs == 0 otherwise)
+    int64_t nextSlideUs;   // Wall-clock time the timer wake is due
+    uint32_t nextIndex;    // Slide the timer wake shows
+    char nextPath[SDCard::ImageList::MAX_PATH];  // Its path ("" for a pack)
+    // Frame left on the glass, so showing it again skips the refresh
+    uint32_t panelHash;
+    bool panelHashValid;
+};
+static constexpr uint32_t RESUME_MAGIC = 0x4D535352;  // "RSSM"
+static RTC_DATA_ATTR ResumeState s_resume;
+
+// Last panel temperature reading and when it was taken (wall clock)
+static RTC_DATA_ATTR int8_t s_panelCelsius = EPD_TEMPERATURE_UNKNOWN;
+static RTC_DATA_ATTR int64_t s_panelCelsiusUs = 0;
+
 // Queues
 static QueueHandle_t s_buttonQueue = nullptr;
 
+// Deferred boot status: the step running when BOOT_STATUS_DELAY_MS expires
+// is drawn from the timer; nullptr once boot no longer wants a status screen
+static esp_timer_handle_t s_bootStatusTimer = nullptr;
+static SemaphoreHandle_t s_bootStatusLock = nullptr;
+static const char* s_bootStatus = nullptr;
+
+// Boot: the SD card is mounted and the image list built on a task of their
+// own while init() brings up the display. The scan waits for BOOT_SD_SCAN
+// so a timed wake's slide is read first; only one of the two tasks runs
+// SlideStats timers at a time.
+static constexpr EventBits_t BOOT_SD_MOUNTED = BIT0;  // s_bootSd.mounted is set
+static constexpr EventBits_t BOOT_SD_SCAN = BIT1;     // The scan may start
+static constexpr EventBits_t BOOT_SD_SCANNED = BIT2;  // s_bootSd.found is set
+struct BootSd {
+    EventGroupHandle_t events = nullptr;
+    bool mounted = false;
+    size_t found = 0;
+};
+static BootSd s_bootSd;
+
+// SD hot-plug (SD_HOTPLUG_ENABLED): a new card is mounted and listed on the
+// card_scan task while the slideshow runs on; done hands the result to the
+// slideshow task, which swaps the list in. The card is only touched by one
+// of the two tasks at a time: running is set before the scan mounts it.
+struct CardScan {
+    std::atomic<bool> running{false};
+    std::atomic<bool> done{false};
+    bool mounted = false;
+    SDCard::ImageList files;
+};
+static CardScan s_cardScan;
+static TickType_t s_lastCardPoll = 0;
+static bool s_cardInSlot = false;  // What the detect pin said at the last poll
+
+// Prefetched neighbour frames, decoded while the current one is on screen
+struct PrefetchSlot {
+    enum class Status { EMPTY, READY, FAILED };
+    Status status = Status::EMPTY;
+    size_t index = 0;
+    uint8_t* planes[2] = { nullptr, nullptr };
+};
+static PrefetchSlot s_prefetch[2];
+static bool s_prefetchReady = false;
+
+// The display's frame planes, sized by the panel geometry: outside the heap
+// for good, and in internal RAM the SPI DMA reads without a bounce copy.
+// A single byte each with FRAMEBUFFER_IN_PSRAM, which allocates them there.
+static constexpr size_t FRAME_PLANE_SIZE =
+    static_cast<size_t>(DISPLAY_NATIVE_WIDTH) * DISPLAY_NATIVE_HEIGHT / 8;
+DMA_ATTR WORD_ALIGNED_ATTR static uint8_t
+    s_framePlanes[2][FRAMEBUFFER_IN_PSRAM ? 1 : FRAME_PLANE_SIZE];
+
+// Image currently held in the display framebuffer, or SIZE_MAX when it has
+// been drawn over (menus, indicators) and can't be reused as a prefetch slot
+static size_t s_framebufferImage = SIZE_MAX;
+
+// The current image's decode was abandoned and still has to be shown
+static bool s_redrawPending = false;
+
+// SELECT acts on release; set by its press, cleared by a long press
+static bool s_selectArmed = false;
+
+// Fast-waveform navigation: the last UP/DOWN step (0 = none yet), and
+// whether the glass shows a fast frame that still needs a normal refresh
+static TickType_t s_lastNavigationTick = 0;
+static bool s_fastFrameShown = false;
+
+// Hold-to-scroll (FAST_SCROLL_ENABLED): the slide a held UP/DOWN has
+// reached, and the steps taken since the long press
+static bool s_scrolling = false;
+static size_t s_scrollTarget = 0;
+static uint32_t s_scrollSteps = 0;
+
+// Contact sheet (GRID_VIEW_ENABLED): the selected slide, the first slide
+// of the page on the glass, and whether UP/DOWN are ignored until released
+// (held through the switch from scrolling)
+static bool s_gridActive = false;
+static size_t s_gridSelection = 0;
+static size_t s_gridPageStart = 0;
+static bool s_gridHeldIgnored = false;
+
+// Stage timing: the shown slide's record waits for its refresh timings,
+// matched by the display's refresh count; polled this often meanwhile
+static constexpr uint32_t SLIDE_STATS_POLL_MS = 500;
+static uint32_t s_statsPending = 0;
+static uint32_t s_statsRefreshCount = 0;
+
+// Input latency: the oldest button press or command (its stamp) that no
+// slide has answered yet goes to the next slide's record; onPanelTrace()
+// notes when the panel's refresh started and ended
+static int64_t s_inputAt = 0;
+static int64_t s_statsInputAt = 0;  // The stamp the last record took
+static std::atomic<int64_t> s_refreshStartAt{0};
+static std::atomic<int64_t> s_refreshDoneAt{0};
+
+// Slide whose power window is open (markSlidePower()), SIZE_MAX during boot
+static size_t s_powerSlide = SIZE_MAX;
+
+// sleepUntilNextSlide() is waiting for the refresh
+static bool s_sleepFlowActive = false;
+
+// releaseIdleBus(), stageNextSlide(), animateSlide() or updateWidgets() is
+// waiting for the refresh
+static bool s_idleFlowActive = false;
+
+// Slide whose animation was looked for (animateSlide()), SIZE_MAX for none
+static size_t s_animationImage = SIZE_MAX;
+
+// Slide whose widgets were looked for (updateWidgets()), SIZE_MAX for none
+static size_t s_widgetImage = SIZE_MAX;
+
 // Forward declarations
 static void handleButton(SlideshowButtonEvent evt);
+static void handleCommand(Slideshow::Command command, uint32_t arg);
+static void refreshCurrentImage(Slideshow::Command command);
+static void runBench(Bench::Suite suite);
+static void syncImages();
+static void uploadImages();
+static void serveUsbStorage();
+static void showUpdatedPack(bool updated, uint32_t before);
+static void showPushedFrame();
+static void showCastFrame();
+static void castSlide(size_t index);
+static void navigate(int steps);
+static void scroll(const SlideshowButtonEvent& evt);
+static void showScrollIndex();
+static bool browsing();
+static bool openGrid(size_t index);
+static void closeGrid(bool show);
+static void gridButton(const SlideshowButtonEvent& evt);
+static bool inputPending();
+static bool preempts(RenderJob::Priority running);
+static bool cancelUpload(Adafruit_EPD* epd, void* arg);
 static void drawErrorScreen(const char* message);
 static void drawLoadingScreen(const char* message);
+static void printCentered(const char* text, uint8_t size, int16_t top);
+static bool startBootSd(bool scanNow, bool mount);
+static void releaseCard();
+static bool cardPolled();
+static void pollCard();
+static void startCardScan();
+static void finishCardScan();
+static void waitCardScan();
+static void reloadImages(const char* why);
+static void beginBootStatus(const char* message);
+static void setBootStatus(const char* message);
+static void endBootStatus();
 static void displayCurrentImage();
+static bool showCurrentImage();
+static void showPreview(const char* path);
+static void redrawAbandoned();
+static void showIndicator(const char* label);
+static void showSlideStatus(const char* path);
+static void finishFastNavigation();
+static void noteInput(int64_t stamp);
+static void beginSlideStats(size_t index);
+static void endSlideStats(bool refreshStarted);
+static void pollSlideStats();
+static void logSlideStats(uint32_t id);
+static void takeSpiStats(uint32_t id);
+static void markSlidePower(size_t next, uint64_t sleepUs = 0);
+static void onPanelPower(Adafruit_EPD* epd, epd_power_state_t state, void* arg);
+static void onPanelTrace(Adafruit_EPD* epd, epd_trace_t span, int64_t startUs, int64_t endUs,
+                         void* arg);
+static void waitRefresh();
+static void initPrefetch();
+static bool prefetchStep();
+static bool cacheWarmDue();
+static void cacheWarmStep();
+static TickType_t ticksUntil(TickType_t since, uint32_t seconds);
+static TickType_t ticksUntilDeadline();
+static size_t imageCount();
+static bool packOpen();
+static bool openImagePack();
+static bool imagePath(size_t index, char* out, size_t outSize);
+static bool loadImage(size_t index, const char* path);
+static bool loadImageIntoPlanes(size_t index, const char* path, uint8_t* plane1, uint8_t* plane2);
+static uint32_t imageListChecksum();
+static bool thumbnailSize(uint8_t& width, uint8_t& height);
+static std::unique_ptr<GFXcanvas1> loadThumbnail(size_t index);
+static bool resumeFromSleep();
+static bool sleepsBetweenSlides();
+static RenderFlow::Flow sleepUntilNextSlide();
+static void sleepUntilOpen();
+static void releaseIdleBus(TickType_t wait);
+static void stageNextSlide();
+static void animateSlide();
+static void updateWidgets();
+static void sleepUntilSlideDue(uint64_t sleepUs);
+static void applyAutoAdvanceWaveform();
+static uint32_t dwellSec();
+static void enterDeepSleep();
+static void setState(Slideshow::State state);
+static void publishSnapshot();
+static int64_t wallClockUs();
+static void sampleTemperature();
 
 bool Slideshow::init()
 {
     ESP_LOGI(TAG_SLIDE, "Initializing slideshow...");
+    BootProfile::mark(BootProfile::Mark::INIT);
+    RamBudget::log();
+    SlideStats::init();
+    PowerStats::init();
+    PerfLog::init();
+    PipelineTrace::init();
+    Telemetry::init();
 
     // Create button queue
     s_buttonQueue = xQueueCreate(10, sizeof(SlideshowButtonEvent));
@@ -48,6 +329,19 @@ bool Slideshow::init()
         ESP_LOGE(TAG_SLIDE, "Failed to create button queue");
         return false;
     }
+    // Coroutine waits are resumed from this queue's task
+    if (!RenderFlow::init(s_buttonQueue)) {
+        return false;
+    }
+    // A press arriving mid-decode makes that slide stale
+    RenderJob::setPreemptCheck(preempts);
+    Schedule::init();
+    Battery::init();
+    ImageLoader::setDitherMode(static_cast<Dither::Mode>(Tunables::get(Tunables::Id::DITHER_MODE)));
+    // Before the display and prefetch planes, while the heap is in one piece
+    SlideArena::init(SLIDE_ARENA_SIZE);
+    ReadAhead::init();
+    DitherPool::init();
 
     // Initialize buttons
     if (!SlideshowButtons::init(s_buttonQueue)) {
@@ -59,49 +353,178 @@ bool Slideshow::init()
     SPI.begin(SPI_SCK_PIN, SPI_MOSI_PIN, SPI_MISO_PIN);
     ESP_LOGI(TAG_SLIDE, "SPI bus initialized");
 
-    // Initialize e-ink display
-    g_display = new Adafruit_IL0373(
-        EINK_CS_PIN,
+    // A button or next-slide timer wake from deep sleep goes straight back
+    // to the pictures
+    esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+    bool waking = (cause == ESP_SLEEP_WAKEUP_EXT1 || cause == ESP_SLEEP_WAKEUP_ULP ||
+                   cause == ESP_SLEEP_WAKEUP_TIMER) &&
+                  s_resume.magic == RESUME_MAGIC;
+    bool timedWake = waking && cause == ESP_SLEEP_WAKEUP_TIMER;
+    // Slides in flash need no card for the first image
+    bool flashSlides = FLASH_PACK_ENABLED && FlashPack::open();
+    bool wakeSlide = timedWake && !flashSlides && s_resume.nextPath[0] != '\0';
+
+    // Mount and scan alongside the display's reset and init. The panel
+    // profile is settled first: the scan's probe reads it too
+    const Panel::Profile& panel = Panel::active();
+    // A wake leaves a released card alone: it was checked at power-on
+    bool mountCard = !(flashSlides && waking && FLASH_PACK_RELEASE_SD);
+    if (!startBootSd(!wakeSlide && !flashSlides, mountCard)) {
+        ESP_LOGE(TAG_SLIDE, "Failed to start SD card boot");
+        return false;
+    }
+
+    // Initialize e-ink display; its constructor allocates the planes
+    if (FRAMEBUFFER_IN_PSRAM) {
+        Adafruit_EPD::setFramebufferMemory(EPD_MEMORY_SPIRAM);
+    }
+    g_display = new Display(
         EINK_DC_PIN,
         EINK_RESET_PIN,
-        EINK_BUSY_PIN,
-        296,   // width (native horizontal)
-        128    // height (native horizontal)
+        EINK_CS_PIN,
+        -1,             // No SRAM: framebuffers in RAM
+        EINK_BUSY_PIN
     );
 
-    g_display->begin();
-    g_display->setRotation(1);  // Portrait mode
+    g_display->setBusyTimeout(EINK_BUSY_TIMEOUT_MS);
+    g_display->setPowerCallback(onPanelPower);
+    g_display->setTraceCallback(onPanelTrace);
+    g_display->setUploadLock(CpuBoost::lock(CpuBoost::Holder::UPLOAD));
+    g_display->setCancelCallback(cancelUpload);
+    SpiRecord::init(*g_display);
+#if !CONFIG_FREERTOS_UNICORE
+    if (PIPELINE_ENABLED) {
+        g_display->setRefreshTaskCore(PIPELINE_IO_CORE);
+    }
+#endif
+    if (!FRAMEBUFFER_IN_PSRAM &&
+        (g_display->getBufferSize(0) != sizeof(s_framePlanes[0]) ||
+         g_display->getBufferSize(1) != sizeof(s_framePlanes[1]) ||
+         !g_display->setFramebuffers(s_framePlanes[0], s_framePlanes[1]))) {
+        ESP_LOGW(TAG_SLIDE, "Static frame planes don't fit the panel, using the heap");
+    }
+    g_display->setSPIClocks(panel.spiCommandHz, panel.spiDataHz);
+    if (EINK_PANEL_IO_ENABLED && !g_display->usePanelIO(SPI.getHost(), panel.spiDataHz)) {
+        ESP_LOGW(TAG_SLIDE, "Panel IO unavailable, using the SPI device");
+    }
+    g_display->begin(*panel.table);
+    g_display->setRotation(DISPLAY_ROTATION);
+    if (FONT_ATLAS_ENABLED) {
+        g_display->setFontAtlases(FontAtlas::ATLASES, FontAtlas::COUNT);
+    }
+    g_display->setGhostPolicy(panel.ghostMaxRefreshes, panel.ghostMaxAreaPercent);
+    g_display->setFastTemperatureRange(EINK_FAST_MIN_CELSIUS, EINK_FAST_MAX_CELSIUS);
+    if (FAST_DIFFERENTIAL_UPDATES && panel.fastNavigation &&
+        !g_display->setDifferentialUpdates(true)) {
+        ESP_LOGW(TAG_SLIDE, "No memory for differential fast frames");
+    }
+    sampleTemperature();
+    ImageLoader::setPalette(panel.palette);
+    BootProfile::mark(BootProfile::Mark::DISPLAY_READY);
     ESP_LOGI(TAG_SLIDE, "E-ink display initialized");
+    // Status then goes to the OLED and the panel only shows slides
+    StatusDisplay::init();
+    SlideCache::init(g_display->getBuffer(0) ? g_display->getBufferSize(0) : 0,
+                     g_display->getBuffer(1) ? g_display->getBufferSize(1) : 0);
+
+    if (waking && s_resume.panelHashValid) {
+        g_display->setPanelHash(s_resume.panelHash);
+    }
+    s_resume.magic = 0;
+    s_resume.nextSlideUs = 0;
 
-    // Show loading screen
-    drawLoadingScreen("Initializing...");
+    // Prefetch buffers are allocated on first use: a timed wake shows one
+    // slide and goes back to sleep
+    if (!timedWake) {
+        initPrefetch();
+    }
 
-    // Initialize SD card
-    if (!SDCard::init()) {
+    // Status screens only if boot turns out to be slow
+    if (!waking && !flashSlides) {
+        beginBootStatus("Initializing...");
+    }
+
+    // The pack in flash goes up while the card mounts; the card is only
+    // checked for a newer pack after that
+    bool slideShown = false;
+    uint32_t flashList = 0;
+    if (flashSlides) {
+        flashList = FlashPack::checksum();
+        s_currentImageIndex = 0;
+        if (waking && !resumeFromSleep()) {
+            ESP_LOGI(TAG_SLIDE, "Image list changed during sleep, starting over");
+        }
+        beginSlideStats(s_currentImageIndex);
+        slideShown = loadImage(s_currentImageIndex, nullptr);
+        endSlideStats(slideShown);
+        xEventGroupSetBits(s_bootSd.events, BOOT_SD_SCAN);
+    }
+
+    // The SD card, by now usually mounted
+    xEventGroupWaitBits(s_bootSd.events, BOOT_SD_MOUNTED, pdFALSE, pdFALSE, portMAX_DELAY);
+    s_cardInSlot = SDCard::present();
+    if (!s_bootSd.mounted && !flashSlides) {
+        endBootStatus();
         drawErrorScreen("SD card error");
-        s_state = Slideshow::State::ERROR;
-        return false;
+        setState(Slideshow::State::ERROR);
+        // With hot-plug the task runs on and waits for a card; a follower
+        // shows what it is cast, card or not
+        FrameCast::start();
+        return SD_HOTPLUG_ENABLED || FrameCast::follows();
+    }
+
+    // A timed wake knows its slide already: show it first, and build the
+    // image list while the panel refreshes
+    if (wakeSlide) {
+        beginSlideStats(s_resume.nextIndex);
+        slideShown = ImageLoader::loadAndDisplay(s_resume.nextPath, g_display);
+        endSlideStats(slideShown);
+        xEventGroupSetBits(s_bootSd.events, BOOT_SD_SCAN);
     }
 
     // Scan for images
-    drawLoadingScreen("Scanning images...");
-    s_state = Slideshow::State::SCANNING;
-    
-    size_t imageCount = SDCard::scanForImages(IMAGE_DIRECTORY, s_imageFiles);
-    if (imageCount == 0) {
+    setBootStatus("Scanning images...");
+    setState(Slideshow::State::SCANNING);
+    xEventGroupWaitBits(s_bootSd.events, BOOT_SD_SCANNED, pdFALSE, pdFALSE, portMAX_DELAY);
+    size_t found = s_bootSd.mounted ? s_bootSd.found : FlashPack::size();
+    endBootStatus();
+    if (found == 0) {
         drawErrorScreen("No images found");
-        s_state = Slideshow::State::ERROR;
-        return false;
+        setState(Slideshow::State::ERROR);
+        FrameCast::start();
+        return SD_HOTPLUG_ENABLED || FrameCast::follows();
     }
 
-    ESP_LOGI(TAG_SLIDE, "Found %zu images", imageCount);
-    s_currentImageIndex = 0;
-    s_state = Slideshow::State::DISPLAYING;
+    ESP_LOGI(TAG_SLIDE, "Found %zu images", found);
+    BadImages::load(imageListChecksum(), found);
+    Captions::load(imageListChecksum(), packOpen() ? 0 : found, imagePath);
+    Playlists::load(imageListChecksum(), found);
+    if (flashSlides && imageListChecksum() != flashList) {
+        // The card's pack replaced the one the slide came from
+        slideShown = false;
+        s_currentImageIndex = 0;
+    } else if (!flashSlides) {
+        s_currentImageIndex = 0;
+        if (waking && !resumeFromSleep()) {
+            ESP_LOGI(TAG_SLIDE, "Image list changed during sleep, starting over");
+            slideShown = false;
+        }
+    }
+    setState(Slideshow::State::DISPLAYING);
     s_lastActivityTick = xTaskGetTickCount();
     s_lastAutoAdvanceTick = xTaskGetTickCount();
 
     // Display first image
-    displayCurrentImage();
+    if (slideShown) {
+        s_framebufferImage = s_currentImageIndex;
+    } else {
+        displayCurrentImage();
+    }
+
+    // Once the first slide is on its way, so joining doesn't hold it up
+    FramePush::start();
+    BleUpload::start();
+    FrameCast::start();
 
     return true;
 }
@@ -109,150 +532,2613 @@ bool Slideshow::init()
 void Slideshow::task(void* arg)
 {
     SlideshowButtonEvent btnEvt;
+    bool prefetchPending = true;  // A neighbour may still need decoding
+    CpuBoost::set(CpuBoost::Holder::SLIDESHOW, true);
+    // Each slide's record counts what this task takes from the heap
+    HeapWatch::watchCurrentTask();
 
     while (true) {
-        // Process button events
-        if (xQueueReceive(s_buttonQueue, &btnEvt, pdMS_TO_TICKS(100)) == pdTRUE) {
-            if (btnEvt.pressed) {
+        // Block until a button press or the next deadline. Nothing polls in
+        // between, so the idle task can light-sleep for the whole dwell;
+        // only pending prefetch work keeps the loop from blocking.
+        publishSnapshot();
+        TickType_t wait = ((prefetchPending || cacheWarmDue()) && !browsing()) ?
+                          0 : ticksUntilDeadline();
+        if (wait > 0) {
+            stageNextSlide();
+        }
+        releaseIdleBus(wait);
+        PowerStats::set(PowerStats::Load::CPU, wait == 0);
+        CpuBoost::set(CpuBoost::Holder::SLIDESHOW, wait == 0);
+        bool received = xQueueReceive(s_buttonQueue, &btnEvt, wait) == pdTRUE;
+        PowerStats::set(PowerStats::Load::CPU, true);
+        CpuBoost::set(CpuBoost::Holder::SLIDESHOW, true);
+        if (received && btnEvt.id == SlideshowButtonId::RESUME) {
+            // Not input: a waiting flow can continue, below
+        } else if (received) {
+            if (btnEvt.action != SlideshowButtonAction::RELEASE) {
                 s_lastActivityTick = xTaskGetTickCount();
-                handleButton(btnEvt);
             }
+            if (btnEvt.stamp) {
+                PipelineTrace::input(btnEvt.stamp);
+            }
+            noteInput(btnEvt.stamp);
+            handleButton(btnEvt);
+            redrawAbandoned();
+            // Answered, or an input that shows no slide (a release, a label)
+            if (!s_redrawPending) {
+                s_inputAt = 0;
+            }
+            prefetchPending = true;
+        } else if (prefetchPending && !browsing()) {
+            // Idle: decode at most one neighbour so buttons stay responsive
+            prefetchPending = prefetchStep();
+        } else if (cacheWarmDue() && !browsing()) {
+            // Neighbours done: convert one slide the cache doesn't hold yet
+            cacheWarmStep();
+        }
+        RenderFlow::runReady();
+        pollSlideStats();
+        // The panel is busy refreshing and off the bus: the log's turn
+        if (g_display->isRefreshing()) {
+            PerfLog::flush();
         }
 
-        // Handle auto-advance
-        if (s_state == Slideshow::State::DISPLAYING && s_autoAdvance) {
-            TickType_t now = xTaskGetTickCount();
-            TickType_t elapsed = now - s_lastAutoAdvanceTick;
-            
-            if (elapsed >= pdMS_TO_TICKS(AUTO_ADVANCE_DELAY_SEC * 1000)) {
-                // Advance to next image
-                s_currentImageIndex = (s_currentImageIndex + 1) % s_imageFiles.size();
-                displayCurrentImage();
-                s_lastAutoAdvanceTick = now;
-            }
+        // SD hot-plug: a swapped card is listed in the background
+        if (s_cardScan.done) {
+            finishCardScan();
+            prefetchPending = true;
+        } else if (!browsing() && !inputPending() && !g_display->isRefreshing()) {
+            pollCard();
+        }
+
+        // The radio window: between slides, with the panel idle
+        if (packOpen() && s_state == Slideshow::State::DISPLAYING && WifiSync::due() &&
+            Battery::allowsRadio() && !g_display->isRefreshing() && !inputPending()) {
+            syncImages();
+        }
+        if (s_state == Slideshow::State::DISPLAYING && Schedule::clockSyncDue() &&
+            Battery::allowsRadio() && !g_display->isRefreshing() && !inputPending()) {
+            Schedule::syncClock();
+        }
+
+        animateSlide();
+        updateWidgets();
+
+        // Navigation has paused: replace the fast frame with a full one
+        if (s_fastFrameShown && !browsing() && !inputPending() &&
+            xTaskGetTickCount() - s_lastNavigationTick >= pdMS_TO_TICKS(FAST_NAVIGATION_SETTLE_MS)) {
+            finishFastNavigation();
+        }
+
+        // Handle auto-advance (a follower's leader does it)
+        if (s_state == Slideshow::State::DISPLAYING && s_autoAdvance && !FrameCast::follows() &&
+            !browsing() && ticksUntil(s_lastAutoAdvanceTick, dwellSec()) == 0) {
+            // Advance to next image
+            s_currentImageIndex = Playlists::step(s_currentImageIndex, 1, imageCount());
+            PrefetchPlan::step(1);
+            Battery::sample();
+            sampleTemperature();
+            applyAutoAdvanceWaveform();
+            displayCurrentImage();
+            s_lastAutoAdvanceTick = xTaskGetTickCount();
+            prefetchPending = true;
+        }
+
+        // Timed deep sleep until the next slide, unless a press is waiting.
+        // The refresh is awaited, not blocked on, so input still comes in
+        if (!s_sleepFlowActive && !browsing() && sleepsBetweenSlides() &&
+            uxQueueMessagesWaiting(s_buttonQueue) == 0) {
+            s_sleepFlowActive = RenderFlow::start(sleepUntilNextSlide());
+        }
+
+        // Closed hours: once input stops, sleep through to the opening
+        if (s_state == Slideshow::State::DISPLAYING && Schedule::isClosed() &&
+            ticksUntil(s_lastActivityTick, SCHEDULE_CLOSED_IDLE_SEC) == 0 && !inputPending()) {
+            sleepUntilOpen();
         }
 
         // Check inactivity timeout
-        TickType_t now = xTaskGetTickCount();
-        TickType_t inactivity = now - s_lastActivityTick;
-        if (inactivity >= pdMS_TO_TICKS(INACTIVITY_TIMEOUT_SEC * 1000)) {
+        if (ticksUntil(s_lastActivityTick, Tunables::get(Tunables::Id::INACTIVITY_SEC)) == 0) {
             ESP_LOGI(TAG_SLIDE, "Inactivity timeout, entering deep sleep");
+            setState(Slideshow::State::SLEEPING);  // Nothing cancels this screen
+            g_display->waitFramebufferFree();
+            s_framebufferImage = SIZE_MAX;
             g_display->clearBuffer();
-            g_display->setCursor(20, 140);
-            g_display->print("Sleeping...");
+            g_display->setTextColor(EPD_BLACK);
+            printCentered("Sleeping...", 1, 140);
             g_display->display();
-            
-            SlideshowButtons::configure_wakeup();
-            vTaskDelay(pdMS_TO_TICKS(100));
-            esp_deep_sleep_start();
+            enterDeepSleep();
+        }
+    }
+}
+
+void Slideshow::getSnapshot(Snapshot& out)
+{
+    while (true) {
+        uint32_t before = s_snapshotSeq.load(std::memory_order_acquire);
+        if ((before & 1) == 0) {
+            out = s_snapshot;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s_snapshotSeq.load(std::memory_order_relaxed) == before) {
+                return;
+            }
         }
+        // Mid-update. The writer may be preempted by this very task, so let
+        // it run instead of spinning
+        vTaskDelay(1);
     }
 }
 
 Slideshow::State Slideshow::getState()
 {
-    return s_state;
+    Snapshot snapshot;
+    getSnapshot(snapshot);
+    return snapshot.state;
 }
 
 size_t Slideshow::getCurrentImageIndex()
 {
-    return s_currentImageIndex;
+    Snapshot snapshot;
+    getSnapshot(snapshot);
+    return snapshot.currentIndex;
 }
 
 size_t Slideshow::getImageCount()
 {
-    return s_imageFiles.size();
+    Snapshot snapshot;
+    getSnapshot(snapshot);
+    return snapshot.imageCount;
 }
 
-static void handleButton(SlideshowButtonEvent evt)
+void Slideshow::getStats(SlideStats::Summary& out)
 {
-    if (s_state != Slideshow::State::DISPLAYING) {
-        return;
+    SlideStats::summarize(out);
+}
+
+bool Slideshow::post(Command command, uint32_t arg)
+{
+    if (!s_buttonQueue) {
+        return false;
     }
+    SlideshowButtonEvent evt{ SlideshowButtonId::COMMAND, SlideshowButtonAction::PRESS };
+    evt.command = static_cast<uint8_t>(command);
+    evt.arg = arg;
+    evt.stamp = esp_timer_get_time();
+    return xQueueSend(s_buttonQueue, &evt, 0) == pdTRUE;
+}
 
-    switch (evt.id) {
-        case SlideshowButtonId::UP:
-            // Previous image
-            if (s_imageFiles.size() > 0) {
-                s_currentImageIndex = (s_currentImageIndex == 0) ? 
-                    s_imageFiles.size() - 1 : s_currentImageIndex - 1;
-                displayCurrentImage();
-                s_lastAutoAdvanceTick = xTaskGetTickCount();
-            }
-            break;
+/**
+ * @brief Ticks left until a period that started at since has passed (0 if it has)
+ */
+static TickType_t ticksUntil(TickType_t since, uint32_t seconds)
+{
+    TickType_t period = pdMS_TO_TICKS(seconds * 1000);
+    TickType_t elapsed = xTaskGetTickCount() - since;
+    return elapsed >= period ? 0 : period - elapsed;
+}
 
-        case SlideshowButtonId::DOWN:
-            // Next image
-            if (s_imageFiles.size() > 0) {
-                s_currentImageIndex = (s_currentImageIndex + 1) % s_imageFiles.size();
-                displayCurrentImage();
-                s_lastAutoAdvanceTick = xTaskGetTickCount();
-            }
-            break;
+/**
+ * @brief Ticks until the task next has to act: auto-advance or inactivity sleep
+ */
+static TickType_t ticksUntilDeadline()
+{
+    TickType_t wait = ticksUntil(s_lastActivityTick, Tunables::get(Tunables::Id::INACTIVITY_SEC));
+    if (s_state == Slideshow::State::DISPLAYING && s_autoAdvance && !FrameCast::follows()) {
+        wait = std::min(wait, ticksUntil(s_lastAutoAdvanceTick, dwellSec()));
+    }
+    if (s_state == Slideshow::State::DISPLAYING && Schedule::isClosed()) {
+        wait = std::min(wait, ticksUntil(s_lastActivityTick, SCHEDULE_CLOSED_IDLE_SEC));
+    }
+    if (s_statsPending) {
+        wait = std::min(wait, pdMS_TO_TICKS(SLIDE_STATS_POLL_MS));
+    }
+    if (cardPolled()) {
+        wait = std::min(wait, ticksUntil(s_lastCardPoll, SD_HOTPLUG_POLL_SEC));
+    }
+    if (packOpen() && s_state == Slideshow::State::DISPLAYING && !g_display->isRefreshing()) {
+        wait = std::min(wait, pdMS_TO_TICKS(WifiSync::msUntilDue()));
+    }
+    if (Animation::active() && s_state == Slideshow::State::DISPLAYING &&
+        !g_display->isRefreshing()) {
+        wait = std::min(wait, Animation::ticksUntilDue());
+    }
+    if (Widgets::active() && s_state == Slideshow::State::DISPLAYING &&
+        !g_display->isRefreshing()) {
+        wait = std::min(wait, Widgets::ticksUntilDue());
+    }
+    if (s_fastFrameShown) {
+        TickType_t settle = pdMS_TO_TICKS(FAST_NAVIGATION_SETTLE_MS);
+        TickType_t elapsed = xTaskGetTickCount() - s_lastNavigationTick;
+        wait = std::min(wait, elapsed >= settle ? 0 : settle - elapsed);
+    }
+    return wait;
+}
 
-        case SlideshowButtonId::SELECT:
-            // Toggle auto-advance
-            s_autoAdvance = !s_autoAdvance;
-            s_lastAutoAdvanceTick = xTaskGetTickCount();
-            ESP_LOGI(TAG_SLIDE, "Auto-advance: %s", s_autoAdvance ? "ON" : "OFF");
-            
-            // Show brief indicator
-            g_display->setTextSize(2);
-            g_display->setTextColor(EPD_BLACK);
-            g_display->fillRect(0, 0, 128, 30, EPD_WHITE);
-            g_display->setCursor(10, 10);
-            g_display->print(s_autoAdvance ? "AUTO" : "MANUAL");
-            g_display->display();
-            vTaskDelay(pdMS_TO_TICKS(1000));
-            displayCurrentImage();
-            break;
+static bool packOpen()
+{
+    return FlashPack::isOpen() || s_imagePack.isOpen();
+}
+
+/**
+ * @brief Open the slides of a pack: the flash partition, brought in line
+ *        with IMAGE_PACK_FILE first, or else the file itself
+ * @return false if neither holds a pack
+ */
+static bool openImagePack()
+{
+    if (FLASH_PACK_ENABLED) {
+        FlashPack::sync(IMAGE_PACK_FILE);
+        if (FlashPack::isOpen()) {
+            return true;
+        }
     }
+    return IMAGE_PACK_ENABLED && s_imagePack.open(IMAGE_PACK_FILE, Panel::active().id);
 }
 
-static void displayCurrentImage()
+static size_t imageCount()
+{
+    if (FlashPack::isOpen()) {
+        return FlashPack::size();
+    }
+    if (s_imagePack.isOpen()) {
+        return s_imagePack.size();
+    }
+    return s_imageCursor.isOpen() ? s_imageCursor.size() : s_imageFiles.size();
+}
+
+static bool imagePath(size_t index, char* out, size_t outSize)
+{
+    if (packOpen()) {
+        // Only used for logs; slides are loaded by index
+        int len = snprintf(out, outSize, "%s#%zu",
+                           FlashPack::isOpen() ? FLASH_PACK_PARTITION : IMAGE_PACK_FILE, index);
+        return len >= 0 && static_cast<size_t>(len) < outSize;
+    }
+    return s_imageCursor.isOpen() ? s_imageCursor.path(index, out, outSize) :
+                                    s_imageFiles.path(index, out, outSize);
+}
+
+static bool loadImage(size_t index, const char* path)
+{
+    if (FlashPack::isOpen()) {
+        size_t length = 0;
+        const uint8_t* frame = FlashPack::frame(index, length);
+        return ImageLoader::loadAndDisplayEPD(frame, length, g_display);
+    }
+    return s_imagePack.isOpen() ? ImageLoader::loadAndDisplay(s_imagePack, index, g_display) :
+                                  ImageLoader::loadAndDisplay(path, g_display);
+}
+
+static bool loadImageIntoPlanes(size_t index, const char* path, uint8_t* plane1, uint8_t* plane2)
+{
+    if (FlashPack::isOpen()) {
+        size_t length = 0;
+        const uint8_t* frame = FlashPack::frame(index, length);
+        return ImageLoader::loadIntoPlanes(frame, length, g_display, plane1, plane2);
+    }
+    return s_imagePack.isOpen() ?
+        ImageLoader::loadIntoPlanes(s_imagePack, index, g_display, plane1, plane2) :
+        ImageLoader::loadIntoPlanes(path, g_display, plane1, plane2);
+}
+
+/**
+ * @brief Thumbnail size of the open pack
+ * @return false without a pack with thumbnails
+ */
+static bool thumbnailSize(uint8_t& width, uint8_t& height)
+{
+    width = height = 0;
+    if (FlashPack::isOpen()) {
+        FlashPack::thumbnail(0, width, height);
+    } else if (s_imagePack.isOpen()) {
+        width = s_imagePack.thumbWidth();
+        height = s_imagePack.thumbHeight();
+    }
+    return width != 0 && height != 0;
+}
+
+/**
+ * @brief A slide's thumbnail from the flash or card pack, in a canvas of
+ *        its size
+ * @return nullptr without a pack with thumbnails, or out of memory
+ */
+static std::unique_ptr<GFXcanvas1> loadThumbnail(size_t index)
+{
+    uint8_t width = 0;
+    uint8_t height = 0;
+    const uint8_t* mapped = nullptr;
+    if (FlashPack::isOpen()) {
+        mapped = FlashPack::thumbnail(index, width, height);
+    } else if (!thumbnailSize(width, height)) {
+        return nullptr;
+    }
+    if (width == 0 || height == 0) {
+        return nullptr;
+    }
+    std::unique_ptr<GFXcanvas1> canvas(new (std::nothrow) GFXcanvas1(width, height));
+    if (!canvas || !canvas->getBuffer()) {
+        return nullptr;
+    }
+    if (mapped) {
+        memcpy(canvas->getBuffer(), mapped, (width + 7) / 8 * size_t(height));
+    } else if (!s_imagePack.readThumbnail(index, canvas->getBuffer())) {
+        return nullptr;
+    }
+    return canvas;
+}
+
+static uint32_t imageListChecksum()
+{
+    if (FlashPack::isOpen()) {
+        return FlashPack::checksum();
+    }
+    if (s_imagePack.isOpen()) {
+        return s_imagePack.checksum();
+    }
+    return s_imageCursor.isOpen() ? s_imageCursor.checksum() : s_imageFiles.checksum();
+}
+
+/**
+ * @brief Restore the pre-sleep position and act on the button that woke us
+ *
+ * DOWN (or the auto-advance timer) shows the next image, UP the previous
+ * one, SELECT the one that was on screen.
+ *
+ * @return false if the image list differs from the one at sleep
+ */
+static bool resumeFromSleep()
+{
+    size_t count = imageCount();
+    if (s_resume.count != count || s_resume.index >= count ||
+        s_resume.listChecksum != imageListChecksum()) {
+        return false;
+    }
+
+    Playlists::load(s_resume.listChecksum, count);
+    size_t index = s_resume.index;
+    SlideshowButtonEvent gesture;
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER) {
+        // Timed auto-advance: the slide picked before sleeping is due
+        index = s_resume.nextIndex < count ? s_resume.nextIndex : 0;
+    } else if (SlideshowButtons::wakeGesture(gesture) && gesture.id != SlideshowButtonId::SELECT) {
+        // The first slide is the one asked for, with no wait for the
+        // button's events (UP/DOWN, pressed or held, each move one slide)
+        index = Playlists::step(index, gesture.id == SlideshowButtonId::DOWN ? 1 : -1, count);
+    }
+
+    s_currentImageIndex = index;
+    s_autoAdvance = s_resume.autoAdvance;
+    ESP_LOGI(TAG_SLIDE, "Resuming at image %zu (auto-advance %s)",
+             index + 1, s_autoAdvance ? "ON" : "OFF");
+    return true;
+}
+
+static void setState(Slideshow::State state)
+{
+    s_state = state;
+    publishSnapshot();
+}
+
+/**
+ * @brief Publish s_state, the slide and the mode to getSnapshot() readers
+ *
+ * Slideshow task only. Costs two counter stores and a copy when something
+ * changed, nothing otherwise.
+ */
+static void publishSnapshot()
 {
-    if (s_imageFiles.empty() || s_currentImageIndex >= s_imageFiles.size()) {
+    Slideshow::Snapshot next{s_state, s_currentImageIndex, imageCount(), s_autoAdvance};
+    if (next.state == s_snapshot.state && next.currentIndex == s_snapshot.currentIndex &&
+        next.imageCount == s_snapshot.imageCount && next.autoAdvance == s_snapshot.autoAdvance) {
         return;
     }
+    uint32_t seq = s_snapshotSeq.load(std::memory_order_relaxed);
+    s_snapshotSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s_snapshot = next;
+    s_snapshotSeq.store(seq + 2, std::memory_order_release);
+}
 
-    const std::string& imagePath = s_imageFiles[s_currentImageIndex];
-    ESP_LOGI(TAG_SLIDE, "Displaying image %zu/%zu: %s", 
-             s_currentImageIndex + 1, s_imageFiles.size(), imagePath.c_str());
+static bool sleepsBetweenSlides()
+{
+    // Pushed frames, uploads and casts need the radio up
+    return AUTO_ADVANCE_DEEP_SLEEP && !FRAME_PUSH_ENABLED && !BLE_UPLOAD_ENABLED &&
+           !FRAME_CAST_ENABLED && s_autoAdvance && s_state == Slideshow::State::DISPLAYING;
+}
 
-    if (!ImageLoader::loadAndDisplayBMP(imagePath.c_str(), g_display)) {
-        ESP_LOGW(TAG_SLIDE, "Failed to load image, skipping");
-        // Skip to next image
-        s_currentImageIndex = (s_currentImageIndex + 1) % s_imageFiles.size();
-        if (s_currentImageIndex != 0) {  // Avoid infinite loop
-            displayCurrentImage();
+/**
+ * @brief Power the panel down and deep-sleep until the next slide is due
+ *
+ * The dwell is counted from the end of the refresh, not its start as when
+ * awake: a tricolor refresh can outlast the dwell, and the slide should
+ * still stay up, unpowered, for the whole of it. A slide that would come
+ * up in closed hours waits for the opening instead. Runs as a
+ * flow: while the refresh is awaited the task handles input, and anything
+ * that came in meanwhile (a press, a new slide) calls the sleep off.
+ */
+static RenderFlow::Flow sleepUntilNextSlide()
+{
+    // E-ink keeps the image unpowered; the refresh has to finish first.
+    // A slide started while waiting is waited for too
+    do {
+        co_await RenderFlow::refreshed(*g_display);
+    } while (g_display->isRefreshing());
+    s_sleepFlowActive = false;
+    if (g_display->wasCancelled() || !sleepsBetweenSlides() || inputPending()) {
+        co_return;  // A press came in; the loop handles it
+    }
+
+    uint32_t dwell = dwellSec();
+    int64_t untilOpen = Schedule::secondsUntilOpen(dwell);
+    int64_t sleepSec = std::max<int64_t>(dwell, untilOpen);
+    ESP_LOGI(TAG_SLIDE, "Sleeping %" PRId64 " s until the next slide%s", sleepSec,
+             untilOpen > 0 ? " (closed hours)" : "");
+    sleepUntilSlideDue(static_cast<uint64_t>(sleepSec) * 1000000ULL);
+}
+
+/**
+ * @brief Wait out the refresh, then let the task loop come round again
+ */
+static RenderFlow::Flow awaitRefreshEnd()
+{
+    do {
+        co_await RenderFlow::refreshed(*g_display);
+    } while (g_display->isRefreshing());
+    s_idleFlowActive = false;
+}
+
+/**
+ * @brief Send the next slide to the panel's RAM during the dwell (STAGED_FRAME_ENABLED)
+ *
+ * Once the refresh is over (awaited as a flow) and the next slide sits
+ * decoded in a prefetch slot, its planes go to the controller. Advancing
+ * to it, by auto-advance or DOWN, swaps the same frame in and display()
+ * finds it staged: only the refresh is left. Anything sent to the panel
+ * in between, like an indicator, drops it and the slide uploads as usual.
+ */
+static void stageNextSlide()
+{
+    // An animation's window refreshes would drop the staged frame each step
+    if (!STAGED_FRAME_ENABLED || s_state != Slideshow::State::DISPLAYING || browsing() ||
+        s_fastFrameShown || inputPending() || imageCount() < 2 || Animation::active() ||
+        Widgets::active()) {
+        return;
+    }
+    if (g_display->isRefreshing()) {
+        if (!s_idleFlowActive) {
+            s_idleFlowActive = RenderFlow::start(awaitRefreshEnd());
+        }
+        return;
+    }
+
+    size_t next = Playlists::step(s_currentImageIndex, 1, imageCount());
+    for (PrefetchSlot& slot : s_prefetch) {
+        if (slot.status == PrefetchSlot::Status::READY && slot.index == next) {
+            // Already staged: stageFrame() finds the same frame and sends nothing
+            bool staged = g_display->stageFrame(slot.planes[0], slot.planes[1]);
+            ESP_LOGD(TAG_SLIDE, "Idle: image %zu %s", next + 1, staged ? "staged" : "not staged");
+            return;
         }
     }
 }
 
-static void drawErrorScreen(const char* message)
+/**
+ * @brief Play the current slide's animation, if it has one (ANIMATION_ENABLED)
+ *
+ * The animation is loaded once the slide is in the framebuffer and its
+ * refresh is over (awaited as a flow), and dropped as soon as anything
+ * else takes the framebuffer. Coming back starts it again from the key
+ * frame.
+ */
+static void animateSlide()
 {
-    if (!g_display) return;
+    if (!ANIMATION_ENABLED) {
+        return;
+    }
+    if (s_state != Slideshow::State::DISPLAYING || browsing() || s_fastFrameShown ||
+        s_framebufferImage != s_currentImageIndex) {
+        s_animationImage = SIZE_MAX;
+        Animation::close();
+        return;
+    }
+    if (inputPending()) {
+        return;
+    }
+    if (g_display->isRefreshing()) {
+        if (!s_idleFlowActive) {
+            s_idleFlowActive = RenderFlow::start(awaitRefreshEnd());
+        }
+        return;
+    }
 
-    g_display->clearBuffer();
-    g_display->setTextSize(2);
-    g_display->setTextColor(EPD_BLACK);
-    g_display->setCursor(10, 100);
-    g_display->print("ERROR");
-    g_display->setTextSize(1);
-    g_display->setCursor(10, 140);
-    g_display->print(message);
-    g_display->display();
+    if (s_animationImage != s_currentImageIndex) {
+        s_animationImage = s_currentImageIndex;
+        char path[SDCard::ImageList::MAX_PATH];
+        if (!imagePath(s_currentImageIndex, path, sizeof(path)) ||
+            !Animation::open(path, *g_display)) {
+            return;
+        }
+    }
+    if (Animation::active() && Animation::ticksUntilDue() == 0) {
+        Animation::step(*g_display);
+        RefreshTiming::learn(*g_display);
+    }
 }
 
-static void drawLoadingScreen(const char* message)
+/**
+ * @brief Redraw the current slide's dashboard widgets that changed (WIDGETS_ENABLED)
+ *
+ * Same lifecycle as animateSlide(): the widgets are read once the slide's
+ * refresh is over and dropped as soon as anything else takes the
+ * framebuffer, so coming back draws all of them again.
+ */
+static void updateWidgets()
 {
-    if (!g_display) return;
+    if (!WIDGETS_ENABLED) {
+        return;
+    }
+    if (s_state != Slideshow::State::DISPLAYING || browsing() || s_fastFrameShown ||
+        s_framebufferImage != s_currentImageIndex) {
+        s_widgetImage = SIZE_MAX;
+        Widgets::clear();
+        return;
+    }
+    if (inputPending()) {
+        return;
+    }
+    if (g_display->isRefreshing()) {
+        if (!s_idleFlowActive) {
+            s_idleFlowActive = RenderFlow::start(awaitRefreshEnd());
+        }
+        return;
+    }
 
-    g_display->clearBuffer();
-    g_display->setTextSize(2);
-    g_display->setTextColor(EPD_BLACK);
-    g_display->setCursor(20, 120);
-    g_display->print(message);
-    g_display->display();
+    if (s_widgetImage != s_currentImageIndex) {
+        s_widgetImage = s_currentImageIndex;
+        char path[SDCard::ImageList::MAX_PATH];
+        if (!imagePath(s_currentImageIndex, path, sizeof(path)) || !Widgets::load(path)) {
+            return;
+        }
+    }
+    if (Widgets::active() && Widgets::update(*g_display, { s_currentImageIndex, imageCount() })) {
+        RefreshTiming::learn(*g_display);
+    }
+}
+
+/**
+ * @brief Free the SPI bus before a wait of wait ticks (SPI_IDLE_RELEASE_ENABLED)
+ *
+ * The panel and the card come off the bus, then the bus is freed. A refresh
+ * still running is awaited first, as a flow, so the release happens once
+ * it is over. Nothing brings the bus back here: the next panel command or
+ * SD access does, on whichever task it comes from.
+ */
+static void releaseIdleBus(TickType_t wait)
+{
+    if (!SPI_IDLE_RELEASE_ENABLED || !SPI.isInitialized() || s_cardScan.running ||
+        wait < pdMS_TO_TICKS(SPI_IDLE_RELEASE_MIN_MS)) {
+        return;
+    }
+    if (g_display->isRefreshing()) {
+        if (!s_idleFlowActive) {
+            s_idleFlowActive = RenderFlow::start(awaitRefreshEnd());
+        }
+        return;
+    }
+
+    // Under the burst lock, so no SD transfer or panel burst is midway
+    SPI.lock();
+    bool freed = g_display->suspendBus() && SDCard::suspendBus() && SPI.end();
+    SPI.unlock();
+    ESP_LOGD(TAG_SLIDE, "Idle: SPI bus %s", freed ? "freed" : "kept");
+}
+
+/**
+ * @brief Closed hours: deep-sleep until the schedule opens, with one timer
+ *        wake that shows the next slide
+ */
+static void sleepUntilOpen()
+{
+    int64_t sleepSec = Schedule::secondsUntilOpen();
+    if (sleepSec <= 0) {
+        return;
+    }
+    ESP_LOGI(TAG_SLIDE, "Closed hours, sleeping %" PRId64 " s until the opening", sleepSec);
+    waitRefresh();
+    sleepUntilSlideDue(static_cast<uint64_t>(sleepSec) * 1000000ULL);
+}
+
+/**
+ * @brief Power the panel down and deep-sleep with a timer wake for the next
+ *        slide; the panel must be idle
+ */
+static void sleepUntilSlideDue(uint64_t sleepUs)
+{
+    g_display->powerDown();
+    esp_sleep_enable_timer_wakeup(sleepUs);
+
+    // Hand the wake its slide, so it can show it before building the list
+    s_resume.nextIndex = static_cast<uint32_t>(Playlists::step(s_currentImageIndex, 1, imageCount()));
+    s_resume.nextPath[0] = '\0';
+    if (!packOpen()) {
+        imagePath(s_resume.nextIndex, s_resume.nextPath, sizeof(s_resume.nextPath));
+    }
+    s_resume.nextSlideUs = wallClockUs() + static_cast<int64_t>(sleepUs);
+    enterDeepSleep();
+}
+
+/**
+ * @brief Save the show's position to RTC memory and enter deep sleep
+ *
+ * A timed sleep sets nextSlideUs / nextIndex / nextPath first; any other
+ * sleep leaves nextSlideUs at 0.
+ */
+static void enterDeepSleep()
+{
+    s_resume.listChecksum = imageListChecksum();
+    s_resume.count = static_cast<uint32_t>(imageCount());
+    s_resume.index = static_cast<uint32_t>(s_currentImageIndex);
+    s_resume.autoAdvance = s_autoAdvance;
+    s_resume.panelHashValid = g_display->getPanelHash(s_resume.panelHash);
+    s_resume.magic = RESUME_MAGIC;
+
+    // The slide stays up through the sleep: a timed sleep is charged to it,
+    // an open-ended one can't be
+    int64_t timedUs = s_resume.nextSlideUs != 0 ? s_resume.nextSlideUs - wallClockUs() : 0;
+    markSlidePower(SIZE_MAX, static_cast<uint64_t>(std::max<int64_t>(timedUs, 0)));
+    PerfLog::sleep();
+    Telemetry::sleep();
+
+    StatusDisplay::sleep();
+    SlideshowButtons::configure_wakeup();
+    vTaskDelay(pdMS_TO_TICKS(100));
+    esp_deep_sleep_start();
+}
+
+void Slideshow::handleWake()
+{
+    if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_EXT1 ||
+        s_resume.magic != RESUME_MAGIC) {
+        return;
+    }
+
+    // EXT1 without a button pin behind it: a glitch on the wake lines. The
+    // LP core (LP_BUTTONS_ENABLED) filters those before waking us
+    SlideshowButtonEvent gesture;
+    if (SlideshowButtons::wakeGesture(gesture)) {
+        return;
+    }
+
+    if (s_resume.nextSlideUs != 0) {
+        int64_t remaining = s_resume.nextSlideUs - wallClockUs();
+        if (remaining <= 0) {
+            return;  // The slide is due anyway; boot shows the current one
+        }
+        esp_sleep_enable_timer_wakeup(static_cast<uint64_t>(remaining));
+    }
+    ESP_LOGI(TAG_SLIDE, "Spurious wake, back to sleep");
+    SlideshowButtons::configure_wakeup();
+    esp_deep_sleep_start();
+}
+
+/**
+ * @brief Read the panel's temperature once EINK_TEMPERATURE_INTERVAL_SEC
+ *        have passed since the last reading, else reuse that one; the
+ *        waveform choice and the learned refresh times follow it
+ */
+static void sampleTemperature()
+{
+    int64_t now = wallClockUs();
+    if (EINK_TEMPERATURE_ENABLED &&
+        (s_panelCelsiusUs == 0 || now < s_panelCelsiusUs ||
+         now - s_panelCelsiusUs >= static_cast<int64_t>(EINK_TEMPERATURE_INTERVAL_SEC) * 1000000)) {
+        // A failed reading waits for the next interval too
+        int8_t celsius = g_display->readTemperature();
+        if (celsius != s_panelCelsius) {
+            if (celsius == EPD_TEMPERATURE_UNKNOWN) {
+                ESP_LOGW(TAG_SLIDE, "No panel temperature reading");
+            } else {
+                ESP_LOGI(TAG_SLIDE, "Panel at %d C", celsius);
+            }
+        }
+        s_panelCelsius = celsius;
+        s_panelCelsiusUs = now;
+    }
+    g_display->setAmbientTemperature(s_panelCelsius);
+    RefreshTiming::apply(*g_display);
+}
+
+static int64_t wallClockUs()
+{
+    // System time keeps running through deep sleep (RTC timer)
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return static_cast<int64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+static void handleButton(SlideshowButtonEvent evt)
+{
+    if (s_state != Slideshow::State::DISPLAYING) {
+        if (evt.id == SlideshowButtonId::COMMAND &&
+            evt.command == static_cast<uint8_t>(Slideshow::Command::PUSH)) {
+            FramePush::rejectPending();
+        } else if (evt.id == SlideshowButtonId::COMMAND &&
+                   evt.command == static_cast<uint8_t>(Slideshow::Command::UPLOAD)) {
+            BleUpload::reject();
+        } else if (evt.id == SlideshowButtonId::COMMAND &&
+                   evt.command == static_cast<uint8_t>(Slideshow::Command::CAST) &&
+                   s_state == Slideshow::State::ERROR) {
+            showCastFrame();  // Followers need no images of their own
+        } else if (evt.id == SlideshowButtonId::COMMAND &&
+                   evt.command == static_cast<uint8_t>(Slideshow::Command::USB) &&
+                   s_state == Slideshow::State::ERROR) {
+            serveUsbStorage();  // A card without slides is the one to fill
+        }
+        return;
+    }
+    if (s_gridActive && evt.id != SlideshowButtonId::COMMAND &&
+        evt.id != SlideshowButtonId::RESUME) {
+        gridButton(evt);
+        return;
+    }
+
+    switch (evt.id) {
+        case SlideshowButtonId::UP:
+        case SlideshowButtonId::DOWN: {
+            if (FAST_SCROLL_ENABLED &&
+                (s_scrolling || evt.action == SlideshowButtonAction::LONG_PRESS)) {
+                scroll(evt);
+                break;
+            }
+            // Hold to scroll: the press, the long press and every repeat
+            // each move one slide
+            auto step = [](const SlideshowButtonEvent& e) {
+                if (e.action == SlideshowButtonAction::RELEASE) {
+                    return 0;
+                }
+                return (e.id == SlideshowButtonId::DOWN) ? 1 : -1;
+            };
+            int steps = step(evt);
+            if (steps == 0) {
+                break;
+            }
+            // Fold the UP/DOWN events queued behind this one into a single
+            // jump; a SELECT or a command stays queued and is handled after it
+            SlideshowButtonEvent next;
+            while (xQueuePeek(s_buttonQueue, &next, 0) == pdTRUE &&
+                   (next.id == SlideshowButtonId::UP || next.id == SlideshowButtonId::DOWN)) {
+                xQueueReceive(s_buttonQueue, &next, 0);
+                steps += step(next);
+            }
+            navigate(steps);
+            break;
+        }
+
+        case SlideshowButtonId::SELECT:
+            // SELECT while a held UP/DOWN scrolls opens the contact sheet there
+            if (evt.action == SlideshowButtonAction::PRESS && s_scrolling &&
+                openGrid(s_scrollTarget)) {
+                s_gridHeldIgnored = true;
+                break;
+            }
+            // Short press acts on release, so a long press doesn't also
+            // toggle; a release without a seen press (held through a wake) is ignored
+            if (evt.action == SlideshowButtonAction::PRESS) {
+                s_selectArmed = true;
+                break;
+            }
+            if (evt.action == SlideshowButtonAction::LONG_PRESS && s_selectArmed) {
+                s_selectArmed = false;
+                showIndicator(Playlists::toggleFavorite(s_currentImageIndex) ? "FAV +" : "FAV -");
+                break;
+            }
+            if (evt.action != SlideshowButtonAction::RELEASE || !s_selectArmed) {
+                break;
+            }
+            s_selectArmed = false;
+
+            // Toggle auto-advance
+            s_autoAdvance = !s_autoAdvance;
+            s_lastAutoAdvanceTick = xTaskGetTickCount();
+            ESP_LOGI(TAG_SLIDE, "Auto-advance: %s", s_autoAdvance ? "ON" : "OFF");
+            showIndicator(s_autoAdvance ? "AUTO" : "MANUAL");
+            break;
+
+        case SlideshowButtonId::COMMAND:
+            handleCommand(static_cast<Slideshow::Command>(evt.command), evt.arg);
+            break;
+
+        case SlideshowButtonId::RESUME:
+            break;  // Taken by the task loop
+    }
+}
+
+/**
+ * @brief Run a command posted with Slideshow::post()
+ */
+static void handleCommand(Slideshow::Command command, uint32_t arg)
+{
+    // Every other command but SHUFFLE and WIDGETS puts a slide or screen of its own on the glass
+    if (s_gridActive && command != Slideshow::Command::GRID &&
+        command != Slideshow::Command::SHUFFLE && command != Slideshow::Command::WIDGETS) {
+        closeGrid(false);
+    }
+    switch (command) {
+        case Slideshow::Command::GOTO:
+            if (arg >= imageCount()) {
+                ESP_LOGW(TAG_SLIDE, "No slide %" PRIu32 " (%zu slides)", arg + 1, imageCount());
+                break;
+            }
+            s_lastAutoAdvanceTick = xTaskGetTickCount();
+            s_currentImageIndex = arg;
+            displayCurrentImage();
+            break;
+
+        case Slideshow::Command::REFRESH_FULL:
+        case Slideshow::Command::REFRESH_PARTIAL:
+        case Slideshow::Command::REFRESH_FAST:
+            refreshCurrentImage(command);
+            break;
+
+        case Slideshow::Command::BENCH:
+            runBench(static_cast<Bench::Suite>(arg));
+            break;
+
+        case Slideshow::Command::SYNC:
+            if (IMAGE_PACK_ENABLED || FLASH_PACK_ENABLED) {
+                syncImages();
+            }
+            break;
+
+        case Slideshow::Command::PUSH:
+            showPushedFrame();
+            break;
+
+        case Slideshow::Command::CAST:
+            showCastFrame();
+            break;
+
+        case Slideshow::Command::UPLOAD:
+            if (IMAGE_PACK_ENABLED || FLASH_PACK_ENABLED) {
+                uploadImages();
+            } else {
+                BleUpload::reject();
+            }
+            break;
+
+        case Slideshow::Command::SHUFFLE:
+            // The next step follows the new order, and prefetch its neighbours
+            if (arg == 2) {
+                Shuffle::setEnabled(true);
+                Shuffle::reshuffle();
+            } else {
+                Shuffle::setEnabled(arg != 0);
+            }
+            ESP_LOGI(TAG_SLIDE, "Shuffle: %s", Shuffle::enabled() ? "ON" : "OFF");
+            break;
+
+        case Slideshow::Command::FAVORITE:
+            showIndicator(Playlists::toggleFavorite(s_currentImageIndex) ? "FAV +" : "FAV -");
+            break;
+
+        case Slideshow::Command::WIDGETS:
+            break;  // The loop's updateWidgets() redraws what changed
+
+        case Slideshow::Command::USB:
+            serveUsbStorage();
+            break;
+
+        case Slideshow::Command::GRID:
+            if (s_gridActive) {
+                closeGrid(true);
+            } else {
+                openGrid(s_currentImageIndex);
+            }
+            break;
+    }
+}
+
+/**
+ * @brief Refresh the current slide with the waveform a REFRESH_ command asks
+ *        for, even when the glass already shows it
+ *
+ * The frame comes from RAM when the framebuffer still holds the slide;
+ * otherwise the slide is decoded again, which always refreshes in full (or
+ * fast) and never as a partial window.
+ */
+static void refreshCurrentImage(Slideshow::Command command)
+{
+    g_display->waitFramebufferFree();
+    bool fast = command == Slideshow::Command::REFRESH_FAST;
+    if ((fast && !Panel::active().fastNavigation) || !g_display->setFastMode(fast)) {
+        ESP_LOGW(TAG_SLIDE, "Fast waveform unavailable");
+        return;
+    }
+    s_fastFrameShown = false;  // Forced, so no settle refresh follows
+
+    // Refresh even if the glass already shows this frame
+    g_display->invalidatePanelHash();
+    if (s_framebufferImage != s_currentImageIndex) {
+        displayCurrentImage();
+    } else if (command == Slideshow::Command::REFRESH_PARTIAL) {
+        g_display->displayPartial(0, 0, g_display->width(), g_display->height());
+        RefreshTiming::learn(*g_display);
+    } else {
+        g_display->displayAsync();
+    }
+
+    if (fast) {
+        // The waveform is loaded with the frame; the next slide is tricolor again
+        g_display->waitFramebufferFree();
+        g_display->setFastMode(false);
+    }
+}
+
+/**
+ * @brief Run a benchmark suite on the slideshow's display, then put the
+ *        current slide back
+ *
+ * The suites draw into the framebuffer and refresh the panel; their SPI
+ * traffic is dropped rather than charged to the slide.
+ */
+static void runBench(Bench::Suite suite)
+{
+    if (suite >= Bench::Suite::COUNT) {
+        return;
+    }
+    waitRefresh();
+    pollSlideStats();
+    g_display->setFastMode(false);
+    s_fastFrameShown = false;
+    s_framebufferImage = SIZE_MAX;
+
+    // The SD suite needs the card, even a released one
+    waitCardScan();
+    SDCard::init();
+    Bench::run(*g_display, suite);
+    releaseCard();
+
+    g_display->resetSPIStats();
+    SPI.resetStats();
+    g_display->invalidatePanelHash();
+    displayCurrentImage();
+}
+
+/**
+ * @brief Update the image pack over Wi-Fi, then show the slides it left
+ *
+ * The pack is closed for the sync, which writes it, and a released card is
+ * mounted for it; the flash pack is then mirrored from the card, even when
+ * Wi-Fi changed nothing (the card may have been swapped). After an update
+ * the indices may mean other images, so nothing decoded under the old ones
+ * is kept and the current slide is shown again.
+ *
+ * Pending telemetry goes out in the same radio window: the radio is held
+ * across both, so it starts and joins the network once.
+ */
+static void syncImages()
+{
+    waitRefresh();
+    waitCardScan();
+    s_imagePack.close();
+    StatusDisplay::showMessage("Syncing images...");
+    uint32_t before = imageListChecksum();
+    SDCard::init();
+    std::unique_ptr<WifiRadio::Link> radio;
+    if (Telemetry::pending()) {
+        radio.reset(new (std::nothrow) WifiRadio::Link());
+    }
+    WifiSync::Result result = WifiSync::run(inputPending);
+    if (radio && radio->connected()) {
+        Telemetry::publish();
+    }
+    radio.reset();
+    showUpdatedPack(result == WifiSync::Result::UPDATED, before);
+}
+
+/**
+ * @brief Receive an image pack over BLE, then show the slides it left
+ *
+ * As syncImages(), with the upload writing the pack in place of WifiSync.
+ */
+static void uploadImages()
+{
+    waitRefresh();
+    waitCardScan();
+    s_imagePack.close();
+    StatusDisplay::showMessage("Receiving images...");
+    uint32_t before = imageListChecksum();
+    SDCard::init();
+    bool updated = BleUpload::receive();
+    showUpdatedPack(updated, before);
+}
+
+/**
+ * @brief Lend the SD card to a USB host, then list it again
+ *
+ * Nothing renders meanwhile: the slideshow task blocks in UsbStorage::serve()
+ * with the pack and cursor closed, so no task touches the card's FAT while
+ * the host writes it. Afterwards the card is mounted afresh and handed to
+ * the card_scan task as a newly inserted one; an eject drops the image index
+ * first, since FAT directory times are no proof the host left it alone. The
+ * slides that scan finds are then converted into the frame cache in the
+ * background (CacheWarm, restarted by reloadImages()).
+ */
+static void serveUsbStorage()
+{
+    if (!UsbStorage::available()) {
+        ESP_LOGW(TAG_SLIDE, "USB storage unavailable in this build");
+        return;
+    }
+    waitRefresh();
+    waitCardScan();
+    if (!SDCard::init()) {
+        ESP_LOGW(TAG_SLIDE, "No SD card to lend over USB");
+        releaseCard();
+        return;
+    }
+    s_imagePack.close();
+    s_imageCursor.close();
+    s_imageFiles.reset(IMAGE_DIRECTORY);
+    SlideCache::clear();
+    for (PrefetchSlot& slot : s_prefetch) {
+        slot.status = PrefetchSlot::Status::EMPTY;
+    }
+    s_redrawPending = false;
+    s_framebufferImage = SIZE_MAX;
+    StatusDisplay::showMessage("USB storage: eject to resume");
+    setState(Slideshow::State::SCANNING);
+
+    UsbStorage::Result result = UsbStorage::serve();
+
+    // Remount: the host may have changed anything under the FAT caches
+    SDCard::deinit();
+    if (result == UsbStorage::Result::EJECTED && SDCard::init()) {
+        SDCard::invalidateImageIndex();
+        SDCard::deinit();
+    }
+    StatusDisplay::showMessage("Listing SD card...");
+    setState(Slideshow::State::ERROR);  // Until the scan brings slides
+    startCardScan();
+}
+
+/**
+ * @brief Reopen the pack a sync or upload wrote and show its slides
+ *
+ * The flash pack is mirrored from the card and the card released; the
+ * current slide is only shown again as new if the pack changed.
+ *
+ * @param updated The pack was rewritten
+ * @param before imageListChecksum() before it was closed
+ */
+static void showUpdatedPack(bool updated, uint32_t before)
+{
+    openImagePack();
+    releaseCard();
+    if (imageCount() == 0) {
+        drawErrorScreen("No images found");
+        setState(Slideshow::State::ERROR);
+        return;
+    }
+    if (!updated && imageListChecksum() == before) {
+        char path[SDCard::ImageList::MAX_PATH] = "";
+        imagePath(s_currentImageIndex, path, sizeof(path));
+        showSlideStatus(path);
+        return;
+    }
+    reloadImages("Image pack updated");
+}
+
+/**
+ * @brief Show the current slide of an image list that changed under it
+ *
+ * The indices may mean other images now, so nothing decoded under the old
+ * ones is kept.
+ */
+static void reloadImages(const char* why)
+{
+    SlideCache::clear();
+    for (PrefetchSlot& slot : s_prefetch) {
+        slot.status = PrefetchSlot::Status::EMPTY;
+    }
+    s_framebufferImage = SIZE_MAX;
+    if (s_currentImageIndex >= imageCount()) {
+        s_currentImageIndex = 0;
+    }
+    BadImages::load(imageListChecksum(), imageCount());
+    Captions::load(imageListChecksum(), packOpen() ? 0 : imageCount(), imagePath);
+    CacheWarm::restart();
+    Playlists::load(imageListChecksum(), imageCount());
+    ESP_LOGI(TAG_SLIDE, "%s: %zu images", why, imageCount());
+    setState(Slideshow::State::DISPLAYING);
+    s_lastAutoAdvanceTick = xTaskGetTickCount();
+    displayCurrentImage();
+}
+
+/**
+ * @brief Mount and list a new card (card_scan task)
+ *
+ * A pack on the card is opened by the slideshow task afterwards (it may
+ * rewrite the flash pack the slides are read from); only a card without
+ * one has its directories listed here. The index makes that a stat per
+ * directory on a card seen before.
+ */
+static void cardScanTask(void* arg)
+{
+    (void)arg;
+    s_cardScan.mounted = SDCard::init();
+    bool pack = (IMAGE_PACK_ENABLED || FLASH_PACK_ENABLED) && SDCard::getFileSize(IMAGE_PACK_FILE) >= 0;
+    if (s_cardScan.mounted && !pack && !LAZY_IMAGE_LIST) {
+        SDCard::scanForImages(IMAGE_DIRECTORY, s_cardScan.files,
+                              IMAGE_SCAN_PROBE ? ImageLoader::probe : nullptr);
+    }
+    s_cardScan.done = true;
+    SlideshowButtonEvent wake{SlideshowButtonId::RESUME, SlideshowButtonAction::PRESS};
+    xQueueSend(s_buttonQueue, &wake, 0);
+    vTaskDelete(nullptr);
+}
+
+/**
+ * @brief Check the card slot, at most every SD_HOTPLUG_POLL_SEC
+ *
+ * A card that stopped answering is unmounted and its list dropped. A card
+ * that may have come in is handed to the card_scan task. A card released on
+ * purpose (FLASH_PACK_RELEASE_SD) is only looked at again when the detect
+ * pin sees it go in.
+ */
+static bool cardPolled()
+{
+    // A card released on purpose is only seen again through the detect pin
+    bool released = FlashPack::isOpen() && FLASH_PACK_RELEASE_SD && !SDCard::isMounted();
+    return SD_HOTPLUG_ENABLED && (SDCard::hasDetectPin() || !released);
+}
+
+static void pollCard()
+{
+    if (!cardPolled() || s_cardScan.running ||
+        ticksUntil(s_lastCardPoll, SD_HOTPLUG_POLL_SEC) != 0) {
+        return;
+    }
+    s_lastCardPoll = xTaskGetTickCount();
+    bool inSlot = SDCard::present();
+    bool inserted = inSlot && !s_cardInSlot;
+    s_cardInSlot = inSlot;
+
+    if (SDCard::isMounted()) {
+        if (inSlot) {
+            return;
+        }
+        ESP_LOGW(TAG_SLIDE, "SD card removed");
+        waitRefresh();
+        s_imagePack.close();
+        s_imageCursor.close();
+        s_imageFiles.reset(IMAGE_DIRECTORY);
+        SDCard::deinit();
+        if (FlashPack::isOpen()) {
+            return;  // The slides come from flash
+        }
+        // The last slide stays on the glass until a card is back
+        SlideCache::clear();
+        for (PrefetchSlot& slot : s_prefetch) {
+            slot.status = PrefetchSlot::Status::EMPTY;
+        }
+        s_redrawPending = false;
+        StatusDisplay::showMessage("Insert SD card");
+        setState(Slideshow::State::ERROR);
+        return;
+    }
+
+    // Unmounted: a released card is looked at once it goes in again, a
+    // missing one whenever the slot may hold a card
+    bool released = FlashPack::isOpen() && FLASH_PACK_RELEASE_SD;
+    if (released ? !inserted : !inSlot && SDCard::hasDetectPin()) {
+        return;
+    }
+    startCardScan();
+}
+
+/**
+ * @brief Mount and list the card on the card_scan task
+ */
+static void startCardScan()
+{
+    s_cardScan.running = true;
+    s_cardScan.files.reset(IMAGE_DIRECTORY);
+    if (xTaskCreate(cardScanTask, "card_scan", BOOT_SD_TASK_STACK, nullptr,
+                    SLIDESHOW_TASK_PRIORITY - 1, nullptr) != pdPASS) {
+        s_cardScan.running = false;
+    }
+}
+
+/**
+ * @brief Take over what the card_scan task found (slideshow task)
+ */
+static void finishCardScan()
+{
+    s_cardScan.done = false;
+    s_cardScan.running = false;
+    if (!s_cardScan.mounted) {
+        return;  // Still no card; the next poll tries again
+    }
+    ESP_LOGI(TAG_SLIDE, "SD card inserted");
+    waitRefresh();
+    uint32_t before = imageListChecksum();
+    bool wasShowing = s_state == Slideshow::State::DISPLAYING;
+    if (!openImagePack()) {
+        s_imageFiles = std::move(s_cardScan.files);
+        if (LAZY_IMAGE_LIST || s_imageFiles.size() >= MAX_IMAGE_FILES) {
+            if (s_imageCursor.open(IMAGE_DIRECTORY) && s_imageCursor.size() > s_imageFiles.size()) {
+                s_imageFiles.reset(IMAGE_DIRECTORY);
+            } else {
+                s_imageCursor.close();
+            }
+        }
+    }
+    s_cardScan.files.reset(IMAGE_DIRECTORY);
+    releaseCard();
+    if (imageCount() == 0) {
+        drawErrorScreen("No images found");
+        setState(Slideshow::State::ERROR);
+        return;
+    }
+    if (wasShowing && imageListChecksum() == before) {
+        return;  // The same slides (flash pack already in line with the card)
+    }
+    reloadImages("SD card listed");
+}
+
+/**
+ * @brief Let a running card scan finish before the card is used here
+ */
+static void waitCardScan()
+{
+    while (s_cardScan.running && !s_cardScan.done) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    if (s_cardScan.done) {
+        finishCardScan();
+    }
+}
+
+/**
+ * @brief Show the frame FramePush received in place of the current slide
+ *
+ * It stays up like a slide until input or auto-advance moves on; the
+ * framebuffer no longer holds the slide, so going back to it decodes again.
+ */
+static void showPushedFrame()
+{
+    g_display->waitFramebufferFree();
+    g_display->setFastMode(false);
+    s_fastFrameShown = false;
+    s_framebufferImage = SIZE_MAX;
+    s_lastAutoAdvanceTick = xTaskGetTickCount();
+    if (FramePush::showPending(g_display)) {
+        s_redrawPending = false;  // The frame replaces a slide it cut short
+    }
+}
+
+/**
+ * @brief Follower: show the slide the leader cast, at its show time
+ *
+ * The cast frame itself when it came through whole; otherwise the slide
+ * with the same index, if this unit's image list is the leader's.
+ */
+static void showCastFrame()
+{
+    g_display->waitFramebufferFree();
+    g_display->setFastMode(false);
+    s_fastFrameShown = false;
+    size_t index = 0;
+    switch (FrameCast::showPending(g_display, imageListChecksum(), index)) {
+        case FrameCast::Received::FRAME:
+            s_framebufferImage = SIZE_MAX;
+            s_redrawPending = false;  // The frame replaces a slide it cut short
+            break;
+        case FrameCast::Received::INDEX:
+            if (s_state == Slideshow::State::DISPLAYING && index < imageCount()) {
+                s_currentImageIndex = index;
+                displayCurrentImage();
+            } else {
+                g_display->setRefreshTime(0);
+            }
+            break;
+        case FrameCast::Received::NONE:
+            break;
+    }
+}
+
+/**
+ * @brief Leader: cast a slide to the followers and hold its refresh for
+ *        the show time
+ *
+ * Frames of a pack go out whole, from flash or the card; a slide from the
+ * image directory goes as its index only.
+ */
+static void castSlide(size_t index)
+{
+    struct FlashFrame {
+        const uint8_t* data;
+        size_t offset;
+    };
+    ImageLoader::FrameReader read = nullptr;
+    void* ctx = nullptr;
+    size_t length = 0;
+    FlashFrame flash = {};
+    if (FlashPack::isOpen()) {
+        flash.data = FlashPack::frame(index, length);
+        read = [](void* ctx, void* dst, size_t len) {
+            FlashFrame* frame = static_cast<FlashFrame*>(ctx);
+            memcpy(dst, frame->data + frame->offset, len);
+            frame->offset += len;
+            return len;
+        };
+        ctx = &flash;
+    } else if (s_imagePack.isOpen() &&
+               s_imagePack.entry(index).format == SDCard::IMAGE_PACK_FORMAT_EPD) {
+        FILE* file = s_imagePack.seek(index);
+        if (file) {
+            length = s_imagePack.entry(index).length;
+            read = [](void* ctx, void* dst, size_t len) {
+                return fread(dst, 1, len, static_cast<FILE*>(ctx));
+            };
+            ctx = file;
+        }
+    }
+    g_display->setRefreshTime(FrameCast::cast(index, imageListChecksum(), read, ctx, length));
+}
+
+/**
+ * @brief Move by a net number of slides (negative = back) and show only the target
+ */
+static void navigate(int steps)
+{
+    size_t count = imageCount();
+    if (count == 0) {
+        return;
+    }
+    s_lastAutoAdvanceTick = xTaskGetTickCount();
+
+    size_t offset = static_cast<size_t>(steps < 0 ? -steps : steps) % count;
+    if (steps < 0) {
+        offset = (count - offset) % count;
+    }
+    if (offset == 0 && s_framebufferImage == s_currentImageIndex) {
+        return;  // The presses cancelled out
+    }
+    if (steps > 1 || steps < -1) {
+        ESP_LOGI(TAG_SLIDE, "Coalesced presses: %+d slides", steps);
+    }
+
+    // A step soon after the last one, or into a running refresh, is part of
+    // rapid browsing: use the fast waveform until navigation pauses
+    TickType_t now = xTaskGetTickCount();
+    bool rapid = FAST_NAVIGATION_ENABLED && Panel::active().fastNavigation &&
+                 (s_fastFrameShown || g_display->isRefreshing() ||
+                  (s_lastNavigationTick != 0 &&
+                   now - s_lastNavigationTick < pdMS_TO_TICKS(FAST_NAVIGATION_WINDOW_MS)));
+    s_lastNavigationTick = now;
+    if (rapid) {
+        g_display->waitFramebufferFree();
+        if (g_display->chooseRefresh(true) == EPD_REFRESH_FAST) {
+            s_fastFrameShown = g_display->setFastMode(true);
+        } else {
+            ESP_LOGI(TAG_SLIDE, "Ghosting budget spent, full refresh");
+            g_display->setFastMode(false);
+            s_fastFrameShown = false;
+        }
+    }
+
+    s_currentImageIndex = Playlists::step(s_currentImageIndex, steps, count);
+    PrefetchPlan::step(steps);
+    displayCurrentImage();
+}
+
+/**
+ * @brief Hold-to-scroll: move the target while UP/DOWN is held, showing
+ *        only its index, and show the target itself on release
+ *
+ * Starts at the long press (the press has already stepped once). Repeats
+ * queued behind the event are folded in, so a slow preview never leaves
+ * the target behind the button. Nothing is decoded until the release,
+ * which refreshes the target with the normal waveform.
+ */
+static void scroll(const SlideshowButtonEvent& evt)
+{
+    size_t count = imageCount();
+    if (count == 0) {
+        s_scrolling = false;
+        return;
+    }
+    if (evt.action == SlideshowButtonAction::RELEASE) {
+        s_scrolling = false;
+        ESP_LOGI(TAG_SLIDE, "Scrolled to image %zu", s_scrollTarget + 1);
+        s_lastAutoAdvanceTick = xTaskGetTickCount();
+        g_display->waitFramebufferFree();
+        g_display->setFastMode(false);
+        s_fastFrameShown = false;
+        s_lastNavigationTick = 0;
+        s_currentImageIndex = s_scrollTarget;
+        if (s_framebufferImage == s_currentImageIndex) {
+            g_display->displayAsync();
+        } else {
+            displayCurrentImage();
+        }
+        return;
+    }
+    if (!s_scrolling) {
+        s_scrolling = true;
+        s_scrollTarget = s_currentImageIndex;
+        s_scrollSteps = 0;
+    }
+
+    auto step = [](const SlideshowButtonEvent& e) {
+        int stride = s_scrollSteps++ < FAST_SCROLL_ACCELERATE_AFTER
+                         ? 1 : static_cast<int>(FAST_SCROLL_STRIDE);
+        return (e.id == SlideshowButtonId::DOWN) ? stride : -stride;
+    };
+    int steps = step(evt);
+    SlideshowButtonEvent next;
+    while (xQueuePeek(s_buttonQueue, &next, 0) == pdTRUE &&
+           (next.id == SlideshowButtonId::UP || next.id == SlideshowButtonId::DOWN) &&
+           next.action != SlideshowButtonAction::RELEASE) {
+        xQueueReceive(s_buttonQueue, &next, 0);
+        steps += step(next);
+    }
+    size_t offset = static_cast<size_t>(steps < 0 ? -steps : steps) % count;
+    if (steps < 0) {
+        offset = (count - offset) % count;
+    }
+    s_scrollTarget = (s_scrollTarget + offset) % count;
+    s_lastAutoAdvanceTick = xTaskGetTickCount();
+
+    // The release may already be waiting; then the preview would be wasted
+    if (uxQueueMessagesWaiting(s_buttonQueue) == 0) {
+        showScrollIndex();
+    }
+}
+
+/**
+ * @brief Show the scroll target's index: on the status OLED, or in a strip
+ *        across the middle of the panel refreshed as a partial window,
+ *        with the slide's thumbnail when the pack has them
+ *
+ * The strip is drawn over the framebuffer, which then no longer holds a
+ * slide. While a slide refreshes the panel can't take the window; the
+ * next step draws it.
+ */
+static void showScrollIndex()
+{
+    if (StatusDisplay::available()) {
+        char path[SDCard::ImageList::MAX_PATH] = "";
+        imagePath(s_scrollTarget, path, sizeof(path));
+        StatusDisplay::showSlide(s_scrollTarget, imageCount(), s_autoAdvance,
+                                 path[0] ? path : nullptr);
+        return;
+    }
+    if (g_display->isRefreshing()) {
+        return;
+    }
+    static constexpr int16_t MARGIN = 4;
+    static constexpr uint8_t TEXT_SIZE = 2;
+
+    char text[24];
+    snprintf(text, sizeof(text), "%zu/%zu", s_scrollTarget + 1, imageCount());
+    int16_t textWidth = static_cast<int16_t>(strlen(text) * 6 * TEXT_SIZE - TEXT_SIZE);
+
+    // A thumbnail goes left of the index, where both fit
+    std::unique_ptr<GFXcanvas1> thumb = loadThumbnail(s_scrollTarget);
+    if (thumb && (thumb->width() + textWidth + 3 * MARGIN > DISPLAY_WIDTH ||
+                  thumb->height() + 2 * MARGIN > DISPLAY_HEIGHT)) {
+        thumb.reset();
+    }
+    int16_t stripHeight = thumb ? thumb->height() + 2 * MARGIN : 32;
+    int16_t top = (DISPLAY_HEIGHT - stripHeight) / 2;
+
+    g_display->waitFramebufferFree();
+    s_framebufferImage = SIZE_MAX;
+    g_display->fillRect(0, top, DISPLAY_WIDTH, stripHeight, EPD_WHITE);
+    g_display->drawFastHLine(0, top, DISPLAY_WIDTH, EPD_BLACK);
+    g_display->drawFastHLine(0, top + stripHeight - 1, DISPLAY_WIDTH, EPD_BLACK);
+    g_display->setTextColor(EPD_BLACK);
+    g_display->setTextSize(TEXT_SIZE);
+    int16_t textLeft = 0;
+    if (thumb) {
+        g_display->blitCanvas(*thumb, MARGIN, top + MARGIN, EPD_BLACK, EPD_BLIT_COPY);
+        textLeft = thumb->width() + MARGIN;
+    }
+    g_display->setCursor(textLeft + (DISPLAY_WIDTH - textLeft - textWidth) / 2,
+                         top + (stripHeight - 8 * TEXT_SIZE) / 2);
+    g_display->print(text);
+    g_display->displayPartial(0, top, DISPLAY_WIDTH, top + stripHeight);
+    RefreshTiming::learn(*g_display);
+}
+
+/**
+ * @brief Hold-to-scroll or the contact sheet owns the panel: no prefetch,
+ *        redraw, settle refresh, auto-advance or sleep until it ends
+ */
+static bool browsing()
+{
+    return s_scrolling || s_gridActive;
+}
+
+/**
+ * @brief Contact sheet geometry: cells of a thumbnail plus GRID_TILE_MARGIN
+ *        on each side, as many as fit, centered
+ */
+struct GridLayout {
+    int16_t cols;
+    int16_t rows;
+    int16_t cellWidth;
+    int16_t cellHeight;
+    int16_t left;
+    int16_t top;
+
+    size_t perPage() const { return static_cast<size_t>(cols) * rows; }
+    int16_t x(size_t slot) const { return left + static_cast<int16_t>(slot % cols) * cellWidth; }
+    int16_t y(size_t slot) const { return top + static_cast<int16_t>(slot / cols) * cellHeight; }
+};
+
+/**
+ * @return false if the open pack has no thumbnails, or one doesn't fit
+ */
+static bool gridLayout(GridLayout& out)
+{
+    uint8_t width;
+    uint8_t height;
+    if (!thumbnailSize(width, height)) {
+        return false;
+    }
+    out.cellWidth = width + 2 * GRID_TILE_MARGIN;
+    out.cellHeight = height + 2 * GRID_TILE_MARGIN;
+    out.cols = DISPLAY_WIDTH / out.cellWidth;
+    out.rows = DISPLAY_HEIGHT / out.cellHeight;
+    out.left = (DISPLAY_WIDTH - out.cols * out.cellWidth) / 2;
+    out.top = (DISPLAY_HEIGHT - out.rows * out.cellHeight) / 2;
+    return out.cols > 0 && out.rows > 0;
+}
+
+/**
+ * @brief Frame a cell as selected (EPD_BLACK) or not (EPD_WHITE), inside
+ *        its margin
+ */
+static void drawGridFrame(const GridLayout& layout, size_t slot, uint16_t color)
+{
+    for (int16_t inset = 1; inset <= 2; inset++) {
+        g_display->drawRect(layout.x(slot) + inset, layout.y(slot) + inset,
+                            layout.cellWidth - 2 * inset, layout.cellHeight - 2 * inset, color);
+    }
+}
+
+/**
+ * @brief Draw the page holding the selection and refresh it in one go,
+ *        with the fast waveform where the panel and ghosting budget allow
+ *
+ * Only thumbnails are read; a slide without one leaves its cell blank.
+ */
+static void showGridPage(const GridLayout& layout)
+{
+    g_display->waitFramebufferFree();
+    s_framebufferImage = SIZE_MAX;
+    bool fast = Panel::active().fastNavigation && g_display->chooseRefresh(true) == EPD_REFRESH_FAST;
+    g_display->setFastMode(fast);
+    s_gridPageStart = s_gridSelection - s_gridSelection % layout.perPage();
+
+    g_display->clearBuffer();
+    size_t count = imageCount();
+    for (size_t slot = 0; slot < layout.perPage() && s_gridPageStart + slot < count; slot++) {
+        std::unique_ptr<GFXcanvas1> thumb = loadThumbnail(s_gridPageStart + slot);
+        if (thumb) {
+            g_display->blitCanvas(*thumb, layout.x(slot) + GRID_TILE_MARGIN,
+                                  layout.y(slot) + GRID_TILE_MARGIN, EPD_BLACK, EPD_BLIT_COPY);
+        }
+    }
+    drawGridFrame(layout, s_gridSelection - s_gridPageStart, EPD_BLACK);
+    ESP_LOGI(TAG_SLIDE, "Grid: images %zu-%zu of %zu", s_gridPageStart + 1,
+             std::min(s_gridPageStart + layout.perPage(), count), count);
+    g_display->displayAsync();
+}
+
+/**
+ * @brief Show the contact sheet with a slide selected
+ * @return false if it is disabled or the pack has no thumbnails
+ */
+static bool openGrid(size_t index)
+{
+    GridLayout layout;
+    if (!GRID_VIEW_ENABLED || imageCount() == 0 || !gridLayout(layout)) {
+        ESP_LOGW(TAG_SLIDE, "Grid needs an image pack with thumbnails");
+        return false;
+    }
+    s_scrolling = false;
+    s_gridActive = true;
+    s_gridHeldIgnored = false;
+    s_selectArmed = false;
+    s_gridSelection = index % imageCount();
+    showGridPage(layout);
+    return true;
+}
+
+/**
+ * @brief Leave the contact sheet for the selected slide
+ * @param show Display the slide; false when the caller puts up something else
+ */
+static void closeGrid(bool show)
+{
+    s_gridActive = false;
+    g_display->waitFramebufferFree();
+    g_display->setFastMode(false);
+    s_fastFrameShown = false;
+    s_lastNavigationTick = 0;
+    s_lastAutoAdvanceTick = xTaskGetTickCount();
+    s_currentImageIndex = s_gridSelection;
+    if (show) {
+        displayCurrentImage();
+    }
+}
+
+/**
+ * @brief Buttons on the contact sheet: UP/DOWN move the selection (by
+ *        partial refresh of the two cells), holding them turns pages, and
+ *        SELECT shows the selected slide
+ */
+static void gridButton(const SlideshowButtonEvent& evt)
+{
+    GridLayout layout;
+    size_t count = imageCount();
+    if (count == 0 || !gridLayout(layout)) {
+        closeGrid(true);
+        return;
+    }
+
+    if (evt.id == SlideshowButtonId::SELECT) {
+        if (evt.action == SlideshowButtonAction::PRESS) {
+            s_selectArmed = true;
+        } else if (evt.action == SlideshowButtonAction::LONG_PRESS) {
+            s_selectArmed = false;
+        } else if (evt.action == SlideshowButtonAction::RELEASE && s_selectArmed) {
+            s_selectArmed = false;
+            closeGrid(true);
+        }
+        return;
+    }
+
+    auto step = [&layout](const SlideshowButtonEvent& e) -> long {
+        long stride = 1;
+        if (e.action == SlideshowButtonAction::RELEASE) {
+            s_gridHeldIgnored = false;
+            return 0;
+        }
+        if (s_gridHeldIgnored) {
+            return 0;
+        }
+        if (e.action != SlideshowButtonAction::PRESS) {
+            stride = static_cast<long>(layout.perPage());
+        }
+        return (e.id == SlideshowButtonId::DOWN) ? stride : -stride;
+    };
+    long steps = step(evt);
+    SlideshowButtonEvent next;
+    while (xQueuePeek(s_buttonQueue, &next, 0) == pdTRUE &&
+           (next.id == SlideshowButtonId::UP || next.id == SlideshowButtonId::DOWN)) {
+        xQueueReceive(s_buttonQueue, &next, 0);
+        steps += step(next);
+    }
+    size_t offset = static_cast<size_t>(steps < 0 ? -steps : steps) % count;
+    if (steps < 0) {
+        offset = (count - offset) % count;
+    }
+    if (offset == 0) {
+        return;
+    }
+
+    size_t previous = s_gridSelection;
+    s_gridSelection = (s_gridSelection + offset) % count;
+    if (s_gridSelection / layout.perPage() != previous / layout.perPage()) {
+        showGridPage(layout);
+        return;
+    }
+
+    // Same page: move the frame and refresh the window over both cells
+    g_display->waitFramebufferFree();
+    size_t from = previous - s_gridPageStart;
+    size_t to = s_gridSelection - s_gridPageStart;
+    drawGridFrame(layout, from, EPD_WHITE);
+    drawGridFrame(layout, to, EPD_BLACK);
+    int16_t x1 = std::min(layout.x(from), layout.x(to));
+    int16_t y1 = std::min(layout.y(from), layout.y(to));
+    int16_t x2 = std::max(layout.x(from), layout.x(to)) + layout.cellWidth;
+    int16_t y2 = std::max(layout.y(from), layout.y(to)) + layout.cellHeight;
+    g_display->displayPartial(x1, y1, x2, y2);
+    RefreshTiming::learn(*g_display);
+}
+
+/**
+ * @brief Waveform for an auto-advanced slide: the fast mono one in a
+ *        "fast" schedule period or on a low battery, while the ghosting
+ *        budget lasts; the normal one otherwise
+ */
+static void applyAutoAdvanceWaveform()
+{
+    if (s_fastFrameShown || !Panel::active().fastNavigation) {
+        return;  // Fast navigation owns the waveform until it settles
+    }
+    g_display->waitFramebufferFree();
+    bool fast = (Schedule::fastWaveform() || Battery::preferMono()) &&
+                g_display->chooseRefresh(true) == EPD_REFRESH_FAST;
+    g_display->setFastMode(fast);
+}
+
+/**
+ * @brief Auto-advance dwell: the schedule period's, stretched on a low
+ *        battery
+ */
+static uint32_t dwellSec()
+{
+    return Schedule::dwellSec() * Battery::dwellFactor();
+}
+
+/**
+ * @brief Back to the tricolor waveform, refreshing the slide from RAM when
+ *        the framebuffer still holds it
+ */
+static void finishFastNavigation()
+{
+    g_display->waitFramebufferFree();
+    g_display->setFastMode(false);
+    s_fastFrameShown = false;
+    ESP_LOGI(TAG_SLIDE, "Navigation settled, full refresh");
+    if (s_framebufferImage == s_currentImageIndex) {
+        g_display->displayAsync();
+    } else {
+        displayCurrentImage();
+    }
+}
+
+/**
+ * @brief Keep an input's stamp for the next slide's record, unless an
+ *        older one is still waiting (coalesced inputs count from the first)
+ * @param stamp SlideshowButtonEvent::stamp, 0 for none
+ */
+static void noteInput(int64_t stamp)
+{
+    if (stamp != 0 && (s_inputAt == 0 || stamp < s_inputAt)) {
+        s_inputAt = stamp;
+    }
+}
+
+/**
+ * @brief Start the stage record of a slide that is about to be shown
+ *
+ * A record still waiting for its refresh is logged without it: the new
+ * slide's refresh is the next one to finish. The record answers the
+ * input waiting in s_inputAt, if any.
+ */
+static void beginSlideStats(size_t index)
+{
+    pollSlideStats();
+    takeSpiStats(s_statsPending);
+    logSlideStats(s_statsPending);
+    s_statsPending = 0;
+    markSlidePower(index);
+    PipelineTrace::slide(index);
+    s_statsInputAt = s_inputAt;
+    s_inputAt = 0;
+    SlideStats::begin(index, s_statsInputAt);
+}
+
+/**
+ * @brief Close the record; with refreshStarted, it waits for the refresh
+ *        timings (pollSlideStats()) before it is logged
+ *
+ * Without a refresh the input it answered is still waiting: an abandoned
+ * slide's redraw takes it over.
+ */
+static void endSlideStats(bool refreshStarted)
+{
+    uint32_t id = SlideStats::end();
+    if (refreshStarted) {
+        s_statsPending = id;
+    } else {
+        noteInput(s_statsInputAt);
+        takeSpiStats(id);
+        logSlideStats(id);
+    }
+    s_statsInputAt = 0;
+}
+
+/**
+ * @brief Once the pending slide's refresh is done, add its panel stages and
+ *        log the record
+ */
+static void pollSlideStats()
+{
+    if (g_display->isRefreshing()) {
+        return;
+    }
+    RefreshTiming::learn(*g_display);
+    epd_timing_t timing;
+    g_display->getTiming(timing);
+    if (s_statsPending) {
+        // An unchanged count means the refresh was skipped (same frame)
+        if (timing.count != s_statsRefreshCount) {
+            SlideStats::add(s_statsPending, SlideStats::Stage::POWER_UP, timing.power_up_us);
+            SlideStats::add(s_statsPending, SlideStats::Stage::PLANE1, timing.plane_us[0]);
+            SlideStats::add(s_statsPending, SlideStats::Stage::PLANE2, timing.plane_us[1]);
+            SlideStats::add(s_statsPending, SlideStats::Stage::REFRESH, timing.refresh_us);
+            SlideStats::add(s_statsPending, SlideStats::Stage::POWER_DOWN, timing.power_down_us);
+            SlideStats::addRefresh(s_statsPending, s_refreshStartAt.load(),
+                                   s_refreshDoneAt.load());
+        }
+        takeSpiStats(s_statsPending);
+        logSlideStats(s_statsPending);
+        s_statsPending = 0;
+    }
+    s_statsRefreshCount = timing.count;
+}
+
+/**
+ * @brief Log a finished record, and add it to the perf log on the card
+ */
+static void logSlideStats(uint32_t id)
+{
+    SlideStats::log(id);
+    PerfLog::slide(id, s_panelCelsius);
+    Telemetry::slide(id);
+}
+
+/**
+ * @brief Add the SPI traffic since the last call to a record (none if id is
+ *        0) and restart the counters
+ *
+ * Covers the display's SPI device and SPIClass's own transfers (the SRAM
+ * framebuffer); the SD card's driver isn't counted. Prefetch records get
+ * none: their traffic goes to the slide on screen.
+ */
+static void takeSpiStats(uint32_t id)
+{
+    BusIOStats stats;
+    g_display->getSPIStats(stats);
+    stats.merge(SPI.getStats());
+    g_display->resetSPIStats();
+    SPI.resetStats();
+
+    SlideStats::SpiCounters counters = {};
+    counters.transactions = stats.transactions;
+    counters.bytes = stats.bytes;
+    counters.busyUs = static_cast<uint32_t>(std::min<int64_t>(stats.busy_us, UINT32_MAX));
+    counters.queuePeak = stats.queue_peak;
+    SlideStats::addSpi(id, counters);
+    PowerStats::add(PowerStats::Load::SPI, stats.busy_us);
+}
+
+/**
+ * @brief Log the charge of the slide on screen until now, from its begin
+ *        to the next one's, dwell included; next opens its window
+ * @param next Slide about to begin, SIZE_MAX for none
+ * @param sleepUs Deep sleep about to follow, charged to the slide on screen
+ */
+static void markSlidePower(size_t next, uint64_t sleepUs)
+{
+    PowerStats::Usage usage;
+    PowerStats::mark(usage);
+    PowerStats::addDeepSleep(usage, sleepUs);
+    char label[24];
+    if (s_powerSlide == SIZE_MAX) {
+        snprintf(label, sizeof(label), "Boot");
+    } else {
+        snprintf(label, sizeof(label), "Slide %zu", s_powerSlide + 1);
+    }
+    PowerStats::log(label, usage);
+    PerfLog::power(s_powerSlide, usage);
+    Telemetry::power(s_powerSlide != SIZE_MAX, usage);
+    s_powerSlide = next;
+}
+
+/**
+ * @brief Panel power callback: charge pumps and refresh as PowerStats loads
+ */
+static void onPanelPower(Adafruit_EPD* epd, epd_power_state_t state, void* arg)
+{
+    (void)arg;
+    PowerStats::set(PowerStats::Load::REFRESH, state == EPD_POWER_REFRESH);
+    PowerStats::set(PowerStats::Load::PANEL, state != EPD_POWER_OFF);
+
+    if (state == EPD_POWER_REFRESH) {
+        Telemetry::refresh(epd->getRefreshMode());
+    }
+
+    // The first refresh that starts once a slide is in the framebuffer shows
+    // it; a boot status screen already refreshing by then doesn't count
+    if (state == EPD_POWER_REFRESH && BootProfile::reached(BootProfile::Mark::FRAME_READY)) {
+        BootProfile::mark(BootProfile::Mark::REFRESH);
+    } else if (state != EPD_POWER_REFRESH && BootProfile::reached(BootProfile::Mark::REFRESH) &&
+               !BootProfile::reached(BootProfile::Mark::GLASS)) {
+        BootProfile::mark(BootProfile::Mark::GLASS);
+        Telemetry::boot();
+    }
+}
+
+/**
+ * @brief Panel trace callback: power-up, plane writes, refresh and
+ *        power-down on the PipelineTrace timeline, as the stages of the
+ *        same names; the refresh's span is kept for the input latency
+ */
+static void onPanelTrace(Adafruit_EPD* epd, epd_trace_t span, int64_t startUs, int64_t endUs,
+                         void* arg)
+{
+    (void)epd;
+    (void)arg;
+    if (span == EPD_TRACE_REFRESH) {
+        s_refreshStartAt = startUs;
+        s_refreshDoneAt = endUs;
+    }
+    static constexpr SlideStats::Stage STAGES[] = {
+        SlideStats::Stage::POWER_UP, SlideStats::Stage::PLANE1, SlideStats::Stage::PLANE2,
+        SlideStats::Stage::REFRESH, SlideStats::Stage::POWER_DOWN,
+    };
+    if (static_cast<size_t>(span) < std::size(STAGES)) {
+        PipelineTrace::span(STAGES[span], startUs, endUs);
+    }
+}
+
+/**
+ * @brief Wait for the panel refresh at the minimum clock
+ *
+ * The upload already went out under the driver's own lock; the rest of
+ * the refresh is spent on the busy pin, so the slideshow's clock lock is
+ * let go for it.
+ */
+static void waitRefresh()
+{
+    CpuBoost::set(CpuBoost::Holder::SLIDESHOW, false);
+    g_display->waitRefresh();
+    CpuBoost::set(CpuBoost::Holder::SLIDESHOW, true);
+}
+
+/**
+ * @brief A button event other than a release is waiting
+ */
+static bool inputPending()
+{
+    // Releases follow every press and change nothing on screen
+    SlideshowButtonEvent next;
+    return s_buttonQueue && xQueuePeek(s_buttonQueue, &next, 0) == pdTRUE &&
+           next.action != SlideshowButtonAction::RELEASE && next.id != SlideshowButtonId::RESUME;
+}
+
+/**
+ * @brief RenderJob preempt check: any input stops a prefetch or a
+ *        background conversion; a slide being
+ *        shown only stops for input that replaces it (UP/DOWN, GOTO, BENCH,
+ *        PUSH, CAST, GRID)
+ *
+ * Looks at the oldest event only: the queue can't be searched without
+ * taking events off it. Runs on the slideshow and refresh tasks.
+ */
+static bool preempts(RenderJob::Priority running)
+{
+    SlideshowButtonEvent next;
+    if (!s_buttonQueue || xQueuePeek(s_buttonQueue, &next, 0) != pdTRUE ||
+        next.action == SlideshowButtonAction::RELEASE || next.id == SlideshowButtonId::RESUME) {
+        return false;
+    }
+    if (running != RenderJob::Priority::DISPLAY) {
+        return true;
+    }
+    switch (next.id) {
+        case SlideshowButtonId::UP:
+        case SlideshowButtonId::DOWN:
+            return true;
+        case SlideshowButtonId::COMMAND:
+            return next.command == static_cast<uint8_t>(Slideshow::Command::GOTO) ||
+                   next.command == static_cast<uint8_t>(Slideshow::Command::BENCH) ||
+                   next.command == static_cast<uint8_t>(Slideshow::Command::PUSH) ||
+                   next.command == static_cast<uint8_t>(Slideshow::Command::CAST) ||
+                   next.command == static_cast<uint8_t>(Slideshow::Command::GRID);
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Display cancel callback: stop uploading a slide that newer input
+ *        replaces, so its refresh doesn't hold up the next one
+ *
+ * Only while slides are shown: boot, error and sleep screens always finish.
+ */
+static bool cancelUpload(Adafruit_EPD* epd, void* arg)
+{
+    (void)epd;
+    (void)arg;
+    return s_state == Slideshow::State::DISPLAYING &&
+           RenderJob::preempted(RenderJob::Priority::DISPLAY);
+}
+
+/**
+ * @brief Show the current image, moving on past images that fail
+ *
+ * Images that failed before are passed over without an attempt; one that
+ * fails now is marked and skipped for the next. Gives up after
+ * MAX_IMAGE_SKIPS failures or once round the list.
+ */
+static void displayCurrentImage()
+{
+    size_t count = imageCount();
+    size_t failures = 0;
+    for (size_t visited = 0; visited < count; visited++) {
+        if (!BadImages::contains(s_currentImageIndex)) {
+            if (showCurrentImage()) {
+                return;
+            }
+            ESP_LOGW(TAG_SLIDE, "Failed to load image %zu, skipping", s_currentImageIndex + 1);
+            BadImages::mark(s_currentImageIndex);
+            PerfLog::failure(s_currentImageIndex);
+            Telemetry::failure();
+            if (++failures >= MAX_IMAGE_SKIPS) {
+                ESP_LOGE(TAG_SLIDE, "%zu images in a row failed, giving up", failures);
+                return;
+            }
+        }
+        s_currentImageIndex = Playlists::step(s_currentImageIndex, 1, count);
+    }
+    if (BadImages::count() >= count) {
+        drawErrorScreen("No image can be shown");
+    }
+}
+
+/**
+ * @brief Show the current image from a prefetch slot, the slide cache or
+ *        the card, as a DISPLAY job
+ * @return false if it failed to load; true once shown or abandoned for
+ *         newer input (s_redrawPending is then set)
+ */
+static bool showCurrentImage()
+{
+    if (s_currentImageIndex >= imageCount()) {
+        return true;
+    }
+
+    RenderJob::Scope job(RenderJob::Priority::DISPLAY);
+    s_redrawPending = false;
+    publishSnapshot();  // Readers see the slide while it loads
+    char path[SDCard::ImageList::MAX_PATH] = "";
+    imagePath(s_currentImageIndex, path, sizeof(path));
+    ESP_LOGI(TAG_SLIDE, "Displaying image %zu/%zu: %s", 
+             s_currentImageIndex + 1, imageCount(), path);
+    showSlideStatus(path);
+    if (FrameCast::leads() && s_state == Slideshow::State::DISPLAYING) {
+        castSlide(s_currentImageIndex);
+    }
+    beginSlideStats(s_currentImageIndex);
+
+    // Prefetched: swap the frame in; the slot keeps the outgoing one, which
+    // is usually the neighbour we want next (the previous image after DOWN)
+    for (PrefetchSlot& slot : s_prefetch) {
+        if (slot.status == PrefetchSlot::Status::READY &&
+            slot.index == s_currentImageIndex &&
+            g_display->swapBuffers(slot.planes[0], slot.planes[1])) {
+            slot.status = (s_framebufferImage != SIZE_MAX) ?
+                PrefetchSlot::Status::READY : PrefetchSlot::Status::EMPTY;
+            slot.index = s_framebufferImage;
+            s_framebufferImage = s_currentImageIndex;
+            g_display->displayAsync();
+            endSlideStats(true);
+            ESP_LOGI(TAG_SLIDE, "Shown from prefetch");
+            return true;
+        }
+    }
+
+    // Shown recently: copy it back instead of reading and decoding it again
+    if (SlideCache::contains(s_currentImageIndex)) {
+        g_display->waitFramebufferFree();
+        SlideCache::fetch(s_currentImageIndex, g_display->getBuffer(0), g_display->getBuffer(1));
+        g_display->markDirty(0, 0, g_display->width(), g_display->height());
+        s_framebufferImage = s_currentImageIndex;
+        g_display->displayAsync();
+        endSlideStats(true);
+        ESP_LOGI(TAG_SLIDE, "Shown from slide cache");
+        return true;
+    }
+
+    s_framebufferImage = SIZE_MAX;
+    if (PROGRESSIVE_DISPLAY_ENABLED && !packOpen() && !FrameCast::leads()) {
+        showPreview(path);
+    }
+    bool loaded = loadImage(s_currentImageIndex, path);
+    endSlideStats(loaded);
+    if (loaded) {
+        s_framebufferImage = s_currentImageIndex;
+        // Only reads the framebuffer, so the upload may be running
+        if (g_display->getBuffer(0)) {
+            SlideCache::store(s_currentImageIndex, g_display->getBuffer(0),
+                              g_display->getBuffer(1));
+        }
+    } else if (RenderJob::cancelled()) {
+        // Abandoned mid-decode: the queued press picks the next target
+        ESP_LOGI(TAG_SLIDE, "Image superseded by newer input");
+        s_redrawPending = true;
+    }
+    return loaded || s_redrawPending;
+}
+
+/**
+ * @brief Put a low-resolution preview of an image up with the fast
+ *        waveform, ahead of its full decode
+ *
+ * Skipped when the slide goes up fast anyway (rapid navigation, a fast
+ * auto-advance waveform) or the ghosting budget is spent. The preview's
+ * upload is waited for; its refresh runs while the full frame decodes,
+ * and that frame's tricolor refresh waits for it.
+ */
+static void showPreview(const char* path)
+{
+    if (s_fastFrameShown || !Panel::active().fastNavigation || inputPending()) {
+        return;
+    }
+    g_display->waitFramebufferFree();
+    if (g_display->fastMode() || g_display->chooseRefresh(true) != EPD_REFRESH_FAST ||
+        !ImageLoader::loadPreview(path, g_display) || RenderJob::cancelled()) {
+        return;
+    }
+    if (g_display->setFastMode(true)) {
+        g_display->displayAsync();
+        g_display->waitFramebufferFree();
+        g_display->setFastMode(false);
+        ESP_LOGI(TAG_SLIDE, "Preview up, decoding the full frame");
+    }
+}
+
+/**
+ * @brief Put the current slide up again when its decode or upload was
+ *        abandoned for an event that didn't replace it (or none is left)
+ *
+ * An abandoned upload leaves the frame in RAM, so only the refresh is redone.
+ */
+static void redrawAbandoned()
+{
+    if (browsing() || inputPending() || g_display->isRefreshing()) {
+        return;
+    }
+    if (!s_redrawPending && g_display->wasCancelled() &&
+        s_framebufferImage == s_currentImageIndex) {
+        ESP_LOGI(TAG_SLIDE, "Upload was abandoned, refreshing again");
+        g_display->displayAsync();
+    } else if (s_redrawPending || g_display->wasCancelled()) {
+        displayCurrentImage();
+    }
+}
+
+/**
+ * @brief Overlay a label (AUTO/MANUAL, FAV +/-) on the current image
+ *
+ * The strip is drawn over a copy of the framebuffer and refreshed once in
+ * the background; the image's planes are put back in RAM as soon as the
+ * upload is done, so the framebuffer still holds the slide and the next
+ * normal refresh clears the label without reading the SD card again.
+ * With the status OLED the slide status goes there instead, and the panel is left alone.
+ */
+static void showIndicator(const char* label)
+{
+    if (StatusDisplay::available()) {
+        char path[SDCard::ImageList::MAX_PATH] = "";
+        imagePath(s_currentImageIndex, path, sizeof(path));
+        showSlideStatus(path);
+        return;
+    }
+
+    g_display->waitFramebufferFree();
+
+    uint32_t sizes[2] = { g_display->getBufferSize(0), g_display->getBufferSize(1) };
+    SlideArena::Scope arena;
+    SlideArena::Ptr<uint8_t[]> saved;
+    if (s_framebufferImage == s_currentImageIndex) {
+        saved = SlideArena::makeArray<uint8_t>(sizes[0] + sizes[1]);
+    }
+    uint8_t* planes[2] = { g_display->getBuffer(0), g_display->getBuffer(1) };
+    if (saved) {
+        for (uint8_t p = 0; p < 2; p++) {
+            if (planes[p]) {
+                memcpy(saved.get() + (p ? sizes[0] : 0), planes[p], sizes[p]);
+            }
+        }
+    }
+
+    g_display->setTextSize(2);
+    g_display->setTextColor(EPD_BLACK);
+    g_display->fillRect(0, 0, 128, 30, EPD_WHITE);
+    g_display->setCursor(10, 10);
+    g_display->print(label);
+    g_display->displayAsync();
+
+    g_display->waitFramebufferFree();
+    if (!saved) {
+        // Nothing to restore from (no memory, or the image wasn't loaded)
+        s_framebufferImage = SIZE_MAX;
+        displayCurrentImage();
+        return;
+    }
+    for (uint8_t p = 0; p < 2; p++) {
+        if (planes[p]) {
+            memcpy(planes[p], saved.get() + (p ? sizes[0] : 0), sizes[p]);
+        }
+    }
+}
+
+/**
+ * @brief Put the current slide's position and the mode on the status OLED
+ * @param path its file, "" if it has none (image pack)
+ */
+static void showSlideStatus(const char* path)
+{
+    StatusDisplay::showSlide(s_currentImageIndex, imageCount(), s_autoAdvance,
+                             path[0] ? path : nullptr);
+}
+
+/**
+ * @brief Allocate the prefetch slots (once; later calls do nothing)
+ */
+static void initPrefetch()
+{
+    static bool attempted = false;
+    if (!PREFETCH_ENABLED || attempted) {
+        return;
+    }
+    attempted = true;
+
+    for (PrefetchSlot& slot : s_prefetch) {
+        for (uint8_t p = 0; p < 2; p++) {
+            uint32_t size = g_display->getBufferSize(p);
+            slot.planes[p] = (size && g_display->getBuffer(p)) ?
+                Adafruit_EPD::allocFramebuffer(size) : nullptr;
+            if (size && g_display->getBuffer(p) && !slot.planes[p]) {
+                ESP_LOGW(TAG_SLIDE, "No memory for prefetch buffers, prefetch disabled");
+                return;
+            }
+        }
+    }
+    s_prefetchReady = true;
+}
+
+/**
+ * @brief Decode one missing slide of the PrefetchPlan, most wanted first
+ *
+ * The first targets go into the prefetch slots. Deeper ones only need to
+ * be in the SlideCache: they are decoded into a slot whose slide is
+ * unwanted or cached, and stored there. A slot holding a slide the plan
+ * no longer wants (the other direction) is the first to be reused.
+ *
+ * @return true if a decode was attempted
+ */
+static bool prefetchStep()
+{
+    static constexpr size_t SLOTS = sizeof(s_prefetch) / sizeof(s_prefetch[0]);
+
+    // Between timed sleeps the neighbours would be decoded for nothing
+    if (s_state != Slideshow::State::DISPLAYING || imageCount() < 2 ||
+        sleepsBetweenSlides() || !Battery::allowsPrefetch()) {
+        return false;
+    }
+    initPrefetch();
+    if (!s_prefetchReady) {
+        return false;
+    }
+
+    size_t count = imageCount();
+    long offsets[std::max<size_t>(PREFETCH_MAX_DEPTH, SLOTS)];
+    size_t planned = PrefetchPlan::plan(offsets, sizeof(offsets) / sizeof(offsets[0]));
+    // Deep targets must stay cached beside the slide on screen and the
+    // slotted ones, or each decode would evict the last
+    size_t cacheRoom = SlideCache::capacity() > SLOTS + 1 ? SlideCache::capacity() - SLOTS - 1 : 0;
+    planned = std::min(planned, SLOTS + cacheRoom);
+    size_t wanted[sizeof(offsets) / sizeof(offsets[0])];
+    for (size_t i = 0; i < planned; i++) {
+        wanted[i] = Playlists::step(s_currentImageIndex, offsets[i], count);
+    }
+    auto rank = [&](size_t index) {
+        for (size_t i = 0; i < planned; i++) {
+            if (wanted[i] == index) {
+                return i;
+            }
+        }
+        return SIZE_MAX;
+    };
+    auto covers = [](const PrefetchSlot& slot, size_t index) {
+        return slot.status != PrefetchSlot::Status::EMPTY && slot.index == index;
+    };
+
+    for (size_t i = 0; i < planned; i++) {
+        size_t index = wanted[i];
+        if (BadImages::contains(index) || index == s_currentImageIndex ||
+            covers(s_prefetch[0], index) || covers(s_prefetch[1], index) ||
+            (i >= SLOTS && SlideCache::contains(index))) {
+            continue;
+        }
+
+        // The slot whose slide is least wanted, as long as losing it loses
+        // nothing: unwanted, a deep target in a slot a top one needs, or cached
+        PrefetchSlot* target = nullptr;
+        size_t targetRank = 0;
+        for (PrefetchSlot& slot : s_prefetch) {
+            size_t held = slot.status == PrefetchSlot::Status::READY ? rank(slot.index) : SIZE_MAX;
+            bool spare = held == SIZE_MAX || (i < SLOTS && held >= SLOTS) ||
+                         (held > i && SlideCache::contains(slot.index));
+            if (spare && (!target || held > targetRank)) {
+                target = &slot;
+                targetRank = held;
+            }
+        }
+        if (!target) {
+            continue;
+        }
+        PrefetchSlot& slot = *target;
+
+        // From the slide cache when it has it; decoded frames go into it
+        RenderJob::Scope job(RenderJob::Priority::PREFETCH);
+        bool ok = SlideCache::fetch(index, slot.planes[0], slot.planes[1]);
+        if (!ok) {
+            char path[SDCard::ImageList::MAX_PATH];
+            int64_t start = esp_timer_get_time();
+            SlideStats::begin(index);
+            ok = imagePath(index, path, sizeof(path)) &&
+                 loadImageIntoPlanes(index, path, slot.planes[0], slot.planes[1]);
+            SlideStats::log(SlideStats::end());
+            if (ok) {
+                PrefetchPlan::loaded(static_cast<uint32_t>(esp_timer_get_time() - start));
+                SlideCache::store(index, slot.planes[0], slot.planes[1]);
+            }
+        }
+        // An abandoned decode is retried later, a broken file is not
+        slot.status = ok ? PrefetchSlot::Status::READY :
+            RenderJob::cancelled() ? PrefetchSlot::Status::EMPTY : PrefetchSlot::Status::FAILED;
+        slot.index = index;
+        if (slot.status == PrefetchSlot::Status::FAILED) {
+            BadImages::mark(index);
+        }
+        ESP_LOGD(TAG_SLIDE, "Prefetched image %zu (%+ld): %s", index + 1, offsets[i],
+                 ok ? "ok" : "failed");
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Check whether background conversion may run now: slides from the
+ *        image directory, the show idle, and external power or a long dwell
+ */
+static bool cacheWarmDue()
+{
+    if (!CACHE_WARM_ENABLED || !CacheWarm::pending() || packOpen() ||
+        s_state != Slideshow::State::DISPLAYING || imageCount() == 0 ||
+        sleepsBetweenSlides() || !Battery::allowsPrefetch() || inputPending()) {
+        return false;
+    }
+    return Battery::externalPower() ||
+           ticksUntilDeadline() >= pdMS_TO_TICKS(CACHE_WARM_MIN_IDLE_SEC * 1000);
+}
+
+static void cacheWarmStep()
+{
+    CacheWarm::step(imageCount(), [](size_t index, char* out, size_t outSize) {
+        return !BadImages::contains(index) && imagePath(index, out, outSize);
+    }, g_display);
+}
+
+static void drawErrorScreen(const char* message)
+{
+    if (StatusDisplay::available()) {
+        StatusDisplay::showError(message);
+        return;
+    }
+    if (!g_display) return;
+
+    g_display->waitFramebufferFree();
+    s_framebufferImage = SIZE_MAX;
+    g_display->clearBuffer();
+    g_display->setTextColor(EPD_BLACK);
+    printCentered("ERROR", 2, 100);
+    printCentered(message, 1, 140);
+    g_display->display();
+}
+
+static void drawLoadingScreen(const char* message)
+{
+    if (!g_display) return;
+
+    g_display->waitFramebufferFree();
+    s_framebufferImage = SIZE_MAX;
+    g_display->clearBuffer();
+    g_display->setTextColor(EPD_BLACK);
+    printCentered(message, 2, 120);
+    // Refresh in the background: init keeps going, and the first image
+    // waits for this refresh on its own
+    g_display->displayAsync();
+}
+
+/**
+ * @brief Print classic-font text word-wrapped to the screen, each line
+ *        centered (at most 8 lines)
+ * @param top y of the first line
+ */
+static void printCentered(const char* text, uint8_t size, int16_t top)
+{
+    static constexpr uint16_t MARGIN = 4;
+    static constexpr size_t MAX_LINES = 8;
+
+    TextLayout::Metrics metrics(nullptr, size, size);
+    TextLayout::Line lines[MAX_LINES];
+    size_t count = TextLayout::wrap(metrics, text, DISPLAY_WIDTH - 2 * MARGIN, lines, MAX_LINES);
+
+    g_display->setTextSize(size);
+    for (size_t i = 0; i < count; i++) {
+        // The advance includes one blank column after the last glyph
+        int16_t width = lines[i].width > size ? lines[i].width - size : 0;
+        g_display->setCursor((DISPLAY_WIDTH - width) / 2, top + i * metrics.lineHeight());
+        g_display->write(reinterpret_cast<const uint8_t*>(text + lines[i].start), lines[i].length);
+    }
+}
+
+/**
+ * @brief Build the image list: the pack's table, the sorted list, or a
+ *        cursor for a directory too large to list
+ * @return Number of images
+ */
+static size_t scanImages()
+{
+    SlideStats::Timer timer(SlideStats::Stage::SCAN);
+    size_t found = 0;
+    if (openImagePack()) {
+        found = imageCount();
+    } else if (!LAZY_IMAGE_LIST) {
+        found = SDCard::scanForImages(IMAGE_DIRECTORY, s_imageFiles,
+                                      IMAGE_SCAN_PROBE ? ImageLoader::probe : nullptr);
+    }
+    if (!packOpen() && (LAZY_IMAGE_LIST || found >= MAX_IMAGE_FILES)) {
+        // The sorted list is capped; a full directory is browsed in place
+        if (s_imageCursor.open(IMAGE_DIRECTORY) && s_imageCursor.size() > found) {
+            s_imageFiles.reset(IMAGE_DIRECTORY);
+            found = s_imageCursor.size();
+        } else {
+            s_imageCursor.close();
+        }
+    }
+    BootProfile::mark(BootProfile::Mark::LIST_READY);
+    return found;
+}
+
+/**
+ * @brief Mount the SD card, then build the image list once BOOT_SD_SCAN is set
+ */
+static void bootSdWork()
+{
+    {
+        SlideStats::Timer timer(SlideStats::Stage::MOUNT);
+        s_bootSd.mounted = SDCard::init();
+    }
+    xEventGroupSetBits(s_bootSd.events, BOOT_SD_MOUNTED);
+    if (s_bootSd.mounted) {
+        xEventGroupWaitBits(s_bootSd.events, BOOT_SD_SCAN, pdFALSE, pdFALSE, portMAX_DELAY);
+        s_bootSd.found = scanImages();
+        releaseCard();
+    }
+    xEventGroupSetBits(s_bootSd.events, BOOT_SD_SCANNED);
+}
+
+/**
+ * @brief Unmount (and power off) the card once the slides come from flash
+ *        (FLASH_PACK_RELEASE_SD); SDCard::init() brings it back for a sync
+ */
+static void releaseCard()
+{
+    if (FLASH_PACK_RELEASE_SD && FlashPack::isOpen()) {
+        SDCard::deinit();
+    }
+}
+
+static void bootSdTask(void* arg)
+{
+    (void)arg;
+    bootSdWork();
+    vTaskDelete(nullptr);
+}
+
+/**
+ * @brief Start mounting the SD card and scanning on the boot task
+ * @param scanNow Scan right after the mount; otherwise the scan waits for
+ *                init() to set BOOT_SD_SCAN
+ * @param mount false leaves the card alone: every step reports done at
+ *              once, with no card mounted
+ * @return false without the event group; without the task both run here,
+ *         before init() goes on
+ */
+static bool startBootSd(bool scanNow, bool mount)
+{
+    s_bootSd.events = xEventGroupCreate();
+    if (!s_bootSd.events) {
+        return false;
+    }
+    if (!mount) {
+        xEventGroupSetBits(s_bootSd.events, BOOT_SD_MOUNTED | BOOT_SD_SCAN | BOOT_SD_SCANNED);
+        return true;
+    }
+    if (scanNow) {
+        xEventGroupSetBits(s_bootSd.events, BOOT_SD_SCAN);
+    }
+    if (xTaskCreate(bootSdTask, "boot_sd", BOOT_SD_TASK_STACK, nullptr,
+                    SLIDESHOW_TASK_PRIORITY, nullptr) != pdPASS) {
+        ESP_LOGW(TAG_SLIDE, "No boot task, mounting the SD card inline");
+        xEventGroupSetBits(s_bootSd.events, BOOT_SD_SCAN);
+        bootSdWork();
+    }
+    return true;
+}
+
+static void bootStatusTimeout(void* arg)
+{
+    xSemaphoreTake(s_bootStatusLock, portMAX_DELAY);
+    if (s_bootStatus) {
+        ESP_LOGI(TAG_SLIDE, "Boot is slow, showing status: %s", s_bootStatus);
+        drawLoadingScreen(s_bootStatus);
+    }
+    xSemaphoreGive(s_bootStatusLock);
+}
+
+/**
+ * @brief Arm the boot status screen for the first step
+ *
+ * Without the lock or timer (out of memory), boot simply shows no status.
+ * The status OLED shows every step at once instead; it costs the panel
+ * nothing.
+ */
+static void beginBootStatus(const char* message)
+{
+    if (StatusDisplay::available()) {
+        StatusDisplay::showMessage(message);
+        return;
+    }
+    s_bootStatusLock = xSemaphoreCreateMutex();
+    esp_timer_create_args_t args = {};
+    args.callback = bootStatusTimeout;
+    args.name = "boot_status";
+    if (!s_bootStatusLock || esp_timer_create(&args, &s_bootStatusTimer) != ESP_OK) {
+        return;
+    }
+    s_bootStatus = message;
+    esp_timer_start_once(s_bootStatusTimer, BOOT_STATUS_DELAY_MS * 1000ULL);
+}
+
+/**
+ * @brief Name the step boot is in now, in case the status screen comes due
+ */
+static void setBootStatus(const char* message)
+{
+    if (StatusDisplay::available()) {
+        StatusDisplay::showMessage(message);
+        return;
+    }
+    if (!s_bootStatusTimer) return;
+
+    xSemaphoreTake(s_bootStatusLock, portMAX_DELAY);
+    s_bootStatus = message;
+    xSemaphoreGive(s_bootStatusLock);
+}
+
+/**
+ * @brief Cancel the status screen before init draws to the display itself
+ *
+ * A status screen already drawn keeps refreshing; the next display write
+ * waits for its framebuffer upload as usual.
+ */
+static void endBootStatus()
+{
+    if (!s_bootStatusTimer) return;
+
+    xSemaphoreTake(s_bootStatusLock, portMAX_DELAY);
+    s_bootStatus = nullptr;
+    s_framebufferImage = SIZE_MAX;
+    xSemaphoreGive(s_bootStatusLock);
+    esp_timer_stop(s_bootStatusTimer);
 }
 
@@ -8,6 +8,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "slide_stats.hpp"
 #include <vector>
 #include <string>
 
@@ -28,6 +29,15 @@ enum class State {
     SLEEPING        // Deep sleep (inactivity)
 };
 
+/**
+ * @brief Act on a deep-sleep wake before anything else is initialized
+ *
+ * Call first in app_main. A button wake that no button pin accounts for
+ * goes straight back to sleep (re-arming the next-slide timer of a timed
+ * auto-advance sleep); otherwise this returns and init() resumes the show.
+ */
+void handleWake();
+
 /**
  * @brief Initialize slideshow system
  * @return true if successful
@@ -40,6 +50,27 @@ bool init();
  */
 void task(void* arg);
 
+/**
+ * @brief The slideshow's state as one consistent copy, for other tasks
+ */
+struct Snapshot {
+    State state;
+    size_t currentIndex;  // 0-based
+    size_t imageCount;
+    bool autoAdvance;
+};
+
+/**
+ * @brief Read the latest snapshot; safe from any task
+ *
+ * The slideshow task publishes it under a sequence counter (a seqlock):
+ * it never waits for readers, and a reader that catches it mid-update
+ * reads again.
+ *
+ * @param out Receives the snapshot
+ */
+void getSnapshot(Snapshot& out);
+
 /**
  * @brief Get current state
  * @return Current slideshow state
@@ -58,5 +89,44 @@ size_t getCurrentImageIndex();
  */
 size_t getImageCount();
 
+/**
+ * @brief Pipeline stage times (min/avg/max) and SPI traffic over the last
+ *        SLIDE_STATS_HISTORY slides
+ * @param out Receives the statistics
+ */
+void getStats(SlideStats::Summary& out);
+
+/**
+ * @brief Commands the slideshow task runs for other tasks (the console,
+ *        FramePush)
+ */
+enum class Command : uint8_t {
+    GOTO,             // Show slide arg (0-based)
+    REFRESH_FULL,     // Refresh the current slide with the tricolor waveform
+    REFRESH_PARTIAL,  // Refresh the current slide as a full-screen partial window
+    REFRESH_FAST,     // Refresh the current slide with the fast waveform once
+    BENCH,            // Run Bench::Suite arg, then redraw the current slide
+    SYNC,             // Run a Wi-Fi sync now (WIFI_SYNC_ENABLED)
+    PUSH,             // Show the frame FramePush received (FRAME_PUSH_ENABLED)
+    UPLOAD,           // Receive the image pack BleUpload has a channel open for
+    CAST,             // Show the slide the FrameCast leader cast (followers)
+    GRID,             // Open the contact sheet at the current slide, or close it
+    SHUFFLE,          // Play order: arg 0 list order, 1 shuffled, 2 a new shuffle
+    FAVORITE,         // Add the current slide to the favorites, or take it out
+    WIDGETS,          // Redraw the dashboard widgets whose value changed
+    USB               // Lend the SD card to a USB host until it ejects it (UsbStorage)
+};
+
+/**
+ * @brief Queue a command for the slideshow task, behind any button events
+ *
+ * Counts as user activity. Ignored unless a slide is displayed.
+ *
+ * @param command Command
+ * @param arg Its argument (GOTO, BENCH, SHUFFLE), 0 otherwise
+ * @return false if the queue is full or not created yet
+ */
+bool post(Command command, uint32_t arg = 0);
+
 } // namespace Slideshow
 
@@ -0,0 +1,72 @@
+/**
+ * @file spi_record.cpp
+ * @brief Panel SPI recorder setup and export
+ */
+
+#include "spi_record.hpp"
+#include "config.hpp"
+#include "esp_log.h"
+#include "../components/Adafruit_EPD/src/Adafruit_EPD.h"
+#include "../components/Adafruit_EPD/src/EPDRecorder.h"
+#include <new>
+
+static const char* TAG_REC = "SpiRecord";
+
+static EPDRecorder* s_recorder = nullptr;
+
+bool SpiRecord::init(Adafruit_EPD& display)
+{
+    if (!SPI_RECORD_ENABLED || s_recorder) {
+        return s_recorder != nullptr;
+    }
+    EPDRecorder* recorder = new (std::nothrow) EPDRecorder();
+    if (!recorder || !recorder->begin(SPI_RECORD_BYTES)) {
+        ESP_LOGW(TAG_REC, "No memory for a %zu-byte SPI recording", SPI_RECORD_BYTES);
+        delete recorder;
+        return false;
+    }
+    s_recorder = recorder;
+    display.setRecorder(s_recorder);
+    return true;
+}
+
+bool SpiRecord::start()
+{
+    if (!s_recorder) {
+        return false;
+    }
+    s_recorder->start();
+    ESP_LOGI(TAG_REC, "Recording panel SPI traffic");
+    return true;
+}
+
+void SpiRecord::stop()
+{
+    if (s_recorder) {
+        s_recorder->stop();
+    }
+}
+
+bool SpiRecord::recording()
+{
+    return s_recorder && s_recorder->recording();
+}
+
+size_t SpiRecord::size()
+{
+    size_t len = 0;
+    if (s_recorder) {
+        s_recorder->log(&len);
+    }
+    return len;
+}
+
+size_t SpiRecord::write(FILE* file)
+{
+    if (!s_recorder) {
+        return 0;
+    }
+    size_t len = 0;
+    const uint8_t* log = s_recorder->log(&len);
+    return fwrite(log, 1, len, file);
+}
@@ -0,0 +1,58 @@
+/**
+ * @file spi_record.hpp
+ * @brief Recording of the panel's SPI traffic for replay on a host
+ *
+ * Wraps an EPDRecorder attached to the e-paper display: between start()
+ * and stop() every transaction the panel's SPI device issues (DC level,
+ * clock, bytes, times) and every BUSY wait goes into a RAM buffer of
+ * SPI_RECORD_BYTES, until it is full. write() saves the log for
+ * tools/spi_replay.py, which works out bus occupancy, transaction counts
+ * and idle gaps, so driver and transport changes can be compared without a
+ * logic analyser. Safe from any task; a no-op until init() with
+ * SPI_RECORD_ENABLED.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+
+class Adafruit_EPD;
+
+namespace SpiRecord {
+
+/**
+ * @brief Allocate the buffer and attach the recorder to the display; call
+ *        once, before the display is used
+ * @return true if recording is enabled and the buffer was allocated
+ */
+bool init(Adafruit_EPD& display);
+
+/**
+ * @brief Drop the last recording and record from now on
+ * @return false without init()
+ */
+bool start();
+
+/**
+ * @brief Stop recording; the log is kept until the next start()
+ */
+void stop();
+
+/**
+ * @brief Whether transactions are being recorded
+ */
+bool recording();
+
+/**
+ * @brief Log size so far, header included; 0 without init()
+ */
+size_t size();
+
+/**
+ * @brief Write the log as it stands
+ * @return Bytes written
+ */
+size_t write(FILE* file);
+
+} // namespace SpiRecord
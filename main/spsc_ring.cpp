@@ -0,0 +1,80 @@
+/**
+ * @file spsc_ring.cpp
+ * @brief SPSC slot ring implementation
+ */
+
+#include "spsc_ring.hpp"
+
+bool SpscRing::attach(uint8_t* storage, size_t slotSize, size_t slotCount)
+{
+    if (!storage || slotCount == 0 || slotCount > MAX_SLOTS) {
+        return false;
+    }
+    storage_ = storage;
+    slotSize_ = slotSize;
+    slotCount_ = static_cast<uint32_t>(slotCount);
+    head_.store(0);
+    tail_.store(0);
+    producerWaiting_.store(nullptr);
+    consumerWaiting_.store(nullptr);
+    return true;
+}
+
+template <typename Ready>
+bool SpscRing::waitFor(Ready ready, std::atomic<TaskHandle_t>& waiter, TickType_t wait)
+{
+    while (!ready()) {
+        // Register, then check again: the other side either sees the
+        // registration or made ready() true before it looked
+        waiter.store(xTaskGetCurrentTaskHandle());
+        bool woken = ready() || ulTaskNotifyTake(pdTRUE, wait) != 0;
+        waiter.store(nullptr);
+        if (!woken && !ready()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SpscRing::wake(std::atomic<TaskHandle_t>& waiter)
+{
+    TaskHandle_t task = waiter.load();
+    if (task) {
+        xTaskNotifyGive(task);
+    }
+}
+
+uint8_t* SpscRing::acquire(TickType_t wait)
+{
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    auto notFull = [this, head]() { return head - tail_.load() < slotCount_; };
+    if (!waitFor(notFull, producerWaiting_, wait)) {
+        return nullptr;
+    }
+    return storage_ + (head % slotCount_) * slotSize_;
+}
+
+void SpscRing::commit(size_t len)
+{
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    lengths_[head % slotCount_] = static_cast<uint32_t>(len);
+    head_.store(head + 1);
+    wake(consumerWaiting_);
+}
+
+const uint8_t* SpscRing::peek(size_t& len, TickType_t wait)
+{
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    auto notEmpty = [this, tail]() { return head_.load() != tail; };
+    if (!waitFor(notEmpty, consumerWaiting_, wait)) {
+        return nullptr;
+    }
+    len = lengths_[tail % slotCount_];
+    return storage_ + (tail % slotCount_) * slotSize_;
+}
+
+void SpscRing::release()
+{
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1);
+    wake(producerWaiting_);
+}
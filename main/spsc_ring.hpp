@@ -0,0 +1,109 @@
+/**
+ * @file spsc_ring.hpp
+ * @brief Single-producer / single-consumer ring of fixed-size buffer slots
+ *
+ * The channel between two pipeline stages (ReadAhead's reader task and the
+ * decoder). Slots are filled and read in place: the producer acquire()s a
+ * slot, writes into it and commit()s it with a length; the consumer peek()s
+ * the oldest committed slot and release()s it when done. No copies and no
+ * locks: each side only writes its own index, and the two indices sit on
+ * separate cache lines. A side that has to wait blocks on its task
+ * notification (index 0) and is woken by the other side; spurious wakeups
+ * are harmless, so the tasks may use notifications for other things too.
+ *
+ * Exactly one task may produce and one consume at a time.
+ */
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+class SpscRing {
+public:
+    // Most slots one ring can have
+    static constexpr size_t MAX_SLOTS = 16;
+
+    SpscRing() = default;
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /**
+     * @brief Use caller memory for the slots and empty the ring
+     *
+     * Only while neither side is using the ring.
+     *
+     * @param storage slotCount * slotSize bytes, outliving the use of the ring
+     * @param slotSize Bytes per slot
+     * @param slotCount Number of slots, 1..MAX_SLOTS
+     * @return false if slotCount is out of range
+     */
+    bool attach(uint8_t* storage, size_t slotSize, size_t slotCount);
+
+    /** @brief Bytes per slot */
+    size_t slotSize() const
+    {
+        return slotSize_;
+    }
+
+    // ---- Producer ----
+
+    /**
+     * @brief Get the next free slot to fill
+     * @param wait Ticks to wait for the consumer to release one
+     * @return The slot (slotSize() bytes), or nullptr on timeout
+     */
+    uint8_t* acquire(TickType_t wait = portMAX_DELAY);
+
+    /**
+     * @brief Publish the acquired slot
+     * @param len Bytes of it in use
+     */
+    void commit(size_t len);
+
+    // ---- Consumer ----
+
+    /**
+     * @brief Get the oldest committed slot, leaving it in the ring
+     * @param len Receives the length it was committed with
+     * @param wait Ticks to wait for the producer to commit one
+     * @return The slot, or nullptr on timeout
+     */
+    const uint8_t* peek(size_t& len, TickType_t wait = portMAX_DELAY);
+
+    /**
+     * @brief Hand the peeked slot back to the producer
+     */
+    void release();
+
+private:
+    // The largest data cache line among the targets (ESP32-S3 PSRAM cache)
+    static constexpr size_t CACHE_LINE = 64;
+
+    /**
+     * @brief Block until ready() holds, registering in waiter for the wakeup
+     * @return false on timeout
+     */
+    template <typename Ready>
+    static bool waitFor(Ready ready, std::atomic<TaskHandle_t>& waiter, TickType_t wait);
+
+    static void wake(std::atomic<TaskHandle_t>& waiter);
+
+    // Written by the producer: slots committed, ever
+    alignas(CACHE_LINE) std::atomic<uint32_t> head_{0};
+    std::atomic<TaskHandle_t> producerWaiting_{nullptr};
+
+    // Written by the consumer: slots released, ever
+    alignas(CACHE_LINE) std::atomic<uint32_t> tail_{0};
+    std::atomic<TaskHandle_t> consumerWaiting_{nullptr};
+
+    // Set by attach()
+    alignas(CACHE_LINE) uint8_t* storage_ = nullptr;
+    size_t slotSize_ = 0;
+    uint32_t slotCount_ = 0;
+    uint32_t lengths_[MAX_SLOTS] = {};  // Written by the producer before head_
+};
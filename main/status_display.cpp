@@ -0,0 +1,110 @@
+/**
+ * @file status_display.cpp
+ * @brief Status on the SH1106 OLED
+ */
+
+#include "status_display.hpp"
+#include "config.hpp"
+#include "esp_log.h"
+#include "../components/Adafruit_SH1106_ESPIDF/Adafruit_SH1106.h"
+#include <cstdio>
+#include <cstring>
+
+static const char* TAG_STATUS = "StatusDisplay";
+
+static constexpr int16_t OLED_WIDTH = 128;
+static constexpr int16_t OLED_HEIGHT = 64;
+static constexpr int16_t BAR_HEIGHT = 4;
+// Classic font at size 1: 6 x 8 pixels a character
+static constexpr size_t CHARS_PER_LINE = OLED_WIDTH / 6;
+
+static Adafruit_SH1106* s_oled = nullptr;
+
+bool StatusDisplay::init()
+{
+    if (!STATUS_OLED_ENABLED || s_oled) {
+        return s_oled != nullptr;
+    }
+    Adafruit_I2CDevice::setDefaultPins(OLED_SDA_PIN, OLED_SCL_PIN);
+    Adafruit_I2CDevice::setDefaultFrequency(OLED_I2C_FREQ_HZ);
+
+    // Built on first use only, so a build without the OLED never touches I2C
+    static Adafruit_SH1106 oled(OLED_WIDTH, OLED_HEIGHT, &Wire, OLED_RESET_PIN, OLED_I2C_ADDRESS);
+    if (!oled.begin(OLED_I2C_ADDRESS)) {
+        ESP_LOGW(TAG_STATUS, "No OLED at 0x%02X, status goes to the e-ink panel", OLED_I2C_ADDRESS);
+        return false;
+    }
+    uint32_t clock = oled.negotiateClock(OLED_I2C_FREQ_STEPS_HZ, NUM_OLED_I2C_FREQ_STEPS);
+    oled.setAsync(OLED_ASYNC_UPDATES);
+    oled.setTextColor(1);
+    oled.setTextWrap(false);
+    s_oled = &oled;
+    ESP_LOGI(TAG_STATUS, "Status OLED ready at %lu Hz", (unsigned long)(clock ? clock : OLED_I2C_FREQ_HZ));
+    return true;
+}
+
+bool StatusDisplay::available()
+{
+    return s_oled != nullptr;
+}
+
+/**
+ * @brief Print one line of classic-font text, cut to the screen width
+ */
+static void printLine(const char* text, uint8_t size, int16_t y)
+{
+    size_t fits = CHARS_PER_LINE / size;
+    size_t length = strnlen(text, fits);
+    s_oled->setTextSize(size);
+    s_oled->setCursor(0, y);
+    s_oled->write(reinterpret_cast<const uint8_t*>(text), length);
+}
+
+void StatusDisplay::showMessage(const char* message)
+{
+    if (!s_oled) return;
+
+    s_oled->clearDisplay();
+    printLine(message, 1, 28);
+    s_oled->display();
+}
+
+void StatusDisplay::showError(const char* message)
+{
+    if (!s_oled) return;
+
+    s_oled->clearDisplay();
+    printLine("ERROR", 2, 8);
+    printLine(message, 1, 36);
+    s_oled->display();
+}
+
+void StatusDisplay::showSlide(size_t index, size_t total, bool autoAdvance, const char* name)
+{
+    if (!s_oled) return;
+
+    char position[24];
+    snprintf(position, sizeof(position), "%zu / %zu", index + 1, total);
+
+    s_oled->clearDisplay();
+    printLine(autoAdvance ? "AUTO" : "MANUAL", 2, 0);
+    printLine(position, 2, 20);
+    if (name) {
+        // Only the file name fits, not the directory
+        const char* base = strrchr(name, '/');
+        printLine(base ? base + 1 : name, 1, 44);
+    }
+    if (total > 0) {
+        int16_t filled = static_cast<int16_t>((index + 1) * OLED_WIDTH / total);
+        s_oled->drawRect(0, OLED_HEIGHT - BAR_HEIGHT, OLED_WIDTH, BAR_HEIGHT, 1);
+        s_oled->fillRect(0, OLED_HEIGHT - BAR_HEIGHT, filled, BAR_HEIGHT, 1);
+    }
+    s_oled->display();
+}
+
+void StatusDisplay::sleep()
+{
+    if (!s_oled) return;
+
+    s_oled->setPower(false);
+}
@@ -0,0 +1,49 @@
+/**
+ * @file status_display.hpp
+ * @brief Optional SH1106 OLED for status, so the e-ink panel only refreshes
+ *        for slides
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace StatusDisplay {
+
+/**
+ * @brief Bring up the OLED on its I2C pins (STATUS_OLED_ENABLED)
+ * @return false if it is disabled or doesn't answer; every other call then
+ *         does nothing
+ */
+bool init();
+
+/**
+ * @brief Whether init() found the OLED, i.e. status goes there instead of
+ *        the e-ink panel
+ */
+bool available();
+
+/**
+ * @brief Show a boot or sync step ("Scanning images...")
+ */
+void showMessage(const char* message);
+
+/**
+ * @brief Show an error the slideshow can't get past
+ */
+void showError(const char* message);
+
+/**
+ * @brief Show the slide being displayed: the AUTO/MANUAL mode, index/total,
+ *        its file name (nullptr for none) and a position bar
+ * @param index 0-based
+ */
+void showSlide(size_t index, size_t total, bool autoAdvance, const char* name);
+
+/**
+ * @brief Switch the panel off before deep sleep; init() on wake switches it
+ *        on again
+ */
+void sleep();
+
+}  // namespace StatusDisplay
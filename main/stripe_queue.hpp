@@ -0,0 +1,79 @@
+/**
+ * @file stripe_queue.hpp
+ * @brief Work-stealing queue of stripe indices for two workers
+ *
+ * The stripes of one job, [0, count), are split into one range per worker.
+ * A worker takes stripes from the front of its own range and, once that is
+ * empty, steals from the back of the other's, so a worker held up (by a
+ * higher-priority task on its core) leaves its stripes to the one that
+ * isn't instead of making it wait. Each range is one atomic word, begin in
+ * the low half and end in the high half, changed only by compare-and-swap:
+ * no locks, and any number of calls from both workers at once are safe.
+ *
+ * reset() only while no worker is taking stripes.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+class StripeQueue {
+public:
+    static constexpr size_t WORKERS = 2;
+
+    StripeQueue() = default;
+
+    StripeQueue(const StripeQueue&) = delete;
+    StripeQueue& operator=(const StripeQueue&) = delete;
+
+    /**
+     * @brief Start a job of count stripes; worker 0 owns the first half
+     */
+    void reset(uint16_t count)
+    {
+        uint16_t half = count / 2;
+        ranges_[0].store(pack(0, half), std::memory_order_relaxed);
+        ranges_[1].store(pack(half, count), std::memory_order_release);
+    }
+
+    /**
+     * @brief Take the next stripe
+     * @param worker 0 or 1
+     * @param index Receives the stripe
+     * @return false once every stripe has been taken
+     */
+    bool next(size_t worker, uint16_t& index)
+    {
+        return take(ranges_[worker], true, index) ||
+               take(ranges_[(worker + 1) % WORKERS], false, index);
+    }
+
+private:
+    static uint32_t pack(uint16_t begin, uint16_t end)
+    {
+        return begin | static_cast<uint32_t>(end) << 16;
+    }
+
+    // The front of a range for its owner, the back for a thief
+    static bool take(std::atomic<uint32_t>& range, bool front, uint16_t& index)
+    {
+        uint32_t value = range.load(std::memory_order_acquire);
+        for (;;) {
+            uint16_t begin = value & 0xFFFF;
+            uint16_t end = value >> 16;
+            if (begin >= end) {
+                return false;
+            }
+            uint32_t taken = front ? pack(begin + 1, end) : pack(begin, end - 1);
+            if (range.compare_exchange_weak(value, taken, std::memory_order_acq_rel,
+                                            std::memory_order_acquire)) {
+                index = front ? begin : end - 1;
+                return true;
+            }
+        }
+    }
+
+    std::atomic<uint32_t> ranges_[WORKERS] = {};
+};
@@ -0,0 +1,398 @@
+/**
+ * @file telemetry.cpp
+ * @brief Fleet performance telemetry implementation
+ */
+
+#include "telemetry.hpp"
+#include "config.hpp"
+#include "panel.hpp"
+#include "slide_stats.hpp"
+#include "boot_profile.hpp"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_mac.h"
+#include "esp_app_desc.h"
+#include "mqtt_client.h"
+#include "sdkconfig.h"
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+#include "esp_crt_bundle.h"
+#endif
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <new>
+
+static const char* TAG_TELEMETRY = "Telemetry";
+
+static constexpr uint32_t HISTOGRAM_MAGIC = 0x4D4C4554;  // "TELM" little-endian
+static constexpr uint8_t HISTOGRAM_VERSION = 1;
+static constexpr size_t BUCKETS = 16;  // The last one holds 2^14 (16 s, 16 mAh) and up
+static constexpr size_t STAGE_COUNT = static_cast<size_t>(SlideStats::Stage::COUNT);
+static constexpr size_t MODES = EPD_REFRESH_PARTIAL + 1;
+static constexpr const char* MODE_NAMES[MODES] = { "full", "fast", "partial" };
+static constexpr const char* NVS_KEY = "hist";
+
+static constexpr EventBits_t MQTT_CONNECTED = BIT0;
+static constexpr EventBits_t MQTT_PUBLISHED = BIT1;
+static constexpr EventBits_t MQTT_FAILED = BIT2;
+
+namespace {
+
+/**
+ * @brief Everything published, kept in RTC memory and saved to NVS as is
+ */
+struct Histograms {
+    uint32_t magic;    // HISTOGRAM_MAGIC once set up
+    uint8_t version;   // HISTOGRAM_VERSION
+    uint8_t reserved[3];
+    uint32_t slides;            // Records added
+    uint32_t failures;          // Images that failed to load
+    uint32_t savedSlides;       // slides when last saved to NVS
+    uint32_t sinceUnix;         // Wall clock of the first sample, 0 if unset then
+    uint64_t chargeUAs;         // All power windows, boot included
+    uint32_t refreshes[MODES];  // By epd_refresh_t
+    uint16_t stageMs[STAGE_COUNT][BUCKETS];
+    uint16_t bootMs[2][BUCKETS];  // Cold boot, wake
+    uint16_t slideUAh[BUCKETS];   // Charge per slide window
+};
+
+} // namespace
+
+static RTC_DATA_ATTR Histograms s_hist;
+static EventGroupHandle_t s_mqttEvents = nullptr;
+static int s_publishId = -1;
+
+/**
+ * @brief Log2 bucket of a value, see telemetry.hpp
+ */
+static size_t bucketOf(uint32_t value)
+{
+    size_t bucket = 0;
+    while (value && bucket < BUCKETS - 1) {
+        value >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static void count(uint16_t (&histogram)[BUCKETS], uint32_t value)
+{
+    uint16_t& bucket = histogram[bucketOf(value)];
+    if (bucket < UINT16_MAX) {
+        bucket++;
+    }
+}
+
+/**
+ * @brief Start empty histograms
+ */
+static void reset()
+{
+    memset(&s_hist, 0, sizeof(s_hist));
+    s_hist.magic = HISTOGRAM_MAGIC;
+    s_hist.version = HISTOGRAM_VERSION;
+}
+
+/**
+ * @brief Note when the first sample arrives, once the clock is set
+ */
+static void stamp()
+{
+    if (s_hist.sinceUnix == 0) {
+        time_t now = time(nullptr);
+        s_hist.sinceUnix = now > 1600000000 ? static_cast<uint32_t>(now) : 0;
+    }
+}
+
+static void save()
+{
+    nvs_handle_t handle;
+    if (nvs_open(TELEMETRY_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        return;
+    }
+    s_hist.savedSlides = s_hist.slides;
+    if (nvs_set_blob(handle, NVS_KEY, &s_hist, sizeof(s_hist)) != ESP_OK ||
+        nvs_commit(handle) != ESP_OK) {
+        ESP_LOGW(TAG_TELEMETRY, "Failed to save the histograms");
+    }
+    nvs_close(handle);
+}
+
+void Telemetry::init()
+{
+    if (!TELEMETRY_ENABLED || (s_hist.magic == HISTOGRAM_MAGIC &&
+                               s_hist.version == HISTOGRAM_VERSION)) {
+        return;
+    }
+    reset();
+    nvs_handle_t handle;
+    if (nvs_open(TELEMETRY_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return;
+    }
+    Histograms saved;
+    size_t size = sizeof(saved);
+    if (nvs_get_blob(handle, NVS_KEY, &saved, &size) == ESP_OK && size == sizeof(saved) &&
+        saved.magic == HISTOGRAM_MAGIC && saved.version == HISTOGRAM_VERSION) {
+        s_hist = saved;
+        ESP_LOGI(TAG_TELEMETRY, "%" PRIu32 " slides from NVS", s_hist.slides);
+    }
+    nvs_close(handle);
+}
+
+void Telemetry::slide(uint32_t statsId)
+{
+    SlideStats::RecordView record;
+    if (!TELEMETRY_ENABLED || !SlideStats::get(statsId, record)) {
+        return;
+    }
+    stamp();
+    for (size_t i = 0; i < STAGE_COUNT; i++) {
+        if (record.mask & (1u << i)) {
+            count(s_hist.stageMs[i], (record.us[i] + 500) / 1000);
+        }
+    }
+    s_hist.slides++;
+}
+
+void Telemetry::power(bool isSlide, const PowerStats::Usage& usage)
+{
+    if (!TELEMETRY_ENABLED) {
+        return;
+    }
+    s_hist.chargeUAs += usage.chargeUAs;
+    if (isSlide) {
+        count(s_hist.slideUAh, static_cast<uint32_t>(std::min<uint64_t>(usage.chargeUAs / 3600,
+                                                                        UINT32_MAX)));
+    }
+}
+
+void Telemetry::refresh(epd_refresh_t mode)
+{
+    if (TELEMETRY_ENABLED && static_cast<size_t>(mode) < MODES) {
+        s_hist.refreshes[mode]++;
+    }
+}
+
+void Telemetry::failure()
+{
+    if (TELEMETRY_ENABLED) {
+        s_hist.failures++;
+    }
+}
+
+void Telemetry::boot()
+{
+    BootProfile::Result result;
+    BootProfile::current(result);
+    int64_t glassUs = result.us[static_cast<size_t>(BootProfile::Mark::GLASS)];
+    if (!TELEMETRY_ENABLED || glassUs < 0) {
+        return;
+    }
+    glassUs += std::max<int64_t>(result.preAppUs, 0);
+    count(s_hist.bootMs[result.wake ? 1 : 0], static_cast<uint32_t>(glassUs / 1000));
+}
+
+bool Telemetry::pending()
+{
+    return TELEMETRY_ENABLED && s_hist.magic == HISTOGRAM_MAGIC &&
+           (s_hist.slides || s_hist.failures);
+}
+
+void Telemetry::sleep()
+{
+    if (TELEMETRY_ENABLED && s_hist.slides - s_hist.savedSlides >= TELEMETRY_NVS_SAVE_SLIDES) {
+        save();
+    }
+}
+
+namespace {
+
+/**
+ * @brief printf into a fixed buffer; sticks at full
+ */
+class Writer {
+public:
+    Writer(char* buffer, size_t size) : buffer_(buffer), size_(size), length_(0) {}
+
+    void printf(const char* format, ...) __attribute__((format(printf, 2, 3)))
+    {
+        if (length_ >= size_) {
+            return;
+        }
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(buffer_ + length_, size_ - length_, format, args);
+        va_end(args);
+        length_ = n < 0 ? size_ : std::min(size_, length_ + static_cast<size_t>(n));
+    }
+
+    /**
+     * @brief A histogram as a JSON array, trailing empty buckets left out
+     */
+    void histogram(const uint16_t (&buckets)[BUCKETS])
+    {
+        size_t used = BUCKETS;
+        while (used && buckets[used - 1] == 0) {
+            used--;
+        }
+        printf("[");
+        for (size_t i = 0; i < used; i++) {
+            printf("%s%u", i ? "," : "", buckets[i]);
+        }
+        printf("]");
+    }
+
+    bool overflowed() const { return length_ >= size_; }
+    size_t length() const { return length_; }
+
+private:
+    char* buffer_;
+    size_t size_;
+    size_t length_;
+};
+
+} // namespace
+
+/**
+ * @brief The histograms as one JSON object
+ * @return Its length, 0 if it didn't fit
+ */
+static size_t formatMessage(char* buffer, size_t size, const char* device)
+{
+    const esp_app_desc_t* app = esp_app_get_description();
+    Writer out(buffer, size);
+    out.printf("{\"device\":\"%s\",\"build\":\"%s\",\"panel\":\"%s\",\"since\":%" PRIu32
+               ",\"slides\":%" PRIu32 ",\"failures\":%" PRIu32 ",\"charge_uah\":%" PRIu64,
+               device, app->version, Panel::active().name, s_hist.sinceUnix, s_hist.slides,
+               s_hist.failures, s_hist.chargeUAs / 3600);
+    out.printf(",\"refreshes\":{");
+    for (size_t m = 0; m < MODES; m++) {
+        out.printf("%s\"%s\":%" PRIu32, m ? "," : "", MODE_NAMES[m], s_hist.refreshes[m]);
+    }
+    out.printf("},\"stage_ms\":{");
+    bool first = true;
+    for (size_t i = 0; i < STAGE_COUNT; i++) {
+        bool empty = std::all_of(std::begin(s_hist.stageMs[i]), std::end(s_hist.stageMs[i]),
+                                 [](uint16_t n) { return n == 0; });
+        if (!empty) {
+            out.printf("%s\"%s\":", first ? "" : ",",
+                       SlideStats::stageName(static_cast<SlideStats::Stage>(i)));
+            out.histogram(s_hist.stageMs[i]);
+            first = false;
+        }
+    }
+    out.printf("},\"boot_ms\":{\"cold\":");
+    out.histogram(s_hist.bootMs[0]);
+    out.printf(",\"wake\":");
+    out.histogram(s_hist.bootMs[1]);
+    out.printf("},\"slide_uah\":");
+    out.histogram(s_hist.slideUAh);
+    out.printf("}");
+    return out.overflowed() ? 0 : out.length();
+}
+
+static void onMqttEvent(void* arg, esp_event_base_t base, int32_t id, void* data)
+{
+    (void)arg;
+    (void)base;
+    esp_mqtt_event_handle_t event = static_cast<esp_mqtt_event_handle_t>(data);
+    switch (static_cast<esp_mqtt_event_id_t>(id)) {
+    case MQTT_EVENT_CONNECTED:
+        xEventGroupSetBits(s_mqttEvents, MQTT_CONNECTED);
+        break;
+    case MQTT_EVENT_PUBLISHED:
+        if (event->msg_id == s_publishId) {
+            xEventGroupSetBits(s_mqttEvents, MQTT_PUBLISHED);
+        }
+        break;
+    case MQTT_EVENT_ERROR:
+    case MQTT_EVENT_DISCONNECTED:
+        xEventGroupSetBits(s_mqttEvents, MQTT_FAILED);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Wait for a bit, or for the connection to fail
+ */
+static bool waitFor(EventBits_t bit)
+{
+    EventBits_t bits = xEventGroupWaitBits(s_mqttEvents, bit | MQTT_FAILED, pdFALSE, pdFALSE,
+                                           pdMS_TO_TICKS(TELEMETRY_MQTT_TIMEOUT_MS));
+    return (bits & bit) != 0;
+}
+
+bool Telemetry::publish()
+{
+    if (!pending()) {
+        return false;
+    }
+    if (!s_mqttEvents) {
+        s_mqttEvents = xEventGroupCreate();
+        if (!s_mqttEvents) {
+            return false;
+        }
+    }
+    xEventGroupClearBits(s_mqttEvents, MQTT_CONNECTED | MQTT_PUBLISHED | MQTT_FAILED);
+
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    char device[13];
+    snprintf(device, sizeof(device), "%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3],
+             mac[4], mac[5]);
+    char topic[64];
+    snprintf(topic, sizeof(topic), TELEMETRY_MQTT_TOPIC, device);
+
+    std::unique_ptr<char[]> message(new (std::nothrow) char[TELEMETRY_MESSAGE_SIZE]);
+    size_t length = message ? formatMessage(message.get(), TELEMETRY_MESSAGE_SIZE, device) : 0;
+    if (length == 0) {
+        ESP_LOGW(TAG_TELEMETRY, "Message doesn't fit in %zu bytes", TELEMETRY_MESSAGE_SIZE);
+        return false;
+    }
+
+    esp_mqtt_client_config_t config = {};
+    config.broker.address.uri = TELEMETRY_MQTT_URI;
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+    config.broker.verification.crt_bundle_attach = esp_crt_bundle_attach;
+#endif
+    config.credentials.client_id = device;
+    config.network.timeout_ms = TELEMETRY_MQTT_TIMEOUT_MS;
+    config.network.disable_auto_reconnect = true;
+    esp_mqtt_client_handle_t client = esp_mqtt_client_init(&config);
+    if (!client) {
+        return false;
+    }
+    esp_mqtt_client_register_event(client, MQTT_EVENT_ANY, onMqttEvent, nullptr);
+
+    bool sent = false;
+    if (esp_mqtt_client_start(client) == ESP_OK && waitFor(MQTT_CONNECTED)) {
+        s_publishId = esp_mqtt_client_publish(client, topic, message.get(),
+                                              static_cast<int>(length), 1, 0);
+        sent = s_publishId >= 0 && waitFor(MQTT_PUBLISHED);
+    }
+    esp_mqtt_client_destroy(client);
+    s_publishId = -1;
+
+    if (!sent) {
+        ESP_LOGW(TAG_TELEMETRY, "Publishing to %s failed, keeping %" PRIu32 " slides",
+                 TELEMETRY_MQTT_URI, s_hist.slides);
+        return false;
+    }
+    ESP_LOGI(TAG_TELEMETRY, "Published %" PRIu32 " slides to %s (%zu bytes)", s_hist.slides,
+             topic, length);
+    bool saved = s_hist.savedSlides != 0;
+    reset();
+    if (saved) {
+        save();  // Or the next power-on would bring them back
+    }
+    return true;
+}
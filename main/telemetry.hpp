@@ -0,0 +1,86 @@
+/**
+ * @file telemetry.hpp
+ * @brief Fleet performance telemetry, batched into one MQTT message per sync
+ *
+ * Every slide's stage times, the time from reset to the first image of
+ * each boot, the refreshes per waveform and the charge each slide took are
+ * added up into log2 histograms: bucket 0 counts values under 1 (ms, or
+ * uAh for charge), bucket k values from 2^(k-1) up to 2^k, and the last
+ * bucket everything above. The histograms live in RTC memory, so deep
+ * sleep keeps them, and are saved to NVS now and then for power loss.
+ *
+ * publish() sends them all as one JSON message while the radio is on for a
+ * WifiSync and clears them once the broker has acknowledged it; nothing
+ * turns the radio on for telemetry alone. A no-op unless
+ * TELEMETRY_ENABLED. Only for the slideshow task, except refresh() and
+ * boot(), which the panel's power callback calls.
+ */
+
+#pragma once
+
+#include "power_stats.hpp"
+#include "../components/Adafruit_EPD/src/Adafruit_EPD.h"
+#include <cstdint>
+
+namespace Telemetry {
+
+/**
+ * @brief Take back the histograms saved to NVS if RTC memory lost them
+ *        (power-on)
+ */
+void init();
+
+/**
+ * @brief Add a slide's stage times
+ * @param statsId Closed SlideStats record, once its refresh stages are in
+ */
+void slide(uint32_t statsId);
+
+/**
+ * @brief Add a slide's power window (PowerStats::mark()); boot windows
+ *        only count toward the total
+ * @param isSlide The window belongs to a slide
+ * @param usage Usage over the window
+ */
+void power(bool isSlide, const PowerStats::Usage& usage);
+
+/**
+ * @brief Count a refresh as it starts
+ * @param mode Its waveform, Adafruit_EPD::getRefreshMode()
+ */
+void refresh(epd_refresh_t mode);
+
+/**
+ * @brief Count an image that failed to load
+ */
+void failure();
+
+/**
+ * @brief Add this boot's time to the first image, once it is on the glass
+ *        (BootProfile::Mark::GLASS)
+ */
+void boot();
+
+/**
+ * @brief Whether there is anything to publish
+ */
+bool pending();
+
+/**
+ * @brief Publish the histograms as one message and clear them once it is
+ *        acknowledged
+ *
+ * Call while something holds the radio (WifiRadio::Link), e.g. right
+ * after a WifiSync; the broker connection is opened and closed here.
+ *
+ * @return true if the broker acknowledged the message
+ */
+bool publish();
+
+/**
+ * @brief Save the histograms to NVS on the way into deep sleep, every
+ *        TELEMETRY_NVS_SAVE_SLIDES slides
+ */
+void sleep();
+
+} // namespace Telemetry
@@ -0,0 +1,92 @@
+/**
+ * @file text_layout.cpp
+ * @brief One-pass text measurement and word wrap
+ */
+
+#include "text_layout.hpp"
+#include <cstring>
+
+TextLayout::Metrics::Metrics(const GFXfont* font, uint8_t sizeX, uint8_t sizeY)
+    : sizeX_(sizeX)
+{
+    if (!font) {
+        // Classic font: every character, printable or not, moves 6 pixels
+        memset(advances_, 6, sizeof(advances_));
+        lineHeight_ = 8 * sizeY;
+    } else {
+        memset(advances_, 0, sizeof(advances_));
+        for (uint16_t c = font->first; c <= font->last; c++) {
+            advances_[c] = font->glyph[c - font->first].xAdvance;
+        }
+        lineHeight_ = font->yAdvance * sizeY;
+    }
+    // Adafruit_GFX::write() doesn't advance for these
+    advances_['\n'] = 0;
+    advances_['\r'] = 0;
+}
+
+uint32_t TextLayout::Metrics::width(const char* text, size_t len) const
+{
+    uint32_t total = 0;
+    for (size_t i = 0; i < len; i++) {
+        total += advance(text[i]);
+    }
+    return total;
+}
+
+size_t TextLayout::wrap(const Metrics& metrics, const char* text, uint32_t maxWidth,
+                        Line* lines, size_t maxLines)
+{
+    size_t count = 0;
+    if (!text || !lines) {
+        return 0;
+    }
+
+    auto emit = [&](size_t start, size_t length, uint32_t width) {
+        if (count < maxLines) {
+            lines[count++] = { start, length, width };
+        }
+    };
+
+    size_t lineStart = 0;
+    uint32_t lineWidth = 0;
+    size_t lastSpace = SIZE_MAX;   // Last break opportunity on this line
+    uint32_t widthAtSpace = 0;     // Line width before that space
+    size_t i = 0;
+    for (; text[i] != '\0' && count < maxLines; i++) {
+        char c = text[i];
+        if (c == '\n') {
+            emit(lineStart, i - lineStart, lineWidth);
+            lineStart = i + 1;
+            lineWidth = 0;
+            lastSpace = SIZE_MAX;
+            continue;
+        }
+
+        uint16_t adv = metrics.advance(c);
+        if (c == ' ') {
+            lastSpace = i;
+            widthAtSpace = lineWidth;
+        }
+        while (c != ' ' && lineWidth + adv > maxWidth && i > lineStart) {
+            if (lastSpace != SIZE_MAX) {
+                // Move the word after the last space down
+                emit(lineStart, lastSpace - lineStart, widthAtSpace);
+                lineWidth -= widthAtSpace + metrics.advance(' ');
+                lineStart = lastSpace + 1;
+            } else {
+                // One word wider than the line: split it here
+                emit(lineStart, i - lineStart, lineWidth);
+                lineWidth = 0;
+                lineStart = i;
+            }
+            lastSpace = SIZE_MAX;
+        }
+        lineWidth += adv;
+    }
+
+    if (text[i] == '\0' && i > lineStart) {
+        emit(lineStart, i - lineStart, lineWidth);
+    }
+    return count;
+}
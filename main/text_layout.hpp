@@ -0,0 +1,77 @@
+/**
+ * @file text_layout.hpp
+ * @brief One-pass text measurement and word wrap for Adafruit_GFX fonts
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <gfxfont.h>
+
+namespace TextLayout {
+
+/**
+ * @brief Per-character advance table for one font at one text size
+ *
+ * Built once, so measuring a string is a table lookup per character instead
+ * of Adafruit_GFX::getTextBounds() walking the glyphs on every call. Widths
+ * are cursor advances, exactly what print() moves the cursor by.
+ */
+class Metrics {
+public:
+    /**
+     * @brief Build the table
+     * @param font GFX font, or nullptr for the classic 6x8 font
+     * @param sizeX Horizontal text size (setTextSize())
+     * @param sizeY Vertical text size
+     */
+    Metrics(const GFXfont* font, uint8_t sizeX = 1, uint8_t sizeY = 1);
+
+    /**
+     * @brief Cursor advance of one character, in pixels
+     */
+    uint16_t advance(char c) const { return advances_[static_cast<uint8_t>(c)] * sizeX_; }
+
+    /**
+     * @brief Width of len characters, in pixels
+     */
+    uint32_t width(const char* text, size_t len) const;
+
+    /**
+     * @brief Distance between baselines (or line tops for the classic font)
+     */
+    uint16_t lineHeight() const { return lineHeight_; }
+
+private:
+    uint8_t advances_[256];
+    uint8_t sizeX_;
+    uint16_t lineHeight_;
+};
+
+/**
+ * @brief One wrapped line: a slice of the source text
+ */
+struct Line {
+    size_t start;    // Offset of the first character
+    size_t length;   // Characters, without the break (space or newline)
+    uint32_t width;  // Pixels
+};
+
+/**
+ * @brief Word-wrap text to a width in one pass
+ *
+ * Breaks at the last space that fits, or mid-word when a single word is
+ * wider than the line; '\n' always breaks. Each character is measured once.
+ *
+ * @param metrics Font measurements
+ * @param text NUL-terminated text
+ * @param maxWidth Line width in pixels
+ * @param lines Output, up to maxLines lines
+ * @param maxLines Capacity of lines; text past the last line is dropped
+ * @return Number of lines written
+ */
+size_t wrap(const Metrics& metrics, const char* text, uint32_t maxWidth,
+            Line* lines, size_t maxLines);
+
+} // namespace TextLayout
@@ -0,0 +1,180 @@
+/**
+ * @file tunables.cpp
+ * @brief Tunables registry backed by NVS
+ */
+
+#include "tunables.hpp"
+#include "config.hpp"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "nvs.h"
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const char* TAG_TUNE = "Tunables";
+
+static constexpr size_t COUNT = static_cast<size_t>(Tunables::Id::COUNT);
+
+// In Id order; keys are NVS keys, so 15 characters at most
+static const Tunables::Info INFOS[COUNT] = {
+    { "prefetch_depth", "slides", PREFETCH_MAX_DEPTH, 0, PREFETCH_MAX_DEPTH },
+    { "cache_budget", "bytes", SLIDE_CACHE_BUDGET, 0, TUNABLE_CACHE_BUDGET_MAX },
+    { "spi_cmd_hz", "Hz", 0, 0, TUNABLE_SPI_MAX_HZ },
+    { "spi_data_hz", "Hz", 0, 0, TUNABLE_SPI_MAX_HZ },
+    { "dither", "mode", IMAGE_DITHER_MODE, 0, 4 },  // Dither::Mode NONE .. BLUE_NOISE
+    { "ghost_refreshes", "refreshes", 0, 0, UINT8_MAX },
+    { "ghost_area", "percent", 0, 0, UINT16_MAX },
+    { "dwell_sec", "s", AUTO_ADVANCE_DELAY_SEC, 1, 24 * 3600 },
+    { "idle_sec", "s", INACTIVITY_TIMEOUT_SEC, 10, 7 * 24 * 3600 },
+};
+
+static uint32_t s_values[COUNT];
+static bool s_loaded = false;
+
+static size_t indexOf(Tunables::Id id)
+{
+    return static_cast<size_t>(id);
+}
+
+/**
+ * @brief Stored value of a key, or its default when absent or out of range
+ */
+static uint32_t readStored(nvs_handle_t handle, size_t i)
+{
+    uint32_t value;
+    if (nvs_get_u32(handle, INFOS[i].key, &value) != ESP_OK) {
+        return INFOS[i].defaultValue;
+    }
+    if (value < INFOS[i].min || value > INFOS[i].max) {
+        ESP_LOGW(TAG_TUNE, "Stored %s %" PRIu32 " out of range, using %" PRIu32, INFOS[i].key,
+                 value, INFOS[i].defaultValue);
+        return INFOS[i].defaultValue;
+    }
+    return value;
+}
+
+/**
+ * @brief FNV-1a of the Wi-Fi MAC, which "arm k/n" lines split units by
+ */
+static uint32_t unitHash()
+{
+    uint8_t mac[6] = {};
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    uint32_t hash = 2166136261u;
+    for (uint8_t byte : mac) {
+        hash = (hash ^ byte) * 16777619u;
+    }
+    return hash;
+}
+
+void Tunables::init()
+{
+    nvs_handle_t handle;
+    bool open = nvs_open(TUNABLES_NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK;
+    for (size_t i = 0; i < COUNT; i++) {
+        s_values[i] = open ? readStored(handle, i) : INFOS[i].defaultValue;
+        if (s_values[i] != INFOS[i].defaultValue) {
+            ESP_LOGI(TAG_TUNE, "%s = %" PRIu32 " %s", INFOS[i].key, s_values[i], INFOS[i].unit);
+        }
+    }
+    if (open) {
+        nvs_close(handle);
+    }
+    s_loaded = true;
+}
+
+uint32_t Tunables::get(Id id)
+{
+    size_t i = indexOf(id);
+    return s_loaded ? s_values[i] : INFOS[i].defaultValue;
+}
+
+uint32_t Tunables::stored(Id id)
+{
+    size_t i = indexOf(id);
+    nvs_handle_t handle;
+    if (nvs_open(TUNABLES_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return INFOS[i].defaultValue;
+    }
+    uint32_t value = readStored(handle, i);
+    nvs_close(handle);
+    return value;
+}
+
+const Tunables::Info& Tunables::info(Id id)
+{
+    return INFOS[indexOf(id)];
+}
+
+bool Tunables::find(const char* key, Id& id)
+{
+    for (size_t i = 0; i < COUNT; i++) {
+        if (strcmp(INFOS[i].key, key) == 0) {
+            id = static_cast<Id>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Tunables::set(Id id, uint32_t value)
+{
+    const Info& entry = info(id);
+    if (value < entry.min || value > entry.max) {
+        return false;
+    }
+    nvs_handle_t handle;
+    if (nvs_open(TUNABLES_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        return false;
+    }
+    esp_err_t err = value == entry.defaultValue ? nvs_erase_key(handle, entry.key)
+                                                : nvs_set_u32(handle, entry.key, value);
+    bool ok = (err == ESP_OK || err == ESP_ERR_NVS_NOT_FOUND) && nvs_commit(handle) == ESP_OK;
+    nvs_close(handle);
+    if (!ok) {
+        ESP_LOGW(TAG_TUNE, "Failed to store %s", entry.key);
+    }
+    return ok;
+}
+
+bool Tunables::applyLine(const char* line, bool& armed)
+{
+    char key[24];
+    char value[24];
+    int fields = sscanf(line, " %23s %23s", key, value);
+    if (fields <= 0 || key[0] == '#') {
+        return true;
+    }
+    if (fields != 2) {
+        return false;
+    }
+    if (strcmp(key, "arm") == 0) {
+        unsigned arm;
+        unsigned arms;
+        if (strcmp(value, "all") == 0) {
+            armed = true;
+        } else if (sscanf(value, "%u/%u", &arm, &arms) == 2 && arms > 0 && arm < arms) {
+            armed = unitHash() % arms == arm;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    Id id;
+    char* end = nullptr;
+    unsigned long number = strtoul(value, &end, 10);
+    if (!find(key, id) || *end != '\0' || number > UINT32_MAX) {
+        return false;
+    }
+    if (!armed || stored(id) == number) {
+        return true;
+    }
+    if (!set(id, static_cast<uint32_t>(number))) {
+        return false;
+    }
+    ESP_LOGI(TAG_TUNE, "%s = %lu from the next boot", key, number);
+    return true;
+}
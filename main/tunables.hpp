@@ -0,0 +1,92 @@
+/**
+ * @file tunables.hpp
+ * @brief Performance parameters that can be changed without reflashing
+ *
+ * Each tunable has a key, a default from config.hpp and a valid range. A
+ * value set from the console ("tune <key> <value>") or by a Wi-Fi sync
+ * (WIFI_SYNC_BASE_URL/tunables.txt) is stored in NVS namespace
+ * TUNABLES_NVS_NAMESPACE. init() reads them once at boot and the pipeline
+ * reads get() when it sets itself up, so a stored value takes effect from
+ * the next boot. A key never set, or reset to its default, is absent from
+ * NVS, so a new default in config.hpp still reaches it.
+ *
+ * For A/B tests across a fleet, tunables.txt can give values to part of
+ * the units only:
+ *
+ *     # key value, for every unit
+ *     dwell_sec 30
+ *     arm 1/2
+ *     # from here on only units whose MAC hashes to 1 modulo 2
+ *     prefetch_depth 2
+ *     arm all
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Tunables {
+
+enum class Id : uint8_t {
+    PREFETCH_DEPTH,          // PrefetchPlan depth limit, up to PREFETCH_MAX_DEPTH
+    CACHE_BUDGET,            // SlideCache bytes
+    SPI_COMMAND_HZ,          // Panel SPI clocks, 0: the panel profile's
+    SPI_DATA_HZ,
+    DITHER_MODE,             // Dither::Mode
+    GHOST_MAX_REFRESHES,     // Ghost policy, 0: the panel profile's
+    GHOST_MAX_AREA_PERCENT,
+    DWELL_SEC,               // Auto-advance dwell outside schedule periods
+    INACTIVITY_SEC,          // Idle time before deep sleep
+    COUNT
+};
+
+/**
+ * @brief What a tunable is and which values it takes
+ */
+struct Info {
+    const char* key;       // NVS key and console/tunables.txt name
+    const char* unit;      // For display only
+    uint32_t defaultValue;
+    uint32_t min;
+    uint32_t max;
+};
+
+/**
+ * @brief Read the stored values; before this get() returns the defaults
+ */
+void init();
+
+/**
+ * @brief Value in effect this boot
+ */
+uint32_t get(Id id);
+
+/**
+ * @brief Value the next boot will use
+ */
+uint32_t stored(Id id);
+
+const Info& info(Id id);
+
+/**
+ * @brief Look up a tunable by key
+ * @return false if there is none
+ */
+bool find(const char* key, Id& id);
+
+/**
+ * @brief Store a value for the next boot; the default erases the key
+ * @return false if it is out of range or NVS could not be written
+ */
+bool set(Id id, uint32_t value);
+
+/**
+ * @brief Apply one line of tunables.txt
+ * @param armed Whether the unit is in the current "arm" section; start
+ *              with true
+ * @return false if the line is malformed or names an unknown key
+ */
+bool applyLine(const char* line, bool& armed);
+
+} // namespace Tunables
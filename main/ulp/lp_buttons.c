@@ -0,0 +1,67 @@
+/**
+ * @file lp_buttons.c
+ * @brief LP-core program: debounces the slideshow buttons in deep sleep
+ *
+ * Started by SlideshowButtons::configure_wakeup() with the LP timer, so it
+ * runs once every LP_BUTTONS_POLL_MS and halts in between. Each run samples
+ * the three buttons (to GND, pulled up) and keeps their debounced state in
+ * LP RAM. The main core is only woken for a gesture: a press released
+ * before long_ticks, or a hold reaching it. The gesture is left in
+ * `gesture` for SlideshowButtons::wakeGesture(); a bounce, or a glitch
+ * shorter than debounce_ticks, never wakes it.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ulp_lp_core_gpio.h"
+#include "ulp_lp_core_utils.h"
+
+#define BUTTONS 3
+#define GESTURE_LONG 0x100
+
+/* Set by the main core before the first run */
+uint32_t pins[BUTTONS];  /* LP IO numbers: UP, SELECT, DOWN */
+uint32_t debounce_ticks;
+uint32_t long_ticks;
+
+/* 0 until a gesture: the button's index + 1, ORed with GESTURE_LONG for a hold */
+volatile uint32_t gesture;
+
+static bool down[BUTTONS];       /* Debounced level */
+static uint32_t settle[BUTTONS]; /* Runs the raw level has differed from it */
+static uint32_t held[BUTTONS];   /* Runs since the debounced press */
+
+static void report(int button, uint32_t flags)
+{
+    gesture = (uint32_t)(button + 1) | flags;
+    ulp_lp_core_wakeup_main_processor();
+}
+
+int main(void)
+{
+    if (gesture != 0) {
+        return 0;  /* The main core is on its way */
+    }
+
+    for (int i = 0; i < BUTTONS; i++) {
+        bool level = ulp_lp_core_gpio_get_level((lp_io_num_t)pins[i]) == 0;
+        if (level == down[i]) {
+            settle[i] = 0;
+        } else if (++settle[i] >= debounce_ticks) {
+            settle[i] = 0;
+            down[i] = level;
+            /* A hold has already been reported */
+            if (!level && held[i] < long_ticks) {
+                report(i, 0);
+                return 0;
+            }
+            held[i] = 0;
+        }
+
+        if (down[i] && ++held[i] == long_ticks) {
+            report(i, GESTURE_LONG);
+            return 0;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file usb_storage.cpp
+ * @brief USB mass-storage implementation
+ */
+
+#include "usb_storage.hpp"
+#include "config.hpp"
+#include "sd_card.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "soc/soc_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <cinttypes>
+
+#if SOC_USB_OTG_SUPPORTED && defined(CONFIG_TINYUSB_MSC_ENABLED)
+#include "tinyusb.h"
+#include "tusb_msc_storage.h"
+#define USB_STORAGE_AVAILABLE 1
+#else
+#define USB_STORAGE_AVAILABLE 0
+#endif
+
+static const char* TAG_USB = "UsbStorage";
+
+bool UsbStorage::available()
+{
+    return USB_STORAGE_ENABLED && USB_STORAGE_AVAILABLE;
+}
+
+#if USB_STORAGE_AVAILABLE
+
+/**
+ * @brief Install TinyUSB with the card as its MSC drive, handed to the host
+ */
+static bool startMsc(sdmmc_card_t* card)
+{
+    tinyusb_config_t usb = {};  // Descriptors from menuconfig
+    if (tinyusb_driver_install(&usb) != ESP_OK) {
+        ESP_LOGE(TAG_USB, "TinyUSB driver install failed");
+        return false;
+    }
+    tinyusb_msc_sdmmc_config_t storage = {};
+    storage.card = card;
+    if (tinyusb_msc_storage_init_sdmmc(&storage) != ESP_OK) {
+        ESP_LOGE(TAG_USB, "MSC storage init failed");
+        tinyusb_driver_uninstall();
+        return false;
+    }
+    // Off the application side (if esp_tinyusb mounted it there) to the host
+    tinyusb_msc_storage_unmount();
+    return true;
+}
+
+static void stopMsc()
+{
+    tinyusb_msc_storage_deinit();
+    tinyusb_driver_uninstall();
+}
+
+UsbStorage::Result UsbStorage::serve()
+{
+    sdmmc_card_t* card = SDCard::card();
+    if (!available() || !card) {
+        return Result::UNAVAILABLE;
+    }
+    if (!startMsc(card)) {
+        return Result::UNAVAILABLE;
+    }
+    ESP_LOGI(TAG_USB, "SD card exposed over USB, waiting for a host");
+
+    // Over once the host had the drive and then ejected it (esp_tinyusb
+    // gives it back to the application) or stopped talking to the device
+    int64_t start = esp_timer_get_time();
+    int64_t connected = 0;
+    Result result = Result::NO_HOST;
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(USB_STORAGE_POLL_MS));
+        bool hostHasIt = tud_mounted() && tinyusb_msc_storage_in_use_by_usb_host();
+        if (hostHasIt && connected == 0) {
+            connected = esp_timer_get_time();
+            ESP_LOGI(TAG_USB, "Host connected");
+        }
+        if (connected != 0 && !hostHasIt) {
+            result = Result::EJECTED;
+            break;
+        }
+        if (connected == 0 &&
+            esp_timer_get_time() - start >= int64_t(USB_STORAGE_CONNECT_TIMEOUT_MS) * 1000) {
+            break;
+        }
+    }
+    stopMsc();
+    if (result == Result::EJECTED) {
+        ESP_LOGI(TAG_USB, "Drive ejected after %" PRId64 " s",
+                 (esp_timer_get_time() - connected) / 1000000);
+    } else {
+        ESP_LOGW(TAG_USB, "No host within %" PRIu32 " ms", USB_STORAGE_CONNECT_TIMEOUT_MS);
+    }
+    return result;
+}
+
+#else
+
+UsbStorage::Result UsbStorage::serve()
+{
+    ESP_LOGW(TAG_USB, "USB mass storage needs USB OTG and CONFIG_TINYUSB_MSC_ENABLED");
+    return Result::UNAVAILABLE;
+}
+
+#endif // USB_STORAGE_AVAILABLE
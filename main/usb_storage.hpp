@@ -0,0 +1,42 @@
+/**
+ * @file usb_storage.hpp
+ * @brief The SD card as a USB mass-storage drive (TinyUSB MSC)
+ *
+ * Copying hundreds of images is far quicker over USB than by pulling the
+ * card. A session hands the mounted card's sectors to TinyUSB's MSC class
+ * (esp_tinyusb's SD/MMC storage) at USB full speed; the host sees the FAT
+ * volume as a removable drive. The firmware's own FAT mount is left
+ * untouched meanwhile and remounted afterwards, since the host may have
+ * changed anything under its caches. Only on chips with USB OTG and with
+ * CONFIG_TINYUSB_MSC_ENABLED; elsewhere available() is false.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace UsbStorage {
+
+/**
+ * @brief Whether this build can expose the card over USB
+ */
+bool available();
+
+/**
+ * @brief Outcome of serve()
+ */
+enum class Result : uint8_t {
+    UNAVAILABLE,  // No USB OTG, MSC support or mounted card
+    NO_HOST,      // No host enumerated the drive within USB_STORAGE_CONNECT_TIMEOUT_MS
+    EJECTED       // The host had the drive and has ejected it or gone away
+};
+
+/**
+ * @brief Expose the card until the host is done with it; blocks
+ *
+ * The caller keeps every other task off the card for the duration and
+ * remounts it afterwards (SDCard::deinit(), SDCard::init()).
+ */
+Result serve();
+
+} // namespace UsbStorage
@@ -0,0 +1,323 @@
+/**
+ * @file widgets.cpp
+ * @brief Widget parsing, change detection and windowed redraws
+ */
+
+#include "widgets.hpp"
+#include "config.hpp"
+#include "battery.hpp"
+#include "schedule.hpp"
+#include "sd_card.hpp"
+#include "esp_log.h"
+#include "../components/Adafruit_EPD/src/Adafruit_EPD.h"
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+static const char* TAG_WIDGET = "Widgets";
+
+static constexpr size_t TEXT_MAX = 16;
+static_assert(WIDGET_MAX <= 32, "Window::members holds a bit per widget");
+static_assert(WIDGET_VALUE_SLOTS <= 32, "s_valuesSet holds a bit per slot");
+
+enum class Kind : uint8_t { CLOCK, DATE, BATTERY, TEMP, SLIDE, VALUE };
+
+/**
+ * @brief One widget and the text it last put on the glass
+ */
+struct Widget {
+    Kind kind;
+    uint8_t slot;      // VALUE
+    uint8_t textSize;
+    bool drawn;        // shown is on the glass
+    int16_t x;
+    int16_t y;
+    int16_t width;
+    int16_t height;
+    char shown[TEXT_MAX];
+};
+
+/**
+ * @brief Changed widgets sent as one window
+ */
+struct Window {
+    int16_t x1;
+    int16_t y1;
+    int16_t x2;
+    int16_t y2;
+    uint32_t area;     // Of its widgets, without the gaps between them
+    uint32_t members;  // Bit per widget
+};
+
+static Widget s_widgets[WIDGET_MAX];
+static size_t s_count = 0;
+static TickType_t s_lastPollTick = 0;
+static std::atomic<int32_t> s_values[WIDGET_VALUE_SLOTS];
+static std::atomic<uint32_t> s_valuesSet{0};
+
+static bool parseKind(const char* name, Widget& widget)
+{
+    static const struct {
+        const char* name;
+        Kind kind;
+    } KINDS[] = {
+        { "clock", Kind::CLOCK }, { "date", Kind::DATE }, { "battery", Kind::BATTERY },
+        { "temp", Kind::TEMP }, { "slide", Kind::SLIDE },
+    };
+    for (const auto& entry : KINDS) {
+        if (strcmp(name, entry.name) == 0) {
+            widget.kind = entry.kind;
+            return true;
+        }
+    }
+    unsigned slot;
+    char extra;
+    if (sscanf(name, "value%u%c", &slot, &extra) == 1 && slot < WIDGET_VALUE_SLOTS) {
+        widget.kind = Kind::VALUE;
+        widget.slot = static_cast<uint8_t>(slot);
+        return true;
+    }
+    return false;
+}
+
+bool Widgets::load(const char* imagePath)
+{
+    clear();
+    const char* dot = strrchr(imagePath, '.');
+    if (IMAGE_SIDECAR_EXTENSION[0] == '\0' || !dot) {
+        return false;
+    }
+    char path[SDCard::ImageList::MAX_PATH];
+    int stem = static_cast<int>(dot - imagePath);
+    if (snprintf(path, sizeof(path), "%.*s%s", stem, imagePath, IMAGE_SIDECAR_EXTENSION) >=
+        static_cast<int>(sizeof(path))) {
+        return false;
+    }
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    char line[96];
+    while (fgets(line, sizeof(line), file)) {
+        char name[12];
+        int x, y, width, height;
+        int textSize = 1;
+        if (sscanf(line, " widget = %11s %d %d %d %d %d", name, &x, &y, &width, &height,
+                   &textSize) < 5) {
+            continue;
+        }
+        Widget widget = {};
+        if (!parseKind(name, widget) || width <= 0 || height <= 0 || textSize < 1) {
+            ESP_LOGW(TAG_WIDGET, "%s: bad widget line: %s", path, line);
+            continue;
+        }
+        if (s_count == WIDGET_MAX) {
+            ESP_LOGW(TAG_WIDGET, "%s: more than %zu widgets", path, WIDGET_MAX);
+            break;
+        }
+        widget.x = static_cast<int16_t>(std::clamp(x, 0, INT16_MAX));
+        widget.y = static_cast<int16_t>(std::clamp(y, 0, INT16_MAX));
+        widget.width = static_cast<int16_t>(std::min(width, INT16_MAX - widget.x));
+        widget.height = static_cast<int16_t>(std::min(height, INT16_MAX - widget.y));
+        widget.textSize = static_cast<uint8_t>(std::min(textSize, 8));
+        s_widgets[s_count++] = widget;
+    }
+    fclose(file);
+    if (s_count > 0) {
+        ESP_LOGI(TAG_WIDGET, "%s: %zu widgets", path, s_count);
+    }
+    return s_count > 0;
+}
+
+void Widgets::clear()
+{
+    s_count = 0;
+}
+
+bool Widgets::active()
+{
+    return s_count > 0;
+}
+
+bool Widgets::setValue(size_t slot, int32_t value)
+{
+    if (slot >= WIDGET_VALUE_SLOTS) {
+        return false;
+    }
+    s_values[slot].store(value, std::memory_order_relaxed);
+    s_valuesSet.fetch_or(1u << slot, std::memory_order_release);
+    return true;
+}
+
+TickType_t Widgets::ticksUntilDue()
+{
+    TickType_t wait = portMAX_DELAY;
+    TickType_t elapsed = xTaskGetTickCount() - s_lastPollTick;
+    TickType_t poll = pdMS_TO_TICKS(WIDGET_POLL_SEC * 1000);
+    TickType_t untilPoll = elapsed >= poll ? 0 : poll - elapsed;
+    for (size_t i = 0; i < s_count; i++) {
+        struct tm now;
+        switch (s_widgets[i].kind) {
+            case Kind::CLOCK:
+            case Kind::DATE:
+                // Just past the next minute; an unset clock is polled
+                wait = std::min(wait, Schedule::localTime(now) ?
+                                          pdMS_TO_TICKS((60 - now.tm_sec) * 1000) :
+                                          untilPoll);
+                break;
+            case Kind::BATTERY:
+            case Kind::TEMP:
+                wait = std::min(wait, untilPoll);
+                break;
+            case Kind::SLIDE:
+            case Kind::VALUE:
+                break;  // Change with an event
+        }
+    }
+    return wait;
+}
+
+static void format(const Widget& widget, const Adafruit_EPD& display,
+                   const Widgets::Sources& sources, char* out)
+{
+    struct tm now;
+    switch (widget.kind) {
+        case Kind::CLOCK:
+            if (Schedule::localTime(now)) {
+                snprintf(out, TEXT_MAX, "%02d:%02d", now.tm_hour, now.tm_min);
+            } else {
+                snprintf(out, TEXT_MAX, "--:--");
+            }
+            break;
+        case Kind::DATE:
+            if (Schedule::localTime(now)) {
+                snprintf(out, TEXT_MAX, "%04d-%02d-%02d", now.tm_year + 1900, now.tm_mon + 1,
+                         now.tm_mday);
+            } else {
+                snprintf(out, TEXT_MAX, "----------");
+            }
+            break;
+        case Kind::BATTERY: {
+            uint32_t mv = Battery::millivolts();
+            if (mv > 0) {
+                snprintf(out, TEXT_MAX, "%" PRIu32 ".%02" PRIu32 " V", mv / 1000, mv % 1000 / 10);
+            } else {
+                snprintf(out, TEXT_MAX, "-- V");
+            }
+            break;
+        }
+        case Kind::TEMP: {
+            int8_t celsius = const_cast<Adafruit_EPD&>(display).getAmbientTemperature();
+            if (celsius != EPD_TEMPERATURE_UNKNOWN) {
+                snprintf(out, TEXT_MAX, "%d C", celsius);
+            } else {
+                snprintf(out, TEXT_MAX, "-- C");
+            }
+            break;
+        }
+        case Kind::SLIDE:
+            snprintf(out, TEXT_MAX, "%zu/%zu", sources.slide + 1, sources.slideCount);
+            break;
+        case Kind::VALUE:
+            if (s_valuesSet.load(std::memory_order_acquire) & (1u << widget.slot)) {
+                snprintf(out, TEXT_MAX, "%" PRId32,
+                         s_values[widget.slot].load(std::memory_order_relaxed));
+            } else {
+                snprintf(out, TEXT_MAX, "--");
+            }
+            break;
+    }
+}
+
+/**
+ * @brief Blank a widget's rectangle and print its text, cut to what fits,
+ *        centered vertically
+ */
+static void draw(Adafruit_EPD& display, Widget& widget, const char* text)
+{
+    int16_t charWidth = 6 * widget.textSize;
+    int16_t charHeight = 8 * widget.textSize;
+    char fitted[TEXT_MAX];
+    snprintf(fitted, sizeof(fitted), "%.*s", std::max(widget.width / charWidth, 0), text);
+    display.fillRect(widget.x, widget.y, widget.width, widget.height, EPD_WHITE);
+    display.setTextSize(widget.textSize);
+    display.setTextColor(EPD_BLACK);
+    display.setCursor(widget.x, widget.y + std::max(widget.height - charHeight, 0) / 2);
+    display.print(fitted);
+    snprintf(widget.shown, sizeof(widget.shown), "%s", text);
+    widget.drawn = true;
+}
+
+bool Widgets::update(Adafruit_EPD& display, const Sources& sources)
+{
+    s_lastPollTick = xTaskGetTickCount();
+
+    // Group the changed widgets: one joins a window as long as the window's
+    // box stays within WIDGET_MERGE_SLACK_PERCENT of the area it redraws
+    char text[WIDGET_MAX][TEXT_MAX];
+    Window windows[WIDGET_MAX];
+    size_t windowCount = 0;
+    for (size_t i = 0; i < s_count; i++) {
+        Widget& widget = s_widgets[i];
+        format(widget, display, sources, text[i]);
+        if (widget.drawn && strcmp(widget.shown, text[i]) == 0) {
+            continue;
+        }
+        int16_t x2 = widget.x + widget.width;
+        int16_t y2 = widget.y + widget.height;
+        uint32_t area = static_cast<uint32_t>(widget.width) * widget.height;
+        Window* joined = nullptr;
+        for (size_t w = 0; w < windowCount && !joined; w++) {
+            Window& window = windows[w];
+            uint32_t box = static_cast<uint32_t>(std::max(window.x2, x2) -
+                                                 std::min(window.x1, widget.x)) *
+                           (std::max(window.y2, y2) - std::min(window.y1, widget.y));
+            if (box * 100 <= (window.area + area) * (100 + WIDGET_MERGE_SLACK_PERCENT)) {
+                joined = &window;
+            }
+        }
+        if (!joined) {
+            joined = &windows[windowCount++];
+            *joined = { widget.x, widget.y, x2, y2, 0, 0 };
+        }
+        joined->x1 = std::min(joined->x1, widget.x);
+        joined->y1 = std::min(joined->y1, widget.y);
+        joined->x2 = std::max(joined->x2, x2);
+        joined->y2 = std::max(joined->y2, y2);
+        joined->area += area;
+        joined->members |= 1u << i;
+    }
+    if (windowCount == 0) {
+        return false;
+    }
+
+    // An upload may still be reading the planes
+    display.waitFramebufferFree();
+    for (size_t w = 0; w < windowCount; w++) {
+        for (size_t i = 0; i < s_count; i++) {
+            if (windows[w].members & (1u << i)) {
+                draw(display, s_widgets[i], text[i]);
+            }
+        }
+        if (display.chooseRefresh(false) == EPD_REFRESH_PARTIAL) {
+            display.displayDirty();
+            continue;
+        }
+        // Ghosting budget spent: one full refresh takes the rest along
+        for (size_t rest = w + 1; rest < windowCount; rest++) {
+            for (size_t i = 0; i < s_count; i++) {
+                if (windows[rest].members & (1u << i)) {
+                    draw(display, s_widgets[i], text[i]);
+                }
+            }
+        }
+        ESP_LOGI(TAG_WIDGET, "Full refresh");
+        display.displayAsync();
+        return true;
+    }
+    ESP_LOGD(TAG_WIDGET, "%zu windows sent", windowCount);
+    return true;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file widgets.hpp
+ * @brief Dashboard widgets over a slide, each redrawn only when it changes
+ *
+ * A slide's widgets are the "widget=" lines of its sidecar (the file
+ * ImageLoader reads the tone from), one per widget:
+ *
+ *     widget = clock 4 4 120 20 2
+ *
+ * gives the kind, its rectangle in logical coordinates and an optional text
+ * size. Kinds: clock (HH:MM), date (YYYY-MM-DD), battery (volts), temp
+ * (panel degrees C), slide (number/count) and value0..value3 (numbers set
+ * with setValue(), e.g. from the console).
+ *
+ * update() works out every widget's text and leaves alone those whose text
+ * hasn't changed. The changed rectangles are grouped into windows, close
+ * ones into one, and each window is redrawn and sent as a partial refresh.
+ * The display's ghosting budget decides, as for any window, when a full
+ * refresh is due instead. Only for the slideshow task, except setValue().
+ */
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include <cstddef>
+#include <cstdint>
+
+class Adafruit_EPD;
+
+namespace Widgets {
+
+/**
+ * @brief What the slideshow knows that the widgets show
+ */
+struct Sources {
+    size_t slide;       // 0-based
+    size_t slideCount;
+};
+
+/**
+ * @brief Read an image's widgets from its sidecar; the next update()
+ *        draws all of them
+ * @return false if it has none
+ */
+bool load(const char* imagePath);
+
+/**
+ * @brief Drop the loaded widgets
+ */
+void clear();
+
+/**
+ * @brief Whether any widgets are loaded
+ */
+bool active();
+
+/**
+ * @brief Set a value widget's number; any task
+ * @param slot 0..WIDGET_VALUE_SLOTS-1
+ * @return false for a slot out of range
+ */
+bool setValue(size_t slot, int32_t value);
+
+/**
+ * @brief Ticks until a widget's text may have changed on its own: the next
+ *        minute for the clock, WIDGET_POLL_SEC for readings
+ * @return portMAX_DELAY if nothing changes without an event
+ */
+TickType_t ticksUntilDue();
+
+/**
+ * @brief Redraw the widgets whose text changed and refresh their windows
+ *
+ * Window refreshes are synchronous; a full one, when the ghosting budget
+ * is spent, runs in the background. Call while the display isn't
+ * refreshing.
+ *
+ * @return true if anything was sent
+ */
+bool update(Adafruit_EPD& display, const Sources& sources);
+
+} // namespace Widgets
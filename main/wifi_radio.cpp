@@ -0,0 +1,159 @@
+/**
+ * @file wifi_radio.cpp
+ * @brief Shared Wi-Fi station implementation
+ */
+
+#include "wifi_radio.hpp"
+#include "config.hpp"
+#include "power_stats.hpp"
+#include "esp_log.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include <cstring>
+
+static const char* TAG_WIFI = "WifiRadio";
+
+static constexpr EventBits_t WIFI_CONNECTED = BIT0;
+static constexpr EventBits_t WIFI_FAILED = BIT1;
+
+static EventGroupHandle_t s_wifiEvents = nullptr;
+static int s_links = 0;            // Links alive
+static bool s_started = false;     // esp_wifi_start() succeeded
+static volatile bool s_stopping = false;
+
+static void onWifiEvent(void* arg, esp_event_base_t base, int32_t id, void* data)
+{
+    (void)arg;
+    (void)data;
+    if (base == WIFI_EVENT && id == WIFI_EVENT_STA_START) {
+        if (WIFI_SSID[0] != '\0') {
+            esp_wifi_connect();
+        }
+    } else if (base == WIFI_EVENT && id == WIFI_EVENT_STA_DISCONNECTED) {
+        xEventGroupClearBits(s_wifiEvents, WIFI_CONNECTED);
+        xEventGroupSetBits(s_wifiEvents, WIFI_FAILED);
+        if (!s_stopping && WIFI_SSID[0] != '\0') {
+            // Lost the access point while held: keep trying in the background
+            esp_wifi_connect();
+        }
+    } else if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP) {
+        xEventGroupClearBits(s_wifiEvents, WIFI_FAILED);
+        xEventGroupSetBits(s_wifiEvents, WIFI_CONNECTED);
+    }
+}
+
+/**
+ * @brief Set up the network stack and event handlers (once)
+ */
+static bool initNetwork()
+{
+    if (s_wifiEvents) {
+        return true;
+    }
+    esp_err_t err = esp_netif_init();
+    if (err == ESP_OK) {
+        err = esp_event_loop_create_default();
+        if (err == ESP_ERR_INVALID_STATE) {
+            err = ESP_OK;  // Created by someone else already
+        }
+    }
+    if (err != ESP_OK || !esp_netif_create_default_wifi_sta()) {
+        ESP_LOGE(TAG_WIFI, "Network stack init failed: %s", esp_err_to_name(err));
+        return false;
+    }
+    esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, onWifiEvent, nullptr);
+    esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, onWifiEvent, nullptr);
+    s_wifiEvents = xEventGroupCreate();
+    return s_wifiEvents != nullptr;
+}
+
+/**
+ * @brief Start the station and begin joining WIFI_SSID
+ */
+static bool startRadio()
+{
+    if (!initNetwork()) {
+        return false;
+    }
+    wifi_init_config_t init = WIFI_INIT_CONFIG_DEFAULT();
+    if (esp_wifi_init(&init) != ESP_OK) {
+        ESP_LOGE(TAG_WIFI, "Wi-Fi init failed");
+        return false;
+    }
+
+    wifi_config_t config = {};
+    strlcpy(reinterpret_cast<char*>(config.sta.ssid), WIFI_SSID, sizeof(config.sta.ssid));
+    strlcpy(reinterpret_cast<char*>(config.sta.password), WIFI_PASSWORD,
+            sizeof(config.sta.password));
+    xEventGroupClearBits(s_wifiEvents, WIFI_CONNECTED | WIFI_FAILED);
+    s_stopping = false;
+
+    // Credentials come from config.hpp; nothing to keep in NVS
+    esp_err_t err = esp_wifi_set_storage(WIFI_STORAGE_RAM);
+    if (err == ESP_OK) {
+        err = esp_wifi_set_mode(WIFI_MODE_STA);
+    }
+    if (err == ESP_OK) {
+        err = esp_wifi_set_config(WIFI_IF_STA, &config);
+    }
+    if (err == ESP_OK) {
+        err = esp_wifi_start();
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG_WIFI, "Wi-Fi start failed: %s", esp_err_to_name(err));
+        esp_wifi_deinit();
+        return false;
+    }
+    PowerStats::set(PowerStats::Load::RADIO, true);
+    return true;
+}
+
+static void stopRadio()
+{
+    s_stopping = true;
+    esp_wifi_disconnect();
+    esp_wifi_stop();
+    esp_wifi_deinit();
+    PowerStats::set(PowerStats::Load::RADIO, false);
+}
+
+WifiRadio::Link::Link()
+    : held_(false)
+{
+    if (s_links == 0) {
+        s_started = startRadio();
+    }
+    if (!s_started) {
+        return;
+    }
+    s_links++;
+    held_ = true;
+    if (WIFI_SSID[0] == '\0') {
+        return;  // Radio only (ESP-NOW): nothing to join
+    }
+
+    EventBits_t bits = xEventGroupWaitBits(s_wifiEvents, WIFI_CONNECTED | WIFI_FAILED, pdFALSE,
+                                           pdFALSE, pdMS_TO_TICKS(WIFI_CONNECT_TIMEOUT_MS));
+    if (!(bits & WIFI_CONNECTED)) {
+        ESP_LOGW(TAG_WIFI, "Could not join \"%s\"", WIFI_SSID);
+    }
+}
+
+WifiRadio::Link::~Link()
+{
+    if (!held_) {
+        return;
+    }
+    if (--s_links == 0) {
+        stopRadio();
+        s_started = false;
+    }
+}
+
+bool WifiRadio::Link::connected() const
+{
+    return held_ && (xEventGroupGetBits(s_wifiEvents) & WIFI_CONNECTED) != 0;
+}
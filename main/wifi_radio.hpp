@@ -0,0 +1,45 @@
+/**
+ * @file wifi_radio.hpp
+ * @brief The Wi-Fi station, shared by the features that need the network
+ *
+ * Each user holds a Link for as long as it needs the radio. The first Link
+ * starts the radio and joins WIFI_SSID; the last one to go stops it again,
+ * so the radio draws current only while something holds it. With an empty
+ * WIFI_SSID the radio is started without joining anything, which is all
+ * ESP-NOW (FrameCast) needs.
+ */
+
+#pragma once
+
+namespace WifiRadio {
+
+/**
+ * @brief A hold on the radio, on for as long as it is in scope
+ *
+ * Only from one task at a time.
+ */
+class Link {
+public:
+    /**
+     * @brief Start the radio if this is the first Link, waiting up to
+     *        WIFI_CONNECT_TIMEOUT_MS for an address
+     */
+    Link();
+    ~Link();
+
+    Link(const Link&) = delete;
+    Link& operator=(const Link&) = delete;
+
+    /**
+     * @brief Joined to WIFI_SSID with an address
+     *
+     * Checked again on each call: while any Link is held the radio keeps
+     * rejoining a lost access point in the background.
+     */
+    bool connected() const;
+
+private:
+    bool held_;
+};
+
+} // namespace WifiRadio
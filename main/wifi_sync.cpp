@@ -0,0 +1,683 @@
+/**
+ * @file wifi_sync.cpp
+ * @brief Wi-Fi image sync implementation
+ */
+
+#include "wifi_sync.hpp"
+#include "config.hpp"
+#include "sd_card.hpp"
+#include "image_loader.hpp"
+#include "slide_arena.hpp"
+#include "wifi_radio.hpp"
+#include "tunables.hpp"
+#include "panel.hpp"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_http_client.h"
+#include "sdkconfig.h"
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+#include "esp_crt_bundle.h"
+#endif
+#include <sys/time.h>
+#include <unistd.h>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+static const char* TAG_SYNC = "WifiSync";
+
+static constexpr uint32_t SYNC_INDEX_MAGIC = 0x58444953;  // "SIDX" little-endian
+static constexpr uint8_t SYNC_INDEX_VERSION = 1;
+static constexpr uint32_t FNV_BASIS = 2166136261u;
+static constexpr size_t MANIFEST_LINE_MAX = 96;
+static constexpr size_t URL_MAX = 192;
+
+/**
+ * @brief WIFI_SYNC_INDEX_FILE header, followed by one content hash per pack entry
+ */
+#pragma pack(push, 1)
+struct SyncIndexHeader {
+    uint32_t magic;         // SYNC_INDEX_MAGIC
+    uint8_t  version;       // SYNC_INDEX_VERSION
+    uint8_t  reserved[3];
+    uint32_t count;         // Entries of the pack it describes
+    uint32_t packChecksum;  // ImagePack::checksum() of that pack
+};
+#pragma pack(pop)
+
+struct ManifestEntry {
+    uint32_t hash;      // FNV-1a of the .epd frame
+    uint32_t length;    // Bytes of the frame
+    uint32_t nameHash;  // FNV-1a of the name, for ImagePackEntry::nameHash
+    uint8_t format;     // SDCard::IMAGE_PACK_FORMAT_*
+};
+
+// Wall clock of the last sync; 0 after power-on, which makes one due at boot
+RTC_DATA_ATTR static int64_t s_lastSyncUs = 0;
+
+static bool (*s_abortCheck)() = nullptr;
+static bool s_abandoned = false;
+
+static uint32_t fnv1a(uint32_t hash, const void* data, size_t len)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static int64_t wallClockUs()
+{
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return static_cast<int64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+/**
+ * @brief Poll the abort check; once it has fired the sync winds down
+ */
+static bool abandoned()
+{
+    if (!s_abandoned && s_abortCheck && s_abortCheck()) {
+        ESP_LOGI(TAG_SYNC, "Sync abandoned for input");
+        s_abandoned = true;
+    }
+    return s_abandoned;
+}
+
+// ---------------------------------------------------------------------------
+// HTTP
+// ---------------------------------------------------------------------------
+
+/**
+ * @brief One HTTP(S) GET, read as a stream
+ */
+class Download {
+public:
+    Download() = default;
+    ~Download();
+
+    Download(const Download&) = delete;
+    Download& operator=(const Download&) = delete;
+
+    /**
+     * @brief Send the request and read the response headers
+     * @return false on a connection error or a status other than 200
+     */
+    bool open(const char* url);
+
+    /** @brief Content-Length, -1 if the server didn't send one */
+    int64_t length() const
+    {
+        return length_;
+    }
+
+    /**
+     * @brief Read body bytes
+     * @return Bytes read (at most len), 0 at the end, -1 on an error
+     */
+    int read(uint8_t* dst, size_t len);
+
+private:
+    esp_http_client_handle_t client_ = nullptr;
+    int64_t length_ = -1;
+};
+
+Download::~Download()
+{
+    if (client_) {
+        esp_http_client_close(client_);
+        esp_http_client_cleanup(client_);
+    }
+}
+
+bool Download::open(const char* url)
+{
+    esp_http_client_config_t config = {};
+    config.url = url;
+    config.timeout_ms = WIFI_SYNC_HTTP_TIMEOUT_MS;
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+    config.crt_bundle_attach = esp_crt_bundle_attach;
+#endif
+    client_ = esp_http_client_init(&config);
+    if (!client_ || esp_http_client_open(client_, 0) != ESP_OK) {
+        ESP_LOGW(TAG_SYNC, "Cannot connect: %s", url);
+        return false;
+    }
+    length_ = esp_http_client_fetch_headers(client_);
+    int status = esp_http_client_get_status_code(client_);
+    if (status != 200) {
+        ESP_LOGW(TAG_SYNC, "HTTP %d: %s", status, url);
+        return false;
+    }
+    if (length_ <= 0) {
+        length_ = -1;  // Chunked, or no length given
+    }
+    return true;
+}
+
+int Download::read(uint8_t* dst, size_t len)
+{
+    int got = esp_http_client_read(client_, reinterpret_cast<char*>(dst), static_cast<int>(len));
+    return got < 0 ? -1 : got;
+}
+
+// ---------------------------------------------------------------------------
+// Manifest and local index
+// ---------------------------------------------------------------------------
+
+/**
+ * @brief Add one manifest line to entries
+ * @param version Set from the "EPDM <version>" line, 0 until it has been read
+ * @return false if the manifest is invalid
+ *
+ * Version 1 lines are "<hash> <length> <name>", all keyframes. Version 2
+ * adds a "k" or "d" before the name: a delta frame is XORed onto the slide
+ * before it (IMAGE_PACK_FORMAT_DELTA), so the first slide is a keyframe.
+ */
+static bool parseManifestLine(char* line, uint8_t& version, std::vector<ManifestEntry>& entries)
+{
+    size_t len = strlen(line);
+    while (len > 0 && (line[len - 1] == '\r' || line[len - 1] == ' ')) {
+        line[--len] = '\0';
+    }
+    if (len == 0 || line[0] == '#') {
+        return true;
+    }
+    if (version == 0) {
+        version = strcmp(line, "EPDM 1") == 0 ? 1 : strcmp(line, "EPDM 2") == 0 ? 2 : 0;
+        if (version == 0) {
+            ESP_LOGE(TAG_SYNC, "Not a version 1 or 2 manifest");
+        }
+        return version != 0;
+    }
+
+    ManifestEntry entry;
+    char name[64];
+    char kind = 'k';
+    bool parsed = version == 1 ?
+        sscanf(line, "%8" SCNx32 " %" SCNu32 " %63s", &entry.hash, &entry.length, name) == 3 :
+        sscanf(line, "%8" SCNx32 " %" SCNu32 " %c %63s", &entry.hash, &entry.length, &kind,
+               name) == 4;
+    if (!parsed || (kind != 'k' && kind != 'd') || (kind == 'd' && entries.empty()) ||
+        entry.length < ImageLoader::EPD_IMAGE_V1_HEADER_SIZE || entries.size() >= MAX_IMAGE_FILES) {
+        ESP_LOGE(TAG_SYNC, "Bad manifest entry %zu: %s", entries.size() + 1, line);
+        return false;
+    }
+    entry.format = kind == 'd' ? SDCard::IMAGE_PACK_FORMAT_DELTA : SDCard::IMAGE_PACK_FORMAT_EPD;
+    entry.nameHash = fnv1a(FNV_BASIS, name, strlen(name));
+    entries.push_back(entry);
+    return true;
+}
+
+/**
+ * @brief Download WIFI_SYNC_BASE_URL/<name> and hand it over line by line
+ * @param onLine Called with each line; returning false stops with an error
+ */
+template <typename OnLine>
+static bool fetchLines(const char* name, uint8_t* buffer, OnLine onLine)
+{
+    char url[URL_MAX];
+    snprintf(url, sizeof(url), "%s/%s", WIFI_SYNC_BASE_URL, name);
+    Download download;
+    if (!download.open(url)) {
+        return false;
+    }
+
+    char line[MANIFEST_LINE_MAX];
+    size_t lineLen = 0;
+    size_t lineNumber = 0;
+    for (;;) {
+        int got = download.read(buffer, WIFI_SYNC_CHUNK_SIZE);
+        if (got < 0 || abandoned()) {
+            return false;
+        }
+        // The end of the body ends the last line too
+        for (int i = 0; i <= got; i++) {
+            char c = (i < got) ? static_cast<char>(buffer[i]) : '\n';
+            if (c != '\n') {
+                if (lineLen + 1 >= sizeof(line)) {
+                    ESP_LOGE(TAG_SYNC, "%s line %zu too long", name, lineNumber + 1);
+                    return false;
+                }
+                line[lineLen++] = c;
+                continue;
+            }
+            line[lineLen] = '\0';
+            lineLen = 0;
+            lineNumber++;
+            if (!onLine(line)) {
+                return false;
+            }
+            if (got == 0) {
+                break;
+            }
+        }
+        if (got == 0) {
+            break;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Download and parse WIFI_SYNC_BASE_URL/manifest.txt
+ */
+static bool fetchManifest(std::vector<ManifestEntry>& entries, uint8_t* buffer)
+{
+    uint8_t version = 0;
+    bool ok = fetchLines("manifest.txt", buffer, [&](char* line) {
+        return parseManifestLine(line, version, entries);
+    });
+    if (!ok) {
+        return false;
+    }
+    if (entries.empty()) {
+        ESP_LOGE(TAG_SYNC, "Manifest lists no slides");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Store the tunables WIFI_SYNC_TUNABLES_FILE sets for this unit, for
+ *        the next boot; a missing or bad file changes nothing after it
+ */
+static void fetchTunables(uint8_t* buffer)
+{
+    bool armed = true;
+    size_t lineNumber = 0;
+    fetchLines(WIFI_SYNC_TUNABLES_FILE, buffer, [&](char* line) {
+        lineNumber++;
+        if (!Tunables::applyLine(line, armed)) {
+            ESP_LOGW(TAG_SYNC, "%s line %zu: %s", WIFI_SYNC_TUNABLES_FILE, lineNumber, line);
+            return false;
+        }
+        return true;
+    });
+}
+
+/**
+ * @brief Content hash of every frame in the pack: from WIFI_SYNC_INDEX_FILE
+ *        when it describes this pack, otherwise by reading the frames
+ * @param fromIndex Set if the index file was used
+ */
+static bool localHashes(SDCard::ImagePack& pack, std::vector<uint32_t>& hashes,
+                        uint8_t* buffer, bool& fromIndex)
+{
+    hashes.assign(pack.size(), 0);
+    fromIndex = false;
+    FILE* file = SDCard::openFile(WIFI_SYNC_INDEX_FILE);
+    if (file) {
+        SyncIndexHeader header;
+        fromIndex = fread(&header, 1, sizeof(header), file) == sizeof(header) &&
+                    header.magic == SYNC_INDEX_MAGIC && header.version == SYNC_INDEX_VERSION &&
+                    header.count == pack.size() && header.packChecksum == pack.checksum() &&
+                    fread(hashes.data(), sizeof(uint32_t), hashes.size(), file) == hashes.size();
+        fclose(file);
+        if (fromIndex) {
+            return true;
+        }
+    }
+
+    ESP_LOGI(TAG_SYNC, "No index for this pack, hashing its %zu frames", pack.size());
+    for (size_t i = 0; i < pack.size(); i++) {
+        FILE* frame = pack.seek(i);
+        uint32_t hash = FNV_BASIS;
+        uint32_t left = pack.entry(i).length;
+        while (frame && left > 0 && !abandoned()) {
+            size_t len = std::min<size_t>(left, WIFI_SYNC_CHUNK_SIZE);
+            size_t got;
+            {
+                SDCard::BusBurst burst;
+                got = fread(buffer, 1, len, frame);
+            }
+            if (got != len) {
+                break;
+            }
+            hash = fnv1a(hash, buffer, len);
+            left -= len;
+        }
+        if (left > 0) {
+            return false;
+        }
+        hashes[i] = hash;
+    }
+    return true;
+}
+
+/**
+ * @brief Record the content hashes of the pack just written
+ */
+static void writeIndex(uint32_t packChecksum, const std::vector<uint32_t>& hashes)
+{
+    SyncIndexHeader header = {};
+    header.magic = SYNC_INDEX_MAGIC;
+    header.version = SYNC_INDEX_VERSION;
+    header.count = static_cast<uint32_t>(hashes.size());
+    header.packChecksum = packChecksum;
+
+    FILE* file = SDCard::createFile(WIFI_SYNC_INDEX_FILE);
+    bool ok = file &&
+              fwrite(&header, 1, sizeof(header), file) == sizeof(header) &&
+              fwrite(hashes.data(), sizeof(uint32_t), hashes.size(), file) == hashes.size();
+    if (file) {
+        ok = (fclose(file) == 0) && ok;
+    }
+    if (!ok) {
+        // The next sync hashes the frames instead
+        ESP_LOGW(TAG_SYNC, "Failed to store the sync index");
+        remove(WIFI_SYNC_INDEX_FILE);
+    }
+}
+
+/**
+ * @brief Stream a frame from the server into the pack, checking its hash
+ */
+static bool downloadFrame(const ManifestEntry& entry, SDCard::ImagePackWriter& writer,
+                         uint8_t* buffer)
+{
+    char url[URL_MAX];
+    snprintf(url, sizeof(url), "%s/%08" PRIx32 ".epd", WIFI_SYNC_BASE_URL, entry.hash);
+    Download download;
+    if (!download.open(url)) {
+        return false;
+    }
+    if (download.length() >= 0 && download.length() != entry.length) {
+        ESP_LOGW(TAG_SYNC, "%s is %" PRId64 " bytes, manifest says %" PRIu32,
+                 url, download.length(), entry.length);
+        return false;
+    }
+
+    uint32_t hash = FNV_BASIS;
+    uint32_t done = 0;
+    while (done < entry.length) {
+        if (abandoned()) {
+            return false;
+        }
+        int got = download.read(buffer, std::min<size_t>(entry.length - done, WIFI_SYNC_CHUNK_SIZE));
+        if (got <= 0) {
+            ESP_LOGW(TAG_SYNC, "%s truncated at %" PRIu32 " bytes", url, done);
+            return false;
+        }
+        hash = fnv1a(hash, buffer, got);
+        if (!writer.write(buffer, got)) {
+            ESP_LOGE(TAG_SYNC, "Card write failed");
+            return false;
+        }
+        done += got;
+    }
+    if (hash != entry.hash) {
+        ESP_LOGW(TAG_SYNC, "%s doesn't match its hash", url);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Copy a frame from the old pack into the one being rebuilt
+ */
+static bool copyFrame(SDCard::ImagePack& pack, size_t index, SDCard::ImagePackWriter& writer,
+                      uint8_t* buffer)
+{
+    FILE* frame = pack.seek(index);
+    uint32_t left = pack.entry(index).length;
+    while (frame && left > 0 && !abandoned()) {
+        size_t len = std::min<size_t>(left, WIFI_SYNC_CHUNK_SIZE);
+        size_t got;
+        {
+            SDCard::BusBurst burst;
+            got = fread(buffer, 1, len, frame);
+        }
+        if (got != len || !writer.write(buffer, len)) {
+            break;
+        }
+        left -= len;
+    }
+    return left == 0;
+}
+
+/**
+ * @brief How the pack is brought in line with the manifest
+ */
+struct SyncPlan {
+    std::vector<size_t> source;  // Per slide: old pack entry with its frame, SIZE_MAX: download
+    uint64_t newBytes = 0;       // To download, frame alignment included
+    bool unchanged = false;      // The pack already is the manifest
+    bool append = false;         // Append to the pack rather than rebuild it
+};
+
+static SyncPlan planSync(const SDCard::ImagePack& pack, const std::vector<uint32_t>& oldHashes,
+                         int32_t packSize, const std::vector<ManifestEntry>& manifest)
+{
+    // Old entries by content hash
+    std::vector<std::pair<uint32_t, size_t>> byHash;
+    for (size_t i = 0; i < oldHashes.size(); i++) {
+        byHash.emplace_back(oldHashes[i], i);
+    }
+    std::sort(byHash.begin(), byHash.end());
+
+    SyncPlan plan;
+    plan.source.assign(manifest.size(), SIZE_MAX);
+    plan.unchanged = manifest.size() == pack.size();
+    std::vector<bool> kept(pack.size(), false);
+    uint64_t keptBytes = 0;
+    for (size_t i = 0; i < manifest.size(); i++) {
+        const ManifestEntry& m = manifest[i];
+        auto it = std::lower_bound(byHash.begin(), byHash.end(), std::make_pair(m.hash, size_t(0)));
+        for (; it != byHash.end() && it->first == m.hash; ++it) {
+            if (pack.entry(it->second).length == m.length) {
+                plan.source[i] = it->second;
+                break;
+            }
+        }
+        size_t from = plan.source[i];
+        if (from == SIZE_MAX) {
+            plan.newBytes += (m.length + SDCard::IMAGE_PACK_FRAME_ALIGN - 1) /
+                             SDCard::IMAGE_PACK_FRAME_ALIGN * SDCard::IMAGE_PACK_FRAME_ALIGN;
+        } else if (!kept[from]) {
+            kept[from] = true;
+            keptBytes += pack.entry(from).length;
+        }
+        plan.unchanged = plan.unchanged && from == i && pack.entry(i).nameHash == m.nameHash &&
+                         pack.entry(i).format == m.format;
+    }
+
+    // Append while at most half the file would be stale (old header and
+    // tables, dropped frames); past that the pack is rebuilt
+    uint64_t stale = static_cast<uint64_t>(std::max<int32_t>(packSize, 0)) - keptBytes;
+    plan.append = pack.isOpen() && stale <= keptBytes + plan.newBytes;
+    return plan;
+}
+
+/**
+ * @brief Bring IMAGE_PACK_FILE in line with the manifest
+ */
+static WifiSync::Result syncPack(uint8_t* buffer)
+{
+    using WifiSync::Result;
+
+    // What the card has, before the radio goes on
+    SDCard::ImagePack pack;
+    std::vector<uint32_t> oldHashes;
+    bool fromIndex = false;
+    if (pack.open(IMAGE_PACK_FILE, Panel::active().id) &&
+        !localHashes(pack, oldHashes, buffer, fromIndex)) {
+        return abandoned() ? Result::ABANDONED : Result::FAILED;
+    }
+    int32_t packSize = pack.isOpen() ? SDCard::getFileSize(IMAGE_PACK_FILE) : 0;
+
+    std::vector<ManifestEntry> manifest;
+    SyncPlan plan;
+    std::vector<SDCard::ImagePackEntry> entries;
+    FILE* file = nullptr;
+    SDCard::ImagePackWriter writer(nullptr, 0);
+    bool ok = true;
+
+    // The radio is on only for the manifest and the new frames
+    {
+        WifiRadio::Link radio;
+        if (!radio.connected()) {
+            return Result::FAILED;
+        }
+        if (WIFI_SYNC_TUNABLES_FILE) {
+            fetchTunables(buffer);
+        }
+        if (!fetchManifest(manifest, buffer)) {
+            return abandoned() ? Result::ABANDONED : Result::FAILED;
+        }
+        plan = planSync(pack, oldHashes, packSize, manifest);
+        if (plan.unchanged) {
+            if (!fromIndex) {
+                writeIndex(pack.checksum(), oldHashes);
+            }
+            return Result::UNCHANGED;
+        }
+        ESP_LOGI(TAG_SYNC, "%zu slides, %" PRIu64 " KB to download, %s", manifest.size(),
+                 plan.newBytes / 1024, plan.append ? "appending" : "rebuilding the pack");
+
+        entries.resize(manifest.size());
+        for (size_t i = 0; i < manifest.size(); i++) {
+            size_t from = plan.source[i];
+            entries[i].length = manifest[i].length;
+            entries[i].format = manifest[i].format;
+            entries[i].nameHash = manifest[i].nameHash;
+            entries[i].offset = (from != SIZE_MAX) ? pack.entry(from).offset : 0;
+        }
+
+        if (plan.append) {
+            pack.close();  // Only written from here on: the old offsets are in entries
+            file = fopen(IMAGE_PACK_FILE, "r+b");
+            writer = SDCard::ImagePackWriter(file, static_cast<uint32_t>(packSize));
+        } else {
+            // Invalid until finish() writes the header. Allocated in one run
+            // (at most one aligned copy per slide, then the table), so the
+            // slideshow reads its frames by sector (ImagePack::direct())
+            uint64_t size = SDCard::IMAGE_PACK_FRAME_ALIGN +
+                            manifest.size() * sizeof(SDCard::ImagePackEntry);
+            for (const ManifestEntry& m : manifest) {
+                size += (m.length + SDCard::IMAGE_PACK_FRAME_ALIGN - 1) /
+                        SDCard::IMAGE_PACK_FRAME_ALIGN * SDCard::IMAGE_PACK_FRAME_ALIGN;
+            }
+            file = size <= UINT32_MAX ?
+                SDCard::createContiguousFile(WIFI_SYNC_TEMP_FILE, static_cast<uint32_t>(size)) :
+                SDCard::createFile(WIFI_SYNC_TEMP_FILE);
+            writer = SDCard::ImagePackWriter(file, 0);
+            SDCard::ImagePackHeader blank = {};
+            writer.write(&blank, sizeof(blank));
+        }
+        if (!file) {
+            ESP_LOGE(TAG_SYNC, "Cannot write %s", plan.append ? IMAGE_PACK_FILE : WIFI_SYNC_TEMP_FILE);
+            return Result::FAILED;
+        }
+
+        for (size_t i = 0; i < manifest.size() && ok; i++) {
+            if (plan.source[i] == SIZE_MAX) {
+                ok = writer.align();
+                entries[i].offset = writer.offset();
+                ok = ok && downloadFrame(manifest[i], writer, buffer);
+            }
+        }
+    }
+
+    // A rebuilt pack also needs the frames it keeps, each copied once
+    if (!plan.append) {
+        std::vector<uint32_t> copiedTo(pack.size(), 0);
+        for (size_t i = 0; i < manifest.size() && ok; i++) {
+            size_t from = plan.source[i];
+            if (from == SIZE_MAX) {
+                continue;
+            }
+            if (copiedTo[from] == 0) {
+                ok = writer.align();
+                copiedTo[from] = writer.offset();
+                ok = ok && copyFrame(pack, from, writer, buffer);
+            }
+            entries[i].offset = copiedTo[from];
+        }
+        pack.close();
+    }
+    ok = ok && writer.align() && writer.finish(entries);
+    ok = (fclose(file) == 0) && ok;
+
+    if (ok && !plan.append) {
+        // Not atomic: a reset in between leaves no pack, and the slideshow
+        // shows the image directory until the next sync
+        remove(IMAGE_PACK_FILE);
+        ok = rename(WIFI_SYNC_TEMP_FILE, IMAGE_PACK_FILE) == 0;
+    }
+    if (!ok) {
+        // An append left only unreferenced bytes behind the old pack
+        if (!plan.append) {
+            remove(WIFI_SYNC_TEMP_FILE);
+        }
+        if (!abandoned()) {
+            ESP_LOGE(TAG_SYNC, "Pack update failed");
+        }
+        return abandoned() ? Result::ABANDONED : Result::FAILED;
+    }
+
+    // Check what was written the way the slideshow will open it
+    if (!pack.open(IMAGE_PACK_FILE, Panel::active().id)) {
+        return Result::FAILED;
+    }
+    std::vector<uint32_t> hashes(manifest.size());
+    for (size_t i = 0; i < manifest.size(); i++) {
+        hashes[i] = manifest[i].hash;
+    }
+    writeIndex(pack.checksum(), hashes);
+    return Result::UPDATED;
+}
+
+bool WifiSync::due()
+{
+    return msUntilDue() == 0;
+}
+
+uint32_t WifiSync::msUntilDue()
+{
+    if (!WIFI_SYNC_ENABLED) {
+        return UINT32_MAX;
+    }
+    if (s_lastSyncUs == 0) {
+        return 0;
+    }
+    int64_t dueUs = s_lastSyncUs + static_cast<int64_t>(WIFI_SYNC_INTERVAL_SEC) * 1000000;
+    int64_t leftMs = (dueUs - wallClockUs()) / 1000;
+    return static_cast<uint32_t>(std::min<int64_t>(std::max<int64_t>(leftMs, 0), UINT32_MAX - 1));
+}
+
+WifiSync::Result WifiSync::run(bool (*abortCheck)())
+{
+    if (!WIFI_SYNC_ENABLED) {
+        ESP_LOGW(TAG_SYNC, "Wi-Fi sync is disabled (WIFI_SYNC_ENABLED)");
+        return Result::FAILED;
+    }
+    s_lastSyncUs = wallClockUs();
+    s_abortCheck = abortCheck;
+    s_abandoned = false;
+
+    int64_t start = esp_timer_get_time();
+    SlideArena::Scope arena;
+    auto buffer = SlideArena::makeArray<uint8_t>(WIFI_SYNC_CHUNK_SIZE);
+    Result result = buffer ? syncPack(buffer.get()) : Result::FAILED;
+    ESP_LOGI(TAG_SYNC, "Sync %s in %" PRId64 " ms", resultName(result),
+             (esp_timer_get_time() - start) / 1000);
+    return result;
+}
+
+const char* WifiSync::resultName(Result result)
+{
+    switch (result) {
+        case Result::UNCHANGED: return "unchanged";
+        case Result::UPDATED:   return "updated";
+        case Result::FAILED:    return "failed";
+        case Result::ABANDONED: return "abandoned";
+    }
+    return "?";
+}
@@ -0,0 +1,70 @@
+/**
+ * @file wifi_sync.hpp
+ * @brief Image pack updates over Wi-Fi, downloading only changed frames
+ *
+ * A sync fetches WIFI_SYNC_BASE_URL/manifest.txt: a "EPDM 1" line, then one
+ * line per slide in show order,
+ *
+ *     <content hash, 8 hex digits> <length> <name>
+ *
+ * where the hash is FNV-1a of the slide's .epd frame, served as
+ * <hash>.epd next to the manifest. An "EPDM 2" manifest puts "k" or "d"
+ * before each name: "d" frames are deltas onto the slide before them
+ * (SDCard::IMAGE_PACK_FORMAT_DELTA), much smaller to download. Slides the pack already holds (by
+ * content hash, from WIFI_SYNC_INDEX_FILE or by hashing the frames) are
+ * kept where they are; the rest are streamed from the network to the card
+ * through one WIFI_SYNC_CHUNK_SIZE buffer and checked against their hash.
+ *
+ * New frames and the new entry table are appended to IMAGE_PACK_FILE and
+ * the header is rewritten last, so an interrupted sync leaves the old pack
+ * intact. Once more than half of the file would be stale, the pack is
+ * rebuilt into WIFI_SYNC_TEMP_FILE and renamed over it instead.
+ *
+ * Before the manifest, WIFI_SYNC_TUNABLES_FILE is fetched and the tunables
+ * it sets for this unit are stored for the next boot (Tunables::applyLine()).
+ *
+ * The radio is started for a sync and stopped again before it returns. Only
+ * for the slideshow task, with the panel idle and the pack closed.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace WifiSync {
+
+enum class Result : uint8_t {
+    UNCHANGED,  // The pack already matches the manifest
+    UPDATED,    // The pack was rewritten; slide indices may mean other images
+    FAILED,     // No network, server or card error; the pack is unchanged
+    ABANDONED   // Stopped for input; the pack is unchanged
+};
+
+/**
+ * @brief Check whether a scheduled sync is due (never if WIFI_SYNC_ENABLED
+ *        is false)
+ *
+ * The schedule survives deep sleep; after power-on a sync is due at once.
+ */
+bool due();
+
+/**
+ * @brief Milliseconds until due() turns true, UINT32_MAX if never
+ */
+uint32_t msUntilDue();
+
+/**
+ * @brief Run a sync now, due or not; the next scheduled one is
+ *        WIFI_SYNC_INTERVAL_SEC after this
+ * @param abortCheck Polled between chunks; returning true stops the sync.
+ *                   nullptr: always finish
+ * @return What happened to the pack
+ */
+Result run(bool (*abortCheck)());
+
+/**
+ * @brief Name of a result, for logs and the console
+ */
+const char* resultName(Result result);
+
+} // namespace WifiSync
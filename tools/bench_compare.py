@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""
+Compare epd_bench runs captured from the serial console (BENCH_JSON_ENABLED).
+
+Each result is a "BENCHJSON {...}" line carrying its samples, percentiles,
+rate, build ID, panel and any budget verdict from BUDGET.TXT on the card;
+the run ends with a summary line. Other lines are ignored, so a whole
+monitor log can be passed.
+
+With one log, prints its results and budget verdicts. With two (baseline
+first), also prints each metric's change and flags the ones that got worse
+by more than --threshold percent: rates (KB/s, MB/s, Mpx/s) by their rate,
+times by their median. Exits 1 if a budget failed or a metric regressed.
+
+Usage:
+    tools/bench_compare.py new.log
+    tools/bench_compare.py old.log new.log --threshold 3
+"""
+
+import argparse
+import json
+import sys
+
+PREFIX = "BENCHJSON "
+
+
+def read_run(path):
+    """The results of a log by metric, and its summary lines."""
+    results, summaries = {}, []
+    with open(path, errors="replace") as f:
+        for line in f:
+            start = line.find(PREFIX)
+            if start < 0:
+                continue
+            try:
+                record = json.loads(line[start + len(PREFIX):])
+            except json.JSONDecodeError:
+                continue
+            if "metric" in record:
+                results[record["metric"]] = record
+            elif "suite" in record:
+                summaries.append(record)
+    return results, summaries
+
+
+def figure(record):
+    """The figure compared between runs, and whether higher is better."""
+    if "rate" in record:
+        return record["rate"], True
+    return record.get("p50"), False
+
+
+def describe(record):
+    if record.get("failed"):
+        text = "FAILED"
+    else:
+        text = f"p50 {record['p50']:9.3f} p90 {record['p90']:9.3f} ms"
+        if "rate" in record:
+            text += f"  {record['rate']:10.3f} {record['rate_unit']}"
+    budget = record.get("budget")
+    if budget:
+        verdict = "ok" if budget["pass"] else "OVER BUDGET"
+        text += f"  [{budget['field']} {budget['op']} {budget['limit']:g}: {verdict}]"
+    return text
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("logs", nargs="+", help="serial log(s): [baseline] current")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="percent change that counts as a regression (default 5)")
+    args = parser.parse_args()
+    if len(args.logs) > 2:
+        parser.error("at most two logs")
+
+    runs = [read_run(path) for path in args.logs]
+    base = runs[0][0] if len(runs) == 2 else None
+    current, summaries = runs[-1]
+    if not current:
+        print(f"No BENCHJSON lines in {args.logs[-1]}")
+        return 1
+
+    first = next(iter(current.values()))
+    print(f"build {first['build']}, panel {first['panel']}")
+    if base:
+        old = next(iter(base.values()))
+        print(f"baseline build {old['build']}, panel {old['panel']}")
+
+    failed = False
+    for metric, record in current.items():
+        line = f"{metric:24} {describe(record)}"
+        budget = record.get("budget")
+        failed |= bool(record.get("failed")) or bool(budget and not budget["pass"])
+        if base and metric in base and not record.get("failed") and not base[metric].get("failed"):
+            now, higher_better = figure(record)
+            then, _ = figure(base[metric])
+            if then:
+                change = (now - then) / then * 100
+                worse = -change if higher_better else change
+                line += f"  {change:+6.1f}%"
+                if worse > args.threshold:
+                    line += " REGRESSION"
+                    failed = True
+        print(line)
+
+    for summary in summaries:
+        verdict = "PASS" if summary["pass"] else "FAIL"
+        print(f"suite {summary['suite']}: {verdict}, {summary['failed']} of "
+              f"{summary['budgets']} budgets exceeded")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
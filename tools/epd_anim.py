@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""
+Build a slide animation (".ani") from a sequence of frame images.
+
+Each frame is rendered at the logical display size exactly as
+tools/epd_convert.py does. The file holds a key frame and the rectangles
+that change from each frame to the next, ending with the way back to the
+first frame. Each rectangle holds the colors it ends with. The key frame is
+the box around every change, as in the first frame. The device draws one
+rectangle per step and refreshes just that window (main/animation.hpp).
+
+Name the output after the slide it animates: photo.bmp gets photo.ani.
+
+Usage:
+    tools/epd_anim.py arrow1.png arrow2.png -o /path/to/sdcard/images/sign.ani
+
+Requires Pillow (pip install pillow).
+"""
+
+import argparse
+import struct
+
+from PIL import Image
+
+import epd_convert
+
+# Must match Animation::FileHeader / FrameHeader in main/animation.hpp
+ANIMATION_MAGIC = 0x41445045  # "EPDA"
+ANIMATION_VERSION = 1
+HEADER_FORMAT = "<IBBHHHHxx"
+FRAME_FORMAT = "<HHHH"
+
+
+def changed_box(a, b):
+    """Bounding box (x1, y1, x2, y2) of the pixels that differ, or None."""
+    rows = [y for y, (ra, rb) in enumerate(zip(a, b)) if ra != rb]
+    if not rows:
+        return None
+    cols = [x for y in rows for x, (pa, pb) in enumerate(zip(a[y], b[y])) if pa != pb]
+    return min(cols), rows[0], max(cols) + 1, rows[-1] + 1
+
+
+def frame_record(colors, box):
+    """A frame: its rectangle, then 2-bit colors, 4 per byte, MSB first."""
+    x1, y1, x2, y2 = box
+    out = bytearray(struct.pack(FRAME_FORMAT, x1, y1, x2 - x1, y2 - y1))
+    for y in range(y1, y2):
+        row = colors[y][x1:x2]
+        for i in range(0, len(row), 4):
+            byte = 0
+            for j, c in enumerate(row[i:i + 4]):
+                byte |= c << (6 - 2 * j)
+            out.append(byte)
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("inputs", nargs="+", help="frames in order (any format Pillow reads)")
+    parser.add_argument("-o", "--output", required=True, help="output .ani file")
+    parser.add_argument("--frame-ms", type=int, default=1000,
+                        help="period between frames (the device caps it at ANIMATION_MIN_FRAME_MS)")
+    parser.add_argument("--width", type=int, default=128, help="logical width (DISPLAY_WIDTH)")
+    parser.add_argument("--height", type=int, default=296, help="logical height (DISPLAY_HEIGHT)")
+    parser.add_argument("--dither", default="none", choices=epd_convert.DITHER_MODES.keys(),
+                        help="dithering (default: none, for flat graphics)")
+    parser.add_argument("--scale", default="area", choices=("nearest", "area"),
+                        help="resize filter, as IMAGE_SCALE_MODE (default: area)")
+    args = parser.parse_args()
+
+    frames = [epd_convert.render(Image.open(path), args.width, args.height,
+                                 epd_convert.DITHER_MODES[args.dither], args.scale == "area")
+              for path in args.inputs]
+    steps = [(frames[i], changed_box(frames[i - 1], frames[i])) for i in range(1, len(frames))]
+    steps.append((frames[0], changed_box(frames[-1], frames[0])))
+    steps = [(colors, box) for colors, box in steps if box]
+    if not steps:
+        parser.error("the frames are all the same")
+
+    key = (min(b[0] for _, b in steps), min(b[1] for _, b in steps),
+           max(b[2] for _, b in steps), max(b[3] for _, b in steps))
+    records = [frame_record(frames[0], key)] + [frame_record(c, b) for c, b in steps]
+    header = struct.pack(HEADER_FORMAT, ANIMATION_MAGIC, ANIMATION_VERSION, 0, len(records),
+                         args.frame_ms, args.width, args.height)
+    with open(args.output, "wb") as f:
+        f.write(header)
+        for record in records:
+            f.write(record)
+    print(f"{len(args.inputs)} frames -> {args.output} ({len(records) - 1} steps, "
+          f"{len(header) + sum(map(len, records))} bytes)")
+
+
+if __name__ == "__main__":
+    main()
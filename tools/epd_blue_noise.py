@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""
+Generate the blue-noise threshold mask Dither::Mode::BLUE_NOISE tiles.
+
+The mask is a SIZE x SIZE ranking of every cell, made by void-and-cluster
+(Ulichney 1993): each rank goes to the cell that leaves the pattern of
+ranked cells most evenly spread, so any threshold of the mask is a
+blue-noise point set with no low-frequency clumps, and the mask tiles
+without seams (distances wrap around). Ranks are scaled to 0..255 thresholds.
+
+The result is deterministic for a given size, sigma and seed.
+
+Usage:
+    tools/epd_blue_noise.py -o main/blue_noise.cpp
+    tools/epd_blue_noise.py --size 32 --sigma 1.9 -o main/blue_noise.cpp
+
+The output is a C++ source defining BlueNoise::MASK (main/blue_noise.hpp);
+its SIZE must match BlueNoise::SIZE.
+"""
+
+import argparse
+import math
+import random
+
+
+class Energy:
+    """Gaussian energy of a set of points on a torus, updated per point."""
+
+    def __init__(self, size, sigma):
+        self.size = size
+        radius = min(size // 2, int(math.ceil(sigma * 4)))
+        self.kernel = []
+        for dy in range(-radius, radius + 1):
+            for dx in range(-radius, radius + 1):
+                self.kernel.append((dy, dx, math.exp(-(dx * dx + dy * dy) / (2 * sigma * sigma))))
+        self.values = [0.0] * (size * size)
+
+    def add(self, cell, sign):
+        size = self.size
+        y0, x0 = divmod(cell, size)
+        values = self.values
+        for dy, dx, weight in self.kernel:
+            values[((y0 + dy) % size) * size + (x0 + dx) % size] += sign * weight
+
+
+def tightest_cluster(energy, points):
+    return max((c for c in range(len(points)) if points[c]), key=energy.values.__getitem__)
+
+
+def largest_void(energy, points):
+    return min((c for c in range(len(points)) if not points[c]), key=energy.values.__getitem__)
+
+
+def void_and_cluster(size, sigma, seed):
+    cells = size * size
+    rng = random.Random(seed)
+
+    # Initial pattern: a tenth of the cells, relaxed until moving the
+    # tightest cluster point doesn't land it in a bigger void
+    points = [False] * cells
+    energy = Energy(size, sigma)
+    for cell in rng.sample(range(cells), max(1, cells // 10)):
+        points[cell] = True
+        energy.add(cell, 1)
+    while True:
+        cluster = tightest_cluster(energy, points)
+        points[cluster] = False
+        energy.add(cluster, -1)
+        void = largest_void(energy, points)
+        points[void] = True
+        energy.add(void, 1)
+        if void == cluster:
+            break
+    initial = list(points)
+    initial_energy = list(energy.values)
+    ones = sum(initial)
+
+    ranks = [0] * cells
+    # Phase 1: rank the initial points, tightest cluster last removed first
+    for rank in range(ones - 1, -1, -1):
+        cluster = tightest_cluster(energy, points)
+        points[cluster] = False
+        energy.add(cluster, -1)
+        ranks[cluster] = rank
+
+    # Phase 2: fill the largest voids up to half the cells
+    points = list(initial)
+    energy.values = list(initial_energy)
+    rank = ones
+    while rank < cells // 2:
+        void = largest_void(energy, points)
+        points[void] = True
+        energy.add(void, 1)
+        ranks[void] = rank
+        rank += 1
+
+    # Phase 3: the rest, as the tightest clusters of the remaining zeros
+    zeros = Energy(size, sigma)
+    for cell in range(cells):
+        if not points[cell]:
+            zeros.add(cell, 1)
+    while rank < cells:
+        cluster = max((c for c in range(cells) if not points[c]), key=zeros.values.__getitem__)
+        points[cluster] = True
+        zeros.add(cluster, -1)
+        ranks[cluster] = rank
+        rank += 1
+
+    return [rank * 256 // cells for rank in ranks]
+
+
+def write_source(path, mask, size, sigma, seed):
+    with open(path, "w") as f:
+        f.write("/**\n")
+        f.write(" * @file blue_noise.cpp\n")
+        f.write(" * @brief Generated by tools/epd_blue_noise.py, do not edit\n")
+        f.write(" *\n")
+        f.write(f" * --size {size} --sigma {sigma} --seed {seed}\n")
+        f.write(" */\n\n")
+        f.write('#include "blue_noise.hpp"\n\n')
+        f.write(f"static_assert(BlueNoise::SIZE == {size}, \"Regenerate with --size\");\n\n")
+        f.write("const uint8_t BlueNoise::MASK[SIZE * SIZE] = {\n")
+        for row in range(size):
+            values = mask[row * size:(row + 1) * size]
+            for start in range(0, size, 16):
+                chunk = ", ".join(f"{v:3}" for v in values[start:start + 16])
+                f.write(f"    {chunk},\n")
+        f.write("};\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("-o", "--output", required=True, help="C++ source to write")
+    parser.add_argument("--size", type=int, default=64, help="mask width and height")
+    parser.add_argument("--sigma", type=float, default=1.5, help="energy filter sigma")
+    parser.add_argument("--seed", type=int, default=1, help="initial pattern seed")
+    args = parser.parse_args()
+
+    mask = void_and_cluster(args.size, args.sigma, args.seed)
+    write_source(args.output, mask, args.size, args.sigma, args.seed)
+
+
+if __name__ == "__main__":
+    main()
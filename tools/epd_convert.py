@@ -0,0 +1,447 @@
+#!/usr/bin/env python3
+"""
+Convert images to the slideshow's native pre-packed ".epd" format.
+
+The output holds the display framebuffer planes exactly as Adafruit_EPD keeps
+them in buffer1/buffer2 (THINKINK_STANDARD entry mode, controller inversion
+applied), so the device loads a slide with no per-pixel work: RAW planes are
+two freads, RLE and LZ planes expand into the buffers as they are read. By
+default each frame gets whichever encoding is smallest.
+The header names the panel, rotation and entry mode the frame is for.
+
+Scaling (including area-average shrinking), color quantization and
+dithering mirror ImageLoader and
+Dither::RowDitherer, so a converted frame looks the same as the BMP would on
+the device.
+
+Usage:
+    tools/epd_convert.py input.jpg [more.png ...] -o /path/to/sdcard/images
+
+Requires Pillow (pip install pillow).
+"""
+
+import argparse
+import collections
+import math
+import os
+import struct
+import sys
+
+try:
+    from PIL import Image
+except ImportError:
+    sys.exit("Pillow is required: pip install pillow")
+
+# Must match EPDImageHeader / EPD_IMAGE_* in main/image_loader.hpp
+EPD_IMAGE_MAGIC = 0x49445045  # "EPDI"
+EPD_IMAGE_VERSION = 2
+HEADER_FORMAT = "<IBBBBHHIIBBxxII"
+THINKINK_STANDARD = 0
+
+# EPD_ENCODING_* and the RLE layout in main/frame_codec.hpp
+ENCODINGS = {"raw": 0, "rle": 1, "lz": 2}
+RLE_MIN_RUN = 3
+RLE_MAX_RUN = 0x7F + RLE_MIN_RUN
+RLE_MAX_LITERAL = 0x80
+LZ_WINDOW_BITS = 10
+LZ_LOOKAHEAD_BITS = 8
+LZ_MIN_MATCH = 3      # A 2-byte match costs more bits than two literals
+LZ_CANDIDATES = 16    # Most recent positions tried per 3-byte prefix
+
+PANEL_IDS = {"il0373-2.9": 1}  # Panel::Profile::id (main/panel.cpp)
+
+EPD_WHITE, EPD_BLACK, EPD_RED = 0, 1, 2
+
+# Must match Dither::Mode / IMAGE_DITHER_MODE
+DITHER_MODES = {"none": 0, "floyd": 1, "atkinson": 2, "bayer": 3, "bluenoise": 4}
+
+# Same ink positions as main/dither.cpp: (Y, Cr, color)
+INKS = ((0, 0, EPD_BLACK), (255, 0, EPD_WHITE), (76, 179, EPD_RED))
+
+BAYER4 = ((0, 8, 2, 10), (12, 4, 14, 6), (3, 11, 1, 9), (15, 7, 13, 5))
+
+BLUE_NOISE_SOURCE = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                 "..", "main", "blue_noise.cpp")
+
+
+def blue_noise_mask():
+    """BlueNoise::MASK, read from the generated main/blue_noise.cpp."""
+    with open(BLUE_NOISE_SOURCE) as f:
+        body = f.read().split("MASK[SIZE * SIZE] = {", 1)[1].split("};", 1)[0]
+    values = [int(v) for v in body.replace(",", " ").split()]
+    size = math.isqrt(len(values))
+    return [values[y * size:(y + 1) * size] for y in range(size)]
+
+
+def rgb_to_eink(r, g, b):
+    """ImageLoader::rgbToEinkColor: thresholds taken at the RGB555 cell center."""
+    r, g, b = (r & ~7) + 4, (g & ~7) + 4, (b & ~7) + 4
+    gray = (r * 30 + g * 59 + b * 11) // 100
+    is_red = r > 128 and r > g and r > b
+    if gray < 85:
+        return EPD_BLACK
+    if is_red and gray > 100:
+        return EPD_RED
+    return EPD_WHITE
+
+
+def nearest_ink(y, cr):
+    return min(INKS, key=lambda ink: (y - ink[0]) ** 2 + (cr - ink[1]) ** 2)
+
+
+def dither_rows(rows, mode, off_x=0, off_y=0):
+    """Integer port of Dither::RowDitherer::processRow(); rows start at
+    frame position (off_x, off_y), which only blue noise depends on."""
+    width = len(rows[0]) if rows else 0
+    pad = 2
+    errors = [[[0, 0] for _ in range(width + 2 * pad)] for _ in range(3)]
+    mask = blue_noise_mask() if mode == DITHER_MODES["bluenoise"] else None
+    out = []
+    for y, row in enumerate(rows):
+        colors = [EPD_WHITE] * width
+        if mode == DITHER_MODES["none"]:
+            colors = [rgb_to_eink(*px) for px in row]
+        elif mode == DITHER_MODES["bayer"]:
+            for x, (r, g, b) in enumerate(row):
+                luma = (77 * r + 150 * g + 29 * b) >> 8
+                offset = (BAYER4[y & 3][x & 3] * 2 - 15) * 8
+                colors[x] = nearest_ink(luma + offset, r - luma)[2]
+        elif mode == DITHER_MODES["bluenoise"]:
+            thresholds = mask[(off_y + y) % len(mask)]
+            for x, (r, g, b) in enumerate(row):
+                luma = (77 * r + 150 * g + 29 * b) >> 8
+                offset = int((thresholds[(off_x + x) % len(mask)] - 128) * 15 / 16)
+                colors[x] = nearest_ink(luma + offset, r - luma)[2]
+        else:
+            cur, nxt, aft = (errors[(y + i) % 3] for i in range(3))
+            for x, (r, g, b) in enumerate(row):
+                luma = (77 * r + 150 * g + 29 * b) >> 8
+                cr = r - luma
+                vy = max(0, min(255, luma + cur[x + pad][0]))
+                vcr = max(-179, min(179, cr + cur[x + pad][1]))
+                ink = nearest_ink(vy, vcr)
+                colors[x] = ink[2]
+                ey, ecr = vy - ink[0], vcr - ink[1]
+                if mode == DITHER_MODES["floyd"]:
+                    taps = ((cur, 1, 7), (nxt, -1, 3), (nxt, 0, 5), (nxt, 1, 1))
+                    shift = 4
+                else:
+                    taps = ((cur, 1, 1), (cur, 2, 1), (nxt, -1, 1), (nxt, 0, 1),
+                            (nxt, 1, 1), (aft, 0, 1))
+                    shift = 3
+                for tgt, dx, w in taps:
+                    term = tgt[x + pad + dx]
+                    term[0] += (ey * w) >> shift
+                    term[1] += (ecr * w) >> shift
+            for term in cur:
+                term[0] = term[1] = 0
+        out.append(colors)
+    return out
+
+
+def to_native(x, y, rotation, native_w, native_h):
+    """Logical (rotated) pixel -> native panel pixel, as Adafruit_EPD::drawPixel."""
+    if rotation == 1:
+        x, y = y, x
+        x = native_w - x - 1
+    elif rotation == 2:
+        x = native_w - x - 1
+        y = native_h - y - 1
+    elif rotation == 3:
+        x, y = y, x
+        y = native_h - y - 1
+    return x, y
+
+
+def render(img, width, height, dither, area):
+    """Aspect-fit scale, dither and center, with the device's integer math."""
+    img = img.convert("RGB")
+    src_w, src_h = img.size
+    # Exact ratio num/den, as fitScale() in image_loader.cpp
+    if width * src_h <= height * src_w:
+        num, den = width, src_w
+    else:
+        num, den = height, src_h
+    scaled_w = min(src_w * num // den, width)
+    scaled_h = min(src_h * num // den, height)
+    off_x = (width - scaled_w) // 2
+    off_y = (height - scaled_h) // 2
+    average = area and den > num
+
+    src = img.load()
+    col = [min(x * den // num, src_w) for x in range(scaled_w + 1)]
+    rows = []
+    for y in range(scaled_h):
+        sy0 = min(y * den // num, src_h - 1)
+        if not average:
+            rows.append([src[col[x], sy0] for x in range(scaled_w)])
+            continue
+        sy1 = max(sy0 + 1, min((y + 1) * den // num, src_h))
+        row = []
+        for x in range(scaled_w):
+            sx0, sx1 = col[x], max(col[x] + 1, col[x + 1])
+            box = [src[sx, sy] for sy in range(sy0, sy1) for sx in range(sx0, sx1)]
+            row.append(tuple(sum(px[c] for px in box) // len(box) for c in range(3)))
+        rows.append(row)
+
+    colors = [[EPD_WHITE] * width for _ in range(height)]
+    for y, row in enumerate(dither_rows(rows, dither, off_x, off_y)):
+        colors[off_y + y][off_x:off_x + scaled_w] = row
+    return colors
+
+
+def pack(colors, args):
+    """Pack logical colors into the two framebuffer planes."""
+    native_w, native_h = args.native_width, args.native_height
+    padded_h = (native_h + 7) & ~7
+    plane_size = native_w * native_h // 8
+
+    # clearBuffer() state: every pixel white
+    black = bytearray([0xFF if args.black_inverted else 0x00] * plane_size)
+    color = bytearray([0xFF if args.color_inverted else 0x00] * plane_size)
+
+    for y, row in enumerate(colors):
+        for x, c in enumerate(row):
+            nx, ny = to_native(x, y, args.rotation, native_w, native_h)
+            addr = ((native_w - 1 - nx) * padded_h + ny) // 8
+            mask = 1 << (7 - ny % 8)
+            # set bit = ink unless the plane is inverted
+            black_ink = (c == EPD_BLACK) != args.black_inverted
+            color_ink = (c == EPD_RED) != args.color_inverted
+            black[addr] = (black[addr] | mask) if black_ink else (black[addr] & ~mask)
+            color[addr] = (color[addr] | mask) if color_ink else (color[addr] & ~mask)
+    return black, color
+
+
+def rle_encode(plane):
+    """EPD_ENCODING_RLE: literal runs of up to 128 bytes, repeats of 3-130."""
+    out = bytearray()
+    literal = bytearray()
+
+    def flush():
+        if literal:
+            out.append(len(literal) - 1)
+            out.extend(literal)
+            literal.clear()
+
+    i = 0
+    while i < len(plane):
+        run = 1
+        while i + run < len(plane) and run < RLE_MAX_RUN and plane[i + run] == plane[i]:
+            run += 1
+        if run >= RLE_MIN_RUN:
+            flush()
+            out.append(0x80 + run - RLE_MIN_RUN)
+            out.append(plane[i])
+            i += run
+        else:
+            literal.append(plane[i])
+            i += 1
+            if len(literal) == RLE_MAX_LITERAL:
+                flush()
+    flush()
+    return bytes(out)
+
+
+def lz_encode(plane):
+    """EPD_ENCODING_LZ: heatshrink's LZSS bit stream, greedy matching."""
+    window = 1 << LZ_WINDOW_BITS
+    max_len = 1 << LZ_LOOKAHEAD_BITS
+    # The decoder's window starts zeroed, so matches may reach back into zeros
+    data = bytes(window) + bytes(plane)
+    heads = collections.defaultdict(lambda: collections.deque(maxlen=LZ_CANDIDATES))
+    for p in range(window - LZ_CANDIDATES, window):
+        heads[data[p:p + 3]].append(p)
+
+    acc, nbits, out = 0, 0, bytearray()
+
+    def emit(value, count):
+        nonlocal acc, nbits
+        acc = (acc << count) | value
+        nbits += count
+        while nbits >= 8:
+            nbits -= 8
+            out.append((acc >> nbits) & 0xFF)
+        acc &= (1 << nbits) - 1
+
+    i = window
+    while i < len(data):
+        best_len, best_pos = 0, 0
+        limit = min(max_len, len(data) - i)
+        if limit >= LZ_MIN_MATCH:
+            for p in reversed(heads[data[i:i + 3]]):
+                if i - p > window:
+                    break
+                n = 0
+                while n < limit and data[p + n] == data[i + n]:
+                    n += 1
+                if n > best_len:
+                    best_len, best_pos = n, p
+                    if n == limit:
+                        break
+        if best_len >= LZ_MIN_MATCH:
+            emit(0, 1)
+            emit(i - best_pos - 1, LZ_WINDOW_BITS)
+            emit(best_len - 1, LZ_LOOKAHEAD_BITS)
+            step = best_len
+        else:
+            emit(1, 1)
+            emit(data[i], 8)
+            step = 1
+        for p in range(i, i + step):
+            heads[data[p:p + 3]].append(p)
+        i += step
+    if nbits:
+        emit(0, 8 - nbits)
+    return bytes(out)
+
+
+ENCODERS = {"raw": bytes, "rle": rle_encode, "lz": lz_encode}
+
+
+def rle_decode(stored, size):
+    out = bytearray()
+    i = 0
+    while i < len(stored) and len(out) < size:
+        c = stored[i]
+        if c < 0x80:
+            out.extend(stored[i + 1:i + 2 + c])
+            i += 2 + c
+        else:
+            out.extend(stored[i + 1:i + 2] * (c - 0x80 + RLE_MIN_RUN))
+            i += 2
+    return bytes(out)
+
+
+def lz_decode(stored, size):
+    window = 1 << LZ_WINDOW_BITS
+    out = bytearray(window)  # The zeroed window matches may reach back into
+    bits = "".join(f"{byte:08b}" for byte in stored)
+    i = 0
+    while len(out) < window + size and i < len(bits):
+        if bits[i] == "1":
+            if i + 9 > len(bits):
+                break
+            out.append(int(bits[i + 1:i + 9], 2))
+            i += 9
+        else:
+            if i + 1 + LZ_WINDOW_BITS + LZ_LOOKAHEAD_BITS > len(bits):
+                break
+            offset = int(bits[i + 1:i + 1 + LZ_WINDOW_BITS], 2) + 1
+            count = int(bits[i + 1 + LZ_WINDOW_BITS:i + 1 + LZ_WINDOW_BITS + LZ_LOOKAHEAD_BITS], 2) + 1
+            for _ in range(count):
+                out.append(out[-offset])
+            i += 1 + LZ_WINDOW_BITS + LZ_LOOKAHEAD_BITS
+    return bytes(out[window:window + size])
+
+
+DECODERS = {0: lambda stored, size: bytes(stored[:size]), 1: rle_decode, 2: lz_decode}
+
+
+def encode_planes(planes, encoding):
+    """Planes in the chosen encoding (the smallest one for "auto"): (id, stored planes)."""
+    names = ENCODINGS.keys() if encoding == "auto" else [encoding]
+    candidates = [(name, [ENCODERS[name](bytes(plane)) for plane in planes]) for name in names]
+    name, stored = min(candidates, key=lambda c: sum(len(s) for s in c[1]))
+    return ENCODINGS[name], stored
+
+
+def panel_id(panel):
+    """Panel::Profile::id for a --panel name, or an ID given as a number."""
+    return PANEL_IDS[panel] if isinstance(panel, str) else panel
+
+
+def encode_frame(black, color, args):
+    """Header + planes in the chosen encoding (the smallest one for "auto")."""
+    encoding, stored = encode_planes((black, color), args.encoding)
+    header = struct.pack(HEADER_FORMAT, EPD_IMAGE_MAGIC, EPD_IMAGE_VERSION,
+                         THINKINK_STANDARD, 2, encoding, args.width, args.height,
+                         len(black), len(color), panel_id(args.panel), args.rotation,
+                         len(stored[0]), len(stored[1]))
+    return header + stored[0] + stored[1]
+
+
+def frame_planes(frame):
+    """Header fields and decoded planes of a version 2 .epd frame."""
+    fields = struct.unpack_from(HEADER_FORMAT, frame)
+    if fields[0] != EPD_IMAGE_MAGIC or fields[1] != EPD_IMAGE_VERSION:
+        raise ValueError("not a version 2 .epd frame")
+    plane_count, encoding, sizes, stored = fields[3], fields[4], fields[7:9], fields[11:13]
+    offset = struct.calcsize(HEADER_FORMAT)
+    planes = []
+    for index in range(plane_count):
+        plane = DECODERS[encoding](frame[offset:offset + stored[index]], sizes[index])
+        if len(plane) != sizes[index]:
+            raise ValueError("truncated .epd frame")
+        planes.append(plane)
+        offset += stored[index]
+    return fields, planes
+
+
+def delta_frame(previous, frame, encoding):
+    """frame as an .epd frame of planes to XOR onto previous's, or None when
+    the two differ in panel, rotation or geometry (IMAGE_PACK_FORMAT_DELTA)."""
+    old_fields, old_planes = frame_planes(previous)
+    fields, planes = frame_planes(frame)
+    # Everything but the encoding and stored sizes must match
+    if old_fields[:4] + old_fields[5:11] != fields[:4] + fields[5:11]:
+        return None
+    xored = [bytes(a ^ b for a, b in zip(old, new)) for old, new in zip(old_planes, planes)]
+    encoding_id, stored = encode_planes(xored, encoding)
+    stored += [b""] * (2 - len(stored))
+    header = struct.pack(HEADER_FORMAT, *fields[:4], encoding_id, *fields[5:11],
+                         len(stored[0]), len(stored[1]))
+    return header + stored[0] + stored[1]
+
+
+def frame_bytes(path, args):
+    """A complete .epd file (header + planes) for one source image."""
+    colors = render(Image.open(path), args.width, args.height, DITHER_MODES[args.dither],
+                    args.scale == "area")
+    black, color = pack(colors, args)
+    return encode_frame(black, color, args)
+
+
+def convert(path, args):
+    base = os.path.splitext(os.path.basename(path))[0]
+    out_path = os.path.join(args.output, base + ".epd")
+    with open(out_path, "wb") as f:
+        f.write(frame_bytes(path, args))
+    print(f"{path} -> {out_path}")
+
+
+def add_frame_arguments(parser):
+    """Panel geometry and rendering options, shared with epd_pack.py."""
+    parser.add_argument("--width", type=int, default=128, help="logical width (DISPLAY_WIDTH)")
+    parser.add_argument("--height", type=int, default=296, help="logical height (DISPLAY_HEIGHT)")
+    parser.add_argument("--native-width", type=int, default=296, help="panel width before rotation")
+    parser.add_argument("--native-height", type=int, default=128, help="panel height before rotation")
+    parser.add_argument("--dither", default="floyd", choices=DITHER_MODES.keys(),
+                        help="dithering, as IMAGE_DITHER_MODE (default: floyd)")
+    parser.add_argument("--scale", default="area", choices=("nearest", "area"),
+                        help="resize filter, as IMAGE_SCALE_MODE (default: area)")
+    parser.add_argument("--rotation", type=int, default=1, choices=range(4), help="setRotation() value")
+    parser.add_argument("--panel", default="il0373-2.9", choices=PANEL_IDS.keys(),
+                        help="panel the frame is for, as DISPLAY_PANEL_ID (default: il0373-2.9)")
+    parser.add_argument("--encoding", default="auto", choices=["auto", *ENCODINGS],
+                        help="plane encoding (default: auto, the smallest of raw, rle and lz)")
+    parser.add_argument("--no-black-inverted", dest="black_inverted", action="store_false",
+                        help="black plane is not inverted (IL0373 default: inverted)")
+    parser.add_argument("--no-color-inverted", dest="color_inverted", action="store_false",
+                        help="color plane is not inverted (IL0373 default: inverted)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("inputs", nargs="+", help="source images (any format Pillow reads)")
+    parser.add_argument("-o", "--output", default=".", help="output directory")
+    add_frame_arguments(parser)
+    args = parser.parse_args()
+
+    os.makedirs(args.output, exist_ok=True)
+    for path in args.inputs:
+        convert(path, args)
+
+
+if __name__ == "__main__":
+    main()
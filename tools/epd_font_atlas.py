@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""
+Pre-rasterize fonts into the flash atlases Adafruit_EPD draws text from.
+
+Each atlas is one font at one text size: every glyph scaled as
+Adafruit_GFX::drawChar() would draw it, stored as rows of bits, MSB first,
+each row padded to a byte. That is the layout blitBits() reads, and with the
+slideshow's rotation the layout of the framebuffer planes too. A glyph is
+then eight pixels per store straight from flash, with no rasterizing at
+runtime and no glyph cache RAM (see setFontAtlases()).
+
+An atlas spec is FONT:SIZE, where FONT is "classic" (the built-in 5x7 font,
+printable ASCII) or the path of a GFX font header, and SIZE is a text size
+("2") or a horizontal and vertical one ("2x3").
+
+Usage:
+    tools/epd_font_atlas.py classic:1 classic:2 -o main/font_atlas.cpp
+    tools/epd_font_atlas.py classic:2 \\
+        components/Adafruit_GFX/Fonts/FreeSans9pt7b.h:1 -o main/font_atlas.cpp
+
+The output is a C++ source defining FontAtlas::ATLASES (main/font_atlas.hpp).
+"""
+
+import argparse
+import os
+import re
+
+GLCDFONT = os.path.join(os.path.dirname(__file__), "..", "components", "Adafruit_GFX", "glcdfont.c")
+
+# Classic glyphs kept: printable ASCII, where cp437 doesn't shift anything
+CLASSIC_FIRST = 0x20
+CLASSIC_LAST = 0x7E
+
+
+def fnv1a_font_key(first, last, y_advance, glyphs):
+    """epdFontKey() in Adafruit_EPD.cpp: FNV-1a over the font metrics."""
+    h = 2166136261
+
+    def mix(b):
+        nonlocal h
+        h = ((h ^ (b & 0xFF)) * 16777619) & 0xFFFFFFFF
+
+    mix(first)
+    mix(last)
+    mix(y_advance)
+    for _, width, height, x_advance, x_offset, y_offset in glyphs:
+        for b in (width, height, x_advance, x_offset, y_offset):
+            mix(b)
+    return h or 1
+
+
+def c_numbers(text):
+    """Every integer literal in a C initializer."""
+    return [int(n, 0) for n in re.findall(r"-?0x[0-9A-Fa-f]+|-?\d+", text)]
+
+
+def load_classic():
+    """The classic font as (key, first, last, pixel(c, x, y), glyph box(c))."""
+    with open(GLCDFONT) as f:
+        source = f.read()
+    body = re.search(r"font\[\]\s*PROGMEM\s*=\s*\{(.*?)\};", source, re.S).group(1)
+    data = c_numbers(body)
+
+    def pixel(c, x, y):
+        return (data[c * 5 + x] >> y) & 1
+
+    def box(c):
+        return 5, 8, 0, 0  # width, height, x offset, y offset from the cursor top
+
+    return 0, CLASSIC_FIRST, CLASSIC_LAST, pixel, box
+
+
+def load_gfx(path):
+    """A GFX font header, as load_classic() returns it."""
+    with open(path) as f:
+        source = re.sub(r"//[^\n]*", "", f.read())  # glyph comments quote '{'
+    bitmap = c_numbers(re.search(r"Bitmaps\[\]\s*PROGMEM\s*=\s*\{(.*?)\};", source, re.S).group(1))
+    glyph_body = re.search(r"Glyphs\[\]\s*PROGMEM\s*=\s*\{(.*?)\};", source, re.S).group(1)
+    glyphs = [tuple(c_numbers(g)) for g in re.findall(r"\{([^{}]*)\}", glyph_body)]
+    font = re.search(r"GFXfont\s+\w+\s*PROGMEM\s*=\s*\{(.*?)\};", source, re.S).group(1)
+    first, last, y_advance = c_numbers(font.split(",", 2)[2])[:3]
+    if len(glyphs) != last - first + 1:
+        raise SystemExit(f"{path}: {len(glyphs)} glyphs for 0x{first:02X}-0x{last:02X}")
+
+    def pixel(c, x, y):
+        offset, width = glyphs[c - first][0], glyphs[c - first][1]
+        bit = y * width + x
+        return (bitmap[offset + bit // 8] >> (7 - bit % 8)) & 1
+
+    def box(c):
+        _, width, height, _, x_offset, y_offset = glyphs[c - first]
+        return width, height, x_offset, y_offset
+
+    return fnv1a_font_key(first, last, y_advance, glyphs), first, last, pixel, box
+
+
+def rasterize(pixel, width, height, c, sx, sy):
+    """One glyph scaled by (sx, sy), rows padded to bytes."""
+    out_w, out_h = width * sx, height * sy
+    stride = (out_w + 7) // 8
+    rows = bytearray(stride * out_h)
+    for y in range(out_h):
+        for x in range(out_w):
+            if pixel(c, x // sx, y // sy):
+                rows[y * stride + x // 8] |= 0x80 >> (x % 8)
+    return bytes(rows)
+
+
+def parse_spec(spec):
+    font, _, size = spec.rpartition(":")
+    if not font or not re.fullmatch(r"\d+(x\d+)?", size):
+        raise argparse.ArgumentTypeError(f"{spec}: expected FONT:SIZE or FONT:WxH")
+    sx, _, sy = size.partition("x")
+    sx, sy = int(sx), int(sy or sx)
+    if not 1 <= sx <= 255 or not 1 <= sy <= 255:
+        raise argparse.ArgumentTypeError(f"{spec}: text size out of range")
+    return font, sx, sy
+
+
+def atlas_source(name, font, sx, sy):
+    """C++ definitions of one atlas, and its total bitmap size."""
+    key, first, last, pixel, box = load_classic() if font == "classic" else load_gfx(font)
+    entries, bitmap = [], bytearray()
+    for c in range(first, last + 1):
+        width, height, x_offset, y_offset = box(c)
+        if width * sx > 255 or height * sy > 255:
+            raise SystemExit(f"{font}:{sx}x{sy}: glyph 0x{c:02X} is over 255 pixels")
+        if width == 0 or height == 0:
+            entries.append((0, 0, 0, 0, 0))
+            continue
+        entries.append((len(bitmap), width * sx, height * sy, x_offset * sx, y_offset * sy))
+        bitmap += rasterize(pixel, width, height, c, sx, sy)
+
+    label = "classic" if font == "classic" else os.path.basename(font)
+    lines = [f"// {label} at text size {sx}x{sy}: {len(bitmap)} bytes"]
+    lines.append(f"static const uint8_t {name}_BITMAP[] = {{")
+    for i in range(0, len(bitmap), 16):
+        lines.append("    " + ", ".join(f"0x{b:02X}" for b in bitmap[i:i + 16]) + ",")
+    lines.append("};")
+    lines.append(f"static const epd_atlas_glyph_t {name}_GLYPHS[] = {{")
+    for c, e in zip(range(first, last + 1), entries):
+        lines.append(f"    {{{e[0]}, {e[1]}, {e[2]}, {e[3]}, {e[4]}}}, // 0x{c:02X}")
+    lines.append("};")
+    lines.append(f"static const epd_font_atlas_t {name} = {{")
+    lines.append(f"    0x{key:08X}, {sx}, {sy}, 0x{first:02X}, 0x{last:02X}, {name}_GLYPHS, {name}_BITMAP,")
+    lines.append("};")
+    return "\n".join(lines), len(bitmap)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("atlases", nargs="+", type=parse_spec, metavar="FONT:SIZE",
+                        help='"classic" or a GFX font header, and a text size')
+    parser.add_argument("-o", "--output", required=True, help="C++ source to write")
+    args = parser.parse_args()
+
+    parts, names, total = [], [], 0
+    for i, (font, sx, sy) in enumerate(args.atlases):
+        name = f"ATLAS_{i}"
+        source, size = atlas_source(name, font, sx, sy)
+        parts.append(source)
+        names.append(name)
+        total += size
+
+    specs = [f"{font if font == 'classic' else os.path.basename(font)}:{sx}x{sy}" for font, sx, sy in args.atlases]
+    with open(args.output, "w", newline="\n") as f:
+        f.write("/**\n")
+        f.write(" * @file font_atlas.cpp\n")
+        f.write(" * @brief Generated by tools/epd_font_atlas.py, do not edit\n")
+        f.write(" *\n")
+        f.write(f" * {' '.join(specs)}\n")
+        f.write(" */\n\n")
+        f.write('#include "font_atlas.hpp"\n\n')
+        f.write("\n\n".join(parts))
+        f.write("\n\nconst epd_font_atlas_t* const FontAtlas::ATLASES[] = {\n")
+        for name in names:
+            f.write(f"    &{name},\n")
+        f.write("};\n\n")
+        f.write(f"const uint8_t FontAtlas::COUNT = {len(names)};\n")
+    print(f"{len(names)} atlases, {total} bitmap bytes -> {args.output}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+"""
+Publish slides for the slideshow's Wi-Fi sync (WIFI_SYNC_ENABLED).
+
+Converts the inputs exactly as tools/epd_pack.py does and writes, into one
+directory for any static HTTP server:
+
+    manifest.txt    "EPDM 1", then "<hash> <length> <name>" per slide
+    <hash>.epd      each frame, named by its FNV-1a content hash
+
+With --keyframes N (as epd_pack.py), the manifest is "EPDM 2" and each line
+is "<hash> <length> k|d <name>": "d" frames are deltas onto the slide
+before them.
+
+The device downloads the manifest and only the frames its pack doesn't
+already hold, so re-running this after adding a slide costs one download.
+Frames no longer listed are left in the directory; delete them at will.
+
+Usage:
+    tools/epd_manifest.py photos/*.jpg -o /srv/slides
+    python3 -m http.server -d /srv/slides 8000
+
+Requires Pillow (pip install pillow).
+"""
+
+import argparse
+import os
+
+import epd_convert
+from epd_pack import (IMAGE_PACK_FORMAT_DELTA, MAX_IMAGE_FILES, fnv1a, keyframe_interval,
+                      read_frame, with_deltas)
+
+# Must match parseManifestLine() in main/wifi_sync.cpp
+MANIFEST_HEADER = "EPDM 1"
+MANIFEST_HEADER_DELTAS = "EPDM 2"
+MAX_NAME_LENGTH = 63
+
+
+def manifest_name(path):
+    """The slide's name as the manifest carries it: one word, 63 bytes at most."""
+    name = "_".join(os.path.basename(path).split())
+    return name.encode()[:MAX_NAME_LENGTH].decode(errors="ignore")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("inputs", nargs="+", help="slides in show order (any format Pillow reads, or .epd)")
+    parser.add_argument("-o", "--output", required=True, help="directory to publish into")
+    parser.add_argument("--keyframes", type=keyframe_interval, default=0,
+                        help="publish slides as deltas onto the one before, a whole frame at "
+                             "least every N slides (default: 0, whole frames only)")
+    epd_convert.add_frame_arguments(parser)
+    args = parser.parse_args()
+
+    if len(args.inputs) > MAX_IMAGE_FILES:
+        parser.error(f"at most {MAX_IMAGE_FILES} slides per pack")
+    os.makedirs(args.output, exist_ok=True)
+
+    lines = [MANIFEST_HEADER_DELTAS if args.keyframes else MANIFEST_HEADER]
+    written = 0
+    frames = with_deltas([read_frame(path, args) for path in args.inputs], args.keyframes,
+                         args.encoding)
+    for path, (fmt, frame) in zip(args.inputs, frames):
+        content_hash = fnv1a(frame)
+        frame_path = os.path.join(args.output, f"{content_hash:08x}.epd")
+        if not os.path.exists(frame_path):
+            with open(frame_path, "wb") as f:
+                f.write(frame)
+            written += 1
+        kind = ("d " if fmt == IMAGE_PACK_FORMAT_DELTA else "k ") if args.keyframes else ""
+        lines.append(f"{content_hash:08x} {len(frame)} {kind}{manifest_name(path)}")
+        print(f"{path} -> {frame_path}")
+
+    # Frames first, manifest last: a device syncing meanwhile never sees a
+    # manifest that names a frame not there yet
+    manifest_path = os.path.join(args.output, "manifest.txt")
+    with open(manifest_path + ".tmp", "w", newline="\n") as f:
+        f.write("\n".join(lines) + "\n")
+    os.replace(manifest_path + ".tmp", manifest_path)
+    print(f"{len(args.inputs)} slides, {written} new frames")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+"""
+Bundle slides into a single image pack (SLIDES.PAK) for the slideshow.
+
+A pack is one file: a 16-byte header, an entry table of {offset, length,
+format, name hash}, a 1-bit thumbnail per slide (--thumbnail, for the
+fast-scroll preview), then the frames back to back, each starting on a
+sector boundary. The device keeps the pack open and the table in RAM, so showing
+slide N is one seek instead of opening a file. Most inputs are converted
+exactly as tools/epd_convert.py does; existing .epd files are copied as is.
+
+With --keyframes N, slides that differ little from the one before them
+(a clock face, a chart, a sequence of photos) are stored as a delta: an
+.epd frame of the two frames' planes XORed, far smaller once encoded. At
+least every Nth slide is stored whole, so showing any slide takes at most
+N reads; the device reads delta packs from the card, not the flash mirror.
+
+With --variant (repeated), every slide is rendered once per panel, e.g. for
+a fleet of 2.9" and 4.2" frames sharing one deck: each unit keeps the
+frames made for its own panel ID and never scales or dithers them itself.
+The pack is then version 2, with the variants of a slide next to each
+other in the table.
+
+Usage:
+    tools/epd_pack.py photos/*.jpg -o /path/to/sdcard/SLIDES.PAK
+
+Requires Pillow (pip install pillow).
+"""
+
+import argparse
+import os
+import struct
+
+import epd_convert
+
+# Must match ImagePackHeader / ImagePackEntry / IMAGE_PACK_* in main/sd_card.hpp
+IMAGE_PACK_MAGIC = 0x50445045  # "EPDP"
+IMAGE_PACK_VERSION = 2  # Version 1 when the pack has no variants
+IMAGE_PACK_FORMAT_EPD = 1
+IMAGE_PACK_FORMAT_DELTA = 2
+IMAGE_PACK_MAX_VARIANTS = 8
+HEADER_FORMAT = "<IBBBBII"
+ENTRY_FORMAT = "<IIBB2xI"
+
+MAX_IMAGE_FILES = 4096  # config.hpp; larger packs are rejected at boot
+
+
+def fnv1a(data):
+    """32-bit FNV-1a, the hash the firmware's frame cache keys use."""
+    h = 2166136261
+    for byte in data:
+        h = ((h ^ byte) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def thumbnail(path, args):
+    """1-bit thumbnail, set bits for ink, rows MSB first and padded to bytes.
+
+    Rendered from the source image like a frame, with red as ink. An .epd
+    input has no source image and gets a blank one.
+    """
+    width, height = args.thumbnail
+    row_bytes = (width + 7) // 8
+    out = bytearray(row_bytes * height)
+    if path.lower().endswith(".epd"):
+        print(f"{path}: no source image, blank thumbnail")
+        return bytes(out)
+    colors = epd_convert.render(epd_convert.Image.open(path), width, height,
+                                epd_convert.DITHER_MODES[args.dither], args.scale == "area")
+    for y, row in enumerate(colors):
+        for x, color in enumerate(row):
+            if color != epd_convert.EPD_WHITE:
+                out[y * row_bytes + x // 8] |= 0x80 >> (x % 8)
+    return bytes(out)
+
+
+def thumbnail_size(text):
+    try:
+        width, height = (int(v) for v in text.lower().split("x"))
+    except ValueError:
+        raise argparse.ArgumentTypeError("expected WIDTHxHEIGHT, e.g. 32x74")
+    if not (0 <= width <= 255 and 0 <= height <= 255) or (width == 0) != (height == 0):
+        raise argparse.ArgumentTypeError("each side 1..255, or 0x0 for none")
+    return width, height
+
+
+def read_frame(path, args):
+    if path.lower().endswith(".epd"):
+        with open(path, "rb") as f:
+            data = f.read()
+        if len(data) < struct.calcsize(epd_convert.HEADER_FORMAT) or \
+                struct.unpack_from("<I", data)[0] != epd_convert.EPD_IMAGE_MAGIC:
+            raise SystemExit(f"{path}: not an .epd file")
+        return data
+    return epd_convert.frame_bytes(path, args)
+
+
+def with_deltas(frames, keyframes, encoding):
+    """(format, data) per frame: a delta onto the frame before it where that
+    is smaller, with a keyframe at least every keyframes frames (0: none)."""
+    stored = []
+    chain = 0
+    for index, frame in enumerate(frames):
+        delta = None
+        if keyframes and 0 < index and chain < keyframes:
+            delta = epd_convert.delta_frame(frames[index - 1], frame, encoding)
+        if delta is not None and len(delta) < len(frame):
+            stored.append((IMAGE_PACK_FORMAT_DELTA, delta))
+            chain += 1
+        else:
+            stored.append((IMAGE_PACK_FORMAT_EPD, frame))
+            chain = 1
+    return stored
+
+
+def variant(text):
+    """--variant PANEL:WIDTHxHEIGHT[:ROTATION], PANEL a --panel name or an ID."""
+    parts = text.split(":")
+    try:
+        if len(parts) not in (2, 3):
+            raise ValueError
+        panel = parts[0] if parts[0] in epd_convert.PANEL_IDS else int(parts[0])
+        width, height = (int(v) for v in parts[1].lower().split("x"))
+        rotation = int(parts[2]) if len(parts) == 3 else 1
+    except ValueError:
+        raise argparse.ArgumentTypeError("expected PANEL:WIDTHxHEIGHT[:ROTATION], e.g. 3:400x300:0")
+    if not (isinstance(panel, str) or 1 <= panel <= 255) or width < 1 or height < 1 or \
+            rotation not in range(4):
+        raise argparse.ArgumentTypeError("panel ID 1..255, a positive size and rotation 0..3")
+    return panel, width, height, rotation
+
+
+def variant_args(args, spec):
+    """args with a variant's panel, logical size and rotation (the native
+    size follows: swapped for rotations 1 and 3)."""
+    panel, width, height, rotation = spec
+    native = (height, width) if rotation % 2 else (width, height)
+    return argparse.Namespace(**{**vars(args), "panel": panel, "width": width, "height": height,
+                                 "rotation": rotation, "native_width": native[0],
+                                 "native_height": native[1]})
+
+
+def keyframe_interval(text):
+    value = int(text)
+    if value < 0:
+        raise argparse.ArgumentTypeError("0 for no deltas, or a positive interval")
+    return value
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("inputs", nargs="+", help="slides in show order (any format Pillow reads, or .epd)")
+    parser.add_argument("-o", "--output", default="SLIDES.PAK", help="pack file (default: SLIDES.PAK)")
+    parser.add_argument("--align", type=int, default=512,
+                        help="start every frame on a multiple of this many bytes (default: 512, one sector)")
+    parser.add_argument("--thumbnail", type=thumbnail_size, default=(32, 74),
+                        help="thumbnail size WIDTHxHEIGHT, 0x0 for none (default: 32x74)")
+    parser.add_argument("--keyframes", type=keyframe_interval, default=0,
+                        help="store slides as deltas onto the one before, a whole frame at least "
+                             "every N slides (default: 0, whole frames only)")
+    parser.add_argument("--variant", type=variant, action="append", default=[],
+                        metavar="PANEL:WxH[:ROT]",
+                        help="also render every slide for this panel ID, logical size and "
+                             "rotation (default rotation: 1); repeat for each panel of a fleet")
+    epd_convert.add_frame_arguments(parser)
+    args = parser.parse_args()
+
+    if len(args.inputs) > MAX_IMAGE_FILES:
+        parser.error(f"at most {MAX_IMAGE_FILES} slides per pack")
+    if args.align < 1:
+        parser.error("--align must be positive")
+    if len(args.variant) > IMAGE_PACK_MAX_VARIANTS:
+        parser.error(f"at most {IMAGE_PACK_MAX_VARIANTS} variants")
+    if args.variant and any(path.lower().endswith(".epd") for path in args.inputs):
+        parser.error("--variant renders every slide from its source image; .epd inputs can't be used")
+
+    # One stream of frames per variant (panel 0: the --panel frame any unit may show),
+    # deltas within a stream
+    variants = [(0, args)] if not args.variant else \
+        [(epd_convert.panel_id(spec[0]), variant_args(args, spec)) for spec in args.variant]
+    streams = [with_deltas([read_frame(path, vargs) for path in args.inputs], args.keyframes,
+                           args.encoding) for _, vargs in variants]
+    thumbs = b"".join(thumbnail(path, args) for path in args.inputs) if args.thumbnail[0] else b""
+
+    header_size = struct.calcsize(HEADER_FORMAT)
+    entry_size = struct.calcsize(ENTRY_FORMAT)
+    count = len(args.inputs) * len(variants)
+
+    def aligned(offset):
+        return (offset + args.align - 1) // args.align * args.align
+
+    # Each slide's variants next to each other, in table and file
+    stored = [(index, panel, stream[index]) for index in range(len(args.inputs))
+              for (panel, _), stream in zip(variants, streams)]
+    entries = []
+    offset = aligned(header_size + entry_size * count + len(thumbs))
+    for index, panel, (fmt, frame) in stored:
+        name = os.path.basename(args.inputs[index]).encode()
+        entries.append(struct.pack(ENTRY_FORMAT, offset, len(frame), fmt, panel, fnv1a(name)))
+        offset = aligned(offset + len(frame))
+
+    version = IMAGE_PACK_VERSION if args.variant else 1
+    with open(args.output, "wb") as f:
+        f.write(struct.pack(HEADER_FORMAT, IMAGE_PACK_MAGIC, version, *args.thumbnail,
+                            len(args.variant), count, header_size))
+        f.write(b"".join(entries))
+        f.write(thumbs)
+        for index, panel, (fmt, frame) in stored:
+            f.write(b"\0" * (aligned(f.tell()) - f.tell()))
+            f.write(frame)
+            kind = " (delta)" if fmt == IMAGE_PACK_FORMAT_DELTA else ""
+            target = f" for panel {panel}" if args.variant else ""
+            print(f"{args.inputs[index]} -> {args.output}#{index}{target}{kind}")
+    print(f"{len(args.inputs)} slides, {len(variants)} variant(s), "
+          f"{os.path.getsize(args.output)} bytes")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,571 @@
+/**
+ * @file bmp_bench.cpp
+ * @brief Host benchmark of the BMP decode pipeline (decode, scale, dither, pack)
+ *
+ * Runs ImageDecode::decodeBMP() on each file a number of times into a sink
+ * that packs the two framebuffer planes the way the display does (IL0373:
+ * THINKINK_STANDARD layout, both planes inverted), and prints per file:
+ *
+ *   file  WxH bpp  min/avg ms  source Mpx/s  read/decode/pack avg ms  plane hash
+ *
+ * The hash is FNV-1a over both planes, so an optimization that changes the
+ * output shows up as a different hash for the same file and options. With
+ * --palette acep rows are quantized to the 7 ACeP inks instead and packed
+ * two 4-bit pixels per byte, as Adafruit_ACEP spans are written. With
+ * --palette gray4 they are quantized to the four grays and packed into the
+ * planes with the 2.9" grayscale panel's layer colors.
+ *
+ * With --sim the packed planes are then sent to a simulated controller
+ * (epd_sim.hpp) the way the driver sends them, at the configured SPI
+ * clocks, and a second line gives the upload and refresh time and decode to
+ * glass: how long the slide takes from file to panel. --png saves what the
+ * simulated glass shows after the refresh, PREFIX000.png for the first file.
+ *
+ * --workers 2 installs a stripe runner with a helper thread, as DitherPool
+ * does on the device, so the stateless dither modes (bayer, bluenoise) are
+ * dithered a band at a time on two threads; the hash must not change.
+ *
+ * Usage:
+ *   bmp_bench [--repeat N] [--dither none|floyd|atkinson|bayer|bluenoise]
+ *             [--scale nearest|area] [--palette tricolor|acep|gray4]
+ *             [--sink planes|null] [--sim il0373|ssd1680 [--png PREFIX]]
+ *             [--workers 1|2] [--verbose] file.bmp...
+ */
+
+#include "image_decode.hpp"
+#include "image_loader.hpp"
+#include "slide_stats.hpp"
+#include "slide_arena.hpp"
+#include "config.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "epd_sim.hpp"
+#include "stripe_queue.hpp"
+#include "../../components/Adafruit_EPD/src/EPDColors.h"
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <condition_variable>
+#include <initializer_list>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+constexpr size_t PLANE_SIZE = DISPLAY_NATIVE_WIDTH * DISPLAY_NATIVE_HEIGHT / 8;
+constexpr int16_t PADDED_HEIGHT = (DISPLAY_NATIVE_HEIGHT + 7) & ~7;
+
+// Plane bits per EPD color ({color, black}), as the panels' layer_colors:
+// SLIDESHOW_PANEL, and ThinkInk_290_Grayscale4_T5 in THINKINK_GRAYSCALE4
+constexpr uint8_t TRICOLOR_LAYERS[EPD_NUM_COLORS] = { 0b00, 0b01, 0b10, 0b10, 0b01, 0b10, 0b00 };
+constexpr uint8_t GRAY4_LAYERS[EPD_NUM_COLORS] = { 0b00, 0b11, 0b01, 0b10, 0b10, 0b01, 0b00 };
+
+/**
+ * @brief A sink that keeps the frame, to hash it
+ */
+class FrameSink : public ImageDecode::PlaneSink {
+public:
+    virtual uint32_t hash() const = 0;
+
+protected:
+    static uint32_t fnv1a(uint32_t h, const uint8_t* data, size_t len)
+    {
+        for (size_t i = 0; i < len; i++) {
+            h = (h ^ data[i]) * 16777619u;
+        }
+        return h;
+    }
+};
+
+/**
+ * @brief Packs spans into two framebuffer planes like Adafruit_EPD::writeSpan()
+ */
+class PlanesSink : public FrameSink {
+public:
+    explicit PlanesSink(const uint8_t* layers)
+        : layers_(layers)
+    {
+    }
+
+    void begin() override
+    {
+        // clearBuffer() on inverted planes: every bit set is white
+        memset(black_, 0xFF, sizeof(black_));
+        memset(color_, 0xFF, sizeof(color_));
+    }
+
+    void writeSpan(int16_t x, int16_t y, const uint8_t* colors, int16_t len) override
+    {
+        for (int16_t i = 0; i < len; i++) {
+            int16_t nx;
+            int16_t ny;
+            toNative(x + i, y, nx, ny);
+            size_t addr = (static_cast<size_t>(DISPLAY_NATIVE_WIDTH - 1 - nx) * PADDED_HEIGHT + ny) / 8;
+            uint8_t mask = static_cast<uint8_t>(1u << (7 - ny % 8));
+            uint8_t layers = layers_[colors[i]];
+            setBit(black_[addr], mask, !(layers & 0x1));
+            setBit(color_[addr], mask, !(layers & 0x2));
+        }
+    }
+
+    /** @brief The fused kernels' path, when logical rows lie along the bytes */
+    bool openRun(int16_t x, int16_t y, int16_t len, ImageDecode::PlaneRun& run) override
+    {
+        int32_t first = bitIndex(x, y);
+        int32_t step = bitIndex(x + 1, y) - first;
+        if (step != 1 && step != -1) {
+            return false;
+        }
+        run.black = black_;
+        run.color = color_;
+        run.bit = static_cast<uint32_t>(step > 0 ? first : bitIndex(x + len - 1, y));
+        run.reversed = step < 0;
+        run.blackInks = 0;
+        run.colorInks = 0;
+        for (uint8_t c = 0; c < EPD_NUM_COLORS; c++) {
+            run.blackInks |= (layers_[c] & 0x1) ? 0 : 1 << c;
+            run.colorInks |= (layers_[c] & 0x2) ? 0 : 1 << c;
+        }
+        return true;
+    }
+
+    /** @brief The planes, in the IL0373's RAM order */
+    const uint8_t* black() const { return black_; }
+    const uint8_t* color() const { return color_; }
+
+    /** @brief FNV-1a over both planes */
+    uint32_t hash() const override
+    {
+        return fnv1a(fnv1a(2166136261u, black_, sizeof(black_)), color_, sizeof(color_));
+    }
+
+private:
+    /** @brief Logical (rotated) pixel -> native panel pixel, as Adafruit_EPD::drawPixel() */
+    static void toNative(int16_t x, int16_t y, int16_t& nx, int16_t& ny)
+    {
+        switch (DISPLAY_ROTATION) {
+        case 1:
+            nx = DISPLAY_NATIVE_WIDTH - 1 - y;
+            ny = x;
+            break;
+        case 2:
+            nx = DISPLAY_NATIVE_WIDTH - 1 - x;
+            ny = DISPLAY_NATIVE_HEIGHT - 1 - y;
+            break;
+        case 3:
+            nx = y;
+            ny = DISPLAY_NATIVE_HEIGHT - 1 - x;
+            break;
+        default:
+            nx = x;
+            ny = y;
+            break;
+        }
+    }
+
+    /** @brief Plane bit of a logical pixel */
+    static int32_t bitIndex(int16_t x, int16_t y)
+    {
+        int16_t nx;
+        int16_t ny;
+        toNative(x, y, nx, ny);
+        return (DISPLAY_NATIVE_WIDTH - 1 - nx) * PADDED_HEIGHT + ny;
+    }
+
+    static void setBit(uint8_t& byte, uint8_t mask, bool set)
+    {
+        byte = set ? (byte | mask) : (byte & ~mask);
+    }
+
+    const uint8_t* layers_;
+    uint8_t black_[PLANE_SIZE];
+    uint8_t color_[PLANE_SIZE];
+};
+
+/**
+ * @brief Packs ACeP ink codes two per byte, high nibble first, in logical
+ *        rows (the 7-color panel's layout at rotation 0)
+ */
+class NibbleSink : public FrameSink {
+public:
+    void begin() override
+    {
+        memset(pixels_, 0x11, sizeof(pixels_));  // ACEP_COLOR_WHITE
+    }
+
+    void writeSpan(int16_t x, int16_t y, const uint8_t* colors, int16_t len) override
+    {
+        for (int16_t i = 0; i < len; i++) {
+            size_t pixel = static_cast<size_t>(y) * DISPLAY_WIDTH + x + i;
+            uint8_t shift = pixel % 2 ? 0 : 4;
+            uint8_t& byte = pixels_[pixel / 2];
+            byte = static_cast<uint8_t>((byte & ~(0xF << shift)) | ((colors[i] & 0xF) << shift));
+        }
+    }
+
+    uint32_t hash() const override
+    {
+        return fnv1a(2166136261u, pixels_, sizeof(pixels_));
+    }
+
+private:
+    uint8_t pixels_[(DISPLAY_WIDTH * DISPLAY_HEIGHT + 1) / 2];
+};
+
+/**
+ * @brief Discards every span, to time decoding without packing
+ */
+class NullSink : public ImageDecode::PlaneSink {
+public:
+    void begin() override {}
+    void writeSpan(int16_t, int16_t, const uint8_t*, int16_t) override {}
+};
+
+/**
+ * @brief Host stand-in for DitherPool: a helper thread that shares each
+ *        band's stripes with the benchmark's thread through a StripeQueue
+ */
+struct HostPool {
+    StripeQueue queue;
+    std::mutex lock;
+    std::condition_variable wake;
+    uint64_t job = 0;  // Bumped for each run
+    bool helperDone = true;
+    void (*work)(void* ctx, size_t index) = nullptr;
+    void* ctx = nullptr;
+
+    void drain(size_t worker)
+    {
+        uint16_t index;
+        while (queue.next(worker, index)) {
+            work(ctx, index);
+        }
+    }
+
+    void helper()
+    {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> guard(lock);
+        for (;;) {
+            wake.wait(guard, [&] { return job != seen; });
+            seen = job;
+            guard.unlock();
+            drain(1);
+            guard.lock();
+            helperDone = true;
+            wake.notify_all();
+        }
+    }
+};
+
+// Never destroyed: the helper still waits on it at exit
+HostPool& g_pool = *new HostPool;
+
+/**
+ * @brief ImageDecode::StripeRunner on this thread and g_pool's helper
+ */
+void runStripes(size_t count, void (*work)(void* ctx, size_t index), void* ctx)
+{
+    {
+        std::lock_guard<std::mutex> guard(g_pool.lock);
+        g_pool.work = work;
+        g_pool.ctx = ctx;
+        g_pool.queue.reset(static_cast<uint16_t>(count));
+        g_pool.helperDone = false;
+        g_pool.job++;
+    }
+    g_pool.wake.notify_all();
+    g_pool.drain(0);
+    std::unique_lock<std::mutex> guard(g_pool.lock);
+    g_pool.wake.wait(guard, [] { return g_pool.helperDone; });
+}
+
+struct Options {
+    int repeat = SLIDE_STATS_HISTORY;
+    bool nullSink = false;
+    bool sim = false;
+    EpdSim::Controller controller = EpdSim::Controller::IL0373;
+    const char* pngPrefix = nullptr;
+};
+
+bool parseDither(const char* name, Dither::Mode& mode)
+{
+    static const char* const names[] = {"none", "floyd", "atkinson", "bayer", "bluenoise"};
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcmp(name, names[i]) == 0) {
+            mode = static_cast<Dither::Mode>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void usage()
+{
+    fprintf(stderr,
+            "usage: bmp_bench [--repeat N] [--dither none|floyd|atkinson|bayer|bluenoise]\n"
+            "                 [--scale nearest|area] [--palette tricolor|acep|gray4]\n"
+            "                 [--tone gamma[,contrast[,brightness]]]\n"
+            "                 [--sink planes|null] [--sim il0373|ssd1680 [--png PREFIX]]\n"
+            "                 [--workers 1|2] [--verbose] file.bmp...\n");
+}
+
+double stageMs(const SlideStats::Summary& summary, SlideStats::Stage stage)
+{
+    return summary.stages[static_cast<size_t>(stage)].avgUs / 1000.0;
+}
+
+void simCommand(EpdSim::Panel& panel, uint8_t cmd, std::initializer_list<uint8_t> args)
+{
+    panel.command(cmd, args.begin(), args.size(), EINK_SPI_COMMAND_HZ);
+}
+
+/**
+ * @brief Send a frame to a simulated panel as its driver does: power up,
+ *        both planes, a full refresh, power down
+ * @param uploadUs Set to the time from power up to the refresh command
+ * @return Time the refresh held BUSY
+ */
+int64_t simulateFrame(EpdSim::Panel& panel, EpdSim::Controller controller,
+                      const PlanesSink& planes, int64_t& uploadUs)
+{
+    constexpr uint8_t ROW_BYTES = PADDED_HEIGHT / 8;
+    int64_t start = panel.nowUs();
+    int64_t refreshUs;
+    if (controller == EpdSim::Controller::IL0373) {
+        // Adafruit_IL0373::powerUp()
+        simCommand(panel, 0x01, { 0x03, 0x00, 0x2B, 0x2B, 0x09 });
+        simCommand(panel, 0x06, { 0x17, 0x17, 0x17 });
+        simCommand(panel, 0x04, {});
+        panel.waitBusy();
+        simCommand(panel, 0x00, { 0xCF });
+        simCommand(panel, 0x50, { 0x37 });
+        simCommand(panel, 0x30, { 0x29 });
+        simCommand(panel, 0x61,
+                   { ROW_BYTES * 8, DISPLAY_NATIVE_WIDTH >> 8, DISPLAY_NATIVE_WIDTH & 0xFF });
+        simCommand(panel, 0x82, { 0x0A });
+        panel.command(0x10, planes.black(), PLANE_SIZE, EINK_SPI_DATA_HZ);
+        panel.command(0x13, planes.color(), PLANE_SIZE, EINK_SPI_DATA_HZ);
+        uploadUs = panel.nowUs() - start;
+        simCommand(panel, 0x12, {});
+        refreshUs = panel.waitBusy();
+        simCommand(panel, 0x02, {});
+        panel.waitBusy();
+        simCommand(panel, 0x07, { 0xA5 });
+    } else {
+        // Adafruit_SSD1680: the red RAM is set where red shows, so the
+        // inverted color plane goes out inverted back
+        static uint8_t red[PLANE_SIZE];
+        for (size_t i = 0; i < PLANE_SIZE; i++) {
+            red[i] = static_cast<uint8_t>(~planes.color()[i]);
+        }
+        uint16_t lastGate = DISPLAY_NATIVE_WIDTH - 1;
+        simCommand(panel, 0x12, {});
+        panel.waitBusy();
+        simCommand(panel, 0x11, { 0x03 });
+        simCommand(panel, 0x44, { 0x00, ROW_BYTES - 1 });
+        simCommand(panel, 0x45,
+                   { 0x00, 0x00, static_cast<uint8_t>(lastGate), static_cast<uint8_t>(lastGate >> 8) });
+        simCommand(panel, 0x4E, { 0x00 });
+        simCommand(panel, 0x4F, { 0x00, 0x00 });
+        panel.command(0x24, planes.black(), PLANE_SIZE, EINK_SPI_DATA_HZ);
+        simCommand(panel, 0x4E, { 0x00 });
+        simCommand(panel, 0x4F, { 0x00, 0x00 });
+        panel.command(0x26, red, PLANE_SIZE, EINK_SPI_DATA_HZ);
+        uploadUs = panel.nowUs() - start;
+        simCommand(panel, 0x22, { 0xF7 });
+        simCommand(panel, 0x20, {});
+        refreshUs = panel.waitBusy();
+        simCommand(panel, 0x10, { 0x01 });
+    }
+    return refreshUs;
+}
+
+/**
+ * @brief Benchmark one file
+ * @return false if it could not be opened or decoded
+ */
+bool benchFile(const char* path, size_t index, const Options& options, ImageDecode::PlaneSink& sink,
+               const FrameSink* frame)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return false;
+    }
+
+    ImageLoader::BMPHeader header = {};
+    if (fread(&header, 1, sizeof(header), file) != sizeof(header)) {
+        fprintf(stderr, "%s: not a BMP\n", path);
+        fclose(file);
+        return false;
+    }
+    uint64_t pixels = static_cast<uint64_t>(std::abs(header.width)) * std::abs(header.height);
+
+    int64_t minUs = INT64_MAX;
+    int64_t totalUs = 0;
+    bool ok = true;
+    for (int run = 0; run < options.repeat && ok; run++) {
+        SlideStats::begin(index);
+        int64_t start = esp_timer_get_time();
+        {
+            // As ImageLoader times it; READ and PACK nest inside
+            SlideArena::Scope arena;
+            SlideStats::Timer timer(SlideStats::Stage::DECODE);
+            ok = ImageDecode::decodeBMP(file, sink);
+        }
+        int64_t us = esp_timer_get_time() - start;
+        SlideStats::end();
+        minUs = std::min(minUs, us);
+        totalUs += us;
+    }
+    fclose(file);
+    if (!ok) {
+        fprintf(stderr, "%s: decode failed\n", path);
+        return false;
+    }
+
+    double avgMs = totalUs / 1000.0 / options.repeat;
+    SlideStats::Summary summary;
+    SlideStats::summarize(summary);
+
+    char size[32];
+    snprintf(size, sizeof(size), "%" PRId32 "x%" PRId32 " %u", std::abs(header.width),
+             std::abs(header.height), static_cast<unsigned>(header.bitsPerPixel));
+    printf("%-32s %-16s %9.3f %9.3f %9.2f %8.3f %8.3f %8.3f  %08" PRIx32 "\n", path, size,
+           minUs / 1000.0, avgMs, avgMs > 0 ? pixels / (avgMs * 1000.0) : 0.0,
+           stageMs(summary, SlideStats::Stage::READ), stageMs(summary, SlideStats::Stage::DECODE),
+           stageMs(summary, SlideStats::Stage::PACK), frame ? frame->hash() : 0);
+
+    if (options.sim) {
+        static const char* const kinds[] = { "full", "fast", "partial" };
+        EpdSim::Panel panel(options.controller, PADDED_HEIGHT, DISPLAY_NATIVE_WIDTH, EpdSim::Timing());
+        int64_t uploadUs = 0;
+        int64_t refreshUs = simulateFrame(panel, options.controller,
+                                          *static_cast<const PlanesSink*>(frame), uploadUs);
+        const EpdSim::Stats& stats = panel.stats();
+        printf("  sim: upload %.3f ms (%" PRIu32 " transactions, %" PRIu64
+               " bytes), refresh %s %.1f ms, decode to glass %.1f ms\n",
+               uploadUs / 1000.0, stats.transactions, stats.bytes, kinds[panel.lastRefresh()],
+               refreshUs / 1000.0, avgMs + (uploadUs + refreshUs) / 1000.0);
+        if (options.pngPrefix) {
+            char png[512];
+            snprintf(png, sizeof(png), "%s%03zu.png", options.pngPrefix, index);
+            if (!panel.writePng(png)) {
+                fprintf(stderr, "%s: cannot write\n", png);
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    int first = argc;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(arg, "--repeat") == 0 && value) {
+            options.repeat = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--dither") == 0 && value) {
+            Dither::Mode mode;
+            if (!parseDither(value, mode)) {
+                usage();
+                return 2;
+            }
+            ImageLoader::setDitherMode(mode);
+            i++;
+        } else if (strcmp(arg, "--scale") == 0 && value) {
+            ImageLoader::setScaleMode(strcmp(value, "nearest") == 0 ? ImageLoader::ScaleMode::NEAREST
+                                                                   : ImageLoader::ScaleMode::AREA);
+            i++;
+        } else if (strcmp(arg, "--palette") == 0 && value) {
+            Dither::Palette palette = Dither::Palette::TRICOLOR;
+            if (strcmp(value, "acep") == 0) {
+                palette = Dither::Palette::ACEP7;
+            } else if (strcmp(value, "gray4") == 0) {
+                palette = Dither::Palette::GRAY4;
+            }
+            ImageLoader::setPalette(palette);
+            i++;
+        } else if (strcmp(arg, "--tone") == 0 && value) {
+            int gamma = 100;
+            int contrast = 0;
+            int brightness = 0;
+            if (sscanf(value, "%d,%d,%d", &gamma, &contrast, &brightness) < 1) {
+                usage();
+                return 2;
+            }
+            ImageLoader::setTone({static_cast<uint16_t>(gamma), static_cast<int8_t>(contrast),
+                                  static_cast<int8_t>(brightness)});
+            i++;
+        } else if (strcmp(arg, "--sink") == 0 && value) {
+            options.nullSink = strcmp(value, "null") == 0;
+            i++;
+        } else if (strcmp(arg, "--sim") == 0 && value) {
+            options.sim = true;
+            options.controller = strcmp(value, "ssd1680") == 0 ? EpdSim::Controller::SSD168X
+                                                                : EpdSim::Controller::IL0373;
+            i++;
+        } else if (strcmp(arg, "--png") == 0 && value) {
+            options.pngPrefix = value;
+            i++;
+        } else if (strcmp(arg, "--workers") == 0 && value) {
+            if (atoi(value) > 1) {
+                std::thread([] { g_pool.helper(); }).detach();
+                ImageDecode::setStripeRunner(runStripes);
+            }
+            i++;
+        } else if (strcmp(arg, "--verbose") == 0) {
+            g_hostLogLevel = ESP_LOG_INFO;
+        } else if (arg[0] == '-') {
+            usage();
+            return 2;
+        } else {
+            first = i;
+            break;
+        }
+    }
+    if (first == argc) {
+        usage();
+        return 2;
+    }
+    if (options.sim && (options.nullSink || ImageLoader::getPalette() == Dither::Palette::ACEP7)) {
+        fprintf(stderr, "--sim needs the planes sink and a two-plane palette\n");
+        return 2;
+    }
+
+    // The stage split is a SlideStats summary, which covers the last
+    // SLIDE_STATS_HISTORY runs: run at least that many so it is this file's
+    options.repeat = std::max<int>(options.repeat, SLIDE_STATS_HISTORY);
+
+    SlideStats::init();
+    SlideArena::init(SLIDE_ARENA_SIZE);
+    static PlanesSink planes(ImageLoader::getPalette() == Dither::Palette::GRAY4 ? GRAY4_LAYERS
+                                                                              : TRICOLOR_LAYERS);
+    static NibbleSink nibbles;
+    NullSink null;
+    FrameSink* frame = nullptr;
+    if (!options.nullSink) {
+        frame = ImageLoader::getPalette() == Dither::Palette::ACEP7
+                    ? static_cast<FrameSink*>(&nibbles)
+                    : &planes;
+    }
+    ImageDecode::PlaneSink& sink = frame ? static_cast<ImageDecode::PlaneSink&>(*frame) : null;
+
+    printf("%-32s %-16s %9s %9s %9s %8s %8s %8s  %s\n", "file", "size bpp", "min ms", "avg ms",
+           "Mpx/s", "read", "decode", "pack", "hash");
+    int failures = 0;
+    for (int i = first; i < argc; i++) {
+        if (!benchFile(argv[i], static_cast<size_t>(i - first), options, sink, frame)) {
+            failures++;
+        }
+    }
+    return failures ? 1 : 0;
+}
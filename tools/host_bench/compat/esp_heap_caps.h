@@ -0,0 +1,41 @@
+/**
+ * @file esp_heap_caps.h
+ * @brief Host stand-in for the heap capability API
+ *
+ * The host heap has no fixed size to report, so the readings are constant
+ * and large enough that SlideStats never raises a memory alarm.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+
+constexpr size_t HOST_HEAP_SIZE = 1024 * 1024;
+
+inline size_t heap_caps_get_free_size(uint32_t)
+{
+    return HOST_HEAP_SIZE;
+}
+
+inline size_t heap_caps_get_largest_free_block(uint32_t)
+{
+    return HOST_HEAP_SIZE;
+}
+
+inline size_t heap_caps_get_minimum_free_size(uint32_t)
+{
+    return HOST_HEAP_SIZE;
+}
+
+inline int heap_caps_monitor_local_minimum_free_size_start()
+{
+    return 0;
+}
+
+inline int heap_caps_monitor_local_minimum_free_size_stop()
+{
+    return 0;
+}
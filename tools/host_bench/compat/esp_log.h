@@ -0,0 +1,32 @@
+/**
+ * @file esp_log.h
+ * @brief Host stand-in for ESP-IDF logging: printf to stderr, filtered by level
+ */
+
+#pragma once
+
+#include <cstdio>
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+/** @brief Messages above this level are dropped (the benchmark sets it) */
+inline esp_log_level_t g_hostLogLevel = ESP_LOG_WARN;
+
+#define HOST_LOG(level, letter, tag, fmt, ...)                                  \
+    do {                                                                        \
+        if ((level) <= g_hostLogLevel) {                                        \
+            fprintf(stderr, letter " (%s): " fmt "\n", tag, ##__VA_ARGS__);     \
+        }                                                                       \
+    } while (0)
+
+#define ESP_LOGE(tag, fmt, ...) HOST_LOG(ESP_LOG_ERROR, "E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) HOST_LOG(ESP_LOG_WARN, "W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) HOST_LOG(ESP_LOG_INFO, "I", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) HOST_LOG(ESP_LOG_DEBUG, "D", tag, fmt, ##__VA_ARGS__)
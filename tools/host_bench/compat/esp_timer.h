@@ -0,0 +1,16 @@
+/**
+ * @file esp_timer.h
+ * @brief Host stand-in for esp_timer_get_time(): monotonic microseconds
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+
+inline int64_t esp_timer_get_time()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
@@ -0,0 +1,24 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Host stand-in for FreeRTOS: the benchmark is single-threaded
+ */
+
+#pragma once
+
+#include <cstdint>
+
+typedef uint32_t TickType_t;
+
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFu)
+#define pdTRUE 1
+
+// Critical sections: nothing to exclude with one thread
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+
+inline int xPortGetCoreID()
+{
+    return 0;
+}
@@ -0,0 +1,26 @@
+/**
+ * @file semphr.h
+ * @brief Host stand-in for FreeRTOS mutexes: no-ops, single-threaded
+ */
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef void* SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    static int token;
+    return &token;
+}
+
+inline int xSemaphoreTake(SemaphoreHandle_t, TickType_t)
+{
+    return pdTRUE;
+}
+
+inline int xSemaphoreGive(SemaphoreHandle_t)
+{
+    return pdTRUE;
+}
@@ -0,0 +1,29 @@
+/**
+ * @file task.h
+ * @brief Host stand-in for the FreeRTOS task API SlideStats and
+ *        PipelineTrace use
+ */
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+
+/** @brief The host thread's stack isn't bounded like a task's: report plenty */
+inline uint32_t uxTaskGetStackHighWaterMark(TaskHandle_t)
+{
+    return 64 * 1024;
+}
+
+/** @brief The benchmark's one thread, as one task */
+inline TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    static int token;
+    return &token;
+}
+
+inline const char* pcTaskGetName(TaskHandle_t)
+{
+    return "host";
+}
@@ -0,0 +1,6 @@
+/**
+ * @file sdkconfig.h
+ * @brief Host stand-in for the Kconfig header: no options set
+ */
+
+#pragma once
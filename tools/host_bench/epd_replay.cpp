@@ -0,0 +1,219 @@
+/**
+ * @file epd_replay.cpp
+ * @brief Replay an SPI recording (SPI_RECORD_ENABLED) into a simulated panel
+ *
+ * Feeds the transactions of EPDCACHE/SPI.REC to the controller model of
+ * epd_sim.hpp at their recorded clocks, keeping the host's own time between
+ * them, and waits out BUSY where the driver waited. It prints the span and
+ * BUSY time simulated against recorded, the refreshes the controller saw,
+ * and how many transactions reached it while BUSY was held: a driver change
+ * can be checked for timing and for what it leaves on the glass before it
+ * goes near a panel. --png saves the glass after each refresh.
+ *
+ * Usage:
+ *   epd_replay [--controller il0373|ssd1680] [--size SOURCESxGATES]
+ *              [--png PREFIX] SPI.REC
+ */
+
+#include "epd_sim.hpp"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Must match epd_record_header_t / epd_record_t in EPDRecorder.h
+constexpr uint32_t RECORD_MAGIC = 0x52445045;  // "EPDR"
+constexpr uint8_t RECORD_VERSION = 1;
+constexpr uint8_t KIND_TRANSACTION = 1;
+constexpr uint8_t KIND_BUSY = 2;
+constexpr uint8_t KIND_CLOCK = 3;
+constexpr uint8_t HEADER_FULL = 0x01;
+constexpr uint8_t FLAG_DATA = 0x01;
+constexpr uint8_t FLAG_READ = 0x04;
+constexpr uint8_t FLAG_IDLE = 0x08;
+
+#pragma pack(push, 1)
+struct RecordHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t flags;
+    uint16_t reserved;
+    uint32_t bytes;
+    uint32_t reserved2;
+};
+
+struct Record {
+    uint8_t kind;
+    uint8_t flags;
+    uint16_t len;
+    uint32_t timeUs;
+    uint32_t value;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(RecordHeader) == 16 && sizeof(Record) == 12, "SPI.REC layout");
+
+void usage()
+{
+    fprintf(stderr, "usage: epd_replay [--controller il0373|ssd1680] [--size SOURCESxGATES]\n"
+                    "                  [--png PREFIX] SPI.REC\n");
+}
+
+bool readFile(const char* path, std::vector<uint8_t>& data)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    uint8_t chunk[4096];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + got);
+    }
+    fclose(file);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    EpdSim::Controller controller = EpdSim::Controller::IL0373;
+    int sources = 128;
+    int gates = 296;
+    const char* pngPrefix = nullptr;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(arg, "--controller") == 0 && value) {
+            controller = strcmp(value, "ssd1680") == 0 ? EpdSim::Controller::SSD168X
+                                                       : EpdSim::Controller::IL0373;
+            i++;
+        } else if (strcmp(arg, "--size") == 0 && value) {
+            if (sscanf(value, "%dx%d", &sources, &gates) != 2 || sources <= 0 || sources % 8 ||
+                gates <= 0 || sources > INT16_MAX || gates > INT16_MAX) {
+                usage();
+                return 2;
+            }
+            i++;
+        } else if (strcmp(arg, "--png") == 0 && value) {
+            pngPrefix = value;
+            i++;
+        } else if (arg[0] == '-' || path) {
+            usage();
+            return 2;
+        } else {
+            path = arg;
+        }
+    }
+    if (!path) {
+        usage();
+        return 2;
+    }
+
+    std::vector<uint8_t> data;
+    if (!readFile(path, data)) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return 1;
+    }
+    RecordHeader header;
+    if (data.size() < sizeof(header)) {
+        fprintf(stderr, "%s: too short for a recording\n", path);
+        return 1;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != RECORD_MAGIC || header.version != RECORD_VERSION) {
+        fprintf(stderr, "%s: not an SPI recording (version %u)\n", path, RECORD_VERSION);
+        return 1;
+    }
+    if (header.flags & HEADER_FULL) {
+        printf("The buffer filled up: the recording stops early (SPI_RECORD_BYTES)\n");
+    }
+    size_t end = std::min<size_t>(data.size(), sizeof(header) + header.bytes);
+
+    EpdSim::Panel panel(controller, static_cast<int16_t>(sources), static_cast<int16_t>(gates),
+                        EpdSim::Timing());
+    uint32_t clock = 0;
+    bool started = false;
+    int64_t firstUs = 0;
+    int64_t hostUs = 0;  // Where the recorded host was when it last returned
+    int64_t recordedBusyUs = 0;
+    int64_t simulatedBusyUs = 0;
+    uint32_t waits = 0;
+    uint32_t timedOut = 0;
+    uint32_t refreshes = 0;
+    size_t offset = sizeof(header);
+    while (offset + sizeof(Record) <= end) {
+        Record record;
+        memcpy(&record, &data[offset], sizeof(record));
+        offset += sizeof(record);
+        if (record.kind == KIND_CLOCK) {
+            clock = record.value;
+            continue;
+        }
+        if (record.kind != KIND_TRANSACTION && record.kind != KIND_BUSY) {
+            fprintf(stderr, "%s: unknown record kind %u at byte %zu\n", path, record.kind,
+                    offset - sizeof(record));
+            return 1;
+        }
+
+        // The host's own time since it last returned from the driver
+        if (!started) {
+            started = true;
+            firstUs = hostUs = record.timeUs;
+        }
+        if (record.timeUs > hostUs) {
+            panel.advance(record.timeUs - hostUs);
+        }
+        hostUs = static_cast<int64_t>(record.timeUs) + record.value;
+
+        if (record.kind == KIND_BUSY) {
+            waits++;
+            timedOut += (record.flags & FLAG_IDLE) ? 0 : 1;
+            recordedBusyUs += record.value;
+            simulatedBusyUs += panel.waitBusy();
+            continue;
+        }
+        const uint8_t* bytes = nullptr;
+        if (!(record.flags & FLAG_READ)) {
+            if (offset + record.len > end) {
+                break;  // Cut off mid-record
+            }
+            bytes = &data[offset];
+            offset += record.len;
+        }
+        panel.transaction(record.flags & FLAG_DATA, bytes, record.len, clock);
+
+        const EpdSim::Stats& stats = panel.stats();
+        uint32_t seen = stats.refreshes[0] + stats.refreshes[1] + stats.refreshes[2];
+        if (seen != refreshes) {
+            refreshes = seen;
+            if (pngPrefix) {
+                char png[512];
+                snprintf(png, sizeof(png), "%s%03" PRIu32 ".png", pngPrefix, refreshes - 1);
+                if (!panel.writePng(png)) {
+                    fprintf(stderr, "%s: cannot write\n", png);
+                }
+            }
+        }
+    }
+
+    const EpdSim::Stats& stats = panel.stats();
+    printf("Span        recorded %10.1f ms, simulated %10.1f ms\n", (hostUs - firstUs) / 1000.0,
+           panel.nowUs() / 1000.0);
+    printf("BUSY waits  recorded %10.1f ms, simulated %10.1f ms (%" PRIu32 " waits, %" PRIu32
+           " timed out)\n",
+           recordedBusyUs / 1000.0, simulatedBusyUs / 1000.0, waits, timedOut);
+    printf("Bus         %" PRIu32 " transactions, %" PRIu64 " bytes, %.1f ms clocked\n",
+           stats.transactions, stats.bytes, stats.spiUs / 1000.0);
+    printf("Refreshes   %" PRIu32 " full, %" PRIu32 " fast, %" PRIu32 " partial\n",
+           stats.refreshes[EpdSim::REFRESH_FULL], stats.refreshes[EpdSim::REFRESH_FAST],
+           stats.refreshes[EpdSim::REFRESH_PARTIAL]);
+    printf("While BUSY  %" PRIu32 " transactions\n", stats.whileBusy);
+    return stats.whileBusy ? 1 : 0;
+}
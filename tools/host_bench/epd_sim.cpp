@@ -0,0 +1,366 @@
+/**
+ * @file epd_sim.cpp
+ * @brief Controller command interpretation, timing and PNG export
+ */
+
+#include "epd_sim.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace EpdSim {
+
+namespace {
+
+// IL0373 commands (drivers/Adafruit_IL0373.h)
+constexpr uint8_t IL0373_PANEL_SETTING = 0x00;
+constexpr uint8_t IL0373_POWER_OFF = 0x02;
+constexpr uint8_t IL0373_POWER_ON = 0x04;
+constexpr uint8_t IL0373_DTM1 = 0x10;
+constexpr uint8_t IL0373_DISPLAY_REFRESH = 0x12;
+constexpr uint8_t IL0373_DTM2 = 0x13;
+constexpr uint8_t IL0373_PARTIAL_WINDOW = 0x90;
+constexpr uint8_t IL0373_PARTIAL_ENTER = 0x91;
+constexpr uint8_t IL0373_PARTIAL_EXIT = 0x92;
+constexpr uint8_t IL0373_REG_EN = 0x20;  // Panel setting: LUTs from registers
+
+// SSD168x commands (drivers/Adafruit_SSD1680.h)
+constexpr uint8_t SSD_DATA_MODE = 0x11;
+constexpr uint8_t SSD_SW_RESET = 0x12;
+constexpr uint8_t SSD_MASTER_ACTIVATE = 0x20;
+constexpr uint8_t SSD_DISP_CTRL1 = 0x21;
+constexpr uint8_t SSD_DISP_CTRL2 = 0x22;
+constexpr uint8_t SSD_WRITE_RAM1 = 0x24;
+constexpr uint8_t SSD_WRITE_RAM2 = 0x26;
+constexpr uint8_t SSD_WRITE_LUT = 0x32;
+constexpr uint8_t SSD_SET_RAMXPOS = 0x44;
+constexpr uint8_t SSD_SET_RAMYPOS = 0x45;
+constexpr uint8_t SSD_SET_RAMXCOUNT = 0x4E;
+constexpr uint8_t SSD_SET_RAMYCOUNT = 0x4F;
+// 0x22 bits
+constexpr uint8_t SSD_UPDATE_LOAD_LUT = 0x10;
+constexpr uint8_t SSD_UPDATE_MODE2 = 0x08;
+constexpr uint8_t SSD_UPDATE_DISPLAY = 0x04;
+
+uint32_t crc32(uint32_t crc, const uint8_t* data, size_t len)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+void put32(std::vector<uint8_t>& out, uint32_t value)
+{
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+}
+
+void chunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& body)
+{
+    put32(out, static_cast<uint32_t>(body.size()));
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), body.begin(), body.end());
+    put32(out, crc32(0, &out[start], out.size() - start));
+}
+
+/**
+ * @brief zlib stream of stored (uncompressed) deflate blocks: no zlib
+ *        needed, and a panel image is small anyway
+ */
+std::vector<uint8_t> zlibStored(const std::vector<uint8_t>& raw)
+{
+    std::vector<uint8_t> out = { 0x78, 0x01 };
+    size_t offset = 0;
+    do {
+        size_t len = std::min<size_t>(raw.size() - offset, 65535);
+        bool last = offset + len == raw.size();
+        out.push_back(last ? 1 : 0);
+        out.push_back(static_cast<uint8_t>(len));
+        out.push_back(static_cast<uint8_t>(len >> 8));
+        out.push_back(static_cast<uint8_t>(~len));
+        out.push_back(static_cast<uint8_t>(~len >> 8));
+        out.insert(out.end(), raw.begin() + offset, raw.begin() + offset + len);
+        offset += len;
+    } while (offset < raw.size());
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (uint8_t byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    put32(out, (b << 16) | a);
+    return out;
+}
+
+} // namespace
+
+Panel::Panel(Controller controller, int16_t sources, int16_t gates, const Timing& timing)
+    : controller_(controller), sources_(sources), gates_(gates), timing_(timing)
+{
+    size_t size = static_cast<size_t>(sources / 8) * gates;
+    // Both blank: BW all white, RED all off (set bits on the IL0373)
+    ram_[0].assign(size, 0xFF);
+    ram_[1].assign(size, controller == Controller::IL0373 ? 0xFF : 0x00);
+    glass_[0] = ram_[0];
+    glass_[1] = ram_[1];
+    xEnd_ = static_cast<int16_t>(sources / 8 - 1);
+    yEnd_ = static_cast<int16_t>(gates - 1);
+}
+
+void Panel::transaction(bool data, const uint8_t* bytes, size_t len, uint32_t hz)
+{
+    stats_.transactions++;
+    stats_.bytes += len;
+    if (busy()) {
+        stats_.whileBusy++;
+    }
+    int64_t us = timing_.transactionUs;
+    if (hz > 0) {
+        us += (static_cast<int64_t>(len) * 8 * 1000000 + hz - 1) / hz;
+    }
+    stats_.spiUs += us;
+    nowUs_ += us;
+    if (!bytes) {
+        return;  // A read
+    }
+
+    size_t i = 0;
+    if (!data && len > 0) {
+        // A command byte; anything after it in the same transaction is
+        // clocked with DC low too, and taken as its arguments
+        cmd_ = bytes[i++];
+        argIndex_ = 0;
+        writing_ = -1;
+        bool il0373 = controller_ == Controller::IL0373;
+        if (il0373 && cmd_ == IL0373_POWER_ON) {
+            holdBusy(timing_.powerOnMs);
+        } else if (il0373 && cmd_ == IL0373_POWER_OFF) {
+            holdBusy(timing_.powerOffMs);
+        } else if (il0373 && (cmd_ == IL0373_DTM1 || cmd_ == IL0373_DTM2)) {
+            if (!partialMode_) {
+                xStart_ = 0;
+                xEnd_ = static_cast<int16_t>(sources_ / 8 - 1);
+                yStart_ = 0;
+                yEnd_ = static_cast<int16_t>(gates_ - 1);
+            }
+            x_ = xStart_;
+            y_ = yStart_;
+            writing_ = cmd_ == IL0373_DTM1 ? 0 : 1;
+        } else if (il0373 && cmd_ == IL0373_DISPLAY_REFRESH) {
+            refresh();
+        } else if (il0373 && cmd_ == IL0373_PARTIAL_ENTER) {
+            partialMode_ = true;
+        } else if (il0373 && cmd_ == IL0373_PARTIAL_EXIT) {
+            partialMode_ = false;
+        } else if (!il0373 && cmd_ == SSD_SW_RESET) {
+            holdBusy(timing_.resetMs);
+            registerLut_ = false;
+            entryMode_ = 0x03;
+            ramOption_ = 0x00;
+        } else if (!il0373 && (cmd_ == SSD_WRITE_RAM1 || cmd_ == SSD_WRITE_RAM2)) {
+            writing_ = cmd_ == SSD_WRITE_RAM1 ? 0 : 1;
+        } else if (!il0373 && cmd_ == SSD_MASTER_ACTIVATE) {
+            refresh();
+        }
+    }
+    for (; i < len; i++) {
+        argument(bytes[i]);
+    }
+}
+
+void Panel::command(uint8_t cmd, const uint8_t* args, size_t len, uint32_t hz)
+{
+    transaction(false, &cmd, 1, hz);
+    if (len > 0) {
+        transaction(true, args, len, hz);
+    }
+}
+
+int64_t Panel::waitBusy()
+{
+    int64_t waited = std::max<int64_t>(busyUntilUs_ - nowUs_, 0);
+    nowUs_ += waited;
+    return waited;
+}
+
+void Panel::argument(uint8_t value)
+{
+    if (writing_ >= 0) {
+        ramByte(value);
+        return;
+    }
+    size_t index = argIndex_++;
+    if (index < sizeof(args_)) {
+        args_[index] = value;
+    }
+    if (controller_ == Controller::IL0373) {
+        if (cmd_ == IL0373_PANEL_SETTING && index == 0) {
+            registerLut_ = (value & IL0373_REG_EN) != 0;
+        } else if (cmd_ == IL0373_PARTIAL_WINDOW && index == 5) {
+            // HRST, HRED in pixels; VRST, VRED as 16-bit lines
+            xStart_ = static_cast<int16_t>(std::min<int>(args_[0] / 8, sources_ / 8 - 1));
+            xEnd_ = static_cast<int16_t>(std::min<int>(args_[1] / 8, sources_ / 8 - 1));
+            yStart_ = static_cast<int16_t>(std::min<int>(args_[2] << 8 | args_[3], gates_ - 1));
+            yEnd_ = static_cast<int16_t>(std::min<int>(args_[4] << 8 | args_[5], gates_ - 1));
+        }
+        return;
+    }
+    switch (cmd_) {
+        case SSD_DATA_MODE:
+            entryMode_ = value & 0x07;
+            break;
+        case SSD_DISP_CTRL1:
+            if (index == 0) {
+                ramOption_ = value;
+            }
+            break;
+        case SSD_DISP_CTRL2:
+            updateMode_ = value;
+            break;
+        case SSD_WRITE_LUT:
+            registerLut_ = true;
+            break;
+        case SSD_SET_RAMXPOS:
+            if (index < 2) {
+                int16_t x = static_cast<int16_t>(std::min<int>(value, sources_ / 8 - 1));
+                (index == 0 ? xStart_ : xEnd_) = x;
+            }
+            break;
+        case SSD_SET_RAMYPOS:
+            if (index == 1 || index == 3) {
+                int y = std::min<int>(args_[index - 1] | args_[index] << 8, gates_ - 1);
+                (index == 1 ? yStart_ : yEnd_) = static_cast<int16_t>(y);
+            }
+            break;
+        case SSD_SET_RAMXCOUNT:
+            x_ = static_cast<int16_t>(std::min<int>(value, sources_ / 8 - 1));
+            break;
+        case SSD_SET_RAMYCOUNT:
+            if (index == 1) {
+                y_ = static_cast<int16_t>(std::min<int>(args_[0] | args_[1] << 8, gates_ - 1));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void Panel::ramByte(uint8_t value)
+{
+    size_t rowBytes = static_cast<size_t>(sources_ / 8);
+    if (x_ >= 0 && x_ < sources_ / 8 && y_ >= 0 && y_ < gates_) {
+        ram_[writing_][static_cast<size_t>(y_) * rowBytes + x_] = value;
+    }
+
+    // The counters run from the window's start towards its end, X first
+    // unless the SSD168x entry mode's AM bit says Y first
+    auto step = [](int16_t& counter, int16_t start, int16_t end) {
+        if (counter == end) {
+            counter = start;
+            return true;
+        }
+        counter = static_cast<int16_t>(counter + (end >= start ? 1 : -1));
+        return false;
+    };
+    bool yFirst = controller_ == Controller::SSD168X && (entryMode_ & 0x04);
+    if (yFirst) {
+        if (step(y_, yStart_, yEnd_)) {
+            step(x_, xStart_, xEnd_);
+        }
+    } else if (step(x_, xStart_, xEnd_)) {
+        step(y_, yStart_, yEnd_);
+    }
+}
+
+void Panel::holdBusy(uint32_t ms)
+{
+    int64_t until = std::max(busyUntilUs_, nowUs_) + static_cast<int64_t>(ms) * 1000;
+    stats_.busyUs += until - std::max(busyUntilUs_, nowUs_);
+    busyUntilUs_ = until;
+}
+
+void Panel::refresh()
+{
+    Refresh kind;
+    if (controller_ == Controller::IL0373) {
+        kind = partialMode_ ? REFRESH_PARTIAL : registerLut_ ? REFRESH_FAST : REFRESH_FULL;
+    } else {
+        if (!(updateMode_ & SSD_UPDATE_DISPLAY)) {
+            holdBusy(timing_.powerOnMs);  // Clock or analog on/off only
+            return;
+        }
+        kind = (updateMode_ & SSD_UPDATE_MODE2)                            ? REFRESH_PARTIAL
+               : (registerLut_ || !(updateMode_ & SSD_UPDATE_LOAD_LUT)) ? REFRESH_FAST
+                                                                        : REFRESH_FULL;
+    }
+    holdBusy(timing_.refreshMs[kind]);
+    stats_.refreshes[kind]++;
+    lastRefresh_ = kind;
+
+    if (controller_ == Controller::IL0373 && kind == REFRESH_PARTIAL) {
+        size_t rowBytes = static_cast<size_t>(sources_ / 8);
+        for (int16_t y = std::min(yStart_, yEnd_); y <= std::max(yStart_, yEnd_); y++) {
+            for (int16_t x = std::min(xStart_, xEnd_); x <= std::max(xStart_, xEnd_); x++) {
+                size_t i = static_cast<size_t>(y) * rowBytes + x;
+                glass_[0][i] = ram_[0][i];
+                glass_[1][i] = ram_[1][i];
+            }
+        }
+    } else {
+        glass_[0] = ram_[0];
+        glass_[1] = ram_[1];
+    }
+}
+
+bool Panel::writePng(const char* path) const
+{
+    // Which bit level inks each plane
+    bool il0373 = controller_ == Controller::IL0373;
+    uint8_t blackLevel = (!il0373 && (ramOption_ & 0x08)) ? 1 : 0;
+    uint8_t redLevel = il0373 ? 0 : ((ramOption_ & 0x80) ? 0 : 1);
+
+    size_t rowBytes = static_cast<size_t>(sources_ / 8);
+    std::vector<uint8_t> raw;
+    raw.reserve(static_cast<size_t>(gates_) * (1 + sources_ * 3));
+    for (int16_t y = 0; y < gates_; y++) {
+        raw.push_back(0);  // Filter: none
+        for (int16_t x = 0; x < sources_; x++) {
+            size_t i = static_cast<size_t>(y) * rowBytes + x / 8;
+            uint8_t shift = static_cast<uint8_t>(7 - x % 8);
+            bool black = ((glass_[0][i] >> shift) & 1) == blackLevel;
+            bool red = ((glass_[1][i] >> shift) & 1) == redLevel;
+            uint8_t rgb[3] = { 255, 255, 255 };
+            if (red) {
+                rgb[1] = rgb[2] = 0;
+            } else if (black) {
+                rgb[0] = rgb[1] = rgb[2] = 0;
+            }
+            raw.insert(raw.end(), rgb, rgb + 3);
+        }
+    }
+
+    std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    std::vector<uint8_t> header;
+    put32(header, static_cast<uint32_t>(sources_));
+    put32(header, static_cast<uint32_t>(gates_));
+    header.insert(header.end(), { 8, 2, 0, 0, 0 });  // 8-bit RGB
+    chunk(png, "IHDR", header);
+    chunk(png, "IDAT", zlibStored(raw));
+    chunk(png, "IEND", {});
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = fwrite(png.data(), 1, png.size(), file) == png.size();
+    return fclose(file) == 0 && ok;
+}
+
+} // namespace EpdSim
@@ -0,0 +1,144 @@
+/**
+ * @file epd_sim.hpp
+ * @brief Host model of an IL0373 or SSD168x panel controller with timing
+ *
+ * Takes the SPI transactions a driver would send (command with DC low,
+ * arguments and plane data with DC high) and interprets them: RAM writes
+ * land in the two RAM planes through the controller's window and address
+ * counters, and a refresh copies them to the glass, which writePng()
+ * saves. Time is simulated. Each transaction takes its bits at the clock it
+ * was sent with plus a fixed setup cost. Power-on, reset and refresh hold
+ * BUSY for the Timing of their kind, and waitBusy() jumps the clock past
+ * it. Commands sent while BUSY is held are counted, since a real panel
+ * drops or mangles them.
+ *
+ * The refresh kind follows the controller's registers: on the IL0373 a
+ * partial window (0x91) is a partial refresh and register LUTs (panel
+ * setting REG_EN) the fast one; on the SSD168x display mode 2 in 0x22 is
+ * partial, and a LUT written with 0x32 or 0x22 skipping the LUT load is
+ * fast. Colors are modeled for black/white/red; gray panels show their
+ * planes' bits as black and red.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace EpdSim {
+
+enum class Controller : uint8_t { IL0373, SSD168X };
+
+// Refresh kinds, in epd_refresh_t order
+enum Refresh : uint8_t { REFRESH_FULL, REFRESH_FAST, REFRESH_PARTIAL, REFRESH_KINDS };
+
+/**
+ * @brief How long the controller takes
+ */
+struct Timing {
+    uint32_t transactionUs = 10;  // CS, DC and driver setup per transaction
+    uint32_t powerOnMs = 80;      // IL0373 power on (0x04)
+    uint32_t powerOffMs = 20;     // IL0373 power off (0x02)
+    uint32_t resetMs = 10;        // SSD168x software reset (0x12)
+    uint32_t refreshMs[REFRESH_KINDS] = { 13000, 1000, 1000 };
+};
+
+/**
+ * @brief What the controller has been sent and how long it took
+ */
+struct Stats {
+    uint32_t transactions;
+    uint64_t bytes;
+    int64_t spiUs;       // Bus time, setup included
+    int64_t busyUs;      // BUSY held, waited out or not
+    uint32_t whileBusy;  // Transactions sent while BUSY was held
+    uint32_t refreshes[REFRESH_KINDS];
+};
+
+class Panel {
+public:
+    /**
+     * @param sources Source lines (RAM X), a multiple of 8
+     * @param gates Gate lines (RAM Y)
+     */
+    Panel(Controller controller, int16_t sources, int16_t gates, const Timing& timing);
+
+    /**
+     * @brief One SPI transaction
+     * @param data DC level: false for a command byte, true for its arguments
+     * @param bytes Bytes sent
+     * @param hz SPI clock
+     */
+    void transaction(bool data, const uint8_t* bytes, size_t len, uint32_t hz);
+
+    /**
+     * @brief A command and its arguments, as two transactions
+     */
+    void command(uint8_t cmd, const uint8_t* args, size_t len, uint32_t hz);
+
+    /**
+     * @brief Wait for BUSY to be released
+     * @return Microseconds waited
+     */
+    int64_t waitBusy();
+
+    /**
+     * @brief Let time pass on the host side, e.g. a driver delay()
+     */
+    void advance(int64_t us) { nowUs_ += us; }
+
+    int64_t nowUs() const { return nowUs_; }
+    bool busy() const { return nowUs_ < busyUntilUs_; }
+    const Stats& stats() const { return stats_; }
+
+    /**
+     * @brief Kind of the last refresh started
+     */
+    Refresh lastRefresh() const { return lastRefresh_; }
+
+    /**
+     * @brief Save the glass as an RGB PNG, sources across, gates down
+     * @return false if the file could not be written
+     */
+    bool writePng(const char* path) const;
+
+private:
+    void argument(uint8_t value);
+    void ramByte(uint8_t value);
+    void holdBusy(uint32_t ms);
+    void refresh();
+
+    Controller controller_;
+    int16_t sources_;
+    int16_t gates_;
+    Timing timing_;
+    Stats stats_ = {};
+    int64_t nowUs_ = 0;
+    int64_t busyUntilUs_ = 0;
+    Refresh lastRefresh_ = REFRESH_FULL;
+
+    std::vector<uint8_t> ram_[2];    // BW, RED as sent
+    std::vector<uint8_t> glass_[2];  // As of the last refresh
+
+    uint8_t cmd_ = 0;
+    size_t argIndex_ = 0;
+    uint8_t args_[8] = {};
+    int writing_ = -1;  // RAM plane data goes to, -1 for none
+
+    // RAM window in bytes (X) and lines (Y), inclusive, and address counters
+    int16_t xStart_ = 0;
+    int16_t xEnd_ = 0;
+    int16_t yStart_ = 0;
+    int16_t yEnd_ = 0;
+    int16_t x_ = 0;
+    int16_t y_ = 0;
+
+    bool partialMode_ = false;   // IL0373 0x91
+    bool registerLut_ = false;   // IL0373 REG_EN, SSD168x LUT written
+    uint8_t entryMode_ = 0x03;   // SSD168x 0x11: X then Y, both increasing
+    uint8_t updateMode_ = 0xF7;  // SSD168x 0x22
+    uint8_t ramOption_ = 0x00;   // SSD168x 0x21 first byte: RAM inversion
+};
+
+} // namespace EpdSim
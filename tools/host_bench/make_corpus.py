@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""
+Generate a BMP corpus for bmp_bench: every format the decoder reads
+(1/4/8/24 bpp, RLE8, RLE4, top-down) at panel size, larger, and smaller,
+so each scaler path (1:1, area shrink, upscale) is covered.
+
+Usage:
+    tools/host_bench/make_corpus.py -o /tmp/corpus
+
+The files are written directly, no imaging library needed.
+"""
+
+import argparse
+import os
+import struct
+
+# (name, width, height)
+SIZES = (
+    ("panel", 128, 296),
+    ("medium", 320, 740),
+    ("photo", 1600, 1200),
+    ("small", 64, 100),
+)
+
+BI_RGB, BI_RLE8, BI_RLE4 = 0, 1, 2
+
+
+def pixel(x, y, width, height):
+    """Gradients with red squares and a black disc: all three inks, and dithering."""
+    r = x * 255 // max(width - 1, 1)
+    g = y * 255 // max(height - 1, 1)
+    b = (x + y) * 255 // max(width + height - 2, 1)
+    step = max(width // 8, 4)
+    if height // 4 <= y < height // 4 + step and (x // step) % 2 == 0:
+        return 220, 20, 20
+    cx, cy, rad = width // 2, height * 5 // 8, min(width, height) // 4
+    if (x - cx) ** 2 + (y - cy) ** 2 < rad * rad:
+        return 0, 0, 0
+    return r, g, b
+
+
+def palette(bpp):
+    """Gray ramp plus pure red, so indices map onto every ink."""
+    count = 1 << bpp
+    colors = [(i * 255 // (count - 1),) * 3 for i in range(count)]
+    if count > 2:
+        colors[-2] = (220, 20, 20)
+    return colors
+
+
+def index_of(rgb, bpp):
+    """Palette index for a pixel: red for the red patches, else its gray level."""
+    count = 1 << bpp
+    r, g, b = rgb
+    if count > 2 and r > 128 and g < 80 and b < 80:
+        return count - 2
+    gray = (r * 30 + g * 59 + b * 11) // 100
+    index = gray * (count - 1) // 255
+    return count - 3 if count > 2 and index == count - 2 else index
+
+
+def pack_row(indices, bpp):
+    bits = "".join(format(i, f"0{bpp}b") for i in indices)
+    bits += "0" * (-len(bits) % 32)
+    return bytes(int(bits[i:i + 8], 2) for i in range(0, len(bits), 8))
+
+
+def rle_row(indices, bpp):
+    """One row as encoded runs (no absolute mode), then end of line."""
+    out = bytearray()
+    i = 0
+    while i < len(indices):
+        run = 1
+        limit = 255
+        while i + run < len(indices) and run < limit and indices[i + run] == indices[i]:
+            run += 1
+        value = indices[i] if bpp == 8 else (indices[i] << 4) | indices[i]
+        out += bytes((run, value))
+        i += run
+    return bytes(out) + b"\x00\x00"
+
+
+def write_bmp(path, image, bpp, compression=BI_RGB, top_down=False):
+    """image: rows of RGB tuples, top row first."""
+    width, height = len(image[0]), len(image)
+    colors = palette(bpp) if bpp <= 8 else []
+    rows = []
+    for y in range(height):
+        rgb = image[y if top_down else height - 1 - y]  # file order
+        if bpp == 24:
+            row = b"".join(bytes((p[2], p[1], p[0])) for p in rgb)
+            row += b"\x00" * (-len(row) % 4)
+        else:
+            indices = [index_of(p, bpp) for p in rgb]
+            row = rle_row(indices, bpp) if compression != BI_RGB else pack_row(indices, bpp)
+        rows.append(row)
+    data = b"".join(rows)
+    if compression != BI_RGB:
+        data += b"\x00\x01"  # end of bitmap
+
+    table = b"".join(bytes((c[2], c[1], c[0], 0)) for c in colors)
+    offset = 14 + 40 + len(table)
+    header = struct.pack("<2sIHHI", b"BM", offset + len(data), 0, 0, offset)
+    info = struct.pack("<IiiHHIIiiII", 40, width, -height if top_down else height, 1, bpp,
+                       compression, len(data), 2835, 2835, len(colors), 0)
+    with open(path, "wb") as f:
+        f.write(header + info + table + data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("-o", "--output", required=True, help="output directory")
+    args = parser.parse_args()
+    os.makedirs(args.output, exist_ok=True)
+
+    variants = (
+        ("24", 24, BI_RGB, False),
+        ("24td", 24, BI_RGB, True),
+        ("8", 8, BI_RGB, False),
+        ("4", 4, BI_RGB, False),
+        ("1", 1, BI_RGB, False),
+        ("rle8", 8, BI_RLE8, False),
+        ("rle4", 4, BI_RLE4, False),
+    )
+    for name, width, height in SIZES:
+        image = [[pixel(x, y, width, height) for x in range(width)] for y in range(height)]
+        for suffix, bpp, compression, top_down in variants:
+            path = os.path.join(args.output, f"{name}_{suffix}.bmp")
+            write_bmp(path, image, bpp, compression, top_down)
+            print(path)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+"""
+Decode the slideshow's binary performance log (PERF_LOG_ENABLED).
+
+The device appends 64-byte entries to EPDCACHE/PERF.LOG on the SD card and
+rotates it to PERF.OLD when it grows past PERF_LOG_MAX_BYTES. Each entry
+is one of:
+
+    slide    stage times in ms, SPI traffic, memory lows, temperature, battery
+    power    one slide's power window: time, estimated charge, time per load
+    failure  an image that failed to load
+
+Padding (all zero) is skipped. Sequence numbers restart at 0 on power-on, so
+a drop to 0 marks a reboot and any other gap marks entries the device had
+no room for.
+
+Usage:
+    tools/perf_log.py /media/card/EPDCACHE/PERF.OLD /media/card/EPDCACHE/PERF.LOG
+    tools/perf_log.py PERF.LOG --csv slides.csv
+"""
+
+import argparse
+import csv
+import datetime
+import struct
+import sys
+
+# Must match Entry in main/perf_log.cpp
+ENTRY_SIZE = 64
+ENTRY_MAGIC = 0xE1
+HEADER = struct.Struct("<BBHIII")
+SLIDE = struct.Struct("<12HHBbIHHIIHH")
+POWER = struct.Struct("<II6I")
+KIND_SLIDE, KIND_POWER, KIND_FAILURE = 1, 2, 3
+SLIDE_FLAG_ALARM, SLIDE_FLAG_SPI = 0x01, 0x02
+
+# SlideStats::stageName() and PowerStats::loadName()
+STAGES = ["mount", "scan", "open", "read", "decode", "pack", "wait",
+          "power-up", "plane1", "plane2", "refresh", "power-down"]
+LOADS = ["cpu", "spi", "sd", "panel", "refresh", "radio"]
+
+
+def read_entries(paths):
+    """Every entry in the files, in order, as dicts."""
+    for path in paths:
+        with open(path, "rb") as f:
+            data = f.read()
+        for offset in range(0, len(data) - ENTRY_SIZE + 1, ENTRY_SIZE):
+            raw = data[offset:offset + ENTRY_SIZE]
+            magic, kind, slide, seq, unix_time, uptime_ms = HEADER.unpack_from(raw)
+            if magic != ENTRY_MAGIC:
+                continue
+            entry = {
+                "seq": seq,
+                "time": unix_time,
+                "uptime_ms": uptime_ms,
+                "slide": None if slide == 0xFFFF else slide + 1,
+            }
+            if kind == KIND_SLIDE:
+                fields = SLIDE.unpack_from(raw, HEADER.size)
+                ms, mask, flags = fields[:12], fields[12], fields[13]
+                entry["kind"] = "slide"
+                entry["stages"] = {STAGES[i]: ms[i] for i in range(len(STAGES)) if mask & (1 << i)}
+                entry["alarm"] = bool(flags & SLIDE_FLAG_ALARM)
+                entry["celsius"] = None if fields[14] == -128 else fields[14]
+                if flags & SLIDE_FLAG_SPI:
+                    entry["spi_bytes"], entry["spi_transactions"], entry["spi_busy_ms"] = fields[15:18]
+                entry["min_free_heap"], entry["min_largest_block"], entry["min_stack_free"] = fields[18:21]
+                entry["battery_mv"] = fields[21] or None
+            elif kind == KIND_POWER:
+                fields = POWER.unpack_from(raw, HEADER.size)
+                entry["kind"] = "power"
+                entry["elapsed_ms"], entry["charge_uas"] = fields[:2]
+                entry["loads"] = dict(zip(LOADS, fields[2:]))
+            elif kind == KIND_FAILURE:
+                entry["kind"] = "failure"
+            else:
+                continue
+            yield entry
+
+
+def timestamp(entry):
+    if entry["time"]:
+        return datetime.datetime.fromtimestamp(entry["time"], datetime.timezone.utc).strftime("%Y-%m-%d %H:%M:%S")
+    return f"+{entry['uptime_ms'] / 1000:.1f}s"
+
+
+def describe(entry):
+    slide = "boot" if entry["slide"] is None else f"slide {entry['slide']}"
+    if entry["kind"] == "slide":
+        stages = " ".join(f"{name} {ms}" for name, ms in entry["stages"].items())
+        text = f"{slide}: {stages} ms"
+        if "spi_bytes" in entry:
+            text += f", SPI {entry['spi_bytes']} B"
+        text += f", heap min {entry['min_free_heap']} block {entry['min_largest_block']}"
+        if entry["celsius"] is not None:
+            text += f", {entry['celsius']} C"
+        if entry["battery_mv"]:
+            text += f", {entry['battery_mv']} mV"
+        if entry["alarm"]:
+            text += ", MEMORY ALARM"
+        return text
+    if entry["kind"] == "power":
+        loads = " ".join(f"{name} {ms}" for name, ms in entry["loads"].items() if ms)
+        text = f"{slide}: {entry['charge_uas'] / 3600:.1f} uAh over {entry['elapsed_ms'] / 1000:.1f} s"
+        return text + f" ({loads} ms)" if loads else text
+    return f"{slide}: FAILED to load"
+
+
+def write_csv(path, entries):
+    columns = (["seq", "time", "uptime_ms", "kind", "slide"] + [f"{s}_ms" for s in STAGES] +
+               ["spi_bytes", "spi_transactions", "spi_busy_ms", "min_free_heap", "min_largest_block",
+                "min_stack_free", "celsius", "battery_mv", "alarm", "elapsed_ms", "charge_uas"] +
+               [f"{load}_on_ms" for load in LOADS])
+    with open(path, "w", newline="") as f:
+        writer = csv.DictWriter(f, columns, extrasaction="ignore")
+        writer.writeheader()
+        for entry in entries:
+            row = dict(entry)
+            row.update({f"{s}_ms": ms for s, ms in entry.get("stages", {}).items()})
+            row.update({f"{load}_on_ms": ms for load, ms in entry.get("loads", {}).items()})
+            writer.writerow(row)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("logs", nargs="+", help="PERF.OLD and PERF.LOG, oldest first")
+    parser.add_argument("--csv", help="write one row per entry here instead of printing")
+    args = parser.parse_args()
+
+    entries = list(read_entries(args.logs))
+    if args.csv:
+        write_csv(args.csv, entries)
+        print(f"{len(entries)} entries -> {args.csv}")
+        return
+
+    previous = None
+    for entry in entries:
+        if previous is not None and entry["seq"] != previous + 1:
+            print("--- reboot ---" if entry["seq"] == 0 else f"--- {entry['seq'] - previous - 1} entries dropped ---")
+        previous = entry["seq"]
+        print(f"{entry['seq']:6} {timestamp(entry):>19}  {describe(entry)}")
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,205 @@
+#!/usr/bin/env python3
+"""
+Replay a panel SPI recording (SPI_RECORD_ENABLED) into bus figures.
+
+The console's "spirec sd" writes EPDCACHE/SPI.REC: every transaction of the
+panel's SPI device with its DC level, clock, bytes and times, and every
+BUSY wait (components/Adafruit_EPD/src/EPDRecorder.h). This replays it on
+the host:
+
+    occupancy  time the bus clocks bits, against the recording's span
+    counts     transactions by kind and size, bytes, bytes per command
+    gaps       idle time between transactions outside BUSY waits
+
+Queued transactions are timed as the driver runs them, back to back from
+when they were queued; blocking ones start when issued. --clock replays the
+same traffic at another SPI clock, to see what a faster bus would buy.
+
+Usage:
+    tools/spi_replay.py /media/card/EPDCACHE/SPI.REC
+    tools/spi_replay.py SPI.REC --clock 20000000 --csv transactions.csv
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+# Must match epd_record_header_t / epd_record_t in EPDRecorder.h
+RECORD_MAGIC = 0x52445045  # "EPDR"
+RECORD_VERSION = 1
+HEADER = struct.Struct("<IBBHII")
+RECORD = struct.Struct("<BBHII")
+KIND_TRANSACTION, KIND_BUSY, KIND_CLOCK = 1, 2, 3
+FLAG_FULL = 0x01
+FLAG_DATA, FLAG_QUEUED, FLAG_READ, FLAG_IDLE = 0x01, 0x02, 0x04, 0x08
+
+SIZE_BUCKETS = [(1, "1"), (4, "2-4"), (32, "5-32"), (512, "33-512"), (None, ">512")]
+
+
+def read_log(path):
+    """(header flags, [events]) with each event a dict."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < HEADER.size:
+        sys.exit(f"{path}: too short for a recording")
+    magic, version, flags, _, size, _ = HEADER.unpack_from(data)
+    if magic != RECORD_MAGIC or version != RECORD_VERSION:
+        sys.exit(f"{path}: not an SPI recording (version {RECORD_VERSION})")
+    end = min(len(data), HEADER.size + size)
+
+    events = []
+    clock = 0
+    offset = HEADER.size
+    while offset + RECORD.size <= end:
+        kind, rflags, length, time_us, value = RECORD.unpack_from(data, offset)
+        offset += RECORD.size
+        if kind == KIND_CLOCK:
+            clock = value
+        elif kind == KIND_BUSY:
+            events.append({"kind": "busy", "start": time_us, "duration": value,
+                           "idle": bool(rflags & FLAG_IDLE)})
+        elif kind == KIND_TRANSACTION:
+            payload = b""
+            if not rflags & FLAG_READ:
+                payload = data[offset:offset + length]
+                offset += length
+            events.append({"kind": "txn", "start": time_us, "blocked": value,
+                           "len": length, "clock": clock, "payload": payload,
+                           "data": bool(rflags & FLAG_DATA),
+                           "queued": bool(rflags & FLAG_QUEUED),
+                           "read": bool(rflags & FLAG_READ)})
+        else:
+            sys.exit(f"{path}: unknown record kind {kind} at byte {offset - RECORD.size}")
+    return flags, events
+
+
+def replay(events, clock_override):
+    """Place each transaction on the wire; returns the transactions, each
+    with wire_start and wire_end in us, and the BUSY waits."""
+    cursor = 0.0
+    txns, waits = [], []
+    for event in events:
+        if event["kind"] == "busy":
+            waits.append(event)
+            cursor = max(cursor, event["start"] + event["duration"])
+            continue
+        clock = clock_override or event["clock"]
+        wire = event["len"] * 8 * 1e6 / clock if clock else 0.0
+        start = max(float(event["start"]), cursor)
+        end = start + wire
+        if not event["queued"] and not clock_override:
+            # A blocking transaction returned after the measured time
+            end = max(end, event["start"] + event["blocked"])
+        event["wire_start"], event["wire_end"], event["wire"] = start, end, wire
+        cursor = end
+        txns.append(event)
+    return txns, waits
+
+
+def percentile(values, p):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(len(ordered) * p / 100))] if ordered else 0
+
+
+def report(txns, waits):
+    if not txns:
+        print("No transactions recorded")
+        return
+    span = max(t["wire_end"] for t in txns) - txns[0]["wire_start"]
+    busy = sum(w["duration"] for w in waits)
+    wire = sum(t["wire"] for t in txns)
+    blocked = sum(t["blocked"] for t in txns if not t["queued"])
+    bytes_total = sum(t["len"] for t in txns)
+    outside_busy = max(span - busy, 1e-9)
+
+    print(f"Span        {span / 1000:10.1f} ms, {len(waits)} BUSY waits {busy / 1000:.1f} ms"
+          f" ({sum(1 for w in waits if not w['idle'])} timed out)")
+    print(f"Bus clocked {wire / 1000:10.1f} ms: {100 * wire / max(span, 1e-9):.1f}% of the span,"
+          f" {100 * wire / outside_busy:.1f}% outside BUSY waits")
+    print(f"Blocked     {blocked / 1000:10.1f} ms in blocking transactions")
+    print()
+
+    commands = sum(1 for t in txns if not t["data"])
+    data = sum(1 for t in txns if t["data"] and not t["read"])
+    print(f"Transactions {len(txns)}: {commands} command, {data} data,"
+          f" {sum(1 for t in txns if t['queued'])} queued,"
+          f" {sum(1 for t in txns if t['read'])} reads; {bytes_total} bytes")
+    low = 0
+    for high, name in SIZE_BUCKETS:
+        sized = [t for t in txns if t["len"] > low and (high is None or t["len"] <= high)]
+        if sized:
+            print(f"  {name:>7} bytes: {len(sized):6} transactions,"
+                  f" {sum(t['len'] for t in sized):8} bytes")
+        low = high or low
+    print()
+
+    # Bytes per command: data transactions belong to the command before them
+    per_command = {}
+    current = None
+    for t in txns:
+        if not t["data"] and t["payload"]:
+            current = t["payload"][0]
+            entry = per_command.setdefault(current, [0, 0, 0.0])
+            entry[0] += 1
+        elif current is not None:
+            entry = per_command[current]
+            entry[1] += t["len"]
+        if current is not None:
+            per_command[current][2] += t["wire_end"] - t["wire_start"]
+    print("Command  sent  data bytes  bus ms")
+    for cmd, (count, nbytes, us) in sorted(per_command.items(), key=lambda kv: -kv[1][2]):
+        print(f"   0x{cmd:02X} {count:5} {nbytes:11} {us / 1000:7.2f}")
+    print()
+
+    # Idle gaps between transactions, BUSY waits taken out
+    gaps = []
+    for prev, nxt in zip(txns, txns[1:]):
+        gap = nxt["wire_start"] - prev["wire_end"]
+        for w in waits:
+            overlap = min(nxt["wire_start"], w["start"] + w["duration"]) - \
+                max(prev["wire_end"], w["start"])
+            gap -= max(overlap, 0)
+        if gap > 0:
+            gaps.append((gap, prev))
+    values = [g for g, _ in gaps]
+    if values:
+        print(f"Idle gaps {len(values)}: total {sum(values) / 1000:.1f} ms,"
+              f" median {percentile(values, 50):.0f} us, p90 {percentile(values, 90):.0f} us,"
+              f" max {max(values):.0f} us")
+        for gap, prev in sorted(gaps, key=lambda g: -g[0])[:5]:
+            kind = "data" if prev["data"] else "command"
+            first = f" 0x{prev['payload'][0]:02X}" if prev["payload"] and not prev["data"] else ""
+            print(f"  {gap:9.0f} us after {kind}{first} at {prev['wire_end'] / 1000:.1f} ms")
+
+
+def write_csv(path, txns):
+    with open(path, "w", newline="") as f:
+        out = csv.writer(f)
+        out.writerow(["start_us", "wire_start_us", "wire_end_us", "bytes", "dc", "queued",
+                      "read", "blocked_us", "clock_hz", "first_byte"])
+        for t in txns:
+            out.writerow([t["start"], f"{t['wire_start']:.1f}", f"{t['wire_end']:.1f}", t["len"],
+                          int(t["data"]), int(t["queued"]), int(t["read"]), t["blocked"],
+                          t["clock"], f"0x{t['payload'][0]:02X}" if t["payload"] else ""])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("log", help="SPI.REC from the card")
+    parser.add_argument("--clock", type=int, default=0,
+                        help="replay at this SPI clock in Hz instead of the recorded ones")
+    parser.add_argument("--csv", help="also write every transaction to this CSV file")
+    args = parser.parse_args()
+
+    flags, events = read_log(args.log)
+    if flags & FLAG_FULL:
+        print("The buffer filled up: the recording stops early (SPI_RECORD_BYTES)")
+    txns, waits = replay(events, args.clock)
+    report(txns, waits)
+    if args.csv:
+        write_csv(args.csv, txns)
+
+
+if __name__ == "__main__":
+    main()